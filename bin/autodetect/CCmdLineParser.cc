@@ -54,6 +54,11 @@ bool CCmdLineParser::parse(int argc,
                            bool& multivariateByFields,
                            std::string& multipleBucketspans,
                            bool& perPartitionNormalization,
+                           std::size_t& numberThreads,
+                           std::size_t& maxDeltaSnapshots,
+                           std::size_t& periodicityTestSpread,
+                           std::size_t& inputReadAheadDepth,
+                           bool& binaryState,
                            TStrVec& clauseTokens) {
     try {
         boost::program_options::options_description desc(DESCRIPTION);
@@ -121,6 +126,16 @@ bool CCmdLineParser::parse(int argc,
                         "Optional comma-separated list of additional bucketspans - must be direct multiples of the main bucketspan")
             ("perPartitionNormalization",
                         "Optional flag to enable per partition normalization")
+            ("numberThreads", boost::program_options::value<std::size_t>(),
+                        "Optional number of threads to use to add records to and process the detectors at the end of each bucket - defaults to 1")
+            ("maxDeltaSnapshots", boost::program_options::value<std::size_t>(),
+                        "Optional maximum number of delta snapshots, containing only the detectors which have been sent records since the previous snapshot, to persist in the background between full snapshots - defaults to 0, meaning every snapshot is full")
+            ("periodicityTestSpread", boost::program_options::value<std::size_t>(),
+                        "Optional number of buckets over which to spread the time series' periodicity tests, which are then run in batches at the end of each bucket - defaults to 0, meaning each test runs as soon as it is due")
+            ("inputReadAheadDepth", boost::program_options::value<std::size_t>(),
+                        "Optional number of 64KB blocks of input to read ahead on a separate thread - defaults to 0, meaning input is read on the processing thread")
+            ("binaryState",
+                        "Optional flag to persist state in a compact binary format rather than JSON - state in either format can be restored")
         ;
         // clang-format on
 
@@ -240,6 +255,21 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("perPartitionNormalization") > 0) {
             perPartitionNormalization = true;
         }
+        if (vm.count("numberThreads") > 0) {
+            numberThreads = vm["numberThreads"].as<std::size_t>();
+        }
+        if (vm.count("maxDeltaSnapshots") > 0) {
+            maxDeltaSnapshots = vm["maxDeltaSnapshots"].as<std::size_t>();
+        }
+        if (vm.count("periodicityTestSpread") > 0) {
+            periodicityTestSpread = vm["periodicityTestSpread"].as<std::size_t>();
+        }
+        if (vm.count("inputReadAheadDepth") > 0) {
+            inputReadAheadDepth = vm["inputReadAheadDepth"].as<std::size_t>();
+        }
+        if (vm.count("binaryState") > 0) {
+            binaryState = true;
+        }
 
         boost::program_options::collect_unrecognized(
             parsed.options, boost::program_options::include_positional)
@@ -66,6 +66,11 @@ public:
                       bool& multivariateByFields,
                       std::string& multipleBucketspans,
                       bool& perPartitionNormalization,
+                      std::size_t& numberThreads,
+                      std::size_t& maxDeltaSnapshots,
+                      std::size_t& periodicityTestSpread,
+                      std::size_t& inputReadAheadDepth,
+                      bool& binaryState,
                       TStrVec& clauseTokens);
 
 private:
@@ -88,6 +88,11 @@ int main(int argc, char** argv) {
     bool multivariateByFields(false);
     std::string multipleBucketspans;
     bool perPartitionNormalization(false);
+    std::size_t numberThreads(1);
+    std::size_t maxDeltaSnapshots(0);
+    std::size_t periodicityTestSpread(0);
+    std::size_t inputReadAheadDepth(0);
+    bool binaryState(false);
     TStrVec clauseTokens;
     if (ml::autodetect::CCmdLineParser::parse(
             argc, argv, limitConfigFile, modelConfigFile, fieldConfigFile,
@@ -98,7 +103,8 @@ int main(int argc, char** argv) {
             isOutputFileNamedPipe, restoreFileName, isRestoreFileNamedPipe,
             persistFileName, isPersistFileNamedPipe, maxAnomalyRecords, memoryUsage,
             bucketResultsDelay, multivariateByFields, multipleBucketspans,
-            perPartitionNormalization, clauseTokens) == false) {
+            perPartitionNormalization, numberThreads, maxDeltaSnapshots,
+            periodicityTestSpread, inputReadAheadDepth, binaryState, clauseTokens) == false) {
         return EXIT_FAILURE;
     }
 
@@ -120,6 +126,9 @@ int main(int argc, char** argv) {
 
     ml::core::CProcessPriority::reducePriority();
 
+    if (inputReadAheadDepth > 0) {
+        ioMgr.readInputAhead(inputReadAheadDepth);
+    }
     if (ioMgr.initIo() == false) {
         LOG_FATAL(<< "Failed to initialise IO");
         return EXIT_FAILURE;
@@ -222,7 +231,9 @@ int main(int argc, char** argv) {
                              boost::bind(&ml::api::CModelSnapshotJsonWriter::write,
                                          &modelSnapshotWriter, _1),
                              periodicPersister.get(), maxQuantileInterval,
-                             timeField, timeFormat, maxAnomalyRecords);
+                             timeField, timeFormat, maxAnomalyRecords,
+                             numberThreads, maxDeltaSnapshots,
+                             periodicityTestSpread, binaryState);
 
     if (!quantilesStateFile.empty()) {
         if (job.initNormalizer(quantilesStateFile) == false) {
@@ -34,7 +34,8 @@ bool CCmdLineParser::parse(int argc,
                            bool& isRestoreFileNamedPipe,
                            std::string& persistFileName,
                            bool& isPersistFileNamedPipe,
-                           std::string& categorizationFieldName) {
+                           std::string& categorizationFieldName,
+                           std::size_t& numberThreads) {
     try {
         boost::program_options::options_description desc(DESCRIPTION);
         // clang-format off
@@ -69,6 +70,8 @@ bool CCmdLineParser::parse(int argc,
                         "Optional interval at which to periodically persist model state - if not specified then models will only be persisted at program exit")
             ("categorizationfield", boost::program_options::value<std::string>(),
                         "Field to compute mlcategory from")
+            ("numberThreads", boost::program_options::value<std::size_t>(),
+                        "Optional number of threads to use to categorize records - defaults to 1")
         ;
         // clang-format on
 
@@ -133,6 +136,9 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("categorizationfield") > 0) {
             categorizationFieldName = vm["categorizationfield"].as<std::string>();
         }
+        if (vm.count("numberThreads") > 0) {
+            numberThreads = vm["numberThreads"].as<std::size_t>();
+        }
     } catch (std::exception& e) {
         std::cerr << "Error processing command line: " << e.what() << std::endl;
         return false;
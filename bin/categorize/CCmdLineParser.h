@@ -8,6 +8,7 @@
 
 #include <core/CoreTypes.h>
 
+#include <cstddef>
 #include <string>
 
 namespace ml {
@@ -45,7 +46,8 @@ public:
                       bool& isRestoreFileNamedPipe,
                       std::string& persistFileName,
                       bool& isPersistFileNamedPipe,
-                      std::string& categorizationFieldName);
+                      std::string& categorizationFieldName,
+                      std::size_t& numberThreads);
 
 private:
     static const std::string DESCRIPTION;
@@ -65,11 +65,13 @@ int main(int argc, char** argv) {
     std::string persistFileName;
     bool isPersistFileNamedPipe(false);
     std::string categorizationFieldName;
+    std::size_t numberThreads(1);
     if (ml::categorize::CCmdLineParser::parse(
             argc, argv, limitConfigFile, jobId, logProperties, logPipe, delimiter,
             lengthEncodedInput, persistInterval, inputFileName, isInputFileNamedPipe,
             outputFileName, isOutputFileNamedPipe, restoreFileName, isRestoreFileNamedPipe,
-            persistFileName, isPersistFileNamedPipe, categorizationFieldName) == false) {
+            persistFileName, isPersistFileNamedPipe, categorizationFieldName,
+            numberThreads) == false) {
         return EXIT_FAILURE;
     }
 
@@ -170,7 +172,7 @@ int main(int argc, char** argv) {
 
     // The typer knows how to assign categories to records
     ml::api::CFieldDataTyper typer(jobId, fieldConfig, limits, nullOutput,
-                                   outputWriter, periodicPersister.get());
+                                   outputWriter, periodicPersister.get(), numberThreads);
 
     if (periodicPersister != nullptr) {
         periodicPersister->firstProcessorPeriodicPersistFunc(boost::bind(
@@ -31,7 +31,8 @@ bool CCmdLineParser::parse(int argc,
                            std::string& quantilesState,
                            bool& deleteStateFiles,
                            bool& writeCsv,
-                           bool& perPartitionNormalization) {
+                           bool& perPartitionNormalization,
+                           std::size_t& numberThreads) {
     try {
         boost::program_options::options_description desc(DESCRIPTION);
         // clang-format off
@@ -62,6 +63,8 @@ bool CCmdLineParser::parse(int argc,
                         "Write the results in CSV format (default is lineified JSON)")
             ("perPartitionNormalization",
                         "Optional flag to enable per partition normalization")
+            ("numberThreads", boost::program_options::value<std::size_t>(),
+                        "Optional number of threads to use to normalize results - defaults to 1")
         ;
         // clang-format on
 
@@ -117,6 +120,9 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("perPartitionNormalization") > 0) {
             perPartitionNormalization = true;
         }
+        if (vm.count("numberThreads") > 0) {
+            numberThreads = vm["numberThreads"].as<std::size_t>();
+        }
     } catch (std::exception& e) {
         std::cerr << "Error processing command line: " << e.what() << std::endl;
         return false;
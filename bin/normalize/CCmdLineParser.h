@@ -8,6 +8,7 @@
 
 #include <core/CoreTypes.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -44,7 +45,8 @@ public:
                       std::string& quantilesState,
                       bool& deleteStateFiles,
                       bool& writeCsv,
-                      bool& perPartitionNormalization);
+                      bool& perPartitionNormalization,
+                      std::size_t& numberThreads);
 
 private:
     static const std::string DESCRIPTION;
@@ -32,6 +32,7 @@
 
 #include <boost/bind.hpp>
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -53,11 +54,12 @@ int main(int argc, char** argv) {
     bool deleteStateFiles(false);
     bool writeCsv(false);
     bool perPartitionNormalization(false);
+    std::size_t numberThreads(1);
     if (ml::normalize::CCmdLineParser::parse(
             argc, argv, modelConfigFile, logProperties, logPipe, bucketSpan,
             lengthEncodedInput, inputFileName, isInputFileNamedPipe,
             outputFileName, isOutputFileNamedPipe, quantilesStateFile,
-            deleteStateFiles, writeCsv, perPartitionNormalization) == false) {
+            deleteStateFiles, writeCsv, perPartitionNormalization, numberThreads) == false) {
         return EXIT_FAILURE;
     }
 
@@ -90,6 +92,8 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
     modelConfig.perPartitionNormalization(perPartitionNormalization);
+    // The lookup tables give identical results to the direct calculation.
+    modelConfig.normalizerLookupTables(true);
 
     // There's a choice of input and output formats for the numbers to be normalised
     using TInputParserUPtr = std::unique_ptr<ml::api::CInputParser>;
@@ -114,7 +118,7 @@ int main(int argc, char** argv) {
     }()};
 
     // This object will do the work
-    ml::api::CResultNormalizer normalizer(modelConfig, *outputWriter);
+    ml::api::CResultNormalizer normalizer(modelConfig, *outputWriter, numberThreads);
 
     // Restore state
     if (!quantilesStateFile.empty()) {
@@ -134,6 +138,12 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    // Normalize any records which are still queued
+    if (normalizer.finalise() == false) {
+        LOG_FATAL(<< "Failed to write normalized output");
+        return EXIT_FAILURE;
+    }
+
     // This message makes it easier to spot process crashes in a log file - if
     // this isn't present in the log for a given PID and there's no other log
     // message indicating early exit then the process has probably core dumped
@@ -6,10 +6,17 @@
 #ifndef INCLUDED_ml_api_CAnomalyJob_h
 #define INCLUDED_ml_api_CAnomalyJob_h
 
+#include <core/CCondition.h>
+#include <core/CFastMutex.h>
 #include <core/CJsonOutputStreamWrapper.h>
+#include <core/CMonotonicArena.h>
+#include <core/CMutex.h>
+#include <core/CStaticThreadPool.h>
 #include <core/CStopWatch.h>
 #include <core/CoreTypes.h>
 
+#include <maths/CPeriodicityTestScheduler.h>
+
 #include <model/CAnomalyDetector.h>
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CBucketQueue.h>
@@ -28,7 +35,10 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <atomic>
 #include <functional>
+#include <iosfwd>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
@@ -44,6 +54,7 @@ namespace ml {
 namespace core {
 class CDataAdder;
 class CDataSearcher;
+class CStatePersistInserter;
 class CStateRestoreTraverser;
 }
 namespace model {
@@ -69,6 +80,24 @@ class CFieldConfig;
 //! handler to be a CJsonOutputWriter rather than a writer for an
 //! arbitrary format
 //!
+//! If more than one thread is requested the detectors' end of bucket
+//! processing, i.e. sampling, computing probabilities and generating model
+//! plot, is spread over a thread pool.  Each detector writes to its own
+//! results object and these are combined in the same order the serial loop
+//! visits the detectors, so the output doesn't depend on the number of
+//! threads.
+//!
+//! Adding records to the detectors is also spread over the pool.  Records
+//! are sharded by a hash of their partition field value, so each detector
+//! belongs to exactly one shard and sees its records in the order they were
+//! received.  The shards are queued and only processed, all together, when
+//! enough records have built up or before anything which needs the
+//! detectors to be up to date, e.g. outputting the results for a bucket.
+//!
+//! State is persisted as JSON unless the job is asked for the compact
+//! binary format.  Each state document is restored in whichever format
+//! it was written, so a job can restore snapshots in either format.
+//!
 class API_EXPORT CAnomalyJob : public CDataProcessor {
 public:
     //! Elasticsearch index for state
@@ -124,8 +153,133 @@ public:
     struct API_EXPORT SRestoredStateDetail {
         ERestoreStateStatus s_RestoredStateStatus;
         boost::optional<std::string> s_Extra;
+        //! The time in milliseconds it took to restore the state.
+        uint64_t s_RestoreTime;
+    };
+
+    //! \brief
+    //! Identifies a snapshot persisted by a job which persists delta
+    //! snapshots and, for a delta, the snapshots it is relative to.
+    //!
+    //! DESCRIPTION:\n
+    //! A delta snapshot contains only the detectors which have been sent
+    //! records since the previous snapshot was taken.  It's restored from
+    //! a stream which contains it followed by each of its predecessors in
+    //! turn, ending with its base, i.e. the last full snapshot.
+    //!
+    //! The detectors left out of a delta have only been sampled since,
+    //! so they're restored from the latest snapshot which contains them
+    //! and then sample the missing buckets, as the job did.  Likewise,
+    //! any people or attributes pruned from them are pruned again.
+    //! Skipping time or resetting buckets changes every detector, so the
+    //! next snapshot is full.
+    struct API_EXPORT SSnapshotManifest {
+        //! Is this the manifest of a delta snapshot?
+        bool isDelta() const;
+
+        //! The ID of this snapshot.
+        std::string s_SnapshotId;
+        //! The ID of the full snapshot a delta is ultimately relative to.
+        std::string s_BaseSnapshotId;
+        //! The ID of the snapshot immediately before a delta.
+        std::string s_PreviousSnapshotId;
+        //! The end of the last bucket the snapshot's detectors sampled.
+        //! This is only read when restoring.
+        core_t::TTime s_LastFinalisedBucketEndTime = 0;
+    };
+
+    using TKeyCRefUInt64Pr = std::pair<model::CSearchKey::TStrCRefKeyCRefPr, uint64_t>;
+    using TKeyCRefUInt64PrVec = std::vector<TKeyCRefUInt64Pr>;
+
+    //! \brief
+    //! The detectors in a snapshot which is persisted in the background.
+    //!
+    //! DESCRIPTION:\n
+    //! The background persist writes the live detectors, so they don't all
+    //! have to be copied when the snapshot is taken.  Instead, the main
+    //! thread calls preserve() before it changes a detector, which copies
+    //! the detector unless it has already been written.  So only detectors
+    //! which change before they're written are copied, and each copy is
+    //! freed as soon as it has been written.
+    //!
+    //! The copies' memory is bounded.  A detector which can't be copied
+    //! without exceeding the bound is instead waited for until it has
+    //! been written.  The detectors are written in order, so preserveAll()
+    //! copies from the back and waits for the front.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! The main thread must preserve a detector before it accesses it in
+    //! any way, not just before it calls non-const methods, because some
+    //! const methods write state which is persisted.  For example, getting
+    //! a model's memory usage updates its memory usage estimator.  So every
+    //! entry point which touches the detectors, including handing them to
+    //! the forecast runner, calls preserveForPersist() or
+    //! preserveAllForPersist() first.  The only exceptions are the const
+    //! description methods, which are used once the job has finalised.
+    struct SPersistDetectors {
+        //! \brief The copy of a detector, if it was changed before it was
+        //! written.
+        struct SCopy {
+            //! Held while the detector is copied or written.
+            core::CMutex s_Mutex;
+            TAnomalyDetectorPtr s_Detector;
+            std::atomic_bool s_Written{false};
+        };
+        using TCopyVec = std::vector<SCopy>;
+        using TSizeVec = std::vector<std::size_t>;
+        using TDetectorCPtrSizeUMap =
+            boost::unordered_map<const model::CAnomalyDetector*, std::size_t>;
+
+        //! \param[in] detectors The detectors in the snapshot.
+        //! \param[in] memoryUsages The memory used by each detector, which
+        //! is what copying it costs.  If empty, copies are free.
+        //! \param[in] maxCopyMemory The most memory the copies may use.
+        explicit SPersistDetectors(const TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                                   const TSizeVec& memoryUsages = TSizeVec(),
+                                   std::size_t maxCopyMemory = std::numeric_limits<std::size_t>::max());
+
+        //! Copy \p detector, or wait for it to be written, if it's in the
+        //! snapshot and hasn't been written.
+        void preserve(const model::CAnomalyDetector& detector);
+
+        //! Copy the \p i'th detector, or wait for it to be written, if it
+        //! hasn't been written.
+        void preserve(std::size_t i);
+
+        //! Copy the \p i'th detector if it hasn't been written and it fits
+        //! within the memory bound.
+        //!
+        //! \return True if the detector has been written or copied.
+        bool tryPreserve(std::size_t i);
+
+        //! Preserve every detector in the snapshot which hasn't been written.
+        void preserveAll();
+
+        //! Write the \p i'th detector's state with \p inserter.
+        void persist(std::size_t i, core::CStatePersistInserter& inserter);
+
+        //! Stop waiting for detectors to be written, because the persist
+        //! has finished, successfully or not.
+        void finish();
+
+        TKeyCRefAnomalyDetectorPtrPrVec s_Detectors;
+        TDetectorCPtrSizeUMap s_Indices;
+        TCopyVec s_Copies;
+        TSizeVec s_MemoryUsages;
+        std::size_t s_MaxCopyMemory;
+        //! The memory used by the copies which haven't been written yet.
+        std::atomic<std::size_t> s_CopyMemory{0};
+        //! The most memory the copies have used at any one time.
+        std::atomic<std::size_t> s_PeakCopyMemory{0};
+        //! Protects waiting for detectors to be written.
+        core::CMutex s_WrittenMutex;
+        core::CCondition s_WrittenCondition{s_WrittenMutex};
+        bool s_Finished = false;
     };
 
+    using TPersistDetectorsPtr = std::shared_ptr<SPersistDetectors>;
+    using TPersistDetectorsWPtr = std::weak_ptr<SPersistDetectors>;
+
     struct SBackgroundPersistArgs {
         SBackgroundPersistArgs(const model::CResultsQueue& resultsQueue,
                                const TModelPlotDataVecQueue& modelPlotQueue,
@@ -143,11 +297,23 @@ public:
         std::string s_NormalizerState;
         core_t::TTime s_LatestRecordTime;
         core_t::TTime s_LastResultsTime;
-        TKeyCRefAnomalyDetectorPtrPrVec s_Detectors;
+        //! The time the snapshot was taken, which identifies it.
+        core_t::TTime s_SnapshotTimestamp;
+        //! Empty unless the job persists delta snapshots.
+        SSnapshotManifest s_Manifest;
+        //! The number of records each detector had been sent when the
+        //! snapshot was taken if the job persists delta snapshots.
+        TKeyCRefUInt64PrVec s_RecordCounts;
+        TPersistDetectorsPtr s_Detectors;
     };
 
     using TBackgroundPersistArgsPtr = std::shared_ptr<SBackgroundPersistArgs>;
 
+    using TStaticThreadPoolUPtr = std::unique_ptr<core::CStaticThreadPool>;
+    using TPeriodicityTestSchedulerUPtr = std::unique_ptr<maths::CPeriodicityTestScheduler>;
+    using TKeyUInt64UMap =
+        boost::unordered_map<model::CSearchKey::TStrKeyPr, uint64_t, model::CStrKeyPrHash, model::CStrKeyPrEqual>;
+
 public:
     CAnomalyJob(const std::string& jobId,
                 model::CLimits& limits,
@@ -159,7 +325,11 @@ public:
                 core_t::TTime maxQuantileInterval = -1,
                 const std::string& timeFieldName = DEFAULT_TIME_FIELD_NAME,
                 const std::string& timeFieldFormat = EMPTY_STRING,
-                size_t maxAnomalyRecords = 0u);
+                size_t maxAnomalyRecords = 0u,
+                std::size_t numberThreads = 1,
+                std::size_t maxDeltaSnapshots = 0,
+                std::size_t periodicityTestSpread = 0,
+                bool binaryState = false);
 
     virtual ~CAnomalyJob();
 
@@ -173,6 +343,27 @@ public:
     //! with any required modifications
     virtual bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Find the positions of the control and time fields in the records
+    //! that will subsequently be passed to handleFieldValues().  The
+    //! positions of the fields each detector needs are resolved lazily.
+    virtual bool handleFieldNames(const TStrVec& fieldNames);
+
+    //! Receive a single record to be processed with field values ordered as
+    //! per the last call to handleFieldNames(), and produce output with any
+    //! required modifications
+    virtual bool handleFieldValues(const TStrVec& fieldValues);
+
+    //! As handleFieldNames(), but also work out which of the fields declared
+    //! to be numeric need to be formatted as strings for the detectors.
+    virtual bool handleTypedFieldNames(const TStrVec& fieldNames,
+                                       const TFieldTypeVec& fieldTypes);
+
+    //! Receive a single record whose numeric fields are passed as numbers.
+    //! A numeric time field is used without parsing, and numeric metric
+    //! values and summary counts are passed straight to the detectors.
+    virtual bool handleTypedFieldValues(const TStrVec& stringValues,
+                                        const TDoubleVec& numericValues);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise();
 
@@ -206,6 +397,57 @@ private:
     //! NULL pointer that we can take a long-lived const reference to
     static const TAnomalyDetectorPtr NULL_DETECTOR;
 
+private:
+    using TSizeVec = std::vector<std::size_t>;
+
+    //! \brief The positions in records passed to handleFieldValues() of the
+    //! fields needed by the detectors for one detector key.
+    struct SDetectorFieldIndices {
+        //! Have the fields of interest been resolved?
+        bool s_Resolved;
+
+        //! The position of the partition field.
+        std::size_t s_PartitionField;
+
+        //! The positions of the detectors' fields of interest.
+        TSizeVec s_FieldsOfInterest;
+    };
+
+    using TDetectorFieldIndicesVec = std::vector<SDetectorFieldIndices>;
+
+    using TDetectorPtrTimePr = std::pair<model::CAnomalyDetector*, core_t::TTime>;
+    using TDetectorPtrTimePrVec = std::vector<TDetectorPtrTimePr>;
+    using TBoolVec = std::vector<bool>;
+    using TDoubleCPtrVec = model::CAnomalyDetector::TDoubleCPtrVec;
+
+    //! \brief The records waiting to be added to the detectors owned by
+    //! one ingest shard.
+    struct SPendingRecords {
+        //! The detector to add each record to and the record's time, in
+        //! the order the records were received.
+        TDetectorPtrTimePrVec s_Records;
+
+        //! The values of each record's fields of interest, concatenated.
+        //! The strings are reused between batches to avoid reallocating.
+        TStrVec s_FieldValues;
+
+        //! Is the corresponding entry in s_FieldValues missing from its
+        //! record?
+        TBoolVec s_Missing;
+
+        //! The numbers supplied for fields of interest, indexed in the same
+        //! way as s_FieldValues.  Only meaningful where s_Numeric is set.
+        TDoubleVec s_NumericValues;
+
+        //! Was the corresponding entry in s_NumericValues supplied?
+        TBoolVec s_Numeric;
+
+        //! The number of entries of s_FieldValues currently in use.
+        std::size_t s_NumberFieldValues;
+    };
+
+    using TPendingRecordsVec = std::vector<SPendingRecords>;
+
 private:
     //! Handle a control message.  The first character of the control
     //! message indicates its type.  Currently defined types are:
@@ -222,6 +464,29 @@ private:
     //! Write out interim results for the bucket starting at \p bucketStartTime.
     void outputInterimResults(core_t::TTime bucketStartTime);
 
+    //! Run the periodicity tests which are due at the end of a bucket.
+    void runPeriodicityTests();
+
+    //! Record the results arena's allocations and account for its memory.
+    void accountResultsArena();
+
+    //! Can work on the detectors currently be spread over the thread pool?
+    //!
+    //! \param[in] extraMemory An upper bound on the extra memory the work
+    //! can reserve for new people and attributes.
+    bool canUseThreadPool(std::size_t extraMemory = 0);
+
+    //! Can \p detectors sample the current bucket spread over the thread
+    //! pool with the same results as sampling them one at a time?
+    bool canBuildResultsInParallel(const TAnomalyDetectorPtrVec& detectors);
+
+    //! Sample \p detectors, add their results for the bucket starting at
+    //! \p bucketStartTime to \p results and generate their model plot,
+    //! spreading the detectors over the thread pool.
+    void buildResultsInParallel(core_t::TTime bucketStartTime,
+                                const TAnomalyDetectorPtrVec& detectors,
+                                model::CHierarchicalResults& results);
+
     //! Helper function for outputResults.
     //! \p processingTimer is the processing time can be written to the bucket
     //! \p sumPastProcessingTime is the total time previously spent processing
@@ -235,13 +500,61 @@ private:
     //! Reset buckets in the range specified by the control message.
     void resetBuckets(const std::string& controlMessage);
 
-    //! Attempt to restore the detectors
+    //! Attempt to restore the next snapshot in \p restoreSearcher, reading
+    //! its manifest into \p manifest.  If \p isPredecessor is true then
+    //! a later delta snapshot has already been restored, so only the
+    //! detectors which it didn't contain are restored.
+    bool restoreSnapshot(core::CDataSearcher& restoreSearcher,
+                         bool isPredecessor,
+                         core_t::TTime& completeToTime,
+                         std::size_t& numDetectors,
+                         SSnapshotManifest& manifest);
+
+    //! Attempt to restore the state from the first document of a snapshot.
+    //! \p numberDetectorDocuments is set to the number of documents which
+    //! follow it, one for each detector.
     bool restoreState(core::CStateRestoreTraverser& traverser,
+                      bool isPredecessor,
                       core_t::TTime& completeToTime,
-                      std::size_t& numDetectors);
+                      std::size_t& numDetectors,
+                      SSnapshotManifest& manifest,
+                      std::size_t& numberDetectorDocuments);
+
+    //! Restore \p numberDocuments detector documents from \p strm.  If
+    //! the job has a thread pool the documents are read in batches, JSON
+    //! ones a line at a time, and each batch is restored in parallel.
+    bool restoreDetectorDocuments(std::istream& strm,
+                                  bool isPredecessor,
+                                  std::size_t numberDocuments,
+                                  std::size_t& numDetectors);
 
     //! Attempt to restore one detector from an already-created traverser.
-    bool restoreSingleDetector(core::CStateRestoreTraverser& traverser);
+    //! If \p isPredecessor is true the detector is skipped if it has
+    //! already been restored.
+    bool restoreSingleDetector(bool isPredecessor, core::CStateRestoreTraverser& traverser);
+
+    //! As restoreSingleDetector but safe to call concurrently for different
+    //! detectors.  The simple count detector isn't restored, because it
+    //! restores global state, but \p isSimpleCount is set instead.
+    bool restoreSingleDetectorConcurrently(bool isPredecessor,
+                                           bool& isSimpleCount,
+                                           core::CStateRestoreTraverser& traverser);
+
+    //! Has the detector identified by \p key and \p partitionFieldValue
+    //! been created?
+    bool hasDetector(const model::CSearchKey& key, const std::string& partitionFieldValue) const;
+
+    //! Read the key and partition field value of a detector from
+    //! \p traverser, leaving it positioned at the detector's state.
+    bool restoreDetectorKey(core::CStateRestoreTraverser& traverser,
+                            model::CSearchKey& key,
+                            std::string& partitionFieldValue);
+
+    //! Get the detector identified by \p key and \p partitionFieldValue
+    //! to restore into, creating it if necessary.  Returns NULL if it
+    //! couldn't be created.
+    const TAnomalyDetectorPtr& detectorForRestore(const model::CSearchKey& key,
+                                                  const std::string& partitionFieldValue);
 
     //! Restore the detector identified by \p key and \p partitionFieldValue
     //! from \p traverser.
@@ -256,12 +569,47 @@ private:
     //! main processing when background persistence is triggered.
     bool runBackgroundPersist(TBackgroundPersistArgsPtr args, core::CDataAdder& persister);
 
-    //! Persist the detectors to a stream.
+    //! Remove the detectors which haven't been sent records since the last
+    //! snapshot persisted from \p detectors if the next snapshot should be
+    //! a delta, and fill in its \p manifest and the \p recordCounts of all
+    //! the detectors.  \p snapshotTimestamp is advanced if necessary so
+    //! that it's later than the last snapshot's.  Returns true if the
+    //! snapshot is a delta.
+    bool selectDeltaDetectors(core_t::TTime& snapshotTimestamp,
+                              TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                              SSnapshotManifest& manifest,
+                              TKeyCRefUInt64PrVec& recordCounts);
+
+    //! Record that the snapshot with \p manifest, taken when the detectors
+    //! had been sent \p recordCounts records, has been persisted, so later
+    //! delta snapshots are relative to it.
+    void snapshotPersisted(const SSnapshotManifest& manifest,
+                           const TKeyCRefUInt64PrVec& recordCounts);
+
+    //! Make the next background snapshot a full one, because the detectors
+    //! have changed other than by being sent records.
+    void forceFullSnapshot();
+
+    //! Copy \p detector, if it's in a snapshot being persisted in the
+    //! background which hasn't written it yet, so it can be accessed.
+    void preserveForPersist(const model::CAnomalyDetector& detector);
+
+    //! Copy every detector in a snapshot being persisted in the background
+    //! which hasn't been written yet, so they can all be accessed.
+    void preserveAllForPersist();
+
+    //! Persist the detectors to a stream.  The state of everything other
+    //! than the detectors is written as one document, followed by each
+    //! detector as a separate document.  Each document is compressed on its
+    //! own, so if the job has a thread pool they're written in parallel.
+    //! \p manifest is written with the state unless it's empty.
     bool persistState(const std::string& descriptionPrefix,
+                      core_t::TTime snapshotTimestamp,
+                      const SSnapshotManifest& manifest,
                       const model::CResultsQueue& resultsQueue,
                       const TModelPlotDataVecQueue& modelPlotQueue,
                       core_t::TTime time,
-                      const TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                      SPersistDetectors& detectors,
                       const model::CResourceMonitor::SResults& modelSizeStats,
                       const model::CHierarchicalResultsAggregator& aggregator,
                       const std::string& normalizerState,
@@ -373,8 +721,53 @@ private:
     //! and add the new record to \p detector
     void addRecord(const TAnomalyDetectorPtr detector,
                    core_t::TTime time,
+                   const std::string& partitionFieldValue,
                    const TStrStrUMap& dataRowFields);
 
+    //! Extract the fields at \p fieldIndices from \p fieldValues, or from
+    //! \p numericValues for fields of numeric type, and add the new record
+    //! to \p detector
+    void addRecord(const TAnomalyDetectorPtr detector,
+                   core_t::TTime time,
+                   const std::string& partitionFieldValue,
+                   const TSizeVec& fieldIndices,
+                   const TStrVec& fieldValues,
+                   const TDoubleVec& numericValues);
+
+    //! Add the record with fields of interest \p fieldValues and, if not
+    //! empty, \p numericValues to \p detector, either immediately or by
+    //! queuing it on the shard which owns the detector's partition.
+    void addRecord(model::CAnomalyDetector& detector,
+                   core_t::TTime time,
+                   const std::string& partitionFieldValue,
+                   const model::CAnomalyDetector::TStrCPtrVec& fieldValues,
+                   const TDoubleCPtrVec& numericValues);
+
+    //! Add all the queued records to their detectors, processing the
+    //! shards in parallel.
+    void addPendingRecords();
+
+    //! Parse \p timeValue, the value of the time field of a record, into
+    //! \p time, checking it is not before the last finalised bucket.  The
+    //! record is only described by \p printRecord if there's an error.
+    template<typename PRINT_RECORD>
+    bool parseRecordTime(const std::string& timeValue,
+                         const PRINT_RECORD& printRecord,
+                         core_t::TTime& time);
+
+    //! Check \p time, the time of a record, is not before the last
+    //! finalised bucket.
+    template<typename PRINT_RECORD>
+    bool checkRecordTime(core_t::TTime time, const PRINT_RECORD& printRecord);
+
+    //! Get the string value of the field at \p index of the current record,
+    //! which for a numeric field is only available if it was formatted by
+    //! handleTypedFieldValues().
+    const std::string& stringValue(std::size_t index, const TStrVec& fieldValues) const;
+
+    //! Update counts and times after a record at \p time has been handled.
+    void recordHandled(core_t::TTime time);
+
 protected:
     //! Get all the detectors.
     void detectors(TAnomalyDetectorPtrVec& detectors) const;
@@ -423,6 +816,34 @@ private:
     //! Detector keys.
     TKeyVec m_DetectorKeys;
 
+    //! The field names of records passed to handleFieldValues()
+    TStrVec m_FieldNames;
+
+    //! The position of the control field in records passed to
+    //! handleFieldValues(), or m_FieldNames.size() if there isn't one
+    std::size_t m_ControlFieldIndex;
+
+    //! The position of the time field in records passed to
+    //! handleFieldValues(), or m_FieldNames.size() if there isn't one
+    std::size_t m_TimeFieldIndex;
+
+    //! The types of the fields in m_FieldNames.  All strings unless they
+    //! were passed to handleTypedFieldNames().
+    TFieldTypeVec m_FieldTypes;
+
+    //! Do any of the fields in m_FieldTypes have to be formatted as strings
+    //! for every record because they're used other than as a number?
+    TBoolVec m_FormatNumericFields;
+
+    //! The string values of the numeric fields flagged in
+    //! m_FormatNumericFields for the current record.
+    TStrVec m_NumericFieldStrings;
+
+    //! The positions of the fields each detector key needs in records passed
+    //! to handleFieldValues().  This is indexed in the same way as
+    //! m_DetectorKeys.
+    TDetectorFieldIndicesVec m_DetectorFieldIndices;
+
     //! Map of objects to provide the inner workings
     TKeyAnomalyDetectorPtrUMap m_Detectors;
 
@@ -478,11 +899,71 @@ private:
     //! to choose the best result
     model::CResultsQueue m_ResultsQueue;
 
+    //! The arena used for the transient containers created when building
+    //! and writing out a bucket's results. This is reset after each bucket.
+    core::CMonotonicArena m_ResultsArena;
+
     //! Also store the model plot for the buckets for each
     //! result time - these will be output when the corresponding
     //! result is output
     TModelPlotDataVecQueue m_ModelPlotQueue;
 
+    //! Threads used to add records to the detectors and to process the
+    //! detectors at the end of each bucket.  This is null if the job is
+    //! single threaded.
+    TStaticThreadPoolUPtr m_ThreadPool;
+
+    //! The records queued for each ingest shard.  There is one shard for
+    //! each thread which can work on them.
+    TPendingRecordsVec m_PendingRecords;
+
+    //! The total number of records queued over all the shards.
+    std::size_t m_NumberPendingRecords;
+
+    //! The maximum number of delta snapshots to persist in the background
+    //! between full snapshots.  Zero means every snapshot is full.
+    std::size_t m_MaxDeltaSnapshots;
+
+    //! True if state is persisted in the compact binary format rather
+    //! than as JSON.
+    bool m_BinaryState;
+
+    //! The time of the last background snapshot taken.
+    core_t::TTime m_LastSnapshotTimestamp;
+
+    //! The number of delta snapshots persisted since the last full one.
+    std::size_t m_NumberDeltaSnapshots;
+
+    //! The manifest of the last background snapshot persisted, which the
+    //! next delta snapshot is relative to.
+    SSnapshotManifest m_LastSnapshotManifest;
+
+    //! The number of records the detectors had been sent when the last
+    //! background snapshot persisted was taken.
+    TKeyUInt64UMap m_SnapshotRecordCounts;
+
+    //! Must the next background snapshot be a full one?
+    bool m_ForceFullSnapshot;
+
+    //! Protects the state of the last background snapshot persisted,
+    //! which is updated by the background persistence thread.  It's only
+    //! updated if the snapshot is persisted successfully, so a snapshot
+    //! which fails, or is never persisted, isn't a predecessor of a delta.
+    core::CFastMutex m_SnapshotMutex;
+
+    //! The detectors of the snapshot being persisted in the background, if
+    //! any, which must be preserved before they're changed.
+    TPersistDetectorsWPtr m_PersistingDetectors;
+
+    //! Serialises creating detectors, and recording failures, while the
+    //! detectors are restored concurrently.
+    core::CFastMutex m_RestoreMutex;
+
+    //! Runs the models' periodicity tests at the end of each bucket,
+    //! spread over several buckets.  This is null if the models run
+    //! their tests as soon as they're due.
+    TPeriodicityTestSchedulerUPtr m_PeriodicityTestScheduler;
+
     friend class ::CBackgroundPersisterTest;
     friend class ::CAnomalyJobTest;
 };
@@ -14,7 +14,6 @@
 #include <api/ImportExport.h>
 
 #include <iosfwd>
-#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -45,6 +44,17 @@ class CTokenListReverseSearchCreatorIntf;
 //! a match.  (This means that a threshold of 1 implies all messages are
 //! different, even if they're identical!)
 //!
+//! Candidate types for a string are found using an inverted index from
+//! token ID to the types whose base tokens contain that token.  Only the
+//! types containing one of the string's rarest tokens need be considered,
+//! since a type must have enough token weight in common with the string
+//! to exceed the threshold.  Types which could match the reverse search
+//! are tracked separately, by the first of their common unique tokens.
+//! The candidates are then checked in the same order as a full scan of
+//! the types would check them, skipping those whose similarity is bounded
+//! below the best match so far, so the results are identical to those of
+//! a full scan.
+//!
 //! This class is not thread safe.  For efficiency, each instance should
 //! only be used within a single thread.  Any multi-threaded access must
 //! be serialised with an external lock.
@@ -108,9 +118,22 @@ public:
     virtual int
     computeType(bool dryRun, const TStrStrUMap& fields, const std::string& str, size_t rawStringLen);
 
+    //! Compute a type from tokens previously obtained by calling
+    //! tokenise() for \p str.
+    virtual int computeType(bool isDryRun,
+                            const TStrSizePrVec& tokens,
+                            const std::string& str,
+                            size_t rawStringLen);
+
     // Bring the other overload of computeType() into scope
     using CDataTyper::computeType;
 
+    //! Split a string into weighted tokens without assigning token IDs.
+    //! This is safe to call concurrently with any other method.
+    virtual bool tokenise(const TStrStrUMap& fields,
+                          const std::string& str,
+                          TStrSizePrVec& tokens) const;
+
     //! Create a search that will (more or less) just select the records
     //! that are classified as the given type.  Note that the reverse search
     //! is only approximate - it may select more records than have actually
@@ -143,6 +166,16 @@ protected:
                                 TSizeSizeMap& tokenUniqueIds,
                                 size_t& totalWeight) = 0;
 
+    //! As above, but return the tokens and their weights in \p tokens
+    //! rather than assigning them IDs, so that this can be called
+    //! concurrently with any other method.
+    virtual void tokeniseString(const TStrStrUMap& fields,
+                                const std::string& str,
+                                TStrSizePrVec& tokens) const = 0;
+
+    //! Get the weighting of a string token.
+    virtual size_t tokenWeight(const std::string& token) const = 0;
+
     //! Take a string token, convert it to a numeric ID and a weighting and
     //! add these to the provided data structures.
     virtual void tokenToIdAndWeight(const std::string& token,
@@ -150,26 +183,25 @@ protected:
                                     TSizeSizeMap& tokenUniqueIds,
                                     size_t& totalWeight) = 0;
 
-    //! Compute similarity between two vectors
+    //! Compute similarity between two vectors.  This must not exceed the
+    //! weight of the tokens the vectors have in common divided by the larger
+    //! of their weights, or the candidate search will miss matches.  If the
+    //! similarity is less than \p minSimilarity then the calculation may
+    //! stop early and return any value less than \p minSimilarity.
     virtual double similarity(const TSizeSizePrVec& left,
                               size_t leftWeight,
                               const TSizeSizePrVec& right,
-                              size_t rightWeight) const = 0;
-
-    //! Used to hold statistics about the types we compute:
-    //! first -> count of matches
-    //! second -> type vector index
-    using TSizeSizePrList = std::list<TSizeSizePr>;
-    using TSizeSizePrListItr = TSizeSizePrList::iterator;
+                              size_t rightWeight,
+                              double minSimilarity) const = 0;
 
-    //! Add a match to an existing type
+    //! Add a match to the type at \p position in the types by count
     void addTypeMatch(bool isDryRun,
                       const std::string& str,
                       size_t rawStringLen,
                       const TSizeSizePrVec& tokenIds,
                       const TSizeSizeMap& tokenUniqueIds,
                       double similarity,
-                      TSizeSizePrListItr& iter);
+                      size_t position);
 
     //! Given the total token weight in a vector and a threshold, what is
     //! the minimum possible token weight in a different vector that could
@@ -239,6 +271,9 @@ private:
         boost::multi_index::indexed_by<boost::multi_index::random_access<>,
                                        boost::multi_index::hashed_unique<boost::multi_index::tag<SToken>, BOOST_MULTI_INDEX_CONST_TYPE_CONST_MEM_FUN(CTokenInfoItem, std::string, str)>>>;
 
+    using TSizeVec = std::vector<size_t>;
+    using TSizeVecVec = std::vector<TSizeVec>;
+
 private:
     //! Used by deferred persistence functions
     static void acceptPersistInserter(const TTokenMIndex& tokenIdLookup,
@@ -255,6 +290,28 @@ private:
                                TSizeSizeMap& tokenUniqueIds,
                                size_t& totalWeight);
 
+    //! Compute the type of \p str whose tokens, of total weight
+    //! \p workWeight, are in the working token containers.
+    int computeTypeOfWorkTokens(bool isDryRun,
+                                const std::string& str,
+                                size_t rawStringLen,
+                                size_t workWeight);
+
+    //! Fill in m_WorkCandidates with the positions in the types by count of
+    //! the types which could match the current working tokens.
+    void findCandidates(size_t workWeight);
+
+    //! Add the type at index \p type to the inverted indices.
+    void indexType(size_t type);
+
+    //! Add the type at index \p type to the index of types by the first of
+    //! their common unique tokens.
+    void indexFirstCommonToken(size_t type);
+
+    //! Remove the type at index \p type from the index of types by the
+    //! first of their common unique tokens, where this was \p tokenId.
+    void unindexFirstCommonToken(size_t type, size_t tokenId);
+
 private:
     //! Reference to the object we'll use to create reverse searches
     const TTokenListReverseSearchCreatorIntfCPtr m_ReverseSearchCreator;
@@ -273,9 +330,20 @@ private:
     //! The types
     TTokenListTypeVec m_Types;
 
-    //! List of match count/index into type vector in descending order of
-    //! match count
-    TSizeSizePrList m_TypesByCount;
+    //! Match count/index into type vector in descending order of match count
+    TSizeSizePrVec m_TypesByCount;
+
+    //! The position of each type in m_TypesByCount
+    TSizeVec m_TypePositions;
+
+    //! The types whose base tokens contain each token ID
+    TSizeVecVec m_TypesByToken;
+
+    //! The types indexed by the first of their common unique token IDs
+    TSizeVecVec m_TypesByFirstCommonToken;
+
+    //! The types which have no common unique tokens
+    TSizeVec m_TypesWithoutCommonTokens;
 
     //! Used for looking up tokens to a unique ID
     TTokenMIndex m_TokenIdLookup;
@@ -288,6 +356,14 @@ private:
     //! repeated reallocations for different strings.
     TSizeSizeMap m_WorkTokenUniqueIds;
 
+    //! Vector to use to order the unique token IDs by rarity.  This is a
+    //! member to save repeated reallocations for different strings.
+    TSizeSizePrVec m_WorkTokenRarities;
+
+    //! Vector to use to build up candidate type positions.  This is a
+    //! member to save repeated reallocations for different strings.
+    TSizeVec m_WorkCandidates;
+
     //! Used to parse pre-tokenised input supplied as CSV.
     CCsvInputParser::CCsvLineParser m_CsvLineParser;
 
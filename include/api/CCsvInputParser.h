@@ -146,7 +146,18 @@ public:
     //! the end of the stream it returns true, otherwise it returns false.
     virtual bool readStream(const TReaderFunc& readerFunc);
 
+    //! Read records from the stream, passing the field values positionally.
+    //! The field names function is called once, after the header has been
+    //! parsed, and the same vector of field values is then refilled for
+    //! every record.
+    virtual bool readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                    const TVecReaderFunc& readerFunc);
+
 private:
+    //! Prepare to read a new stream, parsing the field names if they haven't
+    //! already been obtained.
+    bool startStream();
+
     //! Attempt to parse a single CSV record from the stream into the
     //! working record.  The CSV is assumed to be in the Excel style.
     bool parseCsvRecordFromStream();
@@ -154,8 +165,11 @@ private:
     //! Attempt to parse the field names from the working record.
     bool parseFieldNames();
 
-    //! Attempt to parse the current working record into data fields.
-    bool parseDataRecord(const TStrRefVec& fieldValRefs);
+    //! Attempt to parse the current working record into data fields.  The
+    //! vector is a template argument so that it may be a vector of
+    //! boost::reference_wrappers of std::strings instead of std::strings.
+    template<typename STR_VEC>
+    bool parseDataRecord(STR_VEC& fieldValues);
 
     //! Wrapper around std::getline() that removes carriage returns
     //! preceding the linefeed that breaks the line.  This means that we
@@ -9,8 +9,10 @@
 #include <core/CNonCopyable.h>
 #include <core/CoreTypes.h>
 
+#include <api/CInputParser.h>
 #include <api/ImportExport.h>
 
+#include <boost/ref.hpp>
 #include <boost/unordered_map.hpp>
 
 #include <string>
@@ -52,6 +54,9 @@ public:
     using TStrStrUMapItr = TStrStrUMap::iterator;
     using TStrStrUMapCItr = TStrStrUMap::const_iterator;
 
+    using TFieldTypeVec = CInputParser::TFieldTypeVec;
+    using TDoubleVec = CInputParser::TDoubleVec;
+
 public:
     CDataProcessor();
     virtual ~CDataProcessor();
@@ -63,6 +68,34 @@ public:
     //! with any required modifications
     virtual bool handleRecord(const TStrStrUMap& dataRowFields) = 0;
 
+    //! Receive the names of the fields in the records that will subsequently
+    //! be passed to handleFieldValues().  The default implementation sets up
+    //! a map to adapt positional records to handleRecord().
+    virtual bool handleFieldNames(const TStrVec& fieldNames);
+
+    //! Receive a single record to be processed as a vector of values whose
+    //! order corresponds to the field names most recently passed to
+    //! handleFieldNames().  The default implementation copies the values
+    //! into a map and calls handleRecord(); derived classes that can resolve
+    //! the positions of the fields they need in handleFieldNames() should
+    //! override this to avoid the cost of building and searching the map.
+    virtual bool handleFieldValues(const TStrVec& fieldValues);
+
+    //! Receive the names and types of the fields in the records that will
+    //! subsequently be passed to handleTypedFieldValues().  The default
+    //! implementation remembers the types and calls handleFieldNames().
+    virtual bool handleTypedFieldNames(const TStrVec& fieldNames,
+                                       const TFieldTypeVec& fieldTypes);
+
+    //! Receive a single record to be processed whose numeric fields, as
+    //! declared in the last call to handleTypedFieldNames(), are passed in
+    //! \p numericValues rather than as strings.  The default implementation
+    //! formats the numeric values as strings and calls handleFieldValues();
+    //! derived classes that can use the numbers directly should override
+    //! this to avoid converting them to strings and back.
+    virtual bool handleTypedFieldValues(const TStrVec& stringValues,
+                                        const TDoubleVec& numericValues);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise() = 0;
 
@@ -85,6 +118,33 @@ public:
     //! Create debug for a record.  This is expensive so should NOT be
     //! called for every record as a matter of course.
     static std::string debugPrintRecord(const TStrStrUMap& dataRowFields);
+
+    //! Create debug for a record supplied positionally.  This is expensive
+    //! so should NOT be called for every record as a matter of course.
+    static std::string debugPrintRecord(const TStrVec& fieldNames, const TStrVec& fieldValues);
+
+private:
+    using TStrRef = boost::reference_wrapper<std::string>;
+    using TStrRefVec = std::vector<TStrRef>;
+
+private:
+    //! Map used by the default implementation of handleFieldValues() to
+    //! adapt positional records to handleRecord().
+    TStrStrUMap m_WorkRecordFields;
+
+    //! References to the values in m_WorkRecordFields in the order of the
+    //! field names passed to handleFieldNames().
+    TStrRefVec m_WorkRecordFieldRefs;
+
+    //! The field types passed to handleTypedFieldNames().
+    TFieldTypeVec m_FieldTypes;
+
+    //! Are any of m_FieldTypes numeric?
+    bool m_HaveNumericFields;
+
+    //! Used by the default implementation of handleTypedFieldValues() to
+    //! hold the record with its numeric values formatted as strings.
+    TStrVec m_WorkFieldValues;
 };
 }
 }
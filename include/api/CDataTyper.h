@@ -15,6 +15,8 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace ml {
 namespace core {
@@ -48,6 +50,10 @@ public:
     //! Shared pointer to an instance of this class
     using TPersistFunc = std::function<void(core::CStatePersistInserter&)>;
 
+    //! Used for storing tokens and their weights
+    using TStrSizePr = std::pair<std::string, std::size_t>;
+    using TStrSizePrVec = std::vector<TStrSizePr>;
+
 public:
     CDataTyper(const std::string& fieldName);
 
@@ -68,6 +74,22 @@ public:
                             const std::string& str,
                             size_t rawStringLen) = 0;
 
+    //! Split a string into weighted tokens.  This is the part of computing
+    //! a type which doesn't depend on the types seen so far, so it doesn't
+    //! change the state of the typer and can be called concurrently with
+    //! any other method.  Returns false if the string can't be tokenised.
+    virtual bool tokenise(const TStrStrUMap& fields,
+                          const std::string& str,
+                          TStrSizePrVec& tokens) const = 0;
+
+    //! Compute a type from the tokens \p tokens which were obtained by
+    //! calling tokenise() for \p str.  This gives the same type as calling
+    //! computeType() for \p str.
+    virtual int computeType(bool isDryRun,
+                            const TStrSizePrVec& tokens,
+                            const std::string& str,
+                            size_t rawStringLen) = 0;
+
     //! Create reverse search commands that will (more or less) just
     //! select the records that are classified as the given type when
     //! combined with the original search.  Note that the reverse search is
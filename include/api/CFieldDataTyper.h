@@ -7,6 +7,7 @@
 #define INCLUDED_ml_api_CFieldDataTyper_h
 
 #include <core/CRegexFilter.h>
+#include <core/CStaticThreadPool.h>
 #include <core/CWordDictionary.h>
 #include <core/CoreTypes.h>
 
@@ -16,7 +17,12 @@
 #include <api/CTokenListDataTyper.h>
 #include <api/ImportExport.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <stdint.h>
 
@@ -43,6 +49,23 @@ class COutputHandler;
 //! Adds a new field called mlcategory and assigns to it
 //! integers that correspond to the various cateogories
 //!
+//! If more than one thread is requested records are categorized in a
+//! pipeline.  Records are queued in batches and a pool of threads splits
+//! each batch's categorization field values into tokens, which doesn't
+//! depend on the categories seen so far.  Meanwhile the calling thread
+//! assigns categories to the previous batch's records in the order they
+//! were received, and outputs them.  Token IDs and category numbers are
+//! only assigned by the calling thread, so the output doesn't depend on
+//! the number of threads.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Queued records are categorized before field names change, before any
+//! control message is handled and at finalise, so the output is in the
+//! same order as the input and flush acknowledgements are only written
+//! once the records before them have been output.  As a result the
+//! number of records handled lags the number of records received by up
+//! to two batches between these points.
+//!
 class API_EXPORT CFieldDataTyper : public CDataProcessor {
 public:
     //! The index where state is stored
@@ -80,7 +103,8 @@ public:
                     const model::CLimits& limits,
                     COutputHandler& outputHandler,
                     CJsonOutputWriter& jsonOutputWriter,
-                    CBackgroundPersister* periodicPersister = nullptr);
+                    CBackgroundPersister* periodicPersister = nullptr,
+                    std::size_t numberThreads = 1);
 
     virtual ~CFieldDataTyper();
 
@@ -91,6 +115,15 @@ public:
     //! STDOUT with its type field added
     virtual bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Find the positions of the control and categorization fields in the
+    //! records that will subsequently be passed to handleFieldValues()
+    virtual bool handleFieldNames(const TStrVec& fieldNames);
+
+    //! Receive a single record to be typed with field values ordered as per
+    //! the last call to handleFieldNames(), and output that record with its
+    //! type field added
+    virtual bool handleFieldValues(const TStrVec& fieldValues);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise();
 
@@ -110,6 +143,56 @@ public:
     //! Access the output handler
     virtual COutputHandler& outputHandler();
 
+private:
+    using TStaticThreadPoolUPtr = std::unique_ptr<core::CStaticThreadPool>;
+
+    //! \brief A record waiting to be categorized.
+    struct SPendingRecord {
+        //! True if the record was supplied positionally.
+        bool s_Positional;
+
+        //! The record's field values if it was supplied positionally.
+        TStrVec s_FieldValues;
+
+        //! The record's fields if it was supplied by name, or the fields
+        //! the typer needs if it was supplied positionally.
+        TStrStrUMap s_DataRowFields;
+
+        //! The value of the record's categorization field.  This is empty
+        //! if the record will be assigned type -1 without being typed.
+        std::string s_Value;
+
+        //! The value of the record's categorization field after applying
+        //! the categorization filter, if there is one.
+        std::string s_FilteredValue;
+
+        //! Was the record successfully split into tokens?
+        bool s_Tokenised;
+
+        //! The tokens of the categorization field value.
+        CDataTyper::TStrSizePrVec s_Tokens;
+    };
+
+    using TPendingRecordVec = std::vector<SPendingRecord>;
+
+    //! \brief A batch of records waiting to be categorized.
+    struct SPendingBatch {
+        SPendingBatch();
+
+        //! The records.  These are reused between batches to avoid
+        //! reallocating.
+        TPendingRecordVec s_Records;
+
+        //! The number of entries of s_Records currently in use.
+        std::size_t s_Size;
+
+        //! The index of the next record to tokenise.
+        std::atomic_size_t s_NextToTokenise;
+
+        //! The number of tasks tokenising the batch which haven't finished.
+        std::size_t s_TokenisingTasks;
+    };
+
 private:
     //! Create the typer to operate on the categorization field
     void createTyper(const std::string& fieldName);
@@ -117,6 +200,55 @@ private:
     //! Compute the type for a given record.
     int computeType(const TStrStrUMap& dataRowFields);
 
+    //! Compute the type for a given record supplied positionally.
+    int computeType(const TStrVec& fieldValues);
+
+    //! Get the fields of a record supplied positionally which the typer
+    //! needs, i.e. just the pretokenised tokens if it has them.
+    void typerFields(const TStrVec& fieldValues, TStrStrUMap& fields) const;
+
+    //! Compute the type for the non-empty value \p fieldValue of the
+    //! categorization field of a record with fields \p dataRowFields.
+    int computeType(const TStrStrUMap& dataRowFields, const std::string& fieldValue);
+
+    //! Get the value of the categorization field of a record, or null
+    //! with a warning if it is missing or blank.
+    const std::string* categorizationFieldValue(const TStrStrUMap& dataRowFields) const;
+
+    //! Get the value of the categorization field of a record supplied
+    //! positionally, or null with a warning if it is missing or blank.
+    const std::string* categorizationFieldValue(const TStrVec& fieldValues) const;
+
+    //! Update the examples and the reverse search for the type \p type
+    //! assigned to a record whose categorization field value is
+    //! \p fieldValue.  Returns the type to output.
+    int recordType(int type, const std::string& fieldValue);
+
+    //! Get the next free record of the batch being filled.
+    SPendingRecord& nextPendingRecord();
+
+    //! Note that the next free record of the batch being filled was used
+    //! and start processing the batch if it is full.
+    bool queuedRecord();
+
+    //! Categorize and output all the queued records.
+    bool categorizePendingRecords();
+
+    //! Start splitting the records of \p batch into tokens on the thread
+    //! pool.
+    void startTokenising(SPendingBatch& batch);
+
+    //! Help split the records of \p batch into tokens and wait until they
+    //! have all been processed.
+    void waitForTokenising(SPendingBatch& batch);
+
+    //! Split the categorization field value of \p record into tokens.
+    void tokenise(SPendingRecord& record) const;
+
+    //! Wait for \p batch to be split into tokens then assign categories to
+    //! its records and output them in order.
+    bool categorize(SPendingBatch& batch);
+
     //! Create the reverse search and return true if it has changed or false otherwise
     bool createReverseSearch(int type);
 
@@ -159,6 +291,25 @@ private:
     //! Should we write the field names before the next output?
     bool m_WriteFieldNames;
 
+    //! The field names of records passed to handleFieldValues()
+    TStrVec m_FieldNames;
+
+    //! The position of the control field in records passed to
+    //! handleFieldValues(), or m_FieldNames.size() if there isn't one
+    std::size_t m_ControlFieldIndex;
+
+    //! The position of the categorization field in records passed to
+    //! handleFieldValues(), or m_FieldNames.size() if there isn't one
+    std::size_t m_CategorizationFieldIndex;
+
+    //! The position of the pretokenised tokens field in records passed to
+    //! handleFieldValues(), or m_FieldNames.size() if there isn't one
+    std::size_t m_PretokenisedFieldIndex;
+
+    //! The fields the typer needs of the last record passed to
+    //! handleFieldValues().  This is a member so its storage is reused.
+    TStrStrUMap m_TyperFields;
+
     //! Keep count of how many records we've handled
     uint64_t m_NumRecordsHandled;
 
@@ -197,6 +348,24 @@ private:
     //! nullptr if this object is not responsible for starting periodic
     //! persistence.
     CBackgroundPersister* m_PeriodicPersister;
+
+    //! The batches of records waiting to be categorized.  One is being
+    //! filled and the other is being tokenised on the thread pool.
+    SPendingBatch m_PendingBatches[2];
+
+    //! The index of the batch being filled.
+    std::size_t m_FillingBatch;
+
+    //! Protects the counts of tasks tokenising each batch.
+    std::mutex m_TokenisingMutex;
+
+    //! Signalled when a batch has been tokenised.
+    std::condition_variable m_TokenisingComplete;
+
+    //! Threads used to split the records into tokens.  This is null if
+    //! the typer is single threaded.  This must be declared after the
+    //! batches so that the threads are joined before they are destroyed.
+    TStaticThreadPoolUPtr m_ThreadPool;
 };
 }
 }
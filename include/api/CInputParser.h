@@ -7,6 +7,7 @@
 #define INCLUDED_ml_api_CInputParser_h
 
 #include <core/CNonCopyable.h>
+#include <core/CoreTypes.h>
 
 #include <api/ImportExport.h>
 
@@ -55,6 +56,47 @@ public:
     //! 2) Data row fields
     using TReaderFunc = std::function<bool(const TStrStrUMap&)>;
 
+    //! Callback function prototype that gets called with the field names
+    //! before any records are passed to a TVecReaderFunc, and again if the
+    //! field names subsequently change.  Return false to exit reader loop.
+    using TFieldNamesFunc = std::function<bool(const TStrVec&)>;
+
+    //! Callback function prototype that gets called for each record read
+    //! from the input stream when the field values are to be supplied by
+    //! position rather than by name.  The values are in the same order as
+    //! the field names most recently passed to the TFieldNamesFunc.  Return
+    //! false to exit reader loop.
+    using TVecReaderFunc = std::function<bool(const TStrVec&)>;
+
+    //! The types a field can be declared to have by input formats that
+    //! support typed fields.
+    enum EFieldType {
+        //! The value is passed as a string.
+        E_String,
+        //! The value is passed as a double.  NaN means the value is missing.
+        E_Double,
+        //! The value is passed as a double holding whole seconds since the
+        //! epoch.
+        E_Time
+    };
+
+    using TFieldTypeVec = std::vector<EFieldType>;
+    using TDoubleVec = std::vector<double>;
+
+    //! Callback function prototype that gets called with the field names
+    //! and types before any records are passed to a TTypedVecReaderFunc,
+    //! and again if the field names subsequently change.  Return false to
+    //! exit reader loop.
+    using TTypedFieldNamesFunc = std::function<bool(const TStrVec&, const TFieldTypeVec&)>;
+
+    //! Callback function prototype that gets called for each record read
+    //! from the input stream when numeric fields are to be passed without
+    //! converting them to strings.  The value of the field at position i is
+    //! in the first vector if its type is E_String and in the second vector
+    //! otherwise.  The entry in the other vector is unspecified.  Return
+    //! false to exit reader loop.
+    using TTypedVecReaderFunc = std::function<bool(const TStrVec&, const TDoubleVec&)>;
+
 public:
     CInputParser();
     virtual ~CInputParser();
@@ -68,6 +110,15 @@ public:
     //! Get field names
     const TStrVec& fieldNames() const;
 
+    //! Format \p value, the value of a field of type \p type, as a string.
+    //! A missing double, or a time which isn't a valid time, is formatted
+    //! as an empty string.
+    static void formatNumericValue(EFieldType type, double value, std::string& str);
+
+    //! Convert \p value, the value of a field of type E_Time, to a time.
+    //! Returns false if it is NaN, infinite or out of range for a time.
+    static bool numericValueToTime(double value, core_t::TTime& time);
+
     //! Read records from the stream.  The supplied settings function is
     //! called only once.  The supplied reader function is called once per
     //! record.  If the supplied reader function returns false, reading will
@@ -76,6 +127,24 @@ public:
     //! the stream it returns true, otherwise it returns false.  If
     virtual bool readStream(const TReaderFunc& readerFunc) = 0;
 
+    //! Read records from the stream, passing the field values to the
+    //! supplied reader function positionally.  This avoids building and
+    //! searching a hash map for every record, as callers can resolve the
+    //! position of each field they're interested in once when the field
+    //! names are supplied.  The default implementation is built on top of
+    //! readStream() and so is only efficient for derived classes that
+    //! override it.  The return value is as for readStream().
+    virtual bool readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                    const TVecReaderFunc& readerFunc);
+
+    //! Read records from the stream, passing the field values to the
+    //! supplied reader function positionally, with numeric fields passed
+    //! as doubles if the input format declares field types.  The default
+    //! implementation is built on top of readStreamIntoVecs() and declares
+    //! every field to be a string.  The return value is as for readStream().
+    virtual bool readStreamIntoTypedVecs(const TTypedFieldNamesFunc& fieldNamesFunc,
+                                         const TTypedVecReaderFunc& readerFunc);
+
 protected:
     //! Set the "got field names" flag
     void gotFieldNames(bool gotFieldNames);
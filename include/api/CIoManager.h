@@ -11,10 +11,15 @@
 
 #include <api/ImportExport.h>
 
+#include <cstddef>
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 namespace ml {
+namespace core {
+class CRingBufferStreamBuf;
+}
 namespace api {
 
 //! \brief
@@ -43,6 +48,11 @@ namespace api {
 //! always required.  Persist/restore streams are returned as pointers
 //! because some processes may not require both.
 //!
+//! Optionally the input can be read ahead on a dedicated thread into a
+//! lock-free ring buffer.  In this case the input stream is backed by the
+//! ring buffer, so processing overlaps with reading and bursts of input
+//! don't stall the processing thread.
+//!
 class API_EXPORT CIoManager : private core::CNonCopyable {
 public:
     //! Leave \p inputFileName/\p outputFileName empty to indicate
@@ -62,6 +72,10 @@ public:
     //! this object is destroyed.
     ~CIoManager();
 
+    //! Read the input on a dedicated thread into a ring buffer of \p depth
+    //! blocks.  Must be called before initIo().
+    void readInputAhead(std::size_t depth);
+
     //! Set up the necessary streams given the constructor arguments.
     bool initIo();
 
@@ -77,6 +91,19 @@ public:
     //! Get the stream to persist state to.  If NULL then don't persist state.
     core::CNamedPipeFactory::TOStreamP persistStream();
 
+private:
+    class CReadAheadThread;
+    using TRingBufferStreamBufUPtr = std::unique_ptr<core::CRingBufferStreamBuf>;
+    using TIStreamUPtr = std::unique_ptr<std::istream>;
+    using TReadAheadThreadUPtr = std::unique_ptr<CReadAheadThread>;
+
+private:
+    //! Start reading the input on a dedicated thread.
+    bool startReadAhead();
+
+    //! Stop reading the input on a dedicated thread.
+    void stopReadAhead();
+
 private:
     //! Have the streams been successfully initialised?
     bool m_IoInitialised;
@@ -91,6 +118,19 @@ private:
     //! std::cin is being used then this will be NULL.
     core::CNamedPipeFactory::TIStreamP m_InputStream;
 
+    //! The number of blocks in the read ahead buffer.  Zero means the input
+    //! is read on the thread which processes it.
+    std::size_t m_ReadAheadDepth;
+
+    //! The buffer the input is read ahead into.
+    TRingBufferStreamBufUPtr m_ReadAheadBuf;
+
+    //! The stream the input is processed from if it is read ahead.
+    TIStreamUPtr m_ReadAheadStream;
+
+    //! The thread which reads the input ahead.
+    TReadAheadThreadUPtr m_ReadAheadThread;
+
     //! Name of file/pipe to write output to.  Empty implies STDOUT.
     std::string m_OutputFileName;
 
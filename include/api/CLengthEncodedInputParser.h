@@ -54,6 +54,20 @@ namespace api {
 //! followed by a sequence of length/value pairs corresponding to
 //! each of the fields.
 //!
+//! The input may also declare the type of each field.  In this case
+//! the most significant bit of the number of fields in the field names
+//! record is set, and the field names are followed by a length (equal
+//! to the number of fields) and one character per field giving its
+//! type:
+//! 's' => string
+//! 'd' => double
+//! 't' => time in seconds since the epoch
+//! In the data records the value of a double or time field is then
+//! not preceded by a length.  Doubles are sent as the 8 bytes of an
+//! IEEE 754 double precision value and times as the 8 bytes of a 64
+//! bit signed integer, both little-endian.  A NaN double means the
+//! value is missing.  String fields are encoded as before.
+//!
 //! IMPLEMENTATION DECISIONS:\n
 //! The data format is designed to be a simple drop-in replacement
 //! for CSV, but order-of-magnitude more efficient to decode.  The
@@ -71,6 +85,13 @@ namespace api {
 //! interfacing with Java (which doesn't have built-in unsigned
 //! types) easier.
 //!
+//! Sending numbers as raw binary values means that they don't have to
+//! be formatted by the sender and parsed again here.  Callers that can
+//! use the values directly should call readStreamIntoTypedVecs(); the
+//! other read methods format them as strings.  The byte order of the
+//! numbers is little-endian because that is the native order of every
+//! platform we support, so in practice the bytes are simply copied.
+//!
 class API_EXPORT CLengthEncodedInputParser : public CInputParser {
 public:
     //! Construct with an input stream to be parsed.  Once a stream is
@@ -96,20 +117,50 @@ public:
     //! the end of the stream it returns true, otherwise it returns false.
     virtual bool readStream(const TReaderFunc& readerFunc);
 
+    //! Read records from the stream, passing the field values positionally.
+    //! The field names function is called once, after the header has been
+    //! parsed, and the same vector of field values is then refilled for
+    //! every record, so after the first few records no memory is allocated.
+    virtual bool readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                    const TVecReaderFunc& readerFunc);
+
+    //! Read records from the stream, passing the values of fields declared
+    //! to be numeric as doubles without converting them to strings.  The
+    //! field names function is called once, after the header has been
+    //! parsed.  If the input doesn't declare field types every field is a
+    //! string.
+    virtual bool readStreamIntoTypedVecs(const TTypedFieldNamesFunc& fieldNamesFunc,
+                                         const TTypedVecReaderFunc& readerFunc);
+
 private:
+    //! Prepare to read a new stream, parsing the field names if they haven't
+    //! already been obtained.  Returns false if the header could not be
+    //! parsed.  Completely empty input is not an error, but in this case
+    //! gotFieldNames() will still return false on return.
+    bool startStream();
+
     //! Attempt to parse a single length encoded record from the stream into
     //! the strings in the vector provided.  The vector is a template
     //! argument so that it may be a vector of boost::reference_wrappers
     //! of std::strings instead of std::strings.  The first template
     //! argument indicates whether the vector must have the correct size
     //! when the function is called or whether the function is allowed to
-    //! resize it.
+    //! resize it.  If \p numericValues is supplied the values of numeric
+    //! fields are stored in it, otherwise they're formatted as strings.
     template<bool RESIZE_ALLOWED, typename STR_VEC>
-    bool parseRecordFromStream(STR_VEC& results);
+    bool parseRecordFromStream(STR_VEC& results, TDoubleVec* numericValues = nullptr);
+
+    //! Parse the field types which follow the field names in the header of
+    //! a typed stream.
+    bool parseFieldTypesFromStream();
 
     //! Parse a 32 bit unsigned integer from the input stream.
     bool parseUInt32FromStream(uint32_t& num);
 
+    //! Parse a little-endian 64 bit value from the input stream and
+    //! convert it to a double according to \p type.
+    bool parseNumberFromStream(EFieldType type, double& num);
+
     //! Parse a string of given length from the input stream.
     bool parseStringFromStream(size_t length, std::string& str);
 
@@ -120,6 +171,9 @@ private:
     //! Allocate this much memory for the working buffer
     static const size_t WORK_BUFFER_SIZE;
 
+    //! Set in the number of fields of the header of a typed stream
+    static const uint32_t TYPED_HEADER_FLAG;
+
     //! Reference to the stream we're going to read from
     std::istream& m_StrmIn;
 
@@ -137,6 +191,13 @@ private:
     const char* m_WorkBufferPtr;
     const char* m_WorkBufferEnd;
     bool m_NoMoreRecords;
+
+    //! Did the header declare the field types?
+    bool m_Typed;
+
+    //! The type of each field.  All strings unless the header declared the
+    //! field types.
+    TFieldTypeVec m_FieldTypes;
 };
 }
 }
@@ -42,6 +42,11 @@ public:
     virtual bool writeRow(const TStrStrUMap& dataRowFields,
                           const TStrStrUMap& overrideDataRowFields);
 
+    //! Does nothing with the row provided.
+    virtual bool writeRow(const TStrVec& fieldNames,
+                          const TStrVec& fieldValues,
+                          const TStrStrUMap& overrideDataRowFields);
+
     // Bring the other overload of writeRow() into scope
     using COutputHandler::writeRow;
 };
@@ -61,6 +61,14 @@ public:
     virtual bool writeRow(const TStrStrUMap& dataRowFields,
                           const TStrStrUMap& overrideDataRowFields);
 
+    //! Call the next data processor's positional input function with some
+    //! output values, optionally overriding some of the original field
+    //! values.  Field values are copied by position, so the only hash
+    //! lookups are in \p overrideDataRowFields.
+    virtual bool writeRow(const TStrVec& fieldNames,
+                          const TStrVec& fieldValues,
+                          const TStrStrUMap& overrideDataRowFields);
+
     // Bring the other overload of writeRow() into scope
     using COutputHandler::writeRow;
 
@@ -93,6 +101,14 @@ private:
     //! Field names in the order they are to be written to the output
     TStrVec m_FieldNames;
 
+    //! The number of field names that were not extra field names.  These
+    //! are at the start of m_FieldNames.
+    std::size_t m_NumInputFields;
+
+    //! Have m_FieldNames been passed to the next data processor since they
+    //! were last set?
+    bool m_FieldNamesPassedOn;
+
     //! Pre-computed hashes for each field name.  The pre-computed hashes
     //! are at the same index in this vector as the corresponding field name
     //! in the m_FieldNames vector.
@@ -110,6 +126,10 @@ private:
     //! order as the field names in m_FieldNames.  This avoids the need to
     //! do hash lookups when populating m_WorkRecordFields.
     TStrRefVec m_WorkRecordFieldRefs;
+
+    //! Used to build up the full set of field values to pass on to the next
+    //! data processor positionally, in the same order as m_FieldNames.
+    TStrVec m_WorkRecordValues;
 };
 }
 }
@@ -84,6 +84,17 @@ public:
     virtual bool writeRow(const TStrStrUMap& dataRowFields,
                           const TStrStrUMap& overrideDataRowFields) = 0;
 
+    //! Write a row to the stream where the original field values are
+    //! supplied positionally.  \p fieldNames must be the same as the first
+    //! argument of the most recent call to fieldNames(), and \p fieldValues
+    //! must be in the same order.  Overrides are applied as for the map
+    //! version.  The default implementation builds a map of the original
+    //! field values, so handlers that are on the main processing path
+    //! should override it.
+    virtual bool writeRow(const TStrVec& fieldNames,
+                          const TStrVec& fieldValues,
+                          const TStrStrUMap& overrideDataRowFields);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise();
 
@@ -7,6 +7,8 @@
 #define INCLUDED_ml_api_CResultNormalizer_h
 
 #include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
+#include <core/CStopWatch.h>
 
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CHierarchicalResultsNormalizer.h>
@@ -17,6 +19,9 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -40,10 +45,19 @@ namespace api {
 //! The state required to initialize the normalizers is a JSON document
 //! as created by model::CHierarchicalResultsNormalizer::toJson().
 //!
+//! Records can be normalized by several threads.  In this case they are
+//! queued in batches, each batch is normalized in parallel and then its
+//! records are written in the order they were received.
+//!
 //! IMPLEMENTATION DECISIONS:\n
 //! Does not support processor chaining functionality as it is unlikely
 //! that this class would ever be chained to another data processor.
 //!
+//! Once the state has been restored the normalizers are only read, so
+//! they are shared by the threads without locking.  Queued records are
+//! only normalized and written when a batch is full or by finalise(), so
+//! finalise() must be called after the last record.
+//!
 class API_EXPORT CResultNormalizer {
 public:
     //! Field names used in records to be normalised
@@ -74,9 +88,15 @@ public:
     using TStrStrUMapItr = TStrStrUMap::iterator;
     using TStrStrUMapCItr = TStrStrUMap::const_iterator;
 
+public:
+    //! The number of records normalized together when using more than
+    //! one thread
+    static const std::size_t BATCH_SIZE;
+
 public:
     CResultNormalizer(const model::CAnomalyDetectorModelConfig& modelConfig,
-                      COutputHandler& outputHandler);
+                      COutputHandler& outputHandler,
+                      std::size_t numberThreads = 1);
 
     //! Initialise the system change normalizer
     bool initNormalizer(const std::string& stateFileName);
@@ -84,14 +104,42 @@ public:
     //! Handle a record to be normalized
     bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Normalize and write any queued records and log the throughput
+    bool finalise();
+
+    //! Get the number of records handled
+    std::uint64_t numberRecords() const;
+
+private:
+    //! \brief A record waiting to be normalized.
+    struct SQueuedRecord {
+        //! The record's fields
+        TStrStrUMap s_Fields;
+
+        //! The record's normalized score
+        std::string s_NormalizedScore;
+    };
+
+    using TQueuedRecordVec = std::vector<SQueuedRecord>;
+    using TStaticThreadPoolUPtr = std::unique_ptr<core::CStaticThreadPool>;
+
 private:
+    //! Write the output field names based on the fields of the first record
+    bool writeFieldNames(const TStrStrUMap& dataRowFields);
+
+    //! Compute the normalized score of a record
+    void normalizedScore(const TStrStrUMap& dataRowFields, std::string& result) const;
+
+    //! Normalize the queued records in parallel and write them in order
+    bool normalizeQueuedRecords();
+
     bool parseDataFields(const TStrStrUMap& dataRowFields,
                          std::string& level,
                          std::string& partition,
                          std::string& person,
                          std::string& function,
                          std::string& valueFieldName,
-                         double& probability);
+                         double& probability) const;
 
     bool parseDataFields(const TStrStrUMap& dataRowFields,
                          std::string& level,
@@ -100,7 +148,7 @@ private:
                          std::string& person,
                          std::string& function,
                          std::string& valueFieldName,
-                         double& probability);
+                         double& probability) const;
 
     template<typename T>
     bool parseDataField(const TStrStrUMap& dataRowFields,
@@ -135,6 +183,23 @@ private:
 
     //! The hierarchical results normalizer
     model::CHierarchicalResultsNormalizer m_Normalizer;
+
+    //! The records waiting to be normalized.  The entries are reused so
+    //! only the first m_NumberQueuedRecords are valid.
+    TQueuedRecordVec m_QueuedRecords;
+
+    //! The number of records waiting to be normalized
+    std::size_t m_NumberQueuedRecords;
+
+    //! The number of records handled
+    std::uint64_t m_NumberRecords;
+
+    //! Times from receiving the first record to finalise()
+    core::CStopWatch m_Timer;
+
+    //! The threads which help normalize the queued records, or null if
+    //! records are normalized as they're received
+    TStaticThreadPoolUPtr m_ThreadPool;
 };
 }
 }
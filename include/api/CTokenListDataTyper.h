@@ -14,6 +14,7 @@
 #include <api/CBaseTokenListDataTyper.h>
 
 #include <algorithm>
+#include <cmath>
 #include <string>
 
 #include <ctype.h>
@@ -71,46 +72,34 @@ protected:
         tokenUniqueIds.clear();
         totalWeight = 0;
 
-        std::string temp;
+        this->splitString(fields, str, [&](const std::string& token) {
+            this->tokenToIdAndWeight(token, tokenIds, tokenUniqueIds, totalWeight);
+        });
 
-        // TODO - make more efficient
-        std::string::size_type nonHexPos(std::string::npos);
-        for (std::string::size_type i = 0; i < str.size(); ++i) {
-            const char curChar(str[i]);
+        LOG_TRACE(<< str << " tokenised to " << tokenIds.size() << " tokens with total weight "
+                  << totalWeight << ": " << SIdTranslater(*this, tokenIds, ' '));
+    }
 
-            // Basically tokenise into [a-zA-Z0-9]+ strings, possibly
-            // allowing underscores, dots and dashes in the middle
-            if (::isalnum(static_cast<unsigned char>(curChar)) ||
-                (!temp.empty() && ((ALLOW_UNDERSCORE && curChar == '_') ||
-                                   (ALLOW_DOT && curChar == '.') ||
-                                   (ALLOW_DASH && curChar == '-')))) {
-                temp += curChar;
-                if (IGNORE_HEX) {
-                    // Count dots and dashes as numeric
-                    if (!::isxdigit(static_cast<unsigned char>(curChar)) &&
-                        curChar != '.' && curChar != '-') {
-                        nonHexPos = temp.length() - 1;
-                    }
-                }
-            } else {
-                if (!temp.empty()) {
-                    this->considerToken(fields, nonHexPos, temp, tokenIds,
-                                        tokenUniqueIds, totalWeight);
-                    temp.clear();
-                }
+    //! Split the string into a list of tokens and their weights.  Any
+    //! previous content of \p tokens is wiped.
+    virtual void tokeniseString(const TStrStrUMap& fields,
+                                const std::string& str,
+                                TStrSizePrVec& tokens) const {
+        tokens.clear();
 
-                if (IGNORE_HEX) {
-                    nonHexPos = std::string::npos;
-                }
-            }
-        }
+        this->splitString(fields, str, [&](const std::string& token) {
+            tokens.emplace_back(token, this->tokenWeight(token));
+        });
+    }
 
-        if (!temp.empty()) {
-            this->considerToken(fields, nonHexPos, temp, tokenIds, tokenUniqueIds, totalWeight);
+    //! Get the weighting of a string token.
+    virtual size_t tokenWeight(const std::string& token) const {
+        size_t weight(1);
+        if (token.length() >= MIN_DICTIONARY_LENGTH) {
+            // Give more weighting to tokens that are dictionary words.
+            weight += m_DictionaryWeightFunc(m_Dict.partOfSpeech(token));
         }
-
-        LOG_TRACE(<< str << " tokenised to " << tokenIds.size() << " tokens with total weight "
-                  << totalWeight << ": " << SIdTranslater(*this, tokenIds, ' '));
+        return weight;
     }
 
     //! Take a string token, convert it to a numeric ID and a weighting and
@@ -119,12 +108,7 @@ protected:
                                     TSizeSizePrVec& tokenIds,
                                     TSizeSizeMap& tokenUniqueIds,
                                     size_t& totalWeight) {
-        TSizeSizePr idWithWeight(this->idForToken(token), 1);
-
-        if (token.length() >= MIN_DICTIONARY_LENGTH) {
-            // Give more weighting to tokens that are dictionary words.
-            idWithWeight.second += m_DictionaryWeightFunc(m_Dict.partOfSpeech(token));
-        }
+        TSizeSizePr idWithWeight(this->idForToken(token), this->tokenWeight(token));
         tokenIds.push_back(idWithWeight);
         tokenUniqueIds[idWithWeight.first] += idWithWeight.second;
         totalWeight += idWithWeight.second;
@@ -134,13 +118,21 @@ protected:
     virtual double similarity(const TSizeSizePrVec& left,
                               size_t leftWeight,
                               const TSizeSizePrVec& right,
-                              size_t rightWeight) const {
+                              size_t rightWeight,
+                              double minSimilarity) const {
         double similarity(1.0);
 
         size_t maxWeight(std::max(leftWeight, rightWeight));
         if (maxWeight > 0) {
-            size_t diff(DO_WARPING ? m_SimilarityTester.weightedEditDistance(left, right)
-                                   : this->compareNoWarp(left, right));
+            // Differences greater than this give a similarity less than the
+            // minimum, so the edit distance calculation can stop early
+            size_t maxDiff(minSimilarity > 0.0
+                               ? static_cast<size_t>(std::ceil(
+                                     (1.0 - minSimilarity) * double(maxWeight)))
+                               : core::CStringSimilarityTester::NO_MAXIMUM_DISTANCE);
+            size_t diff(DO_WARPING
+                            ? m_SimilarityTester.weightedEditDistance(left, right, maxDiff)
+                            : this->compareNoWarp(left, right));
 
             similarity = 1.0 - double(diff) / double(maxWeight);
         }
@@ -178,17 +170,58 @@ private:
         return diff;
     }
 
-    //! Consider adding a token to the data structures that will be used in
-    //! the comparison.  The \p token argument must not be empty when this
-    //! method is called.  This method may modify \p token.
-    void considerToken(const TStrStrUMap& fields,
+    //! Split \p str into tokens and call \p addToken for each one which
+    //! should be used in the comparison.
+    template<typename ADD_TOKEN>
+    void splitString(const TStrStrUMap& fields, const std::string& str, ADD_TOKEN addToken) const {
+        std::string temp;
+
+        // TODO - make more efficient
+        std::string::size_type nonHexPos(std::string::npos);
+        for (std::string::size_type i = 0; i < str.size(); ++i) {
+            const char curChar(str[i]);
+
+            // Basically tokenise into [a-zA-Z0-9]+ strings, possibly
+            // allowing underscores, dots and dashes in the middle
+            if (::isalnum(static_cast<unsigned char>(curChar)) ||
+                (!temp.empty() && ((ALLOW_UNDERSCORE && curChar == '_') ||
+                                   (ALLOW_DOT && curChar == '.') ||
+                                   (ALLOW_DASH && curChar == '-')))) {
+                temp += curChar;
+                if (IGNORE_HEX) {
+                    // Count dots and dashes as numeric
+                    if (!::isxdigit(static_cast<unsigned char>(curChar)) &&
+                        curChar != '.' && curChar != '-') {
+                        nonHexPos = temp.length() - 1;
+                    }
+                }
+            } else {
+                if (!temp.empty()) {
+                    if (this->considerToken(fields, nonHexPos, temp)) {
+                        addToken(temp);
+                    }
+                    temp.clear();
+                }
+
+                if (IGNORE_HEX) {
+                    nonHexPos = std::string::npos;
+                }
+            }
+        }
+
+        if (!temp.empty() && this->considerToken(fields, nonHexPos, temp)) {
+            addToken(temp);
+        }
+    }
+
+    //! Consider whether a token should be used in the comparison.  The
+    //! \p token argument must not be empty when this method is called.
+    //! This method may modify \p token.
+    bool considerToken(const TStrStrUMap& fields,
                        std::string::size_type nonHexPos,
-                       std::string& token,
-                       TSizeSizePrVec& tokenIds,
-                       TSizeSizeMap& tokenUniqueIds,
-                       size_t& totalWeight) {
+                       std::string& token) const {
         if (IGNORE_LEADING_DIGIT && ::isdigit(static_cast<unsigned char>(token[0]))) {
-            return;
+            return false;
         }
 
         // If configured, ignore pure hex numbers, with or without a 0x
@@ -196,7 +229,7 @@ private:
         if (IGNORE_HEX) {
             if (nonHexPos == std::string::npos) {
                 // Implies hex without 0x prefix.
-                return;
+                return false;
             }
 
             // This second hex test is redundant if we're ignoring tokens
@@ -206,7 +239,7 @@ private:
             if (!IGNORE_LEADING_DIGIT && nonHexPos == 1 &&
                 token.compare(0, 2, "0x") == 0 && token.length() != 2) {
                 // Implies hex with 0x prefix.
-                return;
+                return false;
             }
         }
 
@@ -216,14 +249,14 @@ private:
         }
 
         if (IGNORE_DATE_WORDS && core::CTimeUtils::isDateWord(token)) {
-            return;
+            return false;
         }
 
         if (IGNORE_FIELD_NAMES && fields.find(token) != fields.end()) {
-            return;
+            return false;
         }
 
-        this->tokenToIdAndWeight(token, tokenIds, tokenUniqueIds, totalWeight);
+        return true;
     }
 
 private:
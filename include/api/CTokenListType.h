@@ -76,6 +76,7 @@ public:
     const std::string& baseString() const;
     const TSizeSizePrVec& baseTokenIds() const;
     size_t baseWeight() const;
+    const TSizeSizePrVec& baseUniqueTokenIds() const;
     const TSizeSizePrVec& commonUniqueTokenIds() const;
     size_t commonUniqueTokenWeight() const;
     size_t origUniqueTokenWeight() const;
@@ -97,6 +98,11 @@ public:
     //! as it can return false as soon as a mismatch occurs.
     bool isMissingCommonTokenWeightZero(const TSizeSizeMap& uniqueTokenIds) const;
 
+    //! What is the weight of the tokens in a given map that are also in
+    //! this type's base tokens?  Tokens appearing different numbers of times
+    //! contribute the lower of their two weights.
+    size_t commonTokenWeight(const TSizeSizeMap& uniqueTokenIds) const;
+
     //! Does the supplied token vector contain all our common tokens in the
     //! same order as our base token vector?
     bool containsCommonTokensInOrder(const TSizeSizePrVec& tokenIds) const;
@@ -124,6 +130,11 @@ private:
     //! Cache the total weight of the base tokens
     size_t m_BaseWeight;
 
+    //! The unique base token IDs and their total weights.  This vector is
+    //! sorted into ascending order of ID.  It isn't persisted because it
+    //! can be computed from the base tokens.
+    TSizeSizePrVec m_BaseUniqueTokenIds;
+
     //! The maximum original length of all the strings that have been
     //! classified as this type.  The original length may be longer than the
     //! length of the strings in passed to the addString() method, because
@@ -0,0 +1,121 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CBinaryStatePersistInserter_h
+#define INCLUDED_ml_core_CBinaryStatePersistInserter_h
+
+#include <core/CStatePersistInserter.h>
+#include <core/ImportExport.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! For persisting state in a compact binary format.
+//!
+//! DESCRIPTION:\n
+//! Concrete implementation of the CStatePersistInserter interface
+//! that persists state in a compact binary format. This is much
+//! smaller and cheaper to write and read than JSON for the deeply
+//! nested, number heavy state of the models, so is suitable for
+//! high frequency or intermediate snapshots. It is restored using
+//! CBinaryStateRestoreTraverser.
+//!
+//! The document is a magic header followed by a sequence of elements.
+//! Each element starts with a varint header whose two lowest bits
+//! are the element type and whose remaining bits are the identifier
+//! of the element's name. Names are interned per document: the first
+//! time a name is used its identifier is written as zero and the name
+//! follows as a length prefixed string, which implicitly defines the
+//! next identifier. The payloads are:
+//!   -# String: varint length followed by the bytes.
+//!   -# Double: the 8 bytes of the IEEE754 representation, little endian.
+//!   -# Level start: nothing, the level's elements follow.
+//!   -# Level end: nothing, the name identifier is always zero.
+//! The document is terminated by a level end at the top level.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Output is streaming rather than building up an in-memory document.
+//!
+//! Floating point values inserted with a precision are stored as the
+//! raw bits of the value rounded to that precision, so they avoid the
+//! cost of printing and parsing and are never less accurate than their
+//! string representation. All other values go through the string
+//! conversions of the base class so restoring code sees exactly the
+//! same strings as it would for the other formats.
+//!
+class CORE_EXPORT CBinaryStatePersistInserter : public CStatePersistInserter {
+public:
+    //! The element types.
+    enum EElementType {
+        E_String = 0,
+        E_Double = 1,
+        E_LevelStart = 2,
+        E_LevelEnd = 3
+    };
+
+    //! The number of bits of the element header used for the type.
+    static const std::size_t TYPE_BITS;
+    //! The mask to extract the element type from the header.
+    static const std::uint64_t TYPE_MASK;
+    //! The header which starts every document.
+    static const std::string MAGIC;
+
+public:
+    CBinaryStatePersistInserter(std::ostream& outputStream);
+
+    //! Destructor terminates the document and flushes.
+    virtual ~CBinaryStatePersistInserter();
+
+    //! Store a name/value
+    virtual void insertValue(const std::string& name, const std::string& value);
+
+    //! Store a floating point number with a given level of precision
+    //! as its raw IEEE754 representation.
+    virtual void insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
+
+    // Bring extra base class overloads into scope
+    using CStatePersistInserter::insertValue;
+
+    //! Flush the underlying output stream
+    void flush();
+
+protected:
+    //! Start a new level with the given name
+    virtual void newLevel(const std::string& name);
+
+    //! End the current level
+    virtual void endLevel();
+
+private:
+    using TStrUInt64UMap = boost::unordered_map<std::string, std::uint64_t>;
+
+private:
+    //! Write the header of an element with \p name and \p type.
+    void writeHeader(const std::string& name, EElementType type);
+
+    //! Write \p value in LEB128 varint encoding.
+    void writeVarint(std::uint64_t value);
+
+    //! Write \p value prefixed by its length.
+    void writeString(const std::string& value);
+
+private:
+    //! The stream to which to write.
+    std::ostream& m_OutputStream;
+
+    //! The identifiers of the names used so far.
+    TStrUInt64UMap m_NameIds;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CBinaryStatePersistInserter_h
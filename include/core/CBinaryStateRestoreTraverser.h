@@ -0,0 +1,157 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
+#define INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
+
+#include <core/CStateRestoreTraverser.h>
+#include <core/ImportExport.h>
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! For restoring state in the compact binary format.
+//!
+//! DESCRIPTION:\n
+//! Concrete implementation of the CStateRestoreTraverser interface
+//! that restores state written by CBinaryStatePersistInserter. See
+//! that class for a description of the format.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Input is streaming rather than building up an in-memory document.
+//! Sub-levels which aren't descended into are skipped without being
+//! decoded.
+//!
+//! Floating point values are returned exactly by doubleValue(), and
+//! so typedValue(), without being converted to a string. They're only
+//! printed if value() is called, with enough significant figures that
+//! parsing the string recovers the exact value which was stored.
+//!
+//! Lengths read from the input aren't trusted to size strings: long
+//! strings are checked against the remaining input, if the stream can
+//! report it, and are read in chunks.
+//!
+class CORE_EXPORT CBinaryStateRestoreTraverser : public CStateRestoreTraverser {
+public:
+    CBinaryStateRestoreTraverser(std::istream& inputStream);
+
+    //! Does the next document in \p inputStream look like binary state?
+    //!
+    //! \note This only peeks at the next character so that any format
+    //! can be restored from the stream afterwards.
+    static bool isBinaryState(std::istream& inputStream);
+
+    //! Read the next binary state document in \p inputStream, without
+    //! restoring it, into \p document.
+    static bool readDocument(std::istream& inputStream, std::string& document);
+
+    //! Navigate to the next element at the current level, or return false
+    //! if there isn't one
+    virtual bool next();
+
+    //! Does the current element have a sub-level?
+    virtual bool hasSubLevel() const;
+
+    //! Get the name of the current element - the returned reference is only
+    //! valid for as long as the traverser is pointing at the same element
+    virtual const std::string& name() const;
+
+    //! Get the value of the current element - the returned reference is
+    //! only valid for as long as the traverser is pointing at the same
+    //! element
+    virtual const std::string& value() const;
+
+    //! Get the value of the current element as a double.
+    virtual bool doubleValue(double& result) const;
+
+    //! Is the traverser at the end of the inputstream?
+    virtual bool isEof() const;
+
+protected:
+    //! Navigate to the start of the sub-level of the current element, or
+    //! return false if there isn't one
+    virtual bool descend();
+
+    //! Navigate to the element of the level above from which descend() was
+    //! called, or return false if there isn't a level above
+    virtual bool ascend();
+
+private:
+    using TStrVec = std::vector<std::string>;
+    using TSizeVec = std::vector<std::size_t>;
+
+private:
+    //! Check the document header and read the first element.
+    bool start();
+
+    //! Read the next element at any level into the current element.
+    bool readElement();
+
+    //! Skip the contents of the sub-level of the current element.
+    bool skipSubLevel();
+
+    //! Read a LEB128 varint into \p value.
+    bool readVarint(std::uint64_t& value);
+
+    //! Read a length prefixed string into \p value.
+    bool readString(std::string& value);
+
+    //! Get the number of bytes left in the input if the stream can
+    //! seek to its end.
+    bool remainingInput(std::uint64_t& remaining);
+
+    //! Read \p n bytes into \p buffer, copying them to the document if
+    //! it's being read.
+    bool read(char* buffer, std::size_t n);
+
+    //! Log an error and mark the traverser as at the end of the level.
+    bool fail(const std::string& what);
+
+private:
+    //! The stream from which to read.
+    std::istream& m_InputStream;
+
+    //! Flag to indicate whether we've started reading.
+    bool m_Started;
+
+    //! The names defined so far indexed by their identifier minus one.
+    TStrVec m_Names;
+
+    //! The name indices of the levels we've descended into.
+    TSizeVec m_Levels;
+
+    //! The index of the current element's name, or NO_NAME
+    //! if it doesn't have one.
+    std::size_t m_Name;
+
+    //! The current element's type.
+    int m_Type;
+
+    //! True if the sub-level of the current element has already
+    //! been read.
+    bool m_SubLevelRead;
+
+    //! The current element's floating point value.
+    double m_Double;
+
+    //! The current element's value.
+    mutable std::string m_Value;
+
+    //! True if the current element's value needs formatting.
+    mutable bool m_FormatValue;
+
+    //! If not null the bytes read are appended to this.
+    std::string* m_Document;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
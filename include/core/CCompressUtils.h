@@ -11,6 +11,7 @@
 
 #include <zlib.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -69,6 +70,28 @@ public:
     //! desirable to explicitly reset the compressor state.
     void reset();
 
+    //! Compress the \p length bytes at \p input into \p result in a
+    //! single call.
+    //!
+    //! \note This doesn't need a Z stream so can be used where creating
+    //! a CCompressUtils object for each compression would be wasteful.
+    static bool deflateBytes(const void* input,
+                             std::size_t length,
+                             TByteVec& result,
+                             int level = Z_DEFAULT_COMPRESSION);
+
+    //! Decompress \p input, which must have been created by deflateBytes
+    //! from exactly \p length bytes, into the \p length bytes at \p result.
+    static bool inflateBytes(const TByteVec& input, void* result, std::size_t length);
+
+    //! Decompress the \p inputLength bytes at \p input, which must have
+    //! been created by deflateBytes from exactly \p length bytes, into the
+    //! \p length bytes at \p result.
+    static bool inflateBytes(const void* input,
+                             std::size_t inputLength,
+                             void* result,
+                             std::size_t length);
+
 private:
     bool doCompress(bool finish, const std::string& input);
 
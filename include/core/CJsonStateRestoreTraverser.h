@@ -31,6 +31,9 @@ namespace core {
 //! Input is streaming rather than building up an in-memory JSON
 //! document.
 //!
+//! Nothing after the end of the root value is read, so the stream can
+//! hold several documents, each restored with a new traverser.
+//!
 //! Unlike the CRapidXmlStatePersistInserter, there is no possibility
 //! of including attributes on the root node (because JSON does not
 //! have attributes).  This may complicate code that needs to be 100%
@@ -0,0 +1,225 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CMonotonicArena_h
+#define INCLUDED_ml_core_CMonotonicArena_h
+
+#include <core/CNonCopyable.h>
+#include <core/ImportExport.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief A monotonic arena for short lived objects.
+//!
+//! DESCRIPTION:\n
+//! Memory is handed out by bumping a pointer through large blocks which
+//! are obtained from the heap. Individual deallocations are ignored and
+//! all memory is released wholesale by reset. This makes allocation and
+//! deallocation of large numbers of small transient objects, for example
+//! the containers created when a bucket's results are computed, very
+//! cheap.
+//!
+//! An arena is installed for the current thread by creating a
+//! CScopedMonotonicArena and is used by any CMonotonicArenaAllocator
+//! which is default constructed on that thread while it is installed.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Reset replaces the blocks by a single block which is large enough for
+//! all the allocations since the last reset, so in steady state the arena
+//! makes no heap allocations at all. The retained block is capped so that
+//! one unusually large bucket doesn't pin its memory for the lifetime of
+//! the arena.
+//!
+//! The arena counts the allocations it serves and the blocks it obtains
+//! from the heap, so one can check the reduction in heap allocations.
+//!
+//! This is not thread safe: an arena should only be used by the thread
+//! which installed it.
+class CORE_EXPORT CMonotonicArena : private CNonCopyable {
+public:
+    //! \brief Summary statistics for the arena's allocations.
+    struct CORE_EXPORT SStatistics {
+        SStatistics();
+
+        //! The number of allocations served since the last reset.
+        std::uint64_t s_Allocations;
+        //! The number of bytes allocated since the last reset.
+        std::uint64_t s_Bytes;
+        //! The number of blocks obtained from the heap since the last reset.
+        std::uint64_t s_HeapAllocations;
+        //! The total number of allocations served.
+        std::uint64_t s_TotalAllocations;
+        //! The total number of blocks obtained from the heap.
+        std::uint64_t s_TotalHeapAllocations;
+    };
+
+public:
+    //! The default size of the blocks obtained from the heap.
+    static const std::size_t DEFAULT_BLOCK_SIZE;
+
+    //! The default maximum size of the block retained on reset.
+    static const std::size_t DEFAULT_MAX_RETAINED_SIZE;
+
+public:
+    explicit CMonotonicArena(std::size_t blockSize = DEFAULT_BLOCK_SIZE,
+                             std::size_t maxRetainedSize = DEFAULT_MAX_RETAINED_SIZE);
+
+    //! Allocate \p size bytes aligned to \p alignment.
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+    //! This is a no-op: memory is only released by reset.
+    void deallocate(void* /*p*/, std::size_t /*size*/) {}
+
+    //! Release all the memory allocated since the last reset.
+    //!
+    //! At most the maximum retained size is kept for reuse and the rest
+    //! is returned to the heap.
+    //!
+    //! \warning This invalidates all objects allocated by the arena.
+    void reset();
+
+    //! Get the allocation statistics.
+    const SStatistics& statistics() const;
+
+    //! Get the memory used by this object.
+    std::size_t memoryUsage() const;
+
+    //! Get the arena installed for the current thread if any.
+    static CMonotonicArena* current();
+
+private:
+    using TCharArrayPtr = std::unique_ptr<char[]>;
+    using TCharArrayPtrSizePr = std::pair<TCharArrayPtr, std::size_t>;
+    using TCharArrayPtrSizePrVec = std::vector<TCharArrayPtrSizePr>;
+
+private:
+    //! Add a new block with space for at least \p size bytes.
+    void newBlock(std::size_t size);
+
+private:
+    //! The minimum size of the blocks obtained from the heap.
+    std::size_t m_BlockSize;
+
+    //! The maximum size of the block retained on reset.
+    std::size_t m_MaxRetainedSize;
+
+    //! The blocks and their sizes.
+    TCharArrayPtrSizePrVec m_Blocks;
+
+    //! The next free byte in the current block.
+    char* m_Next;
+
+    //! The end of the current block.
+    char* m_End;
+
+    //! The allocation statistics.
+    SStatistics m_Statistics;
+};
+
+//! \brief Installs an arena for the current thread.
+//!
+//! DESCRIPTION:\n
+//! The arena is installed for the lifetime of this object and the arena
+//! which was previously installed, if any, is restored on destruction.
+//! The arena is optionally reset on destruction, in which case this must
+//! be created before any container which uses the arena.
+class CORE_EXPORT CScopedMonotonicArena : private CNonCopyable {
+public:
+    CScopedMonotonicArena(CMonotonicArena& arena, bool reset = true);
+    ~CScopedMonotonicArena();
+
+private:
+    //! The arena installed by this object.
+    CMonotonicArena& m_Arena;
+
+    //! The arena which was installed before this object was created.
+    CMonotonicArena* m_Previous;
+
+    //! If true the arena is reset on destruction.
+    bool m_Reset;
+};
+
+//! \brief A standard allocator which uses the current thread's arena.
+//!
+//! DESCRIPTION:\n
+//! If an arena was installed for the current thread when the allocator
+//! was default constructed memory is taken from it, otherwise memory is
+//! taken from the heap. This means that containers which use it can be
+//! used anywhere, but they must not outlive the scope of the arena they
+//! were created in if there was one.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Allocators are propagated on container move assignment and swap so
+//! containers created in the same scope can be swapped freely. A copy
+//! of a container uses the arena installed where the copy is made.
+template<typename T>
+class CMonotonicArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template<typename U>
+    struct rebind {
+        using other = CMonotonicArenaAllocator<U>;
+    };
+
+public:
+    CMonotonicArenaAllocator() : m_Arena(CMonotonicArena::current()) {}
+
+    template<typename U>
+    CMonotonicArenaAllocator(const CMonotonicArenaAllocator<U>& other)
+        : m_Arena(other.arena()) {}
+
+    T* allocate(std::size_t n) {
+        if (m_Arena != nullptr) {
+            return static_cast<T*>(m_Arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        if (m_Arena != nullptr) {
+            m_Arena->deallocate(p, n * sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    CMonotonicArenaAllocator select_on_container_copy_construction() const {
+        return CMonotonicArenaAllocator();
+    }
+
+    //! Get the arena this uses or null if it uses the heap.
+    CMonotonicArena* arena() const { return m_Arena; }
+
+private:
+    //! The arena or null if the heap is used.
+    CMonotonicArena* m_Arena;
+};
+
+template<typename T, typename U>
+bool operator==(const CMonotonicArenaAllocator<T>& lhs, const CMonotonicArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const CMonotonicArenaAllocator<T>& lhs, const CMonotonicArenaAllocator<U>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+}
+}
+
+#endif // INCLUDED_ml_core_CMonotonicArena_h
@@ -869,6 +869,14 @@ public:
         return ret;
     }
 
+    static bool dispatch(const std::string& tag, double& t, CStateRestoreTraverser& traverser) {
+        bool ret = true;
+        if (traverser.name() == tag) {
+            ret = traverser.doubleValue(t);
+        }
+        return ret;
+    }
+
     template<typename A, typename B>
     static bool
     dispatch(const std::string& tag, std::pair<A, B>& t, CStateRestoreTraverser& traverser) {
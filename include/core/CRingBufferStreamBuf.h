@@ -0,0 +1,231 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CRingBufferStreamBuf_h
+#define INCLUDED_ml_core_CRingBufferStreamBuf_h
+
+#include <core/ImportExport.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! A stream buffer where reads and writes are processed in different
+//! threads which hands blocks of data over through a lock-free ring.
+//!
+//! DESCRIPTION:\n
+//! Has the same interface and semantics as CDualThreadStreamBuf, so can
+//! be used wherever content is generated in one thread and consumed in
+//! another, for example to read an input pipe on a dedicated thread.
+//!
+//! Unlike CDualThreadStreamBuf, which has a single intermediate buffer,
+//! the writer can get up to depth - 1 blocks ahead of the reader.  This
+//! smooths out bursty input, because the reader doesn't have to catch up
+//! before the writer can hand over the next block.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! This class is ONLY safe for one thread writing into it whilst another
+//! thread reads from it.
+//!
+//! The blocks are handed over by two counters, the number of blocks the
+//! writer has published and the number the reader has released.  Each is
+//! only ever modified by one side, so no lock is needed to exchange data.
+//! The counters live on separate cache lines so the reader and writer
+//! don't contend for the same line whilst both are running.
+//!
+//! When a side has to wait it yields for a short while and then sleeps on
+//! a condition variable.  The condition variable is only signalled if the
+//! other side has flagged that it's sleeping, so the mutex is never taken
+//! when data is flowing freely.  A reader of a quiet pipe doesn't burn CPU.
+//!
+//! Every block reserves space in front of its data for putback.  On moving
+//! to the next block the end of the previous block is copied into this
+//! space, so up to PUTBACK_CAPACITY characters can be returned to the
+//! stream, whether or not they match what was read.  As with
+//! CDualThreadStreamBuf, clients should prefer putback() to unget().
+//!
+//! The tellg() and tellp() positions are maintained as for
+//! CDualThreadStreamBuf, and the class isn't otherwise seekable.
+//!
+class CORE_EXPORT CRingBufferStreamBuf : public std::streambuf {
+public:
+    //! The default number of characters in each block.
+    static const std::size_t DEFAULT_BLOCK_CAPACITY;
+
+    //! The default number of blocks in the ring.
+    static const std::size_t DEFAULT_DEPTH;
+
+    //! The number of characters which can be put back.
+    static const std::size_t PUTBACK_CAPACITY = 64;
+
+public:
+    //! \param[in] blockCapacity The number of characters in each block.
+    //! \param[in] depth The number of blocks, which must be at least two.
+    CRingBufferStreamBuf(std::size_t blockCapacity = DEFAULT_BLOCK_CAPACITY,
+                         std::size_t depth = DEFAULT_DEPTH);
+
+    //! Set the end-of-file flag.  This should be called by the writer.
+    void signalEndOfFile();
+
+    //! Get the end-of-file flag
+    bool endOfFile() const;
+
+    //! Set the fatal error flag
+    void signalFatalError();
+
+    //! Get the fatal error flag
+    bool hasFatalError() const;
+
+protected:
+    //! Get an estimate of the number of characters still to read after an
+    //! underflow.  This is the unread data in the current block plus the
+    //! data in all the published blocks.
+    virtual std::streamsize showmanyc();
+
+    //! Publish the current write block immediately.  Effectively this
+    //! flushes data through with lower latency but also less efficiently.
+    virtual int sync();
+
+    //! Get up to n characters from the read block and store them in the
+    //! array pointed to by s.
+    virtual std::streamsize xsgetn(char* s, std::streamsize n);
+
+    //! Move on to the next published block.  This may block if the writer
+    //! hasn't published another block.
+    virtual int underflow();
+
+    //! Put character back in the case of backup underflow.
+    virtual int pbackfail(int c = traits_type::eof());
+
+    //! Write up to n characters from the array pointed to by s into the
+    //! write block.
+    virtual std::streamsize xsputn(const char* s, std::streamsize n);
+
+    //! Publish the current write block and move on to the next one.  This
+    //! may block if all the blocks are waiting to be read.
+    virtual int overflow(int c = traits_type::eof());
+
+    //! Only supports a zero byte seek relative to the current position in
+    //! order to allow tellg() and tellp() to work on the connected stream.
+    virtual std::streampos
+    seekoff(std::streamoff off,
+            std::ios_base::seekdir way,
+            std::ios_base::openmode which = std::ios_base::in | std::ios_base::out);
+
+private:
+    //! The size of a cache line on the platforms we support.
+    static const std::size_t CACHE_LINE_SIZE = 64;
+
+    //! \brief A counter which has a cache line to itself.
+    struct SPaddedCounter {
+        SPaddedCounter() : s_Value(0) {}
+
+        std::atomic_size_t s_Value;
+        char s_Padding[CACHE_LINE_SIZE - sizeof(std::atomic_size_t)];
+    };
+
+    using TCharArrayUPtr = std::unique_ptr<char[]>;
+    using TSizeVec = std::vector<std::size_t>;
+
+private:
+    //! Get the start of the data in block \p block.
+    char* blockData(std::size_t block) const;
+
+    //! Hand the current write block over to the reader.
+    void publishWriteBlock();
+
+    //! Wait for a free block and make it the write block.  Returns false if
+    //! the reader signalled a fatal error whilst waiting.
+    bool acquireWriteBlock();
+
+    //! Release the current read block, wait for a published block and make
+    //! it the read block.  Returns false at end-of-file or if there is a
+    //! fatal error.
+    bool acquireReadBlock();
+
+    //! Yield and then sleep until \p ready returns true.
+    template<typename PREDICATE>
+    void wait(std::atomic_bool& waiting, PREDICATE ready);
+
+    //! Wake the other side if it's flagged \p waiting.
+    void wake(const std::atomic_bool& waiting);
+
+private:
+    //! The number of characters in each block.
+    std::size_t m_BlockCapacity;
+
+    //! The number of blocks.
+    std::size_t m_Depth;
+
+    //! The storage for all the blocks, each of which is PUTBACK_CAPACITY
+    //! characters of putback space followed by m_BlockCapacity characters
+    //! of data.
+    TCharArrayUPtr m_Blocks;
+
+    //! The number of characters in each published block.  An entry is
+    //! written by the writer before the block is published and read by the
+    //! reader after it is acquired.
+    TSizeVec m_BlockSizes;
+
+    //! The number of characters in the blocks the writer has published.
+    //! Enables tellp() to work on an associated ostream.  Only accessed by
+    //! the writer.
+    std::size_t m_WriteBytesPublished;
+
+    //! The number of blocks published by the writer.
+    SPaddedCounter m_Published;
+
+    //! The number of blocks released by the reader.
+    SPaddedCounter m_Released;
+
+    //! Does the reader currently hold a block?  Only accessed by the reader.
+    bool m_HaveReadBlock;
+
+    //! The characters saved from the end of the last read block to be
+    //! copied into the putback space of the next.  Only accessed by the
+    //! reader.
+    char m_PutbackSaved[PUTBACK_CAPACITY];
+
+    //! The number of characters in m_PutbackSaved.
+    std::size_t m_PutbackSavedSize;
+
+    //! The number of characters in the blocks the reader has acquired.
+    //! Enables tellg() to work on an associated istream.  Only accessed by
+    //! the reader.
+    std::size_t m_ReadBytesAcquired;
+
+    //! Set whilst the reader is sleeping.
+    std::atomic_bool m_ReaderWaiting;
+
+    //! Set whilst the writer is sleeping.
+    std::atomic_bool m_WriterWaiting;
+
+    //! Only used to sleep when one side has to wait for the other.
+    std::mutex m_WaitMutex;
+
+    //! Signalled to wake up a sleeping reader or writer.
+    std::condition_variable m_WaitCondition;
+
+    //! Flag to indicate end-of-file.  When this is set, the reader will
+    //! receive end-of-file notification once all the blocks are read.
+    //! The writer will not be allowed to add any more data.
+    std::atomic_bool m_Eof;
+
+    //! A call to signalFatalError() chucks away all currently buffered data
+    //! and prevents future data being added.
+    std::atomic_bool m_FatalError;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CRingBufferStreamBuf_h
@@ -40,6 +40,11 @@ class CCompressOStream;
 //! that downstream CDataAdder/CDataSearcher store will
 //! support strings of Base64 encoded data
 //!
+//! State can also be compressed in independent shards, for example on
+//! several threads, and then written one after another.  Each shard is a
+//! complete gzip member, and a gzip stream may consist of several members,
+//! so CStateDecompressor reads the shards back as one stream.
+//!
 class CORE_EXPORT CStateCompressor : public CDataAdder {
 public:
     static const std::string COMPRESSED_ATTRIBUTE;
@@ -127,6 +132,16 @@ public:
     //! be given out to clients.
     virtual TOStreamP addStreamed(const std::string& index, const std::string& id);
 
+    //! Add streamed data which has already been compressed by compressShard().
+    //! The returned stream only encodes and chunks what is written to it.
+    //! Return of NULL stream indicates failure.  Only one of addStreamed()
+    //! and addCompressedStreamed() may be called.
+    TOStreamP addCompressedStreamed(const std::string& index, const std::string& id);
+
+    //! Compress \p state so that it can be written to the stream returned
+    //! by addCompressedStreamed().  This is thread safe.
+    static std::string compressShard(const std::string& state);
+
     //! Clients that get a stream using addStreamed() must call this
     //! method one they've finished sending data to the stream.
     //! They should set force to true.
@@ -141,7 +156,8 @@ private:
     //! The chunking part of the iostreams filter chain
     CChunkFilter m_FilterSink;
 
-    //! The iostreams filter chain that handles compression/chunking
+    //! The iostreams filter chain that handles encoding/chunking of data
+    //! which has already been compressed
     TFilteredOutputP m_OutFilter;
 
     TCompressOStreamP m_OutStream;
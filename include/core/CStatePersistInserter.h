@@ -44,7 +44,11 @@ public:
     }
 
     //! Store a floating point number with a given level of precision
-    void insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
+    //!
+    //! \note The default implementation stores the value as a string.
+    //! Formats which can store floating point values directly override
+    //! this.
+    virtual void insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
 
     //! Store a nested level of state, to be populated by the supplied
     //! function or function object
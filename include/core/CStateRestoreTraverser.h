@@ -8,6 +8,7 @@
 
 #include <core/CLogger.h>
 #include <core/CNonCopyable.h>
+#include <core/CStringUtils.h>
 
 #include <core/ImportExport.h>
 
@@ -35,7 +36,9 @@ namespace core {
 //! that the next() method returns false when the end of a particular
 //! sub-level is reached.
 //!
-//! All values are returned as strings.
+//! All values are available as strings.  Use typedValue() to convert
+//! them to other types, since formats which store some types natively
+//! can then skip formatting and parsing them.
 //!
 class CORE_EXPORT CStateRestoreTraverser : private CNonCopyable {
 public:
@@ -82,6 +85,17 @@ public:
     //! element
     virtual const std::string& value() const = 0;
 
+    //! Get the value of the current element as a double.
+    //!
+    //! \note The default implementation parses value().
+    virtual bool doubleValue(double& result) const;
+
+    //! Get the value of the current element converted to \p T.
+    template<typename T>
+    bool typedValue(T& result) const {
+        return CStringUtils::stringToType(this->value(), result);
+    }
+
     //! Has the end of the inputstream been reached?
     virtual bool isEof() const = 0;
 
@@ -128,6 +142,11 @@ private:
     //! Flag that should be set when the state document is unintelligible.
     bool m_BadState;
 };
+
+template<>
+inline bool CStateRestoreTraverser::typedValue(double& result) const {
+    return this->doubleValue(result);
+}
 }
 }
 
@@ -0,0 +1,92 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_core_CStaticThreadPool_h
+#define INCLUDED_ml_core_CStaticThreadPool_h
+
+#include <core/CNonCopyable.h>
+#include <core/ImportExport.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! A fixed size pool of threads which run tasks from a shared queue.
+//!
+//! DESCRIPTION:\n
+//! Unlike CThreadFarm, which gives every message to every processor, each
+//! task scheduled on this pool is run exactly once by whichever thread is
+//! free next.  This suits splitting a batch of independent pieces of work,
+//! for example per detector processing, across the available cores.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The threads are created in the constructor and joined in the destructor,
+//! so the cost of starting threads is not paid per batch of work.
+//!
+//! parallelForEach() uses the calling thread as well as the pool's threads
+//! and hands out indices dynamically, so a pool of size zero degenerates to
+//! a serial loop on the calling thread.  Callers that need deterministic
+//! output should write the result for index i to slot i of a preallocated
+//! container and combine the slots in order once the call returns.
+//!
+//! Tasks must not throw.
+//!
+class CORE_EXPORT CStaticThreadPool : private CNonCopyable {
+public:
+    using TTask = std::function<void()>;
+    using TSizeFunc = std::function<void(std::size_t)>;
+
+public:
+    //! Start \p size threads.
+    explicit CStaticThreadPool(std::size_t size);
+
+    //! Waits for all scheduled tasks to finish and joins the threads.
+    ~CStaticThreadPool();
+
+    //! Get the number of threads in the pool.
+    std::size_t size() const;
+
+    //! Add \p task to the queue to be run by the next free thread.
+    void schedule(TTask task);
+
+    //! Call \p f for every index in the range [0, \p n) and return when
+    //! all the calls have completed.
+    //!
+    //! \note \p f must be safe to call concurrently for distinct indices.
+    void parallelForEach(std::size_t n, const TSizeFunc& f);
+
+private:
+    //! The loop each thread runs.
+    void worker();
+
+private:
+    //! Protects the queue and the shutdown flag.
+    std::mutex m_Mutex;
+
+    //! Signalled when a task is added or the pool is shutting down.
+    std::condition_variable m_TaskAdded;
+
+    //! The tasks waiting to run.
+    std::deque<TTask> m_Tasks;
+
+    //! Set when the threads should exit once the queue is empty.
+    bool m_Done;
+
+    //! The threads.
+    std::vector<std::thread> m_Threads;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CStaticThreadPool_h
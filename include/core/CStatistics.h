@@ -83,6 +83,27 @@ enum EStatTypes {
     //! The number of times partial memory estimates have been carried out
     E_NumberMemoryUsageEstimates,
 
+    //! The number of times the refreshed memory usage of a model has been
+    //! verified against a full walk
+    E_NumberMemoryUsageVerifications,
+
+    //! The difference in bytes between the refreshed and walked memory
+    //! usage of the model verified most recently
+    E_MemoryUsageDrift,
+
+    //! The number of probabilities which were found in a cache
+    E_NumberProbabilityCacheHits,
+
+    //! The number of probabilities which could be cached but weren't found
+    E_NumberProbabilityCacheMisses,
+
+    //! The number of allocations served by the arena for bucket results
+    E_NumberResultsArenaAllocations,
+
+    //! The number of blocks the arena for bucket results obtained from
+    //! the heap
+    E_NumberResultsArenaHeapAllocations,
+
     // Add any new values here
 
     //! This MUST be last
@@ -32,6 +32,24 @@ namespace core {
 //! stored string pointers that are not managed by a string store.
 //!
 class CORE_EXPORT CStoredStringPtr {
+public:
+    //! \brief A reference to a stored string which doesn't keep it alive.
+    //!
+    //! DESCRIPTION:\n
+    //! This lets a string store cache stored strings without preventing
+    //! them being pruned: weak references don't count against isUnique.
+    class CORE_EXPORT CWeak {
+    public:
+        CWeak() noexcept = default;
+        explicit CWeak(const CStoredStringPtr& ptr) noexcept;
+
+        //! Get the string or a NULL pointer if it has been freed.
+        CStoredStringPtr lock() const noexcept;
+
+    private:
+        std::weak_ptr<const std::string> m_String;
+    };
+
 public:
     //! NULL constructor.
     CStoredStringPtr() noexcept;
@@ -90,6 +108,11 @@ private:
 private:
     using TStrCPtr = std::shared_ptr<const std::string>;
 
+private:
+    //! Used to lock weak references.
+    explicit CStoredStringPtr(TStrCPtr&& str) noexcept;
+
+private:
     //! The wrapped shared_ptr.
     TStrCPtr m_String;
 
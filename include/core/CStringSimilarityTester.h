@@ -14,9 +14,14 @@
 #include <boost/scoped_array.hpp>
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <stdlib.h>
 
@@ -50,6 +55,11 @@ namespace core {
 //! is only 4, because the "o" is already in the right
 //! place.
 //!
+//! For sequences of integer symbols, e.g. token IDs, there is
+//! also a bit-parallel implementation of the Levenshtein
+//! distance, due to Myers and Hyyro, which can stop as soon as
+//! the distance is known to exceed a specified maximum.
+//!
 //! IMPLEMENTATION DECISIONS:\n
 //! Produces symmetric results, i.e. if the similarity of
 //! string 1 to string 2 is 0.8, then the similarity of string 2
@@ -63,6 +73,12 @@ namespace core {
 //! The Levenshtein distance method CAN be used from multiple
 //! threads.
 //!
+//! The bit-parallel and weighted edit distances reuse working
+//! space held by the object, so they don't allocate memory once
+//! the object has seen sequences of a given length.  This also
+//! means a given object must not be used from multiple threads
+//! to calculate them.
+//!
 class CORE_EXPORT CStringSimilarityTester : private CNonCopyable {
 public:
     //! Used by the simple Levenshtein distance algorithm
@@ -72,6 +88,15 @@ public:
     using TScopedIntArray = boost::scoped_array<int>;
     using TScopedIntPArray = boost::scoped_array<int*>;
 
+    //! Used by the bit-parallel and weighted edit distances
+    using TSizeVec = std::vector<size_t>;
+    using TSizeSizePr = std::pair<size_t, size_t>;
+    using TSizeSizePrVec = std::vector<TSizeSizePr>;
+    using TUInt64Vec = std::vector<std::uint64_t>;
+
+    //! Passed to the edit distance calculations if there is no maximum
+    static const size_t NO_MAXIMUM_DISTANCE;
+
 public:
     CStringSimilarityTester();
 
@@ -185,6 +210,26 @@ public:
         return this->berghelRoachEditDistance(first, second);
     }
 
+    //! Calculate the Levenshtein distance between two sequences of integer
+    //! symbols, such as characters or token IDs, using the bit-parallel
+    //! algorithm described by Hyyro in "A Bit-Vector Algorithm for
+    //! Computing Levenshtein and Damerau Edit Distances", which is based
+    //! on Myers' algorithm.  The elements of the sequences can also be
+    //! pairs whose first element is the symbol, in which case the second
+    //! element is ignored.
+    //!
+    //! If the distance is greater than \p maxDistance the calculation
+    //! stops as soon as this is certain and some value greater than
+    //! \p maxDistance is returned.
+    template<typename SEQUENCE>
+    size_t bitParallelEditDistance(const SEQUENCE& first,
+                                   const SEQUENCE& second,
+                                   size_t maxDistance = NO_MAXIMUM_DISTANCE) const {
+        CStringSimilarityTester::symbols(first, m_FirstSymbols);
+        CStringSimilarityTester::symbols(second, m_SecondSymbols);
+        return this->symbolEditDistance(m_FirstSymbols, m_SecondSymbols, maxDistance);
+    }
+
     //! Calculate the weighted edit distance between two sequences.  Each
     //! element of each sequence has an associated weight, such that some
     //! elements can be considered more expensive to add/remove/replace than
@@ -199,10 +244,28 @@ public:
     //! matrix diagonals are not necessarily monotonically increasing.
     //! See http://www.cs.helsinki.fi/u/ukkonen/InfCont85.PDF
     //!
-    //! TODO - It may be possible to apply some of the lesser optimisations
-    //! from section 2 of Ukkonen's paper to this algorithm.
+    //! However, some of the lesser optimisations from section 2 of
+    //! Ukkonen's paper do apply if there's a maximum distance of interest,
+    //! see below.
     template<typename PAIRCONTAINER>
     size_t weightedEditDistance(const PAIRCONTAINER& first, const PAIRCONTAINER& second) const {
+        return this->weightedEditDistance(first, second, NO_MAXIMUM_DISTANCE);
+    }
+
+    //! As above, but if the distance is greater than \p maxDistance the
+    //! calculation stops as soon as this is certain and some value greater
+    //! than \p maxDistance is returned.
+    //!
+    //! Every operation costs at least the smallest weight, so only cells
+    //! of the distance matrix within a band around the diagonal need to be
+    //! calculated.  Also, if the first elements of the pairs are integers,
+    //! the Levenshtein distance times the smallest weight is a lower bound
+    //! for the weighted distance, and this can be calculated much faster
+    //! using bitParallelEditDistance().
+    template<typename PAIRCONTAINER>
+    size_t weightedEditDistance(const PAIRCONTAINER& first,
+                                const PAIRCONTAINER& second,
+                                size_t maxDistance) const {
         // This is similar to the levenshteinDistanceSimple() method below,
         // but adding the concept of different costs for each element.  If
         // you are trying to understand this method, you should first make
@@ -229,28 +292,77 @@ public:
             return cost;
         }
 
-        // We need to store two columns of the matrix, but allocate both in
-        // one go for efficiency.  Then the current and previous column
-        // pointers alternate between pointing and the first and second half
-        // of the memory block.
-        TScopedSizeArray data(new size_t[(secondLen + 1) * 2]);
-        size_t* currentCol(data.get());
+        // Cells further than this from the diagonal must exceed the maximum
+        // distance
+        size_t band(NO_MAXIMUM_DISTANCE);
+        if (maxDistance != NO_MAXIMUM_DISTANCE) {
+            size_t minWeight(NO_MAXIMUM_DISTANCE);
+            for (size_t index = 0; index < firstLen; ++index) {
+                minWeight = std::min(minWeight, first[index].second);
+            }
+            for (size_t index = 0; index < secondLen; ++index) {
+                minWeight = std::min(minWeight, second[index].second);
+            }
+            if (minWeight > 0) {
+                band = maxDistance / minWeight;
+                size_t lengthDifference(std::max(firstLen, secondLen) -
+                                        std::min(firstLen, secondLen));
+                if (lengthDifference > band) {
+                    return lengthDifference * minWeight;
+                }
+                using TSymbol = typename std::decay<decltype(first[0].first)>::type;
+                size_t distance(this->unitEditDistance(first, second, band,
+                                                       std::is_integral<TSymbol>()));
+                if (distance > band) {
+                    return distance * minWeight;
+                }
+            }
+        }
+
+        // We need to store two columns of the matrix, which share one block
+        // of memory that is reused between calls.  Then the current and
+        // previous column pointers alternate between pointing and the first
+        // and second half of the memory block.
+        if (m_Columns.size() < (secondLen + 1) * 2) {
+            m_Columns.resize((secondLen + 1) * 2);
+        }
+        size_t* currentCol(m_Columns.data());
         size_t* prevCol(currentCol + (secondLen + 1));
 
+        // Cells outside the band are treated as being infinitely far away.
+        // This is small enough that adding a weight to it can't overflow.
+        const size_t outside(NO_MAXIMUM_DISTANCE / 2);
+
         // Populate the left column
+        size_t hi(std::min(band, secondLen));
         currentCol[0] = 0;
-        for (size_t downMinusOne = 0; downMinusOne < secondLen; ++downMinusOne) {
+        for (size_t downMinusOne = 0; downMinusOne < hi; ++downMinusOne) {
             currentCol[downMinusOne + 1] = currentCol[downMinusOne] +
                                            second[downMinusOne].second;
         }
+        if (hi < secondLen) {
+            currentCol[hi + 1] = outside;
+        }
 
         // Calculate the other entries in the matrix
         for (size_t acrossMinusOne = 0; acrossMinusOne < firstLen; ++acrossMinusOne) {
             std::swap(currentCol, prevCol);
             size_t firstCost(first[acrossMinusOne].second);
-            currentCol[0] = prevCol[0] + firstCost;
 
-            for (size_t downMinusOne = 0; downMinusOne < secondLen; ++downMinusOne) {
+            // Only the rows [lo, hi] are in the band for this column
+            size_t lo(acrossMinusOne + 1 > band ? acrossMinusOne + 1 - band : 0);
+            hi = band >= secondLen ? secondLen : std::min(secondLen, acrossMinusOne + 1 + band);
+
+            size_t columnMin(outside);
+            if (lo == 0) {
+                currentCol[0] = prevCol[0] + firstCost;
+                columnMin = currentCol[0];
+                lo = 1;
+            } else {
+                currentCol[lo - 1] = outside;
+            }
+
+            for (size_t downMinusOne = lo - 1; downMinusOne < hi; ++downMinusOne) {
                 size_t secondCost(second[downMinusOne].second);
 
                 // There are 3 options, and due to the possible differences
@@ -277,6 +389,16 @@ public:
 
                 // Take the cheapest option of the 3
                 currentCol[downMinusOne + 1] = std::min(std::min(option1, option2), option3);
+                columnMin = std::min(columnMin, currentCol[downMinusOne + 1]);
+            }
+            if (hi < secondLen) {
+                currentCol[hi + 1] = outside;
+            }
+
+            // The distance can't be less than the smallest value in any
+            // column
+            if (columnMin > maxDistance) {
+                return columnMin;
             }
         }
 
@@ -434,6 +556,79 @@ private:
     //! calculating edit distance
     static int** setupBerghelRoachMatrix(int longLen, TScopedIntArray& data, TScopedIntPArray& matrix);
 
+    //! Calculate the Levenshtein distance between two sequences of symbols
+    //! using the bit-parallel algorithm, stopping early if it is certain to
+    //! exceed \p maxDistance.
+    size_t symbolEditDistance(const TSizeVec& first,
+                              const TSizeVec& second,
+                              size_t maxDistance) const;
+
+    //! Calculate the bit-parallel Levenshtein distance between sequences
+    //! of integer symbols.
+    template<typename SEQUENCE>
+    size_t unitEditDistance(const SEQUENCE& first,
+                            const SEQUENCE& second,
+                            size_t maxDistance,
+                            std::true_type /*integral*/) const {
+        return this->bitParallelEditDistance(first, second, maxDistance);
+    }
+
+    //! The bit-parallel algorithm can't be used for sequences of symbols
+    //! which aren't integers, so return the trivial lower bound.
+    template<typename SEQUENCE>
+    size_t unitEditDistance(const SEQUENCE& /*first*/,
+                            const SEQUENCE& /*second*/,
+                            size_t /*maxDistance*/,
+                            std::false_type /*integral*/) const {
+        return 0;
+    }
+
+    //! Calculate the Levenshtein distance between the pattern whose match
+    //! masks have been set up and \p text, where the pattern fits in a
+    //! single 64 bit word.
+    size_t singleWordEditDistance(size_t patternLen,
+                                  const TSizeVec& text,
+                                  size_t maxDistance) const;
+
+    //! Calculate the Levenshtein distance between the pattern whose match
+    //! masks have been set up and \p text, where the pattern is split over
+    //! several 64 bit words.
+    size_t blockedEditDistance(size_t patternLen,
+                               const TSizeVec& text,
+                               size_t maxDistance) const;
+
+    //! Set up the masks of the positions of each symbol in \p pattern.
+    void setupMatchMasks(const TSizeVec& pattern, size_t blocks) const;
+
+    //! Get the slot of the symbol table which contains \p symbol or the
+    //! empty slot where it would be inserted.
+    size_t symbolSlot(size_t symbol) const;
+
+    //! Get the row of the match masks for \p symbol, which is zero if the
+    //! pattern doesn't contain it.
+    size_t matchMasksRow(size_t symbol) const;
+
+    //! Copy the symbols of \p sequence to \p result.
+    template<typename SEQUENCE>
+    static void symbols(const SEQUENCE& sequence, TSizeVec& result) {
+        result.clear();
+        for (size_t index = 0; index < sequence.size(); ++index) {
+            result.push_back(CStringSimilarityTester::symbol(sequence[index]));
+        }
+    }
+
+    //! Get the symbol of an element which is an integer.
+    template<typename T>
+    static size_t symbol(const T& element) {
+        return static_cast<size_t>(element);
+    }
+
+    //! Get the symbol of an element which is a pair.
+    template<typename T, typename U>
+    static size_t symbol(const std::pair<T, U>& element) {
+        return CStringSimilarityTester::symbol(element.first);
+    }
+
 private:
     //! Required for initialisation of the Berghel-Roach matrix (don't call
     //! this MINUS_INFINITY because that can clash with 3rd party macros)
@@ -442,6 +637,32 @@ private:
     //! Used by the compression-based similarity measures
     mutable CCompressUtils m_Compressor;
 
+    //! The symbols of the first and second sequences passed to the
+    //! bit-parallel edit distance.
+    mutable TSizeVec m_FirstSymbols;
+    mutable TSizeVec m_SecondSymbols;
+
+    //! An open addressing hash table from the distinct symbols of the
+    //! pattern to their rows of the match masks.  Empty slots have row 0.
+    mutable TSizeSizePrVec m_SymbolTable;
+
+    //! The masks of the positions in the pattern of each distinct symbol,
+    //! one for each 64 bit block of the pattern.  Row 0 is for symbols
+    //! which aren't in the pattern.
+    mutable TUInt64Vec m_MatchMasks;
+
+    //! The positive and negative vertical differences of each block of
+    //! the current column of the distance matrix.
+    mutable TUInt64Vec m_PositiveDifferences;
+    mutable TUInt64Vec m_NegativeDifferences;
+
+    //! The values in the last row of each block of the current column of
+    //! the distance matrix.
+    mutable TSizeVec m_BlockScores;
+
+    //! The two columns of the matrix for the weighted edit distance.
+    mutable TSizeVec m_Columns;
+
     // For unit testing
     friend class ::CStringSimilarityTesterTest;
 };
@@ -74,7 +74,7 @@ public:
     template<size_t DEFAULT_EXTRA_WEIGHT>
     class CWeightAll {
     public:
-        size_t operator()(EPartOfSpeech partOfSpeech) {
+        size_t operator()(EPartOfSpeech partOfSpeech) const {
             return (partOfSpeech == E_NotInDictionary) ? 0 : DEFAULT_EXTRA_WEIGHT;
         }
     };
@@ -86,7 +86,7 @@ public:
     template<EPartOfSpeech SPECIAL_PART1, size_t EXTRA_WEIGHT1, size_t DEFAULT_EXTRA_WEIGHT>
     class CWeightOnePart {
     public:
-        size_t operator()(EPartOfSpeech partOfSpeech) {
+        size_t operator()(EPartOfSpeech partOfSpeech) const {
             if (partOfSpeech == E_NotInDictionary) {
                 return 0;
             }
@@ -101,7 +101,7 @@ public:
     template<EPartOfSpeech SPECIAL_PART1, size_t EXTRA_WEIGHT1, EPartOfSpeech SPECIAL_PART2, size_t EXTRA_WEIGHT2, size_t DEFAULT_EXTRA_WEIGHT>
     class CWeightTwoParts {
     public:
-        size_t operator()(EPartOfSpeech partOfSpeech) {
+        size_t operator()(EPartOfSpeech partOfSpeech) const {
             if (partOfSpeech == E_NotInDictionary) {
                 return 0;
             }
@@ -19,13 +19,13 @@ namespace core {
         continue;                                                                  \
     }
 
-#define RESTORE_BUILT_IN(tag, target)                                               \
-    if (name == tag) {                                                              \
-        if (core::CStringUtils::stringToType(traverser.value(), target) == false) { \
-            LOG_ERROR(<< "Failed to restore " #tag ", got " << traverser.value());  \
-            return false;                                                           \
-        }                                                                           \
-        continue;                                                                   \
+#define RESTORE_BUILT_IN(tag, target)                                              \
+    if (name == tag) {                                                             \
+        if (traverser.typedValue(target) == false) {                               \
+            LOG_ERROR(<< "Failed to restore " #tag ", got " << traverser.value()); \
+            return false;                                                          \
+        }                                                                          \
+        continue;                                                                  \
     }
 
 #define RESTORE_BOOL(tag, target)                                                  \
@@ -16,6 +16,7 @@
 
 #include <cstddef>
 #include <functional>
+#include <utility>
 #include <vector>
 
 namespace ml {
@@ -36,6 +37,16 @@ namespace maths {
 //! constructor. At the point it overflows, i.e. time since the
 //! beginning of the window exceeds "size" x "maximum bucket length",
 //! it will re-initialize the bucketing and update the start time.
+//!
+//! The bucket values can optionally be stored deflated. In this case
+//! added values are buffered and each full buffer is deflated on its own.
+//! The deflated buffers are only merged into the deflated bucket values,
+//! which means inflating and deflating the whole window, once they use a
+//! quarter of their memory or the window's bucketing changes. This trades
+//! some runtime for a reduction in memory when there are many windows,
+//! for example, in population analysis. Reading the values inflates them
+//! into a copy, so the const member functions never change the window and
+//! can be called from any thread while it isn't being updated.
 class MATHS_EXPORT CExpandingWindow {
 public:
     using TDoubleVec = std::vector<double>;
@@ -43,6 +54,9 @@ public:
     using TTimeCRng = core::CVectorRange<const TTimeVec>;
     using TFloatMeanAccumulator = CBasicStatistics::SSampleMean<CFloatStorage>::TAccumulator;
     using TFloatMeanAccumulatorVec = std::vector<TFloatMeanAccumulator>;
+    using TSizeFloatMeanAccumulatorPr = std::pair<std::size_t, TFloatMeanAccumulator>;
+    using TSizeFloatMeanAccumulatorPrVec = std::vector<TSizeFloatMeanAccumulatorPr>;
+    using TByteVec = std::vector<unsigned char>;
     using TPredictor = std::function<double(core_t::TTime)>;
 
 public:
@@ -57,6 +71,12 @@ public:
     //! Persist state by passing information to \p inserter.
     void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
 
+    //! Set whether to store the bucket values deflated.
+    void deflate(bool deflate);
+
+    //! Check if the bucket values are stored deflated.
+    bool deflated() const;
+
     //! Get the start time of the sketch.
     core_t::TTime startTime() const;
 
@@ -67,7 +87,7 @@ public:
     core_t::TTime bucketLength() const;
 
     //! Get the bucket values.
-    const TFloatMeanAccumulatorVec& values() const;
+    TFloatMeanAccumulatorVec values() const;
 
     //! Get the bucket values minus the values from \p trend.
     TFloatMeanAccumulatorVec valuesMinusPrediction(const TPredictor& predictor) const;
@@ -84,6 +104,10 @@ public:
     //! Check if we need to compress by increasing the bucket span.
     bool needToCompress(core_t::TTime time) const;
 
+    //! Check if adding a value at \p time would discard the values and
+    //! start the window again.
+    bool needToRestart(core_t::TTime time) const;
+
     //! Get a checksum for this object.
     uint64_t checksum(uint64_t seed = 0) const;
 
@@ -93,6 +117,22 @@ public:
     //! Get the memory used by this object.
     std::size_t memoryUsage() const;
 
+private:
+    //! Get the bucket values, including any buffered values, inflating
+    //! them into \p workspace if they're stored deflated.
+    const TFloatMeanAccumulatorVec& bucketValues(TFloatMeanAccumulatorVec& workspace) const;
+
+    //! Inflate the bucket values and apply any buffered values.
+    void inflateBucketValues();
+
+    //! Deflate the bucket values if they're stored deflated.
+    void deflateBucketValues();
+
+    //! Deflate the full buffer of values added since the bucket values
+    //! were last inflated, or merge it into the bucket values if the
+    //! deflated buffers have grown too large.
+    void deflateBufferedValues();
+
 private:
     //! The rate at which the bucket values are aged.
     double m_DecayRate;
@@ -109,9 +149,25 @@ private:
     //! The time of the first data point.
     core_t::TTime m_StartTime;
 
-    //! The bucket values.
+    //! The number of buckets.
+    std::size_t m_Size;
+
+    //! True if the bucket values are stored deflated.
+    bool m_Deflate;
+
+    //! The bucket values, which are empty if they're stored deflated.
     TFloatMeanAccumulatorVec m_BucketValues;
 
+    //! The deflated bucket values.
+    TByteVec m_DeflatedBucketValues;
+
+    //! The buffers of values added since the bucket values were last
+    //! inflated which have been deflated, each prefixed by its length.
+    TByteVec m_DeflatedBufferedValues;
+
+    //! The values added since the last buffer was deflated.
+    TSizeFloatMeanAccumulatorPrVec m_BufferedValues;
+
     //! The mean value time modulo the data bucketing length.
     TFloatMeanAccumulator m_MeanOffset;
 };
@@ -85,6 +85,16 @@ public:
         TenDimensions = 10
     };
 
+public:
+    //! \brief Compile time tables of the Gauss-Legendre weights and abscissas
+    //! for each order of quadrature.
+    //!
+    //! DESCRIPTION:\n
+    //! Each specialization defines static arrays WEIGHTS and ABSCISSAS with
+    //! ORDER entries for the interval [-1, 1].
+    template<EOrder ORDER>
+    class CGaussLegendreNodes;
+
 public:
     //! Gauss-Legendre quadrature.
     //!
@@ -107,8 +117,8 @@ public:
     static bool gaussLegendre(const F& function, double a, double b, T& result) {
         result = T();
 
-        const double* weights = CGaussLegendreQuadrature::weights(ORDER);
-        const double* abscissas = CGaussLegendreQuadrature::abscissas(ORDER);
+        const double* weights = CGaussLegendreNodes<ORDER>::WEIGHTS;
+        const double* abscissas = CGaussLegendreNodes<ORDER>::ABSCISSAS;
 
         // Evaluate f(x) at the abscissas and compute the weighted sum
         // of the quadrature.
@@ -167,8 +177,8 @@ public:
         fIntegral = U();
         gIntegral = V();
 
-        const double* weights = CGaussLegendreQuadrature::weights(ORDER);
-        const double* abscissas = CGaussLegendreQuadrature::abscissas(ORDER);
+        const double* weights = CGaussLegendreNodes<ORDER>::WEIGHTS;
+        const double* abscissas = CGaussLegendreNodes<ORDER>::ABSCISSAS;
 
         // Evaluate f(x) at the abscissas and compute the weighted sum
         // of the quadrature.
@@ -223,8 +233,8 @@ public:
             std::swap(a, b);
         }
 
-        const double* weights = CGaussLegendreQuadrature::weights(ORDER);
-        const double* abscissas = CGaussLegendreQuadrature::abscissas(ORDER);
+        const double* weights = CGaussLegendreNodes<ORDER>::WEIGHTS;
+        const double* abscissas = CGaussLegendreNodes<ORDER>::ABSCISSAS;
 
         double fx[ORDER] = {0.0};
 
@@ -237,18 +247,123 @@ public:
             }
         }
 
-        // Re-normalize and then take exponentials to avoid underflow.
-        double fmax = *std::max_element(fx, fx + ORDER);
-        for (unsigned int i = 0; i < ORDER; ++i) {
-            fx[i] = std::exp(fx[i] - fmax);
+        result = logQuadrature(weights, fx, ORDER, range);
+
+        return true;
+    }
+
+    //! Batched Gauss-Legendre quadrature.
+    //!
+    //! This is equivalent to gaussLegendre except that \p function is
+    //! evaluated at all the abscissas of the interval [\p a, \p b] in
+    //! a single call. This lets the integrand share work between the
+    //! abscissas and evaluate them in a tight loop.
+    //!
+    //! \param[in] function The function to integrate.
+    //! \param[in] a The start of the integration interval.
+    //! \param[in] b The end of the integration interval.
+    //! \param[out] result Filled with the integral of \p function over [\p a, \p b].
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double *x, std::size_t n, double *f)
+    //! where f is filled in with the values of the function at the \p n
+    //! points x and returning false means that the function could not be
+    //! evaluated.
+    template<EOrder ORDER, typename F>
+    static bool gaussLegendreBatch(const F& function, double a, double b, double& result) {
+        result = 0.0;
+
+        double x[ORDER];
+        double fx[ORDER];
+        abscissasBatch<ORDER>(a, b, x);
+        if (!function(static_cast<const double*>(x), static_cast<std::size_t>(ORDER), fx)) {
+            return false;
         }
 
-        // Quadrature.
         for (unsigned int i = 0; i < ORDER; ++i) {
-            result += weights[i] * fx[i];
+            result += CGaussLegendreNodes<ORDER>::WEIGHTS[i] * fx[i];
+        }
+        result *= (b - a) / 2.0;
+
+        return true;
+    }
+
+    //! Batched Gauss-Legendre quadrature over several intervals.
+    //!
+    //! This integrates \p function over each of \p intervals evaluating
+    //! it at all the abscissas of all the intervals in a single call. The
+    //! abscissas of the j'th interval are the ORDER points starting at
+    //! j * ORDER.
+    //!
+    //! \param[in] function The function to integrate.
+    //! \param[in] intervals The intervals over which to integrate.
+    //! \param[out] results Filled with the integral of \p function over
+    //! each interval in \p intervals.
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double *x, std::size_t n, double *f)
+    //! \see gaussLegendreBatch for details.
+    template<EOrder ORDER, typename F>
+    static bool gaussLegendreBatch(const F& function,
+                                   const TDoubleDoublePrVec& intervals,
+                                   TDoubleVec& results) {
+        results.assign(intervals.size(), 0.0);
+
+        std::size_t n = ORDER * intervals.size();
+        TDoubleVec x(n);
+        TDoubleVec fx(n);
+        for (std::size_t i = 0u; i < intervals.size(); ++i) {
+            abscissasBatch<ORDER>(intervals[i].first, intervals[i].second, &x[ORDER * i]);
+        }
+        if (!function(static_cast<const double*>(x.data()), n, fx.data())) {
+            return false;
+        }
+
+        for (std::size_t i = 0u; i < intervals.size(); ++i) {
+            const double* fi = &fx[ORDER * i];
+            for (unsigned int j = 0; j < ORDER; ++j) {
+                results[i] += CGaussLegendreNodes<ORDER>::WEIGHTS[j] * fi[j];
+            }
+            results[i] *= (intervals[i].second - intervals[i].first) / 2.0;
         }
-        result *= range;
-        result = result <= 0.0 ? core::constants::LOG_MIN_DOUBLE : fmax + std::log(result);
+
+        return true;
+    }
+
+    //! Batched Gauss-Legendre quadrature using logarithms.
+    //!
+    //! This is equivalent to logGaussLegendre except that the log of
+    //! \p function is evaluated at all the abscissas of the interval
+    //! [\p a, \p b] in a single call.
+    //!
+    //! \param[in] function The log of the function to integrate.
+    //! \param[in] a The start of the integration interval.
+    //! \param[in] b The end of the integration interval.
+    //! \param[out] result Filled with the log of the integral of \p function
+    //! over [\p a, \p b].
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double *x, std::size_t n, double *f)
+    //! \see gaussLegendreBatch for details.
+    template<EOrder ORDER, typename F>
+    static bool logGaussLegendreBatch(const F& function, double a, double b, double& result) {
+        result = 0.0;
+
+        if (b <= a) {
+            std::swap(a, b);
+        }
+
+        double x[ORDER];
+        double fx[ORDER];
+        abscissasBatch<ORDER>(a, b, x);
+        if (!function(static_cast<const double*>(x), static_cast<std::size_t>(ORDER), fx)) {
+            return false;
+        }
+
+        result = logQuadrature(CGaussLegendreNodes<ORDER>::WEIGHTS, fx, ORDER, (b - a) / 2.0);
 
         return true;
     }
@@ -430,6 +545,10 @@ public:
         //! The sparse grid point points.
         const TVectorVec& points() const { return m_Points; }
 
+        //! The coordinates of the sparse grid points stored contiguously,
+        //! i.e. point i occupies [i * DIMENSION, (i + 1) * DIMENSION).
+        const TDoubleVec& coordinates() const { return m_Coordinates; }
+
     private:
         using TUIntVec = std::vector<unsigned int>;
 
@@ -515,9 +634,13 @@ public:
 
             m_Weights.reserve(ordered.size());
             m_Points.reserve(ordered.size());
+            m_Coordinates.reserve(DIMENSION * ordered.size());
             for (const auto& i : ordered) {
                 m_Weights.push_back(i.second);
                 m_Points.push_back(i.first);
+                for (std::size_t j = 0u; j < DIMENSION; ++j) {
+                    m_Coordinates.push_back(i.first(j));
+                }
             }
         }
 
@@ -525,6 +648,7 @@ public:
 
         TDoubleVec m_Weights;
         TVectorVec m_Points;
+        TDoubleVec m_Coordinates;
     };
 
     //! Sparse grid Gauss-Legendre quadrature.
@@ -594,54 +718,113 @@ public:
         return true;
     }
 
-private:
-    //! \brief Definitions of the weights and abscissas for different orders
-    //! of Gauss-Legendre quadrature.
-    class MATHS_EXPORT CGaussLegendreQuadrature {
-    public:
-        static const double* weights(EOrder order);
-        static const double* abscissas(EOrder order);
+    //! Batched sparse grid Gauss-Legendre quadrature.
+    //!
+    //! This is equivalent to sparseGaussLegendre except that \p function
+    //! is evaluated at all the sparse grid points in a single call.
+    //!
+    //! \param[in] function The function to integrate.
+    //! \param[in] a The lower integration limits.
+    //! \param[in] b The upper integration limits.
+    //! \param[out] result Filled with the integral of \p function over [\p a, \p b].
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam DIMENSION The number of dimensions.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double *x, std::size_t n, double *f)
+    //! where x holds the DIMENSION coordinates of each of the \p n points
+    //! contiguously and f is filled in with the values of the function at
+    //! the points. Returning false means that the function could not be
+    //! evaluated.
+    template<EOrder ORDER, EDimension DIMENSION, typename F>
+    static bool sparseGaussLegendreBatch(const F& function,
+                                         const TDoubleVec& a,
+                                         const TDoubleVec& b,
+                                         double& result) {
+        using TSparseQuadrature = CSparseGaussLegendreQuadrature<ORDER, DIMENSION>;
 
-    private:
-        //! Order one.
-        static const double WEIGHTS1[1];
-        static const double ABSCISSAS1[1];
+        result = 0.0;
 
-        //! Order two.
-        static const double WEIGHTS2[2];
-        static const double ABSCISSAS2[2];
+        if (a.size() != static_cast<std::size_t>(DIMENSION)) {
+            LOG_ERROR(<< "Bad lower limits: " << core::CContainerPrinter::print(a));
+            return false;
+        }
+        if (b.size() != static_cast<std::size_t>(DIMENSION)) {
+            LOG_ERROR(<< "Bad upper limits: " << core::CContainerPrinter::print(b));
+            return false;
+        }
 
-        //! Order three.
-        static const double WEIGHTS3[3];
-        static const double ABSCISSAS3[3];
+        const TDoubleVec& weights = TSparseQuadrature::instance().weights();
+        const TDoubleVec& coordinates = TSparseQuadrature::instance().coordinates();
 
-        //! Order four.
-        static const double WEIGHTS4[4];
-        static const double ABSCISSAS4[4];
+        double centre[DIMENSION];
+        double range[DIMENSION];
+        for (std::size_t i = 0u; i < DIMENSION; ++i) {
+            centre[i] = (a[i] + b[i]) / 2.0;
+            range[i] = (b[i] - a[i]) / 2.0;
+        }
 
-        //! Order five.
-        static const double WEIGHTS5[5];
-        static const double ABSCISSAS5[5];
+        std::size_t n = weights.size();
+        TDoubleVec x(coordinates.size());
+        TDoubleVec fx(n);
+        for (std::size_t i = 0u; i < x.size(); i += DIMENSION) {
+            for (std::size_t j = 0u; j < DIMENSION; ++j) {
+                x[i + j] = centre[j] + range[j] * coordinates[i + j];
+            }
+        }
+        if (!function(static_cast<const double*>(x.data()), n, fx.data())) {
+            return false;
+        }
+
+        for (std::size_t i = 0u; i < n; ++i) {
+            result += weights[i] * fx[i];
+        }
+        for (std::size_t i = 0u; i < DIMENSION; ++i) {
+            result *= range[i];
+        }
 
-        //! Order six.
-        static const double WEIGHTS6[6];
-        static const double ABSCISSAS6[6];
+        return true;
+    }
 
-        //! Order seven.
-        static const double WEIGHTS7[7];
-        static const double ABSCISSAS7[7];
+private:
+    //! Fill in the abscissas of ORDER quadrature on the interval [\p a, \p b].
+    template<EOrder ORDER>
+    static void abscissasBatch(double a, double b, double* x) {
+        double centre = (a + b) / 2.0;
+        double range = (b - a) / 2.0;
+        for (unsigned int i = 0; i < ORDER; ++i) {
+            x[i] = centre + range * CGaussLegendreNodes<ORDER>::ABSCISSAS[i];
+        }
+    }
 
-        //! Order eight.
-        static const double WEIGHTS8[8];
-        static const double ABSCISSAS8[8];
+    //! Compute the log of the quadrature with \p weights of the function
+    //! whose logs at the abscissas are \p fx.
+    //!
+    //! \note This overwrites \p fx.
+    static double
+    logQuadrature(const double* weights, double* fx, unsigned int order, double range) {
+        // Re-normalize and then take exponentials to avoid underflow.
+        double fmax = *std::max_element(fx, fx + order);
+        for (unsigned int i = 0; i < order; ++i) {
+            fx[i] = std::exp(fx[i] - fmax);
+        }
 
-        //! Order nine.
-        static const double WEIGHTS9[9];
-        static const double ABSCISSAS9[9];
+        // Quadrature.
+        double result = 0.0;
+        for (unsigned int i = 0; i < order; ++i) {
+            result += weights[i] * fx[i];
+        }
+        result *= range;
+        return result <= 0.0 ? core::constants::LOG_MIN_DOUBLE : fmax + std::log(result);
+    }
 
-        //! Order ten.
-        static const double WEIGHTS10[10];
-        static const double ABSCISSAS10[10];
+private:
+    //! \brief Definitions of the weights and abscissas for different orders
+    //! of Gauss-Legendre quadrature.
+    class MATHS_EXPORT CGaussLegendreQuadrature {
+    public:
+        static const double* weights(EOrder order);
+        static const double* abscissas(EOrder order);
     };
 
 private:
@@ -652,6 +835,115 @@ private:
     static core::CFastMutex ms_Mutex;
 };
 
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderOne> {
+public:
+    static constexpr double WEIGHTS[1]{2.0};
+    static constexpr double ABSCISSAS[1]{0.0};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderTwo> {
+public:
+    static constexpr double WEIGHTS[2]{1.0, 1.0};
+    static constexpr double ABSCISSAS[2]{-0.5773502691896257, 0.5773502691896257};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderThree> {
+public:
+    static constexpr double WEIGHTS[3]{0.8888888888888888, 0.5555555555555556, 0.5555555555555556};
+    static constexpr double ABSCISSAS[3]{
+        0.0000000000000000, -0.7745966692414834, 0.7745966692414834};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderFour> {
+public:
+    static constexpr double WEIGHTS[4]{
+        0.6521451548625461, 0.6521451548625461, 0.3478548451374538,
+        0.3478548451374538};
+    static constexpr double ABSCISSAS[4]{
+        -0.3399810435848563, 0.3399810435848563, -0.8611363115940526,
+        0.8611363115940526};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderFive> {
+public:
+    static constexpr double WEIGHTS[5]{
+        0.5688888888888889, 0.4786286704993665, 0.4786286704993665,
+        0.2369268850561891, 0.2369268850561891};
+    static constexpr double ABSCISSAS[5]{
+        0.0000000000000000, -0.5384693101056831, 0.5384693101056831,
+        -0.9061798459386640, 0.9061798459386640};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderSix> {
+public:
+    static constexpr double WEIGHTS[6]{
+        0.3607615730481386, 0.3607615730481386, 0.4679139345726910,
+        0.4679139345726910, 0.1713244923791704, 0.1713244923791704};
+    static constexpr double ABSCISSAS[6]{
+        0.6612093864662645, -0.6612093864662645, -0.2386191860831969,
+        0.2386191860831969, -0.9324695142031521, 0.9324695142031521};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderSeven> {
+public:
+    static constexpr double WEIGHTS[7]{
+        0.4179591836734694, 0.3818300505051189, 0.3818300505051189,
+        0.2797053914892766, 0.2797053914892766, 0.1294849661688697,
+        0.1294849661688697};
+    static constexpr double ABSCISSAS[7]{
+        0.0000000000000000, 0.4058451513773972, -0.4058451513773972,
+        -0.7415311855993945, 0.7415311855993945, -0.9491079123427585,
+        0.9491079123427585};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderEight> {
+public:
+    static constexpr double WEIGHTS[8]{
+        0.3626837833783620, 0.3626837833783620, 0.3137066458778873,
+        0.3137066458778873, 0.2223810344533745, 0.2223810344533745,
+        0.1012285362903763, 0.1012285362903763};
+    static constexpr double ABSCISSAS[8]{
+        -0.1834346424956498, 0.1834346424956498, -0.5255324099163290,
+        0.5255324099163290, -0.7966664774136267, 0.7966664774136267,
+        -0.9602898564975363, 0.9602898564975363};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderNine> {
+public:
+    static constexpr double WEIGHTS[9]{
+        0.3302393550012598, 0.1806481606948574, 0.1806481606948574,
+        0.0812743883615744, 0.0812743883615744, 0.3123470770400029,
+        0.3123470770400029, 0.2606106964029354, 0.2606106964029354};
+    static constexpr double ABSCISSAS[9]{
+        0.0000000000000000, -0.8360311073266358, 0.8360311073266358,
+        -0.9681602395076261, 0.9681602395076261, -0.3242534234038089,
+        0.3242534234038089, -0.6133714327005904, 0.6133714327005904};
+};
+
+template<>
+class MATHS_EXPORT CIntegration::CGaussLegendreNodes<CIntegration::OrderTen> {
+public:
+    static constexpr double WEIGHTS[10]{
+        0.2955242247147529, 0.2955242247147529, 0.2692667193099963,
+        0.2692667193099963, 0.2190863625159820, 0.2190863625159820,
+        0.1494513491505806, 0.1494513491505806, 0.0666713443086881,
+        0.0666713443086881};
+    static constexpr double ABSCISSAS[10]{
+        -0.1488743389816312, 0.1488743389816312, -0.4333953941292472,
+        0.4333953941292472, -0.6794095682990244, 0.6794095682990244,
+        -0.8650633666889845, 0.8650633666889845, -0.9739065285171717,
+        0.9739065285171717};
+};
+
 template<CIntegration::EOrder O, CIntegration::EDimension D>
 std::atomic<const CIntegration::CSparseGaussLegendreQuadrature<O, D>*>
     CIntegration::CSparseGaussLegendreQuadrature<O, D>::ms_Instance;
@@ -52,6 +52,7 @@ public:
     static bool dynamicSizeAlwaysZero() { return true; }
 
     using TEqualWithTolerance = CEqualWithTolerance<double>;
+    using TLogNormalCPtrVec = std::vector<const CLogNormalMeanPrecConjugate*>;
 
     //! Lift the overloads of addSamples into scope.
     using CPrior::addSamples;
@@ -321,6 +322,35 @@ public:
     virtual void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
     //@}
 
+    //! \name Batch Evaluation
+    //!
+    //! Overloads of the CPrior batch functions for collections of log-normal
+    //! priors. These gather the samples for which the calculation has a
+    //! simple closed form into contiguous arrays and evaluate them with
+    //! vectorised kernels. All other samples are evaluated by the member
+    //! functions.
+    //@{
+    //! \see CPrior::batchProbabilityOfLessLikelySamples.
+    static bool batchProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                    const TLogNormalCPtrVec& priors,
+                                                    const SSampleBatch& samples,
+                                                    TDoubleVec& lowerBounds,
+                                                    TDoubleVec& upperBounds,
+                                                    TTailVec& tails);
+
+    //! \see CPrior::batchMinusLogJointCdf.
+    static bool batchMinusLogJointCdf(const TLogNormalCPtrVec& priors,
+                                      const SSampleBatch& samples,
+                                      TDoubleVec& lowerBounds,
+                                      TDoubleVec& upperBounds);
+
+    //! \see CPrior::batchJointLogMarginalLikelihood.
+    static maths_t::EFloatingPointErrorStatus
+    batchJointLogMarginalLikelihood(const TLogNormalCPtrVec& priors,
+                                    const SSampleBatch& samples,
+                                    TDoubleVec& results);
+    //@}
+
     //! Get the current expected mean for the exponentiated normal.
     //!
     //! \note This is not to be confused with the mean of the variable itself
@@ -370,6 +400,16 @@ private:
     //! Check that the state is valid.
     bool isBad() const;
 
+    //! If the marginal likelihood of the \p i'th sample of \p samples is
+    //! well approximated by a log-normal distribution append the sample
+    //! and the distribution's location and scale to \p x, \p locations
+    //! and \p scales, respectively.
+    bool gatherLogNormalApproximation(const SSampleBatch& samples,
+                                      std::size_t i,
+                                      TDoubleVec& x,
+                                      TDoubleVec& locations,
+                                      TDoubleVec& scales) const;
+
     //! Full debug dump of the state of this prior.
     virtual std::string debug() const;
 
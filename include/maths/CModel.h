@@ -18,6 +18,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 namespace ml {
 namespace core {
@@ -42,6 +43,9 @@ using TForecastPushDatapointFunc = std::function<void(SErrorBar)>;
 
 //! \brief Model parameters.
 class MATHS_EXPORT CModelParams {
+public:
+    using TPriorCPtr = std::shared_ptr<const CPrior>;
+
 public:
     CModelParams(core_t::TTime bucketLength,
                  const double& learnRate,
@@ -69,6 +73,16 @@ public:
     //! Get the probability that the bucket will be empty for the model.
     double probabilityBucketEmpty() const;
 
+    //! Set the residual model to which compact residual models are
+    //! promoted when structure is detected in the time series.
+    //!
+    //! \note Residual models are only compacted if this is set.
+    void residualModelPrototype(const TPriorCPtr& prototype);
+
+    //! Get the residual model to which compact residual models are
+    //! promoted, if any.
+    const TPriorCPtr& residualModelPrototype() const;
+
 private:
     //! The data bucketing length.
     core_t::TTime m_BucketLength;
@@ -80,6 +94,8 @@ private:
     double m_MinimumSeasonalVarianceScale;
     //! The probability that a bucket will be empty for the model.
     double m_ProbabilityBucketEmpty;
+    //! The full residual model shared by all models with these parameters.
+    TPriorCPtr m_ResidualModelPrototype;
 };
 
 //! \brief The extra parameters needed by CModel::addSamples.
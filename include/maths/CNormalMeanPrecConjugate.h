@@ -51,6 +51,7 @@ public:
 
     using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
     using TEqualWithTolerance = CEqualWithTolerance<double>;
+    using TNormalCPtrVec = std::vector<const CNormalMeanPrecConjugate*>;
 
     //! Lift the overloads of addSamples into scope.
     using CPrior::addSamples;
@@ -288,6 +289,35 @@ public:
     virtual void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
     //@}
 
+    //! \name Batch Evaluation
+    //!
+    //! Overloads of the CPrior batch functions for collections of normal
+    //! priors. These gather the samples for which the calculation has a
+    //! simple closed form into contiguous arrays and evaluate them with
+    //! vectorised kernels. All other samples are evaluated by the member
+    //! functions.
+    //@{
+    //! \see CPrior::batchProbabilityOfLessLikelySamples.
+    static bool batchProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                    const TNormalCPtrVec& priors,
+                                                    const SSampleBatch& samples,
+                                                    TDoubleVec& lowerBounds,
+                                                    TDoubleVec& upperBounds,
+                                                    TTailVec& tails);
+
+    //! \see CPrior::batchMinusLogJointCdf.
+    static bool batchMinusLogJointCdf(const TNormalCPtrVec& priors,
+                                      const SSampleBatch& samples,
+                                      TDoubleVec& lowerBounds,
+                                      TDoubleVec& upperBounds);
+
+    //! \see CPrior::batchJointLogMarginalLikelihood.
+    static maths_t::EFloatingPointErrorStatus
+    batchJointLogMarginalLikelihood(const TNormalCPtrVec& priors,
+                                    const SSampleBatch& samples,
+                                    TDoubleVec& results);
+    //@}
+
     //! The current expected mean for the variable.
     double mean() const;
 
@@ -313,6 +343,16 @@ private:
     //! Read parameters from \p traverser.
     bool acceptRestoreTraverser(core::CStateRestoreTraverser& traverser);
 
+    //! If the marginal likelihood of the \p i'th sample of \p samples is
+    //! well approximated by a normal distribution append the sample and
+    //! the distribution's mean and deviation to \p x, \p means and
+    //! \p deviations, respectively.
+    bool gatherNormalApproximation(const SSampleBatch& samples,
+                                   std::size_t i,
+                                   TDoubleVec& x,
+                                   TDoubleVec& means,
+                                   TDoubleVec& deviations) const;
+
     //! Check that the state is valid.
     bool isBad() const;
 
@@ -127,6 +127,14 @@ public:
     //! Remove models marked by \p filter.
     virtual void removeModels(CModelFilter& filter);
 
+    //! Remove the models which participate in model selection and whose
+    //! normalized weight is less than \p minimumWeight.
+    //!
+    //! \return True if any models were removed.
+    //! \note The model with the largest weight is kept provided
+    //! \p minimumWeight is at most one over the number of models.
+    bool removeModelsWithWeightLessThan(double minimumWeight);
+
     //! Check if any of the models needs an offset to be applied.
     virtual bool needsOffset() const;
 
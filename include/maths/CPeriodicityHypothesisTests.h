@@ -12,6 +12,7 @@
 #include <core/CoreTypes.h>
 
 #include <maths/CBasicStatistics.h>
+#include <maths/CSignal.h>
 #include <maths/ImportExport.h>
 
 #include <boost/operators.hpp>
@@ -418,6 +419,16 @@ testForPeriods(const CPeriodicityHypothesisTestsConfig& config,
                core_t::TTime startTime,
                core_t::TTime bucketLength,
                const TFloatMeanAccumulatorVec& values);
+
+//! Test for periodic components in \p values reusing \p workspace to
+//! search for candidate periods.
+MATHS_EXPORT
+CPeriodicityHypothesisTestsResult
+testForPeriods(const CPeriodicityHypothesisTestsConfig& config,
+               core_t::TTime startTime,
+               core_t::TTime bucketLength,
+               const TFloatMeanAccumulatorVec& values,
+               CSignal::CFftWorkspace& workspace);
 }
 }
 
@@ -0,0 +1,168 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_maths_CPeriodicityTestScheduler_h
+#define INCLUDED_ml_maths_CPeriodicityTestScheduler_h
+
+#include <core/CFastMutex.h>
+#include <core/CNonCopyable.h>
+#include <core/CoreTypes.h>
+
+#include <maths/CBasicStatistics.h>
+#include <maths/CPeriodicityHypothesisTests.h>
+#include <maths/ImportExport.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ml {
+namespace core {
+class CStaticThreadPool;
+}
+namespace maths {
+
+//! \brief Runs the periodicity tests of many time series in batches.
+//!
+//! DESCRIPTION:\n
+//! In jobs with many time series which are bucketed on the same grid
+//! the periodicity test windows of every series fill at the same time
+//! and so all the series test for periodic components in the same
+//! bucket. Rather than testing when the test is due, a time series
+//! decomposition which has a scheduler schedules its test and collects
+//! the result the next time it is updated after the test has run.
+//!
+//! The owner calls runTests() once per bucket, after all the time series
+//! have been updated. This runs the tests which are due, sorted so that
+//! tests on the same bucket grid run together, over a thread pool.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! To flatten the spike in CPU when many tests become due together each
+//! test is delayed by between zero and spread - 1 calls to runTests().
+//! The delay is a hash of the values tested, so the results, and when
+//! they're collected, don't depend on the order in which the tests are
+//! scheduled or the number of threads which run them.
+//!
+//! The hypotheses tested depend on the values, so the state which can
+//! be shared between tests on the same grid is the FFT plan and scratch
+//! memory used to find candidate periods. Each batch of tests reuses one
+//! workspace.
+//!
+//! A test whose handle has been released by the caller before it is due
+//! is discarded without running it.
+class MATHS_EXPORT CPeriodicityTestScheduler : private core::CNonCopyable {
+public:
+    using TFloatMeanAccumulator = CBasicStatistics::SSampleMean<CFloatStorage>::TAccumulator;
+    using TFloatMeanAccumulatorVec = std::vector<TFloatMeanAccumulator>;
+
+    //! \brief A scheduled periodicity test.
+    class MATHS_EXPORT CTest : private core::CNonCopyable {
+    public:
+        CTest(const CPeriodicityHypothesisTestsConfig& config,
+              core_t::TTime startTime,
+              core_t::TTime bucketLength,
+              TFloatMeanAccumulatorVec values,
+              std::uint64_t due);
+
+        //! Check if the test has run.
+        bool complete() const;
+
+        //! Get the test result.
+        //!
+        //! \note This is empty until the test is complete.
+        const CPeriodicityHypothesisTestsResult& result() const;
+
+    private:
+        //! The test configuration.
+        CPeriodicityHypothesisTestsConfig m_Config;
+        //! The start time of the values.
+        core_t::TTime m_StartTime;
+        //! The bucket length of the values.
+        core_t::TTime m_BucketLength;
+        //! The values to test.
+        TFloatMeanAccumulatorVec m_Values;
+        //! The call to runTests() in which the test is due.
+        std::uint64_t m_Due;
+        //! The test result.
+        CPeriodicityHypothesisTestsResult m_Result;
+        //! Set when the result is available.
+        std::atomic<bool> m_Complete;
+
+        friend class CPeriodicityTestScheduler;
+    };
+
+    using TTestPtr = std::shared_ptr<CTest>;
+
+    //! \brief Summary statistics for the time taken to run tests.
+    struct MATHS_EXPORT STimings {
+        //! The number of tests run.
+        std::uint64_t s_NumberTests{0};
+        //! The number of tests which were discarded.
+        std::uint64_t s_NumberDiscarded{0};
+        //! The mean time taken to run a test in microseconds.
+        double s_MeanTestTime{0.0};
+        //! The maximum time taken to run a test in microseconds.
+        double s_MaxTestTime{0.0};
+        //! The number of tests run in the last call to runTests().
+        std::size_t s_LastNumberTests{0};
+        //! The elapsed time of the last call to runTests() in microseconds.
+        double s_LastRunTime{0.0};
+    };
+
+public:
+    //! \param[in] spread The number of calls to runTests() over which
+    //! to spread tests which become due at the same time.
+    explicit CPeriodicityTestScheduler(std::size_t spread = 1);
+
+    //! Schedule a test for periodic components in \p values.
+    //!
+    //! \note This is thread safe.
+    TTestPtr schedule(const CPeriodicityHypothesisTestsConfig& config,
+                      core_t::TTime startTime,
+                      core_t::TTime bucketLength,
+                      TFloatMeanAccumulatorVec values);
+
+    //! Run the tests which are due using \p pool if it is supplied.
+    void runTests(core::CStaticThreadPool* pool = nullptr);
+
+    //! Get the number of tests waiting to run.
+    std::size_t numberPending() const;
+
+    //! Get statistics for the time taken to run tests.
+    STimings timings() const;
+
+private:
+    using TDoubleVec = std::vector<double>;
+    using TTestPtrVec = std::vector<TTestPtr>;
+    using TMeanAccumulator = CBasicStatistics::SSampleMean<double>::TAccumulator;
+    using TMaxAccumulator = CBasicStatistics::SMax<double>::TAccumulator;
+
+private:
+    //! The number of calls to runTests() over which tests are spread.
+    std::size_t m_Spread;
+    //! The number of calls to runTests().
+    std::uint64_t m_Runs;
+    //! Protects the pending tests and statistics.
+    mutable core::CFastMutex m_Mutex;
+    //! The tests waiting to run.
+    TTestPtrVec m_Pending;
+    //! The number of tests discarded.
+    std::uint64_t m_NumberDiscarded;
+    //! The mean test time.
+    TMeanAccumulator m_MeanTestTime;
+    //! The maximum test time.
+    TMaxAccumulator m_MaxTestTime;
+    //! The number of tests run in the last call to runTests().
+    std::size_t m_LastNumberTests;
+    //! The elapsed time of the last call to runTests().
+    double m_LastRunTime;
+};
+}
+}
+
+#endif // INCLUDED_ml_maths_CPeriodicityTestScheduler_h
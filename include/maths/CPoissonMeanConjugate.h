@@ -48,6 +48,7 @@ struct SDistributionRestoreParams;
 class MATHS_EXPORT CPoissonMeanConjugate : public CPrior {
 public:
     using TEqualWithTolerance = CEqualWithTolerance<double>;
+    using TPoissonCPtrVec = std::vector<const CPoissonMeanConjugate*>;
 
     //! Lift the overloads of addSamples into scope.
     using CPrior::addSamples;
@@ -256,6 +257,35 @@ public:
     virtual void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
     //@}
 
+    //! \name Batch Evaluation
+    //!
+    //! Overloads of the CPrior batch functions for collections of Poisson
+    //! priors. These gather the samples for which the calculation has a
+    //! simple closed form into contiguous arrays and evaluate them with
+    //! vectorised kernels. All other samples are evaluated by the member
+    //! functions.
+    //@{
+    //! \see CPrior::batchProbabilityOfLessLikelySamples.
+    static bool batchProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                    const TPoissonCPtrVec& priors,
+                                                    const SSampleBatch& samples,
+                                                    TDoubleVec& lowerBounds,
+                                                    TDoubleVec& upperBounds,
+                                                    TTailVec& tails);
+
+    //! \see CPrior::batchMinusLogJointCdf.
+    static bool batchMinusLogJointCdf(const TPoissonCPtrVec& priors,
+                                      const SSampleBatch& samples,
+                                      TDoubleVec& lowerBounds,
+                                      TDoubleVec& upperBounds);
+
+    //! \see CPrior::batchJointLogMarginalLikelihood.
+    static maths_t::EFloatingPointErrorStatus
+    batchJointLogMarginalLikelihood(const TPoissonCPtrVec& priors,
+                                    const SSampleBatch& samples,
+                                    TDoubleVec& results);
+    //@}
+
     //! Compute the mean of the prior distribution.
     double priorMean() const;
 
@@ -276,6 +306,16 @@ private:
     //! Read parameters from \p traverser.
     bool acceptRestoreTraverser(core::CStateRestoreTraverser& traverser);
 
+    //! If the marginal likelihood of the \p i'th sample of \p samples is
+    //! well approximated by a normal distribution append the sample and
+    //! the distribution's mean and deviation to \p x, \p means and
+    //! \p deviations, respectively.
+    bool gatherNormalApproximation(const SSampleBatch& samples,
+                                   std::size_t i,
+                                   TDoubleVec& x,
+                                   TDoubleVec& means,
+                                   TDoubleVec& deviations) const;
+
 private:
     //! The shape parameter of a non-informative prior.
     static const double NON_INFORMATIVE_SHAPE;
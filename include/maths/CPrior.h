@@ -38,6 +38,7 @@ namespace maths {
 class MATHS_EXPORT CPrior {
 public:
     using TDoubleVec = std::vector<double>;
+    using TSizeVec = std::vector<std::size_t>;
     using TDoubleVecVec = std::vector<TDoubleVec>;
     using TDoubleDoublePr = std::pair<double, double>;
     using TDoubleDoublePrVec = std::vector<TDoubleDoublePr>;
@@ -45,6 +46,43 @@ public:
     using TDoubleWeightsAry = maths_t::TDoubleWeightsAry;
     using TDoubleWeightsAry1Vec = maths_t::TDoubleWeightsAry1Vec;
     using TWeights = maths_t::CUnitWeights;
+    using TTailVec = std::vector<maths_t::ETail>;
+    using TPriorCPtrVec = std::vector<const CPrior*>;
+
+    //! \brief A batch of weighted samples stored as structure of arrays.
+    //!
+    //! DESCRIPTION:\n
+    //! This is the input to the batch evaluation functions, which compute
+    //! one result for each of a collection of priors. The i'th sample is
+    //! evaluated on the i'th prior. The weights of each sample are stored
+    //! in parallel arrays so that the loops over a batch can be vectorised.
+    struct MATHS_EXPORT SSampleBatch {
+        //! Append \p sample with \p weights.
+        void add(double sample, const TDoubleWeightsAry& weights = TWeights::UNIT);
+
+        //! Remove all the samples.
+        void clear();
+
+        //! Reserve space for \p n samples.
+        void reserve(std::size_t n);
+
+        //! Get the number of samples.
+        std::size_t size() const;
+
+        //! Get the weights of the \p i'th sample.
+        TDoubleWeightsAry weights(std::size_t i) const;
+
+        //! The sample values.
+        TDoubleVec s_Samples;
+        //! The count weights.
+        TDoubleVec s_Counts;
+        //! The seasonal variance scales.
+        TDoubleVec s_SeasonalVarianceScales;
+        //! The count variance scales.
+        TDoubleVec s_CountVarianceScales;
+        //! The winsorisation weights.
+        TDoubleVec s_WinsorisationWeights;
+    };
 
     //! \brief Data for plotting a series
     struct MATHS_EXPORT SPlot {
@@ -436,6 +474,46 @@ public:
                                TDouble1Vec& resamples,
                                TDoubleWeightsAry1Vec& resamplesWeights) const;
 
+    //! \name Batch Evaluation
+    //!
+    //! These evaluate the i'th sample of a batch on the i'th prior of
+    //! a collection and write the result to the i'th element of each
+    //! output vector. They give the same results as calling the member
+    //! functions on each prior in turn with a single sample. The priors
+    //! can be of any type. The overloads on the concrete prior types
+    //! evaluate as many samples as possible using vectorised kernels.
+    //!
+    //! \return False if any prior failed, in which case its results are
+    //! zero, and true otherwise.
+    //@{
+    //! Compute the probabilities of less likely samples.
+    //!
+    //! \see probabilityOfLessLikelySamples for details.
+    static bool batchProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                    const TPriorCPtrVec& priors,
+                                                    const SSampleBatch& samples,
+                                                    TDoubleVec& lowerBounds,
+                                                    TDoubleVec& upperBounds,
+                                                    TTailVec& tails);
+
+    //! Compute minus the log c.d.f.s.
+    //!
+    //! \see minusLogJointCdf for details.
+    static bool batchMinusLogJointCdf(const TPriorCPtrVec& priors,
+                                      const SSampleBatch& samples,
+                                      TDoubleVec& lowerBounds,
+                                      TDoubleVec& upperBounds);
+
+    //! Compute the log marginal likelihoods.
+    //!
+    //! \see jointLogMarginalLikelihood for details.
+    //! \return The union of the error statuses of the priors.
+    static maths_t::EFloatingPointErrorStatus
+    batchJointLogMarginalLikelihood(const TPriorCPtrVec& priors,
+                                    const SSampleBatch& samples,
+                                    TDoubleVec& results);
+    //@}
+
 protected:
     //! \brief Defines a set of operations to adjust the offset parameter
     //! of those priors with non-negative support.
@@ -515,6 +593,68 @@ protected:
     //! Get a debug description of the prior parameters.
     virtual std::string debug() const;
 
+    //! \name Batch Evaluation Helpers
+    //@{
+    //! Compute the probability of less likely samples for the \p i'th
+    //! sample of \p samples on \p prior using its member function.
+    static bool singleProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                     const CPrior& prior,
+                                                     const SSampleBatch& samples,
+                                                     std::size_t i,
+                                                     double& lowerBound,
+                                                     double& upperBound,
+                                                     maths_t::ETail& tail);
+
+    //! Compute minus the log c.d.f. for the \p i'th sample of \p samples
+    //! on \p prior using its member function.
+    static bool singleMinusLogJointCdf(const CPrior& prior,
+                                       const SSampleBatch& samples,
+                                       std::size_t i,
+                                       double& lowerBound,
+                                       double& upperBound);
+
+    //! Compute the log marginal likelihood for the \p i'th sample of
+    //! \p samples on \p prior using its member function.
+    static maths_t::EFloatingPointErrorStatus
+    singleJointLogMarginalLikelihood(const CPrior& prior,
+                                     const SSampleBatch& samples,
+                                     std::size_t i,
+                                     double& result);
+
+    //! Compute the probabilities of less likely samples than \p x for
+    //! the normal distributions with \p means and \p deviations.
+    //!
+    //! \note This is only valid for samples with unit count and finite
+    //! values, distributions with positive deviation.
+    static void normalProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                     const TDoubleVec& x,
+                                                     const TDoubleVec& means,
+                                                     const TDoubleVec& deviations,
+                                                     TDoubleVec& result,
+                                                     TTailVec& tails);
+
+    //! Compute minus the log of the c.d.f. at \p x of the normal
+    //! distributions with \p means and \p deviations.
+    //!
+    //! \note The log-normal c.d.f. is the normal c.d.f. of log(\p x).
+    static void normalMinusLogCdf(const TDoubleVec& x,
+                                  const TDoubleVec& means,
+                                  const TDoubleVec& deviations,
+                                  TDoubleVec& result);
+
+    //! Compute the probabilities of less likely samples than \p x for
+    //! the log-normal distributions with \p locations and \p scales.
+    //!
+    //! \note This is only valid for samples with unit count and finite
+    //! positive values, distributions with positive scale.
+    static void logNormalProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                        const TDoubleVec& x,
+                                                        const TDoubleVec& locations,
+                                                        const TDoubleVec& scales,
+                                                        TDoubleVec& result,
+                                                        TTailVec& tails);
+    //@}
+
 private:
     //! If this is true then the prior is being used to model discrete
     //! data. Note that this is not persisted and deduced from context.
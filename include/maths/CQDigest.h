@@ -77,6 +77,7 @@ namespace maths {
 //! and to reserve sufficient memory up front for our node allocator.
 class MATHS_EXPORT CQDigest : private core::CNonCopyable {
 public:
+    using TUInt32Vec = std::vector<uint32_t>;
     using TUInt32UInt64Pr = std::pair<uint32_t, uint64_t>;
     using TUInt32UInt64PrVec = std::vector<TUInt32UInt64Pr>;
 
@@ -176,6 +177,15 @@ public:
     //! Get the minimum knot point greater than \p x.
     void superlevelSetInfimum(uint32_t x, uint32_t& result) const;
 
+    //! Get the values at which the c.d.f. and p.d.f. bounds can
+    //! change. These are the end points of the nodes' ranges and
+    //! the values immediately after them, so cdf(x) and pdf(x) are
+    //! constant for x between consecutive values.
+    //!
+    //! \param[out] result Filled in with the values in ascending
+    //! order. This always starts with zero.
+    void cdfBreakpoints(TUInt32Vec& result) const;
+
     //! Get a summary of the q-digest. This is the counts less
     //! than or equal to each distinct integer in the quantile
     //! summary.
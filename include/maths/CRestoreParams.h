@@ -17,13 +17,16 @@
 namespace ml {
 namespace maths {
 class CModelParams;
+class CPeriodicityTestScheduler;
 
 //! \brief Gatherers up extra parameters supplied when restoring
 //! time series decompositions.
 struct MATHS_EXPORT STimeSeriesDecompositionRestoreParams {
     STimeSeriesDecompositionRestoreParams(double decayRate,
                                           core_t::TTime minimumBucketLength,
-                                          std::size_t componentSize);
+                                          std::size_t componentSize,
+                                          CPeriodicityTestScheduler* periodicityTestScheduler = nullptr,
+                                          bool deflatePeriodicityTestWindows = false);
 
     //! The rate at which decomposition loses information.
     double s_DecayRate;
@@ -33,6 +36,12 @@ struct MATHS_EXPORT STimeSeriesDecompositionRestoreParams {
 
     //! The decomposition seasonal component size.
     std::size_t s_ComponentSize;
+
+    //! The scheduler used to run periodicity tests, if any.
+    CPeriodicityTestScheduler* s_PeriodicityTestScheduler;
+
+    //! True if the periodicity test windows are stored deflated.
+    bool s_DeflatePeriodicityTestWindows;
 };
 
 //! \brief Gatherers up extra parameters supplied when restoring
@@ -28,6 +28,28 @@ public:
     using TFloatMeanAccumulatorVec = std::vector<TFloatMeanAccumulator>;
     using TFloatMeanAccumulatorCRng = core::CVectorRange<const TFloatMeanAccumulatorVec>;
 
+    //! \brief Scratch memory used to compute transforms.
+    //!
+    //! DESCRIPTION:\n
+    //! Passing the same workspace to a sequence of transforms avoids
+    //! allocating their scratch memory each time. A workspace must not
+    //! be shared between threads.
+    class MATHS_EXPORT CFftWorkspace {
+    private:
+        //! Holds the reordered input to the mixed radix transform.
+        TComplexVec m_Buffer;
+        //! Holds the padded convolution for Bluestein's transform.
+        TComplexVec m_Padded;
+        //! Holds the packed real values for the real transform.
+        TComplexVec m_Packed;
+        //! Holds real values for the autocorrelation.
+        TDoubleVec m_Real;
+        //! Holds the transform for the autocorrelation.
+        TComplexVec m_Transform;
+
+        friend class CSignal;
+    };
+
 public:
     //! Compute the conjugate of \p f.
     static void conj(TComplexVec& f);
@@ -35,18 +57,39 @@ public:
     //! Compute the Hadamard product of \p fx and \p fy.
     static void hadamard(const TComplexVec& fx, TComplexVec& fy);
 
-    //! Cooley-Tukey fast DFT transform implementation.
+    //! Compute the DFT of \p f in-place.
     //!
-    //! \note This is a simple implementation radix 2 DIT which uses the chirp-z
-    //! idea to handle the case that the length of \p fx is not a power of 2. As
-    //! such it is definitely not a highly optimized FFT implementation. It should
-    //! be sufficiently fast for our needs.
+    //! \note This uses a mixed radix 2, 3, 4 and 5 Cooley-Tukey transform if
+    //! the length of \p f only has these prime factors and otherwise uses the
+    //! chirp-z idea to reformulate the DFT as a convolution whose length has
+    //! these factors. The permutation and twiddle factors are computed once
+    //! for each length and cached.
     static void fft(TComplexVec& f);
 
+    //! Compute the DFT of \p f in-place reusing \p workspace.
+    static void fft(TComplexVec& f, CFftWorkspace& workspace);
+
     //! This uses conjugate of the conjugate of the series is the inverse DFT trick
     //! to compute this using fft.
     static void ifft(TComplexVec& f);
 
+    //! Compute the inverse DFT of \p f in-place reusing \p workspace.
+    static void ifft(TComplexVec& f, CFftWorkspace& workspace);
+
+    //! Compute the DFT of the real values \p f.
+    //!
+    //! Since the DFT of a real signal is conjugate symmetric this only
+    //! computes the \f$\lfloor n/2 \rfloor + 1\f$ coefficients for the
+    //! frequencies \f$0, 1, ..., \lfloor n/2 \rfloor\f$. For even \f$n\f$
+    //! this packs pairs of values into a complex signal of half the length.
+    //!
+    //! \param[in] f The values to transform.
+    //! \param[out] result Filled in with the non-redundant coefficients.
+    static void realFft(const TDoubleVec& f, TComplexVec& result);
+
+    //! Compute the DFT of the real values \p f reusing \p workspace.
+    static void realFft(const TDoubleVec& f, TComplexVec& result, CFftWorkspace& workspace);
+
     //! Compute the discrete cyclic autocorrelation of \p values for the offset
     //! \p offset.
     //!
@@ -71,6 +114,12 @@ public:
     //! \param[in] result Filled in with the autocorrelations of \p values for
     //! offsets 1, 2, ..., length \p values - 1.
     static void autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVec& result);
+
+    //! Get linear autocorrelations for all offsets up to the length of \p values
+    //! reusing \p workspace.
+    static void autocorrelations(const TFloatMeanAccumulatorVec& values,
+                                 TDoubleVec& result,
+                                 CFftWorkspace& workspace);
 };
 }
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_maths_CSpecialFunctions_h
+#define INCLUDED_ml_maths_CSpecialFunctions_h
+
+#include <core/CNonInstantiatable.h>
+
+#include <maths/ImportExport.h>
+
+#include <cstddef>
+
+namespace ml {
+namespace maths {
+
+//! \brief Vectorised special functions.
+//!
+//! DESCRIPTION:\n
+//! Evaluates the special functions and distribution functions which
+//! dominate the cost of computing the marginal likelihood and c.d.f.
+//! of the conjugate priors for many arguments at once. Each function
+//! reads \p n values from its argument arrays and writes \p n values
+//! to \p result, for example
+//! \code{.cpp}
+//!   double x[]{0.5, 1.5, 2.5};
+//!   double result[3];
+//!   CSpecialFunctions::logGamma(x, 3, result);
+//! \endcode
+//! Arguments outside the domain of a function give NaN.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The functions are evaluated for several arguments in parallel using
+//! AVX2 if the code is compiled for it, SSE2 otherwise on x86 and a
+//! portable scalar implementation elsewhere. The instruction set is
+//! chosen at compile time, so it follows the target architecture flags
+//! of the build rather than requiring runtime dispatch. The same branch
+//! free algorithms are used for every instruction set: this includes
+//! exp and log since the standard library has no vector versions.
+//!
+//! The accuracy is close to boost::math. In particular:
+//!   -# logGamma and digamma have absolute errors of a few ulp relative
+//!      to max(1, |f(x)|), so relative accuracy is lost close to their
+//!      zeros.
+//!   -# erf and erfc have relative errors less than 1e-14.
+//!   -# The incomplete gamma and beta functions, and so the c.d.f.s, use
+//!      the classic series and continued fraction expansions. Their
+//!      relative accuracy degrades slowly as the shape parameters grow
+//!      and any argument for which the expansions fail to converge is
+//!      evaluated using boost::math.
+class MATHS_EXPORT CSpecialFunctions : private core::CNonInstantiatable {
+public:
+    //! Get the name of the instruction set used to evaluate the functions.
+    static const char* instructionSet();
+
+    //! Get the number of arguments which are evaluated in parallel.
+    static std::size_t width();
+
+    //! Compute \f$\log(\Gamma(x))\f$ for \f$x > 0\f$.
+    static void logGamma(const double* x, std::size_t n, double* result);
+
+    //! Compute the digamma function, i.e. \f$\frac{d}{dx}\log(\Gamma(x))\f$,
+    //! for \f$x > 0\f$.
+    static void digamma(const double* x, std::size_t n, double* result);
+
+    //! Compute the error function.
+    static void erf(const double* x, std::size_t n, double* result);
+
+    //! Compute the complementary error function.
+    static void erfc(const double* x, std::size_t n, double* result);
+
+    //! Compute the regularized lower incomplete gamma function
+    //! \f$P(a, x)\f$ for \f$a > 0\f$ and \f$x \geq 0\f$, or its
+    //! complement \f$Q(a, x) = 1 - P(a, x)\f$ if \p complement is true.
+    static void incompleteGamma(const double* a,
+                                const double* x,
+                                std::size_t n,
+                                double* result,
+                                bool complement = false);
+
+    //! Compute the regularized incomplete beta function \f$I_x(a, b)\f$
+    //! for \f$a, b > 0\f$ and \f$0 \leq x \leq 1\f$, or its complement
+    //! \f$1 - I_x(a, b)\f$ if \p complement is true.
+    static void incompleteBeta(const double* a,
+                               const double* b,
+                               const double* x,
+                               std::size_t n,
+                               double* result,
+                               bool complement = false);
+
+    //! Compute the c.d.f., or its complement if \p complement is true,
+    //! of the normal distributions with \p mean and standard deviation
+    //! \p sd at \p x.
+    static void normalCdf(const double* mean,
+                          const double* sd,
+                          const double* x,
+                          std::size_t n,
+                          double* result,
+                          bool complement = false);
+
+    //! Compute the c.d.f., or its complement if \p complement is true,
+    //! of the standard student's t distributions with \p dof degrees of
+    //! freedom at \p x.
+    static void studentsTCdf(const double* dof,
+                             const double* x,
+                             std::size_t n,
+                             double* result,
+                             bool complement = false);
+
+    //! Compute the c.d.f., or its complement if \p complement is true,
+    //! of the gamma distributions with \p shape and \p scale at \p x.
+    static void gammaCdf(const double* shape,
+                         const double* scale,
+                         const double* x,
+                         std::size_t n,
+                         double* result,
+                         bool complement = false);
+};
+}
+}
+
+#endif // INCLUDED_ml_maths_CSpecialFunctions_h
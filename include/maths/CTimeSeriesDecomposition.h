@@ -91,6 +91,17 @@ public:
     //! Get the decay rate.
     virtual double decayRate() const;
 
+    //! Set the scheduler used to run periodicity tests.
+    //!
+    //! \note This isn't owned and must outlive the decomposition. If it
+    //! is null periodicity tests are run as soon as they're due.
+    void periodicityTestScheduler(CPeriodicityTestScheduler* scheduler);
+
+    //! Set whether to store the periodicity test windows deflated.
+    //!
+    //! This uses much less memory at the cost of some extra runtime.
+    void deflatePeriodicityTestWindows(bool deflate);
+
     //! Check if the decomposition has any initialized components.
     virtual bool initialized() const;
 
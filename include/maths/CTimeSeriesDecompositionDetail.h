@@ -13,6 +13,7 @@
 
 #include <maths/CCalendarComponent.h>
 #include <maths/CPeriodicityHypothesisTests.h>
+#include <maths/CPeriodicityTestScheduler.h>
 #include <maths/CSeasonalComponent.h>
 #include <maths/CTimeSeriesDecompositionInterface.h>
 #include <maths/CTrendComponent.h>
@@ -196,8 +197,20 @@ public:
         virtual void handle(const SNewComponents& message);
 
         //! Test to see whether any seasonal components are present.
+        //!
+        //! If the test has a scheduler the test is scheduled and its
+        //! result is handled in the first call after it has run.
         void test(const SAddValue& message);
 
+        //! Set the scheduler used to run the tests.
+        //!
+        //! \note This isn't owned and must outlive the test. If it is null
+        //! tests are run immediately.
+        void scheduler(CPeriodicityTestScheduler* scheduler);
+
+        //! Set whether to store the window values deflated.
+        void deflateWindows(bool deflate);
+
         //! Age the test to account for the interval \p end - \p start
         //! elapsed time.
         void propagateForwards(core_t::TTime start, core_t::TTime end);
@@ -215,6 +228,8 @@ public:
         using TTimeAry = boost::array<core_t::TTime, 2>;
         using TExpandingWindowPtr = std::shared_ptr<CExpandingWindow>;
         using TExpandingWindowPtrAry = boost::array<TExpandingWindowPtr, 2>;
+        using TTestPtr = CPeriodicityTestScheduler::TTestPtr;
+        using TTestPtrAry = boost::array<TTestPtr, 2>;
 
         //! Test types (categorised as short and long period tests).
         enum ETest { E_Short, E_Long };
@@ -230,6 +245,12 @@ public:
         //! Handle \p symbol.
         void apply(std::size_t symbol, const SMessage& message);
 
+        //! Forward the results of any scheduled tests which have run.
+        void forwardScheduledTestResults(const SAddValue& message);
+
+        //! Discard any scheduled tests.
+        void discardScheduledTests();
+
         //! Check if we should run the periodicity test on \p window.
         bool shouldTest(const TExpandingWindowPtr& window, core_t::TTime time) const;
 
@@ -252,6 +273,20 @@ public:
 
         //! Expanding windows on the "recent" time series values.
         TExpandingWindowPtrAry m_Windows;
+
+        //! True if the window values are stored deflated.
+        bool m_DeflateWindows;
+
+        //! The scheduler used to run tests if any.
+        CPeriodicityTestScheduler* m_Scheduler;
+
+        //! The scheduled tests of each window.
+        TTestPtrAry m_ScheduledTests;
+
+        //! Copies of the windows which restarted before the results of
+        //! their scheduled tests were forwarded.  Otherwise the results
+        //! are forwarded with the live windows.
+        TExpandingWindowPtrAry m_ScheduledWindows;
     };
 
     //! \brief Tests for cyclic calendar components explaining large prediction
@@ -29,6 +29,15 @@ struct SDistributionRestoreParams;
 struct SModelRestoreParams;
 
 //! \brief A CModel implementation for modeling a univariate time series.
+//!
+//! DESCRIPTION:\n
+//! If the model parameters supply a residual model prototype then, while
+//! the trend has no components, residual distribution models which no
+//! longer explain the data are removed. The full residual model is
+//! restored from the prototype as soon as the trend decomposition detects
+//! structure in the time series. Most time series in jobs with many by or
+//! over field values never develop seasonality so this can reduce the
+//! memory they use.
 class MATHS_EXPORT CUnivariateTimeSeriesModel : public CModel {
 public:
     using TTimeDoublePr = std::pair<core_t::TTime, double>;
@@ -158,6 +167,9 @@ public:
     //! Get the type of data being modeled.
     virtual maths_t::EDataType dataType() const;
 
+    //! Check if the residual model has been compacted.
+    bool isResidualModelCompact() const;
+
     //! \name Test Functions
     //@{
     //! Get the sliding window of recent values.
@@ -195,6 +207,13 @@ private:
     //! Compute the prediction errors for \p sample.
     void appendPredictionErrors(double interval, double sample, TDouble1VecVec (&result)[2]);
 
+    //! Remove the residual models which no longer explain the data if
+    //! the trend has no components.
+    void compactResidualModel();
+
+    //! Replace a compact residual model by the full residual model.
+    void promoteResidualModel();
+
     //! Get the models for the correlations and the models of the correlated
     //! time series.
     bool correlationModels(TSize1Vec& correlated,
@@ -212,6 +231,9 @@ private:
     //! True if the model can be forecast.
     bool m_IsForecastable;
 
+    //! True if residual models have been removed from the prior.
+    bool m_IsResidualModelCompact;
+
     //! A random number generator for sampling the sliding window.
     CPRNG::CXorOShiro128Plus m_Rng;
 
@@ -350,6 +350,10 @@ public:
     static double safeCdfComplement(const chi_squared& chi2, double x);
     //@}
 
+    //! Compute minus the log of \p cdf clamping the result to the range
+    //! [0, -log(min double)] to avoid underflow.
+    static double safeMinusLogCdf(double cdf);
+
     //! Compute the deviation from the probability of seeing a more
     //! extreme event for a distribution, i.e. for a sample \f$x\f$
     //! from a R.V. the probability \f$P(R)\f$ of the set:
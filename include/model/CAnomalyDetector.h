@@ -69,6 +69,7 @@ class MODEL_EXPORT CAnomalyDetector : private core::CNonCopyable {
 public:
     using TStrVec = std::vector<std::string>;
     using TStrCPtrVec = std::vector<const std::string*>;
+    using TDoubleCPtrVec = std::vector<const double*>;
     using TModelPlotDataVec = std::vector<CModelPlotData>;
 
     using TDataGathererPtr = std::shared_ptr<CDataGatherer>;
@@ -212,6 +213,18 @@ public:
     //! Extract and add the necessary details of an event record.
     void addRecord(core_t::TTime time, const TStrCPtrVec& fieldValues);
 
+    //! Extract and add the necessary details of an event record, some of
+    //! whose fields of interest were supplied as numbers.  \p numericValues
+    //! is indexed in the same way as \p fieldValues and is null for fields
+    //! only supplied as strings.
+    void addRecord(core_t::TTime time,
+                   const TStrCPtrVec& fieldValues,
+                   const TDoubleCPtrVec& numericValues);
+
+    //! Get the number of records added since this detector was created or
+    //! restored.
+    uint64_t numberRecords() const;
+
     //! Update the results with this detector model's results.
     void buildResults(core_t::TTime bucketStartTime,
                       core_t::TTime bucketEndTime,
@@ -257,6 +270,14 @@ public:
     //! Return the total memory usage
     std::size_t memoryUsage() const;
 
+    //! Get the memory the models which will be created when the next bucket
+    //! is sampled will use.
+    std::size_t pendingMemoryUsage();
+
+    //! Get a checksum of the detector's model, including the data in the
+    //! current bucket, which can be used to tell if it has changed.
+    uint64_t checksum() const;
+
     //! Get end of the last complete bucket we've observed.
     const core_t::TTime& lastBucketEndTime() const;
 
@@ -360,6 +381,10 @@ private:
     //! necessary to create a valid persisted state?
     bool m_IsForPersistence;
 
+    //! The number of records added since this detector was created or
+    //! restored.
+    uint64_t m_NumberRecords;
+
     friend MODEL_EXPORT std::ostream& operator<<(std::ostream&, const CAnomalyDetector&);
 };
 
@@ -464,6 +464,17 @@ public:
                                                       std::size_t numberAttributes,
                                                       std::size_t numberCorrelations);
 
+    //! Get the memory used by this object, including its static size,
+    //! by walking it with debugMemoryUsage.
+    std::size_t walkMemoryUsage() const;
+
+    //! Get the memory the models of the people and attributes which are
+    //! waiting to be created, or recycled, will use when they're created.
+    //!
+    //! New models are copies of the prototype models, so this is constant
+    //! time.
+    virtual std::size_t pendingMemoryUsage();
+
     //! Get the static size of this object - used for virtual hierarchies
     virtual std::size_t staticSize() const = 0;
 
@@ -514,6 +525,8 @@ protected:
         model_t::EFeature s_Feature;
         //! A prototype model.
         TMathsModelPtr s_NewModel;
+        //! The memory a copy of the prototype model uses.
+        std::size_t s_NewModelMemoryUsage;
         //! The person models.
         TMathsModelPtrVec s_Models;
     };
@@ -686,6 +699,13 @@ protected:
     //! or attributes to free memory resource.
     static maths::CModel* tinyModel();
 
+    //! Get the memory the models in \p models will use once there are
+    //! \p numberModels for each feature and \p numberRecycled have been
+    //! replaced with new ones.
+    static std::size_t pendingMemoryUsage(const TFeatureModelsVec& models,
+                                          std::size_t numberModels,
+                                          std::size_t numberRecycled);
+
 private:
     using TModelParamsCRef = boost::reference_wrapper<const SModelParams>;
     using TInterimBucketCorrectorPtr = std::shared_ptr<CInterimBucketCorrector>;
@@ -27,6 +27,9 @@
 #include <vector>
 
 namespace ml {
+namespace maths {
+class CPeriodicityTestScheduler;
+}
 namespace model {
 class CDetectionRule;
 class CSearchKey;
@@ -347,6 +350,11 @@ public:
     //! Get the rate at which the models lose information.
     double decayRate() const;
 
+    //! Set the scheduler used to run the models' periodicity tests.
+    //!
+    //! \note This isn't owned and must outlive all the models.
+    void periodicityTestScheduler(maths::CPeriodicityTestScheduler* scheduler);
+
     //! Get the length of the baseline.
     core_t::TTime baselineLength() const;
 
@@ -420,6 +428,14 @@ public:
     //! Set whether we should create one normalizer per partition field value.
     void perPartitionNormalization(bool value);
 
+    //! Check if the normalizers should use lookup tables.
+    bool normalizerLookupTables() const;
+
+    //! Set whether the normalizers should use lookup tables.  These make
+    //! normalizing scores much cheaper if scores are normalized much more
+    //! often than the quantiles are updated.
+    void normalizerLookupTables(bool value);
+
     //! Sets the reference to the detection rules map
     void detectionRules(TIntDetectionRuleVecUMapCRef detectionRules);
 
@@ -490,6 +506,9 @@ private:
 
     //! If true then create one normalizer per partition field value.
     bool m_PerPartitionNormalisation;
+
+    //! If true then the normalizers use lookup tables.
+    bool m_NormalizerLookupTables;
     //@}
 
     //! A reference to the map containing detection rules per
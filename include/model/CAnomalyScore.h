@@ -16,8 +16,10 @@
 
 #include <boost/optional.hpp>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -97,6 +99,28 @@ public:
 
     //! \brief Manages the normalization of aggregate anomaly scores
     //! based on historic values percentiles.
+    //!
+    //! DESCRIPTION:\n
+    //! The normalized score is the minimum of several ceilings. The
+    //! ceiling which is computed from the percentile of the score
+    //! requires a number of q-digest queries, which dominate the cost
+    //! of normalizing a score. Optionally, i.e. if the model config
+    //! enables normalizer lookup tables, this ceiling is looked up
+    //! in a table which is rebuilt lazily after the quantiles change.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! The q-digest c.d.f. and p.d.f. bounds are step functions of
+    //! the discrete score, which only change at the end points of the
+    //! q-digest nodes' ranges. So the percentile ceiling is constant
+    //! between consecutive end points and the table stores its value
+    //! at each one. This means the table gives exactly the same
+    //! normalized scores as the direct calculation and normalizing a
+    //! score costs a binary search over the end points.
+    //!
+    //! The table can be rebuilt by normalize, so it's protected by a
+    //! mutex. This means scores can be normalized by several threads
+    //! concurrently, but the quantiles must not be updated at the same
+    //! time.
     class MODEL_EXPORT CNormalizer : private core::CNonCopyable {
     public:
         explicit CNormalizer(const CAnomalyDetectorModelConfig& config);
@@ -171,6 +195,30 @@ public:
         using TGreaterDouble = std::greater<double>;
         using TMaxValueAccumulator =
             maths::CBasicStatistics::COrderStatisticsStack<double, 1u, TGreaterDouble>;
+        using TUInt32Vec = std::vector<uint32_t>;
+
+        //! \brief The parameters of the noise ceiling which depend on
+        //! the quantiles.
+        struct SNoiseCeilingParameters {
+            //! The noise percentile discrete score.
+            uint32_t s_NoiseScore;
+            //! The normalized score of the noise percentile knot point.
+            double s_KnotPointScore;
+            //! The part of the ceiling which depends on the c.d.f. at 0.
+            double s_ZeroScoreCeiling;
+        };
+
+        //! \brief A lookup table for the ceilings of the normalized
+        //! score which depend on the quantiles.
+        struct SLookupTable {
+            //! The noise ceiling parameters.
+            SNoiseCeilingParameters s_NoiseCeiling;
+            //! The discrete scores at which the percentile ceiling can
+            //! change in ascending order.
+            TUInt32Vec s_Breakpoints;
+            //! The percentile ceiling between each breakpoint and the next.
+            TDoubleVec s_PercentileCeilings;
+        };
 
     private:
         //! Used to convert raw scores in to integers so that we
@@ -196,6 +244,30 @@ public:
         //! Compute the discrete score from a raw score.
         uint32_t discreteScore(double rawScore) const;
 
+        //! Estimate the quantile range including \p discreteScore.
+        void discreteQuantile(uint32_t discreteScore,
+                              double confidence,
+                              double& lowerBound,
+                              double& upperBound) const;
+
+        //! Compute the noise ceiling parameters from the quantiles.
+        SNoiseCeilingParameters noiseCeilingParameters() const;
+
+        //! Compute the ceiling of the normalized score which is a
+        //! multiple of the noise percentile score.
+        double noiseCeiling(const SNoiseCeilingParameters& parameters,
+                            uint32_t discreteScore) const;
+
+        //! Compute the ceiling of the normalized score which is based
+        //! on the percentile of \p discreteScore.
+        double percentileCeiling(uint32_t discreteScore) const;
+
+        //! Get the lookup table rebuilding it if necessary.
+        const SLookupTable& lookupTable() const;
+
+        //! Mark the lookup table as needing to be rebuilt.
+        void invalidateLookupTable();
+
         //! Extract the raw score from a discrete score.
         double rawScore(uint32_t discreteScore) const;
 
@@ -235,6 +307,15 @@ public:
         double m_DecayRate;
         //! The time to when we next age the quantiles.
         double m_TimeToQuantileDecay;
+
+        //! True if the quantile ceilings are looked up in a table.
+        bool m_UseLookupTable;
+        //! True if the lookup table is up-to-date with the quantiles.
+        mutable std::atomic<bool> m_LookupTableValid;
+        //! Serializes rebuilding the lookup table.
+        mutable std::mutex m_LookupTableMutex;
+        //! The lookup table.
+        mutable SLookupTable m_LookupTable;
     };
 
     using TNormalizerP = std::shared_ptr<CNormalizer>;
@@ -16,12 +16,12 @@
 
 #include <model/CBucketQueue.h>
 #include <model/CEventData.h>
+#include <model/CFeatureData.h>
 #include <model/CModelParams.h>
 #include <model/FunctionTypes.h>
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
 
-#include <boost/any.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
 #include <boost/unordered_map.hpp>
@@ -65,6 +65,7 @@ public:
     using TStrVec = std::vector<std::string>;
     using TStrVecCItr = TStrVec::const_iterator;
     using TStrCPtrVec = std::vector<const std::string*>;
+    using TDoubleCPtrVec = std::vector<const double*>;
     using TSizeUInt64Pr = std::pair<std::size_t, uint64_t>;
     using TSizeUInt64PrVec = std::vector<TSizeUInt64Pr>;
     using TFeatureVec = model_t::TFeatureVec;
@@ -126,8 +127,30 @@ public:
     using TTimeSizeSizePrStoredStringPtrPrUInt64UMapVecMap =
         std::map<core_t::TTime, TSizeSizePrStoredStringPtrPrUInt64UMapVec>;
     using TSearchKeyCRef = boost::reference_wrapper<const CSearchKey>;
-    using TFeatureAnyPr = std::pair<model_t::EFeature, boost::any>;
-    using TFeatureAnyPrVec = std::vector<TFeatureAnyPr>;
+    using TSizeEventRateFeatureDataPr = std::pair<std::size_t, SEventRateFeatureData>;
+    using TSizeEventRateFeatureDataPrVec = std::vector<TSizeEventRateFeatureDataPr>;
+    using TFeatureSizeEventRateFeatureDataPrVecPr =
+        std::pair<model_t::EFeature, TSizeEventRateFeatureDataPrVec>;
+    using TFeatureSizeEventRateFeatureDataPrVecPrVec =
+        std::vector<TFeatureSizeEventRateFeatureDataPrVecPr>;
+    using TSizeSizePrEventRateFeatureDataPr = std::pair<TSizeSizePr, SEventRateFeatureData>;
+    using TSizeSizePrEventRateFeatureDataPrVec = std::vector<TSizeSizePrEventRateFeatureDataPr>;
+    using TFeatureSizeSizePrEventRateFeatureDataPrVecPr =
+        std::pair<model_t::EFeature, TSizeSizePrEventRateFeatureDataPrVec>;
+    using TFeatureSizeSizePrEventRateFeatureDataPrVecPrVec =
+        std::vector<TFeatureSizeSizePrEventRateFeatureDataPrVecPr>;
+    using TSizeMetricFeatureDataPr = std::pair<std::size_t, SMetricFeatureData>;
+    using TSizeMetricFeatureDataPrVec = std::vector<TSizeMetricFeatureDataPr>;
+    using TFeatureSizeMetricFeatureDataPrVecPr =
+        std::pair<model_t::EFeature, TSizeMetricFeatureDataPrVec>;
+    using TFeatureSizeMetricFeatureDataPrVecPrVec =
+        std::vector<TFeatureSizeMetricFeatureDataPrVecPr>;
+    using TSizeSizePrMetricFeatureDataPr = std::pair<TSizeSizePr, SMetricFeatureData>;
+    using TSizeSizePrMetricFeatureDataPrVec = std::vector<TSizeSizePrMetricFeatureDataPr>;
+    using TFeatureSizeSizePrMetricFeatureDataPrVecPr =
+        std::pair<model_t::EFeature, TSizeSizePrMetricFeatureDataPrVec>;
+    using TFeatureSizeSizePrMetricFeatureDataPrVecPrVec =
+        std::vector<TFeatureSizeSizePrMetricFeatureDataPrVecPr>;
     using TMetricCategoryVec = std::vector<model_t::EMetricCategory>;
     using TTimeVec = std::vector<core_t::TTime>;
     using TTimeVecCItr = TTimeVec::const_iterator;
@@ -212,8 +235,12 @@ public:
     //! Process the specified fields.
     //!
     //! This adds people and attributes as necessary and fills out the
-    //! event data from \p fieldValues.
+    //! event data from \p fieldValues.  \p numericValues is either empty
+    //! or holds the value of each field which was supplied as a number,
+    //! and null for the others.  Where a number is supplied it is used in
+    //! preference to the string, which may be null.
     virtual bool processFields(const TStrCPtrVec& fieldValues,
+                               const TDoubleCPtrVec& numericValues,
                                CEventData& result,
                                CResourceMonitor& resourceMonitor) = 0;
 
@@ -374,14 +401,30 @@ public:
         }
     }
 
+    //! \name Features
+    //@{
     //! Get the raw data for all features for the bucketing time interval
     //! containing \p time.
     //!
+    //! There is one overload per type of feature data and the caller's
+    //! collection is filled in directly. A gatherer only overrides those
+    //! it can produce: the others log an error and return no data.
+    //!
     //! \param[in] time The time of interest.
     //! \param[out] result Filled in with the feature data at \p time.
     virtual void featureData(core_t::TTime time,
                              core_t::TTime bucketLength,
-                             TFeatureAnyPrVec& result) const = 0;
+                             TFeatureSizeEventRateFeatureDataPrVecPrVec& result) const;
+    virtual void featureData(core_t::TTime time,
+                             core_t::TTime bucketLength,
+                             TFeatureSizeSizePrEventRateFeatureDataPrVecPrVec& result) const;
+    virtual void featureData(core_t::TTime time,
+                             core_t::TTime bucketLength,
+                             TFeatureSizeMetricFeatureDataPrVecPrVec& result) const;
+    virtual void featureData(core_t::TTime time,
+                             core_t::TTime bucketLength,
+                             TFeatureSizeSizePrMetricFeatureDataPrVecPrVec& result) const;
+    //@}
 
     //! Get a reference to the owning data gatherer.
     const CDataGatherer& dataGatherer() const;
@@ -392,6 +435,11 @@ public:
     //! Create samples if possible for the bucket pointed out by \p time.
     virtual void sample(core_t::TTime time);
 
+protected:
+    //! Get the number supplied for the field at position \p i of the
+    //! record, or null if it was only supplied as a string.
+    static const double* numericValue(const TDoubleCPtrVec& numericValues, std::size_t i);
+
 private:
     //! Resize the necessary data structures so they can hold values
     //! for the person and/or attribute identified by \p pid and \p cid,
@@ -21,7 +21,6 @@
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
 
-#include <boost/any.hpp>
 #include <boost/optional.hpp>
 #include <boost/unordered_map.hpp>
 
@@ -105,6 +104,7 @@ public:
     using TStrVec = std::vector<std::string>;
     using TStrVecCItr = TStrVec::const_iterator;
     using TStrCPtrVec = std::vector<const std::string*>;
+    using TDoubleCPtrVec = std::vector<const double*>;
     using TSizeUInt64Pr = std::pair<std::size_t, uint64_t>;
     using TSizeUInt64PrVec = std::vector<TSizeUInt64Pr>;
     using TFeatureVec = model_t::TFeatureVec;
@@ -132,8 +132,6 @@ public:
     using TBucketGathererPVec = std::vector<CBucketGatherer*>;
     using TBucketGathererPVecItr = TBucketGathererPVec::iterator;
     using TBucketGathererPVecCItr = TBucketGathererPVec::const_iterator;
-    using TFeatureAnyPr = std::pair<model_t::EFeature, boost::any>;
-    using TFeatureAnyPrVec = std::vector<TFeatureAnyPr>;
     using TMetricCategoryVec = std::vector<model_t::EMetricCategory>;
     using TSampleCountsPtr = std::shared_ptr<CSampleCounts>;
     using TTimeVec = std::vector<core_t::TTime>;
@@ -318,9 +316,25 @@ public:
                        CEventData& result,
                        CResourceMonitor& resourceMonitor);
 
+    //! Process the specified fields, some of which may have been supplied
+    //! as numbers in \p numericValues.
+    //!
+    //! \see CBucketGatherer::processFields for details.
+    bool processFields(const TStrCPtrVec& fieldValues,
+                       const TDoubleCPtrVec& numericValues,
+                       CEventData& result,
+                       CResourceMonitor& resourceMonitor);
+
     //! Record the arrival of \p data at \p time.
     bool addArrival(const TStrCPtrVec& fieldValues, CEventData& data, CResourceMonitor& resourceMonitor);
 
+    //! Record the arrival of \p data at \p time, where some of the fields
+    //! may have been supplied as numbers in \p numericValues.
+    bool addArrival(const TStrCPtrVec& fieldValues,
+                    const TDoubleCPtrVec& numericValues,
+                    CEventData& data,
+                    CResourceMonitor& resourceMonitor);
+
     //! Roll time to the end of the bucket that is latency after the sampled bucket.
     void sampleNow(core_t::TTime sampleBucketStart);
 
@@ -351,44 +365,13 @@ public:
     //!
     //! \param[in] time The time of interest.
     //! \param[out] result Filled in with the feature data at \p time.
-    //! \tparam T The type of the feature data.
+    //! \tparam T The type of the feature data. This must be one of the
+    //! types for which CBucketGatherer::featureData is overloaded.
     template<typename T>
-    bool featureData(core_t::TTime time,
+    void featureData(core_t::TTime time,
                      core_t::TTime bucketLength,
                      std::vector<std::pair<model_t::EFeature, T>>& result) const {
-        TFeatureAnyPrVec rawFeatureData;
-        this->chooseBucketGatherer(time).featureData(time, bucketLength, rawFeatureData);
-
-        bool succeeded = true;
-
-        result.clear();
-        result.reserve(rawFeatureData.size());
-        for (std::size_t i = 0u; i < rawFeatureData.size(); ++i) {
-            TFeatureAnyPr& feature = rawFeatureData[i];
-
-            // Check the typeid before attempting the cast so we
-            // don't use throw to handle failure, which is slow.
-            if (feature.second.type() != typeid(T)) {
-                LOG_ERROR(<< "Bad type for feature = " << model_t::print(feature.first)
-                          << ", expected " << typeid(T).name() << " got "
-                          << feature.second.type().name());
-                succeeded = false;
-                continue;
-            }
-
-            // We emulate move semantics here to avoid the expensive
-            // copy if T is large (as we expect it might be sometimes).
-            // We have to adopt the using std::swap idiom (contravening
-            // coding guidelines) because T can be a built in type.
-            // Unfortunately, this implementation requires T to be
-            // default constructible.
-            using std::swap;
-            result.push_back(std::pair<model_t::EFeature, T>(feature.first, T()));
-            T& tmp = boost::any_cast<T&>(feature.second);
-            swap(result.back().second, tmp);
-        }
-
-        return succeeded;
+        this->chooseBucketGatherer(time).featureData(time, bucketLength, result);
     }
     //@}
 
@@ -690,12 +673,23 @@ public:
                                const std::string* fieldValue,
                                std::size_t& count) const;
 
+    //! Get a count from a field supplied as a number.  NaN is treated
+    //! as a missing value.
+    bool extractCountFromField(const std::string& fieldName,
+                               double fieldValue,
+                               std::size_t& count) const;
+
     //! Helper to avoid code duplication when getting a metric value from a
     //! field.  Logs different errors for missing value and invalid value.
     bool extractMetricFromField(const std::string& fieldName,
                                 std::string fieldValue,
                                 TDouble1Vec& metricValue) const;
 
+    //! Get a metric value from a field supplied as a number.
+    bool extractMetricFromField(const std::string& fieldName,
+                                double fieldValue,
+                                TDouble1Vec& metricValue) const;
+
     //! Returns the startTime of the earliest bucket for which data are still
     //! accepted.
     core_t::TTime earliestBucketStartTime() const;
@@ -105,6 +105,8 @@ public:
     using TSizeFeatureDataPrVec = std::vector<TSizeFeatureDataPr>;
     using TSizeSizePrFeatureDataPr = std::pair<TSizeSizePr, SEventRateFeatureData>;
     using TSizeSizePrFeatureDataPrVec = std::vector<TSizeSizePrFeatureDataPr>;
+    using TFeatureSizeFeatureDataPrVecPrVec = TFeatureSizeEventRateFeatureDataPrVecPrVec;
+    using TFeatureSizeSizePrFeatureDataPrVecPrVec = TFeatureSizeSizePrEventRateFeatureDataPrVecPrVec;
 
 public:
     //! \name Life-cycle
@@ -217,6 +219,7 @@ public:
     //! field value. The second field should the by clause field value
     //! or a generic name if none was specified.
     virtual bool processFields(const TStrCPtrVec& fieldValues,
+                               const TDoubleCPtrVec& numericValues,
                                CEventData& result,
                                CResourceMonitor& resourceMonitor);
     //@}
@@ -264,14 +267,25 @@ public:
 
     //! \name Features
     //@{
-    //! Get the raw data for all features for the bucketing time interval
-    //! containing \p time.
+    using CBucketGatherer::featureData;
+
+    //! Get the raw data for all individual features for the bucketing
+    //! time interval containing \p time.
+    //!
+    //! \param[in] time The time of interest.
+    //! \param[out] result Filled in with the feature data at \p time.
+    virtual void featureData(core_t::TTime time,
+                             core_t::TTime bucketLength,
+                             TFeatureSizeFeatureDataPrVecPrVec& result) const;
+
+    //! Get the raw data for all population features for the bucketing
+    //! time interval containing \p time.
     //!
     //! \param[in] time The time of interest.
     //! \param[out] result Filled in with the feature data at \p time.
     virtual void featureData(core_t::TTime time,
                              core_t::TTime bucketLength,
-                             TFeatureAnyPrVec& result) const;
+                             TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
     //@}
 
 private:
@@ -284,7 +298,7 @@ private:
     //! \param[in] time The time of interest.
     //! \param[in,out] result Append (person identifier, count) for each
     //! person. The collection is sorted by person.
-    void personCounts(model_t::EFeature feature, core_t::TTime time, TFeatureAnyPrVec& result) const;
+    void personCounts(model_t::EFeature feature, core_t::TTime time, TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the non-zero counts by person for bucketing interval
     //! containing \p time.
@@ -295,7 +309,7 @@ private:
     //! collection is sorted by person.
     void nonZeroPersonCounts(model_t::EFeature feature,
                              core_t::TTime time,
-                             TFeatureAnyPrVec& result) const;
+                             TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append an indicator function for people present in the bucketing
     //! interval containing \p time.
@@ -304,7 +318,7 @@ private:
     //! \param[in,out] result Append (person identifier, 1) for each person
     //! present in the bucketing interval containing \p time. The collection
     //! is sorted by person identifier.
-    void personIndicator(model_t::EFeature feature, core_t::TTime time, TFeatureAnyPrVec& result) const;
+    void personIndicator(model_t::EFeature feature, core_t::TTime time, TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the mean arrival times for people present in the current
     //! bucketing interval.
@@ -315,7 +329,7 @@ private:
     //! The collection is sorted by person identifier.
     void personArrivalTimes(model_t::EFeature feature,
                             core_t::TTime time,
-                            TFeatureAnyPrVec& result) const;
+                            TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the non-zero counts for each attribute by person for the
     //! bucketing interval containing \p time.
@@ -328,14 +342,14 @@ private:
     //! product space of attribute and person so use a sparse encoding.
     void nonZeroAttributeCounts(model_t::EFeature feature,
                                 core_t::TTime time,
-                                TFeatureAnyPrVec& result) const;
+                                TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Append the number of unique people hitting each attribute.
     //!
     //! \param[in,out] result Append the count of people per attribute.
     //! The person identifier is dummied to zero so that the result
     //! type matches other population features.
-    void peoplePerAttribute(model_t::EFeature feature, TFeatureAnyPrVec& result) const;
+    void peoplePerAttribute(model_t::EFeature feature, TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Append an indicator function for (person, attribute) pairs
     //! present in the bucketing interval containing \p time.
@@ -349,7 +363,7 @@ private:
     //! product space of attribute and person so use a sparse encoding.
     void attributeIndicator(model_t::EFeature feature,
                             core_t::TTime time,
-                            TFeatureAnyPrVec& result) const;
+                            TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Append the number of unique values for each person
     //! in the bucketing interval containing \p time.
@@ -359,7 +373,7 @@ private:
     //! by person
     void bucketUniqueValuesPerPerson(model_t::EFeature feature,
                                      core_t::TTime time,
-                                     TFeatureAnyPrVec& result) const;
+                                     TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the number of unique values for each person and attribute
     //! in the bucketing interval containing \p time.
@@ -369,7 +383,7 @@ private:
     //! by person and attribute
     void bucketUniqueValuesPerPersonAttribute(model_t::EFeature feature,
                                               core_t::TTime time,
-                                              TFeatureAnyPrVec& result) const;
+                                              TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Append the compressed length of the unique attributes each person
     //! hits in the bucketing interval containing \p time.
@@ -379,7 +393,7 @@ private:
     //! unique values by person and attribute
     void bucketCompressedLengthPerPerson(model_t::EFeature feature,
                                          core_t::TTime time,
-                                         TFeatureAnyPrVec& result) const;
+                                         TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the compressed length of the unique attributes each person
     //! hits in the bucketing interval containing \p time.
@@ -389,7 +403,7 @@ private:
     //! unique values by person and attribute
     void bucketCompressedLengthPerPersonAttribute(model_t::EFeature feature,
                                                   core_t::TTime time,
-                                                  TFeatureAnyPrVec& result) const;
+                                                  TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Append the time-of-day/week values for each person in the
     //! bucketing interval \p time.
@@ -399,7 +413,7 @@ private:
     //! by person.
     void bucketMeanTimesPerPerson(model_t::EFeature feature,
                                   core_t::TTime time,
-                                  TFeatureAnyPrVec& result) const;
+                                  TFeatureSizeFeatureDataPrVecPrVec& result) const;
 
     //! Append the time-of-day/week values of each attribute and person
     //! in the bucketing interval \p time.
@@ -409,7 +423,7 @@ private:
     //! by attribute and person
     void bucketMeanTimesPerPersonAttribute(model_t::EFeature feature,
                                            core_t::TTime time,
-                                           TFeatureAnyPrVec& result) const;
+                                           TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
 
     //! Resize the necessary data structures so they can accommodate
     //! the person and attribute identified by \p pid and \p cid,
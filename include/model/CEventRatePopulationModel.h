@@ -297,6 +297,10 @@ public:
     //! Get the non-estimated memory used by this model.
     virtual std::size_t computeMemoryUsage() const;
 
+    //! Get the memory the models of the attributes waiting to be created,
+    //! or recycled, will use when they're created.
+    virtual std::size_t pendingMemoryUsage();
+
     //! Get a view of the internals of the model for visualization.
     virtual CModelDetailsViewPtr details() const;
 
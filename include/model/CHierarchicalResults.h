@@ -329,6 +329,16 @@ public:
     //! Add the influencer called \p name.
     void addInfluencer(const std::string& name);
 
+    //! Move the results and influencers added to \p other to the end of
+    //! these results.
+    //!
+    //! This is equivalent to having added \p other's results directly and
+    //! so lets results for separate detectors be built independently and
+    //! then combined in a fixed order.
+    //!
+    //! \note Neither set of results can have had its hierarchy built.
+    void append(CHierarchicalResults& other);
+
     //! Build a hierarchy from the current flat node list using the
     //! default aggregation rules.
     //!
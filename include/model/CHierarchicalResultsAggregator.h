@@ -7,6 +7,8 @@
 #ifndef INCLUDED_ml_model_CHierarchicalResultsAggregator_h
 #define INCLUDED_ml_model_CHierarchicalResultsAggregator_h
 
+#include <core/CMonotonicArena.h>
+
 #include <maths/CQuantileSketch.h>
 
 #include <model/CDetectorEqualizer.h>
@@ -82,7 +84,12 @@ private:
     using TDetectorEqualizerPtrVec = TBase::TTypePtrVec;
     using TIntSizePr = std::pair<int, std::size_t>;
     using TDouble1Vec = core::CSmallVector<double, 1>;
-    using TIntSizePrDouble1VecUMap = boost::unordered_map<TIntSizePr, TDouble1Vec>;
+    using TIntSizePrDouble1VecUMap =
+        boost::unordered_map<TIntSizePr,
+                             TDouble1Vec,
+                             boost::hash<TIntSizePr>,
+                             std::equal_to<TIntSizePr>,
+                             core::CMonotonicArenaAllocator<std::pair<const TIntSizePr, TDouble1Vec>>>;
 
 private:
     static const std::size_t N = model_t::E_AggregateAttributes + 1;
@@ -171,6 +171,10 @@ public:
     //! Get the non-estimated value of the the memory used by this model.
     virtual std::size_t computeMemoryUsage() const = 0;
 
+    //! Get the memory the models of the people waiting to be created, or
+    //! recycled, will use when they're created.
+    virtual std::size_t pendingMemoryUsage();
+
 protected:
     using TStrCRefDouble1VecDouble1VecPrPr = std::pair<TStrCRef, TDouble1VecDouble1VecPr>;
     using TStrCRefDouble1VecDouble1VecPrPrVec = std::vector<TStrCRefDouble1VecDouble1VecPrPr>;
@@ -43,6 +43,8 @@ public:
     using TCategorySizePrAnyMap = std::map<TCategorySizePr, boost::any>;
     using TCategorySizePrAnyMapItr = TCategorySizePrAnyMap::iterator;
     using TCategorySizePrAnyMapCItr = TCategorySizePrAnyMap::const_iterator;
+    using TFeatureSizeFeatureDataPrVecPrVec = TFeatureSizeMetricFeatureDataPrVecPrVec;
+    using TFeatureSizeSizePrFeatureDataPrVecPrVec = TFeatureSizeSizePrMetricFeatureDataPrVecPrVec;
 
 public:
     //! \name Life-cycle
@@ -163,6 +165,7 @@ public:
     //! specified. The third field should contain a number corresponding
     //! to the metric value.
     virtual bool processFields(const TStrCPtrVec& fieldValues,
+                               const TDoubleCPtrVec& numericValues,
                                CEventData& result,
                                CResourceMonitor& resourceMonitor);
     //@}
@@ -210,14 +213,25 @@ public:
 
     //! \name Features
     //@{
-    //! Get the raw data for all features for the bucketing time interval
-    //! containing \p time.
+    using CBucketGatherer::featureData;
+
+    //! Get the raw data for all individual features for the bucketing
+    //! time interval containing \p time.
+    //!
+    //! \param[in] time The time of interest.
+    //! \param[out] result Filled in with the feature data at \p time.
+    virtual void featureData(core_t::TTime time,
+                             core_t::TTime bucketLength,
+                             TFeatureSizeFeatureDataPrVecPrVec& result) const;
+
+    //! Get the raw data for all population features for the bucketing
+    //! time interval containing \p time.
     //!
     //! \param[in] time The time of interest.
     //! \param[out] result Filled in with the feature data at \p time.
     virtual void featureData(core_t::TTime time,
                              core_t::TTime bucketLength,
-                             TFeatureAnyPrVec& result) const;
+                             TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const;
     //@}
 
 private:
@@ -280,6 +280,10 @@ public:
     //! Get the non-estimated memory used by this model.
     virtual std::size_t computeMemoryUsage() const;
 
+    //! Get the memory the models of the attributes waiting to be created,
+    //! or recycled, will use when they're created.
+    virtual std::size_t pendingMemoryUsage();
+
 private:
     //! Initialize the feature models.
     void initialize(const TFeatureMathsModelPtrPrVec& newFeatureModels,
@@ -7,6 +7,7 @@
 #ifndef INCLUDED_ml_model_CModelFactory_h
 #define INCLUDED_ml_model_CModelFactory_h
 
+#include <core/CFastMutex.h>
 #include <core/CNonCopyable.h>
 #include <core/CoreTypes.h>
 
@@ -36,6 +37,7 @@ namespace maths {
 class CModel;
 class CMultinomialConjugate;
 class CMultivariatePrior;
+class CPeriodicityTestScheduler;
 class CPrior;
 class CTimeSeriesCorrelations;
 class CTimeSeriesDecompositionInterface;
@@ -134,6 +136,7 @@ public:
 
 public:
     CModelFactory(const SModelParams& params);
+    CModelFactory(const CModelFactory& other);
     virtual ~CModelFactory() = default;
 
     //! Create a copy of the factory owned by the calling code.
@@ -333,11 +336,22 @@ public:
     //! Set the periods and the number of points we'll use to model
     //! of the seasonal components in the data.
     void componentSize(std::size_t componentSize);
+
+    //! Set whether to store the time series models compactly.
+    void compactModels(bool compact);
+
+    //! Set whether to prune the residual models of time series without
+    //! seasonal or calendar components.
+    void pruneResidualModels(bool prune);
     //@}
 
     //! Update the bucket length, for ModelAutoConfig's benefit
     void updateBucketLength(core_t::TTime length);
 
+    //! Set the scheduler used to run the periodicity tests of the
+    //! time series models' decompositions.
+    void periodicityTestScheduler(maths::CPeriodicityTestScheduler* scheduler);
+
     //! Get global model configuration parameters.
     const SModelParams& modelParams() const;
 
@@ -430,6 +444,10 @@ private:
 
     //! A cache of influence calculators for collections of features.
     mutable TStrFeatureVecPrInfluenceCalculatorCPtrMap m_InfluenceCalculatorCache;
+
+    //! Protects the caches, which are filled in lazily and may be used by
+    //! detectors which are being restored concurrently.
+    mutable core::CFastMutex m_CacheMutex;
 };
 }
 }
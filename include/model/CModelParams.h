@@ -24,6 +24,7 @@
 
 namespace ml {
 namespace maths {
+class CPeriodicityTestScheduler;
 struct SDistributionRestoreParams;
 }
 namespace model {
@@ -92,6 +93,16 @@ struct MODEL_EXPORT SModelParams {
     //! The number of points to use for approximating each seasonal component.
     std::size_t s_ComponentSize;
 
+    //! If true then the time series models' periodicity test windows are
+    //! stored deflated.
+    bool s_CompactModels;
+
+    //! If true then the residual models of time series without seasonal or
+    //! calendar components are pruned of the distributions which no longer
+    //! explain the data.  This changes which distributions are available
+    //! for model selection so it's separate from s_CompactModels.
+    bool s_PruneResidualModels;
+
     //! Controls whether to exclude heavy hitters.
     model_t::EExcludeFrequent s_ExcludeFrequent;
 
@@ -161,6 +172,10 @@ struct MODEL_EXPORT SModelParams {
 
     //! The time window during which samples are accepted.
     core_t::TTime s_SamplingAgeCutoff;
+
+    //! The scheduler used to run periodicity tests, if any. This isn't
+    //! owned.
+    maths::CPeriodicityTestScheduler* s_PeriodicityTestScheduler;
 };
 }
 }
@@ -32,6 +32,7 @@
 namespace ml {
 namespace maths {
 class CModel;
+class CModelProbabilityParams;
 class CMultinomialConjugate;
 }
 namespace model {
@@ -210,23 +211,54 @@ public:
     //! This bounds the maximum relative error it'll introduce by only interpolating
     //! an interval if the difference in the probability at its end points satisfy
     //! \f$|P(b) - P(a)| < threshold \times min(P(A), P(b))\f$.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! The cache is shared across buckets. The owner must invalidate a model's
+    //! entry whenever the model changes, for example when samples are added to
+    //! it, and start a new generation each bucket. Each entry also records a
+    //! checksum of the parameters of the probability calculation, i.e. the
+    //! weights and so on, and is only used for calculations with the same
+    //! parameters.
+    //!
+    //! The cached probabilities aren't adjusted for the time elapsed since the
+    //! model was created, since this changes from one bucket to the next, so
+    //! the caller must apply model_t::adjustProbability to the result of a
+    //! lookup.
+    //!
+    //! The cache's memory is bounded: if it exceeds its budget the entries not
+    //! used in the current generation are removed first and if that isn't
+    //! enough everything is removed.
     class MODEL_EXPORT CProbabilityCache {
     public:
         using TTail2Vec = core::CSmallVector<maths_t::ETail, 2>;
         using TSize1Vec = core::CSmallVector<std::size_t, 1>;
 
     public:
-        explicit CProbabilityCache(double maximumError);
+        //! The default maximum memory the cache can use.
+        static const std::size_t DEFAULT_MEMORY_BUDGET;
+
+    public:
+        explicit CProbabilityCache(double maximumError,
+                                   std::size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
 
         //! Clear the cache.
         void clear();
 
+        //! Remove the entry for the model identified by \p feature and \p id.
+        //!
+        //! This must be called whenever the model is updated.
+        void invalidate(model_t::EFeature feature, std::size_t id);
+
+        //! Start a new generation, i.e. bucket.
+        void nextGeneration();
+
         //! Maybe add the modes of \p model.
         void addModes(model_t::EFeature feature, std::size_t id, const maths::CModel& model);
 
         //! Add a new ("value", "probability") result.
         //!
         //! \param[in] id The unique model identifier.
+        //! \param[in] params The parameters of the probability calculation.
         //! \param[in] value The value.
         //! \param[in] probability The result of running the probability
         //! calculation for \p value.
@@ -237,6 +269,7 @@ public:
         //! anomalous correlate (or empty if there isn't one).
         void addProbability(model_t::EFeature feature,
                             std::size_t id,
+                            const maths::CModelProbabilityParams& params,
                             const TDouble2Vec1Vec& value,
                             double probability,
                             const TTail2Vec& tail,
@@ -246,6 +279,7 @@ public:
         //! Try to lookup the probability of \p value in cache.
         //!
         //! \param[in] id The unique model identifier.
+        //! \param[in] params The parameters of the probability calculation.
         //! \param[in] value The value.
         //! \param[out] probability An estimate of the probability
         //! corresponding to \p likelihood.
@@ -258,12 +292,19 @@ public:
         //! acceptable error and false otherwise.
         bool lookup(model_t::EFeature feature,
                     std::size_t id,
+                    const maths::CModelProbabilityParams& params,
                     const TDouble2Vec1Vec& value,
                     double& probability,
                     TTail2Vec& tail,
                     bool& conditional,
                     TSize1Vec& mostAnomalousCorrelate) const;
 
+        //! Debug the memory used by this object.
+        void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
+
+        //! Get the memory used by this object.
+        std::size_t memoryUsage() const;
+
     private:
         using TDouble1Vec = core::CSmallVector<double, 1>;
 
@@ -284,10 +325,24 @@ public:
         //! \brief A cache of all the results of a probability calculation
         //! for a specific model.
         struct MODEL_EXPORT SProbabilityCache {
+            SProbabilityCache();
+
+            //! Debug the memory used by this object.
+            void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
+
+            //! Get the memory used by this object.
+            std::size_t memoryUsage() const;
+
             //! The modes of the model's residual distribution for which
             //! this is caching the result of the probability calculation.
             TDouble1Vec s_Modes;
 
+            //! A checksum of the parameters of the probability calculation.
+            uint64_t s_Parameters;
+
+            //! The last generation in which the cache was used.
+            mutable std::size_t s_Generation;
+
             //! The probability cache.
             TDoubleProbabilityFMap s_Probabilities;
         };
@@ -296,10 +351,26 @@ public:
         using TFeatureSizePrProbabilityCacheUMap =
             boost::unordered_map<TFeatureSizePr, SProbabilityCache>;
 
+    private:
+        //! Get a checksum of the parameters of the probability calculation.
+        static uint64_t checksum(const maths::CModelProbabilityParams& params);
+
+        //! Remove entries until the cache is within its memory budget.
+        void prune();
+
     private:
         //! The maximum relative error we'll tolerate in the probability.
         double m_MaximumError;
 
+        //! The maximum memory the cache can use.
+        std::size_t m_MemoryBudget;
+
+        //! The current generation.
+        std::size_t m_Generation;
+
+        //! The total number of cached probabilities.
+        std::size_t m_NumberProbabilities;
+
         //! The univariate probability cache.
         TFeatureSizePrProbabilityCacheUMap m_Caches;
     };
@@ -6,13 +6,17 @@
 #ifndef INCLUDED_ml_model_CResourceMonitor_h
 #define INCLUDED_ml_model_CResourceMonitor_h
 
+#include <core/CFastMutex.h>
+#include <core/CNonCopyable.h>
 #include <core/CoreTypes.h>
 
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
+#include <vector>
 
 class CResourceMonitorTest;
 class CResourceLimitTest;
@@ -29,6 +33,21 @@ class CResourcePruner;
 //!
 //! DESCRIPTION:\n
 //! Assess memory used by models and decide on further memory allocations.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The total is maintained incrementally. A refresh measures the refreshed
+//! model with its memoryUsage, which uses the model's CMemoryUsageEstimator
+//! where possible and computes the usage in full otherwise, and applies the
+//! change from its previous usage to the total. The string stores keep
+//! running totals which they update as they change, so the total is cheap
+//! to read at any time. The per model and total counters are atomic and the
+//! registered models are looked up under a mutex, so detectors can be
+//! refreshed concurrently.
+//!
+//! Each usage report walks one model, in turn, and publishes the difference
+//! between its walked usage and its usage at the last refresh as the
+//! E_MemoryUsageDrift statistic. The walked usage is only used for the
+//! statistic.
 class MODEL_EXPORT CResourceMonitor {
 public:
     struct MODEL_EXPORT SResults {
@@ -42,11 +61,26 @@ public:
     };
 
 public:
-    using TModelPtrSizePr = std::pair<CAnomalyDetectorModel*, std::size_t>;
-    using TModelPtrSizeMap = std::map<CAnomalyDetectorModel*, std::size_t>;
+    using TAtomicSize = std::atomic<std::size_t>;
+
+    //! The memory usage of a model as of its last refresh.
+    struct MODEL_EXPORT SModelUsage {
+        explicit SModelUsage(std::size_t usage) : s_Usage(usage) {}
+
+        TAtomicSize s_Usage;
+    };
+    using TModelPtrModelUsageMap = std::map<CAnomalyDetectorModel*, SModelUsage>;
     using TMemoryUsageReporterFunc = std::function<void(const CResourceMonitor::SResults&)>;
     using TTimeSizeMap = std::map<core_t::TTime, std::size_t>;
 
+    //! The extra memory added by a task while refreshes are deferred and
+    //! whether the task cleared the extra memory first.
+    struct MODEL_EXPORT SDeferredExtraMemory {
+        bool s_Cleared = false;
+        std::size_t s_Extra = 0;
+    };
+    using TDeferredExtraMemoryVec = std::vector<SDeferredExtraMemory>;
+
     //! The minimum time between prunes
     static const core_t::TTime MINIMUM_PRUNE_FREQUENCY;
 
@@ -70,13 +104,17 @@ public:
 
     //! Tell this resource monitor about a CAnomalyDetector class -
     //! these classes contain all the model memory and are used
-    //! to query the current overall usage
+    //! to query the current overall usage.  This is thread safe, so
+    //! detectors can be restored concurrently.
     void registerComponent(CAnomalyDetector& detector);
 
     //! Tell this resource monitor that a CAnomalyDetector class is
-    //! going to be deleted.
+    //! going to be deleted.  This is thread safe.
     void unRegisterComponent(CAnomalyDetector& detector);
 
+    //! Get the memory usage of \p detector's model as of its last refresh.
+    std::size_t componentMemoryUsage(const CAnomalyDetector& detector) const;
+
     //! Set a callback used when the memory usage grows
     void memoryUsageReporter(const TMemoryUsageReporterFunc& reporter);
 
@@ -86,6 +124,13 @@ public:
     //! Recalculate the memory usage regardless of whether there is a memory limit
     void forceRefresh(CAnomalyDetector& detector);
 
+    //! Walk \p detector's model, publish the difference between the walked
+    //! memory usage and the usage at its last refresh as the drift and
+    //! return it. This doesn't change the usage.
+    //!
+    //! \warning This must not be called whilst \p detector is updated.
+    std::size_t verifyMemoryUsage(const CAnomalyDetector& detector);
+
     //! Set the internal memory limit, as specified in a limits config file
     void memoryLimit(std::size_t limitMBs);
 
@@ -127,6 +172,85 @@ public:
     //! Clears all extra memory
     void clearExtraMemory();
 
+    //! Set the memory used by the job outside the models, such as the
+    //! arena for the transient containers of a bucket's results.
+    void workingMemoryUsage(std::size_t usage);
+
+    //! Can refreshes be deferred without changing any allocation decision?
+    //!
+    //! Allocations are only refused once the usage nears the limit, so this
+    //! is true if there's no limit, or the limit hasn't come into play and
+    //! the usage, including the extra memory reserved for models which are
+    //! about to be created, plus \p extraMemory is below the prune threshold.
+    //!
+    //! \param[in] extraMemory An upper bound on the growth in the usage
+    //! whilst deferring.  Deferring is only allowed if the usage can't reach
+    //! the prune threshold, and so the limit can't come into play, before
+    //! the refreshes are committed.
+    bool canDeferRefreshes(std::size_t extraMemory = 0) const;
+
+    //! Can the detectors sample a bucket with refreshes deferred without
+    //! changing any allocation decision?
+    //!
+    //! Whilst sampling the models' usage can grow by the memory of the new
+    //! models, \p pendingMemory, and as other models are updated.  The
+    //! latter is bounded by the most the refreshed usage, which includes
+    //! the growth of the existing models, has grown sampling any bucket so
+    //! far.  That also includes the new models, so this can only overestimate
+    //! the growth.
+    bool canDeferSampling(std::size_t pendingMemory) const;
+
+    //! Note that the detectors are about to sample a bucket.
+    void startSampling();
+
+    //! Note that the detectors have sampled the bucket and remember the
+    //! growth in the models' usage if it's the most so far.
+    void finishSampling();
+
+    //! Start deferring refreshes so that detectors can be updated
+    //! concurrently.
+    //!
+    //! Until commitDeferredRefreshes() is called, the changes in the models'
+    //! memory usage are accumulated separately from the total, which is safe
+    //! to do concurrently for distinct detectors, and extra memory is put
+    //! aside and clearing it is put off until commit.  The totals, and so
+    //! all the allocation decisions taken meanwhile, are those at the point
+    //! deferral started, irrespective of the order in which the detectors
+    //! are processed.  Check canDeferRefreshes() first if these must be the
+    //! same as when the detectors are refreshed one at a time.
+    //!
+    //! \param[in] numberTasks The number of tasks the work is split into.
+    //! The extra memory added and cleared by each task, identified by a
+    //! CScopedDeferredTask, is applied on commit in task order, so it ends
+    //! up the same as if the tasks had been run one after another.
+    void deferRefreshes(std::size_t numberTasks = 0);
+
+    //! Update the totals with the memory usage computed by any refreshes
+    //! and the extra memory added or cleared since deferRefreshes() was
+    //! called, and go back to updating them immediately.
+    //!
+    //! Extra memory added or cleared outside any task is applied first.
+    void commitDeferredRefreshes();
+
+public:
+    //! \brief Identifies the deferred task the current thread is running.
+    //!
+    //! DESCRIPTION:\n
+    //! While this exists the extra memory the current thread adds to or
+    //! clears from \p monitor is recorded against task \p task.
+    class MODEL_EXPORT CScopedDeferredTask : private core::CNonCopyable {
+    public:
+        CScopedDeferredTask(const CResourceMonitor& monitor, std::size_t task);
+        ~CScopedDeferredTask();
+
+    private:
+        //! The monitor of the task the thread was previously running.
+        const CResourceMonitor* m_PreviousMonitor;
+
+        //! The task the thread was previously running.
+        std::size_t m_PreviousTask;
+    };
+
 private:
     //! Updates the memory limit fields and the prune threshold
     //! to the given value.
@@ -135,6 +259,20 @@ private:
     //! Update the given model and recalculate the total usage
     void memUsage(CAnomalyDetectorModel* model);
 
+    //! Walk the given model, publish the drift between its walked memory
+    //! usage and \p usage and return it.
+    std::size_t verify(const CAnomalyDetectorModel* model, std::size_t usage);
+
+    //! Verify the memory usage of the model after the last one verified.
+    void verifyNextModel();
+
+    //! Get the entry for the given model or null if it isn't registered.
+    SModelUsage* modelUsage(CAnomalyDetectorModel* model);
+
+    //! Update the usage of the given model to \p modelCurrentUsage and
+    //! apply the change to the total usage
+    void memUsage(CAnomalyDetectorModel* model, std::size_t modelCurrentUsage);
+
     //! Determine if we need to send a usage report, based on
     //! increased usage, or increased errors
     bool needToSendReport();
@@ -146,9 +284,13 @@ private:
     //! Returns the sum of used memory plus any extra memory
     std::size_t totalMemory() const;
 
+    //! Get the deferred task the current thread is running for this
+    //! monitor or null if there isn't one.
+    SDeferredExtraMemory* deferredTask();
+
 private:
-    //! The registered collection of components
-    TModelPtrSizeMap m_Models;
+    //! The registered collection of components and their memory usage
+    TModelPtrModelUsageMap m_Models;
 
     //! Is there enough free memory to allow creating new components
     bool m_AllowAllocations;
@@ -160,11 +302,14 @@ private:
     std::size_t m_ByteLimitLow;
 
     //! Memory usage by anomaly detectors on the most recent calculation
-    std::size_t m_CurrentAnomalyDetectorMemory;
+    TAtomicSize m_CurrentAnomalyDetectorMemory;
 
     //! Extra memory to enable accounting of soon to be allocated memory
     std::size_t m_ExtraMemory;
 
+    //! The memory used by the job outside the models
+    std::size_t m_WorkingMemory;
+
     //! The total memory usage on the previous usage report
     std::size_t m_PreviousTotal;
 
@@ -205,6 +350,37 @@ private:
     //! Don't do any sort of memory checking if this is set
     bool m_NoLimit;
 
+    //! The model whose memory usage was last verified
+    CAnomalyDetectorModel* m_LastVerifiedModel;
+
+    //! The models' memory usage when the detectors started sampling the
+    //! current bucket.
+    std::size_t m_SamplingStartMemory;
+
+    //! The most the models' memory usage has grown sampling a bucket.
+    std::size_t m_LargestSamplingGrowth;
+
+    //! Are refreshes currently being deferred?
+    bool m_DeferRefreshes;
+
+    //! The change in the models' memory usage while refreshes were
+    //! deferred (modulo 2^n).
+    TAtomicSize m_DeferredAnomalyDetectorMemory;
+
+    //! The extra memory added while refreshes were deferred.
+    TAtomicSize m_DeferredExtraMemory;
+
+    //! Was the extra memory cleared while refreshes were deferred?
+    std::atomic_bool m_DeferredClearExtraMemory;
+
+    //! The extra memory added and cleared by each deferred task.
+    TDeferredExtraMemoryVec m_DeferredTasks;
+
+    //! Protects the registered components while detectors are restored
+    //! or refreshed concurrently and the allocation failures while they
+    //! are sampled concurrently.
+    mutable core::CFastMutex m_Mutex;
+
     //! Test friends
     friend class ::CResourceMonitorTest;
     friend class ::CResourceLimitTest;
@@ -13,11 +13,14 @@
 
 #include <model/ImportExport.h>
 
+#include <boost/optional.hpp>
 #include <boost/unordered_set.hpp>
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 class CResourceMonitorTest;
 class CStringStoreTest;
@@ -47,8 +50,27 @@ namespace model {
 //! A singleton class: there should only be one collection strings for
 //! person names/attributes, and a separate collection for influencer
 //! strings.
-//! Write access is locked for the benefit of future threading.
 //!
+//! The strings are split between a fixed number of shards by their hash.
+//! Each shard has its own read and write fences so lookups are lock free
+//! and threads interning different strings rarely touch the same cache
+//! lines. Inserts, which are expected to be rare, are synchronized with a
+//! mutex per shard.
+//!
+//! Each thread also has a small direct mapped cache of the strings it has
+//! recently looked up, which is checked before the shards. This avoids
+//! the fences altogether for the frequently repeated values which make up
+//! most records. The cache holds weak references so it never stops a
+//! string being pruned.
+//!
+//! Stored strings are compared by address, so a lookup always returns the
+//! pointer held by the store and never a copy.
+//!
+//! Pruning is safe to call concurrently with lookups. It fences one shard
+//! at a time so lookups of strings in the shard being pruned wait until it
+//! finishes. The store counts the prunes it starts and a thread's cache
+//! entries from before the latest one aren't used, since the strings they
+//! refer to may have been removed from the store.
 class MODEL_EXPORT CStringStore : private core::CNonCopyable {
 public:
     struct MODEL_EXPORT SHashStoredStringPtr {
@@ -64,9 +86,20 @@ public:
         }
     };
 
+    using TOptionalStr = boost::optional<std::string>;
+    using TOptionalStrVec = std::vector<TOptionalStr>;
+    using TStoredStringPtrVec = std::vector<core::CStoredStringPtr>;
+
+public:
+    //! The number of shards between which the strings are split.
+    static const std::size_t NUMBER_SHARDS;
+
+    //! The number of entries in each thread's cache of recent lookups.
+    static const std::size_t THREAD_CACHE_SIZE;
+
 public:
     //! Call this to tidy up any strings no longer needed.
-    static void tidyUpNotThreadSafe();
+    static void tidyUp();
 
     //! Singleton pattern for person/attribute names.
     static CStringStore& names();
@@ -80,57 +113,137 @@ public:
     //! (Possibly) add \p value to the store and get back a pointer to it.
     core::CStoredStringPtr get(const std::string& value);
 
+    //! (Possibly) add each of \p values to the store and get back pointers
+    //! to them in \p result.
+    //!
+    //! Missing values get a null pointer. This visits each shard at most
+    //! once so is cheaper than getting the values one at a time.
+    void get(const TOptionalStrVec& values, TStoredStringPtrVec& result);
+
     //! (Possibly) remove \p value from the store.
     void remove(const std::string& value);
 
     //! Prune strings which have been removed.
-    void pruneRemovedNotThreadSafe();
+    void pruneRemoved();
 
     //! Iterate over the string store and remove unused entries.
-    void pruneNotThreadSafe();
+    void prune();
 
     //! Get the memory used by this string store
     void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
 
     //! Get the memory used by this string store
+    //!
+    //! \note This doesn't lock the shards so is cheap to call often.
     std::size_t memoryUsage() const;
 
 private:
     using TStoredStringPtrUSet =
         boost::unordered_set<core::CStoredStringPtr, SHashStoredStringPtr, SStoredStringPtrEqual>;
     using TStrVec = std::vector<std::string>;
+    using TSizeVec = std::vector<std::size_t>;
+
+    //! \brief A subset of the strings selected by their hash.
+    struct SShard {
+        explicit SShard(std::atomic<std::size_t>& memoryUsage);
+
+        //! Get the shared pointer for \p value, adding it to the set if
+        //! necessary.
+        core::CStoredStringPtr get(const std::string& value, std::size_t hash);
+
+        //! Get the pointer for \p value in the set, adding it if necessary.
+        //! This must be called with the mutex locked and no readers.
+        core::CStoredStringPtr findOrInsert(const std::string& value, std::size_t hash);
+
+        //! Remove the strings in the set for which \p pred is true.
+        template<typename PRED>
+        void erase(PRED pred);
+
+        //! Report the change in the memory used by this shard to the
+        //! store. This must be called with the mutex locked.
+        void updateMemoryUsage();
+
+        //! Fence for reading operations (writers wait for these to finish).
+        //! See get for details.
+        std::atomic_int s_Reading;
+
+        //! Fence for writing operations (readers then wait on the mutex).
+        //! See get for details.
+        std::atomic_int s_Writing;
+
+        //! Set to keep the person/attribute string pointers
+        TStoredStringPtrUSet s_Strings;
+
+        //! A list of the strings to remove.
+        TStrVec s_Removed;
+
+        //! Running count of memory usage by stored strings.  Avoids the need to
+        //! recalculate repeatedly.
+        std::size_t s_StoredStringsMemUse;
+
+        //! The memory used by this shard when it was last reported.
+        std::size_t s_MemoryUsage;
+
+        //! The store's running count of the memory used by its shards.
+        std::atomic<std::size_t>& s_StoreMemoryUsage;
+
+        //! Locking primitive
+        mutable core::CFastMutex s_Mutex;
+    };
+    using TShardPtr = std::unique_ptr<SShard>;
+    using TShardPtrVec = std::vector<TShardPtr>;
+
+    //! \brief An entry in a thread's cache of recent lookups.
+    struct SCacheEntry {
+        //! The hash of the string.
+        std::size_t s_Hash = 0;
+
+        //! The number of prunes the store had started before the string
+        //! was looked up.
+        std::size_t s_Prunes = 0;
+
+        //! The string.
+        core::CStoredStringPtr::CWeak s_String;
+    };
+    using TCacheEntryVec = std::vector<SCacheEntry>;
 
 private:
     //! Constructor of a Singleton is private.
-    CStringStore();
+    explicit CStringStore(std::size_t index);
+
+    //! Get the calling thread's cache of recent lookups in this store.
+    TCacheEntryVec& threadCache() const;
+
+    //! Get the string for \p value with hash \p hash from the cache entry
+    //! \p entry, or null if it isn't there or may have been pruned.
+    core::CStoredStringPtr
+    lookUpCache(const SCacheEntry& entry, std::size_t hash, const std::string& value) const;
+
+    //! Get the shard for a string with hash \p hash.
+    SShard& shard(std::size_t hash) const;
+
+    //! Get the total number of strings in the store.
+    std::size_t size() const;
 
     //! Bludgeoning device to delete all objects in store.
     void clearEverythingTestOnly();
 
 private:
-    //! Fence for reading operations (in which case we "leak" a string
-    //! if we try to write at the same time). See get for details.
-    std::atomic_int m_Reading;
-
-    //! Fence for writing operations (in which case we "leak" a string
-    //! if we try to read at the same time). See get for details.
-    std::atomic_int m_Writing;
+    //! The index of this store, used to find the thread caches.
+    std::size_t m_Index;
 
     //! The empty string is often used so we store it outside the set.
     core::CStoredStringPtr m_EmptyString;
 
-    //! Set to keep the person/attribute string pointers
-    TStoredStringPtrUSet m_Strings;
-
-    //! A list of the strings to remove.
-    TStrVec m_Removed;
+    //! Running count of the memory used by the shards, which they update
+    //! as they change, so memoryUsage needn't lock them.
+    std::atomic<std::size_t> m_MemoryUsage;
 
-    //! Running count of memory usage by stored strings.  Avoids the need to
-    //! recalculate repeatedly.
-    std::size_t m_StoredStringsMemUse;
+    //! The number of prunes which have started.
+    std::atomic<std::size_t> m_Prunes;
 
-    //! Locking primitive
-    mutable core::CFastMutex m_Mutex;
+    //! The shards.
+    TShardPtrVec m_Shards;
 
     friend class ::CResourceMonitorTest;
     friend class ::CStringStoreTest;
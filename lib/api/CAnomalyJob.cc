@@ -5,16 +5,21 @@
  */
 #include <api/CAnomalyJob.h>
 
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
 #include <core/CDataAdder.h>
 #include <core/CDataSearcher.h>
 #include <core/CFunctional.h>
 #include <core/CJsonStatePersistInserter.h>
 #include <core/CJsonStateRestoreTraverser.h>
 #include <core/CLogger.h>
+#include <core/CScopedFastLock.h>
+#include <core/CScopedLock.h>
 #include <core/CScopedRapidJsonPoolAllocator.h>
 #include <core/CStateCompressor.h>
 #include <core/CStateDecompressor.h>
 #include <core/CStatistics.h>
+#include <core/CStopWatch.h>
 #include <core/CStringUtils.h>
 #include <core/CTimeUtils.h>
 #include <core/Constants.h>
@@ -24,6 +29,7 @@
 #include <maths/CTools.h>
 
 #include <model/CAnomalyScore.h>
+#include <model/CDataGatherer.h>
 #include <model/CForecastDataSink.h>
 #include <model/CHierarchicalResultsAggregator.h>
 #include <model/CHierarchicalResultsPopulator.h>
@@ -32,6 +38,7 @@
 #include <model/CSearchKey.h>
 #include <model/CSimpleCountDetector.h>
 #include <model/CStringStore.h>
+#include <model/FunctionTypes.h>
 
 #include <api/CBackgroundPersister.h>
 #include <api/CConfigUpdater.h>
@@ -41,10 +48,17 @@
 #include <api/CModelPlotDataJsonWriter.h>
 
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <set>
 #include <sstream>
 #include <string>
 
@@ -54,6 +68,7 @@ namespace api {
 // We use short field names to reduce the state size
 namespace {
 using TStrCRef = boost::reference_wrapper<const std::string>;
+using TStrSet = std::set<std::string>;
 
 //! Convert a (string, key) pair to something readable.
 template<typename T>
@@ -72,10 +87,104 @@ const std::string HIERARCHICAL_RESULTS_TAG("f");
 const std::string LATEST_RECORD_TIME_TAG("h");
 const std::string MODEL_PLOT_TAG("i");
 const std::string LAST_RESULTS_TIME_TAG("j");
+const std::string SNAPSHOT_ID_TAG("k");
+const std::string BASE_SNAPSHOT_ID_TAG("l");
+const std::string PREVIOUS_SNAPSHOT_ID_TAG("m");
+const std::string NUMBER_DETECTORS_TAG("n");
+
+//! The maximum number of records to queue before adding them to the detectors
+const std::size_t MAX_PENDING_RECORDS(10000);
+
+//! The maximum number of detectors whose compressed state is held in memory
+//! at once when persisting
+const std::size_t MAX_COMPRESSED_DETECTORS(256);
+
+//! The maximum number of detector documents held in memory at once when
+//! restoring in parallel
+const std::size_t MAX_RESTORED_DETECTORS(256);
+
+//! Marks a detector field of interest with an empty name in the positions
+//! of fields in records passed to handleFieldValues().
+const std::size_t NO_FIELD_NAME(std::numeric_limits<std::size_t>::max());
+
+//! Get the position of \p fieldName in \p fieldNames, or the number of field
+//! names if it isn't present.
+std::size_t fieldIndex(const std::string& fieldName, const CAnomalyJob::TStrVec& fieldNames) {
+    return static_cast<std::size_t>(
+        std::find(fieldNames.begin(), fieldNames.end(), fieldName) - fieldNames.begin());
+}
 
 //! The minimum version required to read the state corresponding to a model snapshot.
 //! This should be updated every time there is a breaking change to the model state.
-const std::string MODEL_SNAPSHOT_MIN_VERSION("6.3.0");
+//! Snapshots are written as a header document followed by one compressed
+//! document per detector, and may be deltas, which versions before 7.0.0
+//! can't read.  Snapshots from earlier versions, which hold the detectors in
+//! the first document and have no detector count, are still restored.
+const std::string MODEL_SNAPSHOT_MIN_VERSION("7.0.0");
+
+//! Write a state document with \p persist, in the compact binary format
+//! if \p binary is true and as JSON otherwise, and compress it independently
+//! of any other document.
+template<typename PERSIST>
+std::string compressDocument(const PERSIST& persist, bool binary) {
+    std::ostringstream strm;
+    if (binary) {
+        core::CBinaryStatePersistInserter inserter(strm);
+        persist(inserter);
+    } else {
+        core::CJsonStatePersistInserter inserter(strm);
+        persist(inserter);
+    }
+    return core::CStateCompressor::compressShard(strm.str());
+}
+
+//! Restore the next state document in \p strm with \p restore, which is
+//! passed a traverser for whichever format the document was written in.
+template<typename RESTORE>
+bool restoreDocument(std::istream& strm, const RESTORE& restore) {
+    if (core::CBinaryStateRestoreTraverser::isBinaryState(strm)) {
+        core::CBinaryStateRestoreTraverser traverser(strm);
+        bool restored{restore(traverser)};
+        // Read to the end of the document, so the stream is positioned at
+        // the start of the next one, even if restoring stopped early
+        while (traverser.next()) {
+        }
+        return restored;
+    }
+    core::CJsonStateRestoreTraverser traverser(strm);
+    return restore(traverser);
+}
+
+//! Read the next state document in \p strm, without restoring it, into
+//! \p document.  JSON documents are each written on their own line.
+bool readDocument(std::istream& strm, std::string& document) {
+    if (core::CBinaryStateRestoreTraverser::isBinaryState(strm)) {
+        return core::CBinaryStateRestoreTraverser::readDocument(strm, document);
+    }
+    return std::getline(strm >> std::ws, document).fail() == false;
+}
+
+//! Copy \p detector so that it can be persisted while the original changes.
+CAnomalyJob::TAnomalyDetectorPtr copyForPersistence(const model::CAnomalyDetector& detector) {
+    if (detector.isSimpleCount()) {
+        return std::make_shared<model::CSimpleCountDetector>(true, detector);
+    }
+    return std::make_shared<model::CAnomalyDetector>(true, detector);
+}
+
+//! Remove any null detectors from \p detectors.
+void removeNullDetectors(CAnomalyJob::TKeyCRefAnomalyDetectorPtrPrVec& detectors) {
+    detectors.erase(std::remove_if(detectors.begin(), detectors.end(),
+                                   [](const CAnomalyJob::TKeyCRefAnomalyDetectorPtrPr& detector) {
+                                       if (detector.second == nullptr) {
+                                           LOG_ERROR(<< "Unexpected NULL pointer for key '"
+                                                     << pairDebug(detector.first) << '\'');
+                                           return true;
+                                       }
+                                       return false;
+                                   }),
+                    detectors.end());
+}
 }
 
 // Statics
@@ -96,11 +205,16 @@ CAnomalyJob::CAnomalyJob(const std::string& jobId,
                          core_t::TTime maxQuantileInterval,
                          const std::string& timeFieldName,
                          const std::string& timeFieldFormat,
-                         size_t maxAnomalyRecords)
+                         size_t maxAnomalyRecords,
+                         std::size_t numberThreads,
+                         std::size_t maxDeltaSnapshots,
+                         std::size_t periodicityTestSpread,
+                         bool binaryState)
     : m_JobId(jobId), m_Limits(limits), m_OutputStream(outputStream),
       m_ForecastRunner(m_JobId, m_OutputStream, limits.resourceMonitor()),
       m_JsonOutputWriter(m_JobId, m_OutputStream), m_FieldConfig(fieldConfig),
       m_ModelConfig(modelConfig), m_NumRecordsHandled(0),
+      m_ControlFieldIndex(0), m_TimeFieldIndex(0),
       m_LastFinalisedBucketEndTime(0), m_PersistCompleteFunc(persistCompleteFunc),
       m_TimeFieldName(timeFieldName), m_TimeFieldFormat(timeFieldFormat),
       m_MaxDetectors(std::numeric_limits<size_t>::max()),
@@ -109,15 +223,35 @@ CAnomalyJob::CAnomalyJob(const std::string& jobId,
       m_LastNormalizerPersistTime(core::CTimeUtils::now()), m_LatestRecordTime(0),
       m_LastResultsTime(0), m_Aggregator(modelConfig), m_Normalizer(modelConfig),
       m_ResultsQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength()),
-      m_ModelPlotQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength(), 0) {
+      m_ModelPlotQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength(), 0),
+      m_NumberPendingRecords(0), m_MaxDeltaSnapshots(maxDeltaSnapshots),
+      m_BinaryState(binaryState), m_LastSnapshotTimestamp(0), m_NumberDeltaSnapshots(0),
+      m_ForceFullSnapshot(false) {
     m_JsonOutputWriter.limitNumberRecords(maxAnomalyRecords);
 
+    // The thread calling outputResults() does its share of the work
+    if (numberThreads > 1) {
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+        m_PendingRecords.resize(numberThreads);
+        LOG_DEBUG(<< "Using " << numberThreads << " threads to process detectors");
+    }
+
+    if (periodicityTestSpread > 0) {
+        m_PeriodicityTestScheduler =
+            std::make_unique<maths::CPeriodicityTestScheduler>(periodicityTestSpread);
+        m_ModelConfig.periodicityTestScheduler(m_PeriodicityTestScheduler.get());
+        LOG_DEBUG(<< "Spreading periodicity tests over " << periodicityTestSpread << " buckets");
+    }
+
     m_Limits.resourceMonitor().memoryUsageReporter(
         boost::bind(&CJsonOutputWriter::reportMemoryUsage, &m_JsonOutputWriter, _1));
 }
 
 CAnomalyJob::~CAnomalyJob() {
     m_ForecastRunner.finishForecasts();
+    if (m_PeriodicityTestScheduler != nullptr) {
+        m_ModelConfig.periodicityTestScheduler(nullptr);
+    }
 }
 
 void CAnomalyJob::newOutputStream() {
@@ -135,7 +269,6 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
         return this->handleControlMessage(iter->second);
     }
 
-    core_t::TTime time(0);
     iter = dataRowFields.find(m_TimeFieldName);
     if (iter == dataRowFields.end()) {
         core::CStatistics::stat(stat_t::E_NumberRecordsNoTimeField).increment();
@@ -143,37 +276,13 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
                   << core_t::LINE_ENDING << this->debugPrintRecord(dataRowFields));
         return true;
     }
-    if (m_TimeFieldFormat.empty()) {
-        if (core::CStringUtils::stringToType(iter->second, time) == false) {
-            core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
-            LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName
-                      << " field in record:" << core_t::LINE_ENDING
-                      << this->debugPrintRecord(dataRowFields));
-            return true;
-        }
-    } else {
-        // Use this library function instead of raw strptime() as it works
-        // around many operating system specific issues.
-        if (core::CTimeUtils::strptime(m_TimeFieldFormat, iter->second, time) == false) {
-            core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
-            LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName << " field using format "
-                      << m_TimeFieldFormat << " in record:" << core_t::LINE_ENDING
-                      << this->debugPrintRecord(dataRowFields));
-            return true;
-        }
-    }
 
-    // This record must be within the specified latency. If latency
-    // is zero, then it should be after the current bucket end. If
-    // latency is non-zero, then it should be after the current bucket
-    // end minus the latency.
-    if (time < m_LastFinalisedBucketEndTime) {
-        core::CStatistics::stat(stat_t::E_NumberTimeOrderErrors).increment();
-        std::ostringstream ss;
-        ss << "Records must be in ascending time order. "
-           << "Record '" << this->debugPrintRecord(dataRowFields) << "' time "
-           << time << " is before bucket time " << m_LastFinalisedBucketEndTime;
-        LOG_ERROR(<< ss.str());
+    core_t::TTime time(0);
+    if (this->parseRecordTime(iter->second,
+                              [&dataRowFields]() {
+                                  return debugPrintRecord(dataRowFields);
+                              },
+                              time) == false) {
         return true;
     }
 
@@ -203,18 +312,257 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
             continue;
         }
 
-        this->addRecord(detector, time, dataRowFields);
+        this->addRecord(detector, time, partitionFieldValue, dataRowFields);
+    }
+
+    this->recordHandled(time);
+
+    return true;
+}
+
+bool CAnomalyJob::handleFieldNames(const TStrVec& fieldNames) {
+    m_FieldNames = fieldNames;
+    m_ControlFieldIndex = fieldIndex(CONTROL_FIELD_NAME, m_FieldNames);
+    m_TimeFieldIndex = fieldIndex(m_TimeFieldName, m_FieldNames);
+    m_FieldTypes.assign(m_FieldNames.size(), CInputParser::E_String);
+    m_FormatNumericFields.assign(m_FieldNames.size(), false);
+    m_NumericFieldStrings.resize(m_FieldNames.size());
+
+    // The positions of the detectors' fields are resolved on demand
+    m_DetectorFieldIndices.clear();
+
+    return true;
+}
+
+bool CAnomalyJob::handleTypedFieldNames(const TStrVec& fieldNames,
+                                        const TFieldTypeVec& fieldTypes) {
+    if (fieldTypes.size() != fieldNames.size()) {
+        LOG_ERROR(<< "Got " << fieldTypes.size() << " field types for "
+                  << fieldNames.size() << " fields");
+        return false;
+    }
+
+    this->handleFieldNames(fieldNames);
+    m_FieldTypes = fieldTypes;
+
+    // Numbers are passed straight through for the fields the detectors
+    // analyse as metrics and for the summary count.  Any other use of a
+    // numeric field needs it as a string, so it's formatted once per record.
+    TStrSet numericOnly;
+    TStrSet usedAsString(m_FieldConfig.influencerFieldNames().begin(),
+                         m_FieldConfig.influencerFieldNames().end());
+    usedAsString.insert(m_FieldConfig.categorizationFieldName());
+    if (m_FieldConfig.summaryCountFieldName().empty() == false) {
+        numericOnly.insert(m_FieldConfig.summaryCountFieldName());
+    }
+    for (const auto& fieldOptions : m_FieldConfig.fieldOptions()) {
+        (model::function_t::isMetric(fieldOptions.function()) ? numericOnly : usedAsString)
+            .insert(fieldOptions.fieldName());
+        usedAsString.insert(fieldOptions.byFieldName());
+        usedAsString.insert(fieldOptions.overFieldName());
+        usedAsString.insert(fieldOptions.partitionFieldName());
+    }
+    for (std::size_t i = 0; i < m_FieldNames.size(); ++i) {
+        m_FormatNumericFields[i] =
+            m_FieldTypes[i] != CInputParser::E_String && i != m_TimeFieldIndex &&
+            (numericOnly.count(m_FieldNames[i]) == 0 ||
+             usedAsString.count(m_FieldNames[i]) > 0);
+        if (m_FormatNumericFields[i]) {
+            LOG_DEBUG(<< "Numeric field " << m_FieldNames[i]
+                      << " will be converted to a string for every record");
+        }
     }
 
+    return true;
+}
+
+bool CAnomalyJob::handleFieldValues(const TStrVec& fieldValues) {
+    static const TDoubleVec NO_NUMERIC_VALUES;
+    return this->handleTypedFieldValues(fieldValues, NO_NUMERIC_VALUES);
+}
+
+bool CAnomalyJob::handleTypedFieldValues(const TStrVec& fieldValues,
+                                         const TDoubleVec& numericValues) {
+    if (fieldValues.size() != m_FieldNames.size()) {
+        LOG_ERROR(<< "Record has " << fieldValues.size() << " fields but "
+                  << m_FieldNames.size() << " field names were supplied");
+        return false;
+    }
+
+    bool haveNumericValues = numericValues.size() == fieldValues.size();
+    for (std::size_t i = 0; i < m_FieldTypes.size(); ++i) {
+        if (m_FieldTypes[i] != CInputParser::E_String) {
+            if (haveNumericValues == false) {
+                LOG_ERROR(<< "Record has no value for numeric field " << m_FieldNames[i]);
+                return false;
+            }
+            if (m_FormatNumericFields[i]) {
+                CInputParser::formatNumericValue(m_FieldTypes[i], numericValues[i],
+                                                 m_NumericFieldStrings[i]);
+            }
+        }
+    }
+
+    // Non-empty control fields take precedence over everything else
+    if (m_ControlFieldIndex < fieldValues.size()) {
+        const std::string& controlMessage = this->stringValue(m_ControlFieldIndex, fieldValues);
+        if (!controlMessage.empty()) {
+            return this->handleControlMessage(controlMessage);
+        }
+    }
+
+    auto printRecord = [this, &fieldValues, &numericValues]() {
+        TStrVec values(fieldValues);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            if (m_FieldTypes[i] != CInputParser::E_String) {
+                CInputParser::formatNumericValue(m_FieldTypes[i], numericValues[i], values[i]);
+            }
+        }
+        return debugPrintRecord(m_FieldNames, values);
+    };
+
+    if (m_TimeFieldIndex >= fieldValues.size()) {
+        core::CStatistics::stat(stat_t::E_NumberRecordsNoTimeField).increment();
+        LOG_ERROR(<< "Found record with no " << m_TimeFieldName << " field:"
+                  << core_t::LINE_ENDING << printRecord());
+        return true;
+    }
+
+    core_t::TTime time(0);
+    if (m_FieldTypes[m_TimeFieldIndex] == CInputParser::E_String) {
+        if (this->parseRecordTime(fieldValues[m_TimeFieldIndex], printRecord, time) == false) {
+            return true;
+        }
+    } else {
+        if (CInputParser::numericValueToTime(numericValues[m_TimeFieldIndex], time) == false) {
+            core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
+            LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName << " field in record:"
+                      << core_t::LINE_ENDING << printRecord());
+            return true;
+        }
+        if (this->checkRecordTime(time, printRecord) == false) {
+            return true;
+        }
+    }
+
+    this->outputBucketResultsUntil(time);
+
+    if (m_DetectorKeys.empty()) {
+        this->populateDetectorKeys(m_FieldConfig, m_DetectorKeys);
+    }
+
+    if (m_DetectorFieldIndices.size() != m_DetectorKeys.size()) {
+        m_DetectorFieldIndices.clear();
+        m_DetectorFieldIndices.reserve(m_DetectorKeys.size());
+        for (const auto& key : m_DetectorKeys) {
+            // An empty partitionFieldName means no partitioning
+            const std::string& partitionFieldName(key.partitionFieldName());
+            m_DetectorFieldIndices.push_back(
+                {false,
+                 partitionFieldName.empty() ? m_FieldNames.size()
+                                            : fieldIndex(partitionFieldName, m_FieldNames),
+                 TSizeVec()});
+        }
+    }
+
+    for (std::size_t i = 0u; i < m_DetectorKeys.size(); ++i) {
+        SDetectorFieldIndices& indices = m_DetectorFieldIndices[i];
+
+        const std::string& partitionFieldValue(
+            indices.s_PartitionField < fieldValues.size()
+                ? this->stringValue(indices.s_PartitionField, fieldValues)
+                : EMPTY_STRING);
+
+        const TAnomalyDetectorPtr& detector = this->detectorForKey(
+            false, // not restoring
+            time, m_DetectorKeys[i], partitionFieldValue, m_Limits.resourceMonitor());
+        if (detector == nullptr) {
+            // There wasn't enough memory to create the detector
+            continue;
+        }
+
+        // The fields of interest depend only on the detector key so are the
+        // same for every partition
+        if (indices.s_Resolved == false) {
+            const TStrVec& fieldsOfInterest = detector->fieldsOfInterest();
+            indices.s_FieldsOfInterest.clear();
+            indices.s_FieldsOfInterest.reserve(fieldsOfInterest.size());
+            for (const auto& fieldName : fieldsOfInterest) {
+                indices.s_FieldsOfInterest.push_back(
+                    fieldName.empty() ? NO_FIELD_NAME : fieldIndex(fieldName, m_FieldNames));
+            }
+            indices.s_Resolved = true;
+        }
+
+        this->addRecord(detector, time, partitionFieldValue,
+                        indices.s_FieldsOfInterest, fieldValues, numericValues);
+    }
+
+    this->recordHandled(time);
+
+    return true;
+}
+
+template<typename PRINT_RECORD>
+bool CAnomalyJob::parseRecordTime(const std::string& timeValue,
+                                  const PRINT_RECORD& printRecord,
+                                  core_t::TTime& time) {
+    if (m_TimeFieldFormat.empty()) {
+        if (core::CStringUtils::stringToType(timeValue, time) == false) {
+            core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
+            LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName << " field in record:"
+                      << core_t::LINE_ENDING << printRecord());
+            return false;
+        }
+    } else {
+        // Use this library function instead of raw strptime() as it works
+        // around many operating system specific issues.
+        if (core::CTimeUtils::strptime(m_TimeFieldFormat, timeValue, time) == false) {
+            core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
+            LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName << " field using format "
+                      << m_TimeFieldFormat << " in record:" << core_t::LINE_ENDING
+                      << printRecord());
+            return false;
+        }
+    }
+
+    return this->checkRecordTime(time, printRecord);
+}
+
+template<typename PRINT_RECORD>
+bool CAnomalyJob::checkRecordTime(core_t::TTime time, const PRINT_RECORD& printRecord) {
+    // This record must be within the specified latency. If latency
+    // is zero, then it should be after the current bucket end. If
+    // latency is non-zero, then it should be after the current bucket
+    // end minus the latency.
+    if (time < m_LastFinalisedBucketEndTime) {
+        core::CStatistics::stat(stat_t::E_NumberTimeOrderErrors).increment();
+        std::ostringstream ss;
+        ss << "Records must be in ascending time order. "
+           << "Record '" << printRecord() << "' time " << time
+           << " is before bucket time " << m_LastFinalisedBucketEndTime;
+        LOG_ERROR(<< ss.str());
+        return false;
+    }
+
+    return true;
+}
+
+const std::string& CAnomalyJob::stringValue(std::size_t index, const TStrVec& fieldValues) const {
+    return m_FieldTypes[index] == CInputParser::E_String ? fieldValues[index]
+                                                          : m_NumericFieldStrings[index];
+}
+
+void CAnomalyJob::recordHandled(core_t::TTime time) {
     core::CStatistics::stat(stat_t::E_NumberApiRecordsHandled).increment();
 
     ++m_NumRecordsHandled;
     m_LatestRecordTime = std::max(m_LatestRecordTime, time);
-
-    return true;
 }
 
 void CAnomalyJob::finalise() {
+    this->addPendingRecords();
+
     // Persist final state of normalizer
     m_JsonOutputWriter.persistNormalizer(m_Normalizer, m_LastNormalizerPersistTime);
 
@@ -305,6 +653,10 @@ bool CAnomalyJob::handleControlMessage(const std::string& controlMessage) {
         return false;
     }
 
+    // Control messages act on the state of the detectors so it must reflect
+    // every record received before them
+    this->addPendingRecords();
+
     switch (controlMessage[0]) {
     case ' ':
         // Spaces are just used to fill the buffers and force prior messages
@@ -366,6 +718,7 @@ void CAnomalyJob::acknowledgeFlush(const std::string& flushId) {
 
 void CAnomalyJob::updateConfig(const std::string& config) {
     LOG_DEBUG(<< "Received update config request: " << config);
+    this->preserveAllForPersist();
     CConfigUpdater configUpdater(m_FieldConfig, m_ModelConfig);
     if (configUpdater.update(config) == false) {
         LOG_ERROR(<< "Failed to update configuration");
@@ -443,6 +796,8 @@ void CAnomalyJob::skipSampling(core_t::TTime endTime) {
     LOG_INFO(<< "Skipping time to: " << endTime);
 
     this->flushAndResetResultsQueue(endTime);
+    this->preserveAllForPersist();
+    this->forceFullSnapshot();
 
     for (const auto& detector_ : m_Detectors) {
         model::CAnomalyDetector* detector(detector_.second.get());
@@ -491,6 +846,7 @@ void CAnomalyJob::flushAndResetResultsQueue(core_t::TTime startTime) {
 }
 
 void CAnomalyJob::timeNow(core_t::TTime time) {
+    this->preserveAllForPersist();
     for (const auto& detector_ : m_Detectors) {
         model::CAnomalyDetector* detector(detector_.second.get());
         if (detector == nullptr) {
@@ -555,6 +911,9 @@ bool CAnomalyJob::parseTimeRangeInControlMessage(const std::string& controlMessa
 }
 
 void CAnomalyJob::doForecast(const std::string& controlMessage) {
+    // Checking the forecast prerequisites reads the detectors
+    this->preserveAllForPersist();
+
     // make a copy of the detectors vector, note: this is a shallow, not a deep copy
     TAnomalyDetectorPtrVec detectorVector;
     this->detectors(detectorVector);
@@ -567,6 +926,13 @@ void CAnomalyJob::doForecast(const std::string& controlMessage) {
 }
 
 void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
+    // This is the barrier for records queued for ingestion
+    this->addPendingRecords();
+    this->preserveAllForPersist();
+
+    // This resets the arena when we return so must come first.
+    core::CScopedMonotonicArena scopedArena(m_ResultsArena);
+
     using TKeyAnomalyDetectorPtrUMapCItr = TKeyAnomalyDetectorPtrUMap::const_iterator;
     using TKeyAnomalyDetectorPtrUMapCItrVec = std::vector<TKeyAnomalyDetectorPtrUMapCItr>;
 
@@ -593,17 +959,33 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
     std::sort(iterators.begin(), iterators.end(),
               core::CFunctional::SDereference<maths::COrderings::SFirstLess>());
 
+    TAnomalyDetectorPtrVec detectors;
+    detectors.reserve(iterators.size());
     for (std::size_t i = 0u; i < iterators.size(); ++i) {
-        model::CAnomalyDetector* detector(iterators[i]->second.get());
-        if (detector == nullptr) {
+        if (iterators[i]->second == nullptr) {
             LOG_ERROR(<< "Unexpected NULL pointer for key '"
                       << pairDebug(iterators[i]->first) << '\'');
             continue;
         }
-        detector->buildResults(bucketStartTime, bucketStartTime + bucketLength, results);
-        detector->releaseMemory(bucketStartTime - m_ModelConfig.samplingAgeCutoff());
+        detectors.push_back(iterators[i]->second);
+    }
+
+    model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+    resourceMonitor.startSampling();
+    if (this->canBuildResultsInParallel(detectors)) {
+        this->buildResultsInParallel(bucketStartTime, detectors, results);
+    } else {
+        for (const auto& detector : detectors) {
+            detector->buildResults(bucketStartTime, bucketStartTime + bucketLength, results);
+            detector->releaseMemory(bucketStartTime - m_ModelConfig.samplingAgeCutoff());
+
+            this->generateModelPlot(bucketStartTime, bucketStartTime + bucketLength, *detector);
+        }
+    }
+    resourceMonitor.finishSampling();
 
-        this->generateModelPlot(bucketStartTime, bucketStartTime + bucketLength, *detector);
+    if (m_PeriodicityTestScheduler != nullptr) {
+        this->runPeriodicityTests();
     }
 
     if (!results.empty()) {
@@ -637,11 +1019,121 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
         cumulativeTime += timer.stop();
     }
 
-    m_Limits.resourceMonitor().pruneIfRequired(bucketStartTime);
-    model::CStringStore::tidyUpNotThreadSafe();
+    this->accountResultsArena();
+
+    resourceMonitor.pruneIfRequired(bucketStartTime);
+    model::CStringStore::tidyUp();
+}
+
+void CAnomalyJob::accountResultsArena() {
+    const core::CMonotonicArena::SStatistics& statistics{m_ResultsArena.statistics()};
+    core::CStatistics::stat(stat_t::E_NumberResultsArenaAllocations)
+        .increment(statistics.s_Allocations);
+    core::CStatistics::stat(stat_t::E_NumberResultsArenaHeapAllocations)
+        .increment(statistics.s_HeapAllocations);
+
+    // The arena holds on to its memory between buckets.
+    m_Limits.resourceMonitor().workingMemoryUsage(m_ResultsArena.memoryUsage());
+}
+
+void CAnomalyJob::runPeriodicityTests() {
+    m_PeriodicityTestScheduler->runTests(m_ThreadPool.get());
+
+    maths::CPeriodicityTestScheduler::STimings timings{m_PeriodicityTestScheduler->timings()};
+    if (timings.s_LastNumberTests > 0) {
+        LOG_DEBUG(<< "Ran " << timings.s_LastNumberTests << " periodicity tests in "
+                  << timings.s_LastRunTime << "us, "
+                  << m_PeriodicityTestScheduler->numberPending() << " pending, "
+                  << "mean test time = " << timings.s_MeanTestTime
+                  << "us, max test time = " << timings.s_MaxTestTime << "us");
+    }
+}
+
+bool CAnomalyJob::canUseThreadPool(std::size_t extraMemory) {
+    if (m_ThreadPool == nullptr) {
+        return false;
+    }
+
+    // Whilst working on detectors in parallel every detector sees the memory
+    // usage as it was when the work started.  As the usage nears the memory
+    // limit we go back to updating it after each detector, so the limit is
+    // enforced as it is when single threaded.
+    return m_Limits.resourceMonitor().canDeferRefreshes(extraMemory);
+}
+
+bool CAnomalyJob::canBuildResultsInParallel(const TAnomalyDetectorPtrVec& detectors) {
+    if (m_ThreadPool == nullptr || detectors.size() < 2) {
+        return false;
+    }
+
+    model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+    if (resourceMonitor.haveNoLimit()) {
+        return true;
+    }
+
+    // Sampling creates the models for the people and attributes which have
+    // arrived since the last bucket.  If the memory they and the updates to
+    // the existing models could take crosses the prune threshold, the order
+    // in which the detectors see it matters, so process them one at a time.
+    std::size_t pendingMemory{0};
+    for (const auto& detector : detectors) {
+        pendingMemory += detector->pendingMemoryUsage();
+    }
+    return resourceMonitor.canDeferSampling(pendingMemory);
+}
+
+void CAnomalyJob::buildResultsInParallel(core_t::TTime bucketStartTime,
+                                         const TAnomalyDetectorPtrVec& detectors,
+                                         model::CHierarchicalResults& results) {
+    using THierarchicalResultsVec = std::vector<model::CHierarchicalResults>;
+    using TModelPlotDataVecVec = std::vector<TModelPlotDataVec>;
+
+    core_t::TTime bucketEndTime = bucketStartTime + m_ModelConfig.bucketLength();
+    core_t::TTime samplingCutoffTime = bucketStartTime - m_ModelConfig.samplingAgeCutoff();
+    double modelPlotBoundsPercentile = m_ModelConfig.modelPlotBoundsPercentile();
+
+    model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+
+    // Each detector clears the extra memory before it samples, so it's
+    // replayed in the order the detectors are supplied.
+    resourceMonitor.deferRefreshes(detectors.size());
+
+    THierarchicalResultsVec detectorResults(detectors.size());
+    TModelPlotDataVecVec detectorModelPlots(detectors.size());
+
+    m_ThreadPool->parallelForEach(detectors.size(), [&](std::size_t i) {
+        model::CResourceMonitor::CScopedDeferredTask task(resourceMonitor, i);
+        model::CAnomalyDetector& detector = *detectors[i];
+        detector.buildResults(bucketStartTime, bucketEndTime, detectorResults[i]);
+        detector.releaseMemory(samplingCutoffTime);
+        if (modelPlotBoundsPercentile > 0.0) {
+            detector.generateModelPlot(bucketStartTime, bucketEndTime,
+                                       modelPlotBoundsPercentile,
+                                       m_ModelConfig.modelPlotTerms(),
+                                       detectorModelPlots[i]);
+        }
+    });
+
+    resourceMonitor.commitDeferredRefreshes();
+
+    // Combine in the order the detectors were supplied so the results are
+    // identical to processing them one at a time.
+    TModelPlotDataVec& modelPlots = m_ModelPlotQueue.get(bucketStartTime);
+    for (std::size_t i = 0u; i < detectors.size(); ++i) {
+        results.append(detectorResults[i]);
+        modelPlots.insert(modelPlots.end(),
+                          std::make_move_iterator(detectorModelPlots[i].begin()),
+                          std::make_move_iterator(detectorModelPlots[i].end()));
+    }
 }
 
 void CAnomalyJob::outputInterimResults(core_t::TTime bucketStartTime) {
+    this->addPendingRecords();
+    this->preserveAllForPersist();
+
+    // This resets the arena when we return so must come first.
+    core::CScopedMonotonicArena scopedArena(m_ResultsArena);
+
     core::CStopWatch timer(true);
 
     core_t::TTime bucketLength = m_ModelConfig.bucketLength();
@@ -684,6 +1176,8 @@ void CAnomalyJob::outputInterimResults(core_t::TTime bucketStartTime) {
         this->writeOutResults(true, olderResult, olderTime, processingTime, 0l);
     }
     this->writeOutResults(true, results, bucketStartTime, processingTime, 0l);
+
+    this->accountResultsArena();
 }
 
 void CAnomalyJob::writeOutResults(bool interim,
@@ -733,6 +1227,8 @@ void CAnomalyJob::resetBuckets(const std::string& controlMessage) {
         core_t::TTime bucketLength = m_ModelConfig.bucketLength();
         core_t::TTime time = maths::CIntegerTools::floor(start, bucketLength);
         core_t::TTime bucketEnd = maths::CIntegerTools::ceil(end, bucketLength);
+        this->preserveAllForPersist();
+        this->forceFullSnapshot();
         while (time < bucketEnd) {
             for (const auto& detector_ : m_Detectors) {
                 model::CAnomalyDetector* detector = detector_.second.get();
@@ -756,37 +1252,55 @@ bool CAnomalyJob::restoreState(core::CDataSearcher& restoreSearcher,
         return false;
     }
 
-    size_t numDetectors(0);
-    try {
-        // Restore from Elasticsearch compressed data
-        core::CStateDecompressor decompressor(restoreSearcher);
-        decompressor.setStateRestoreSearch(ML_STATE_INDEX);
-
-        core::CDataSearcher::TIStreamP strm(decompressor.search(1, 1));
-        if (strm == nullptr) {
-            LOG_ERROR(<< "Unable to connect to data store");
-            return false;
-        }
-
-        if (strm->bad()) {
-            LOG_ERROR(<< "State restoration search returned bad stream");
-            return false;
+    // Each detector is restored from the latest snapshot which contains it,
+    // so it has sampled the buckets up to that snapshot's time.  Detectors
+    // are created for restoring at time zero.
+    auto setLastBucketEndTimes = [this](const SSnapshotManifest& manifest) {
+        core_t::TTime lastBucketEndTime(maths::CIntegerTools::ceil(
+            manifest.s_LastFinalisedBucketEndTime, m_ModelConfig.bucketLength()));
+        for (const auto& detector : m_Detectors) {
+            if (detector.second != nullptr && detector.second->lastBucketEndTime() == 0) {
+                detector.second->lastBucketEndTime() = lastBucketEndTime;
+            }
         }
+    };
 
-        if (strm->fail()) {
-            // This is fatal. If the stream exists and has failed then state is missing
-            LOG_ERROR(<< "State restoration search returned failed stream");
+    core::CStopWatch restoreTimer(true);
+    size_t numDetectors(0);
+    try {
+        SSnapshotManifest manifest;
+        if (this->restoreSnapshot(restoreSearcher, false, completeToTime,
+                                  numDetectors, manifest) == false) {
             return false;
         }
-
-        // We're dealing with streaming JSON state
-        core::CJsonStateRestoreTraverser traverser(*strm);
-
-        if (this->restoreState(traverser, completeToTime, numDetectors) == false) {
-            LOG_ERROR(<< "Failed to restore detectors");
-            return false;
+        setLastBucketEndTimes(manifest);
+
+        // A delta snapshot is followed by its predecessors, back to the full
+        // snapshot it's relative to
+        while (manifest.isDelta() &&
+               m_RestoredStateDetail.s_RestoredStateStatus == E_Success) {
+            std::string previousSnapshotId;
+            previousSnapshotId.swap(manifest.s_PreviousSnapshotId);
+            manifest = SSnapshotManifest();
+            if (this->restoreSnapshot(restoreSearcher, true, completeToTime,
+                                      numDetectors, manifest) == false) {
+                LOG_ERROR(<< "Failed to restore snapshot '" << previousSnapshotId
+                          << "' preceding delta snapshot");
+                return false;
+            }
+            if (m_RestoredStateDetail.s_RestoredStateStatus != E_Success ||
+                manifest.s_SnapshotId != previousSnapshotId) {
+                LOG_ERROR(<< "Expected snapshot '" << previousSnapshotId
+                          << "' to precede delta snapshot but found '"
+                          << manifest.s_SnapshotId << "'");
+                m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+                return false;
+            }
+            setLastBucketEndTimes(manifest);
         }
-        LOG_DEBUG(<< "Finished restoration, with " << numDetectors << " detectors");
+        m_RestoredStateDetail.s_RestoreTime = restoreTimer.stop();
+        LOG_INFO(<< "Finished restoration, with " << numDetectors << " detectors in "
+                 << m_RestoredStateDetail.s_RestoreTime << "ms");
 
         if (numDetectors == 1 && m_Detectors.empty()) {
             // non fatal error
@@ -797,6 +1311,8 @@ bool CAnomalyJob::restoreState(core::CDataSearcher& restoreSearcher,
         if (completeToTime > 0) {
             core_t::TTime lastBucketEndTime(maths::CIntegerTools::ceil(
                 completeToTime, m_ModelConfig.bucketLength()));
+            core_t::TTime lastSampledBucketEndTime(maths::CIntegerTools::ceil(
+                m_LastFinalisedBucketEndTime, m_ModelConfig.bucketLength()));
 
             for (const auto& detector_ : m_Detectors) {
                 model::CAnomalyDetector* detector(detector_.second.get());
@@ -806,6 +1322,10 @@ bool CAnomalyJob::restoreState(core::CDataSearcher& restoreSearcher,
                     continue;
                 }
 
+                // A detector restored from a delta's predecessor must sample
+                // the buckets the job sampled after that was persisted
+                detector->zeroModelsToTime(lastSampledBucketEndTime);
+
                 LOG_DEBUG(<< "Setting lastBucketEndTime to " << lastBucketEndTime
                           << " in detector for '" << detector->description() << '\'');
                 detector->lastBucketEndTime() = lastBucketEndTime;
@@ -825,11 +1345,140 @@ bool CAnomalyJob::restoreState(core::CDataSearcher& restoreSearcher,
     return true;
 }
 
+bool CAnomalyJob::restoreSnapshot(core::CDataSearcher& restoreSearcher,
+                                  bool isPredecessor,
+                                  core_t::TTime& completeToTime,
+                                  std::size_t& numDetectors,
+                                  SSnapshotManifest& manifest) {
+    // Restore from Elasticsearch compressed data
+    core::CStateDecompressor decompressor(restoreSearcher);
+    decompressor.setStateRestoreSearch(ML_STATE_INDEX);
+
+    core::CDataSearcher::TIStreamP strm(decompressor.search(1, 1));
+    if (strm == nullptr) {
+        LOG_ERROR(<< "Unable to connect to data store");
+        return false;
+    }
+
+    if (strm->bad()) {
+        LOG_ERROR(<< "State restoration search returned bad stream");
+        return false;
+    }
+
+    if (strm->fail()) {
+        // This is fatal. If the stream exists and has failed then state is missing
+        LOG_ERROR(<< "State restoration search returned failed stream");
+        return false;
+    }
+
+    // We're dealing with streaming JSON or binary state.  This is a document
+    // holding everything other than the detectors followed by a document for
+    // each detector, unless it was persisted before the detectors were written
+    // separately, in which case they're all in the first document.
+    std::size_t numberDetectorDocuments(0);
+    if (restoreDocument(*strm, [&](core::CStateRestoreTraverser& traverser) {
+            return this->restoreState(traverser, isPredecessor, completeToTime,
+                                      numDetectors, manifest, numberDetectorDocuments);
+        }) == false) {
+        LOG_ERROR(<< "Failed to restore detectors");
+        return false;
+    }
+    if (m_RestoredStateDetail.s_RestoredStateStatus != E_Success) {
+        return true;
+    }
+
+    return this->restoreDetectorDocuments(*strm, isPredecessor,
+                                          numberDetectorDocuments, numDetectors);
+}
+
+bool CAnomalyJob::restoreDetectorDocuments(std::istream& strm,
+                                           bool isPredecessor,
+                                           std::size_t numberDocuments,
+                                           std::size_t& numDetectors) {
+    auto restore = [&](core::CStateRestoreTraverser& traverser) {
+        return traverser.name() == TOP_LEVEL_DETECTOR_TAG &&
+               traverser.traverseSubLevel(boost::bind(&CAnomalyJob::restoreSingleDetector,
+                                                      this, isPredecessor, _1)) &&
+               traverser.haveBadState() == false;
+    };
+
+    if (m_ThreadPool == nullptr) {
+        for (std::size_t i = 0; i < numberDocuments; ++i) {
+            if (restoreDocument(strm, restore) == false) {
+                LOG_ERROR(<< "Failed to restore detector " << i << " of " << numberDocuments);
+                m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+                return false;
+            }
+            ++numDetectors;
+        }
+        return true;
+    }
+
+    using TArrayStream = boost::iostreams::stream<boost::iostreams::array_source>;
+
+    // A batch of documents is read without restoring them.  They're then
+    // parsed and restored by the thread pool.
+    TStrVec documents;
+    for (std::size_t i = 0; i < numberDocuments; i += documents.size()) {
+        documents.resize(std::min(numberDocuments - i, MAX_RESTORED_DETECTORS));
+        for (std::size_t j = 0; j < documents.size(); ++j) {
+            if (readDocument(strm, documents[j]) == false) {
+                LOG_ERROR(<< "Expected " << numberDocuments << " detectors but found " << i + j);
+                m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+                return false;
+            }
+        }
+
+        std::vector<std::uint8_t> restored(documents.size(), 0);
+        std::vector<std::uint8_t> isSimpleCount(documents.size(), 0);
+        m_ThreadPool->parallelForEach(documents.size(), [&](std::size_t j) {
+            TArrayStream documentStrm(documents[j].data(), documents[j].size());
+            bool isSimpleCount_{false};
+            auto restoreConcurrently = [&](core::CStateRestoreTraverser& traverser) {
+                return traverser.name() == TOP_LEVEL_DETECTOR_TAG &&
+                       traverser.traverseSubLevel([&](core::CStateRestoreTraverser& traverser_) {
+                           return this->restoreSingleDetectorConcurrently(
+                               isPredecessor, isSimpleCount_, traverser_);
+                       }) &&
+                       traverser.haveBadState() == false;
+            };
+            restored[j] = restoreDocument(documentStrm, restoreConcurrently);
+            isSimpleCount[j] = isSimpleCount_;
+        });
+
+        for (std::size_t j = 0; j < documents.size(); ++j) {
+            if (restored[j] == false) {
+                LOG_ERROR(<< "Failed to restore detector " << i + j << " of "
+                          << numberDocuments);
+                m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+                return false;
+            }
+            // The simple count detector restores global statics so it must
+            // not run concurrently with the other detectors
+            if (isSimpleCount[j]) {
+                TArrayStream documentStrm(documents[j].data(), documents[j].size());
+                if (restoreDocument(documentStrm, restore) == false) {
+                    LOG_ERROR(<< "Failed to restore the simple count detector");
+                    m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+                    return false;
+                }
+            }
+        }
+        numDetectors += documents.size();
+    }
+
+    return true;
+}
+
 bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
+                               bool isPredecessor,
                                core_t::TTime& completeToTime,
-                               std::size_t& numDetectors) {
+                               std::size_t& numDetectors,
+                               SSnapshotManifest& manifest,
+                               std::size_t& numberDetectorDocuments) {
     m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
     m_RestoredStateDetail.s_Extra = boost::none;
+    m_RestoredStateDetail.s_RestoreTime = 0;
 
     // Call name() to prime the traverser if it hasn't started
     traverser.name();
@@ -847,11 +1496,15 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
                   << traverser.name() << '=' << traverser.value());
         return false;
     }
-    m_LastFinalisedBucketEndTime = lastBucketEndTime;
+    manifest.s_LastFinalisedBucketEndTime = lastBucketEndTime;
+    // Times are taken from the latest snapshot
+    if (isPredecessor == false) {
+        m_LastFinalisedBucketEndTime = lastBucketEndTime;
 
-    if (lastBucketEndTime > completeToTime) {
-        LOG_INFO(<< "Processing is already complete to time " << lastBucketEndTime);
-        completeToTime = lastBucketEndTime;
+        if (lastBucketEndTime > completeToTime) {
+            LOG_INFO(<< "Processing is already complete to time " << lastBucketEndTime);
+            completeToTime = lastBucketEndTime;
+        }
     }
 
     if ((traverser.next() == false) || (traverser.name() != VERSION_TAG)) {
@@ -874,12 +1527,28 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
     while (traverser.next()) {
         const std::string& name = traverser.name();
         if (name == TOP_LEVEL_DETECTOR_TAG) {
-            if (traverser.traverseSubLevel(boost::bind(
-                    &CAnomalyJob::restoreSingleDetector, this, _1)) == false) {
+            if (traverser.traverseSubLevel(boost::bind(&CAnomalyJob::restoreSingleDetector,
+                                                       this, isPredecessor, _1)) == false) {
                 LOG_ERROR(<< "Cannot restore anomaly detector");
                 return false;
             }
             ++numDetectors;
+        } else if (name == SNAPSHOT_ID_TAG) {
+            manifest.s_SnapshotId = traverser.value();
+        } else if (name == BASE_SNAPSHOT_ID_TAG) {
+            manifest.s_BaseSnapshotId = traverser.value();
+        } else if (name == PREVIOUS_SNAPSHOT_ID_TAG) {
+            manifest.s_PreviousSnapshotId = traverser.value();
+        } else if (name == NUMBER_DETECTORS_TAG) {
+            if (core::CStringUtils::stringToType(traverser.value(),
+                                                 numberDetectorDocuments) == false) {
+                LOG_ERROR(<< "Invalid number of detectors in " << traverser.value());
+                return false;
+            }
+        } else if (isPredecessor) {
+            // Everything other than the detectors is taken from the latest
+            // snapshot
+            continue;
         } else if (name == RESULTS_AGGREGATOR_TAG) {
             if (traverser.traverseSubLevel(boost::bind(
                     &model::CHierarchicalResultsAggregator::acceptRestoreTraverser,
@@ -908,7 +1577,72 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
     return true;
 }
 
-bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser) {
+bool CAnomalyJob::restoreSingleDetector(bool isPredecessor,
+                                        core::CStateRestoreTraverser& traverser) {
+    model::CSearchKey key;
+    std::string partitionFieldValue;
+    if (this->restoreDetectorKey(traverser, key, partitionFieldValue) == false) {
+        return false;
+    }
+
+    if (isPredecessor && this->hasDetector(key, partitionFieldValue)) {
+        LOG_TRACE(<< "Already restored " << key.toCue() << "/" << partitionFieldValue);
+        return true;
+    }
+
+    if (this->restoreDetectorState(key, partitionFieldValue, traverser) == false ||
+        traverser.haveBadState()) {
+        LOG_ERROR(<< "Delegated portion of anomaly detector restore failed");
+        m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+        return false;
+    }
+
+    LOG_TRACE(<< "Restored state for " << key.toCue() << "/" << partitionFieldValue);
+    return true;
+}
+
+bool CAnomalyJob::restoreSingleDetectorConcurrently(bool isPredecessor,
+                                                    bool& isSimpleCount,
+                                                    core::CStateRestoreTraverser& traverser) {
+    model::CSearchKey key;
+    std::string partitionFieldValue;
+    TAnomalyDetectorPtr detector;
+    {
+        core::CScopedFastLock lock(m_RestoreMutex);
+        if (this->restoreDetectorKey(traverser, key, partitionFieldValue) == false) {
+            return false;
+        }
+        isSimpleCount = key.isSimpleCount();
+        if (isSimpleCount) {
+            return true;
+        }
+        if (isPredecessor && this->hasDetector(key, partitionFieldValue)) {
+            LOG_TRACE(<< "Already restored " << key.toCue() << "/" << partitionFieldValue);
+            return true;
+        }
+        detector = this->detectorForRestore(key, partitionFieldValue);
+        if (detector == nullptr) {
+            return false;
+        }
+    }
+
+    LOG_DEBUG(<< "Restoring state for detector with key '" << key.debug() << '/'
+              << partitionFieldValue << '\'');
+
+    if (traverser.traverseSubLevel(boost::bind(
+            &model::CAnomalyDetector::acceptRestoreTraverser, detector.get(),
+            boost::cref(partitionFieldValue), _1)) == false) {
+        LOG_ERROR(<< "Error restoring anomaly detector for key '" << key.debug()
+                  << '/' << partitionFieldValue << '\'');
+        return false;
+    }
+
+    return true;
+}
+
+bool CAnomalyJob::restoreDetectorKey(core::CStateRestoreTraverser& traverser,
+                                     model::CSearchKey& key,
+                                     std::string& partitionFieldValue) {
     if (traverser.name() != KEY_TAG) {
         LOG_ERROR(<< "Cannot restore anomaly detector - " << KEY_TAG << " element expected but found "
                   << traverser.name() << '=' << traverser.value());
@@ -917,7 +1651,6 @@ bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser)
         return false;
     }
 
-    model::CSearchKey key;
     if (traverser.traverseSubLevel(boost::bind(&model::CAnomalyDetector::keyAcceptRestoreTraverser,
                                                _1, boost::ref(key))) == false) {
         LOG_ERROR(<< "Cannot restore anomaly detector - no key found in " << KEY_TAG);
@@ -942,7 +1675,6 @@ bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser)
         return false;
     }
 
-    std::string partitionFieldValue;
     if (traverser.traverseSubLevel(
             boost::bind(&model::CAnomalyDetector::partitionFieldAcceptRestoreTraverser,
                         _1, boost::ref(partitionFieldValue))) == false) {
@@ -970,20 +1702,22 @@ bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser)
         return false;
     }
 
-    if (this->restoreDetectorState(key, partitionFieldValue, traverser) == false ||
-        traverser.haveBadState()) {
-        LOG_ERROR(<< "Delegated portion of anomaly detector restore failed");
-        m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
-        return false;
-    }
-
-    LOG_TRACE(<< "Restored state for " << key.toCue() << "/" << partitionFieldValue);
     return true;
 }
 
-bool CAnomalyJob::restoreDetectorState(const model::CSearchKey& key,
-                                       const std::string& partitionFieldValue,
-                                       core::CStateRestoreTraverser& traverser) {
+bool CAnomalyJob::hasDetector(const model::CSearchKey& key,
+                              const std::string& partitionFieldValue) const {
+    // The simple count detector always lives in a special null partition.
+    const std::string& partition = key.isSimpleCount() ? EMPTY_STRING : partitionFieldValue;
+    return m_Detectors.find(model::CSearchKey::TStrCRefKeyCRefPr(boost::cref(partition),
+                                                                 boost::cref(key)),
+                            model::CStrKeyPrHash(),
+                            model::CStrKeyPrEqual()) != m_Detectors.end();
+}
+
+const CAnomalyJob::TAnomalyDetectorPtr&
+CAnomalyJob::detectorForRestore(const model::CSearchKey& key,
+                                const std::string& partitionFieldValue) {
     const TAnomalyDetectorPtr& detector =
         this->detectorForKey(true, // for restoring
                              0,    // time reset later
@@ -995,6 +1729,15 @@ bool CAnomalyJob::restoreDetectorState(const model::CSearchKey& key,
                      "memory limit is too low to continue this job");
 
         m_RestoredStateDetail.s_RestoredStateStatus = E_MemoryLimitReached;
+    }
+    return detector;
+}
+
+bool CAnomalyJob::restoreDetectorState(const model::CSearchKey& key,
+                                       const std::string& partitionFieldValue,
+                                       core::CStateRestoreTraverser& traverser) {
+    const TAnomalyDetectorPtr& detector = this->detectorForRestore(key, partitionFieldValue);
+    if (!detector) {
         return false;
     }
 
@@ -1032,14 +1775,20 @@ bool CAnomalyJob::persistState(core::CDataAdder& persister) {
         return true;
     }
 
+    // The state must reflect every record received
+    this->addPendingRecords();
+
     TKeyCRefAnomalyDetectorPtrPrVec detectors;
     this->sortedDetectors(detectors);
+    removeNullDetectors(detectors);
+    SPersistDetectors persistDetectors(detectors);
     std::string normaliserState;
     m_Normalizer.toJson(m_LastResultsTime, "api", normaliserState, true);
 
     return this->persistState(
-        "State persisted due to job close at ", m_ResultsQueue,
-        m_ModelPlotQueue, m_LastFinalisedBucketEndTime, detectors,
+        "State persisted due to job close at ", core::CTimeUtils::now(),
+        SSnapshotManifest(), m_ResultsQueue, m_ModelPlotQueue,
+        m_LastFinalisedBucketEndTime, persistDetectors,
         m_Limits.resourceMonitor().createMemoryUsageReport(
             m_LastFinalisedBucketEndTime - m_ModelConfig.bucketLength()),
         m_Aggregator, normaliserState, m_LatestRecordTime, m_LastResultsTime, persister);
@@ -1062,34 +1811,35 @@ bool CAnomalyJob::backgroundPersistState(CBackgroundPersister& backgroundPersist
     // it should be relatively fast though
     m_Normalizer.toJson(m_LastResultsTime, "api", args->s_NormalizerState, true);
 
-    TKeyCRefAnomalyDetectorPtrPrVec& copiedDetectors = args->s_Detectors;
-    copiedDetectors.reserve(m_Detectors.size());
-
-    for (const auto& detector_ : m_Detectors) {
-        model::CAnomalyDetector* detector(detector_.second.get());
-        if (detector == nullptr) {
-            LOG_ERROR(<< "Unexpected NULL pointer for key '"
-                      << pairDebug(detector_.first) << '\'');
-            continue;
-        }
-        model::CSearchKey::TStrCRefKeyCRefPr key(boost::cref(detector_.first.first),
-                                                 boost::cref(detector_.first.second));
-        if (detector->isSimpleCount()) {
-            copiedDetectors.push_back(TKeyCRefAnomalyDetectorPtrPr(
-                key, TAnomalyDetectorPtr(new model::CSimpleCountDetector(true, *detector))));
-        } else {
-            copiedDetectors.push_back(TKeyCRefAnomalyDetectorPtrPr(
-                key, TAnomalyDetectorPtr(new model::CAnomalyDetector(true, *detector))));
-        }
-    }
-    std::sort(copiedDetectors.begin(), copiedDetectors.end(),
-              maths::COrderings::SFirstLess());
+    TKeyCRefAnomalyDetectorPtrPrVec detectors;
+    this->sortedDetectors(detectors);
+    removeNullDetectors(detectors);
+
+    args->s_SnapshotTimestamp = core::CTimeUtils::now();
+    this->selectDeltaDetectors(args->s_SnapshotTimestamp, detectors,
+                               args->s_Manifest, args->s_RecordCounts);
+
+    // The detectors aren't copied now.  Instead the background persist
+    // writes them as they are and the main thread preserves any which
+    // haven't been written before it changes them.  The copies may use
+    // at most half the memory the models use and mustn't take the usage
+    // over the limit, beyond which the main thread waits for the writes.
+    const model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+    SPersistDetectors::TSizeVec memoryUsages;
+    memoryUsages.reserve(detectors.size());
+    for (const auto& detector : detectors) {
+        memoryUsages.push_back(resourceMonitor.componentMemoryUsage(*detector.second));
+    }
+    args->s_Detectors = std::make_shared<SPersistDetectors>(
+        detectors, memoryUsages,
+        std::min(resourceMonitor.allocationLimit(), args->s_ModelSizeStats.s_Usage / 2));
 
     if (backgroundPersister.addPersistFunc(boost::bind(
             &CAnomalyJob::runBackgroundPersist, this, args, _1)) == false) {
         LOG_ERROR(<< "Failed to add anomaly detector background persistence function");
         return false;
     }
+    m_PersistingDetectors = args->s_Detectors;
 
     return true;
 }
@@ -1101,18 +1851,119 @@ bool CAnomalyJob::runBackgroundPersist(TBackgroundPersistArgsPtr args,
         return false;
     }
 
-    return this->persistState("Periodic background persist at ", args->s_ResultsQueue,
-                              args->s_ModelPlotQueue, args->s_Time, args->s_Detectors,
-                              args->s_ModelSizeStats, args->s_Aggregator,
-                              args->s_NormalizerState, args->s_LatestRecordTime,
-                              args->s_LastResultsTime, persister);
+    bool persisted{this->persistState(
+        args->s_Manifest.isDelta() ? "Periodic background delta persist at "
+                                   : "Periodic background persist at ",
+        args->s_SnapshotTimestamp, args->s_Manifest, args->s_ResultsQueue,
+        args->s_ModelPlotQueue, args->s_Time, *args->s_Detectors,
+        args->s_ModelSizeStats, args->s_Aggregator, args->s_NormalizerState,
+        args->s_LatestRecordTime, args->s_LastResultsTime, persister)};
+
+    // The main thread mustn't wait for detectors which won't be written
+    args->s_Detectors->finish();
+    LOG_DEBUG(<< "Copies of changed detectors used at most "
+              << args->s_Detectors->s_PeakCopyMemory.load() << " bytes");
+
+    if (persisted == false) {
+        return false;
+    }
+    if (args->s_Manifest.s_SnapshotId.empty() == false) {
+        this->snapshotPersisted(args->s_Manifest, args->s_RecordCounts);
+    }
+    return true;
+}
+
+bool CAnomalyJob::selectDeltaDetectors(core_t::TTime& snapshotTimestamp,
+                                       TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                                       SSnapshotManifest& manifest,
+                                       TKeyCRefUInt64PrVec& recordCounts) {
+    if (m_MaxDeltaSnapshots == 0) {
+        return false;
+    }
+
+    recordCounts.clear();
+    recordCounts.reserve(detectors.size());
+    for (const auto& detector : detectors) {
+        recordCounts.emplace_back(detector.first, detector.second->numberRecords());
+    }
+
+    // Snapshot IDs have a resolution of one second and a snapshot mustn't
+    // replace its predecessor
+    if (snapshotTimestamp <= m_LastSnapshotTimestamp) {
+        snapshotTimestamp = m_LastSnapshotTimestamp + 1;
+    }
+    m_LastSnapshotTimestamp = snapshotTimestamp;
+    manifest.s_SnapshotId = core::CStringUtils::typeToString(snapshotTimestamp);
+
+    core::CScopedFastLock lock(m_SnapshotMutex);
+
+    bool isDelta = m_ForceFullSnapshot == false &&
+                   m_LastSnapshotManifest.s_SnapshotId.empty() == false &&
+                   m_NumberDeltaSnapshots < m_MaxDeltaSnapshots;
+    m_ForceFullSnapshot = false;
+    if (isDelta == false) {
+        return false;
+    }
+
+    manifest.s_BaseSnapshotId = m_LastSnapshotManifest.isDelta()
+                                    ? m_LastSnapshotManifest.s_BaseSnapshotId
+                                    : m_LastSnapshotManifest.s_SnapshotId;
+    manifest.s_PreviousSnapshotId = m_LastSnapshotManifest.s_SnapshotId;
+
+    std::size_t numberChanged(0);
+    for (std::size_t i = 0u; i < detectors.size(); ++i) {
+        const model::CSearchKey::TStrCRefKeyCRefPr& key = detectors[i].first;
+        auto itr = m_SnapshotRecordCounts.find(key, model::CStrKeyPrHash(),
+                                               model::CStrKeyPrEqual());
+        // The simple count detector also persists the global statistics, so
+        // it's always included
+        if (itr == m_SnapshotRecordCounts.end() ||
+            itr->second != recordCounts[i].second || key.second.get().isSimpleCount()) {
+            detectors[numberChanged++] = detectors[i];
+        }
+    }
+
+    LOG_DEBUG(<< "Delta snapshot " << manifest.s_SnapshotId << " contains "
+              << numberChanged << " of " << detectors.size() << " detectors");
+    detectors.erase(detectors.begin() + numberChanged, detectors.end());
+
+    return true;
+}
+
+void CAnomalyJob::snapshotPersisted(const SSnapshotManifest& manifest,
+                                    const TKeyCRefUInt64PrVec& recordCounts) {
+    core::CScopedFastLock lock(m_SnapshotMutex);
+
+    m_NumberDeltaSnapshots = manifest.isDelta() ? m_NumberDeltaSnapshots + 1 : 0;
+    m_LastSnapshotManifest = manifest;
+    for (const auto& recordCount : recordCounts) {
+        const model::CSearchKey::TStrCRefKeyCRefPr& key = recordCount.first;
+        auto itr = m_SnapshotRecordCounts.find(key, model::CStrKeyPrHash(),
+                                               model::CStrKeyPrEqual());
+        if (itr == m_SnapshotRecordCounts.end()) {
+            m_SnapshotRecordCounts.emplace(
+                model::CSearchKey::TStrKeyPr(key.first.get(), key.second.get()),
+                recordCount.second);
+        } else {
+            itr->second = recordCount.second;
+        }
+    }
+}
+
+void CAnomalyJob::forceFullSnapshot() {
+    if (m_MaxDeltaSnapshots > 0) {
+        core::CScopedFastLock lock(m_SnapshotMutex);
+        m_ForceFullSnapshot = true;
+    }
 }
 
 bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
+                               core_t::TTime snapshotTimestamp,
+                               const SSnapshotManifest& manifest,
                                const model::CResultsQueue& resultsQueue,
                                const TModelPlotDataVecQueue& modelPlotQueue,
                                core_t::TTime lastFinalisedBucketEnd,
-                               const TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                               SPersistDetectors& detectors,
                                const model::CResourceMonitor::SResults& modelSizeStats,
                                const model::CHierarchicalResultsAggregator& aggregator,
                                const std::string& normalizerState,
@@ -1123,22 +1974,34 @@ bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
     try {
         core::CStateCompressor compressor(persister);
 
-        core_t::TTime snapshotTimestamp(core::CTimeUtils::now());
         const std::string snapShotId(core::CStringUtils::typeToString(snapshotTimestamp));
-        core::CDataAdder::TOStreamP strm = compressor.addStreamed(
-            ML_STATE_INDEX, m_JobId + '_' + STATE_TYPE + '_' + snapShotId);
+        const std::string snapshotDocId(m_JobId + '_' + STATE_TYPE + '_' + snapShotId);
+        core::CDataAdder::TOStreamP strm =
+            compressor.addCompressedStreamed(ML_STATE_INDEX, snapshotDocId);
         if (strm != nullptr) {
             // IMPORTANT - this method can run in a background thread while the
             // analytics carries on processing new buckets in the main thread.
             // Therefore, this method must NOT access any member variables whose
             // values can change.  There should be no use of m_ variables in the
-            // following code block.
-            {
-                // The JSON inserter must be destructed before the stream is complete
-                core::CJsonStatePersistInserter inserter(*strm);
+            // following code block, except for the thread pool which can be
+            // shared with the main thread and the state format which is fixed.
+            std::size_t numberDetectors{detectors.s_Detectors.size()};
+
+            // Everything other than the detectors is written first, as one
+            // document, and says how many detector documents follow it
+            auto persistOthers = [&](core::CStatePersistInserter& inserter) {
                 inserter.insertValue(TIME_TAG, lastFinalisedBucketEnd);
                 inserter.insertValue(VERSION_TAG, model::CAnomalyDetector::STATE_VERSION);
 
+                if (manifest.s_SnapshotId.empty() == false) {
+                    inserter.insertValue(SNAPSHOT_ID_TAG, manifest.s_SnapshotId);
+                }
+                if (manifest.isDelta()) {
+                    inserter.insertValue(BASE_SNAPSHOT_ID_TAG, manifest.s_BaseSnapshotId);
+                    inserter.insertValue(PREVIOUS_SNAPSHOT_ID_TAG,
+                                         manifest.s_PreviousSnapshotId);
+                }
+
                 if (resultsQueue.size() > 1) {
                     core::CPersistUtils::persist(HIERARCHICAL_RESULTS_TAG,
                                                  resultsQueue, inserter);
@@ -1147,20 +2010,6 @@ bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
                     core::CPersistUtils::persist(MODEL_PLOT_TAG, modelPlotQueue, inserter);
                 }
 
-                for (const auto& detector_ : detectors) {
-                    const model::CAnomalyDetector* detector(detector_.second.get());
-                    if (detector == nullptr) {
-                        LOG_ERROR(<< "Unexpected NULL pointer for key '"
-                                  << pairDebug(detector_.first) << '\'');
-                        continue;
-                    }
-                    inserter.insertLevel(TOP_LEVEL_DETECTOR_TAG,
-                                         boost::bind(&CAnomalyJob::persistIndividualDetector,
-                                                     boost::cref(*detector), _1));
-
-                    LOG_DEBUG(<< "Persisted state for '" << detector->description() << "'");
-                }
-
                 inserter.insertLevel(RESULTS_AGGREGATOR_TAG,
                                      boost::bind(&model::CHierarchicalResultsAggregator::acceptPersistInserter,
                                                  &aggregator, _1));
@@ -1168,7 +2017,40 @@ bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
                 core::CPersistUtils::persist(LATEST_RECORD_TIME_TAG,
                                              latestRecordTime, inserter);
                 core::CPersistUtils::persist(LAST_RESULTS_TIME_TAG, lastResultsTime, inserter);
+                inserter.insertValue(NUMBER_DETECTORS_TAG, numberDetectors);
+            };
+
+            // Each document is compressed on its own, so the detectors can
+            // be written and compressed in parallel.  The stream only encodes
+            // and chunks them, so they aren't compressed again.  They're done
+            // in batches to bound the memory used by their compressed state.
+            std::string others(compressDocument(persistOthers, m_BinaryState));
+            strm->write(others.data(), others.size());
+
+            TStrVec compressed;
+            for (std::size_t begin = 0; begin < numberDetectors;
+                 begin += MAX_COMPRESSED_DETECTORS) {
+                compressed.assign(std::min(MAX_COMPRESSED_DETECTORS, numberDetectors - begin),
+                                  std::string());
+                auto compress = [&](std::size_t i) {
+                    compressed[i] = compressDocument(
+                        [&](core::CStatePersistInserter& inserter) {
+                            detectors.persist(begin + i, inserter);
+                        },
+                        m_BinaryState);
+                };
+                if (m_ThreadPool != nullptr) {
+                    m_ThreadPool->parallelForEach(compressed.size(), compress);
+                } else {
+                    for (std::size_t i = 0u; i < compressed.size(); ++i) {
+                        compress(i);
+                    }
+                }
+                for (const auto& detector : compressed) {
+                    strm->write(detector.data(), detector.size());
+                }
             }
+            LOG_DEBUG(<< "Persisted state for " << numberDetectors << " detectors");
 
             if (compressor.streamComplete(strm, true) == false || strm->bad()) {
                 LOG_ERROR(<< "Failed to complete last persistence stream");
@@ -1203,6 +2085,9 @@ bool CAnomalyJob::periodicPersistState(CBackgroundPersister& persister) {
         return false;
     }
 
+    // The state must reflect every record received
+    this->addPendingRecords();
+
     // Prune the models so that the persisted state is as neat as possible
     this->pruneAllModels();
 
@@ -1335,6 +2220,24 @@ void CAnomalyJob::refreshMemoryAndReport() {
         m_LastFinalisedBucketEndTime - m_ModelConfig.bucketLength());
 }
 
+void CAnomalyJob::preserveForPersist(const model::CAnomalyDetector& detector) {
+    if (m_PersistingDetectors.expired()) {
+        return;
+    }
+    TPersistDetectorsPtr detectors{m_PersistingDetectors.lock()};
+    if (detectors != nullptr) {
+        detectors->preserve(detector);
+    }
+}
+
+void CAnomalyJob::preserveAllForPersist() {
+    TPersistDetectorsPtr detectors{m_PersistingDetectors.lock()};
+    if (detectors != nullptr) {
+        detectors->preserveAll();
+    }
+    m_PersistingDetectors.reset();
+}
+
 void CAnomalyJob::persistIndividualDetector(const model::CAnomalyDetector& detector,
                                             core::CStatePersistInserter& inserter) {
     inserter.insertLevel(KEY_TAG, boost::bind(&model::CAnomalyDetector::keyAcceptPersistInserter,
@@ -1420,6 +2323,7 @@ CAnomalyJob::detectorForKey(bool isRestoring,
 
 void CAnomalyJob::pruneAllModels() {
     LOG_INFO(<< "Pruning all models");
+    this->preserveAllForPersist();
 
     for (const auto& detector_ : m_Detectors) {
         model::CAnomalyDetector* detector = detector_.second.get();
@@ -1473,6 +2377,7 @@ const std::string* CAnomalyJob::fieldValue(const std::string& fieldName,
 
 void CAnomalyJob::addRecord(const TAnomalyDetectorPtr detector,
                             core_t::TTime time,
+                            const std::string& partitionFieldValue,
                             const TStrStrUMap& dataRowFields) {
     model::CAnomalyDetector::TStrCPtrVec fieldValues;
     const TStrVec& fieldNames = detector->fieldsOfInterest();
@@ -1481,7 +2386,143 @@ void CAnomalyJob::addRecord(const TAnomalyDetectorPtr detector,
         fieldValues.push_back(fieldValue(fieldNames[i], dataRowFields));
     }
 
-    detector->addRecord(time, fieldValues);
+    this->addRecord(*detector, time, partitionFieldValue, fieldValues, TDoubleCPtrVec());
+}
+
+void CAnomalyJob::addRecord(const TAnomalyDetectorPtr detector,
+                            core_t::TTime time,
+                            const std::string& partitionFieldValue,
+                            const TSizeVec& fieldIndices,
+                            const TStrVec& fieldValues,
+                            const TDoubleVec& numericValues) {
+    // This must match the treatment of missing and empty fields in
+    // fieldValue()
+    model::CAnomalyDetector::TStrCPtrVec detectorFieldValues;
+    TDoubleCPtrVec detectorNumericValues;
+    detectorFieldValues.reserve(fieldIndices.size());
+    for (auto index : fieldIndices) {
+        if (index == NO_FIELD_NAME) {
+            detectorFieldValues.push_back(&EMPTY_STRING);
+        } else if (index >= fieldValues.size()) {
+            detectorFieldValues.push_back(nullptr);
+        } else if (m_FieldTypes[index] == CInputParser::E_String) {
+            detectorFieldValues.push_back(fieldValues[index].empty() ? nullptr
+                                                                     : &fieldValues[index]);
+        } else {
+            // A missing number is NaN, which is passed on so the detector
+            // treats it exactly as it would a missing string
+            const std::string& value = m_NumericFieldStrings[index];
+            detectorFieldValues.push_back(
+                m_FormatNumericFields[index] && value.empty() == false ? &value : nullptr);
+            if (detectorNumericValues.empty()) {
+                detectorNumericValues.resize(fieldIndices.size(), nullptr);
+            }
+            detectorNumericValues[detectorFieldValues.size() - 1] = &numericValues[index];
+        }
+    }
+
+    this->addRecord(*detector, time, partitionFieldValue, detectorFieldValues,
+                    detectorNumericValues);
+}
+
+void CAnomalyJob::addRecord(model::CAnomalyDetector& detector,
+                            core_t::TTime time,
+                            const std::string& partitionFieldValue,
+                            const model::CAnomalyDetector::TStrCPtrVec& fieldValues,
+                            const TDoubleCPtrVec& numericValues) {
+    // Queued records are added with the memory usage as it was when they
+    // were queued, so stop queuing before the extra memory they can reserve
+    // for new people and attributes could bring the limit into play.
+    std::size_t extraMemory = (m_NumberPendingRecords + 1) *
+                              (model::CDataGatherer::ESTIMATED_MEM_USAGE_PER_BY_FIELD +
+                               model::CDataGatherer::ESTIMATED_MEM_USAGE_PER_OVER_FIELD);
+    if (this->canUseThreadPool(extraMemory) == false) {
+        // Records for a detector must be added in the order they're received
+        this->addPendingRecords();
+        this->preserveForPersist(detector);
+        detector.addRecord(time, fieldValues, numericValues);
+        return;
+    }
+
+    // All the detectors for a partition belong to the same shard.
+    SPendingRecords& pending =
+        m_PendingRecords[boost::hash<std::string>()(partitionFieldValue) %
+                         m_PendingRecords.size()];
+
+    pending.s_Records.emplace_back(&detector, time);
+    for (std::size_t j = 0; j < fieldValues.size(); ++j) {
+        std::size_t i = pending.s_NumberFieldValues++;
+        if (i == pending.s_FieldValues.size()) {
+            pending.s_FieldValues.emplace_back();
+            pending.s_Missing.push_back(false);
+            pending.s_NumericValues.push_back(0.0);
+            pending.s_Numeric.push_back(false);
+        }
+        if (fieldValues[j] == nullptr) {
+            pending.s_FieldValues[i].clear();
+            pending.s_Missing[i] = true;
+        } else {
+            pending.s_FieldValues[i].assign(*fieldValues[j]);
+            pending.s_Missing[i] = false;
+        }
+        const double* numericValue = j < numericValues.size() ? numericValues[j] : nullptr;
+        pending.s_Numeric[i] = numericValue != nullptr;
+        pending.s_NumericValues[i] = numericValue != nullptr ? *numericValue : 0.0;
+    }
+
+    if (++m_NumberPendingRecords >= MAX_PENDING_RECORDS) {
+        this->addPendingRecords();
+    }
+}
+
+void CAnomalyJob::addPendingRecords() {
+    if (m_NumberPendingRecords == 0) {
+        return;
+    }
+
+    model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+
+    if (m_PersistingDetectors.expired() == false) {
+        for (const auto& pending : m_PendingRecords) {
+            for (const auto& record : pending.s_Records) {
+                this->preserveForPersist(*record.first);
+            }
+        }
+    }
+
+    // Memory accounting is committed once all the shards are done so that
+    // allocation decisions don't depend on how the shards interleave.
+    resourceMonitor.deferRefreshes();
+
+    m_ThreadPool->parallelForEach(m_PendingRecords.size(), [this](std::size_t shard) {
+        SPendingRecords& pending = m_PendingRecords[shard];
+        model::CAnomalyDetector::TStrCPtrVec fieldValues;
+        TDoubleCPtrVec numericValues;
+        std::size_t i = 0;
+        for (const auto& record : pending.s_Records) {
+            std::size_t n = record.first->fieldsOfInterest().size();
+            fieldValues.clear();
+            numericValues.clear();
+            bool haveNumericValues = false;
+            for (std::size_t end = i + n; i < end; ++i) {
+                fieldValues.push_back(pending.s_Missing[i] ? nullptr
+                                                           : &pending.s_FieldValues[i]);
+                numericValues.push_back(pending.s_Numeric[i] ? &pending.s_NumericValues[i]
+                                                             : nullptr);
+                haveNumericValues = haveNumericValues || pending.s_Numeric[i];
+            }
+            if (haveNumericValues == false) {
+                numericValues.clear();
+            }
+            record.first->addRecord(record.second, fieldValues, numericValues);
+        }
+        pending.s_Records.clear();
+        pending.s_NumberFieldValues = 0;
+    });
+
+    resourceMonitor.commitDeferredRefreshes();
+
+    m_NumberPendingRecords = 0;
 }
 
 CAnomalyJob::SBackgroundPersistArgs::SBackgroundPersistArgs(
@@ -1494,7 +2535,91 @@ CAnomalyJob::SBackgroundPersistArgs::SBackgroundPersistArgs(
     core_t::TTime lastResultsTime)
     : s_ResultsQueue(resultsQueue), s_ModelPlotQueue(modelPlotQueue),
       s_Time(time), s_ModelSizeStats(modelSizeStats), s_Aggregator(aggregator),
-      s_LatestRecordTime(latestRecordTime), s_LastResultsTime(lastResultsTime) {
+      s_LatestRecordTime(latestRecordTime), s_LastResultsTime(lastResultsTime),
+      s_SnapshotTimestamp(0) {
+}
+
+CAnomalyJob::SPersistDetectors::SPersistDetectors(const TKeyCRefAnomalyDetectorPtrPrVec& detectors,
+                                                  const TSizeVec& memoryUsages,
+                                                  std::size_t maxCopyMemory)
+    : s_Detectors(detectors), s_Copies(detectors.size()),
+      s_MemoryUsages(memoryUsages), s_MaxCopyMemory(maxCopyMemory) {
+    s_MemoryUsages.resize(s_Detectors.size(), 0);
+    s_Indices.reserve(s_Detectors.size());
+    for (std::size_t i = 0u; i < s_Detectors.size(); ++i) {
+        s_Indices.emplace(s_Detectors[i].second.get(), i);
+    }
+}
+
+void CAnomalyJob::SPersistDetectors::preserve(const model::CAnomalyDetector& detector) {
+    auto i = s_Indices.find(&detector);
+    if (i != s_Indices.end()) {
+        this->preserve(i->second);
+    }
+}
+
+void CAnomalyJob::SPersistDetectors::preserve(std::size_t i) {
+    if (this->tryPreserve(i)) {
+        return;
+    }
+    core::CScopedLock lock(s_WrittenMutex);
+    while (s_Copies[i].s_Written == false && s_Finished == false) {
+        s_WrittenCondition.wait();
+    }
+}
+
+bool CAnomalyJob::SPersistDetectors::tryPreserve(std::size_t i) {
+    SCopy& copy = s_Copies[i];
+    core::CScopedLock lock(copy.s_Mutex);
+    if (copy.s_Written || copy.s_Detector != nullptr) {
+        return true;
+    }
+    if (s_CopyMemory + s_MemoryUsages[i] > s_MaxCopyMemory) {
+        return false;
+    }
+    copy.s_Detector = copyForPersistence(*s_Detectors[i].second);
+    s_PeakCopyMemory = std::max(s_PeakCopyMemory.load(), s_CopyMemory += s_MemoryUsages[i]);
+    return true;
+}
+
+void CAnomalyJob::SPersistDetectors::preserveAll() {
+    // Copy the detectors which will be written last and wait for the rest
+    for (std::size_t i = s_Detectors.size(); i > 0; --i) {
+        this->tryPreserve(i - 1);
+    }
+    for (std::size_t i = 0u; i < s_Detectors.size(); ++i) {
+        this->preserve(i);
+    }
+}
+
+void CAnomalyJob::SPersistDetectors::persist(std::size_t i,
+                                             core::CStatePersistInserter& inserter) {
+    SCopy& copy = s_Copies[i];
+    {
+        core::CScopedLock lock(copy.s_Mutex);
+        const model::CAnomalyDetector& detector =
+            copy.s_Detector != nullptr ? *copy.s_Detector : *s_Detectors[i].second;
+        inserter.insertLevel(TOP_LEVEL_DETECTOR_TAG,
+                             boost::bind(&CAnomalyJob::persistIndividualDetector,
+                                         boost::cref(detector), _1));
+        if (copy.s_Detector != nullptr) {
+            copy.s_Detector.reset();
+            s_CopyMemory -= s_MemoryUsages[i];
+        }
+        copy.s_Written = true;
+    }
+    core::CScopedLock lock(s_WrittenMutex);
+    s_WrittenCondition.broadcast();
+}
+
+void CAnomalyJob::SPersistDetectors::finish() {
+    core::CScopedLock lock(s_WrittenMutex);
+    s_Finished = true;
+    s_WrittenCondition.broadcast();
+}
+
+bool CAnomalyJob::SSnapshotManifest::isDelta() const {
+    return s_PreviousSnapshotId.empty() == false;
 }
 }
 }
@@ -35,6 +35,10 @@ const std::string TYPE_TAG("c");
 const std::string TIME_ATTRIBUTE("time");
 
 const std::string EMPTY_STRING;
+
+//! The tolerance for floating point error in the bounds used to rule out
+//! types without calculating their similarity.
+const double SIMILARITY_BOUND_TOLERANCE(0.00000000001);
 }
 
 CBaseTokenListDataTyper::CBaseTokenListDataTyper(const TTokenListReverseSearchCreatorIntfCPtr& reverseSearchCreator,
@@ -72,18 +76,70 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
         this->tokeniseString(fields, str, m_WorkTokenIds, m_WorkTokenUniqueIds, workWeight);
     }
 
+    return this->computeTypeOfWorkTokens(isDryRun, str, rawStringLen, workWeight);
+}
+
+int CBaseTokenListDataTyper::computeType(bool isDryRun,
+                                         const TStrSizePrVec& tokens,
+                                         const std::string& str,
+                                         size_t rawStringLen) {
+    // Token IDs are assigned here, in the order the strings are typed, so
+    // they don't depend on how tokenisation was scheduled
+    m_WorkTokenIds.clear();
+    m_WorkTokenUniqueIds.clear();
+    size_t workWeight(0);
+    for (const auto& token : tokens) {
+        TSizeSizePr idWithWeight(this->idForToken(token.first), token.second);
+        m_WorkTokenIds.push_back(idWithWeight);
+        m_WorkTokenUniqueIds[idWithWeight.first] += idWithWeight.second;
+        workWeight += idWithWeight.second;
+    }
+
+    return this->computeTypeOfWorkTokens(isDryRun, str, rawStringLen, workWeight);
+}
+
+bool CBaseTokenListDataTyper::tokenise(const TStrStrUMap& fields,
+                                       const std::string& str,
+                                       TStrSizePrVec& tokens) const {
+    tokens.clear();
+
+    auto preTokenisedIter = fields.find(PRETOKENISED_TOKEN_FIELD);
+    if (preTokenisedIter == fields.end()) {
+        this->tokeniseString(fields, str, tokens);
+        return true;
+    }
+
+    // The member line parser can't be shared between threads
+    CCsvInputParser::CCsvLineParser csvLineParser;
+    csvLineParser.reset(preTokenisedIter->second);
+    std::string token;
+    while (!csvLineParser.atEnd()) {
+        if (csvLineParser.parseNext(token) == false) {
+            return false;
+        }
+        tokens.emplace_back(token, this->tokenWeight(token));
+    }
+
+    return true;
+}
+
+int CBaseTokenListDataTyper::computeTypeOfWorkTokens(bool isDryRun,
+                                                     const std::string& str,
+                                                     size_t rawStringLen,
+                                                     size_t workWeight) {
     // Determine the minimum and maximum token weight that could possibly
     // match the weight we've got
     size_t minWeight(CBaseTokenListDataTyper::minMatchingWeight(workWeight, m_LowerThreshold));
     size_t maxWeight(CBaseTokenListDataTyper::maxMatchingWeight(workWeight, m_LowerThreshold));
 
-    // We search previous types in descending order of the number of matches
-    // we've seen for them
-    TSizeSizePrListItr bestSoFarIter(m_TypesByCount.end());
+    // We search the previous types which could possibly match in descending
+    // order of the number of matches we've seen for them
+    this->findCandidates(workWeight);
+
+    size_t bestSoFarPosition(m_TypesByCount.size());
     double bestSoFarSimilarity(m_LowerThreshold);
-    for (TSizeSizePrListItr iter = m_TypesByCount.begin();
-         iter != m_TypesByCount.end(); ++iter) {
-        const CTokenListType& compType = m_Types[iter->second];
+    for (auto position : m_WorkCandidates) {
+        const CTokenListType& compType = m_Types[m_TypesByCount[position].second];
         const TSizeSizePrVec& baseTokenIds = compType.baseTokenIds();
         size_t baseWeight(compType.baseWeight());
 
@@ -114,9 +170,21 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
             if (proportionOfOrig < m_LowerThreshold) {
                 continue;
             }
+
+            // Rule out types whose similarity can't exceed the best so far
+            // given the weight of the tokens they have in common
+            size_t largerWeight(std::max(workWeight, baseWeight));
+            if (largerWeight > 0 &&
+                double(compType.commonTokenWeight(m_WorkTokenUniqueIds)) <
+                    (bestSoFarSimilarity - SIMILARITY_BOUND_TOLERANCE) * double(largerWeight)) {
+                continue;
+            }
         }
 
-        double similarity(this->similarity(m_WorkTokenIds, workWeight, baseTokenIds, baseWeight));
+        // Unless the record matches the search we're only interested in the
+        // similarity if it beats the best so far
+        double similarity(this->similarity(m_WorkTokenIds, workWeight, baseTokenIds,
+                                           baseWeight, matchesSearch ? 0.0 : bestSoFarSimilarity));
 
         LOG_TRACE(<< similarity << '-' << compType.baseString() << '|' << str);
 
@@ -130,16 +198,16 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
 
             // This is a strong match, so accept it immediately and stop
             // looking for better matches - use vector index plus one as type
-            int type(1 + int(iter->second));
+            int type(1 + int(m_TypesByCount[position].second));
             this->addTypeMatch(isDryRun, str, rawStringLen, m_WorkTokenIds,
-                               m_WorkTokenUniqueIds, similarity, iter);
+                               m_WorkTokenUniqueIds, similarity, position);
             return type;
         }
 
         if (similarity > bestSoFarSimilarity) {
             // This is a weak match, but remember it because it's the best we've
             // seen
-            bestSoFarIter = iter;
+            bestSoFarPosition = position;
             bestSoFarSimilarity = similarity;
 
             // Recalculate the minimum and maximum token counts that might
@@ -149,19 +217,21 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
         }
     }
 
-    if (bestSoFarIter != m_TypesByCount.end()) {
+    if (bestSoFarPosition != m_TypesByCount.size()) {
         // Return the best match - use vector index plus one as type
-        int type(1 + int(bestSoFarIter->second));
+        int type(1 + int(m_TypesByCount[bestSoFarPosition].second));
         this->addTypeMatch(isDryRun, str, rawStringLen, m_WorkTokenIds,
-                           m_WorkTokenUniqueIds, bestSoFarSimilarity, bestSoFarIter);
+                           m_WorkTokenUniqueIds, bestSoFarSimilarity, bestSoFarPosition);
         return type;
     }
 
     // If we get here we haven't matched, so create a new type
     CTokenListType obj(isDryRun, str, rawStringLen, m_WorkTokenIds, workWeight,
                        m_WorkTokenUniqueIds);
+    m_TypePositions.push_back(m_TypesByCount.size());
     m_TypesByCount.push_back(TSizeSizePr(1, m_Types.size()));
     m_Types.push_back(obj);
+    this->indexType(m_Types.size() - 1);
     m_HasChanged = true;
 
     // Increment the counts of types that use a given token
@@ -341,6 +411,10 @@ bool CBaseTokenListDataTyper::hasChanged() const {
 bool CBaseTokenListDataTyper::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
     m_Types.clear();
     m_TypesByCount.clear();
+    m_TypePositions.clear();
+    m_TypesByToken.clear();
+    m_TypesByFirstCommonToken.clear();
+    m_TypesWithoutCommonTokens.clear();
     m_TokenIdLookup.clear();
     m_WorkTokenIds.clear();
     m_WorkTokenUniqueIds.clear();
@@ -375,9 +449,18 @@ bool CBaseTokenListDataTyper::acceptRestoreTraverser(core::CStateRestoreTraverse
         }
     } while (traverser.next());
 
-    // Types are persisted in order of creation, but this list needs to be
+    // Types are persisted in order of creation, but this vector needs to be
     // sorted by count instead
-    m_TypesByCount.sort(CPairFirstElementGreater());
+    std::stable_sort(m_TypesByCount.begin(), m_TypesByCount.end(),
+                     CPairFirstElementGreater());
+
+    m_TypePositions.resize(m_Types.size());
+    for (size_t position = 0; position < m_TypesByCount.size(); ++position) {
+        m_TypePositions[m_TypesByCount[position].second] = position;
+    }
+    for (size_t type = 0; type < m_Types.size(); ++type) {
+        this->indexType(type);
+    }
 
     return true;
 }
@@ -411,30 +494,41 @@ void CBaseTokenListDataTyper::addTypeMatch(bool isDryRun,
                                            const TSizeSizePrVec& tokenIds,
                                            const TSizeSizeMap& tokenUniqueIds,
                                            double similarity,
-                                           TSizeSizePrListItr& iter) {
-    if (m_Types[iter->second].addString(isDryRun, str, rawStringLen, tokenIds,
-                                        tokenUniqueIds, similarity) == true) {
+                                           size_t position) {
+    size_t type(m_TypesByCount[position].second);
+    CTokenListType& typeObj = m_Types[type];
+
+    // Adding the string can remove common unique tokens, so we may need to
+    // reindex the type
+    const TSizeSizePrVec& commonUniqueTokenIds = typeObj.commonUniqueTokenIds();
+    bool hadCommonTokens(commonUniqueTokenIds.empty() == false);
+    size_t firstCommonTokenId(hadCommonTokens ? commonUniqueTokenIds.front().first : 0);
+
+    if (typeObj.addString(isDryRun, str, rawStringLen, tokenIds, tokenUniqueIds,
+                          similarity) == true) {
         m_HasChanged = true;
     }
 
-    size_t& count = iter->first;
-    ++count;
+    if (hadCommonTokens && (commonUniqueTokenIds.empty() ||
+                            commonUniqueTokenIds.front().first != firstCommonTokenId)) {
+        this->unindexFirstCommonToken(type, firstCommonTokenId);
+        this->indexFirstCommonToken(type);
+    }
+
+    size_t count(++m_TypesByCount[position].first);
 
     // Search backwards for the point where the incremented count belongs
-    TSizeSizePrListItr swapIter(m_TypesByCount.end());
-    TSizeSizePrListItr checkIter(iter);
-    while (checkIter != m_TypesByCount.begin()) {
-        --checkIter;
-        if (count <= checkIter->first) {
-            break;
-        }
-        swapIter = checkIter;
+    size_t swapPosition(position);
+    while (swapPosition > 0 && count > m_TypesByCount[swapPosition - 1].first) {
+        --swapPosition;
     }
 
-    // Move the iterator we've matched nearer the front of the list if it
+    // Move the type we've matched nearer the front of the vector if it
     // deserves this
-    if (swapIter != m_TypesByCount.end()) {
-        std::iter_swap(swapIter, iter);
+    if (swapPosition != position) {
+        std::swap(m_TypesByCount[swapPosition], m_TypesByCount[position]);
+        m_TypePositions[m_TypesByCount[swapPosition].second] = swapPosition;
+        m_TypePositions[m_TypesByCount[position].second] = position;
     }
 }
 
@@ -504,6 +598,89 @@ bool CBaseTokenListDataTyper::addPretokenisedTokens(const std::string& tokensCsv
     return true;
 }
 
+void CBaseTokenListDataTyper::findCandidates(size_t workWeight) {
+    m_WorkCandidates.clear();
+
+    // Types with no common unique tokens could match the reverse search of
+    // any string
+    for (auto type : m_TypesWithoutCommonTokens) {
+        m_WorkCandidates.push_back(m_TypePositions[type]);
+    }
+
+    // Otherwise a type can only match the reverse search if the string
+    // contains all its common unique tokens, including the first
+    m_WorkTokenRarities.clear();
+    for (const auto& tokenUniqueId : m_WorkTokenUniqueIds) {
+        size_t tokenId(tokenUniqueId.first);
+        if (tokenId < m_TypesByFirstCommonToken.size()) {
+            for (auto type : m_TypesByFirstCommonToken[tokenId]) {
+                m_WorkCandidates.push_back(m_TypePositions[type]);
+            }
+        }
+        size_t typeCount(tokenId < m_TypesByToken.size() ? m_TypesByToken[tokenId].size() : 0);
+        m_WorkTokenRarities.emplace_back(typeCount, tokenId);
+    }
+
+    // The similarity can't exceed the weight of the tokens in common divided
+    // by the larger weight.  So if the tokens which remain after removing the
+    // rarest ones weigh less than the threshold times the string's weight,
+    // any type containing none of the rarest tokens can't match.
+    std::sort(m_WorkTokenRarities.begin(), m_WorkTokenRarities.end());
+    double maxRemainingWeight((m_LowerThreshold - SIMILARITY_BOUND_TOLERANCE) *
+                              double(workWeight));
+    size_t remainingWeight(workWeight);
+    for (const auto& tokenRarity : m_WorkTokenRarities) {
+        if (double(remainingWeight) < maxRemainingWeight) {
+            break;
+        }
+        size_t tokenId(tokenRarity.second);
+        if (tokenId < m_TypesByToken.size()) {
+            for (auto type : m_TypesByToken[tokenId]) {
+                m_WorkCandidates.push_back(m_TypePositions[type]);
+            }
+        }
+        remainingWeight -= m_WorkTokenUniqueIds[tokenId];
+    }
+
+    std::sort(m_WorkCandidates.begin(), m_WorkCandidates.end());
+    m_WorkCandidates.erase(std::unique(m_WorkCandidates.begin(), m_WorkCandidates.end()),
+                           m_WorkCandidates.end());
+}
+
+void CBaseTokenListDataTyper::indexType(size_t type) {
+    for (const auto& baseUniqueTokenId : m_Types[type].baseUniqueTokenIds()) {
+        size_t tokenId(baseUniqueTokenId.first);
+        if (tokenId >= m_TypesByToken.size()) {
+            m_TypesByToken.resize(tokenId + 1);
+        }
+        m_TypesByToken[tokenId].push_back(type);
+    }
+    this->indexFirstCommonToken(type);
+}
+
+void CBaseTokenListDataTyper::indexFirstCommonToken(size_t type) {
+    const TSizeSizePrVec& commonUniqueTokenIds = m_Types[type].commonUniqueTokenIds();
+    if (commonUniqueTokenIds.empty()) {
+        m_TypesWithoutCommonTokens.push_back(type);
+        return;
+    }
+    size_t tokenId(commonUniqueTokenIds.front().first);
+    if (tokenId >= m_TypesByFirstCommonToken.size()) {
+        m_TypesByFirstCommonToken.resize(tokenId + 1);
+    }
+    m_TypesByFirstCommonToken[tokenId].push_back(type);
+}
+
+void CBaseTokenListDataTyper::unindexFirstCommonToken(size_t type, size_t tokenId) {
+    if (tokenId >= m_TypesByFirstCommonToken.size()) {
+        LOG_ERROR(<< "Inconsistency - type " << type
+                  << " is not indexed by token " << tokenId);
+        return;
+    }
+    TSizeVec& types = m_TypesByFirstCommonToken[tokenId];
+    types.erase(std::remove(types.begin(), types.end(), type), types.end());
+}
+
 CBaseTokenListDataTyper::CTokenInfoItem::CTokenInfoItem(const std::string& str, size_t index)
     : m_Str(str), m_Index(index), m_TypeCount(0) {
 }
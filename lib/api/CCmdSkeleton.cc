@@ -12,8 +12,6 @@
 #include <api/CDataProcessor.h>
 #include <api/CInputParser.h>
 
-#include <boost/bind.hpp>
-
 namespace ml {
 namespace api {
 
@@ -36,8 +34,15 @@ bool CCmdSkeleton::ioLoop() {
         }
     }
 
-    if (m_InputParser.readStream(boost::bind(&CDataProcessor::handleRecord,
-                                             &m_Processor, _1)) == false) {
+    if (m_InputParser.readStreamIntoTypedVecs(
+            [this](const CInputParser::TStrVec& fieldNames,
+                   const CInputParser::TFieldTypeVec& fieldTypes) {
+                return m_Processor.handleTypedFieldNames(fieldNames, fieldTypes);
+            },
+            [this](const CInputParser::TStrVec& stringValues,
+                   const CInputParser::TDoubleVec& numericValues) {
+                return m_Processor.handleTypedFieldValues(stringValues, numericValues);
+            }) == false) {
         LOG_FATAL(<< "Failed to handle all input data");
         return false;
     }
@@ -40,22 +40,12 @@ const std::string& CCsvInputParser::fieldNameStr() const {
 }
 
 bool CCsvInputParser::readStream(const TReaderFunc& readerFunc) {
-    // Reset the record buffer pointers in case we're reading a new stream
-    m_WorkBufferEnd = m_WorkBufferPtr;
-    m_NoMoreRecords = false;
-    TStrVec& fieldNames = this->fieldNames();
+    if (this->startStream() == false) {
+        return false;
+    }
 
-    if (!this->gotFieldNames()) {
-        if (this->parseCsvRecordFromStream() == false) {
-            LOG_ERROR(<< "Failed to parse CSV record from stream");
-            return false;
-        }
+    const TStrVec& fieldNames = this->fieldNames();
 
-        if (this->parseFieldNames() == false) {
-            LOG_ERROR(<< "Failed to parse field names from stream");
-            return false;
-        }
-    }
     // We reuse the same field map for every record
     TStrStrUMap recordFields;
 
@@ -91,6 +81,65 @@ bool CCsvInputParser::readStream(const TReaderFunc& readerFunc) {
     return true;
 }
 
+bool CCsvInputParser::readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                         const TVecReaderFunc& readerFunc) {
+    if (this->startStream() == false) {
+        return false;
+    }
+
+    const TStrVec& fieldNames = this->fieldNames();
+    if (fieldNamesFunc(fieldNames) == false) {
+        LOG_ERROR(<< "Field names handler function forced exit");
+        return false;
+    }
+
+    // We reuse the same field values for every record
+    TStrVec fieldValues(fieldNames.size());
+
+    while (!m_NoMoreRecords) {
+        if (this->parseCsvRecordFromStream() == false) {
+            LOG_ERROR(<< "Failed to parse CSV record from stream");
+            return false;
+        }
+
+        if (m_NoMoreRecords) {
+            break;
+        }
+
+        if (this->parseDataRecord(fieldValues) == false) {
+            LOG_ERROR(<< "Failed to parse data record from stream");
+            return false;
+        }
+
+        if (readerFunc(fieldValues) == false) {
+            LOG_ERROR(<< "Record handler function forced exit");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CCsvInputParser::startStream() {
+    // Reset the record buffer pointers in case we're reading a new stream
+    m_WorkBufferEnd = m_WorkBufferPtr;
+    m_NoMoreRecords = false;
+
+    if (!this->gotFieldNames()) {
+        if (this->parseCsvRecordFromStream() == false) {
+            LOG_ERROR(<< "Failed to parse CSV record from stream");
+            return false;
+        }
+
+        if (this->parseFieldNames() == false) {
+            LOG_ERROR(<< "Failed to parse field names from stream");
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool CCsvInputParser::parseCsvRecordFromStream() {
     // For maximum performance, read the stream in large chunks that can be
     // moved around by memcpy().  Using memcpy() is an order of magnitude faster
@@ -211,9 +260,10 @@ bool CCsvInputParser::parseFieldNames() {
     return true;
 }
 
-bool CCsvInputParser::parseDataRecord(const TStrRefVec& fieldValRefs) {
-    for (TStrRefVecCItr iter = fieldValRefs.begin(); iter != fieldValRefs.end(); ++iter) {
-        if (m_LineParser.parseNext(iter->get()) == false) {
+template<typename STR_VEC>
+bool CCsvInputParser::parseDataRecord(STR_VEC& fieldValues) {
+    for (auto& fieldValue : fieldValues) {
+        if (m_LineParser.parseNext(boost::unwrap_ref(fieldValue)) == false) {
             LOG_ERROR(<< "Failed to get next CSV token");
             return false;
         }
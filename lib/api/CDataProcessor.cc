@@ -7,13 +7,15 @@
 
 #include <core/CLogger.h>
 
+#include <algorithm>
+
 namespace ml {
 namespace api {
 
 // statics
 const std::string CDataProcessor::CONTROL_FIELD_NAME(1, CONTROL_FIELD_NAME_CHAR);
 
-CDataProcessor::CDataProcessor() {
+CDataProcessor::CDataProcessor() : m_HaveNumericFields(false) {
 }
 
 CDataProcessor::~CDataProcessor() {
@@ -22,6 +24,69 @@ CDataProcessor::~CDataProcessor() {
     // empty definition to the header file!
 }
 
+bool CDataProcessor::handleFieldNames(const TStrVec& fieldNames) {
+    m_WorkRecordFieldRefs.clear();
+    m_WorkRecordFields.clear();
+
+    m_WorkRecordFieldRefs.reserve(fieldNames.size());
+    for (const auto& fieldName : fieldNames) {
+        m_WorkRecordFieldRefs.push_back(boost::ref(m_WorkRecordFields[fieldName]));
+    }
+
+    return true;
+}
+
+bool CDataProcessor::handleFieldValues(const TStrVec& fieldValues) {
+    if (fieldValues.size() != m_WorkRecordFieldRefs.size()) {
+        LOG_ERROR(<< "Record has " << fieldValues.size() << " fields but "
+                  << m_WorkRecordFieldRefs.size() << " field names were supplied");
+        return false;
+    }
+
+    for (std::size_t i = 0; i < fieldValues.size(); ++i) {
+        m_WorkRecordFieldRefs[i].get() = fieldValues[i];
+    }
+
+    return this->handleRecord(m_WorkRecordFields);
+}
+
+bool CDataProcessor::handleTypedFieldNames(const TStrVec& fieldNames,
+                                           const TFieldTypeVec& fieldTypes) {
+    m_FieldTypes = fieldTypes;
+    m_HaveNumericFields = std::any_of(
+        m_FieldTypes.begin(), m_FieldTypes.end(), [](CInputParser::EFieldType type) {
+            return type != CInputParser::E_String;
+        });
+
+    return this->handleFieldNames(fieldNames);
+}
+
+bool CDataProcessor::handleTypedFieldValues(const TStrVec& stringValues,
+                                            const TDoubleVec& numericValues) {
+    if (m_HaveNumericFields == false) {
+        return this->handleFieldValues(stringValues);
+    }
+
+    if (stringValues.size() != m_FieldTypes.size() ||
+        numericValues.size() != m_FieldTypes.size()) {
+        LOG_ERROR(<< "Record has " << stringValues.size() << " fields but "
+                  << m_FieldTypes.size() << " field types were supplied");
+        return false;
+    }
+
+    m_WorkFieldValues.resize(stringValues.size());
+    for (std::size_t i = 0; i < stringValues.size(); ++i) {
+        if (m_FieldTypes[i] == CInputParser::E_String) {
+            m_WorkFieldValues[i] = stringValues[i];
+        } else {
+            CInputParser::formatNumericValue(m_FieldTypes[i], numericValues[i],
+                                             m_WorkFieldValues[i]);
+        }
+    }
+
+    return this->handleFieldValues(m_WorkFieldValues);
+}
+
 std::string CDataProcessor::debugPrintRecord(const TStrStrUMap& dataRowFields) {
     if (dataRowFields.empty()) {
         return "<EMPTY RECORD>";
@@ -49,6 +114,28 @@ std::string CDataProcessor::debugPrintRecord(const TStrStrUMap& dataRowFields) {
     return result.str();
 }
 
+std::string CDataProcessor::debugPrintRecord(const TStrVec& fieldNames,
+                                             const TStrVec& fieldValues) {
+    if (fieldNames.empty()) {
+        return "<EMPTY RECORD>";
+    }
+
+    std::ostringstream result;
+
+    // We want to print the field names on one line, followed by the field
+    // values on the next line
+
+    for (std::size_t i = 0; i < fieldNames.size(); ++i) {
+        result << (i == 0 ? "" : ",") << fieldNames[i];
+    }
+    result << core_t::LINE_ENDING;
+    for (std::size_t i = 0; i < fieldValues.size(); ++i) {
+        result << (i == 0 ? "" : ",") << fieldValues[i];
+    }
+
+    return result.str();
+}
+
 bool CDataProcessor::periodicPersistState(CBackgroundPersister& /*persister*/) {
     // No-op
     return true;
@@ -16,6 +16,7 @@
 #include <core/CStringUtils.h>
 
 #include <api/CBackgroundPersister.h>
+#include <api/CBaseTokenListDataTyper.h>
 #include <api/CFieldConfig.h>
 #include <api/CJsonOutputWriter.h>
 #include <api/COutputHandler.h>
@@ -23,6 +24,8 @@
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <memory>
 #include <sstream>
 
 namespace ml {
@@ -33,6 +36,9 @@ namespace {
 const std::string VERSION_TAG("a");
 const std::string TYPER_TAG("b");
 const std::string EXAMPLES_COLLECTOR_TAG("c");
+
+//! The number of records in each batch which is tokenised in parallel
+const std::size_t PIPELINE_BATCH_SIZE(1000);
 } // unnamed
 
 // Initialise statics
@@ -47,18 +53,28 @@ CFieldDataTyper::CFieldDataTyper(const std::string& jobId,
                                  const model::CLimits& limits,
                                  COutputHandler& outputHandler,
                                  CJsonOutputWriter& jsonOutputWriter,
-                                 CBackgroundPersister* periodicPersister)
+                                 CBackgroundPersister* periodicPersister,
+                                 std::size_t numberThreads)
     : m_JobId(jobId), m_OutputHandler(outputHandler),
       m_ExtraFieldNames(1, MLCATEGORY_NAME), m_WriteFieldNames(true),
-      m_NumRecordsHandled(0), m_OutputFieldCategory(m_Overrides[MLCATEGORY_NAME]),
+      m_ControlFieldIndex(0), m_CategorizationFieldIndex(0),
+      m_PretokenisedFieldIndex(0), m_NumRecordsHandled(0),
+      m_OutputFieldCategory(m_Overrides[MLCATEGORY_NAME]),
       m_MaxMatchingLength(0), m_JsonOutputWriter(jsonOutputWriter),
       m_ExamplesCollector(limits.maxExamples()),
       m_CategorizationFieldName(config.categorizationFieldName()),
-      m_CategorizationFilter(), m_PeriodicPersister(periodicPersister) {
+      m_CategorizationFilter(), m_PeriodicPersister(periodicPersister),
+      m_FillingBatch(0) {
     this->createTyper(m_CategorizationFieldName);
 
     LOG_DEBUG(<< "Configuring categorization filtering");
     m_CategorizationFilter.configure(config.categorizationFilters());
+
+    // The calling thread assigns the categories
+    if (numberThreads > 1) {
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+        LOG_DEBUG(<< "Using " << numberThreads << " threads to categorize records");
+    }
 }
 
 CFieldDataTyper::~CFieldDataTyper() {
@@ -66,6 +82,7 @@ CFieldDataTyper::~CFieldDataTyper() {
 }
 
 void CFieldDataTyper::newOutputStream() {
+    this->categorizePendingRecords();
     m_WriteFieldNames = true;
     m_OutputHandler.newOutputStream();
 }
@@ -90,12 +107,26 @@ bool CFieldDataTyper::handleRecord(const TStrStrUMap& dataRowFields) {
     // Non-empty control fields take precedence over everything else
     TStrStrUMapCItr iter = dataRowFields.find(CONTROL_FIELD_NAME);
     if (iter != dataRowFields.end() && !iter->second.empty()) {
+        if (this->categorizePendingRecords() == false) {
+            return false;
+        }
         if (m_OutputHandler.consumesControlMessages()) {
             return m_OutputHandler.writeRow(dataRowFields, m_Overrides);
         }
         return this->handleControlMessage(iter->second);
     }
 
+    if (m_ThreadPool != nullptr) {
+        SPendingRecord& record = this->nextPendingRecord();
+        record.s_Positional = false;
+        record.s_DataRowFields = dataRowFields;
+        const std::string* fieldValue = this->categorizationFieldValue(dataRowFields);
+        if (fieldValue != nullptr) {
+            record.s_Value = *fieldValue;
+        }
+        return this->queuedRecord();
+    }
+
     m_OutputFieldCategory = core::CStringUtils::typeToString(this->computeType(dataRowFields));
 
     if (m_OutputHandler.writeRow(dataRowFields, m_Overrides) == false) {
@@ -108,7 +139,86 @@ bool CFieldDataTyper::handleRecord(const TStrStrUMap& dataRowFields) {
     return true;
 }
 
+bool CFieldDataTyper::handleFieldNames(const TStrVec& fieldNames) {
+    // Queued records must be output with the field names they arrived with
+    if (this->categorizePendingRecords() == false) {
+        return false;
+    }
+
+    m_FieldNames = fieldNames;
+    m_ControlFieldIndex = static_cast<std::size_t>(
+        std::find(m_FieldNames.begin(), m_FieldNames.end(), CONTROL_FIELD_NAME) -
+        m_FieldNames.begin());
+    m_CategorizationFieldIndex = static_cast<std::size_t>(
+        std::find(m_FieldNames.begin(), m_FieldNames.end(), m_CategorizationFieldName) -
+        m_FieldNames.begin());
+    m_PretokenisedFieldIndex = static_cast<std::size_t>(
+        std::find(m_FieldNames.begin(), m_FieldNames.end(),
+                  CBaseTokenListDataTyper::PRETOKENISED_TOKEN_FIELD) -
+        m_FieldNames.begin());
+
+    // Different field names must be passed on before the next output
+    m_WriteFieldNames = true;
+
+    return true;
+}
+
+bool CFieldDataTyper::handleFieldValues(const TStrVec& fieldValues) {
+    if (fieldValues.size() != m_FieldNames.size()) {
+        LOG_ERROR(<< "Record has " << fieldValues.size() << " fields but "
+                  << m_FieldNames.size() << " field names were supplied");
+        return false;
+    }
+
+    // First time through we output the field names
+    if (m_WriteFieldNames) {
+        if (m_OutputHandler.fieldNames(m_FieldNames, m_ExtraFieldNames) == false) {
+            LOG_ERROR(<< "Unable to set field names for output:" << core_t::LINE_ENDING
+                      << this->debugPrintRecord(m_FieldNames, fieldValues));
+            return false;
+        }
+        m_WriteFieldNames = false;
+    }
+
+    // Non-empty control fields take precedence over everything else
+    if (m_ControlFieldIndex < fieldValues.size() &&
+        !fieldValues[m_ControlFieldIndex].empty()) {
+        if (this->categorizePendingRecords() == false) {
+            return false;
+        }
+        if (m_OutputHandler.consumesControlMessages()) {
+            return m_OutputHandler.writeRow(m_FieldNames, fieldValues, m_Overrides);
+        }
+        return this->handleControlMessage(fieldValues[m_ControlFieldIndex]);
+    }
+
+    if (m_ThreadPool != nullptr) {
+        SPendingRecord& record = this->nextPendingRecord();
+        record.s_Positional = true;
+        record.s_FieldValues = fieldValues;
+        this->typerFields(fieldValues, record.s_DataRowFields);
+        const std::string* fieldValue = this->categorizationFieldValue(fieldValues);
+        if (fieldValue != nullptr) {
+            record.s_Value = *fieldValue;
+        }
+        return this->queuedRecord();
+    }
+
+    m_OutputFieldCategory = core::CStringUtils::typeToString(this->computeType(fieldValues));
+
+    if (m_OutputHandler.writeRow(m_FieldNames, fieldValues, m_Overrides) == false) {
+        LOG_ERROR(<< "Unable to write output with type " << m_OutputFieldCategory
+                  << " for input:" << core_t::LINE_ENDING
+                  << this->debugPrintRecord(m_FieldNames, fieldValues));
+        return false;
+    }
+    ++m_NumRecordsHandled;
+    return true;
+}
+
 void CFieldDataTyper::finalise() {
+    this->categorizePendingRecords();
+
     // Pass on the request in case we're chained
     m_OutputHandler.finalise();
 
@@ -129,13 +239,52 @@ COutputHandler& CFieldDataTyper::outputHandler() {
 }
 
 int CFieldDataTyper::computeType(const TStrStrUMap& dataRowFields) {
+    const std::string* fieldValue = this->categorizationFieldValue(dataRowFields);
+    return fieldValue == nullptr ? -1 : this->computeType(dataRowFields, *fieldValue);
+}
+
+int CFieldDataTyper::computeType(const TStrVec& fieldValues) {
+    const std::string* fieldValue = this->categorizationFieldValue(fieldValues);
+    if (fieldValue == nullptr) {
+        return -1;
+    }
+    this->typerFields(fieldValues, m_TyperFields);
+    return this->computeType(m_TyperFields, *fieldValue);
+}
+
+void CFieldDataTyper::typerFields(const TStrVec& fieldValues, TStrStrUMap& fields) const {
+    // The typer doesn't exclude field names from its analysis, so only
+    // needs the pretokenised tokens, which Java supplies if it has them
+    if (m_PretokenisedFieldIndex < fieldValues.size()) {
+        fields[CBaseTokenListDataTyper::PRETOKENISED_TOKEN_FIELD] =
+            fieldValues[m_PretokenisedFieldIndex];
+    } else {
+        fields.clear();
+    }
+}
+
+int CFieldDataTyper::computeType(const TStrStrUMap& dataRowFields, const std::string& fieldValue) {
+    int type = -1;
+    if (m_CategorizationFilter.empty()) {
+        type = m_DataTyper->computeType(false, dataRowFields, fieldValue,
+                                        fieldValue.length());
+    } else {
+        std::string filtered = m_CategorizationFilter.apply(fieldValue);
+        type = m_DataTyper->computeType(false, dataRowFields, filtered,
+                                        fieldValue.length());
+    }
+    return this->recordType(type, fieldValue);
+}
+
+const std::string*
+CFieldDataTyper::categorizationFieldValue(const TStrStrUMap& dataRowFields) const {
     const std::string& categorizationFieldName = m_DataTyper->fieldName();
     TStrStrUMapCItr fieldIter = dataRowFields.find(categorizationFieldName);
     if (fieldIter == dataRowFields.end()) {
         LOG_WARN(<< "Assigning type -1 to record with no "
                  << categorizationFieldName << " field:" << core_t::LINE_ENDING
                  << this->debugPrintRecord(dataRowFields));
-        return -1;
+        return nullptr;
     }
 
     const std::string& fieldValue = fieldIter->second;
@@ -143,18 +292,32 @@ int CFieldDataTyper::computeType(const TStrStrUMap& dataRowFields) {
         LOG_WARN(<< "Assigning type -1 to record with blank "
                  << categorizationFieldName << " field:" << core_t::LINE_ENDING
                  << this->debugPrintRecord(dataRowFields));
-        return -1;
+        return nullptr;
     }
 
-    int type = -1;
-    if (m_CategorizationFilter.empty()) {
-        type = m_DataTyper->computeType(false, dataRowFields, fieldValue,
-                                        fieldValue.length());
-    } else {
-        std::string filtered = m_CategorizationFilter.apply(fieldValue);
-        type = m_DataTyper->computeType(false, dataRowFields, filtered,
-                                        fieldValue.length());
+    return &fieldValue;
+}
+
+const std::string* CFieldDataTyper::categorizationFieldValue(const TStrVec& fieldValues) const {
+    if (m_CategorizationFieldIndex >= fieldValues.size()) {
+        LOG_WARN(<< "Assigning type -1 to record with no "
+                 << m_CategorizationFieldName << " field:" << core_t::LINE_ENDING
+                 << this->debugPrintRecord(m_FieldNames, fieldValues));
+        return nullptr;
     }
+
+    const std::string& fieldValue = fieldValues[m_CategorizationFieldIndex];
+    if (fieldValue.empty()) {
+        LOG_WARN(<< "Assigning type -1 to record with blank "
+                 << m_CategorizationFieldName << " field:" << core_t::LINE_ENDING
+                 << this->debugPrintRecord(m_FieldNames, fieldValues));
+        return nullptr;
+    }
+
+    return &fieldValue;
+}
+
+int CFieldDataTyper::recordType(int type, const std::string& fieldValue) {
     if (type < 1) {
         return -1;
     }
@@ -176,6 +339,135 @@ int CFieldDataTyper::computeType(const TStrStrUMap& dataRowFields) {
     return type;
 }
 
+CFieldDataTyper::SPendingRecord& CFieldDataTyper::nextPendingRecord() {
+    SPendingBatch& batch = m_PendingBatches[m_FillingBatch];
+    if (batch.s_Size == batch.s_Records.size()) {
+        batch.s_Records.emplace_back();
+    }
+    SPendingRecord& record = batch.s_Records[batch.s_Size];
+    record.s_Value.clear();
+    record.s_Tokenised = false;
+    return record;
+}
+
+bool CFieldDataTyper::queuedRecord() {
+    SPendingBatch& batch = m_PendingBatches[m_FillingBatch];
+    if (++batch.s_Size < PIPELINE_BATCH_SIZE) {
+        return true;
+    }
+
+    // Tokenise this batch in the background while categorizing the batch
+    // which was tokenised in the background before it
+    this->startTokenising(batch);
+    m_FillingBatch = 1 - m_FillingBatch;
+    return this->categorize(m_PendingBatches[m_FillingBatch]);
+}
+
+bool CFieldDataTyper::categorizePendingRecords() {
+    if (m_ThreadPool == nullptr) {
+        return true;
+    }
+
+    // The batch being tokenised was received first
+    SPendingBatch& filling = m_PendingBatches[m_FillingBatch];
+    bool result = this->categorize(m_PendingBatches[1 - m_FillingBatch]);
+    if (filling.s_Size > 0) {
+        this->startTokenising(filling);
+        result = this->categorize(filling) && result;
+    }
+    return result;
+}
+
+void CFieldDataTyper::startTokenising(SPendingBatch& batch) {
+    batch.s_NextToTokenise.store(0);
+    std::size_t tasks{std::min(m_ThreadPool->size(), batch.s_Size)};
+    {
+        std::lock_guard<std::mutex> lock(m_TokenisingMutex);
+        batch.s_TokenisingTasks = tasks;
+    }
+
+    for (std::size_t i = 0; i < tasks; ++i) {
+        m_ThreadPool->schedule([this, &batch] {
+            for (std::size_t j = batch.s_NextToTokenise++; j < batch.s_Size;
+                 j = batch.s_NextToTokenise++) {
+                this->tokenise(batch.s_Records[j]);
+            }
+            std::lock_guard<std::mutex> lock(m_TokenisingMutex);
+            if (--batch.s_TokenisingTasks == 0) {
+                m_TokenisingComplete.notify_one();
+            }
+        });
+    }
+}
+
+void CFieldDataTyper::waitForTokenising(SPendingBatch& batch) {
+    // Rather than sit idle the calling thread takes any remaining records
+    for (std::size_t i = batch.s_NextToTokenise++; i < batch.s_Size;
+         i = batch.s_NextToTokenise++) {
+        this->tokenise(batch.s_Records[i]);
+    }
+
+    std::unique_lock<std::mutex> lock(m_TokenisingMutex);
+    m_TokenisingComplete.wait(lock, [&batch] { return batch.s_TokenisingTasks == 0; });
+}
+
+void CFieldDataTyper::tokenise(SPendingRecord& record) const {
+    if (record.s_Value.empty()) {
+        return;
+    }
+
+    if (m_CategorizationFilter.empty()) {
+        record.s_Tokenised = m_DataTyper->tokenise(record.s_DataRowFields,
+                                                   record.s_Value, record.s_Tokens);
+    } else {
+        record.s_FilteredValue = m_CategorizationFilter.apply(record.s_Value);
+        record.s_Tokenised = m_DataTyper->tokenise(
+            record.s_DataRowFields, record.s_FilteredValue, record.s_Tokens);
+    }
+}
+
+bool CFieldDataTyper::categorize(SPendingBatch& batch) {
+    if (batch.s_Size == 0) {
+        return true;
+    }
+
+    this->waitForTokenising(batch);
+
+    bool result = true;
+    for (std::size_t i = 0; i < batch.s_Size; ++i) {
+        SPendingRecord& record = batch.s_Records[i];
+
+        int type = -1;
+        if (record.s_Tokenised) {
+            const std::string& value = m_CategorizationFilter.empty()
+                                           ? record.s_Value
+                                           : record.s_FilteredValue;
+            type = this->recordType(m_DataTyper->computeType(false, record.s_Tokens, value,
+                                                             record.s_Value.length()),
+                                    record.s_Value);
+        }
+        m_OutputFieldCategory = core::CStringUtils::typeToString(type);
+
+        bool written = record.s_Positional
+                           ? m_OutputHandler.writeRow(m_FieldNames, record.s_FieldValues,
+                                                      m_Overrides)
+                           : m_OutputHandler.writeRow(record.s_DataRowFields, m_Overrides);
+        if (written == false) {
+            LOG_ERROR(<< "Unable to write output with type " << m_OutputFieldCategory
+                      << " for input:" << core_t::LINE_ENDING
+                      << (record.s_Positional
+                              ? this->debugPrintRecord(m_FieldNames, record.s_FieldValues)
+                              : this->debugPrintRecord(record.s_DataRowFields)));
+            result = false;
+            continue;
+        }
+        ++m_NumRecordsHandled;
+    }
+    batch.s_Size = 0;
+
+    return result;
+}
+
 void CFieldDataTyper::createTyper(const std::string& fieldName) {
     // TODO - if we ever have more than one data typer class, this should be
     // replaced with a factory
@@ -453,6 +745,10 @@ bool CFieldDataTyper::handleControlMessage(const std::string& controlMessage) {
     return true;
 }
 
+CFieldDataTyper::SPendingBatch::SPendingBatch()
+    : s_Size(0), s_NextToTokenise(0), s_TokenisingTasks(0) {
+}
+
 void CFieldDataTyper::acknowledgeFlush(const std::string& flushId) {
     if (flushId.empty()) {
         LOG_ERROR(<< "Received flush control message with no ID");
@@ -5,6 +5,13 @@
  */
 #include <api/CInputParser.h>
 
+#include <core/CIEEE754.h>
+#include <core/CStringUtils.h>
+#include <core/CoreTypes.h>
+
+#include <cmath>
+#include <limits>
+
 namespace ml {
 namespace api {
 
@@ -26,6 +33,80 @@ const CInputParser::TStrVec& CInputParser::fieldNames() const {
     return m_FieldNames;
 }
 
+void CInputParser::formatNumericValue(EFieldType type, double value, std::string& str) {
+    if (type == E_Time) {
+        core_t::TTime time;
+        if (numericValueToTime(value, time)) {
+            str = core::CStringUtils::typeToString(time);
+        } else {
+            str.clear();
+        }
+    } else if (std::isnan(value)) {
+        str.clear();
+    } else {
+        str = core::CStringUtils::typeToStringPrecise(value, core::CIEEE754::E_DoublePrecision);
+    }
+}
+
+bool CInputParser::numericValueToTime(double value, core_t::TTime& time) {
+    // Converting a double which is out of range for the integer type is
+    // undefined behaviour. The minimum is a power of two so it and its
+    // negation are exactly representable as doubles; the comparisons are
+    // false for NaN.
+    static const double MIN_TIME{
+        static_cast<double>(std::numeric_limits<core_t::TTime>::min())};
+    if (value >= MIN_TIME && value < -MIN_TIME) {
+        time = static_cast<core_t::TTime>(value);
+        return true;
+    }
+    return false;
+}
+
+bool CInputParser::readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                      const TVecReaderFunc& readerFunc) {
+    // Derived classes that don't override this method may produce records
+    // with different fields, so the field names have to be checked for
+    // every record
+    TStrVec lastFieldNames;
+    TStrVec recordFieldNames;
+    TStrVec recordFieldValues;
+
+    return this->readStream([&fieldNamesFunc, &readerFunc, &lastFieldNames, &recordFieldNames,
+                             &recordFieldValues](const TStrStrUMap& recordFields) {
+        recordFieldNames.clear();
+        recordFieldValues.clear();
+        for (const auto& recordField : recordFields) {
+            recordFieldNames.push_back(recordField.first);
+            recordFieldValues.push_back(recordField.second);
+        }
+
+        if (recordFieldNames != lastFieldNames) {
+            lastFieldNames.swap(recordFieldNames);
+            if (fieldNamesFunc(lastFieldNames) == false) {
+                return false;
+            }
+        }
+
+        return readerFunc(recordFieldValues);
+    });
+}
+
+bool CInputParser::readStreamIntoTypedVecs(const TTypedFieldNamesFunc& fieldNamesFunc,
+                                           const TTypedVecReaderFunc& readerFunc) {
+    TFieldTypeVec fieldTypes;
+    TDoubleVec numericValues;
+
+    return this->readStreamIntoVecs(
+        [&fieldNamesFunc, &fieldTypes, &numericValues](const TStrVec& fieldNames) {
+            fieldTypes.assign(fieldNames.size(), E_String);
+            numericValues.assign(fieldNames.size(), 0.0);
+            return fieldNamesFunc(fieldNames, fieldTypes);
+        },
+        [&readerFunc, &numericValues](const TStrVec& fieldValues) {
+            return readerFunc(fieldValues, numericValues);
+        });
+}
+
 void CInputParser::gotFieldNames(bool gotFieldNames) {
     m_GotFieldNames = gotFieldNames;
 }
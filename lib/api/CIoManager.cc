@@ -6,10 +6,15 @@
 #include <api/CIoManager.h>
 
 #include <core/CLogger.h>
+#include <core/CRingBufferStreamBuf.h>
+#include <core/CThread.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <vector>
 
 namespace ml {
 namespace api {
@@ -49,6 +54,60 @@ bool setUpOStream(const std::string& fileName,
 }
 }
 
+//! \brief
+//! Copies the input into the read ahead buffer.
+//!
+//! DESCRIPTION:\n
+//! Only ever waits for one read from the underlying file or pipe at a
+//! time, and publishes what it has to the ring buffer before it waits,
+//! so input doesn't sit in the buffer whilst the source is quiet.
+class CIoManager::CReadAheadThread : public core::CThread {
+public:
+    CReadAheadThread(std::istream& source, core::CRingBufferStreamBuf& buf)
+        : m_Source(source), m_Buf(buf), m_Shutdown(false) {}
+
+protected:
+    virtual void run() {
+        std::streambuf* source(m_Source.rdbuf());
+        std::vector<char> chunk(core::CRingBufferStreamBuf::DEFAULT_BLOCK_CAPACITY);
+
+        while (m_Shutdown.load() == false) {
+            // This waits for at most one read from the file or pipe
+            if (source->sgetc() == std::char_traits<char>::eof()) {
+                break;
+            }
+            std::streamsize available(std::min(
+                source->in_avail(), static_cast<std::streamsize>(chunk.size())));
+            std::streamsize read(source->sgetn(chunk.data(), available));
+            if (m_Buf.sputn(chunk.data(), read) < read) {
+                // The reader has gone away
+                break;
+            }
+            if (source->in_avail() <= 0) {
+                m_Buf.pubsync();
+            }
+        }
+
+        m_Buf.signalEndOfFile();
+    }
+
+    virtual void shutdown() {
+        m_Shutdown.store(true);
+
+        // Wake up the run() method if it's waiting for space in the ring
+        // buffer or for the file or pipe
+        m_Buf.signalFatalError();
+        if (this->cancelBlockedIo() == false) {
+            LOG_WARN(<< "Failed to cancel blocked IO in input read ahead thread");
+        }
+    }
+
+private:
+    std::istream& m_Source;
+    core::CRingBufferStreamBuf& m_Buf;
+    std::atomic_bool m_Shutdown;
+};
+
 CIoManager::CIoManager(const std::string& inputFileName,
                        bool isInputFileNamedPipe,
                        const std::string& outputFileName,
@@ -59,6 +118,7 @@ CIoManager::CIoManager(const std::string& inputFileName,
                        bool isPersistFileNamedPipe)
     : m_IoInitialised(false), m_InputFileName(inputFileName),
       m_IsInputFileNamedPipe(isInputFileNamedPipe && !inputFileName.empty()),
+      m_ReadAheadDepth(0),
       m_OutputFileName(outputFileName),
       m_IsOutputFileNamedPipe(isOutputFileNamedPipe && !outputFileName.empty()),
       m_RestoreFileName(restoreFileName),
@@ -80,6 +140,15 @@ CIoManager::CIoManager(const std::string& inputFileName,
 }
 
 CIoManager::~CIoManager() {
+    this->stopReadAhead();
+}
+
+void CIoManager::readInputAhead(std::size_t depth) {
+    if (m_IoInitialised) {
+        LOG_ERROR(<< "Input read ahead must be configured before IO is initialised");
+        return;
+    }
+    m_ReadAheadDepth = depth;
 }
 
 bool CIoManager::initIo() {
@@ -87,11 +156,16 @@ bool CIoManager::initIo() {
         setUpIStream(m_InputFileName, m_IsInputFileNamedPipe, m_InputStream) &&
         setUpOStream(m_OutputFileName, m_IsOutputFileNamedPipe, m_OutputStream) &&
         setUpIStream(m_RestoreFileName, m_IsRestoreFileNamedPipe, m_RestoreStream) &&
-        setUpOStream(m_PersistFileName, m_IsPersistFileNamedPipe, m_PersistStream);
+        setUpOStream(m_PersistFileName, m_IsPersistFileNamedPipe, m_PersistStream) &&
+        (m_ReadAheadDepth == 0 || this->startReadAhead());
     return m_IoInitialised;
 }
 
 std::istream& CIoManager::inputStream() {
+    if (m_ReadAheadStream != nullptr) {
+        return *m_ReadAheadStream;
+    }
+
     if (m_InputStream != nullptr) {
         return *m_InputStream;
     }
@@ -130,5 +204,30 @@ core::CNamedPipeFactory::TOStreamP CIoManager::persistStream() {
 
     return m_PersistStream;
 }
+
+bool CIoManager::startReadAhead() {
+    std::istream& source(m_InputStream != nullptr ? *m_InputStream : std::cin);
+
+    m_ReadAheadBuf = std::make_unique<core::CRingBufferStreamBuf>(
+        core::CRingBufferStreamBuf::DEFAULT_BLOCK_CAPACITY, m_ReadAheadDepth);
+    m_ReadAheadStream = std::make_unique<std::istream>(m_ReadAheadBuf.get());
+    m_ReadAheadThread = std::make_unique<CReadAheadThread>(source, *m_ReadAheadBuf);
+
+    if (m_ReadAheadThread->start() == false) {
+        LOG_ERROR(<< "Failed to start thread to read input ahead");
+        m_ReadAheadThread.reset();
+        m_ReadAheadStream.reset();
+        m_ReadAheadBuf.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void CIoManager::stopReadAhead() {
+    if (m_ReadAheadThread != nullptr && m_ReadAheadThread->isStarted()) {
+        m_ReadAheadThread->stop();
+    }
+}
 }
 }
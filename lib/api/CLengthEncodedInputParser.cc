@@ -27,10 +27,12 @@ namespace api {
 
 // Initialise statics
 const size_t CLengthEncodedInputParser::WORK_BUFFER_SIZE(8192); // 8kB
+const uint32_t CLengthEncodedInputParser::TYPED_HEADER_FLAG(0x80000000);
 
 CLengthEncodedInputParser::CLengthEncodedInputParser(std::istream& strmIn)
     : CInputParser(), m_StrmIn(strmIn), m_WorkBuffer(nullptr),
-      m_WorkBufferPtr(nullptr), m_WorkBufferEnd(nullptr), m_NoMoreRecords(false) {
+      m_WorkBufferPtr(nullptr), m_WorkBufferEnd(nullptr),
+      m_NoMoreRecords(false), m_Typed(false) {
     // This test is not ideal because std::cin's stream buffer could have been
     // changed
     if (strmIn.rdbuf() == std::cin.rdbuf()) {
@@ -46,26 +48,15 @@ CLengthEncodedInputParser::CLengthEncodedInputParser(std::istream& strmIn)
 }
 
 bool CLengthEncodedInputParser::readStream(const TReaderFunc& readerFunc) {
-    // Reset the record buffer pointers in case we're reading a new stream
-    m_WorkBufferEnd = m_WorkBufferPtr;
-    m_NoMoreRecords = false;
-    TStrVec& fieldNames = this->fieldNames();
-
+    if (this->startStream() == false) {
+        return false;
+    }
     if (!this->gotFieldNames()) {
-        if (this->parseRecordFromStream<true>(fieldNames) == false) {
-            LOG_ERROR(<< "Failed to parse length encoded header from stream");
-            return false;
-        }
+        return true;
+    }
 
-        if (fieldNames.empty()) {
-            // If we parsed no field names at all, return true, as
-            // completely empty input is technically valid
-            LOG_INFO(<< "Field names are empty")
-            return true;
-        }
+    const TStrVec& fieldNames = this->fieldNames();
 
-        this->gotFieldNames(true);
-    }
     // We reuse the same field map for every record
     TStrStrUMap recordFields;
 
@@ -98,8 +89,122 @@ bool CLengthEncodedInputParser::readStream(const TReaderFunc& readerFunc) {
     return true;
 }
 
+bool CLengthEncodedInputParser::readStreamIntoVecs(const TFieldNamesFunc& fieldNamesFunc,
+                                                   const TVecReaderFunc& readerFunc) {
+    if (this->startStream() == false) {
+        return false;
+    }
+    if (!this->gotFieldNames()) {
+        return true;
+    }
+
+    const TStrVec& fieldNames = this->fieldNames();
+    if (fieldNamesFunc(fieldNames) == false) {
+        LOG_ERROR(<< "Field names handler function forced exit");
+        return false;
+    }
+
+    // We reuse the same field values for every record, so the strings only
+    // need to grow when a value is longer than any seen before in its field
+    TStrVec fieldValues(fieldNames.size());
+
+    while (!m_NoMoreRecords) {
+        if (this->parseRecordFromStream<false>(fieldValues) == false) {
+            LOG_ERROR(<< "Failed to parse length encoded data record from stream");
+            return false;
+        }
+
+        if (m_NoMoreRecords) {
+            break;
+        }
+
+        this->gotData(true);
+
+        if (readerFunc(fieldValues) == false) {
+            LOG_ERROR(<< "Record handler function forced exit");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CLengthEncodedInputParser::readStreamIntoTypedVecs(const TTypedFieldNamesFunc& fieldNamesFunc,
+                                                        const TTypedVecReaderFunc& readerFunc) {
+    if (this->startStream() == false) {
+        return false;
+    }
+    if (!this->gotFieldNames()) {
+        return true;
+    }
+
+    const TStrVec& fieldNames = this->fieldNames();
+    if (fieldNamesFunc(fieldNames, m_FieldTypes) == false) {
+        LOG_ERROR(<< "Field names handler function forced exit");
+        return false;
+    }
+
+    TStrVec fieldValues(fieldNames.size());
+    TDoubleVec numericValues(fieldNames.size(), 0.0);
+
+    while (!m_NoMoreRecords) {
+        if (this->parseRecordFromStream<false>(fieldValues, &numericValues) == false) {
+            LOG_ERROR(<< "Failed to parse length encoded data record from stream");
+            return false;
+        }
+
+        if (m_NoMoreRecords) {
+            break;
+        }
+
+        this->gotData(true);
+
+        if (readerFunc(fieldValues, numericValues) == false) {
+            LOG_ERROR(<< "Record handler function forced exit");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CLengthEncodedInputParser::startStream() {
+    // Reset the record buffer pointers in case we're reading a new stream
+    m_WorkBufferEnd = m_WorkBufferPtr;
+    m_NoMoreRecords = false;
+
+    if (!this->gotFieldNames()) {
+        TStrVec& fieldNames = this->fieldNames();
+        if (this->parseRecordFromStream<true>(fieldNames) == false) {
+            LOG_ERROR(<< "Failed to parse length encoded header from stream");
+            return false;
+        }
+
+        if (fieldNames.empty()) {
+            // If we parsed no field names at all, return true, as
+            // completely empty input is technically valid
+            LOG_INFO(<< "Field names are empty")
+            return true;
+        }
+
+        if (m_Typed) {
+            if (this->parseFieldTypesFromStream() == false) {
+                LOG_ERROR(<< "Failed to parse length encoded field types from stream");
+                return false;
+            }
+        } else {
+            m_FieldTypes.assign(fieldNames.size(), E_String);
+        }
+
+        this->gotFieldNames(true);
+    }
+
+    return true;
+}
+
 template<bool RESIZE_ALLOWED, typename STR_VEC>
-bool CLengthEncodedInputParser::parseRecordFromStream(STR_VEC& results) {
+bool CLengthEncodedInputParser::parseRecordFromStream(STR_VEC& results,
+                                                      TDoubleVec* numericValues) {
     // For maximum performance, read the stream in large chunks that can be
     // moved around by memcpy().  Using memcpy() is an order of magnitude faster
     // than the naive approach of checking and copying one character at a time.
@@ -125,6 +230,12 @@ bool CLengthEncodedInputParser::parseRecordFromStream(STR_VEC& results) {
         return false;
     }
 
+    // Only the header can declare that the stream is typed
+    if (RESIZE_ALLOWED) {
+        m_Typed = (numFields & TYPED_HEADER_FLAG) != 0;
+        numFields &= ~TYPED_HEADER_FLAG;
+    }
+
     if (results.size() != numFields) {
         if (RESIZE_ALLOWED) {
             if (numFields == 0) {
@@ -150,6 +261,20 @@ bool CLengthEncodedInputParser::parseRecordFromStream(STR_VEC& results) {
     }
 
     for (size_t index = 0; index < numFields; ++index) {
+        if (m_Typed && !RESIZE_ALLOWED && m_FieldTypes[index] != E_String) {
+            double num(0.0);
+            if (this->parseNumberFromStream(m_FieldTypes[index], num) == false) {
+                LOG_ERROR(<< "Unable to read numeric field from input stream");
+                return false;
+            }
+            if (numericValues != nullptr) {
+                (*numericValues)[index] = num;
+            } else {
+                formatNumericValue(m_FieldTypes[index], num, results[index]);
+            }
+            continue;
+        }
+
         uint32_t length(0);
         if (this->parseUInt32FromStream(length) == false) {
             LOG_ERROR(<< "Unable to read field length from input stream");
@@ -179,6 +304,48 @@ bool CLengthEncodedInputParser::parseRecordFromStream(STR_VEC& results) {
     return true;
 }
 
+bool CLengthEncodedInputParser::parseFieldTypesFromStream() {
+    std::size_t numFields(this->fieldNames().size());
+
+    uint32_t length(0);
+    if (this->parseUInt32FromStream(length) == false) {
+        LOG_ERROR(<< "Unable to read field types length from input stream");
+        return false;
+    }
+    if (length != numFields) {
+        LOG_ERROR(<< "Got " << length << " field types for " << numFields << " fields");
+        return false;
+    }
+
+    std::string types;
+    if (this->parseStringFromStream(length, types) == false) {
+        LOG_ERROR(<< "Unable to read field types from input stream");
+        return false;
+    }
+
+    m_FieldTypes.clear();
+    m_FieldTypes.reserve(numFields);
+    for (char type : types) {
+        switch (type) {
+        case 's':
+            m_FieldTypes.push_back(E_String);
+            break;
+        case 'd':
+            m_FieldTypes.push_back(E_Double);
+            break;
+        case 't':
+            m_FieldTypes.push_back(E_Time);
+            break;
+        default:
+            LOG_ERROR(<< "Unknown field type '" << type << "' in input stream");
+            return false;
+        }
+    }
+    LOG_DEBUG(<< "Field types are " << types);
+
+    return true;
+}
+
 bool CLengthEncodedInputParser::parseUInt32FromStream(uint32_t& num) {
     size_t avail(m_WorkBufferEnd - m_WorkBufferPtr);
     if (avail < sizeof(uint32_t)) {
@@ -199,6 +366,36 @@ bool CLengthEncodedInputParser::parseUInt32FromStream(uint32_t& num) {
     return true;
 }
 
+bool CLengthEncodedInputParser::parseNumberFromStream(EFieldType type, double& num) {
+    size_t avail(m_WorkBufferEnd - m_WorkBufferPtr);
+    if (avail < sizeof(uint64_t)) {
+        avail = this->refillBuffer();
+        if (avail < sizeof(uint64_t)) {
+            return false;
+        }
+    }
+
+    // Assembling the value byte by byte makes this independent of the host
+    // byte order, and compilers reduce it to a single load on little-endian
+    // platforms
+    const unsigned char* bytes(reinterpret_cast<const unsigned char*>(m_WorkBufferPtr));
+    uint64_t bits(0);
+    for (size_t i = sizeof(uint64_t); i > 0; --i) {
+        bits = (bits << 8) | bytes[i - 1];
+    }
+    m_WorkBufferPtr += sizeof(uint64_t);
+
+    if (type == E_Time) {
+        int64_t time(0);
+        ::memcpy(&time, &bits, sizeof(int64_t));
+        num = static_cast<double>(time);
+    } else {
+        ::memcpy(&num, &bits, sizeof(double));
+    }
+
+    return true;
+}
+
 bool CLengthEncodedInputParser::parseStringFromStream(size_t length, std::string& str) {
     if (length == 0) {
         str.clear();
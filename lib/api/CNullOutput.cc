@@ -20,5 +20,11 @@ bool CNullOutput::writeRow(const TStrStrUMap& /*dataRowFields*/,
                            const TStrStrUMap& /*overrideDataRowFields*/) {
     return true;
 }
+
+bool CNullOutput::writeRow(const TStrVec& /*fieldNames*/,
+                           const TStrVec& /*fieldValues*/,
+                           const TStrStrUMap& /*overrideDataRowFields*/) {
+    return true;
+}
 }
 }
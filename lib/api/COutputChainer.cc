@@ -13,7 +13,7 @@ namespace ml {
 namespace api {
 
 COutputChainer::COutputChainer(CDataProcessor& dataProcessor)
-    : m_DataProcessor(dataProcessor) {
+    : m_DataProcessor(dataProcessor), m_NumInputFields(0), m_FieldNamesPassedOn(false) {
 }
 
 void COutputChainer::newOutputStream() {
@@ -22,6 +22,8 @@ void COutputChainer::newOutputStream() {
 
 bool COutputChainer::fieldNames(const TStrVec& fieldNames, const TStrVec& extraFieldNames) {
     m_FieldNames = fieldNames;
+    m_NumInputFields = fieldNames.size();
+    m_FieldNamesPassedOn = false;
 
     // Only add extra field names if they're not already present
     for (TStrVecCItr iter = extraFieldNames.begin(); iter != extraFieldNames.end(); ++iter) {
@@ -34,6 +36,7 @@ bool COutputChainer::fieldNames(const TStrVec& fieldNames, const TStrVec& extraF
     m_Hashes.clear();
     m_WorkRecordFieldRefs.clear();
     m_WorkRecordFields.clear();
+    m_WorkRecordValues.clear();
 
     if (m_FieldNames.empty()) {
         LOG_ERROR(<< "Attempt to set empty field names");
@@ -50,6 +53,7 @@ bool COutputChainer::fieldNames(const TStrVec& fieldNames, const TStrVec& extraF
         m_Hashes.push_back(EMPTY_FIELD_OVERRIDES.hash_function()(*iter));
         m_WorkRecordFieldRefs.push_back(boost::ref(m_WorkRecordFields[*iter]));
     }
+    m_WorkRecordValues.resize(m_FieldNames.size());
 
     return true;
 }
@@ -100,6 +104,61 @@ bool COutputChainer::writeRow(const TStrStrUMap& dataRowFields,
     return true;
 }
 
+bool COutputChainer::writeRow(const TStrVec& fieldNames,
+                              const TStrVec& fieldValues,
+                              const TStrStrUMap& overrideDataRowFields) {
+    if (m_FieldNames.empty()) {
+        LOG_ERROR(<< "Attempt to output data before field names");
+        return false;
+    }
+
+    if (fieldNames.size() != m_NumInputFields || fieldValues.size() != m_NumInputFields) {
+        LOG_ERROR(<< "Row has " << fieldValues.size() << " values for "
+                  << fieldNames.size() << " field names but output was set up for "
+                  << m_NumInputFields << " input fields");
+        return false;
+    }
+
+    if (m_FieldNamesPassedOn == false) {
+        if (m_DataProcessor.handleFieldNames(m_FieldNames) == false) {
+            LOG_ERROR(<< "Chained data processor function returned false for field names");
+            return false;
+        }
+        m_FieldNamesPassedOn = true;
+    }
+
+    using TStrEqualTo = std::equal_to<std::string>;
+    TStrEqualTo pred;
+
+    for (std::size_t i = 0; i < m_FieldNames.size(); ++i) {
+        TStrStrUMapCItr overrideIter =
+            overrideDataRowFields.empty()
+                ? overrideDataRowFields.end()
+                : overrideDataRowFields.find(m_FieldNames[i], m_Hashes[i], pred);
+
+        // As for the map version, use the start/length version of assign to
+        // bypass GNU copy-on-write
+        if (overrideIter != overrideDataRowFields.end()) {
+            m_WorkRecordValues[i].assign(overrideIter->second, 0,
+                                         overrideIter->second.length());
+        } else if (i < m_NumInputFields) {
+            m_WorkRecordValues[i].assign(fieldValues[i], 0, fieldValues[i].length());
+        } else {
+            LOG_ERROR(<< "Output fields do not include a value for field "
+                      << m_FieldNames[i]);
+            return false;
+        }
+    }
+
+    if (m_DataProcessor.handleFieldValues(m_WorkRecordValues) == false) {
+        LOG_ERROR(<< "Chained data processor function returned false for record:" << core_t::LINE_ENDING
+                  << CDataProcessor::debugPrintRecord(m_FieldNames, m_WorkRecordValues));
+        return false;
+    }
+
+    return true;
+}
+
 void COutputChainer::finalise() {
     m_DataProcessor.finalise();
 }
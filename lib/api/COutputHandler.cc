@@ -5,6 +5,8 @@
  */
 #include <api/COutputHandler.h>
 
+#include <core/CLogger.h>
+
 namespace ml {
 namespace api {
 
@@ -32,6 +34,23 @@ bool COutputHandler::writeRow(const TStrStrUMap& dataRowFields) {
     return this->writeRow(EMPTY_FIELD_OVERRIDES, dataRowFields);
 }
 
+bool COutputHandler::writeRow(const TStrVec& fieldNames,
+                              const TStrVec& fieldValues,
+                              const TStrStrUMap& overrideDataRowFields) {
+    if (fieldNames.size() != fieldValues.size()) {
+        LOG_ERROR(<< "Row has " << fieldValues.size() << " values but "
+                  << fieldNames.size() << " field names");
+        return false;
+    }
+
+    TStrStrUMap dataRowFields;
+    for (std::size_t i = 0; i < fieldNames.size(); ++i) {
+        dataRowFields[fieldNames[i]] = fieldValues[i];
+    }
+
+    return this->writeRow(dataRowFields, overrideDataRowFields);
+}
+
 void COutputHandler::finalise() {
     // NOOP unless overridden
 }
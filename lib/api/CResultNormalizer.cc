@@ -29,13 +29,20 @@ const std::string CResultNormalizer::PARTITION_LEVEL("part");
 const std::string CResultNormalizer::BUCKET_INFLUENCER_LEVEL("inflb");
 const std::string CResultNormalizer::INFLUENCER_LEVEL("infl");
 const std::string CResultNormalizer::ZERO("0");
+const std::size_t CResultNormalizer::BATCH_SIZE(1000);
 
 CResultNormalizer::CResultNormalizer(const model::CAnomalyDetectorModelConfig& modelConfig,
-                                     COutputHandler& outputHandler)
+                                     COutputHandler& outputHandler,
+                                     std::size_t numberThreads)
     : m_ModelConfig(modelConfig), m_OutputHandler(outputHandler),
       m_WriteFieldNames(true),
       m_OutputFieldNormalizedScore(m_OutputFields[NORMALIZED_SCORE_NAME]),
-      m_Normalizer(m_ModelConfig) {
+      m_Normalizer(m_ModelConfig), m_NumberQueuedRecords(0), m_NumberRecords(0) {
+    if (numberThreads > 1) {
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+        m_QueuedRecords.resize(BATCH_SIZE);
+        LOG_DEBUG(<< "Using " << numberThreads << " threads to normalize records");
+    }
 }
 
 bool CResultNormalizer::initNormalizer(const std::string& stateFileName) {
@@ -51,22 +58,70 @@ bool CResultNormalizer::initNormalizer(const std::string& stateFileName) {
 
 bool CResultNormalizer::handleRecord(const TStrStrUMap& dataRowFields) {
     if (m_WriteFieldNames) {
-        TStrVec fieldNames;
-        fieldNames.reserve(dataRowFields.size());
-        for (const auto& entry : dataRowFields) {
-            fieldNames.push_back(entry.first);
+        if (this->writeFieldNames(dataRowFields) == false) {
+            return false;
         }
+        m_WriteFieldNames = false;
+    }
 
-        TStrVec extraFieldNames;
-        extraFieldNames.push_back(NORMALIZED_SCORE_NAME);
+    if (m_NumberRecords++ == 0) {
+        m_Timer.start();
+    }
 
-        if (m_OutputHandler.fieldNames(fieldNames, extraFieldNames) == false) {
-            LOG_ERROR(<< "Unable to set field names for output");
+    if (m_ThreadPool == nullptr) {
+        this->normalizedScore(dataRowFields, m_OutputFieldNormalizedScore);
+        if (m_OutputHandler.writeRow(dataRowFields, m_OutputFields) == false) {
+            LOG_ERROR(<< "Unable to write normalized output");
             return false;
         }
-        m_WriteFieldNames = false;
+        return true;
+    }
+
+    m_QueuedRecords[m_NumberQueuedRecords++].s_Fields = dataRowFields;
+    if (m_NumberQueuedRecords == m_QueuedRecords.size()) {
+        return this->normalizeQueuedRecords();
+    }
+
+    return true;
+}
+
+bool CResultNormalizer::finalise() {
+    bool result(this->normalizeQueuedRecords());
+
+    // Report the throughput, which includes the time to read the input
+    std::uint64_t elapsed(m_Timer.isRunning() ? m_Timer.stop() : 0);
+    std::uint64_t recordsPerSecond(elapsed > 0 ? (1000 * m_NumberRecords) / elapsed
+                                               : m_NumberRecords);
+    LOG_INFO(<< "Normalized " << m_NumberRecords << " records in " << elapsed
+             << "ms at " << recordsPerSecond << " records/second");
+
+    return result;
+}
+
+std::uint64_t CResultNormalizer::numberRecords() const {
+    return m_NumberRecords;
+}
+
+bool CResultNormalizer::writeFieldNames(const TStrStrUMap& dataRowFields) {
+    TStrVec fieldNames;
+    fieldNames.reserve(dataRowFields.size());
+    for (const auto& entry : dataRowFields) {
+        fieldNames.push_back(entry.first);
+    }
+
+    TStrVec extraFieldNames;
+    extraFieldNames.push_back(NORMALIZED_SCORE_NAME);
+
+    if (m_OutputHandler.fieldNames(fieldNames, extraFieldNames) == false) {
+        LOG_ERROR(<< "Unable to set field names for output");
+        return false;
     }
 
+    return true;
+}
+
+void CResultNormalizer::normalizedScore(const TStrStrUMap& dataRowFields,
+                                        std::string& result) const {
     std::string level;
     std::string partition;
     std::string partitionValue;
@@ -120,18 +175,36 @@ bool CResultNormalizer::handleRecord(const TStrStrUMap& dataRowFields) {
                       << "' and person field name '" << person << "'");
         }
 
-        m_OutputFieldNormalizedScore =
-            (score > 0.0) ? core::CStringUtils::typeToStringPretty(score) : ZERO;
+        result = (score > 0.0) ? core::CStringUtils::typeToStringPretty(score) : ZERO;
     } else {
-        m_OutputFieldNormalizedScore.clear();
+        result.clear();
     }
+}
 
-    if (m_OutputHandler.writeRow(dataRowFields, m_OutputFields) == false) {
-        LOG_ERROR(<< "Unable to write normalized output");
-        return false;
+bool CResultNormalizer::normalizeQueuedRecords() {
+    if (m_NumberQueuedRecords == 0) {
+        return true;
     }
 
-    return true;
+    m_ThreadPool->parallelForEach(m_NumberQueuedRecords, [this](std::size_t i) {
+        SQueuedRecord& record = m_QueuedRecords[i];
+        this->normalizedScore(record.s_Fields, record.s_NormalizedScore);
+    });
+
+    // Write the records in the order they were received
+    bool result(true);
+    for (std::size_t i = 0; i < m_NumberQueuedRecords; ++i) {
+        SQueuedRecord& record = m_QueuedRecords[i];
+        m_OutputFieldNormalizedScore.swap(record.s_NormalizedScore);
+        if (m_OutputHandler.writeRow(record.s_Fields, m_OutputFields) == false) {
+            LOG_ERROR(<< "Unable to write normalized output");
+            result = false;
+            break;
+        }
+    }
+    m_NumberQueuedRecords = 0;
+
+    return result;
 }
 
 bool CResultNormalizer::parseDataFields(const TStrStrUMap& dataRowFields,
@@ -140,7 +213,7 @@ bool CResultNormalizer::parseDataFields(const TStrStrUMap& dataRowFields,
                                         std::string& person,
                                         std::string& function,
                                         std::string& valueFieldName,
-                                        double& probability) {
+                                        double& probability) const {
     return this->parseDataField(dataRowFields, LEVEL, level) &&
            this->parseDataField(dataRowFields, PARTITION_FIELD_NAME, partition) &&
            this->parseDataField(dataRowFields, PERSON_FIELD_NAME, person) &&
@@ -156,7 +229,7 @@ bool CResultNormalizer::parseDataFields(const TStrStrUMap& dataRowFields,
                                         std::string& person,
                                         std::string& function,
                                         std::string& valueFieldName,
-                                        double& probability) {
+                                        double& probability) const {
     return this->parseDataField(dataRowFields, LEVEL, level) &&
            this->parseDataField(dataRowFields, PARTITION_FIELD_NAME, partition) &&
            this->parseDataField(dataRowFields, PARTITION_FIELD_VALUE, partitionValue) &&
@@ -49,7 +49,9 @@ CTokenListType::CTokenListType(bool isDryRun,
                                size_t baseWeight,
                                const TSizeSizeMap& uniqueTokenIds)
     : m_BaseString(baseString), m_BaseTokenIds(baseTokenIds),
-      m_BaseWeight(baseWeight), m_MaxStringLen(rawStringLen),
+      m_BaseWeight(baseWeight),
+      m_BaseUniqueTokenIds(uniqueTokenIds.begin(), uniqueTokenIds.end()),
+      m_MaxStringLen(rawStringLen),
       m_OutOfOrderCommonTokenIndex(baseTokenIds.size()),
       // Note: m_CommonUniqueTokenIds is required to be in sorted order, and
       // this relies on uniqueTokenIds being in sorted order
@@ -153,6 +155,12 @@ bool CTokenListType::acceptRestoreTraverser(core::CStateRestoreTraverser& traver
         }
     } while (traverser.next());
 
+    TSizeSizeMap uniqueTokenIds;
+    for (const auto& baseTokenId : m_BaseTokenIds) {
+        uniqueTokenIds[baseTokenId.first] += baseTokenId.second;
+    }
+    m_BaseUniqueTokenIds.assign(uniqueTokenIds.begin(), uniqueTokenIds.end());
+
     return true;
 }
 
@@ -246,6 +254,10 @@ size_t CTokenListType::baseWeight() const {
     return m_BaseWeight;
 }
 
+const CTokenListType::TSizeSizePrVec& CTokenListType::baseUniqueTokenIds() const {
+    return m_BaseUniqueTokenIds;
+}
+
 const CTokenListType::TSizeSizePrVec& CTokenListType::commonUniqueTokenIds() const {
     return m_CommonUniqueTokenIds;
 }
@@ -300,6 +312,27 @@ size_t CTokenListType::missingCommonTokenWeight(const TSizeSizeMap& uniqueTokenI
     return m_CommonUniqueTokenWeight - presentWeight;
 }
 
+size_t CTokenListType::commonTokenWeight(const TSizeSizeMap& uniqueTokenIds) const {
+    size_t commonWeight(0);
+
+    TSizeSizePrVecCItr baseIter = m_BaseUniqueTokenIds.begin();
+    TSizeSizeMapCItr testIter = uniqueTokenIds.begin();
+    while (baseIter != m_BaseUniqueTokenIds.end() && testIter != uniqueTokenIds.end()) {
+        if (baseIter->first == testIter->first) {
+            commonWeight += std::min(baseIter->second, testIter->second);
+            ++baseIter;
+            ++testIter;
+        } else if (baseIter->first < testIter->first) {
+            ++baseIter;
+        } else // if (baseIter->first > testIter->first)
+        {
+            ++testIter;
+        }
+    }
+
+    return commonWeight;
+}
+
 bool CTokenListType::isMissingCommonTokenWeightZero(const TSizeSizeMap& uniqueTokenIds) const {
     // This method could be implemented as:
     // return this->missingCommonTokenWeight(uniqueTokenIds) == 0;
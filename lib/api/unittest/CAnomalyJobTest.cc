@@ -5,27 +5,45 @@
  */
 #include "CAnomalyJobTest.h"
 
+#include <core/CDataAdder.h>
+#include <core/CIEEE754.h>
 #include <core/CJsonOutputStreamWrapper.h>
+#include <core/CJsonStatePersistInserter.h>
 #include <core/CLogger.h>
 #include <core/CRegex.h>
+#include <core/CStatistics.h>
+#include <core/CStringUtils.h>
 
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CDataGatherer.h>
 #include <model/CLimits.h>
+#include <model/CStringStore.h>
 
 #include <api/CAnomalyJob.h>
+#include <api/CBackgroundPersister.h>
 #include <api/CCsvInputParser.h>
 #include <api/CFieldConfig.h>
 #include <api/CHierarchicalResultsWriter.h>
 #include <api/CJsonOutputWriter.h>
+#include <api/CSingleStreamDataAdder.h>
+#include <api/CSingleStreamSearcher.h>
+#include <api/CStateRestoreStreamFilter.h>
 
 #include <rapidjson/document.h>
 
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/math/constants/constants.hpp>
 #include <boost/tuple/tuple.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <fstream>
+#include <map>
 #include <sstream>
+#include <thread>
 
 namespace {
 
@@ -43,6 +61,25 @@ public:
     }
 };
 
+//! \brief
+//! Mock object for state persist unit tests.
+//!
+//! DESCRIPTION:\n
+//! CDataAdder that accepts the state but fails to complete it.
+//!
+class CFailingDataAdder : public ml::core::CDataAdder {
+public:
+    //! Get a stream which discards the state.
+    virtual TOStreamP addStreamed(const std::string& /*index*/, const std::string& /*id*/) {
+        return TOStreamP(new std::ostringstream());
+    }
+
+    //! Fail to complete the stream.
+    virtual bool streamComplete(TOStreamP& /*strm*/, bool /*force*/) {
+        return false;
+    }
+};
+
 //! \brief
 //! Mock object for unit tests
 //!
@@ -142,7 +179,8 @@ private:
 size_t countBuckets(const std::string& key, const std::string& output) {
     size_t count = 0;
     rapidjson::Document doc;
-    doc.Parse<rapidjson::kParseDefaultFlags>(output);
+    // Stop at the end of the results so any state appended to them is ignored
+    doc.Parse<rapidjson::kParseStopWhenDoneFlag>(output);
     CPPUNIT_ASSERT(!doc.HasParseError());
     CPPUNIT_ASSERT(doc.IsArray());
 
@@ -170,6 +208,315 @@ bool findLine(const std::string& regex, const ml::core::CRegex::TStrVec& lines)
 }
 
 const ml::core_t::TTime BUCKET_SIZE(3600);
+
+//! Reset the state shared by all the jobs in the process so that each run
+//! starts from the same point.
+void resetGlobalState() {
+    // The string stores are shared by all jobs in the process and their
+    // memory is included in the model size stats, so start each run with
+    // only the strings which are still in use
+    ml::model::CStringStore::names().prune();
+    ml::model::CStringStore::influencers().prune();
+
+    // The global statistics are persisted with the job state, so each run
+    // must start from the same counts
+    for (int i = 0; i < ml::stat_t::E_LastEnumStat; ++i) {
+        ml::core::CStatistics::stat(i).set(0);
+    }
+}
+
+//! Zero the processing and log times in \p output.
+void zeroTimes(std::string& output) {
+    for (const auto& time : {"\"processing_time_ms\":", "\"log_time\":"}) {
+        const std::string timeKey(time);
+        for (std::size_t pos = output.find(timeKey); pos != std::string::npos;
+             pos = output.find(timeKey, pos)) {
+            pos += timeKey.length();
+            std::size_t end = output.find_first_not_of("0123456789", pos);
+            output.replace(pos, end - pos, "0");
+        }
+    }
+}
+
+//! Check if the persisted states \p lhs and \p rhs are the same, except for
+//! numbers which differ by no more than the rounding of persisting them.
+//! A model restored from a snapshot has the persisted precision, so it
+//! diverges slightly from a model which wasn't persisted as it's updated.
+bool isSameToPersistedPrecision(const std::string& lhs, const std::string& rhs) {
+    const std::string delimiters{"\":;,{}"};
+    std::size_t i{0};
+    std::size_t j{0};
+    while (i < lhs.size() && j < rhs.size()) {
+        std::size_t iEnd{std::min(lhs.find_first_of(delimiters, i), lhs.size())};
+        std::size_t jEnd{std::min(rhs.find_first_of(delimiters, j), rhs.size())};
+        std::string lhsToken{lhs, i, iEnd - i};
+        std::string rhsToken{rhs, j, jEnd - j};
+        double x;
+        double y;
+        if (lhsToken != rhsToken &&
+            (ml::core::CStringUtils::stringToTypeSilent(lhsToken, x) == false ||
+             ml::core::CStringUtils::stringToTypeSilent(rhsToken, y) == false ||
+             std::fabs(x - y) > 1e-3 * std::max(std::fabs(x), std::fabs(y)) + 1e-5)) {
+            return false;
+        }
+        if (iEnd < lhs.size() && jEnd < rhs.size() && lhs[iEnd] != rhs[jEnd]) {
+            return false;
+        }
+        i = iEnd + 1;
+        j = jEnd + 1;
+    }
+    return i >= lhs.size() && j >= rhs.size();
+}
+
+//! Get the earliest time, in ms, of the model size stats in \p output which
+//! report the memory limit has come into play or -1 if there are none.
+std::int64_t firstMemoryLimitedTime(const std::string& output) {
+    std::int64_t result{-1};
+    rapidjson::Document doc;
+    doc.Parse<rapidjson::kParseStopWhenDoneFlag>(output);
+    CPPUNIT_ASSERT(!doc.HasParseError());
+    CPPUNIT_ASSERT(doc.IsArray());
+    for (const auto& r : doc.GetArray()) {
+        auto stats = r.GetObject().FindMember("model_size_stats");
+        if (stats != r.GetObject().MemberEnd() &&
+            std::string(stats->value["memory_status"].GetString()) != "ok") {
+            std::int64_t time{stats->value["timestamp"].GetInt64()};
+            result = result == -1 ? time : std::min(result, time);
+        }
+    }
+    return result;
+}
+
+//! Run a job with several partitions, and so many detectors, using
+//! \p numberThreads threads and return its output.  If \p positional
+//! is true the records are passed by position and interleaved with flush
+//! control messages, and the job's state, persisted just before it's
+//! finalised, is appended to the output.  If \p typed is true as well
+//! the time and value are passed as numbers.
+std::string runPartitionedJob(std::size_t numberThreads,
+                              bool positional = false,
+                              bool typed = false) {
+    resetGlobalState();
+
+    ml::model::CLimits limits;
+    ml::api::CFieldConfig fieldConfig;
+    ml::api::CFieldConfig::TStrVec clauses;
+    clauses.push_back("mean(value)");
+    clauses.push_back("by");
+    clauses.push_back("animal");
+    clauses.push_back("partitionfield=zoo");
+    fieldConfig.initFromClause(clauses);
+
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    modelConfig.modelPlotBoundsPercentile(95.0);
+
+    std::string snapshotId;
+    ml::api::CAnomalyJob::TPersistCompleteFunc reportPersistComplete =
+        [&snapshotId](const ml::api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+            snapshotId = report.s_SnapshotId;
+        };
+
+    std::stringstream outputStrm;
+    std::string persistedState;
+    {
+        ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+        ml::api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete,
+                                 nullptr, -1, "time", "", 0, numberThreads);
+
+        ml::api::CAnomalyJob::TStrVec fieldNames{"time", "zoo", "animal", "value", "."};
+        ml::api::CInputParser::TFieldTypeVec fieldTypes{
+            ml::api::CInputParser::E_Time, ml::api::CInputParser::E_String,
+            ml::api::CInputParser::E_String, ml::api::CInputParser::E_Double,
+            ml::api::CInputParser::E_String};
+        if (typed) {
+            CPPUNIT_ASSERT(job.handleTypedFieldNames(fieldNames, fieldTypes));
+        } else if (positional) {
+            CPPUNIT_ASSERT(job.handleFieldNames(fieldNames));
+        }
+
+        ml::api::CAnomalyJob::TStrStrUMap dataRows;
+        ml::api::CAnomalyJob::TStrVec fieldValues(fieldNames.size());
+        ml::api::CInputParser::TDoubleVec numericValues(fieldNames.size(), 0.0);
+        for (ml::core_t::TTime bucket = 0; bucket < 300; ++bucket) {
+            for (std::size_t zoo = 0; zoo < 8; ++zoo) {
+                for (std::size_t animal = 0; animal < 3; ++animal) {
+                    double value = 10.0 * static_cast<double>(animal + 1) +
+                                   std::sin(static_cast<double>(bucket * (zoo + 1)));
+                    if (bucket == 250 && zoo == 5 && animal == 1) {
+                        value += 100.0;
+                    }
+                    dataRows["time"] = ml::core::CStringUtils::typeToString(
+                        1000000 + bucket * BUCKET_SIZE + 60 * static_cast<ml::core_t::TTime>(animal));
+                    dataRows["zoo"] = "zoo" + ml::core::CStringUtils::typeToString(zoo);
+                    dataRows["animal"] = "animal" + ml::core::CStringUtils::typeToString(animal);
+                    dataRows["value"] = ml::core::CStringUtils::typeToStringPrecise(
+                        value, ml::core::CIEEE754::E_DoublePrecision);
+                    if (typed) {
+                        numericValues[0] = static_cast<double>(
+                            1000000 + bucket * BUCKET_SIZE +
+                            60 * static_cast<ml::core_t::TTime>(animal));
+                        fieldValues[1] = dataRows["zoo"];
+                        fieldValues[2] = dataRows["animal"];
+                        // Use the value the string would parse to so the
+                        // results are identical
+                        CPPUNIT_ASSERT(ml::core::CStringUtils::stringToType(
+                            dataRows["value"], numericValues[3]));
+                        CPPUNIT_ASSERT(job.handleTypedFieldValues(fieldValues, numericValues));
+                    } else if (positional) {
+                        for (std::size_t i = 0; i + 1 < fieldNames.size(); ++i) {
+                            fieldValues[i] = dataRows[fieldNames[i]];
+                        }
+                        CPPUNIT_ASSERT(job.handleFieldValues(fieldValues));
+                    } else {
+                        CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                    }
+                }
+            }
+            if (positional && bucket % 50 == 25) {
+                ml::api::CAnomalyJob::TStrVec flush(fieldNames.size());
+                flush.back() = "f" + ml::core::CStringUtils::typeToString(bucket);
+                CPPUNIT_ASSERT(typed ? job.handleTypedFieldValues(flush, numericValues)
+                                     : job.handleFieldValues(flush));
+            }
+        }
+        if (positional) {
+            // Records may still be queued for the detectors at this point
+            std::ostringstream* strm(nullptr);
+            ml::api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+            ml::api::CSingleStreamDataAdder persister(ptr);
+            CPPUNIT_ASSERT(job.persistState(persister));
+            persistedState = strm->str();
+            // The snapshot ID is the time of the persist, so replace the
+            // first occurrence of it (which is in the bulk metadata)
+            CPPUNIT_ASSERT_EQUAL(std::size_t(1), ml::core::CStringUtils::replaceFirst(
+                                                     snapshotId, "snap", persistedState));
+        }
+        job.finalise();
+    }
+
+    // Processing and log times are the only things we expect to differ
+    // between runs, so zero them
+    std::string output = outputStrm.str() + persistedState;
+    zeroTimes(output);
+
+    return output;
+}
+
+const ml::core_t::TTime JUMP_BUCKET(50);
+
+//! Run a job with a 1MB memory limit using \p numberThreads threads, adding
+//! a partition each bucket until the limit is reached, and return its
+//! output.  If \p jump is true the job instead sees 3 partitions until
+//! JUMP_BUCKET and then 30 partitions, whose models are all created when
+//! that bucket is sampled, from then on.
+std::string runJobToMemoryLimit(std::size_t numberThreads, bool jump) {
+    resetGlobalState();
+
+    ml::model::CLimits limits;
+    limits.resourceMonitor().memoryLimit(1);
+    ml::api::CFieldConfig fieldConfig;
+    ml::api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal",
+                                           "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+
+    std::stringstream outputStrm;
+    {
+        ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+        ml::api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream,
+                                 ml::api::CAnomalyJob::TPersistCompleteFunc(),
+                                 nullptr, -1, "time", "", 0, numberThreads);
+
+        ml::api::CAnomalyJob::TStrStrUMap dataRows;
+        for (ml::core_t::TTime bucket = 0; bucket < 200; ++bucket) {
+            std::size_t numberZoos = jump ? (bucket < JUMP_BUCKET ? 3 : 30)
+                                          : static_cast<std::size_t>(bucket) + 1;
+            for (std::size_t zoo = 0; zoo < numberZoos; ++zoo) {
+                for (std::size_t animal = 0; animal < 3; ++animal) {
+                    double value = 10.0 * static_cast<double>(animal + 1) +
+                                   std::sin(static_cast<double>(bucket * (zoo + 1)));
+                    dataRows["time"] = ml::core::CStringUtils::typeToString(
+                        1000000 + bucket * BUCKET_SIZE + 60 * static_cast<ml::core_t::TTime>(animal));
+                    dataRows["zoo"] = "zoo" + ml::core::CStringUtils::typeToString(zoo);
+                    dataRows["animal"] = "animal" + ml::core::CStringUtils::typeToString(animal);
+                    dataRows["value"] = ml::core::CStringUtils::typeToStringPrecise(
+                        value, ml::core::CIEEE754::E_DoublePrecision);
+                    CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                }
+            }
+        }
+        job.finalise();
+    }
+
+    std::string output = outputStrm.str();
+    zeroTimes(output);
+
+    return output;
+}
+
+const std::size_t NUMBER_GROWTH_ZOOS(4);
+const ml::core_t::TTime DAY(86400);
+
+//! Run a job with a 1MB memory limit using \p numberThreads threads on
+//! NUMBER_GROWTH_ZOOS partitions, a new one of which is seen in each of the
+//! first buckets, and return its output.  The values have a strong daily
+//! periodicity so the models then grow, for example as they add seasonal
+//! components, without any new models being created.
+std::string runJobWithGrowingModels(std::size_t numberThreads) {
+    resetGlobalState();
+
+    ml::model::CLimits limits;
+    limits.resourceMonitor().memoryLimit(1);
+    ml::api::CFieldConfig fieldConfig;
+    ml::api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal",
+                                           "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+
+    std::stringstream outputStrm;
+    {
+        ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+        ml::api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream,
+                                 ml::api::CAnomalyJob::TPersistCompleteFunc(),
+                                 nullptr, -1, "time", "", 0, numberThreads);
+
+        ml::api::CAnomalyJob::TStrStrUMap dataRows;
+        for (ml::core_t::TTime bucket = 0; bucket < 480; ++bucket) {
+            ml::core_t::TTime time{1000000 + bucket * BUCKET_SIZE};
+            double daily{std::sin(boost::math::double_constants::two_pi *
+                                  static_cast<double>(time % DAY) /
+                                  static_cast<double>(DAY))};
+            std::size_t numberZoos{std::min(static_cast<std::size_t>(bucket) + 1,
+                                            NUMBER_GROWTH_ZOOS)};
+            for (std::size_t zoo = 0; zoo < numberZoos; ++zoo) {
+                for (std::size_t animal = 0; animal < 3; ++animal) {
+                    double value = 10.0 * static_cast<double>(animal + 1) * (2.0 + daily) +
+                                   0.1 * std::sin(static_cast<double>(bucket * (zoo + 1)));
+                    dataRows["time"] = ml::core::CStringUtils::typeToString(
+                        time + 60 * static_cast<ml::core_t::TTime>(animal));
+                    dataRows["zoo"] = "zoo" + ml::core::CStringUtils::typeToString(zoo);
+                    dataRows["animal"] = "animal" + ml::core::CStringUtils::typeToString(animal);
+                    dataRows["value"] = ml::core::CStringUtils::typeToStringPrecise(
+                        value, ml::core::CIEEE754::E_DoublePrecision);
+                    CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                }
+            }
+        }
+        job.finalise();
+    }
+
+    std::string output = outputStrm.str();
+    zeroTimes(output);
+
+    return output;
+}
 }
 
 using namespace ml;
@@ -1843,6 +2190,697 @@ void CAnomalyJobTest::testRestoreFailsWithEmptyStream() {
     CPPUNIT_ASSERT(job.restoreState(restoreSearcher, completeToTime) == false);
 }
 
+void CAnomalyJobTest::testParallelBuildResults() {
+    std::string serialOutput = runPartitionedJob(1);
+    LOG_TRACE(<< "Serial output: " << serialOutput);
+
+    CPPUNIT_ASSERT(countBuckets("bucket", serialOutput) > 0);
+    CPPUNIT_ASSERT(countBuckets("records", serialOutput) > 0);
+    CPPUNIT_ASSERT(countBuckets("model_plot", serialOutput) > 0);
+
+    for (std::size_t numberThreads : {2, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+        std::string parallelOutput = runPartitionedJob(numberThreads);
+        CPPUNIT_ASSERT_EQUAL(serialOutput, parallelOutput);
+    }
+}
+
+void CAnomalyJobTest::testParallelBuildResultsMemoryLimit() {
+    // The job goes back to processing the detectors one at a time if the
+    // memory usage could reach the prune threshold whilst they sample the
+    // bucket, so the limit is enforced exactly as it is when single threaded.
+    // With the jump the usage is well below the threshold until the models
+    // of the new partitions, which take it past the hard limit in a single
+    // bucket, are created.
+
+    for (bool jump : {false, true}) {
+        LOG_DEBUG(<< "Testing jump = " << jump);
+
+        std::string serialOutput = runJobToMemoryLimit(1, jump);
+        LOG_TRACE(<< "Serial output: " << serialOutput);
+
+        CPPUNIT_ASSERT(serialOutput.find("\"memory_status\":\"hard_limit\"") !=
+                       std::string::npos);
+        if (jump) {
+            // The record times are offset from the bucket boundaries, so the
+            // jump's records are in the bucket which starts in JUMP_BUCKET - 1
+            CPPUNIT_ASSERT(firstMemoryLimitedTime(serialOutput) >=
+                           1000 * (1000000 + (JUMP_BUCKET - 1) * BUCKET_SIZE));
+        }
+
+        for (std::size_t numberThreads : {2, 4}) {
+            LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+            std::string parallelOutput = runJobToMemoryLimit(numberThreads, jump);
+            CPPUNIT_ASSERT_EQUAL(serialOutput, parallelOutput);
+        }
+    }
+}
+
+void CAnomalyJobTest::testParallelBuildResultsModelGrowth() {
+    // All the models are created in the first few buckets and the usage only
+    // crosses the prune threshold, days later, as they grow sampling the
+    // periodic values.  The growth is included in the refreshed usage, so
+    // the job switches from sampling the detectors concurrently to one at a
+    // time before it crosses and prunes exactly as it does when single
+    // threaded.
+
+    std::string serialOutput = runJobWithGrowingModels(1);
+    LOG_TRACE(<< "Serial output: " << serialOutput);
+
+    CPPUNIT_ASSERT(firstMemoryLimitedTime(serialOutput) >= 1000 * (1000000 + DAY));
+
+    for (std::size_t numberThreads : {2, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+        std::string parallelOutput = runJobWithGrowingModels(numberThreads);
+        CPPUNIT_ASSERT_EQUAL(serialOutput, parallelOutput);
+    }
+}
+
+void CAnomalyJobTest::testParallelAddRecords() {
+    // Records passed by position with control messages in between, and a
+    // persist at the end, exercise the points at which queued records must
+    // be added.
+
+    std::string serialOutput = runPartitionedJob(1, true);
+    LOG_TRACE(<< "Serial output: " << serialOutput);
+
+    CPPUNIT_ASSERT(countBuckets("flush", serialOutput) > 0);
+    CPPUNIT_ASSERT(countBuckets("records", serialOutput) > 0);
+
+    for (std::size_t numberThreads : {3, 8}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+        std::string parallelOutput = runPartitionedJob(numberThreads, true);
+        CPPUNIT_ASSERT_EQUAL(serialOutput, parallelOutput);
+    }
+}
+
+void CAnomalyJobTest::testTypedFieldValues() {
+    // Passing the time and metric value as numbers must give exactly the
+    // same results as passing them as strings.
+
+    std::string stringOutput = runPartitionedJob(1, true);
+    LOG_TRACE(<< "String output: " << stringOutput);
+
+    for (std::size_t numberThreads : {1, 3}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+        std::string typedOutput = runPartitionedJob(numberThreads, true, true);
+        CPPUNIT_ASSERT_EQUAL(stringOutput, typedOutput);
+    }
+}
+
+void CAnomalyJobTest::testParallelRestore() {
+    // Restoring the detectors in parallel must give exactly the same state
+    // as restoring them one at a time.
+
+    model::CLimits limits;
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    std::ostringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    std::string snapshotId;
+    api::CAnomalyJob::TPersistCompleteFunc reportPersistComplete =
+        [&snapshotId](const api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+            snapshotId = report.s_SnapshotId;
+        };
+
+    auto persist = [&](api::CAnomalyJob& job) {
+        std::ostringstream* strm(nullptr);
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder persister(ptr);
+        CPPUNIT_ASSERT(job.persistState(persister));
+        std::string state = strm->str();
+        // The snapshot ID can be different between persists, so replace the
+        // first occurrence of it (which is in the bulk metadata)
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1),
+                             core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+        return state;
+    };
+
+    std::string origPersistedState;
+    {
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                             wrappedOutputStream, reportPersistComplete);
+
+        api::CAnomalyJob::TStrStrUMap dataRows;
+        for (core_t::TTime bucket = 0; bucket < 100; ++bucket) {
+            for (std::size_t zoo = 0; zoo < 8; ++zoo) {
+                for (std::size_t animal = 0; animal < 3; ++animal) {
+                    double value = 10.0 * static_cast<double>(animal + 1) +
+                                   std::sin(static_cast<double>(bucket * (zoo + 1)));
+                    dataRows["time"] = core::CStringUtils::typeToString(
+                        1000000 + bucket * BUCKET_SIZE + 60 * static_cast<core_t::TTime>(animal));
+                    dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(zoo);
+                    dataRows["animal"] = "animal" + core::CStringUtils::typeToString(animal);
+                    dataRows["value"] = core::CStringUtils::typeToString(value);
+                    CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                }
+            }
+        }
+        origPersistedState = persist(job);
+    }
+
+    for (std::size_t numberThreads : {1, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                             wrappedOutputStream, reportPersistComplete, nullptr,
+                             -1, "time", "", 0, numberThreads);
+
+        core_t::TTime completeToTime(0);
+        auto strm = std::make_shared<boost::iostreams::filtering_istream>();
+        strm->push(api::CStateRestoreStreamFilter());
+        std::istringstream inputStream(origPersistedState);
+        strm->push(inputStream);
+        api::CSingleStreamSearcher retriever(strm);
+        CPPUNIT_ASSERT(job.restoreState(retriever, completeToTime));
+        CPPUNIT_ASSERT(completeToTime > 0);
+        CPPUNIT_ASSERT_EQUAL(api::CAnomalyJob::E_Success,
+                             job.restoreStateStatus().s_RestoredStateStatus);
+
+        CPPUNIT_ASSERT_EQUAL(origPersistedState, persist(job));
+    }
+}
+
+void CAnomalyJobTest::testBinaryStateRestore() {
+    // State persisted in the binary format must restore, serially and in
+    // parallel, to exactly the state which was persisted, whichever format
+    // the restoring job persists in.
+
+    model::CLimits limits;
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    std::ostringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    std::string snapshotId;
+    api::CAnomalyJob::TPersistCompleteFunc reportPersistComplete =
+        [&snapshotId](const api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+            snapshotId = report.s_SnapshotId;
+        };
+
+    auto persist = [&](api::CAnomalyJob& job) {
+        std::ostringstream* strm(nullptr);
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder persister(ptr);
+        CPPUNIT_ASSERT(job.persistState(persister));
+        std::string state = strm->str();
+        // The snapshot ID can be different between persists, so replace the
+        // first occurrence of it (which is in the bulk metadata)
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1),
+                             core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+        return state;
+    };
+
+    auto restore = [&](api::CAnomalyJob& job, const std::string& state) {
+        core_t::TTime completeToTime(0);
+        auto strm = std::make_shared<boost::iostreams::filtering_istream>();
+        strm->push(api::CStateRestoreStreamFilter());
+        std::istringstream inputStream(state);
+        strm->push(inputStream);
+        api::CSingleStreamSearcher retriever(strm);
+        CPPUNIT_ASSERT(job.restoreState(retriever, completeToTime));
+        CPPUNIT_ASSERT(completeToTime > 0);
+        CPPUNIT_ASSERT_EQUAL(api::CAnomalyJob::E_Success,
+                             job.restoreStateStatus().s_RestoredStateStatus);
+    };
+
+    std::string origJsonState;
+    std::string origBinaryState;
+    for (bool binaryState : {false, true}) {
+        resetGlobalState();
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                             wrappedOutputStream, reportPersistComplete, nullptr,
+                             -1, "time", "", 0, 1, 0, 0, binaryState);
+
+        api::CAnomalyJob::TStrStrUMap dataRows;
+        for (core_t::TTime bucket = 0; bucket < 100; ++bucket) {
+            for (std::size_t zoo = 0; zoo < 8; ++zoo) {
+                for (std::size_t animal = 0; animal < 3; ++animal) {
+                    double value = 10.0 * static_cast<double>(animal + 1) +
+                                   std::sin(static_cast<double>(bucket * (zoo + 1)));
+                    dataRows["time"] = core::CStringUtils::typeToString(
+                        1000000 + bucket * BUCKET_SIZE + 60 * static_cast<core_t::TTime>(animal));
+                    dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(zoo);
+                    dataRows["animal"] = "animal" + core::CStringUtils::typeToString(animal);
+                    dataRows["value"] = core::CStringUtils::typeToString(value);
+                    CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                }
+            }
+        }
+        (binaryState ? origBinaryState : origJsonState) = persist(job);
+    }
+    LOG_DEBUG(<< "JSON state size = " << origJsonState.size()
+              << ", binary state size = " << origBinaryState.size());
+
+    for (std::size_t numberThreads : {1, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+
+        api::CAnomalyJob binaryJob("job", limits, fieldConfig, modelConfig,
+                                   wrappedOutputStream, reportPersistComplete, nullptr,
+                                   -1, "time", "", 0, numberThreads, 0, 0, true);
+        restore(binaryJob, origBinaryState);
+        CPPUNIT_ASSERT_EQUAL(origBinaryState, persist(binaryJob));
+
+        // A job which persists JSON detects the format of the state it
+        // restores and has exactly the models of the job which persisted it.
+        api::CAnomalyJob jsonJob("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads);
+        restore(jsonJob, origBinaryState);
+        CPPUNIT_ASSERT_EQUAL(origJsonState, persist(jsonJob));
+    }
+}
+
+void CAnomalyJobTest::testDeltaSnapshots() {
+    // The deltas should only contain the detectors which have been sent
+    // records since the previous snapshot, even though every detector is
+    // sampled at the end of each bucket.  Restoring a delta, followed by
+    // its predecessors, must restore each detector from the latest snapshot
+    // which contains it and then sample the buckets since, so its model is
+    // the same as if the job hadn't been interrupted.  A snapshot which
+    // fails to persist mustn't be a predecessor of the next delta.
+
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    std::ostringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    std::string snapshotId;
+    api::CAnomalyJob::TPersistCompleteFunc reportPersistComplete =
+        [&snapshotId](const api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+            snapshotId = report.s_SnapshotId;
+        };
+
+    auto persist = [&](api::CAnomalyJob& job) {
+        std::ostringstream* strm(nullptr);
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder persister(ptr);
+        CPPUNIT_ASSERT(job.persistState(persister));
+        std::string state = strm->str();
+        // The snapshot ID can be different between persists, so replace the
+        // first occurrence of it (which is in the bulk metadata)
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1),
+                             core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+        return state;
+    };
+    auto backgroundPersist = [&](api::CAnomalyJob& job) {
+        std::ostringstream* strm(nullptr);
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder adder(ptr);
+        api::CBackgroundPersister persister(300, adder);
+        CPPUNIT_ASSERT(persister.firstProcessorPeriodicPersistFunc(
+            [&job](api::CBackgroundPersister& persister_) {
+                return job.periodicPersistState(persister_);
+            }));
+        CPPUNIT_ASSERT(persister.startBackgroundPersist());
+        CPPUNIT_ASSERT(persister.waitForIdle());
+        return strm->str();
+    };
+    auto failedBackgroundPersist = [&](api::CAnomalyJob& job) {
+        CFailingDataAdder adder;
+        api::CBackgroundPersister persister(300, adder);
+        CPPUNIT_ASSERT(persister.firstProcessorPeriodicPersistFunc(
+            [&job](api::CBackgroundPersister& persister_) {
+                return job.periodicPersistState(persister_);
+            }));
+        CPPUNIT_ASSERT(persister.startBackgroundPersist());
+        CPPUNIT_ASSERT(persister.waitForIdle());
+    };
+    using TStrStrMap = std::map<std::string, std::string>;
+    auto detectorStates = [](api::CAnomalyJob& job) {
+        api::CAnomalyJob::TKeyCRefAnomalyDetectorPtrPrVec detectors;
+        job.sortedDetectors(detectors);
+        api::CAnomalyJob::SPersistDetectors persistDetectors(detectors);
+        TStrStrMap states;
+        for (std::size_t i = 0; i < detectors.size(); ++i) {
+            // The simple count detector also persists the global statistics
+            if (detectors[i].first.second.get().isSimpleCount()) {
+                continue;
+            }
+            std::ostringstream strm;
+            {
+                core::CJsonStatePersistInserter inserter(strm);
+                persistDetectors.persist(i, inserter);
+            }
+            states[detectors[i].first.first.get() + '/' +
+                   detectors[i].first.second.get().debug()] = strm.str();
+        }
+        return states;
+    };
+    auto restore = [&](api::CAnomalyJob& job, const std::string& state) {
+        core_t::TTime completeToTime(0);
+        auto strm = std::make_shared<boost::iostreams::filtering_istream>();
+        strm->push(api::CStateRestoreStreamFilter());
+        std::istringstream inputStream(state);
+        strm->push(inputStream);
+        api::CSingleStreamSearcher retriever(strm);
+        return job.restoreState(retriever, completeToTime);
+    };
+
+    std::string serialPersistedState;
+    for (std::size_t numberThreads : {1, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+
+        // The global statistics, including the memory usage, are persisted
+        // with the job state, so each run must start from scratch
+        for (int i = 0; i < stat_t::E_LastEnumStat; ++i) {
+            core::CStatistics::stat(i).set(0);
+        }
+        model::CLimits limits;
+
+        std::string origPersistedState;
+        std::string baseSnapshot;
+        std::string deltaSnapshots[2];
+        TStrStrMap baseStates;
+        TStrStrMap deltaStates[2];
+        {
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads, 2);
+
+            api::CAnomalyJob::TStrStrUMap dataRows;
+            auto addRecords = [&](core_t::TTime begin, core_t::TTime end,
+                                  core_t::TTime offset, std::size_t zooBegin,
+                                  std::size_t zooEnd) {
+                for (core_t::TTime bucket = begin; bucket < end; ++bucket) {
+                    for (std::size_t zoo = zooBegin; zoo < zooEnd; ++zoo) {
+                        for (std::size_t animal = 0; animal < 3; ++animal) {
+                            double value = 10.0 * static_cast<double>(animal + 1) +
+                                           std::sin(static_cast<double>(bucket * (zoo + 1)));
+                            dataRows["time"] = core::CStringUtils::typeToString(
+                                1000000 + bucket * BUCKET_SIZE + offset +
+                                60 * static_cast<core_t::TTime>(animal));
+                            dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(zoo);
+                            dataRows["animal"] = "animal" +
+                                                 core::CStringUtils::typeToString(animal);
+                            dataRows["value"] = core::CStringUtils::typeToString(value);
+                            CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                        }
+                    }
+                }
+            };
+
+            addRecords(0, 100, 0, 0, 8);
+            baseSnapshot = backgroundPersist(job);
+            baseStates = detectorStates(job);
+            // The first delta must include the changes since the base
+            // rather than the snapshot which failed
+            addRecords(100, 110, 0, 2, 3);
+            failedBackgroundPersist(job);
+            // Only one partition gets data before each delta, but every
+            // partition is sampled
+            addRecords(110, 120, 0, 0, 1);
+            deltaSnapshots[0] = backgroundPersist(job);
+            deltaStates[0] = detectorStates(job);
+            addRecords(120, 130, 0, 1, 2);
+            deltaSnapshots[1] = backgroundPersist(job);
+            deltaStates[1] = detectorStates(job);
+            origPersistedState = persist(job);
+        }
+        LOG_DEBUG(<< "base size = " << baseSnapshot.size() << ", delta sizes = "
+                  << deltaSnapshots[0].size() << ", " << deltaSnapshots[1].size());
+        // The first delta holds three of the nine detectors and the second
+        // two, the changed partitions' and the simple count detector, and
+        // every detector is compressed on its own
+        CPPUNIT_ASSERT(2 * deltaSnapshots[0].size() < baseSnapshot.size());
+        CPPUNIT_ASSERT(3 * deltaSnapshots[1].size() < baseSnapshot.size());
+
+        // Records queued for the detectors must be added before persisting
+        if (numberThreads == 1) {
+            serialPersistedState = origPersistedState;
+        } else {
+            CPPUNIT_ASSERT_EQUAL(serialPersistedState, origPersistedState);
+        }
+
+        {
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads);
+            CPPUNIT_ASSERT(restore(job, deltaSnapshots[1] + deltaSnapshots[0] + baseSnapshot));
+            CPPUNIT_ASSERT_EQUAL(api::CAnomalyJob::E_Success,
+                                 job.restoreStateStatus().s_RestoredStateStatus);
+            TStrStrMap restoredStates = detectorStates(job);
+            CPPUNIT_ASSERT_EQUAL(baseStates.size(), restoredStates.size());
+            std::size_t numberStale = 0;
+            for (const auto& restored : restoredStates) {
+                const std::string& key = restored.first;
+                const TStrStrMap& persisted =
+                    key.compare(0, 5, "zoo1/") == 0
+                        ? deltaStates[1]
+                        : (key.compare(0, 5, "zoo0/") == 0 || key.compare(0, 5, "zoo2/") == 0
+                               ? deltaStates[0]
+                               : baseStates);
+                numberStale += persisted.at(key) == deltaStates[1].at(key) ? 0 : 1;
+                // Detectors in the latest delta are restored exactly
+                if (&persisted == &deltaStates[1]) {
+                    CPPUNIT_ASSERT_EQUAL(persisted.at(key), restored.second);
+                }
+            }
+            // The detectors without data have been sampled since they were
+            // last persisted
+            CPPUNIT_ASSERT(numberStale > 0);
+
+            // The restored models must be the same as those of the job which
+            // wasn't interrupted, including those restored from predecessors,
+            // up to the precision of the state they were restored from
+            for (const auto& restored : restoredStates) {
+                LOG_TRACE(<< "Checking " << restored.first);
+                CPPUNIT_ASSERT(isSameToPersistedPrecision(
+                    deltaStates[1].at(restored.first), restored.second));
+            }
+        }
+
+        // A delta can't be restored without all of its predecessors
+        {
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads);
+            CPPUNIT_ASSERT(restore(job, deltaSnapshots[1] + baseSnapshot) == false);
+        }
+        {
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, reportPersistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads);
+            CPPUNIT_ASSERT(restore(job, deltaSnapshots[1]) == false);
+        }
+    }
+}
+
+void CAnomalyJobTest::testBackgroundPersistCopyOnWrite() {
+    // The detectors in a snapshot persisted in the background are only
+    // copied if they change before they've been written, and the snapshot
+    // has their state as it was when it was taken.
+
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    std::ostringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    auto persistDetector = [](api::CAnomalyJob::SPersistDetectors& detectors, std::size_t i) {
+        std::ostringstream strm;
+        {
+            core::CJsonStatePersistInserter inserter(strm);
+            detectors.persist(i, inserter);
+        }
+        return strm.str();
+    };
+
+    for (std::size_t numberThreads : {1, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+
+        model::CLimits limits;
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream,
+                             api::CAnomalyJob::TPersistCompleteFunc(), nullptr,
+                             -1, "time", "", 0, numberThreads);
+
+        api::CAnomalyJob::TStrStrUMap dataRows;
+        auto addRecords = [&](core_t::TTime begin, core_t::TTime end, core_t::TTime offset,
+                              std::size_t zooBegin, std::size_t zooEnd) {
+            for (core_t::TTime bucket = begin; bucket < end; ++bucket) {
+                for (std::size_t zoo = zooBegin; zoo < zooEnd; ++zoo) {
+                    for (std::size_t animal = 0; animal < 3; ++animal) {
+                        double value = 10.0 * static_cast<double>(animal + 1) +
+                                       std::sin(static_cast<double>(bucket * (zoo + 1)));
+                        dataRows["time"] = core::CStringUtils::typeToString(
+                            1000000 + bucket * BUCKET_SIZE + offset +
+                            60 * static_cast<core_t::TTime>(animal));
+                        dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(zoo);
+                        dataRows["animal"] = "animal" + core::CStringUtils::typeToString(animal);
+                        dataRows["value"] = core::CStringUtils::typeToString(value);
+                        CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                    }
+                }
+            }
+        };
+
+        addRecords(0, 100, 0, 0, 4);
+        job.addPendingRecords();
+
+        api::CAnomalyJob::TKeyCRefAnomalyDetectorPtrPrVec detectors;
+        job.sortedDetectors(detectors);
+        std::size_t numberDetectors = detectors.size();
+        CPPUNIT_ASSERT(numberDetectors > 2);
+
+        api::CAnomalyJob::TStrVec expected;
+        {
+            api::CAnomalyJob::SPersistDetectors reference(detectors);
+            for (std::size_t i = 0; i < numberDetectors; ++i) {
+                expected.push_back(persistDetector(reference, i));
+            }
+        }
+
+        auto snapshot = std::make_shared<api::CAnomalyJob::SPersistDetectors>(detectors);
+        job.m_PersistingDetectors = snapshot;
+        CPPUNIT_ASSERT_EQUAL(expected[0], persistDetector(*snapshot, 0));
+
+        // Records in the current bucket for one partition only cause its
+        // detectors, and the simple count detector, to be copied
+        addRecords(99, 100, 200, 1, 2);
+        job.addPendingRecords();
+        std::size_t numberCopied = 0;
+        for (std::size_t i = 0; i < numberDetectors; ++i) {
+            bool changed = detectors[i].first.first.get() == "zoo1" ||
+                           detectors[i].first.second.get().isSimpleCount();
+            CPPUNIT_ASSERT_EQUAL(i > 0 && changed, snapshot->s_Copies[i].s_Detector != nullptr);
+            numberCopied += snapshot->s_Copies[i].s_Detector != nullptr ? 1 : 0;
+        }
+        CPPUNIT_ASSERT(numberCopied > 0);
+        CPPUNIT_ASSERT(numberCopied < numberDetectors - 1);
+
+        // Everything which hasn't been written is copied before the bucket's
+        // results are output
+        addRecords(100, 101, 0, 0, 4);
+        CPPUNIT_ASSERT(job.m_PersistingDetectors.expired());
+        for (std::size_t i = 1; i < numberDetectors; ++i) {
+            CPPUNIT_ASSERT(snapshot->s_Copies[i].s_Detector != nullptr);
+            std::string state = persistDetector(*snapshot, i);
+            CPPUNIT_ASSERT(snapshot->s_Copies[i].s_Detector == nullptr);
+            // The simple count detector also persists the global statistics,
+            // which aren't copied
+            if (detectors[i].first.second.get().isSimpleCount() == false) {
+                CPPUNIT_ASSERT_EQUAL(expected[i], state);
+            }
+        }
+    }
+}
+
+void CAnomalyJobTest::testBackgroundPersistBoundedCopies() {
+    // A bucket closing while the detectors are written in the background
+    // copies no more of them than fit in the memory allowed for copies and
+    // waits for the rest to be written.
+
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+    std::ostringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    auto persistDetector = [](api::CAnomalyJob::SPersistDetectors& detectors, std::size_t i) {
+        std::ostringstream strm;
+        {
+            core::CJsonStatePersistInserter inserter(strm);
+            detectors.persist(i, inserter);
+        }
+        return strm.str();
+    };
+
+    for (std::size_t numberThreads : {1, 4}) {
+        LOG_DEBUG(<< "Testing " << numberThreads << " threads");
+
+        model::CLimits limits;
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream,
+                             api::CAnomalyJob::TPersistCompleteFunc(), nullptr,
+                             -1, "time", "", 0, numberThreads);
+
+        api::CAnomalyJob::TStrStrUMap dataRows;
+        auto addRecords = [&](core_t::TTime begin, core_t::TTime end) {
+            for (core_t::TTime bucket = begin; bucket < end; ++bucket) {
+                for (std::size_t zoo = 0; zoo < 6; ++zoo) {
+                    for (std::size_t animal = 0; animal < 3; ++animal) {
+                        double value = 10.0 * static_cast<double>(animal + 1) +
+                                       std::sin(static_cast<double>(bucket * (zoo + 1)));
+                        dataRows["time"] = core::CStringUtils::typeToString(
+                            1000000 + bucket * BUCKET_SIZE +
+                            60 * static_cast<core_t::TTime>(animal));
+                        dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(zoo);
+                        dataRows["animal"] = "animal" + core::CStringUtils::typeToString(animal);
+                        dataRows["value"] = core::CStringUtils::typeToString(value);
+                        CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                    }
+                }
+            }
+        };
+
+        addRecords(0, 100);
+        job.addPendingRecords();
+
+        api::CAnomalyJob::TKeyCRefAnomalyDetectorPtrPrVec detectors;
+        job.sortedDetectors(detectors);
+        std::size_t numberDetectors = detectors.size();
+        std::size_t maxCopies = 3;
+        CPPUNIT_ASSERT(numberDetectors > 2 * maxCopies);
+
+        api::CAnomalyJob::TStrVec expected;
+        {
+            api::CAnomalyJob::SPersistDetectors reference(detectors);
+            for (std::size_t i = 0; i < numberDetectors; ++i) {
+                expected.push_back(persistDetector(reference, i));
+            }
+        }
+
+        // Each detector costs one unit of memory to copy
+        auto snapshot = std::make_shared<api::CAnomalyJob::SPersistDetectors>(
+            detectors, api::CAnomalyJob::SPersistDetectors::TSizeVec(numberDetectors, 1),
+            maxCopies);
+        job.m_PersistingDetectors = snapshot;
+
+        // The writer only starts once the bucket has started closing, so
+        // the persist spans the bucket boundary
+        api::CAnomalyJob::TStrVec states(numberDetectors);
+        std::thread writer([&] {
+            while (snapshot->s_PeakCopyMemory == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            for (std::size_t i = 0; i < numberDetectors; ++i) {
+                states[i] = persistDetector(*snapshot, i);
+            }
+            snapshot->finish();
+        });
+
+        addRecords(100, 101);
+        CPPUNIT_ASSERT(job.m_PersistingDetectors.expired());
+        writer.join();
+
+        LOG_DEBUG(<< "peak copies = " << snapshot->s_PeakCopyMemory.load());
+        CPPUNIT_ASSERT(snapshot->s_PeakCopyMemory > 0);
+        CPPUNIT_ASSERT(snapshot->s_PeakCopyMemory <= maxCopies);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), snapshot->s_CopyMemory.load());
+        for (std::size_t i = 0; i < numberDetectors; ++i) {
+            CPPUNIT_ASSERT(snapshot->s_Copies[i].s_Detector == nullptr);
+            // The simple count detector also persists the global statistics,
+            // which aren't copied
+            if (detectors[i].first.second.get().isSimpleCount() == false) {
+                CPPUNIT_ASSERT_EQUAL(expected[i], states[i]);
+            }
+        }
+    }
+}
+
 CppUnit::Test* CAnomalyJobTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CAnomalyJobTest");
 
@@ -1867,5 +2905,29 @@ CppUnit::Test* CAnomalyJobTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
         "CAnomalyJobTest::testRestoreFailsWithEmptyStream",
         &CAnomalyJobTest::testRestoreFailsWithEmptyStream));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelBuildResults", &CAnomalyJobTest::testParallelBuildResults));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelBuildResultsMemoryLimit",
+        &CAnomalyJobTest::testParallelBuildResultsMemoryLimit));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelBuildResultsModelGrowth",
+        &CAnomalyJobTest::testParallelBuildResultsModelGrowth));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelAddRecords", &CAnomalyJobTest::testParallelAddRecords));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testTypedFieldValues", &CAnomalyJobTest::testTypedFieldValues));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelRestore", &CAnomalyJobTest::testParallelRestore));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testBinaryStateRestore", &CAnomalyJobTest::testBinaryStateRestore));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testDeltaSnapshots", &CAnomalyJobTest::testDeltaSnapshots));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testBackgroundPersistCopyOnWrite",
+        &CAnomalyJobTest::testBackgroundPersistCopyOnWrite));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testBackgroundPersistBoundedCopies",
+        &CAnomalyJobTest::testBackgroundPersistBoundedCopies));
     return suiteOfTests;
 }
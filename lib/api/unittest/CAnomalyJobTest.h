@@ -22,6 +22,16 @@ public:
     void testModelPlot();
     void testInterimResultEdgeCases();
     void testRestoreFailsWithEmptyStream();
+    void testParallelBuildResults();
+    void testParallelBuildResultsMemoryLimit();
+    void testParallelBuildResultsModelGrowth();
+    void testParallelAddRecords();
+    void testTypedFieldValues();
+    void testParallelRestore();
+    void testBinaryStateRestore();
+    void testDeltaSnapshots();
+    void testBackgroundPersistCopyOnWrite();
+    void testBackgroundPersistBoundedCopies();
 
     static CppUnit::Test* suite();
 };
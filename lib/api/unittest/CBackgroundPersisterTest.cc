@@ -55,6 +55,9 @@ CppUnit::Test* CBackgroundPersisterTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CBackgroundPersisterTest>(
         "CBackgroundPersisterTest::testDetectorPersistPartition",
         &CBackgroundPersisterTest::testDetectorPersistPartition));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBackgroundPersisterTest>(
+        "CBackgroundPersisterTest::testDetectorPersistPartitionInParallel",
+        &CBackgroundPersisterTest::testDetectorPersistPartitionInParallel));
     suiteOfTests->addTest(new CppUnit::TestCaller<CBackgroundPersisterTest>(
         "CBackgroundPersisterTest::testCategorizationOnlyPersist",
         &CBackgroundPersisterTest::testCategorizationOnlyPersist));
@@ -75,6 +78,11 @@ void CBackgroundPersisterTest::testDetectorPersistPartition() {
         "testfiles/new_mlfields_partition.conf");
 }
 
+void CBackgroundPersisterTest::testDetectorPersistPartitionInParallel() {
+    this->foregroundBackgroundCompCategorizationAndAnomalyDetection(
+        "testfiles/new_mlfields_partition.conf", 4);
+}
+
 void CBackgroundPersisterTest::testCategorizationOnlyPersist() {
     // Start by creating a categorizer with non-trivial state
 
@@ -145,7 +153,8 @@ void CBackgroundPersisterTest::testCategorizationOnlyPersist() {
 }
 
 void CBackgroundPersisterTest::foregroundBackgroundCompCategorizationAndAnomalyDetection(
-    const std::string& configFileName) {
+    const std::string& configFileName,
+    std::size_t numberThreads) {
     // Start by creating processors with non-trivial state
 
     static const ml::core_t::TTime BUCKET_SIZE(3600);
@@ -192,7 +201,7 @@ void CBackgroundPersisterTest::foregroundBackgroundCompCategorizationAndAnomalyD
             JOB_ID, limits, fieldConfig, modelConfig, wrappedOutputStream,
             boost::bind(&reportPersistComplete, _1, boost::ref(snapshotId),
                         boost::ref(numDocs)),
-            &backgroundPersister, -1, "time", "%d/%b/%Y:%T %z");
+            &backgroundPersister, -1, "time", "%d/%b/%Y:%T %z", 0, numberThreads);
 
         ml::api::CDataProcessor* firstProcessor(&job);
 
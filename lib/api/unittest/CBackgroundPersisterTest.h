@@ -15,12 +15,14 @@ public:
     void testDetectorPersistBy();
     void testDetectorPersistOver();
     void testDetectorPersistPartition();
+    void testDetectorPersistPartitionInParallel();
     void testCategorizationOnlyPersist();
 
     static CppUnit::Test* suite();
 
 private:
-    void foregroundBackgroundCompCategorizationAndAnomalyDetection(const std::string& configFileName);
+    void foregroundBackgroundCompCategorizationAndAnomalyDetection(const std::string& configFileName,
+                                                                   std::size_t numberThreads = 1);
 };
 
 #endif // INCLUDED_CBackgroundPersisterTest_h
@@ -12,6 +12,7 @@
 
 #include <model/CLimits.h>
 
+#include <api/CBaseTokenListDataTyper.h>
 #include <api/CFieldConfig.h>
 #include <api/CFieldDataTyper.h>
 #include <api/CJsonOutputWriter.h>
@@ -22,6 +23,8 @@
 #include "CMockDataProcessor.h"
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 using namespace ml;
 using namespace api;
@@ -81,6 +84,30 @@ private:
     uint64_t m_Records;
 };
 
+class CCategoryRecordingOutputHandler : public COutputHandler {
+public:
+    virtual bool fieldNames(const TStrVec& /*fieldNames*/, const TStrVec& /*extraFieldNames*/) {
+        return true;
+    }
+
+    virtual const TStrVec& fieldNames() const { return m_FieldNames; }
+
+    virtual bool writeRow(const TStrStrUMap& dataRowFields,
+                          const TStrStrUMap& overrideDataRowFields) {
+        auto message = dataRowFields.find("message");
+        auto category = overrideDataRowFields.find(CFieldDataTyper::MLCATEGORY_NAME);
+        m_Rows.push_back((message == dataRowFields.end() ? "" : message->second) +
+                         '|' + category->second);
+        return true;
+    }
+
+    const TStrVec& rows() const { return m_Rows; }
+
+private:
+    TStrVec m_FieldNames;
+    TStrVec m_Rows;
+};
+
 class CTestDataSearcher : public core::CDataSearcher {
 public:
     CTestDataSearcher(const std::string& data)
@@ -300,6 +327,185 @@ void CFieldDataTyperTest::testRestoreStateFailsWithEmptyState() {
     CPPUNIT_ASSERT(typer.restoreState(restoreSearcher, completeToTime) == false);
 }
 
+void CFieldDataTyperTest::testPipelined() {
+    // Check that categorizing in a pipeline gives exactly the same output,
+    // in the same order, and the same state as categorizing serially.
+
+    using TStrVec = std::vector<std::string>;
+
+    const TStrVec users{"root", "elastic", "kibana", "admin", "guest"};
+    const TStrVec hosts{"web-1", "web-2", "db-primary", "db-replica", "cache"};
+    const TStrVec extras{"retrying", "after timeout", "queue full", "shutting down"};
+
+    auto message = [&](std::size_t i) {
+        std::ostringstream result;
+        switch (i % 7) {
+        case 0:
+            result << "Node " << i << " started on host " << hosts[i % hosts.size()];
+            break;
+        case 1:
+            result << "Connection from 10.0." << i % 256 << '.' << (i * 7) % 256
+                   << " refused: too many open files";
+            break;
+        case 2:
+            result << "User " << users[i % users.size()] << " logged in from "
+                   << hosts[(i / 7) % hosts.size()];
+            break;
+        case 3:
+            result << "Failed to read block 0x" << std::hex << i * 4096
+                   << std::dec << " from disk " << i % 4;
+            break;
+        case 4:
+            result << "GC pause of " << i % 500 << " ms in thread worker-" << i % 16;
+            break;
+        case 5:
+            result << "Request " << i << " completed in " << i % 1000 << " ms with status 200";
+            break;
+        default:
+            result << "Job " << users[(i / 7) % users.size()] << " scheduled task "
+                   << hosts[i % hosts.size()] << " for user " << users[i % users.size()];
+            break;
+        }
+        if (i % 11 == 0) {
+            result << ' ' << extras[(i / 11) % extras.size()];
+        }
+        return result.str();
+    };
+
+    auto categorize = [&](std::size_t numberThreads, bool positional,
+                          TStrVec& rows, std::string& json, std::string& state) {
+        model::CLimits limits;
+        CFieldConfig config;
+        CPPUNIT_ASSERT(config.initFromFile("testfiles/new_persist_categorization.conf"));
+        CCategoryRecordingOutputHandler handler;
+
+        std::ostringstream outputStrm;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+            CJsonOutputWriter writer("job", wrappedOutputStream);
+
+            CFieldDataTyper typer("job", config, limits, handler, writer, nullptr, numberThreads);
+
+            const TStrVec fieldNames{"message", "other", "."};
+            if (positional) {
+                CPPUNIT_ASSERT(typer.handleFieldNames(fieldNames));
+            }
+            std::size_t records = 0;
+            for (std::size_t i = 0; i < 5000; ++i) {
+                TStrVec fieldValues{i % 101 == 50 ? "" : message(i), "x", ""};
+                if (i % 2477 == 2476) {
+                    fieldValues = TStrVec{"", "", "f" + std::to_string(i)};
+                } else {
+                    ++records;
+                }
+                if (positional) {
+                    if (i == 2500) {
+                        CPPUNIT_ASSERT(typer.handleFieldNames(fieldNames));
+                    }
+                    CPPUNIT_ASSERT(typer.handleFieldValues(fieldValues));
+                } else {
+                    CFieldDataTyper::TStrStrUMap dataRowFields;
+                    for (std::size_t j = 0; j < fieldNames.size(); ++j) {
+                        if (fieldValues[j].empty() == false) {
+                            dataRowFields[fieldNames[j]] = fieldValues[j];
+                        }
+                    }
+                    CPPUNIT_ASSERT(typer.handleRecord(dataRowFields));
+                }
+            }
+            typer.finalise();
+            CPPUNIT_ASSERT_EQUAL(uint64_t(records), typer.numRecordsHandled());
+
+            CTestDataAdder adder;
+            CPPUNIT_ASSERT(typer.persistState(adder));
+            state = dynamic_cast<std::ostringstream&>(*adder.getStream()).str();
+        }
+        rows = handler.rows();
+        json = outputStrm.str();
+    };
+
+    for (auto positional : {false, true}) {
+        LOG_DEBUG(<< "positional = " << positional);
+
+        TStrVec expectedRows;
+        std::string expectedJson;
+        std::string expectedState;
+        categorize(1, positional, expectedRows, expectedJson, expectedState);
+        CPPUNIT_ASSERT(expectedJson.find("\"flush\"") != std::string::npos);
+        CPPUNIT_ASSERT(expectedJson.find("\"category_definition\"") != std::string::npos);
+
+        for (std::size_t numberThreads : {2, 4}) {
+            LOG_DEBUG(<< "# threads = " << numberThreads);
+
+            TStrVec rows;
+            std::string json;
+            std::string state;
+            categorize(numberThreads, positional, rows, json, state);
+            CPPUNIT_ASSERT(expectedRows == rows);
+            CPPUNIT_ASSERT_EQUAL(expectedJson, json);
+            CPPUNIT_ASSERT_EQUAL(expectedState, state);
+        }
+    }
+}
+
+void CFieldDataTyperTest::testPositionalPretokenised() {
+    // Records supplied positionally must be categorized using their
+    // pretokenised tokens, just like records supplied by name, whether
+    // or not they're categorized in a pipeline.
+
+    using TStrVec = std::vector<std::string>;
+
+    auto categorize = [](bool positional, std::size_t numberThreads) {
+        model::CLimits limits;
+        CFieldConfig config;
+        CPPUNIT_ASSERT(config.initFromFile("testfiles/new_persist_categorization.conf"));
+        CCategoryRecordingOutputHandler handler;
+
+        std::ostringstream outputStrm;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+            CJsonOutputWriter writer("job", wrappedOutputStream);
+
+            CFieldDataTyper typer("job", config, limits, handler, writer,
+                                  nullptr, numberThreads);
+
+            const TStrVec fieldNames{"message", CBaseTokenListDataTyper::PRETOKENISED_TOKEN_FIELD};
+            if (positional) {
+                CPPUNIT_ASSERT(typer.handleFieldNames(fieldNames));
+            }
+            // The messages are identical so only the pretokenised tokens
+            // can put them in different categories
+            for (std::size_t i = 0; i < 10; ++i) {
+                TStrVec fieldValues{"Service CUBE_CHIX has shut down",
+                                    i % 2 == 0 ? "Service,CUBE_CHIX,has,shut,down"
+                                               : "编码,コーディング,코딩"};
+                if (positional) {
+                    CPPUNIT_ASSERT(typer.handleFieldValues(fieldValues));
+                } else {
+                    CFieldDataTyper::TStrStrUMap dataRowFields;
+                    for (std::size_t j = 0; j < fieldNames.size(); ++j) {
+                        dataRowFields[fieldNames[j]] = fieldValues[j];
+                    }
+                    CPPUNIT_ASSERT(typer.handleRecord(dataRowFields));
+                }
+            }
+            typer.finalise();
+        }
+        return handler.rows();
+    };
+
+    TStrVec expectedRows{categorize(false, 1)};
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), expectedRows.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("Service CUBE_CHIX has shut down|1"), expectedRows[0]);
+    CPPUNIT_ASSERT_EQUAL(std::string("Service CUBE_CHIX has shut down|2"), expectedRows[1]);
+
+    for (std::size_t numberThreads : {1, 3}) {
+        LOG_DEBUG(<< "# threads = " << numberThreads);
+        CPPUNIT_ASSERT(expectedRows == categorize(false, numberThreads));
+        CPPUNIT_ASSERT(expectedRows == categorize(true, numberThreads));
+    }
+}
+
 CppUnit::Test* CFieldDataTyperTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CFieldDataTyperTest");
 
@@ -316,5 +522,10 @@ CppUnit::Test* CFieldDataTyperTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CFieldDataTyperTest>(
         "CFieldDataTyperTest::testRestoreStateFailsWithEmptyState",
         &CFieldDataTyperTest::testRestoreStateFailsWithEmptyState));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CFieldDataTyperTest>(
+        "CFieldDataTyperTest::testPipelined", &CFieldDataTyperTest::testPipelined));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CFieldDataTyperTest>(
+        "CFieldDataTyperTest::testPositionalPretokenised",
+        &CFieldDataTyperTest::testPositionalPretokenised));
     return suiteOfTests;
 }
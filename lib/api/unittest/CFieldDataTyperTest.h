@@ -17,6 +17,8 @@ public:
     void testPassOnControlMessages();
     void testHandleControlMessages();
     void testRestoreStateFailsWithEmptyState();
+    void testPipelined();
+    void testPositionalPretokenised();
 
     static CppUnit::Test* suite();
 };
@@ -141,6 +141,10 @@ CppUnit::Test* CIoManagerTest::suite() {
         "CIoManagerTest::testNamedPipeIoGood", &CIoManagerTest::testNamedPipeIoGood));
     suiteOfTests->addTest(new CppUnit::TestCaller<CIoManagerTest>(
         "CIoManagerTest::testNamedPipeIoBad", &CIoManagerTest::testNamedPipeIoBad));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CIoManagerTest>(
+        "CIoManagerTest::testFileIoReadAhead", &CIoManagerTest::testFileIoReadAhead));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CIoManagerTest>(
+        "CIoManagerTest::testNamedPipeIoReadAhead", &CIoManagerTest::testNamedPipeIoReadAhead));
 
     return suiteOfTests;
 }
@@ -195,11 +199,34 @@ void CIoManagerTest::testNamedPipeIoBad() {
     this->testCommon(BAD_INPUT_PIPE_NAME, true, BAD_OUTPUT_PIPE_NAME, true, false);
 }
 
+void CIoManagerTest::testFileIoReadAhead() {
+    ::remove(GOOD_OUTPUT_FILE_NAME);
+
+    std::ofstream strm(GOOD_INPUT_FILE_NAME);
+    strm << std::string(TEST_SIZE, TEST_CHAR);
+    strm.close();
+
+    this->testCommon(GOOD_INPUT_FILE_NAME, false, GOOD_OUTPUT_FILE_NAME, false, true, 2);
+
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(GOOD_INPUT_FILE_NAME));
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(GOOD_OUTPUT_FILE_NAME));
+}
+
+void CIoManagerTest::testNamedPipeIoReadAhead() {
+    CThreadDataWriter threadWriter(GOOD_INPUT_PIPE_NAME, TEST_SIZE);
+    CPPUNIT_ASSERT(threadWriter.start());
+
+    this->testCommon(GOOD_INPUT_PIPE_NAME, true, GOOD_OUTPUT_PIPE_NAME, true, true, 4);
+
+    CPPUNIT_ASSERT(threadWriter.stop());
+}
+
 void CIoManagerTest::testCommon(const std::string& inputFileName,
                                 bool isInputFileNamedPipe,
                                 const std::string& outputFileName,
                                 bool isOutputFileNamedPipe,
-                                bool isGood) {
+                                bool isGood,
+                                std::size_t readAheadDepth) {
     // Test reader reads from the IO manager's output stream.
     CThreadDataReader threadReader(outputFileName);
     CPPUNIT_ASSERT(threadReader.start());
@@ -209,6 +236,9 @@ void CIoManagerTest::testCommon(const std::string& inputFileName,
     {
         ml::api::CIoManager ioMgr(inputFileName, isInputFileNamedPipe,
                                   outputFileName, isOutputFileNamedPipe);
+        if (readAheadDepth > 0) {
+            ioMgr.readInputAhead(readAheadDepth);
+        }
         CPPUNIT_ASSERT_EQUAL(isGood, ioMgr.initIo());
         if (isGood) {
             static const std::streamsize BUF_SIZE = 512;
@@ -8,6 +8,9 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <cstddef>
+#include <string>
+
 class CIoManagerTest : public CppUnit::TestFixture {
 public:
     void testStdinStdout();
@@ -15,6 +18,8 @@ public:
     void testFileIoBad();
     void testNamedPipeIoGood();
     void testNamedPipeIoBad();
+    void testFileIoReadAhead();
+    void testNamedPipeIoReadAhead();
 
     static CppUnit::Test* suite();
 
@@ -23,7 +28,8 @@ private:
                     bool isInputFileNamedPipe,
                     const std::string& outputFileName,
                     bool isOutputFileNamedPipe,
-                    bool isGood);
+                    bool isGood,
+                    std::size_t readAheadDepth = 0);
 };
 
 #endif // INCLUDED_CIoManagerTest_h
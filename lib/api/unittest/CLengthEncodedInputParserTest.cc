@@ -5,6 +5,7 @@
  */
 #include "CLengthEncodedInputParserTest.h"
 
+#include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
 #include <core/CStringUtils.h>
 #include <core/CTimeUtils.h>
@@ -14,8 +15,12 @@
 
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <ios>
 #include <sstream>
+#include <vector>
+
+#include <string.h>
 
 // For htonl
 #ifdef Windows
@@ -30,12 +35,21 @@ CppUnit::Test* CLengthEncodedInputParserTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
         "CLengthEncodedInputParserTest::testCsvEquivalence",
         &CLengthEncodedInputParserTest::testCsvEquivalence));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
+        "CLengthEncodedInputParserTest::testReadStreamIntoVecs",
+        &CLengthEncodedInputParserTest::testReadStreamIntoVecs));
     suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
         "CLengthEncodedInputParserTest::testThroughput",
         &CLengthEncodedInputParserTest::testThroughput));
     suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
         "CLengthEncodedInputParserTest::testCorruptStreamDetection",
         &CLengthEncodedInputParserTest::testCorruptStreamDetection));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
+        "CLengthEncodedInputParserTest::testTypedFields",
+        &CLengthEncodedInputParserTest::testTypedFields));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CLengthEncodedInputParserTest>(
+        "CLengthEncodedInputParserTest::testInvalidTimes",
+        &CLengthEncodedInputParserTest::testInvalidTimes));
 
     return suiteOfTests;
 }
@@ -102,6 +116,27 @@ private:
     std::string m_EncodedDataBlock;
 };
 
+void appendLength(uint32_t num, std::string& str) {
+    uint32_t netNum(htonl(num));
+    str.append(reinterpret_cast<char*>(&netNum), sizeof(netNum));
+}
+
+void appendString(const std::string& value, std::string& str) {
+    appendLength(static_cast<uint32_t>(value.length()), str);
+    str += value;
+}
+
+//! Append the little-endian bytes of \p value.
+template<typename NUM_TYPE>
+void appendLittleEndian(NUM_TYPE value, std::string& str) {
+    uint64_t bits(0);
+    static_assert(sizeof(bits) == sizeof(value), "Expected a 64 bit value");
+    ::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < sizeof(bits); ++i) {
+        str += static_cast<char>((bits >> (8 * i)) & 0xff);
+    }
+}
+
 class CVisitor {
 public:
     CVisitor() : m_Fast(true), m_RecordCount(0) {}
@@ -204,6 +239,55 @@ void CLengthEncodedInputParserTest::testCsvEquivalence() {
     CPPUNIT_ASSERT_EQUAL(size_t(15), visitor.recordCount());
 }
 
+void CLengthEncodedInputParserTest::testReadStreamIntoVecs() {
+    std::ifstream ifs("testfiles/simple.txt");
+    CPPUNIT_ASSERT(ifs.is_open());
+
+    CSetupVisitor setupVisitor;
+
+    ml::api::CCsvInputParser setupParser(ifs);
+
+    CPPUNIT_ASSERT(setupParser.readStream(std::ref(setupVisitor)));
+
+    using TStrStrUMapVec = std::vector<ml::api::CLengthEncodedInputParser::TStrStrUMap>;
+
+    // Input must be binary otherwise Windows will stop at CTRL+Z
+    std::istringstream mapInput(setupVisitor.input(2), std::ios::in | std::ios::binary);
+    ml::api::CLengthEncodedInputParser mapParser(mapInput);
+
+    TStrStrUMapVec expectedRecords;
+    CPPUNIT_ASSERT(mapParser.readStream(
+        [&expectedRecords](const ml::api::CLengthEncodedInputParser::TStrStrUMap& dataRowFields) {
+            expectedRecords.push_back(dataRowFields);
+            return true;
+        }));
+
+    std::istringstream vecInput(setupVisitor.input(2), std::ios::in | std::ios::binary);
+    ml::api::CLengthEncodedInputParser vecParser(vecInput);
+
+    std::size_t fieldNamesCalls(0);
+    ml::api::CLengthEncodedInputParser::TStrVec fieldNames;
+    TStrStrUMapVec records;
+    CPPUNIT_ASSERT(vecParser.readStreamIntoVecs(
+        [&fieldNamesCalls, &fieldNames](const ml::api::CLengthEncodedInputParser::TStrVec& names) {
+            ++fieldNamesCalls;
+            fieldNames = names;
+            return true;
+        },
+        [&fieldNames, &records](const ml::api::CLengthEncodedInputParser::TStrVec& values) {
+            CPPUNIT_ASSERT_EQUAL(fieldNames.size(), values.size());
+            records.emplace_back();
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                records.back()[fieldNames[i]] = values[i];
+            }
+            return true;
+        }));
+
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), fieldNamesCalls);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(30), records.size());
+    CPPUNIT_ASSERT(expectedRecords == records);
+}
+
 void CLengthEncodedInputParserTest::testThroughput() {
     // NB: For fair comparison with the other input formats (CSV and Google
     // Protocol Buffers), the input data and test size must be identical
@@ -260,3 +344,117 @@ void CLengthEncodedInputParserTest::testCorruptStreamDetection() {
     LOG_INFO(<< "Expect the next parse to report a suspiciously long length");
     CPPUNIT_ASSERT(!parser.readStream(std::ref(visitor)));
 }
+
+void CLengthEncodedInputParserTest::testTypedFields() {
+    std::string input;
+    appendLength(3 | 0x80000000, input);
+    appendString("time", input);
+    appendString("value", input);
+    appendString("airline", input);
+    appendString("tds", input);
+
+    appendLength(3, input);
+    appendLittleEndian(int64_t(1359331200), input);
+    appendLittleEndian(12.5, input);
+    appendString("AAL", input);
+
+    appendLength(3, input);
+    appendLittleEndian(int64_t(1359331260), input);
+    appendLittleEndian(std::numeric_limits<double>::quiet_NaN(), input);
+    appendString("", input);
+
+    // Input must be binary otherwise Windows will stop at CTRL+Z
+    std::istringstream typedInput(input, std::ios::in | std::ios::binary);
+    ml::api::CLengthEncodedInputParser typedParser(typedInput);
+
+    ml::api::CInputParser::TStrVec fieldNames;
+    ml::api::CInputParser::TFieldTypeVec fieldTypes;
+    std::vector<ml::api::CInputParser::TStrVec> values;
+    std::vector<ml::api::CInputParser::TDoubleVec> numericValues;
+    CPPUNIT_ASSERT(typedParser.readStreamIntoTypedVecs(
+        [&fieldNames, &fieldTypes](const ml::api::CInputParser::TStrVec& names,
+                                   const ml::api::CInputParser::TFieldTypeVec& types) {
+            fieldNames = names;
+            fieldTypes = types;
+            return true;
+        },
+        [&values, &numericValues](const ml::api::CInputParser::TStrVec& strings,
+                                  const ml::api::CInputParser::TDoubleVec& numbers) {
+            values.push_back(strings);
+            numericValues.push_back(numbers);
+            return true;
+        }));
+
+    CPPUNIT_ASSERT_EQUAL(std::string("[time, value, airline]"),
+                         ml::core::CContainerPrinter::print(fieldNames));
+    CPPUNIT_ASSERT(fieldTypes == ml::api::CInputParser::TFieldTypeVec(
+                                     {ml::api::CInputParser::E_Time,
+                                      ml::api::CInputParser::E_Double,
+                                      ml::api::CInputParser::E_String}));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), values.size());
+    CPPUNIT_ASSERT_EQUAL(1359331200.0, numericValues[0][0]);
+    CPPUNIT_ASSERT_EQUAL(12.5, numericValues[0][1]);
+    CPPUNIT_ASSERT_EQUAL(std::string("AAL"), values[0][2]);
+    CPPUNIT_ASSERT_EQUAL(1359331260.0, numericValues[1][0]);
+    CPPUNIT_ASSERT(numericValues[1][1] != numericValues[1][1]);
+    CPPUNIT_ASSERT_EQUAL(std::string(""), values[1][2]);
+
+    // Readers which don't understand types get the numbers as strings
+    std::istringstream stringInput(input, std::ios::in | std::ios::binary);
+    ml::api::CLengthEncodedInputParser stringParser(stringInput);
+
+    values.clear();
+    CPPUNIT_ASSERT(stringParser.readStreamIntoVecs(
+        [](const ml::api::CInputParser::TStrVec&) { return true; },
+        [&values](const ml::api::CInputParser::TStrVec& strings) {
+            values.push_back(strings);
+            return true;
+        }));
+
+    CPPUNIT_ASSERT_EQUAL(std::string("[[1359331200, 12.5, AAL], [1359331260, , ]]"),
+                         ml::core::CContainerPrinter::print(values));
+}
+
+void CLengthEncodedInputParserTest::testInvalidTimes() {
+    // Times which are NaN, infinite or out of range can't be converted to
+    // a time and are formatted as an empty string.
+
+    using TDoubleStrPr = std::pair<double, std::string>;
+    for (const auto& value : {TDoubleStrPr{1359331200.0, "1359331200"},
+                              TDoubleStrPr{-9.223372036854775808e18, "-9223372036854775808"},
+                              TDoubleStrPr{9.223372036854775808e18, ""},
+                              TDoubleStrPr{1e300, ""},
+                              TDoubleStrPr{std::numeric_limits<double>::infinity(), ""},
+                              TDoubleStrPr{-std::numeric_limits<double>::infinity(), ""},
+                              TDoubleStrPr{std::numeric_limits<double>::quiet_NaN(), ""}}) {
+        ml::core_t::TTime time;
+        CPPUNIT_ASSERT_EQUAL(value.second.empty() == false,
+                             ml::api::CInputParser::numericValueToTime(value.first, time));
+        std::string str("unchanged");
+        ml::api::CInputParser::formatNumericValue(ml::api::CInputParser::E_Time,
+                                                  value.first, str);
+        CPPUNIT_ASSERT_EQUAL(value.second, str);
+    }
+
+    // The largest 64 bit time rounds up to 2^63 when converted to a double.
+    std::string input;
+    appendLength(1 | 0x80000000, input);
+    appendString("time", input);
+    appendString("t", input);
+    appendLength(1, input);
+    appendLittleEndian(std::numeric_limits<int64_t>::max(), input);
+
+    // Input must be binary otherwise Windows will stop at CTRL+Z
+    std::istringstream stringInput(input, std::ios::in | std::ios::binary);
+    ml::api::CLengthEncodedInputParser stringParser(stringInput);
+
+    std::vector<ml::api::CInputParser::TStrVec> values;
+    CPPUNIT_ASSERT(stringParser.readStreamIntoVecs(
+        [](const ml::api::CInputParser::TStrVec&) { return true; },
+        [&values](const ml::api::CInputParser::TStrVec& strings) {
+            values.push_back(strings);
+            return true;
+        }));
+
+    CPPUNIT_ASSERT_EQUAL(std::string("[[]]"), ml::core::CContainerPrinter::print(values));
+}
@@ -11,8 +11,11 @@
 class CLengthEncodedInputParserTest : public CppUnit::TestFixture {
 public:
     void testCsvEquivalence();
+    void testReadStreamIntoVecs();
     void testThroughput();
     void testCorruptStreamDetection();
+    void testTypedFields();
+    void testInvalidTimes();
 
     static CppUnit::Test* suite();
 };
@@ -6,30 +6,121 @@
 #include "COutputChainerTest.h"
 
 #include <core/CJsonOutputStreamWrapper.h>
+#include <core/COsFileFuncs.h>
+#include <core/CStatistics.h>
+#include <core/CStringUtils.h>
 
 #include <model/CLimits.h>
 
 #include <api/CAnomalyJob.h>
 #include <api/CFieldConfig.h>
+#include <api/CFieldDataTyper.h>
 #include <api/CJsonOutputWriter.h>
 #include <api/CLineifiedJsonInputParser.h>
+#include <api/CModelSnapshotJsonWriter.h>
 #include <api/COutputChainer.h>
+#include <api/CSingleStreamDataAdder.h>
 
 #include <test/CTestTmpDir.h>
 
 #include "CMockDataProcessor.h"
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 
 CppUnit::Test* COutputChainerTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("COutputChainerTest");
 
     suiteOfTests->addTest(new CppUnit::TestCaller<COutputChainerTest>(
         "COutputChainerTest::testChaining", &COutputChainerTest::testChaining));
+    suiteOfTests->addTest(new CppUnit::TestCaller<COutputChainerTest>(
+        "COutputChainerTest::testChainingFieldValues",
+        &COutputChainerTest::testChainingFieldValues));
 
     return suiteOfTests;
 }
 
+namespace {
+
+//! Run the input through a typer -> chainer -> detector chain, passing the
+//! records either as maps or positionally, and return the persisted state.
+std::string chainAndPersist(bool positional) {
+    static const ml::core_t::TTime BUCKET_SIZE(3600);
+    static const std::string JOB_ID("job");
+
+    // The global statistics are persisted with the job state, so both runs
+    // must start from the same counts
+    for (int i = 0; i < ml::stat_t::E_LastEnumStat; ++i) {
+        ml::core::CStatistics::stat(i).set(0);
+    }
+
+    std::ifstream inputStrm("testfiles/big_ascending.txt");
+    CPPUNIT_ASSERT(inputStrm.is_open());
+
+    std::ofstream outputStrm(ml::core::COsFileFuncs::NULL_FILENAME);
+    CPPUNIT_ASSERT(outputStrm.is_open());
+
+    ml::model::CLimits limits;
+    ml::api::CFieldConfig fieldConfig;
+    CPPUNIT_ASSERT(fieldConfig.initFromFile("testfiles/new_mlfields_partition.conf"));
+
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE);
+
+    std::string snapshotId;
+    std::ostringstream* stateStream(nullptr);
+    ml::api::CSingleStreamDataAdder::TOStreamP stateStreamPtr(
+        stateStream = new std::ostringstream());
+    {
+        ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+        ml::api::CJsonOutputWriter outputWriter(JOB_ID, wrappedOutputStream);
+
+        ml::api::CAnomalyJob job(
+            JOB_ID, limits, fieldConfig, modelConfig, wrappedOutputStream,
+            [&snapshotId](const ml::api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+                snapshotId = report.s_SnapshotId;
+            },
+            nullptr, -1, "time", "%d/%b/%Y:%T %z");
+
+        ml::api::COutputChainer outputChainer(job);
+
+        ml::api::CFieldDataTyper typer(JOB_ID, fieldConfig, limits, outputChainer, outputWriter);
+
+        ml::api::CLineifiedJsonInputParser parser(inputStrm);
+
+        if (positional) {
+            CPPUNIT_ASSERT(parser.readStreamIntoVecs(
+                [&typer](const ml::api::CInputParser::TStrVec& fieldNames) {
+                    return typer.handleFieldNames(fieldNames);
+                },
+                [&typer](const ml::api::CInputParser::TStrVec& fieldValues) {
+                    return typer.handleFieldValues(fieldValues);
+                }));
+        } else {
+            CPPUNIT_ASSERT(parser.readStream(
+                boost::bind(&ml::api::CDataProcessor::handleRecord, &typer, _1)));
+        }
+        CPPUNIT_ASSERT(job.numRecordsHandled() > 0);
+
+        ml::api::CSingleStreamDataAdder dataAdder(stateStreamPtr);
+        CPPUNIT_ASSERT(typer.persistState(dataAdder));
+    }
+
+    std::string state = stateStream->str();
+
+    // The snapshot ID depends on the time of the persist, so replace the
+    // first occurrence of it (which is in the bulk metadata)
+    CPPUNIT_ASSERT_EQUAL(size_t(1), ml::core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+
+    // Replace the zero byte separators so the expected/actual strings don't get
+    // truncated by CppUnit if the test fails
+    std::replace(state.begin(), state.end(), '\0', ',');
+
+    return state;
+}
+}
+
 void COutputChainerTest::testChaining() {
     static const ml::core_t::TTime BUCKET_SIZE(3600);
 
@@ -91,3 +182,12 @@ void COutputChainerTest::testChaining() {
     reReadStrm.close();
     CPPUNIT_ASSERT_EQUAL(0, ::remove(outputFileName.c_str()));
 }
+
+void COutputChainerTest::testChainingFieldValues() {
+    // Passing the records through the chain positionally should produce
+    // exactly the same models as passing them as maps
+    std::string mapState = chainAndPersist(false);
+    std::string positionalState = chainAndPersist(true);
+
+    CPPUNIT_ASSERT_EQUAL(mapState, positionalState);
+}
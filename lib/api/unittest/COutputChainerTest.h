@@ -11,6 +11,7 @@
 class COutputChainerTest : public CppUnit::TestFixture {
 public:
     void testChaining();
+    void testChainingFieldValues();
 
     static CppUnit::Test* suite();
 };
@@ -17,15 +17,20 @@
 
 #include <boost/bind.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 CppUnit::Test* CResultNormalizerTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CResultNormalizerTest");
 
     suiteOfTests->addTest(new CppUnit::TestCaller<CResultNormalizerTest>(
         "CResultNormalizerTest::testInitNormalizer", &CResultNormalizerTest::testInitNormalizer));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResultNormalizerTest>(
+        "CResultNormalizerTest::testParallel", &CResultNormalizerTest::testParallel));
 
     return suiteOfTests;
 }
@@ -192,3 +197,72 @@ void CResultNormalizerTest::testInitNormalizer() {
                              std::string(doc["normalized_score"].GetString()));
     }
 }
+
+void CResultNormalizerTest::testParallel() {
+    // Check that normalizing with several threads gives the same output as
+    // normalizing with one thread, including for a partial final batch.
+
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(3600);
+
+    std::string header;
+    std::string rows;
+    {
+        std::ifstream inputStrm("testfiles/normalizerInput.csv");
+        CPPUNIT_ASSERT(std::getline(inputStrm, header));
+        std::string row;
+        while (std::getline(inputStrm, row)) {
+            rows += row;
+            rows += '\n';
+        }
+    }
+    std::string input(header + '\n');
+    for (std::size_t i = 0; i < 100; ++i) {
+        input += rows;
+    }
+
+    // The order of the fields in each document depends on the map of input
+    // fields, so compare the fields' values
+    using TStrVec = std::vector<std::string>;
+    auto fieldValues = [](const std::string& results) {
+        TStrVec values;
+        std::stringstream ss(results);
+        std::string docString;
+        while (std::getline(ss, docString)) {
+            rapidjson::Document doc;
+            doc.Parse<rapidjson::kParseDefaultFlags>(docString.c_str());
+            std::string docValues;
+            for (const auto& name :
+                 {"level", "partition_field_name", "person_field_name", "function_name",
+                  "value_field_name", "probability", "normalized_score"}) {
+                docValues += doc[name].GetString();
+                docValues += '|';
+            }
+            values.push_back(docValues);
+        }
+        return values;
+    };
+
+    TStrVec expected;
+    for (std::size_t numberThreads : {1, 2, 4}) {
+        ml::api::CLineifiedJsonOutputWriter outputWriter;
+
+        ml::api::CResultNormalizer normalizer(modelConfig, outputWriter, numberThreads);
+        CPPUNIT_ASSERT(normalizer.initNormalizer("testfiles/quantilesState.json"));
+
+        std::istringstream inputStrm(input);
+        ml::api::CCsvInputParser inputParser(inputStrm, ml::api::CCsvInputParser::COMMA);
+        CPPUNIT_ASSERT(inputParser.readStream(
+            boost::bind(&ml::api::CResultNormalizer::handleRecord, &normalizer, _1)));
+        CPPUNIT_ASSERT(normalizer.finalise());
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t{3800}, normalizer.numberRecords());
+
+        TStrVec results(fieldValues(outputWriter.internalString()));
+        CPPUNIT_ASSERT_EQUAL(std::size_t{3800}, results.size());
+        if (numberThreads == 1) {
+            expected = results;
+        } else {
+            CPPUNIT_ASSERT(expected == results);
+        }
+    }
+}
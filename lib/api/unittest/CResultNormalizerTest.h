@@ -11,6 +11,7 @@
 class CResultNormalizerTest : public CppUnit::TestFixture {
 public:
     void testInitNormalizer();
+    void testParallel();
 
     static CppUnit::Test* suite();
 };
@@ -101,15 +101,29 @@ struct SLookup {
 } // namespace
 
 bool CStringStoreTest::nameExists(const std::string& string) {
-    model::CStringStore::TStoredStringPtrUSet names =
-        model::CStringStore::names().m_Strings;
-    return names.find(string, ::SLookup(), ::SLookup()) != names.end();
+    return this->exists(model::CStringStore::names(), string);
 }
 
 bool CStringStoreTest::influencerExists(const std::string& string) {
-    model::CStringStore::TStoredStringPtrUSet names =
-        model::CStringStore::influencers().m_Strings;
-    return names.find(string, ::SLookup(), ::SLookup()) != names.end();
+    return this->exists(model::CStringStore::influencers(), string);
+}
+
+bool CStringStoreTest::exists(const model::CStringStore& store, const std::string& string) {
+    for (const auto& shard : store.m_Shards) {
+        if (shard->s_Strings.find(string, ::SLookup(), ::SLookup()) !=
+            shard->s_Strings.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string CStringStoreTest::print(const model::CStringStore& store) {
+    std::string result;
+    for (const auto& shard : store.m_Shards) {
+        result += core::CContainerPrinter::print(shard->s_Strings);
+    }
+    return result;
 }
 
 void CStringStoreTest::testPersonStringPruning() {
@@ -142,9 +156,9 @@ void CStringStoreTest::testPersonStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         LOG_TRACE(<< "Setting up job");
 
@@ -164,7 +178,7 @@ void CStringStoreTest::testPersonStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // "", "count", "max", "notes", "composer", "instrument", "Elgar", "Holst", "Delius", "flute", "tuba"
         CPPUNIT_ASSERT(this->nameExists("count"));
@@ -194,9 +208,9 @@ void CStringStoreTest::testPersonStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -209,7 +223,7 @@ void CStringStoreTest::testPersonStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // "", "count", "max", "notes", "composer", "instrument", "Elgar", "Holst", "Delius", "flute", "tuba"
         CPPUNIT_ASSERT(this->nameExists("count"));
@@ -236,9 +250,9 @@ void CStringStoreTest::testPersonStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -251,7 +265,7 @@ void CStringStoreTest::testPersonStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // While the 3 composers from the second partition should have been culled in the prune,
         // their names still exist in the first partition, so will still be in the string store
@@ -279,9 +293,9 @@ void CStringStoreTest::testPersonStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -294,7 +308,7 @@ void CStringStoreTest::testPersonStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // One composer should have been culled!
         CPPUNIT_ASSERT(this->nameExists("count"));
@@ -340,9 +354,9 @@ void CStringStoreTest::testAttributeStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         LOG_TRACE(<< "Setting up job");
         std::ostringstream outputStrm;
@@ -360,10 +374,10 @@ void CStringStoreTest::testAttributeStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // "", "count", "distinct_count", "notes", "composer", "instrument", "Elgar", "Holst", "Delius", "flute", "tuba"
-        LOG_DEBUG(<< core::CContainerPrinter::print(model::CStringStore::names().m_Strings));
+        LOG_DEBUG(<< this->print(model::CStringStore::names()));
         CPPUNIT_ASSERT(this->nameExists("count"));
         CPPUNIT_ASSERT(this->nameExists("distinct_count"));
         CPPUNIT_ASSERT(this->nameExists("notes"));
@@ -389,9 +403,9 @@ void CStringStoreTest::testAttributeStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -405,7 +419,7 @@ void CStringStoreTest::testAttributeStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // "", "count", "distinct_count", "notes", "composer", "instrument", "Elgar", "Holst", "Delius", "flute", "tuba"
         CPPUNIT_ASSERT(this->nameExists("count"));
@@ -432,9 +446,9 @@ void CStringStoreTest::testAttributeStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -448,7 +462,7 @@ void CStringStoreTest::testAttributeStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // While the 3 composers from the second partition should have been culled in the prune,
         // their names still exist in the first partition, so will still be in the string store
@@ -476,9 +490,9 @@ void CStringStoreTest::testAttributeStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         std::ostringstream outputStrm;
         ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
@@ -492,7 +506,7 @@ void CStringStoreTest::testAttributeStringPruning() {
 
         // No influencers in this configuration
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
 
         // One composer should have been culled!
         CPPUNIT_ASSERT(this->nameExists("count"));
@@ -536,9 +550,9 @@ void CStringStoreTest::testInfluencerStringPruning() {
         model::CStringStore::names().clearEverythingTestOnly();
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::influencers().m_Strings.size());
+                             model::CStringStore::influencers().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             model::CStringStore::names().m_Strings.size());
+                             model::CStringStore::names().size());
 
         LOG_TRACE(<< "Setting up job");
         std::ostringstream outputStrm;
@@ -551,9 +565,8 @@ void CStringStoreTest::testInfluencerStringPruning() {
         LOG_DEBUG(<< "Running 20 buckets");
         time = playData(time, BUCKET_SPAN, 20, 7, 5, 99, job);
 
-        LOG_TRACE(<< core::CContainerPrinter::print(model::CStringStore::names().m_Strings));
-        LOG_TRACE(<< core::CContainerPrinter::print(
-                      model::CStringStore::influencers().m_Strings));
+        LOG_TRACE(<< this->print(model::CStringStore::names()));
+        LOG_TRACE(<< this->print(model::CStringStore::influencers()));
 
         CPPUNIT_ASSERT(this->influencerExists("Delius"));
         CPPUNIT_ASSERT(this->influencerExists("Walton"));
@@ -10,6 +10,14 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <string>
+
+namespace ml {
+namespace model {
+class CStringStore;
+}
+}
+
 class CStringStoreTest : public CppUnit::TestFixture {
 public:
     void testPersonStringPruning();
@@ -21,6 +29,8 @@ public:
 private:
     bool nameExists(const std::string& string);
     bool influencerExists(const std::string& string);
+    bool exists(const ml::model::CStringStore& store, const std::string& string);
+    std::string print(const ml::model::CStringStore& store);
 };
 
 #endif // INCLUDED_CStringStoreTest_h
@@ -63,6 +63,8 @@ CppUnit::Test* CTokenListDataTyperTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListDataTyperTest>(
         "CTokenListDataTyperTest::testPreTokenisedPerformance",
         &CTokenListDataTyperTest::testPreTokenisedPerformance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListDataTyperTest>(
+        "CTokenListDataTyperTest::testManyTypes", &CTokenListDataTyperTest::testManyTypes));
 
     return suiteOfTests;
 }
@@ -472,3 +474,74 @@ void CTokenListDataTyperTest::testPreTokenisedPerformance() {
 
     CPPUNIT_ASSERT(preTokenisationTime <= inlineTokenisationTime);
 }
+
+void CTokenListDataTyperTest::testManyTypes() {
+    // Check that the candidate search is unaffected by restoring the typer
+    // and that categorisation is still fast when there are many types.
+
+    static const size_t NUM_WORDS(1000);
+    static const size_t NUM_MESSAGES(5000);
+
+    auto word = [](size_t i) {
+        std::string result("zq");
+        do {
+            result += static_cast<char>('a' + i % 26);
+            i /= 26;
+        } while (i > 0);
+        return result;
+    };
+    auto message = [&word](size_t i, size_t variant) {
+        return word(i % NUM_WORDS) + ' ' + word((7 * i + 1) % NUM_WORDS) + ' ' +
+               word((13 * i + 2) % NUM_WORDS) + ' ' +
+               word((31 * i + 3 + variant) % NUM_WORDS) + ' ' +
+               word((61 * i + 5) % NUM_WORDS) + ' ' + word(i / NUM_WORDS);
+    };
+
+    TTokenListDataTyperKeepsFields origTyper(NO_REVERSE_SEARCH_CREATOR, 0.7, "whatever");
+    for (size_t i = 0; i < NUM_MESSAGES; ++i) {
+        origTyper.computeType(false, message(i, 0), 100);
+    }
+
+    std::string origXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        origTyper.acceptPersistInserter(inserter);
+        inserter.toXml(origXml);
+    }
+
+    TTokenListDataTyperKeepsFields restoredTyper(NO_REVERSE_SEARCH_CREATOR, 0.7, "whatever");
+    {
+        ml::core::CRapidXmlParser parser;
+        CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+        ml::core::CRapidXmlStateRestoreTraverser traverser(parser);
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(boost::bind(
+            &TTokenListDataTyperKeepsFields::acceptRestoreTraverser, &restoredTyper, _1)));
+    }
+
+    ml::core::CStopWatch stopWatch(true);
+    int maxType(0);
+    for (size_t i = 0; i < NUM_MESSAGES; ++i) {
+        for (size_t variant = 0; variant < 2; ++variant) {
+            int type(origTyper.computeType(false, message(i, variant), 100));
+            CPPUNIT_ASSERT_EQUAL(type, restoredTyper.computeType(false, message(i, variant), 100));
+            maxType = std::max(maxType, type);
+        }
+    }
+    LOG_DEBUG(<< "Typing " << 2 * NUM_MESSAGES << " messages with " << maxType
+              << " types took " << stopWatch.stop() << "ms");
+    CPPUNIT_ASSERT(maxType > 1000);
+
+    std::string origTyperXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        origTyper.acceptPersistInserter(inserter);
+        inserter.toXml(origTyperXml);
+    }
+    std::string restoredTyperXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        restoredTyper.acceptPersistInserter(inserter);
+        inserter.toXml(restoredTyperXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(origTyperXml, restoredTyperXml);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CBinaryStatePersistInserter.h>
+
+#include <cstring>
+
+namespace ml {
+namespace core {
+
+const std::size_t CBinaryStatePersistInserter::TYPE_BITS(2);
+const std::uint64_t CBinaryStatePersistInserter::TYPE_MASK(0x3);
+const std::string CBinaryStatePersistInserter::MAGIC("\x00mlb\x01", 5);
+
+CBinaryStatePersistInserter::CBinaryStatePersistInserter(std::ostream& outputStream)
+    : m_OutputStream(outputStream) {
+    m_OutputStream.write(MAGIC.data(), MAGIC.size());
+}
+
+CBinaryStatePersistInserter::~CBinaryStatePersistInserter() {
+    this->writeVarint(E_LevelEnd);
+    m_OutputStream.flush();
+}
+
+void CBinaryStatePersistInserter::insertValue(const std::string& name,
+                                              const std::string& value) {
+    this->writeHeader(name, E_String);
+    this->writeString(value);
+}
+
+void CBinaryStatePersistInserter::insertValue(const std::string& name,
+                                              double value,
+                                              CIEEE754::EPrecision precision) {
+    // Round exactly as the string representation would, but don't lose
+    // any more precision than was asked for.
+    if (precision != CIEEE754::E_DoublePrecision) {
+        value = CIEEE754::round(value, precision);
+    }
+
+    std::uint64_t bits;
+    static_assert(sizeof(double) == sizeof(std::uint64_t),
+                  "Unexpected size of double");
+    // Use memcpy() rather than union to adhere to strict aliasing rules
+    ::memcpy(&bits, &value, sizeof(double));
+
+    // Always write little endian so the format is platform independent.
+    char bytes[sizeof(double)];
+    for (std::size_t i = 0; i < sizeof(double); ++i) {
+        bytes[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+    }
+
+    this->writeHeader(name, E_Double);
+    m_OutputStream.write(bytes, sizeof(bytes));
+}
+
+void CBinaryStatePersistInserter::flush() {
+    m_OutputStream.flush();
+}
+
+void CBinaryStatePersistInserter::newLevel(const std::string& name) {
+    this->writeHeader(name, E_LevelStart);
+}
+
+void CBinaryStatePersistInserter::endLevel() {
+    this->writeVarint(E_LevelEnd);
+}
+
+void CBinaryStatePersistInserter::writeHeader(const std::string& name, EElementType type) {
+    auto i = m_NameIds.find(name);
+    if (i != m_NameIds.end()) {
+        this->writeVarint((i->second << TYPE_BITS) | type);
+        return;
+    }
+
+    // Identifiers start at one: zero means the name follows.
+    std::uint64_t id{m_NameIds.size() + 1};
+    m_NameIds.emplace(name, id);
+    this->writeVarint(type);
+    this->writeString(name);
+}
+
+void CBinaryStatePersistInserter::writeVarint(std::uint64_t value) {
+    char bytes[10];
+    std::size_t n{0};
+    do {
+        char byte = static_cast<char>(value & 0x7F);
+        value >>= 7;
+        bytes[n++] = value > 0 ? static_cast<char>(byte | 0x80) : byte;
+    } while (value > 0);
+    m_OutputStream.write(bytes, n);
+}
+
+void CBinaryStatePersistInserter::writeString(const std::string& value) {
+    this->writeVarint(value.size());
+    m_OutputStream.write(value.data(), value.size());
+}
+}
+}
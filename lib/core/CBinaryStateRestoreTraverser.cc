@@ -0,0 +1,369 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CBinaryStateRestoreTraverser.h>
+
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CLogger.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace ml {
+namespace core {
+
+namespace {
+const std::string EMPTY_STRING;
+const std::size_t NO_NAME{std::numeric_limits<std::size_t>::max()};
+//! Strings longer than this are checked against the remaining input
+//! and read this many bytes at a time.
+const std::size_t STRING_CHUNK_SIZE{65536};
+}
+
+CBinaryStateRestoreTraverser::CBinaryStateRestoreTraverser(std::istream& inputStream)
+    : m_InputStream(inputStream), m_Started(false), m_Name(NO_NAME),
+      m_Type(CBinaryStatePersistInserter::E_LevelEnd), m_SubLevelRead(false),
+      m_Double(0.0), m_FormatValue(false), m_Document(nullptr) {
+}
+
+bool CBinaryStateRestoreTraverser::isBinaryState(std::istream& inputStream) {
+    return inputStream.peek() == std::istream::traits_type::to_int_type(
+                                     CBinaryStatePersistInserter::MAGIC[0]);
+}
+
+bool CBinaryStateRestoreTraverser::readDocument(std::istream& inputStream,
+                                                std::string& document) {
+    document.clear();
+
+    CBinaryStateRestoreTraverser traverser(inputStream);
+    traverser.m_Document = &document;
+    if (traverser.start() == false) {
+        return false;
+    }
+
+    // Skip every element at the root level, which reads up to and including
+    // the end of the document.
+    while (traverser.m_Type != CBinaryStatePersistInserter::E_LevelEnd) {
+        if (traverser.m_Type == CBinaryStatePersistInserter::E_LevelStart &&
+            traverser.skipSubLevel() == false) {
+            return false;
+        }
+        if (traverser.readElement() == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::isEof() const {
+    return m_InputStream.peek() == std::istream::traits_type::eof();
+}
+
+bool CBinaryStateRestoreTraverser::next() {
+    if (!m_Started) {
+        if (this->start() == false) {
+            return false;
+        }
+    }
+
+    if (m_Type == CBinaryStatePersistInserter::E_LevelEnd) {
+        return false;
+    }
+
+    // If we get here then we're skipping over a nested level that's not of
+    // interest
+    if (m_Type == CBinaryStatePersistInserter::E_LevelStart && !m_SubLevelRead) {
+        if (this->skipSubLevel() == false) {
+            return false;
+        }
+    }
+
+    return this->readElement() && m_Type != CBinaryStatePersistInserter::E_LevelEnd;
+}
+
+bool CBinaryStateRestoreTraverser::hasSubLevel() const {
+    if (!m_Started) {
+        if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+            return false;
+        }
+    }
+
+    return m_Type == CBinaryStatePersistInserter::E_LevelStart && !m_SubLevelRead;
+}
+
+const std::string& CBinaryStateRestoreTraverser::name() const {
+    if (!m_Started) {
+        if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+            return EMPTY_STRING;
+        }
+    }
+
+    return m_Name < m_Names.size() ? m_Names[m_Name] : EMPTY_STRING;
+}
+
+const std::string& CBinaryStateRestoreTraverser::value() const {
+    if (!m_Started) {
+        if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+            return EMPTY_STRING;
+        }
+    }
+
+    if (m_FormatValue) {
+        // 17 significant figures are enough to recover any double exactly.
+        char buf[4 * sizeof(double)];
+        int n{::snprintf(buf, sizeof(buf), "%.17g", m_Double)};
+        m_Value.assign(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+        m_FormatValue = false;
+    }
+
+    return m_Value;
+}
+
+bool CBinaryStateRestoreTraverser::doubleValue(double& result) const {
+    if (!m_Started) {
+        if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+            return false;
+        }
+    }
+
+    if (m_Type == CBinaryStatePersistInserter::E_Double) {
+        result = m_Double;
+        return true;
+    }
+
+    return this->CStateRestoreTraverser::doubleValue(result);
+}
+
+bool CBinaryStateRestoreTraverser::descend() {
+    if (!m_Started) {
+        if (this->start() == false) {
+            return false;
+        }
+    }
+
+    if (m_Type != CBinaryStatePersistInserter::E_LevelStart || m_SubLevelRead) {
+        return false;
+    }
+
+    // If the sub-level is empty this leaves the traverser on its end marker
+    // so that the sub-level traverser will find nothing and then ascend.
+    std::size_t level{m_Name};
+    if (this->readElement() == false) {
+        return false;
+    }
+    m_Levels.push_back(level);
+
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::ascend() {
+    // If we're trying to ascend above the root level then something has gone
+    // wrong
+    if (m_Levels.empty()) {
+        LOG_ERROR(<< "Inconsistency - trying to ascend above root");
+        return false;
+    }
+
+    while (m_Type != CBinaryStatePersistInserter::E_LevelEnd) {
+        if (m_Type == CBinaryStatePersistInserter::E_LevelStart && !m_SubLevelRead) {
+            if (this->skipSubLevel() == false) {
+                return false;
+            }
+        }
+        if (this->readElement() == false) {
+            return false;
+        }
+    }
+
+    m_Name = m_Levels.back();
+    m_Levels.pop_back();
+    m_Type = CBinaryStatePersistInserter::E_LevelStart;
+    m_SubLevelRead = true;
+
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::start() {
+    m_Started = true;
+
+    std::string magic(CBinaryStatePersistInserter::MAGIC.size(), '\0');
+    if (this->read(&magic[0], magic.size()) == false ||
+        magic != CBinaryStatePersistInserter::MAGIC) {
+        return this->fail("Input is not binary state");
+    }
+
+    return this->readElement();
+}
+
+bool CBinaryStateRestoreTraverser::readElement() {
+    m_Value.clear();
+    m_FormatValue = false;
+    m_SubLevelRead = false;
+
+    std::uint64_t header;
+    if (this->readVarint(header) == false) {
+        return this->fail("Failed to read element header");
+    }
+
+    m_Type = static_cast<int>(header & CBinaryStatePersistInserter::TYPE_MASK);
+    std::uint64_t id{header >> CBinaryStatePersistInserter::TYPE_BITS};
+
+    if (m_Type == CBinaryStatePersistInserter::E_LevelEnd) {
+        m_Name = NO_NAME;
+        return true;
+    }
+
+    if (id == 0) {
+        std::string name;
+        if (this->readString(name) == false) {
+            return this->fail("Failed to read element name");
+        }
+        m_Names.push_back(std::move(name));
+        m_Name = m_Names.size() - 1;
+    } else if (id <= m_Names.size()) {
+        m_Name = static_cast<std::size_t>(id - 1);
+    } else {
+        return this->fail("Undefined name identifier " + std::to_string(id));
+    }
+
+    switch (m_Type) {
+    case CBinaryStatePersistInserter::E_String:
+        if (this->readString(m_Value) == false) {
+            return this->fail("Failed to read value of '" + m_Names[m_Name] + "'");
+        }
+        break;
+    case CBinaryStatePersistInserter::E_Double: {
+        unsigned char bytes[sizeof(double)];
+        if (this->read(reinterpret_cast<char*>(bytes), sizeof(bytes)) == false) {
+            return this->fail("Failed to read value of '" + m_Names[m_Name] + "'");
+        }
+        std::uint64_t bits{0};
+        for (std::size_t i = 0; i < sizeof(double); ++i) {
+            bits |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+        }
+        // Use memcpy() rather than union to adhere to strict aliasing rules
+        ::memcpy(&m_Double, &bits, sizeof(double));
+        m_FormatValue = true;
+        break;
+    }
+    case CBinaryStatePersistInserter::E_LevelStart:
+        break;
+    }
+
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::skipSubLevel() {
+    for (std::size_t depth = 1; depth > 0; /**/) {
+        if (this->readElement() == false) {
+            return false;
+        }
+        if (m_Type == CBinaryStatePersistInserter::E_LevelStart) {
+            ++depth;
+        } else if (m_Type == CBinaryStatePersistInserter::E_LevelEnd) {
+            --depth;
+        }
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::readVarint(std::uint64_t& value) {
+    value = 0;
+    for (std::size_t shift = 0; shift < 64; shift += 7) {
+        int byte{m_InputStream.get()};
+        if (byte == std::istream::traits_type::eof()) {
+            return false;
+        }
+        if (m_Document != nullptr) {
+            m_Document->push_back(static_cast<char>(byte));
+        }
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CBinaryStateRestoreTraverser::readString(std::string& value) {
+    std::uint64_t length;
+    if (this->readVarint(length) == false) {
+        return false;
+    }
+    if (length <= STRING_CHUNK_SIZE) {
+        value.resize(static_cast<std::size_t>(length));
+        return length == 0 || this->read(&value[0], value.size());
+    }
+
+    // A corrupt length mustn't make us allocate more memory than the input
+    // could possibly fill.
+    std::uint64_t remaining;
+    if (this->remainingInput(remaining) && length > remaining) {
+        LOG_ERROR(<< "String length " << length << " exceeds remaining input " << remaining);
+        return false;
+    }
+
+    value.clear();
+    while (value.size() < length) {
+        std::size_t size{value.size()};
+        std::size_t chunk{static_cast<std::size_t>(
+            std::min(length - size, static_cast<std::uint64_t>(STRING_CHUNK_SIZE)))};
+        value.resize(size + chunk);
+        if (this->read(&value[size], chunk) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::remainingInput(std::uint64_t& remaining) {
+    // Go to the stream buffer directly since std::istream::tellg() sets
+    // badbit if the buffer throws, as the decompressing buffers do because
+    // they can't seek.
+    std::streambuf* buffer{m_InputStream.rdbuf()};
+    if (buffer == nullptr) {
+        return false;
+    }
+    try {
+        std::streampos pos{buffer->pubseekoff(0, std::ios_base::cur, std::ios_base::in)};
+        if (pos == std::streampos(-1)) {
+            return false;
+        }
+        std::streampos end{buffer->pubseekoff(0, std::ios_base::end, std::ios_base::in)};
+        if (buffer->pubseekpos(pos, std::ios_base::in) != pos || end == std::streampos(-1)) {
+            return false;
+        }
+        remaining = static_cast<std::uint64_t>(end - pos);
+    } catch (const std::exception& e) {
+        LOG_TRACE(<< "Can't seek input: " << e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::read(char* buffer, std::size_t n) {
+    if (!m_InputStream.read(buffer, static_cast<std::streamsize>(n))) {
+        return false;
+    }
+    if (m_Document != nullptr) {
+        m_Document->append(buffer, n);
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::fail(const std::string& what) {
+    LOG_ERROR(<< what);
+    m_Type = CBinaryStatePersistInserter::E_LevelEnd;
+    m_Name = NO_NAME;
+    m_Value.clear();
+    m_FormatValue = false;
+    this->setBadState();
+    return false;
+}
+}
+}
@@ -97,6 +97,46 @@ void CCompressUtils::reset() {
     m_State = E_Unused;
 }
 
+bool CCompressUtils::deflateBytes(const void* input,
+                                  std::size_t length,
+                                  TByteVec& result,
+                                  int level) {
+    uLongf size(::compressBound(static_cast<uLong>(length)));
+    result.resize(size);
+    int ret(::compress2(result.data(), &size, static_cast<const Bytef*>(input),
+                        static_cast<uLong>(length), level));
+    if (ret != Z_OK) {
+        LOG_ERROR(<< "Error deflating bytes: " << ::zError(ret));
+        result.clear();
+        return false;
+    }
+    result.resize(size);
+    result.shrink_to_fit();
+    return true;
+}
+
+bool CCompressUtils::inflateBytes(const TByteVec& input, void* result, std::size_t length) {
+    return inflateBytes(input.data(), input.size(), result, length);
+}
+
+bool CCompressUtils::inflateBytes(const void* input,
+                                  std::size_t inputLength,
+                                  void* result,
+                                  std::size_t length) {
+    uLongf size(static_cast<uLongf>(length));
+    int ret(::uncompress(static_cast<Bytef*>(result), &size,
+                         static_cast<const Bytef*>(input), static_cast<uLong>(inputLength)));
+    if (ret != Z_OK) {
+        LOG_ERROR(<< "Error inflating bytes: " << ::zError(ret));
+        return false;
+    }
+    if (size != length) {
+        LOG_ERROR(<< "Inflated " << size << " bytes, expected " << length);
+        return false;
+    }
+    return true;
+}
+
 bool CCompressUtils::doCompress(bool finish, const std::string& str) {
     if (str.empty() && m_State == E_Compressing && !finish) {
         return true;
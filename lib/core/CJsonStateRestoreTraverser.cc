@@ -195,7 +195,13 @@ bool CJsonStateRestoreTraverser::parseNext(bool remember) {
         return false;
     }
 
-    const int parseFlags = rapidjson::kParseDefaultFlags;
+    // Stop at the end of the root value, so that further documents can
+    // follow it in the stream
+    if (m_Reader.IterativeParseComplete()) {
+        return false;
+    }
+
+    const int parseFlags = rapidjson::kParseDefaultFlags | rapidjson::kParseStopWhenDoneFlag;
     m_Handler.s_RememberValue = remember;
 
     return m_Reader.IterativeParseNext<parseFlags>(m_ReadStream, m_Handler);
@@ -266,7 +272,10 @@ bool CJsonStateRestoreTraverser::advance() {
 
     while (keepGoing) {
         if (this->parseNext(true) == false) {
-            if (!this->isEof()) {
+            // Reaching the end of the root value isn't an error
+            bool isEndOfDocument{m_Reader.IterativeParseComplete() &&
+                                 !m_Reader.HasParseError()};
+            if (!this->isEof() && !isEndOfDocument) {
                 this->logError();
             }
             return false;
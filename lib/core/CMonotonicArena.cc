@@ -0,0 +1,110 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CMonotonicArena.h>
+
+#include <core/CLogger.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace core {
+namespace {
+//! The arena installed for the current thread.
+thread_local CMonotonicArena* currentArena{nullptr};
+}
+
+CMonotonicArena::SStatistics::SStatistics()
+    : s_Allocations{0}, s_Bytes{0}, s_HeapAllocations{0},
+      s_TotalAllocations{0}, s_TotalHeapAllocations{0} {
+}
+
+const std::size_t CMonotonicArena::DEFAULT_BLOCK_SIZE{65536};
+const std::size_t CMonotonicArena::DEFAULT_MAX_RETAINED_SIZE{16777216};
+
+CMonotonicArena::CMonotonicArena(std::size_t blockSize, std::size_t maxRetainedSize)
+    : m_BlockSize{std::max(blockSize, std::size_t(256))},
+      m_MaxRetainedSize{std::max(maxRetainedSize, m_BlockSize)}, m_Next{nullptr},
+      m_End{nullptr} {
+}
+
+void* CMonotonicArena::allocate(std::size_t size, std::size_t alignment) {
+    ++m_Statistics.s_Allocations;
+    ++m_Statistics.s_TotalAllocations;
+    m_Statistics.s_Bytes += size;
+
+    std::size_t space{static_cast<std::size_t>(m_End - m_Next)};
+    void* result{m_Next};
+    if (m_Next == nullptr || std::align(alignment, size, result, space) == nullptr) {
+        this->newBlock(size + alignment);
+        space = static_cast<std::size_t>(m_End - m_Next);
+        result = m_Next;
+        std::align(alignment, size, result, space);
+    }
+    m_Next = static_cast<char*>(result) + size;
+    return result;
+}
+
+void CMonotonicArena::reset() {
+    std::size_t size{0};
+    for (const auto& block : m_Blocks) {
+        size += block.second;
+    }
+    if (m_Blocks.size() > 1 || size > m_MaxRetainedSize) {
+        // Replace the blocks by one which is large enough for all the
+        // allocations so far if they're repeated, up to the maximum we
+        // retain.
+        m_Blocks.clear();
+        m_Blocks.shrink_to_fit();
+        this->newBlock(std::min(size, m_MaxRetainedSize));
+    }
+    if (m_Blocks.size() > 0) {
+        m_Next = m_Blocks.back().first.get();
+        m_End = m_Next + m_Blocks.back().second;
+    }
+    m_Statistics.s_Allocations = 0;
+    m_Statistics.s_Bytes = 0;
+    m_Statistics.s_HeapAllocations = 0;
+}
+
+const CMonotonicArena::SStatistics& CMonotonicArena::statistics() const {
+    return m_Statistics;
+}
+
+std::size_t CMonotonicArena::memoryUsage() const {
+    std::size_t result{m_Blocks.capacity() * sizeof(TCharArrayPtrSizePr)};
+    for (const auto& block : m_Blocks) {
+        result += block.second;
+    }
+    return result;
+}
+
+CMonotonicArena* CMonotonicArena::current() {
+    return currentArena;
+}
+
+void CMonotonicArena::newBlock(std::size_t size) {
+    size = std::max(size, m_BlockSize);
+    LOG_TRACE(<< "Allocating block of " << size << " bytes");
+    m_Blocks.emplace_back(TCharArrayPtr(new char[size]), size);
+    m_Next = m_Blocks.back().first.get();
+    m_End = m_Next + size;
+    ++m_Statistics.s_HeapAllocations;
+    ++m_Statistics.s_TotalHeapAllocations;
+}
+
+CScopedMonotonicArena::CScopedMonotonicArena(CMonotonicArena& arena, bool reset)
+    : m_Arena{arena}, m_Previous{currentArena}, m_Reset{reset} {
+    currentArena = &m_Arena;
+}
+
+CScopedMonotonicArena::~CScopedMonotonicArena() {
+    currentArena = m_Previous;
+    if (m_Reset) {
+        m_Arena.reset();
+    }
+}
+}
+}
@@ -0,0 +1,374 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CRingBufferStreamBuf.h>
+
+#include <core/CLogger.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <string.h>
+
+namespace ml {
+namespace core {
+
+namespace {
+//! The number of times to check for the other side before sleeping.
+const std::size_t SPIN_COUNT(64);
+}
+
+// Initialise statics
+const std::size_t CRingBufferStreamBuf::DEFAULT_BLOCK_CAPACITY(65536);
+const std::size_t CRingBufferStreamBuf::DEFAULT_DEPTH(4);
+const std::size_t CRingBufferStreamBuf::PUTBACK_CAPACITY;
+const std::size_t CRingBufferStreamBuf::CACHE_LINE_SIZE;
+
+CRingBufferStreamBuf::CRingBufferStreamBuf(std::size_t blockCapacity, std::size_t depth)
+    : m_BlockCapacity(std::max(blockCapacity, std::size_t(1))),
+      m_Depth(std::max(depth, std::size_t(2))),
+      m_Blocks(new char[m_Depth * (PUTBACK_CAPACITY + m_BlockCapacity)]),
+      m_BlockSizes(m_Depth, 0), m_WriteBytesPublished(0), m_HaveReadBlock(false),
+      m_PutbackSavedSize(0), m_ReadBytesAcquired(0), m_ReaderWaiting(false),
+      m_WriterWaiting(false), m_Eof(false), m_FatalError(false) {
+    if (depth < 2) {
+        LOG_WARN(<< "Ring buffer depth " << depth << " is too small - using 2");
+    }
+
+    // Initialise write pointers to indicate the first block is empty
+    char* begin(this->blockData(0));
+    this->setp(begin, begin + m_BlockCapacity);
+
+    // Initialise read pointers to indicate a buffer that has underflowed
+    this->setg(begin, begin, begin);
+}
+
+void CRingBufferStreamBuf::signalEndOfFile() {
+    if (m_Eof.load()) {
+        return;
+    }
+
+    // Unlike CDualThreadStreamBuf publishing never has to wait because the
+    // writer already owns the block
+    if (m_FatalError.load() == false && this->pptr() > this->pbase()) {
+        this->publishWriteBlock();
+    }
+
+    // It's important that the end-of-file flag isn't set until the last
+    // block has been published, because otherwise the reader may stop
+    // before it has read it
+    m_Eof.store(true);
+    this->wake(m_ReaderWaiting);
+}
+
+bool CRingBufferStreamBuf::endOfFile() const {
+    return m_Eof.load();
+}
+
+void CRingBufferStreamBuf::signalFatalError() {
+    // Chuck away the rest of the current read block
+    this->setg(this->gptr(), this->gptr(), this->gptr());
+
+    // Set a flag to indicate that future reads and writes should fail
+    m_FatalError.store(true);
+
+    this->wake(m_ReaderWaiting);
+    this->wake(m_WriterWaiting);
+}
+
+bool CRingBufferStreamBuf::hasFatalError() const {
+    return m_FatalError.load();
+}
+
+std::streamsize CRingBufferStreamBuf::showmanyc() {
+    // Unread contents of the read block
+    std::streamsize ret(this->egptr() - this->gptr());
+
+    if (m_FatalError.load() == false) {
+        // Add on the contents of the published blocks still to be read
+        std::size_t published(m_Published.s_Value.load());
+        std::size_t next(m_Released.s_Value.load() + (m_HaveReadBlock ? 1 : 0));
+        for (std::size_t i = next; i < published; ++i) {
+            ret += static_cast<std::streamsize>(m_BlockSizes[i % m_Depth]);
+        }
+    }
+
+    return ret;
+}
+
+int CRingBufferStreamBuf::sync() {
+    if (m_FatalError.load()) {
+        return -1;
+    }
+
+    // If there is no data in the write block then sync is a no-op
+    if (this->pptr() > this->pbase()) {
+        this->publishWriteBlock();
+    }
+
+    return 0;
+}
+
+std::streamsize CRingBufferStreamBuf::xsgetn(char* s, std::streamsize n) {
+    // Expected to be called only in the reader thread (see Doxygen comments)
+
+    std::streamsize ret(0);
+    if (m_FatalError.load()) {
+        return ret;
+    }
+
+    while (ret < n) {
+        std::streamsize bufLen(this->egptr() - this->gptr());
+        if (bufLen > 0) {
+            std::streamsize copyLen(std::min(bufLen, n - ret));
+            ::memcpy(s, this->gptr(), static_cast<size_t>(copyLen));
+            s += copyLen;
+            ret += copyLen;
+            this->gbump(static_cast<int>(copyLen));
+        } else {
+            // uflow() will call underflow(), so may block
+            int c(this->uflow());
+            if (c == traits_type::eof()) {
+                break;
+            }
+            *s = char(c);
+            ++s;
+            ++ret;
+        }
+    }
+
+    return ret;
+}
+
+int CRingBufferStreamBuf::underflow() {
+    if (this->gptr() < this->egptr()) {
+        return traits_type::to_int_type(*this->gptr());
+    }
+
+    if (m_FatalError.load() || this->acquireReadBlock() == false) {
+        return traits_type::eof();
+    }
+
+    return traits_type::to_int_type(*this->gptr());
+}
+
+int CRingBufferStreamBuf::pbackfail(int c) {
+    if (c == traits_type::eof()) {
+        // As for CDualThreadStreamBuf we can't support retaining the
+        // character at the ungotten position, so don't reliably support
+        // sungetc() at the start of the putback space
+        LOG_ERROR(<< "pbackfail() not implemented for argument EOF");
+        return c;
+    }
+
+    if (this->gptr() == this->eback()) {
+        // We can extend the get area back into the putback space in front
+        // of the current block
+        char* limit(this->eback());
+        if (m_HaveReadBlock) {
+            limit = this->blockData(m_Released.s_Value.load() % m_Depth) - PUTBACK_CAPACITY;
+        }
+        if (this->eback() == limit) {
+            LOG_ERROR(<< "Can't put back more than " << PUTBACK_CAPACITY << " characters");
+            return traits_type::eof();
+        }
+        this->setg(this->eback() - 1, this->eback(), this->egptr());
+    }
+
+    // The character being put back does not match the one at the putback
+    // position, but we own the read block so can overwrite it
+    this->gbump(-1);
+    *this->gptr() = char(c);
+
+    return c;
+}
+
+std::streamsize CRingBufferStreamBuf::xsputn(const char* s, std::streamsize n) {
+    // Expected to be called only in the writer thread (see Doxygen comments)
+
+    std::streamsize ret(0);
+
+    if (m_Eof.load()) {
+        LOG_ERROR(<< "Inconsistency - trying to add data to stream buffer after end-of-file");
+        return ret;
+    }
+
+    if (m_FatalError.load()) {
+        return ret;
+    }
+
+    while (ret < n) {
+        std::streamsize bufAvail(this->epptr() - this->pptr());
+        if (bufAvail > 0) {
+            std::streamsize copyLen(std::min(bufAvail, n - ret));
+            ::memcpy(this->pptr(), s, static_cast<size_t>(copyLen));
+            s += copyLen;
+            ret += copyLen;
+            this->pbump(static_cast<int>(copyLen));
+        } else {
+            // overflow() may block if the reader is depth blocks behind
+            int c(this->overflow(traits_type::to_int_type(*s)));
+            if (c == traits_type::eof()) {
+                break;
+            }
+            ++s;
+            ++ret;
+        }
+    }
+
+    return ret;
+}
+
+int CRingBufferStreamBuf::overflow(int c) {
+    if (m_Eof.load() || m_FatalError.load()) {
+        return traits_type::eof();
+    }
+
+    if (c == traits_type::eof()) {
+        // For compatibility with CDualThreadStreamBuf this indicates the end
+        // of the data
+        this->signalEndOfFile();
+        return traits_type::not_eof(c);
+    }
+
+    if (this->pptr() > this->pbase()) {
+        this->publishWriteBlock();
+    }
+    if (this->acquireWriteBlock() == false) {
+        return traits_type::eof();
+    }
+
+    *this->pptr() = char(c);
+    this->pbump(1);
+
+    return c;
+}
+
+std::streampos CRingBufferStreamBuf::seekoff(std::streamoff off,
+                                             std::ios_base::seekdir way,
+                                             std::ios_base::openmode which) {
+    std::streampos pos(static_cast<std::streampos>(-1));
+
+    if (off != 0) {
+        LOG_ERROR(<< "Seeking not supported on stream buffer");
+        return pos;
+    }
+
+    if (way != std::ios_base::cur) {
+        LOG_ERROR(<< "Seeking from beginning or end not supported on stream buffer");
+        return pos;
+    }
+
+    if (which == std::ios_base::in) {
+        pos = static_cast<std::streampos>(m_ReadBytesAcquired);
+        pos -= (this->egptr() - this->gptr());
+    } else if (which == std::ios_base::out) {
+        pos = static_cast<std::streampos>(m_WriteBytesPublished);
+        pos += (this->pptr() - this->pbase());
+    } else {
+        LOG_ERROR(<< "Unexpected mode for seek on stream buffer: " << which);
+    }
+
+    return pos;
+}
+
+char* CRingBufferStreamBuf::blockData(std::size_t block) const {
+    return m_Blocks.get() + block * (PUTBACK_CAPACITY + m_BlockCapacity) + PUTBACK_CAPACITY;
+}
+
+void CRingBufferStreamBuf::publishWriteBlock() {
+    std::size_t published(m_Published.s_Value.load());
+    std::size_t size(static_cast<std::size_t>(this->pptr() - this->pbase()));
+
+    m_BlockSizes[published % m_Depth] = size;
+    m_WriteBytesPublished += size;
+
+    // There's nowhere to write until the next block is acquired
+    this->setp(this->pptr(), this->pptr());
+
+    m_Published.s_Value.store(published + 1);
+    this->wake(m_ReaderWaiting);
+}
+
+bool CRingBufferStreamBuf::acquireWriteBlock() {
+    // The next block to write is free once the reader has released the
+    // block that was written depth blocks ago
+    std::size_t published(m_Published.s_Value.load());
+    this->wait(m_WriterWaiting, [this, published] {
+        return m_FatalError.load() || published - m_Released.s_Value.load() < m_Depth;
+    });
+    if (m_FatalError.load()) {
+        return false;
+    }
+
+    char* begin(this->blockData(published % m_Depth));
+    this->setp(begin, begin + m_BlockCapacity);
+
+    return true;
+}
+
+bool CRingBufferStreamBuf::acquireReadBlock() {
+    if (m_HaveReadBlock) {
+        // Save the end of the block so it can be put back after the block
+        // has been handed back to the writer
+        m_PutbackSavedSize = std::min(
+            static_cast<std::size_t>(this->egptr() - this->eback()), PUTBACK_CAPACITY);
+        ::memcpy(m_PutbackSaved, this->egptr() - m_PutbackSavedSize, m_PutbackSavedSize);
+        char* end(m_PutbackSaved + m_PutbackSavedSize);
+        this->setg(m_PutbackSaved, end, end);
+
+        m_HaveReadBlock = false;
+        m_Released.s_Value.store(m_Released.s_Value.load() + 1);
+        this->wake(m_WriterWaiting);
+    }
+
+    std::size_t released(m_Released.s_Value.load());
+    this->wait(m_ReaderWaiting, [this, released] {
+        return m_FatalError.load() || m_Eof.load() || m_Published.s_Value.load() > released;
+    });
+
+    // Blocks published before end-of-file was signalled must still be read
+    if (m_FatalError.load() || m_Published.s_Value.load() == released) {
+        return false;
+    }
+
+    std::size_t block(released % m_Depth);
+    char* begin(this->blockData(block));
+    char* end(begin + m_BlockSizes[block]);
+    ::memcpy(begin - m_PutbackSavedSize, m_PutbackSaved, m_PutbackSavedSize);
+    this->setg(begin - m_PutbackSavedSize, begin, end);
+
+    m_ReadBytesAcquired += m_BlockSizes[block];
+    m_HaveReadBlock = true;
+
+    return true;
+}
+
+template<typename PREDICATE>
+void CRingBufferStreamBuf::wait(std::atomic_bool& waiting, PREDICATE ready) {
+    for (std::size_t i = 0; i < SPIN_COUNT; ++i) {
+        if (ready()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    // The waker changes the counters before it checks the flag and we set
+    // the flag before we check the counters.  All these operations are
+    // sequentially consistent so at least one side sees the other's change.
+    std::unique_lock<std::mutex> lock(m_WaitMutex);
+    waiting.store(true);
+    m_WaitCondition.wait(lock, ready);
+    waiting.store(false);
+}
+
+void CRingBufferStreamBuf::wake(const std::atomic_bool& waiting) {
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(m_WaitMutex);
+        m_WaitCondition.notify_all();
+    }
+}
+}
+}
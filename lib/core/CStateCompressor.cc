@@ -5,11 +5,15 @@
  */
 #include <core/CStateCompressor.h>
 
+#include <core/CBase64Filter.h>
 #include <core/CCompressOStream.h>
 #include <core/CLogger.h>
 
+#include <boost/iostreams/filter/gzip.hpp>
 #include <boost/ref.hpp>
 
+#include <sstream>
+
 namespace ml {
 namespace core {
 
@@ -17,8 +21,7 @@ const std::string CStateCompressor::COMPRESSED_ATTRIBUTE("compressed");
 const std::string CStateCompressor::END_OF_STREAM_ATTRIBUTE("eos");
 
 CStateCompressor::CStateCompressor(CDataAdder& compressedAdder)
-    : m_FilterSink(compressedAdder),
-      m_OutStream(std::make_shared<CCompressOStream>(boost::ref(m_FilterSink))) {
+    : m_FilterSink(compressedAdder) {
     LOG_TRACE(<< "New compressor");
 }
 
@@ -26,13 +29,49 @@ CDataAdder::TOStreamP CStateCompressor::addStreamed(const std::string& index,
                                                     const std::string& baseId) {
     LOG_TRACE(<< "StateCompressor asking for index " << index);
 
+    // The compression thread writes the end of the gzip stream when it's
+    // closed, so it mustn't be started unless it's going to be used
+    if (m_OutStream == nullptr) {
+        m_OutStream = std::make_shared<CCompressOStream>(boost::ref(m_FilterSink));
+    }
+
     m_FilterSink.index(index, baseId);
     return m_OutStream;
 }
 
+CDataAdder::TOStreamP CStateCompressor::addCompressedStreamed(const std::string& index,
+                                                              const std::string& baseId) {
+    LOG_TRACE(<< "StateCompressor asking for index " << index << " for compressed data");
+
+    if (m_OutFilter == nullptr) {
+        m_OutFilter = std::make_shared<TFilteredOutput>();
+        m_OutFilter->push(CBase64Encoder());
+        m_OutFilter->push(boost::ref(m_FilterSink));
+    }
+
+    m_FilterSink.index(index, baseId);
+    return m_OutFilter;
+}
+
+std::string CStateCompressor::compressShard(const std::string& state) {
+    std::ostringstream compressed;
+    {
+        TFilteredOutput filter;
+        filter.push(boost::iostreams::gzip_compressor());
+        filter.push(compressed);
+        filter.write(state.data(), static_cast<std::streamsize>(state.size()));
+    }
+    return compressed.str();
+}
+
 bool CStateCompressor::streamComplete(CDataAdder::TOStreamP& /*strm*/, bool /*force*/) {
     LOG_TRACE(<< "Stream Complete");
-    m_OutStream->close();
+    if (m_OutStream != nullptr) {
+        m_OutStream->close();
+    }
+    if (m_OutFilter != nullptr) {
+        boost::iostreams::close(*m_OutFilter);
+    }
     return m_FilterSink.allWritesSuccessful();
 }
 
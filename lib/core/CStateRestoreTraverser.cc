@@ -16,6 +16,10 @@ CStateRestoreTraverser::CStateRestoreTraverser() : m_BadState(false) {
 CStateRestoreTraverser::~CStateRestoreTraverser() {
 }
 
+bool CStateRestoreTraverser::doubleValue(double& result) const {
+    return CStringUtils::stringToType(this->value(), result);
+}
+
 bool CStateRestoreTraverser::haveBadState() const {
     return m_BadState;
 }
@@ -0,0 +1,102 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CStaticThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace ml {
+namespace core {
+
+CStaticThreadPool::CStaticThreadPool(std::size_t size) : m_Done(false) {
+    m_Threads.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        m_Threads.emplace_back([this] { this->worker(); });
+    }
+}
+
+CStaticThreadPool::~CStaticThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Done = true;
+    }
+    m_TaskAdded.notify_all();
+
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+std::size_t CStaticThreadPool::size() const {
+    return m_Threads.size();
+}
+
+void CStaticThreadPool::schedule(TTask task) {
+    if (m_Threads.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_TaskAdded.notify_one();
+}
+
+void CStaticThreadPool::parallelForEach(std::size_t n, const TSizeFunc& f) {
+    if (n == 0) {
+        return;
+    }
+
+    // The calling thread does its share of the work so there's no point
+    // waking more threads than there are remaining indices.
+    std::size_t helpers{std::min(m_Threads.size(), n - 1)};
+
+    std::atomic_size_t next{0};
+    auto loop = [&next, n, &f] {
+        for (std::size_t i = next++; i < n; i = next++) {
+            f(i);
+        }
+    };
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+    std::size_t running{helpers};
+
+    for (std::size_t i = 0; i < helpers; ++i) {
+        this->schedule([&] {
+            loop();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--running == 0) {
+                done.notify_one();
+            }
+        });
+    }
+
+    loop();
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&running] { return running == 0; });
+}
+
+void CStaticThreadPool::worker() {
+    for (;;) {
+        TTask task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_TaskAdded.wait(lock, [this] { return m_Done || !m_Tasks.empty(); });
+            if (m_Tasks.empty()) {
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        task();
+    }
+}
+}
+}
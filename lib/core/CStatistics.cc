@@ -146,6 +146,30 @@ std::ostream& operator<<(std::ostream& o, const CStatistics& /*stats*/) {
                  "Number of times a partial memory usage estimate has been carried out",
                  CStatistics::stat(stat_t::E_NumberMemoryUsageEstimates).value());
 
+    addStringInt(writer, "E_NumberMemoryUsageVerifications",
+                 "Number of times a model's refreshed memory usage has been verified by a full walk",
+                 CStatistics::stat(stat_t::E_NumberMemoryUsageVerifications).value());
+
+    addStringInt(writer, "E_MemoryUsageDrift",
+                 "Difference between the refreshed and walked memory usage of the model verified most recently",
+                 CStatistics::stat(stat_t::E_MemoryUsageDrift).value());
+
+    addStringInt(writer, "E_NumberResultsArenaAllocations",
+                 "Number of allocations served by the arena for bucket results",
+                 CStatistics::stat(stat_t::E_NumberResultsArenaAllocations).value());
+
+    addStringInt(writer, "E_NumberResultsArenaHeapAllocations",
+                 "Number of blocks the arena for bucket results obtained from the heap",
+                 CStatistics::stat(stat_t::E_NumberResultsArenaHeapAllocations).value());
+
+    addStringInt(writer, "E_NumberProbabilityCacheHits",
+                 "Number of probabilities which were found in a cache",
+                 CStatistics::stat(stat_t::E_NumberProbabilityCacheHits).value());
+
+    addStringInt(writer, "E_NumberProbabilityCacheMisses",
+                 "Number of probabilities which could be cached but weren't found",
+                 CStatistics::stat(stat_t::E_NumberProbabilityCacheMisses).value());
+
     addStringInt(writer, "E_NumberRecordsNoTimeField",
                  "Number of records that didn't contain a Time field",
                  CStatistics::stat(stat_t::E_NumberRecordsNoTimeField).value());
@@ -17,6 +17,10 @@ namespace core {
 CStoredStringPtr::CStoredStringPtr() noexcept : m_String{} {
 }
 
+CStoredStringPtr::CStoredStringPtr(TStrCPtr&& str) noexcept
+    : m_String{std::move(str)} {
+}
+
 CStoredStringPtr::CStoredStringPtr(const std::string& str)
     : m_String{std::make_shared<const std::string>(str)} {
 }
@@ -89,6 +93,14 @@ CStoredStringPtr CStoredStringPtr::makeStoredString(std::string&& str) {
     return CStoredStringPtr(std::move(str));
 }
 
+CStoredStringPtr::CWeak::CWeak(const CStoredStringPtr& ptr) noexcept
+    : m_String{ptr.m_String} {
+}
+
+CStoredStringPtr CStoredStringPtr::CWeak::lock() const noexcept {
+    return CStoredStringPtr{m_String.lock()};
+}
+
 std::size_t hash_value(const CStoredStringPtr& ptr) {
     return boost::hash_value(ptr.m_String);
 }
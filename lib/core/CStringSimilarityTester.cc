@@ -10,7 +10,51 @@
 namespace ml {
 namespace core {
 
+namespace {
+using TUInt64 = std::uint64_t;
+
+const size_t WORD_SIZE(64);
+const TUInt64 ALL_ONES(~TUInt64(0));
+const TUInt64 HIGH_BIT(TUInt64(1) << (WORD_SIZE - 1));
+
+//! Count the bits set in \p x.
+size_t popCount(TUInt64 x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<size_t>((x * 0x0101010101010101ULL) >> 56);
+}
+
+//! Get a lower bound for the smallest value in the rows of a block of a
+//! column of the distance matrix given the value \p score in its last row
+//! and its positive vertical differences \p pv.
+size_t blockMinimum(size_t score, TUInt64 pv) {
+    size_t increases(popCount(pv));
+    return score > increases ? score - increases : 0;
+}
+
+//! Update a block of the vertical differences of a column of the distance
+//! matrix for the next symbol of the text, given the matches \p eq of the
+//! symbol with the block of the pattern and the horizontal difference \p hin
+//! in the row above the block.  Returns the horizontal differences of the
+//! rows of the block in \p ph and \p mh before they're shifted.
+void advanceBlock(TUInt64 eq, int hin, TUInt64& pv, TUInt64& mv, TUInt64& ph, TUInt64& mh) {
+    TUInt64 hinNegative(hin < 0 ? 1 : 0);
+    TUInt64 hinPositive(hin > 0 ? 1 : 0);
+    TUInt64 xv(eq | mv);
+    eq |= hinNegative;
+    TUInt64 xh((((eq & pv) + pv) ^ pv) | eq);
+    ph = mv | ~(xh | pv);
+    mh = pv & xh;
+    TUInt64 phShifted((ph << 1) | hinPositive);
+    TUInt64 mhShifted((mh << 1) | hinNegative);
+    pv = mhShifted | ~(xv | phShifted);
+    mv = phShifted & xv;
+}
+}
+
 const int CStringSimilarityTester::MINUS_INFINITE_INT(std::numeric_limits<int>::min());
+const size_t CStringSimilarityTester::NO_MAXIMUM_DISTANCE(std::numeric_limits<size_t>::max());
 
 CStringSimilarityTester::CStringSimilarityTester() : m_Compressor(true) {
 }
@@ -131,5 +175,188 @@ int** CStringSimilarityTester::setupBerghelRoachMatrix(int maxDist,
 
     return matrix;
 }
+size_t CStringSimilarityTester::symbolEditDistance(const TSizeVec& first,
+                                                   const TSizeVec& second,
+                                                   size_t maxDistance) const {
+    // The pattern, which is represented by bit vectors, is the shorter
+    // sequence
+    const TSizeVec& pattern(first.size() <= second.size() ? first : second);
+    const TSizeVec& text(first.size() <= second.size() ? second : first);
+    size_t patternLen(pattern.size());
+    size_t textLen(text.size());
+
+    // Rule out boundary cases
+    if (patternLen == 0) {
+        return textLen;
+    }
+    if (textLen - patternLen > maxDistance) {
+        return textLen - patternLen;
+    }
+
+    size_t blocks((patternLen + WORD_SIZE - 1) / WORD_SIZE);
+    this->setupMatchMasks(pattern, blocks);
+
+    if (blocks == 1) {
+        return this->singleWordEditDistance(patternLen, text, maxDistance);
+    }
+    return this->blockedEditDistance(patternLen, text, maxDistance);
+}
+
+size_t CStringSimilarityTester::singleWordEditDistance(size_t patternLen,
+                                                       const TSizeVec& text,
+                                                       size_t maxDistance) const {
+    // This is the algorithm in figure 3 of Hyyro's paper, using the
+    // formulation for the distance between whole sequences rather than
+    // approximate matching, i.e. the top row of the distance matrix is
+    // 0, 1, 2, ...  Bit i of the vertical differences is D[i+1][j] - D[i][j]
+    // for column j of the matrix.
+
+    size_t textLen(text.size());
+    TUInt64 lastBit(TUInt64(1) << (patternLen - 1));
+    TUInt64 mask(patternLen == WORD_SIZE ? ALL_ONES : (lastBit << 1) - 1);
+
+    TUInt64 pv(ALL_ONES);
+    TUInt64 mv(0);
+    TUInt64 ph(0);
+    TUInt64 mh(0);
+    size_t score(patternLen);
+
+    for (size_t j = 0; j < textLen; ++j) {
+        TUInt64 eq(m_MatchMasks[this->matchMasksRow(text[j])]);
+        advanceBlock(eq, 1, pv, mv, ph, mh);
+        if ((ph & lastBit) != 0) {
+            ++score;
+        } else if ((mh & lastBit) != 0) {
+            --score;
+        }
+
+        // Every path through the matrix passes through this column and
+        // the distance never decreases along the optimal path, so the
+        // smallest value in the column is a lower bound for the distance.
+        // Also the remaining text symbols can reduce the score by at most
+        // one each.
+        size_t columnMin(blockMinimum(score, pv & mask));
+        size_t remaining(textLen - j - 1);
+        size_t lowerBound(std::max(columnMin, score > remaining ? score - remaining : 0));
+        if (lowerBound > maxDistance) {
+            return lowerBound;
+        }
+    }
+
+    return score;
+}
+
+size_t CStringSimilarityTester::blockedEditDistance(size_t patternLen,
+                                                    const TSizeVec& text,
+                                                    size_t maxDistance) const {
+    // This splits the pattern into blocks of 64 symbols and carries the
+    // horizontal differences between them, as described in section 4 of
+    // Hyyro's paper.  Furthermore, D[i][j] >= i - j, so if we're not
+    // interested in distances greater than the maximum, only the blocks
+    // containing rows i <= j + maxDistance need be calculated for column
+    // j, as in Ukkonen's cut-off heuristic.  A block which becomes active
+    // is initialised assuming the vertical differences are all +1, which
+    // over estimates the values in the block's rows.  However, these are
+    // all greater than the maximum distance, so this doesn't affect the
+    // values of any cells less than or equal to the maximum.
+
+    size_t textLen(text.size());
+    size_t blocks((patternLen + WORD_SIZE - 1) / WORD_SIZE);
+    size_t lastBlockSize(patternLen - (blocks - 1) * WORD_SIZE);
+    TUInt64 lastBit(TUInt64(1) << (lastBlockSize - 1));
+    TUInt64 lastMask(lastBlockSize == WORD_SIZE ? ALL_ONES : (lastBit << 1) - 1);
+
+    auto lastActiveBlock = [&](size_t j) {
+        return maxDistance >= patternLen
+                   ? blocks - 1
+                   : std::min(blocks - 1, (j + maxDistance) / WORD_SIZE);
+    };
+    auto blockSize = [&](size_t block) {
+        return block + 1 == blocks ? lastBlockSize : WORD_SIZE;
+    };
+
+    m_PositiveDifferences.assign(blocks, ALL_ONES);
+    m_NegativeDifferences.assign(blocks, 0);
+    m_BlockScores.resize(blocks);
+    size_t active(lastActiveBlock(0));
+    for (size_t block = 0; block <= active; ++block) {
+        m_BlockScores[block] = block * WORD_SIZE + blockSize(block);
+    }
+
+    for (size_t j = 0; j < textLen; ++j) {
+        for (size_t next = lastActiveBlock(j + 1); active < next; /**/) {
+            ++active;
+            m_PositiveDifferences[active] = ALL_ONES;
+            m_NegativeDifferences[active] = 0;
+            m_BlockScores[active] = m_BlockScores[active - 1] + blockSize(active);
+        }
+
+        const TUInt64* eqs(&m_MatchMasks[this->matchMasksRow(text[j]) * blocks]);
+        size_t columnMin(NO_MAXIMUM_DISTANCE);
+        int hin(1);
+        for (size_t block = 0; block <= active; ++block) {
+            TUInt64& pv(m_PositiveDifferences[block]);
+            TUInt64& mv(m_NegativeDifferences[block]);
+            TUInt64 ph(0);
+            TUInt64 mh(0);
+            advanceBlock(eqs[block], hin, pv, mv, ph, mh);
+            TUInt64 bit(block + 1 == blocks ? lastBit : HIGH_BIT);
+            TUInt64 mask(block + 1 == blocks ? lastMask : ALL_ONES);
+            hin = (ph & bit) != 0 ? 1 : ((mh & bit) != 0 ? -1 : 0);
+            if (hin > 0) {
+                ++m_BlockScores[block];
+            } else if (hin < 0) {
+                --m_BlockScores[block];
+            }
+            columnMin = std::min(columnMin, blockMinimum(m_BlockScores[block], pv & mask));
+        }
+
+        // The cells in inactive blocks are all greater than the maximum
+        // distance, so the smallest value in the active blocks is a lower
+        // bound for the distance if it exceeds the maximum
+        if (columnMin > maxDistance) {
+            return columnMin;
+        }
+    }
+
+    return m_BlockScores[blocks - 1];
+}
+
+void CStringSimilarityTester::setupMatchMasks(const TSizeVec& pattern, size_t blocks) const {
+    // The table is at most half full so probe sequences are short
+    size_t capacity(4);
+    while (capacity < 2 * pattern.size()) {
+        capacity *= 2;
+    }
+    m_SymbolTable.assign(capacity, TSizeSizePr(0, 0));
+
+    m_MatchMasks.assign(blocks, 0);
+    size_t rows(1);
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        TSizeSizePr& entry(m_SymbolTable[this->symbolSlot(pattern[i])]);
+        if (entry.second == 0) {
+            entry.first = pattern[i];
+            entry.second = rows++;
+            m_MatchMasks.resize(rows * blocks, 0);
+        }
+        m_MatchMasks[entry.second * blocks + i / WORD_SIZE] |= TUInt64(1) << (i % WORD_SIZE);
+    }
+}
+
+size_t CStringSimilarityTester::symbolSlot(size_t symbol) const {
+    size_t mask(m_SymbolTable.size() - 1);
+    TUInt64 hash(static_cast<TUInt64>(symbol) * 0x9e3779b97f4a7c15ULL);
+    for (size_t slot = static_cast<size_t>(hash ^ (hash >> 32)) & mask; /**/;
+         slot = (slot + 1) & mask) {
+        const TSizeSizePr& entry(m_SymbolTable[slot]);
+        if (entry.second == 0 || entry.first == symbol) {
+            return slot;
+        }
+    }
+}
+
+size_t CStringSimilarityTester::matchMasksRow(size_t symbol) const {
+    return m_SymbolTable[this->symbolSlot(symbol)].second;
+}
 }
 }
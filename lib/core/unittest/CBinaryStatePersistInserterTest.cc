@@ -0,0 +1,180 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CBinaryStatePersistInserterTest.h"
+
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
+#include <core/CJsonStatePersistInserter.h>
+#include <core/CLogger.h>
+#include <core/CStringUtils.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+CppUnit::Test* CBinaryStatePersistInserterTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CBinaryStatePersistInserterTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStatePersistInserterTest>(
+        "CBinaryStatePersistInserterTest::testPersist",
+        &CBinaryStatePersistInserterTest::testPersist));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStatePersistInserterTest>(
+        "CBinaryStatePersistInserterTest::testPrecision",
+        &CBinaryStatePersistInserterTest::testPrecision));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStatePersistInserterTest>(
+        "CBinaryStatePersistInserterTest::testSize",
+        &CBinaryStatePersistInserterTest::testSize));
+
+    return suiteOfTests;
+}
+
+namespace {
+
+using TDoubleVec = std::vector<double>;
+
+void insert2ndLevel(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertValue("level2A", 3.14, ml::core::CIEEE754::E_SinglePrecision);
+    inserter.insertValue("level2B", 'z');
+}
+
+void insertModel(ml::core::CStatePersistInserter& inserter) {
+    for (std::size_t i = 0; i < 20; ++i) {
+        inserter.insertValue("mean", 1.0 / static_cast<double>(i + 3),
+                             ml::core::CIEEE754::E_DoublePrecision);
+        inserter.insertValue("variance", 100.0 * std::sqrt(static_cast<double>(i + 1)),
+                             ml::core::CIEEE754::E_DoublePrecision);
+        inserter.insertValue("count", i);
+    }
+}
+
+void insertModels(ml::core::CStatePersistInserter& inserter) {
+    for (std::size_t i = 0; i < 50; ++i) {
+        inserter.insertLevel("model", &insertModel);
+    }
+}
+}
+
+void CBinaryStatePersistInserterTest::testPersist() {
+    std::ostringstream strm;
+
+    {
+        ml::core::CBinaryStatePersistInserter inserter(strm);
+
+        inserter.insertValue("level1A", "a");
+        inserter.insertValue("level1B", 25);
+        inserter.insertLevel("level1C", &insert2ndLevel);
+        inserter.insertValue("level1A", "b");
+    }
+
+    std::string state(strm.str());
+
+    double level2A{ml::core::CIEEE754::round(3.14, ml::core::CIEEE754::E_SinglePrecision)};
+    char level2ABytes[sizeof(double)];
+    std::uint64_t bits;
+    ::memcpy(&bits, &level2A, sizeof(double));
+    for (std::size_t i = 0; i < sizeof(double); ++i) {
+        level2ABytes[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+    }
+
+    std::string expected{ml::core::CBinaryStatePersistInserter::MAGIC};
+    expected += std::string("\x00\x07level1A\x01"
+                            "a",
+                            11);
+    expected += std::string("\x00\x07level1B\x02"
+                            "25",
+                            12);
+    expected += std::string("\x02\x07level1C", 9);
+    expected += std::string("\x01\x07level2A", 9);
+    expected += std::string(level2ABytes, sizeof(level2ABytes));
+    expected += std::string("\x00\x07level2B\x01"
+                            "z",
+                            11);
+    expected += std::string("\x03", 1);
+    // The second use of a name only writes its identifier.
+    expected += std::string("\x04\x01"
+                            "b",
+                            3);
+    expected += std::string("\x03", 1);
+
+    CPPUNIT_ASSERT_EQUAL(expected.size(), state.size());
+    CPPUNIT_ASSERT(expected == state);
+}
+
+void CBinaryStatePersistInserterTest::testPrecision() {
+    // Check that we store the value rounded to the requested precision and
+    // that this is no less accurate than the string representation.
+
+    TDoubleVec values{0.0,
+                      -0.0,
+                      1.0,
+                      3.14,
+                      -2.0 / 3.0,
+                      1e-300,
+                      0.49999998,
+                      1.2345678901234567e12,
+                      -9.87654321e-7,
+                      std::numeric_limits<double>::min(),
+                      std::numeric_limits<double>::max(),
+                      -std::numeric_limits<double>::max()};
+
+    for (auto precision : {ml::core::CIEEE754::E_HalfPrecision,
+                           ml::core::CIEEE754::E_SinglePrecision,
+                           ml::core::CIEEE754::E_DoublePrecision}) {
+        std::ostringstream strm;
+        {
+            ml::core::CBinaryStatePersistInserter inserter(strm);
+            for (auto value : values) {
+                inserter.insertValue("value", value, precision);
+            }
+        }
+
+        std::istringstream istrm(strm.str());
+        ml::core::CBinaryStateRestoreTraverser traverser(istrm);
+        std::size_t i{0};
+        do {
+            CPPUNIT_ASSERT_EQUAL(std::string("value"), traverser.name());
+            CPPUNIT_ASSERT(!traverser.hasSubLevel());
+            double restored;
+            CPPUNIT_ASSERT(ml::core::CStringUtils::stringToType(traverser.value(), restored));
+
+            double expected{precision == ml::core::CIEEE754::E_DoublePrecision
+                                ? values[i]
+                                : ml::core::CIEEE754::round(values[i], precision)};
+            CPPUNIT_ASSERT_EQUAL(expected, restored);
+            CPPUNIT_ASSERT_EQUAL(std::signbit(expected), std::signbit(restored));
+            CPPUNIT_ASSERT_EQUAL(
+                ml::core::CStringUtils::typeToStringPrecise(values[i], precision),
+                ml::core::CStringUtils::typeToStringPrecise(restored, precision));
+            ++i;
+        } while (traverser.next());
+
+        CPPUNIT_ASSERT_EQUAL(values.size(), i);
+        CPPUNIT_ASSERT(traverser.isEof());
+    }
+}
+
+void CBinaryStatePersistInserterTest::testSize() {
+    // Check that the binary representation of number heavy state is
+    // much more compact than the JSON representation.
+
+    std::ostringstream json;
+    {
+        ml::core::CJsonStatePersistInserter inserter(json);
+        inserter.insertLevel("models", &insertModels);
+    }
+    std::ostringstream binary;
+    {
+        ml::core::CBinaryStatePersistInserter inserter(binary);
+        inserter.insertLevel("models", &insertModels);
+    }
+
+    LOG_DEBUG(<< "JSON size = " << json.str().size()
+              << ", binary size = " << binary.str().size());
+    CPPUNIT_ASSERT(2 * binary.str().size() < json.str().size());
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CBinaryStatePersistInserterTest_h
+#define INCLUDED_CBinaryStatePersistInserterTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CBinaryStatePersistInserterTest : public CppUnit::TestFixture {
+public:
+    void testPersist();
+    void testPrecision();
+    void testSize();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CBinaryStatePersistInserterTest_h
@@ -0,0 +1,490 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CBinaryStateRestoreTraverserTest.h"
+
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
+#include <core/CJsonStatePersistInserter.h>
+#include <core/CStringUtils.h>
+
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+CppUnit::Test* CBinaryStateRestoreTraverserTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CBinaryStateRestoreTraverserTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestore1",
+        &CBinaryStateRestoreTraverserTest::testRestore1));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestore2",
+        &CBinaryStateRestoreTraverserTest::testRestore2));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestore3",
+        &CBinaryStateRestoreTraverserTest::testRestore3));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestore4",
+        &CBinaryStateRestoreTraverserTest::testRestore4));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRoundTrip",
+        &CBinaryStateRestoreTraverserTest::testRoundTrip));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testCorrupt",
+        &CBinaryStateRestoreTraverserTest::testCorrupt));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testTypedValues",
+        &CBinaryStateRestoreTraverserTest::testTypedValues));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testLongStrings",
+        &CBinaryStateRestoreTraverserTest::testLongStrings));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testReadDocuments",
+        &CBinaryStateRestoreTraverserTest::testReadDocuments));
+
+    return suiteOfTests;
+}
+
+namespace {
+
+using TPersistFunc = std::function<void(ml::core::CStatePersistInserter&)>;
+
+std::string persist(const TPersistFunc& f) {
+    std::ostringstream strm;
+    {
+        ml::core::CBinaryStatePersistInserter inserter(strm);
+        f(inserter);
+    }
+    return strm.str();
+}
+
+void insert2ndLevel(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertValue("level2A", "3.14");
+    inserter.insertValue("level2B", 'z');
+}
+
+void insert2ndLevelNested(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertLevel("level2A", &insert2ndLevel);
+    inserter.insertValue("level2B", "y");
+}
+
+void insert1stLevel(ml::core::CStatePersistInserter& inserter,
+                    const TPersistFunc& insertLevelC,
+                    bool afterAscending) {
+    inserter.insertValue("level1A", "a");
+    inserter.insertValue("level1B", 25);
+    inserter.insertLevel("level1C", insertLevelC);
+    if (afterAscending) {
+        inserter.insertValue("level1D", "afterAscending");
+    }
+}
+
+bool traverse2ndLevel(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level2A"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("3.14"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level2B"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("z"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+
+    return true;
+}
+
+bool traverse2ndLevelEmpty(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT(traverser.name().empty());
+    CPPUNIT_ASSERT(traverser.value().empty());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+
+    return true;
+}
+
+bool traverse2ndLevelNested(ml::core::CStateRestoreTraverser& traverser) {
+    // Only look at the start of the nested level.
+    CPPUNIT_ASSERT_EQUAL(std::string("level2A"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel([](ml::core::CStateRestoreTraverser& traverser_) {
+        CPPUNIT_ASSERT_EQUAL(std::string("level2A"), traverser_.name());
+        return true;
+    }));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level2B"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("y"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.next());
+
+    return true;
+}
+
+bool traverse1stLevel(ml::core::CStateRestoreTraverser& traverser,
+                      bool (*traverseLevelC)(ml::core::CStateRestoreTraverser&),
+                      bool afterAscending) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level1A"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1B"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("25"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1C"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    // If no function is supplied we ignore the contents of the sub-level.
+    if (traverseLevelC != nullptr) {
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(traverseLevelC));
+    }
+    if (afterAscending) {
+        CPPUNIT_ASSERT(traverser.next());
+        CPPUNIT_ASSERT_EQUAL(std::string("level1D"), traverser.name());
+        CPPUNIT_ASSERT_EQUAL(std::string("afterAscending"), traverser.value());
+        CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    }
+    CPPUNIT_ASSERT(!traverser.next());
+
+    return true;
+}
+
+//! A simple object with the same persistence idioms as the models.
+struct SState {
+    void acceptPersistInserter(ml::core::CStatePersistInserter& inserter) const {
+        inserter.insertValue("name", s_Name);
+        inserter.insertValue("count", s_Count);
+        inserter.insertValue("mean", s_Mean, ml::core::CIEEE754::E_SinglePrecision);
+        inserter.insertValue("variance", s_Variance, ml::core::CIEEE754::E_DoublePrecision);
+        for (const auto& child : s_Children) {
+            inserter.insertLevel("child", std::bind(&SState::acceptPersistInserter,
+                                                    &child, std::placeholders::_1));
+        }
+    }
+
+    bool acceptRestoreTraverser(ml::core::CStateRestoreTraverser& traverser) {
+        do {
+            const std::string& name = traverser.name();
+            if (name == "name") {
+                s_Name = traverser.value();
+            } else if (name == "count") {
+                if (ml::core::CStringUtils::stringToType(traverser.value(), s_Count) == false) {
+                    return false;
+                }
+            } else if (name == "mean") {
+                if (traverser.typedValue(s_Mean) == false) {
+                    return false;
+                }
+            } else if (name == "variance") {
+                if (traverser.typedValue(s_Variance) == false) {
+                    return false;
+                }
+            } else if (name == "child") {
+                s_Children.emplace_back();
+                if (traverser.traverseSubLevel(std::bind(&SState::acceptRestoreTraverser,
+                                                         &s_Children.back(),
+                                                         std::placeholders::_1)) == false) {
+                    return false;
+                }
+            }
+        } while (traverser.next());
+        return true;
+    }
+
+    std::string s_Name;
+    int s_Count = 0;
+    double s_Mean = 0.0;
+    double s_Variance = 0.0;
+    std::vector<SState> s_Children;
+};
+}
+
+void CBinaryStateRestoreTraverserTest::testRestore1() {
+    std::istringstream strm(persist([](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevel, false));
+    }));
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(std::bind(
+        &traverse1stLevel, std::placeholders::_1, &traverse2ndLevel, false)));
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(traverser.isEof());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRestore2() {
+    std::istringstream strm(persist([](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevel, true));
+    }));
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(std::bind(
+        &traverse1stLevel, std::placeholders::_1, &traverse2ndLevel, true)));
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRestore3() {
+    // Test empty and partially read sub-levels.
+
+    std::istringstream strm(persist([](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  [](ml::core::CStatePersistInserter&) {},
+                                                  true));
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevelNested, true));
+    }));
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(std::bind(
+        &traverse1stLevel, std::placeholders::_1, &traverse2ndLevelEmpty, true)));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(std::bind(
+        &traverse1stLevel, std::placeholders::_1, &traverse2ndLevelNested, true)));
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRestore4() {
+    // Test skipping sub-levels, which must still read the names they define.
+
+    std::istringstream strm(persist([](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevelNested, true));
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevel, false));
+    }));
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(
+        std::bind(&traverse1stLevel, std::placeholders::_1, nullptr, true)));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(std::bind(
+        &traverse1stLevel, std::placeholders::_1, &traverse2ndLevel, false)));
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRoundTrip() {
+    // Check that state restored from the binary format persists to exactly
+    // the same JSON as the original.
+
+    SState state;
+    state.s_Name = std::string("binary\0name", 11);
+    state.s_Count = -3;
+    state.s_Mean = 2.0 / 3.0;
+    state.s_Variance = 1.0 / 7.0;
+    for (int i = 0; i < 3; ++i) {
+        state.s_Children.emplace_back();
+        state.s_Children.back().s_Name = "child" + std::to_string(i);
+        state.s_Children.back().s_Count = i;
+        state.s_Children.back().s_Mean = 1e-5 * i;
+        state.s_Children.back().s_Variance = 1e5 * (i + 1.0 / 3.0);
+        state.s_Children.back().s_Children.resize(i);
+    }
+
+    std::ostringstream expected;
+    {
+        ml::core::CJsonStatePersistInserter inserter(expected);
+        state.acceptPersistInserter(inserter);
+    }
+
+    std::istringstream strm(persist(std::bind(&SState::acceptPersistInserter,
+                                              &state, std::placeholders::_1)));
+    SState restored;
+    {
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(restored.acceptRestoreTraverser(traverser));
+        CPPUNIT_ASSERT(!traverser.haveBadState());
+    }
+
+    std::ostringstream actual;
+    {
+        ml::core::CJsonStatePersistInserter inserter(actual);
+        restored.acceptPersistInserter(inserter);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(expected.str(), actual.str());
+    CPPUNIT_ASSERT_EQUAL(state.s_Variance, restored.s_Variance);
+}
+
+void CBinaryStateRestoreTraverserTest::testCorrupt() {
+    std::string state(persist([](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertLevel("_source", std::bind(&insert1stLevel, std::placeholders::_1,
+                                                  &insert2ndLevel, true));
+    }));
+
+    // Not binary state.
+    {
+        std::istringstream strm("{\"_source\":{}}");
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.name().empty());
+        CPPUNIT_ASSERT(!traverser.hasSubLevel());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+
+    // Truncated state.
+    for (std::size_t length : {state.size() / 2, state.size() - 2}) {
+        std::istringstream strm(state.substr(0, length));
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+        traverser.traverseSubLevel([](ml::core::CStateRestoreTraverser& traverser_) {
+            while (traverser_.next()) {
+            }
+            return true;
+        });
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+}
+
+void CBinaryStateRestoreTraverserTest::testTypedValues() {
+    // Check that doubles are restored exactly without going through their
+    // string representation and that other values are converted as usual.
+
+    const double values[]{0.1 + 0.2, -0.0, 1e-310, -1.7976931348623157e308,
+                          std::numeric_limits<double>::infinity()};
+
+    std::istringstream strm(persist([&values](ml::core::CStatePersistInserter& inserter) {
+        for (double value : values) {
+            inserter.insertValue("double", value, ml::core::CIEEE754::E_DoublePrecision);
+        }
+        inserter.insertValue("string", "3.25");
+        inserter.insertValue("int", 42);
+    }));
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+    for (double expected : values) {
+        CPPUNIT_ASSERT_EQUAL(std::string("double"), traverser.name());
+        double actual;
+        CPPUNIT_ASSERT(traverser.doubleValue(actual));
+        CPPUNIT_ASSERT_EQUAL(0, std::memcmp(&expected, &actual, sizeof(double)));
+        CPPUNIT_ASSERT(traverser.typedValue(actual));
+        CPPUNIT_ASSERT_EQUAL(0, std::memcmp(&expected, &actual, sizeof(double)));
+        CPPUNIT_ASSERT(traverser.next());
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("string"), traverser.name());
+    double d;
+    CPPUNIT_ASSERT(traverser.typedValue(d));
+    CPPUNIT_ASSERT_EQUAL(3.25, d);
+    CPPUNIT_ASSERT(traverser.next());
+
+    CPPUNIT_ASSERT_EQUAL(std::string("int"), traverser.name());
+    int i;
+    CPPUNIT_ASSERT(traverser.typedValue(i));
+    CPPUNIT_ASSERT_EQUAL(42, i);
+    CPPUNIT_ASSERT(traverser.doubleValue(d));
+    CPPUNIT_ASSERT_EQUAL(42.0, d);
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testLongStrings() {
+    // Check that strings longer than the chunk in which they're read are
+    // restored and that a corrupt length is rejected rather than used to
+    // allocate memory.
+
+    std::string value;
+    for (std::size_t i = 0; i < 200000; ++i) {
+        value += static_cast<char>('a' + i % 26);
+    }
+
+    std::string state(persist([&value](ml::core::CStatePersistInserter& inserter) {
+        inserter.insertValue("long", value);
+        inserter.insertValue("short", "b");
+    }));
+
+    {
+        std::istringstream strm(state);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT_EQUAL(std::string("long"), traverser.name());
+        CPPUNIT_ASSERT(value == traverser.value());
+        CPPUNIT_ASSERT(traverser.next());
+        CPPUNIT_ASSERT_EQUAL(std::string("short"), traverser.name());
+        CPPUNIT_ASSERT_EQUAL(std::string("b"), traverser.value());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(!traverser.haveBadState());
+    }
+
+    // Truncating the long string.
+    {
+        std::istringstream strm(state.substr(0, state.size() / 2));
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.name().empty());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+
+    // A string element named "a" whose value claims to be 2^56 - 1 bytes.
+    {
+        std::string corrupt(ml::core::CBinaryStatePersistInserter::MAGIC);
+        corrupt += static_cast<char>(ml::core::CBinaryStatePersistInserter::E_String);
+        corrupt += '\x01';
+        corrupt += 'a';
+        corrupt += std::string(7, '\xFF');
+        corrupt += '\x7F';
+        corrupt += "not nearly enough input";
+        std::istringstream strm(corrupt);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.name().empty());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+}
+
+void CBinaryStateRestoreTraverserTest::testReadDocuments() {
+    // Check that documents which follow one another in a stream can be
+    // read without restoring them and that the format is detected.
+
+    SState state;
+    state.s_Name = std::string("line\nbreak", 10);
+    state.s_Count = 10;
+    state.s_Mean = 1.5;
+    state.s_Children.resize(2);
+    state.s_Children[1].s_Children.resize(1);
+
+    std::string document{persist(std::bind(&SState::acceptPersistInserter,
+                                           &state, std::placeholders::_1))};
+    std::string empty{persist([](ml::core::CStatePersistInserter&) {})};
+
+    std::istringstream strm(document + empty + document);
+    for (const auto& expected : {document, empty, document}) {
+        CPPUNIT_ASSERT(ml::core::CBinaryStateRestoreTraverser::isBinaryState(strm));
+        std::string actual;
+        CPPUNIT_ASSERT(ml::core::CBinaryStateRestoreTraverser::readDocument(strm, actual));
+        CPPUNIT_ASSERT_EQUAL(expected, actual);
+    }
+    std::string actual;
+    CPPUNIT_ASSERT(!ml::core::CBinaryStateRestoreTraverser::readDocument(strm, actual));
+
+    // A truncated document can't be read.
+    std::istringstream truncated(document.substr(0, document.size() - 1));
+    CPPUNIT_ASSERT(!ml::core::CBinaryStateRestoreTraverser::readDocument(truncated, actual));
+
+    std::ostringstream json;
+    {
+        ml::core::CJsonStatePersistInserter inserter(json);
+        state.acceptPersistInserter(inserter);
+    }
+    std::istringstream jsonStrm(json.str());
+    CPPUNIT_ASSERT(!ml::core::CBinaryStateRestoreTraverser::isBinaryState(jsonStrm));
+}
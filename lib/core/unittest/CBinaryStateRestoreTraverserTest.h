@@ -0,0 +1,26 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CBinaryStateRestoreTraverserTest_h
+#define INCLUDED_CBinaryStateRestoreTraverserTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CBinaryStateRestoreTraverserTest : public CppUnit::TestFixture {
+public:
+    void testRestore1();
+    void testRestore2();
+    void testRestore3();
+    void testRestore4();
+    void testRoundTrip();
+    void testCorrupt();
+    void testTypedValues();
+    void testLongStrings();
+    void testReadDocuments();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CBinaryStateRestoreTraverserTest_h
@@ -9,6 +9,7 @@
 #include <core/CLogger.h>
 
 #include <string>
+#include <vector>
 
 CppUnit::Test* CCompressUtilsTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CCompressUtilsTest");
@@ -21,6 +22,9 @@ CppUnit::Test* CCompressUtilsTest::suite() {
         "CCompressUtilsTest::testManyAdds", &CCompressUtilsTest::testManyAdds));
     suiteOfTests->addTest(new CppUnit::TestCaller<CCompressUtilsTest>(
         "CCompressUtilsTest::testLengthOnly", &CCompressUtilsTest::testLengthOnly));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CCompressUtilsTest>(
+        "CCompressUtilsTest::testDeflateInflateBytes",
+        &CCompressUtilsTest::testDeflateInflateBytes));
     return suiteOfTests;
 }
 
@@ -135,3 +139,38 @@ void CCompressUtilsTest::testLengthOnly() {
     CPPUNIT_ASSERT_EQUAL(lengthFull, lengthLengthOnly);
     CPPUNIT_ASSERT_EQUAL(size_t(0), outputLengthOnly.size());
 }
+
+void CCompressUtilsTest::testDeflateInflateBytes() {
+    std::vector<float> input(1000);
+    for (std::size_t i = 0u; i < input.size(); ++i) {
+        input[i] = i % 3 == 0 ? 0.0f : static_cast<float>(i % 17);
+    }
+    std::size_t length(input.size() * sizeof(float));
+
+    ml::core::CCompressUtils::TByteVec deflated;
+    CPPUNIT_ASSERT(ml::core::CCompressUtils::deflateBytes(input.data(), length, deflated));
+    LOG_DEBUG(<< "Deflated " << length << " bytes to " << deflated.size());
+    CPPUNIT_ASSERT(deflated.size() < length / 4);
+
+    std::vector<float> inflated(input.size());
+    CPPUNIT_ASSERT(ml::core::CCompressUtils::inflateBytes(deflated, inflated.data(), length));
+    CPPUNIT_ASSERT(input == inflated);
+
+    // The deflated bytes can be read in place from a larger buffer.
+    ml::core::CCompressUtils::TByteVec buffer(1, 0);
+    buffer.insert(buffer.end(), deflated.begin(), deflated.end());
+    buffer.push_back(0);
+    inflated.assign(input.size(), 0.0f);
+    CPPUNIT_ASSERT(ml::core::CCompressUtils::inflateBytes(
+        &buffer[1], deflated.size(), inflated.data(), length));
+    CPPUNIT_ASSERT(input == inflated);
+
+    // Inflating to the wrong length should fail.
+    std::vector<float> wrongLength(input.size() + 1);
+    CPPUNIT_ASSERT(!ml::core::CCompressUtils::inflateBytes(
+        deflated, wrongLength.data(), length + sizeof(float)));
+
+    // Corrupt input should fail.
+    ml::core::CCompressUtils::TByteVec corrupt(deflated.size() / 2, 0xff);
+    CPPUNIT_ASSERT(!ml::core::CCompressUtils::inflateBytes(corrupt, inflated.data(), length));
+}
@@ -14,6 +14,7 @@ public:
     void testOneAdd();
     void testManyAdds();
     void testLengthOnly();
+    void testDeflateInflateBytes();
 
     static CppUnit::Test* suite();
 };
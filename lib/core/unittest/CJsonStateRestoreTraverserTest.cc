@@ -33,6 +33,9 @@ CppUnit::Test* CJsonStateRestoreTraverserTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CJsonStateRestoreTraverserTest>(
         "CJsonStateRestoreTraverserTest::testRestore1IgnoreArraysNested",
         &CJsonStateRestoreTraverserTest::testRestore1IgnoreArraysNested));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CJsonStateRestoreTraverserTest>(
+        "CJsonStateRestoreTraverserTest::testRestoreConsecutiveDocuments",
+        &CJsonStateRestoreTraverserTest::testRestoreConsecutiveDocuments));
 
     return suiteOfTests;
 }
@@ -241,3 +244,30 @@ void CJsonStateRestoreTraverserTest::testRestore1IgnoreArraysNested() {
     CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse1stLevel1));
     CPPUNIT_ASSERT(!traverser.next());
 }
+
+void CJsonStateRestoreTraverserTest::testRestoreConsecutiveDocuments() {
+    std::string json("{\"_source\":{\"level1A\":\"a\",\"level1B\":\"25\",\"level1C\":{\"level2A\":\"3.14\",\"level2B\":\"z\"}}}\n"
+                     "{\"second\":\"b\",\"third\":\"c\"}\n");
+    std::istringstream strm(json);
+
+    {
+        ml::core::CJsonStateRestoreTraverser traverser(strm);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+        CPPUNIT_ASSERT(traverser.hasSubLevel());
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse1stLevel1));
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(!traverser.haveBadState());
+    }
+    {
+        ml::core::CJsonStateRestoreTraverser traverser(strm);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("second"), traverser.name());
+        CPPUNIT_ASSERT_EQUAL(std::string("b"), traverser.value());
+        CPPUNIT_ASSERT(traverser.next());
+        CPPUNIT_ASSERT_EQUAL(std::string("third"), traverser.name());
+        CPPUNIT_ASSERT_EQUAL(std::string("c"), traverser.value());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(!traverser.haveBadState());
+    }
+}
@@ -17,6 +17,7 @@ public:
     void testParsingBooleanFields();
     void testRestore1IgnoreArrays();
     void testRestore1IgnoreArraysNested();
+    void testRestoreConsecutiveDocuments();
 
     static CppUnit::Test* suite();
 };
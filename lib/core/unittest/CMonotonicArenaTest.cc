@@ -0,0 +1,196 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CMonotonicArenaTest.h"
+
+#include <core/CLogger.h>
+#include <core/CMonotonicArena.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ml;
+
+namespace {
+template<typename T>
+using TArenaVec = std::vector<T, core::CMonotonicArenaAllocator<T>>;
+using TIntVec = TArenaVec<int>;
+using TIntVecVec = TArenaVec<TIntVec>;
+using TIntIntMap = std::map<int, int, std::less<int>, core::CMonotonicArenaAllocator<std::pair<const int, int>>>;
+}
+
+CppUnit::Test* CMonotonicArenaTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CMonotonicArenaTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMonotonicArenaTest>(
+        "CMonotonicArenaTest::testAllocate", &CMonotonicArenaTest::testAllocate));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMonotonicArenaTest>(
+        "CMonotonicArenaTest::testReset", &CMonotonicArenaTest::testReset));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMonotonicArenaTest>(
+        "CMonotonicArenaTest::testAllocator", &CMonotonicArenaTest::testAllocator));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMonotonicArenaTest>(
+        "CMonotonicArenaTest::testScope", &CMonotonicArenaTest::testScope));
+
+    return suiteOfTests;
+}
+
+void CMonotonicArenaTest::testAllocate() {
+    // Test allocations are aligned, don't overlap and are counted.
+
+    core::CMonotonicArena arena{1024};
+
+    std::vector<std::pair<char*, std::size_t>> allocations;
+    for (std::size_t i = 0u; i < 200; ++i) {
+        std::size_t size{1 + (i * 37) % 113};
+        std::size_t alignment{std::size_t(1) << (i % 4)};
+        char* p{static_cast<char*>(arena.allocate(size, alignment))};
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), reinterpret_cast<std::uintptr_t>(p) % alignment);
+        allocations.emplace_back(p, size);
+    }
+    for (std::size_t i = 0u; i < allocations.size(); ++i) {
+        for (std::size_t j = 0u; j < i; ++j) {
+            CPPUNIT_ASSERT(allocations[i].first + allocations[i].second <= allocations[j].first ||
+                           allocations[j].first + allocations[j].second <= allocations[i].first);
+        }
+    }
+
+    // Check an allocation larger than the block size.
+    char* large{static_cast<char*>(arena.allocate(4096))};
+    std::fill_n(large, 4096, 'a');
+
+    const core::CMonotonicArena::SStatistics& statistics{arena.statistics()};
+    LOG_DEBUG(<< "allocations = " << statistics.s_Allocations
+              << ", heap allocations = " << statistics.s_HeapAllocations);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(201), statistics.s_Allocations);
+    CPPUNIT_ASSERT(statistics.s_HeapAllocations > 1);
+    CPPUNIT_ASSERT(statistics.s_HeapAllocations < 20);
+    CPPUNIT_ASSERT(arena.memoryUsage() >= statistics.s_Bytes);
+}
+
+void CMonotonicArenaTest::testReset() {
+    // Test that once we've seen the peak usage reset means we don't
+    // allocate any more memory from the heap.
+
+    core::CMonotonicArena arena{256};
+
+    for (std::size_t i = 0u; i < 100; ++i) {
+        arena.allocate(64);
+    }
+    CPPUNIT_ASSERT(arena.statistics().s_HeapAllocations > 1);
+
+    std::size_t memory{arena.memoryUsage()};
+    std::uint64_t totalHeapAllocations{arena.statistics().s_TotalHeapAllocations};
+    arena.reset();
+    LOG_DEBUG(<< "memory = " << memory << ", after reset = " << arena.memoryUsage());
+
+    for (std::size_t round = 0u; round < 5; ++round) {
+        for (std::size_t i = 0u; i < 100; ++i) {
+            arena.allocate(64);
+        }
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(100), arena.statistics().s_Allocations);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), arena.statistics().s_HeapAllocations);
+        arena.reset();
+    }
+    CPPUNIT_ASSERT_EQUAL(totalHeapAllocations + 1, arena.statistics().s_TotalHeapAllocations);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(600), arena.statistics().s_TotalAllocations);
+
+    // Test that reset returns memory above the maximum retained size.
+
+    core::CMonotonicArena capped{256, 1024};
+    for (std::size_t i = 0u; i < 100; ++i) {
+        capped.allocate(64);
+    }
+    CPPUNIT_ASSERT(capped.memoryUsage() > 6400);
+    capped.reset();
+    LOG_DEBUG(<< "capped after reset = " << capped.memoryUsage());
+    CPPUNIT_ASSERT(capped.memoryUsage() < 1024 + 256);
+    for (std::size_t i = 0u; i < 10; ++i) {
+        capped.allocate(64);
+    }
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), capped.statistics().s_HeapAllocations);
+}
+
+void CMonotonicArenaTest::testAllocator() {
+    // Test standard containers work with and without an arena.
+
+    core::CMonotonicArena arena;
+
+    auto fill = [](TIntVecVec& vectors, TIntIntMap& map) {
+        for (int i = 0; i < 100; ++i) {
+            vectors.emplace_back();
+            for (int j = 0; j <= i; ++j) {
+                vectors.back().push_back(j);
+            }
+            map[i] = i * i;
+        }
+    };
+    auto check = [](const TIntVecVec& vectors, const TIntIntMap& map) {
+        CPPUNIT_ASSERT_EQUAL(std::size_t(100), vectors.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(100), map.size());
+        for (int i = 0; i < 100; ++i) {
+            CPPUNIT_ASSERT_EQUAL(std::size_t(i + 1), vectors[i].size());
+            CPPUNIT_ASSERT_EQUAL(i, vectors[i].back());
+            CPPUNIT_ASSERT_EQUAL(i * i, map.at(i));
+        }
+    };
+
+    {
+        TIntVecVec vectors;
+        TIntIntMap map;
+        CPPUNIT_ASSERT(vectors.get_allocator().arena() == nullptr);
+        fill(vectors, map);
+        check(vectors, map);
+    }
+    {
+        core::CScopedMonotonicArena scope{arena};
+        TIntVecVec vectors;
+        TIntIntMap map;
+        CPPUNIT_ASSERT(vectors.get_allocator().arena() == &arena);
+        fill(vectors, map);
+        check(vectors, map);
+
+        TIntVecVec other;
+        other.swap(vectors);
+        check(other, map);
+        CPPUNIT_ASSERT(vectors.empty());
+
+        LOG_DEBUG(<< "allocations = " << arena.statistics().s_Allocations
+                  << ", heap allocations = " << arena.statistics().s_HeapAllocations);
+        CPPUNIT_ASSERT(arena.statistics().s_Allocations > 200);
+        CPPUNIT_ASSERT(arena.statistics().s_HeapAllocations <= 2);
+    }
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), arena.statistics().s_Allocations);
+}
+
+void CMonotonicArenaTest::testScope() {
+    // Test nested scopes and that arenas are only installed for the
+    // thread which created the scope.
+
+    core::CMonotonicArena arena1;
+    core::CMonotonicArena arena2;
+
+    CPPUNIT_ASSERT(core::CMonotonicArena::current() == nullptr);
+    {
+        core::CScopedMonotonicArena scope1{arena1, false};
+        CPPUNIT_ASSERT(core::CMonotonicArena::current() == &arena1);
+        {
+            core::CScopedMonotonicArena scope2{arena2};
+            CPPUNIT_ASSERT(core::CMonotonicArena::current() == &arena2);
+
+            core::CMonotonicArena* other{&arena1};
+            std::thread thread{[&other] { other = core::CMonotonicArena::current(); }};
+            thread.join();
+            CPPUNIT_ASSERT(other == nullptr);
+        }
+        CPPUNIT_ASSERT(core::CMonotonicArena::current() == &arena1);
+        TIntVec values(10);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), arena1.statistics().s_Allocations);
+    }
+    CPPUNIT_ASSERT(core::CMonotonicArena::current() == nullptr);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), arena1.statistics().s_Allocations);
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CMonotonicArenaTest_h
+#define INCLUDED_CMonotonicArenaTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CMonotonicArenaTest : public CppUnit::TestFixture {
+public:
+    void testAllocate();
+    void testReset();
+    void testAllocator();
+    void testScope();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CMonotonicArenaTest_h
@@ -0,0 +1,318 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CRingBufferStreamBufTest.h"
+
+#include <core/CDualThreadStreamBuf.h>
+#include <core/CLogger.h>
+#include <core/CRingBufferStreamBuf.h>
+#include <core/CSleep.h>
+#include <core/CStopWatch.h>
+#include <core/CThread.h>
+#include <core/CTimeUtils.h>
+#include <core/CoreTypes.h>
+
+#include <algorithm>
+#include <istream>
+#include <string>
+
+#include <stdint.h>
+#include <string.h>
+
+CppUnit::Test* CRingBufferStreamBufTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CRingBufferStreamBufTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRingBufferStreamBufTest>(
+        "CRingBufferStreamBufTest::testThroughput", &CRingBufferStreamBufTest::testThroughput));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRingBufferStreamBufTest>(
+        "CRingBufferStreamBufTest::testSlowConsumer", &CRingBufferStreamBufTest::testSlowConsumer));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRingBufferStreamBufTest>(
+        "CRingBufferStreamBufTest::testPutback", &CRingBufferStreamBufTest::testPutback));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRingBufferStreamBufTest>(
+        "CRingBufferStreamBufTest::testFatal", &CRingBufferStreamBufTest::testFatal));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRingBufferStreamBufTest>(
+        "CRingBufferStreamBufTest::testFlushLatency", &CRingBufferStreamBufTest::testFlushLatency));
+
+    return suiteOfTests;
+}
+
+namespace {
+
+template<typename BUFFER>
+class CInputThread : public ml::core::CThread {
+public:
+    CInputThread(BUFFER& buffer, uint32_t delay = 0, size_t fatalAfter = 0)
+        : m_Buffer(buffer), m_Delay(delay), m_FatalAfter(fatalAfter),
+          m_TotalData(0) {}
+
+    size_t totalData() const { return m_TotalData; }
+
+protected:
+    virtual void run() {
+        std::istream strm(&m_Buffer);
+        size_t count(0);
+        std::string line;
+        while (std::getline(strm, line)) {
+            ++count;
+            m_TotalData += line.length();
+            ++m_TotalData; // For the delimiter
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::streampos>(m_TotalData), strm.tellg());
+            ml::core::CSleep::sleep(m_Delay);
+            if (count == m_FatalAfter) {
+                m_Buffer.signalFatalError();
+            }
+        }
+    }
+
+    virtual void shutdown() { m_Buffer.signalFatalError(); }
+
+private:
+    BUFFER& m_Buffer;
+    uint32_t m_Delay;
+    size_t m_FatalAfter;
+    size_t m_TotalData;
+};
+
+const char*
+    DATA("According to the most recent Wikipedia definition \"Predictive "
+         "analytics encompasses a variety of statistical techniques from "
+         "modeling, machine learning, data mining and game theory that ... "
+         "exploit patterns found in historical and transactional data to "
+         "identify risks and opportunities.\"\n"
+         "In applications such as credit scoring, predictive analytics "
+         "identifies patterns and relationships in huge volumes of data, hidden "
+         "to human analysis, that presages an undesirable outcome.  Many "
+         "vendors refer to their ability to project a ramp in a single metric, "
+         "say CPU utilization, as predictive analytics.  As most users know, "
+         "these capabilities are of limited value in that single metrics are "
+         "rarely the cause of cataclysmic failures.  Rather it is the impact of "
+         "change between components that causes failure in complex IT systems.\n");
+
+template<typename BUFFER>
+void writeAll(BUFFER& buf, size_t testSize) {
+    size_t dataSize(::strlen(DATA));
+    for (size_t count = 0; count < testSize; ++count) {
+        std::streamsize toWrite(static_cast<std::streamsize>(dataSize));
+        const char* ptr(DATA);
+        while (toWrite > 0) {
+            std::streamsize written(buf.sputn(ptr, toWrite));
+            CPPUNIT_ASSERT(written > 0);
+            toWrite -= written;
+            ptr += written;
+        }
+    }
+}
+
+template<typename BUFFER>
+uint64_t timeThroughput(BUFFER& buf, size_t testSize) {
+    size_t totalDataSize(testSize * ::strlen(DATA));
+
+    ml::core::CStopWatch stopWatch(true);
+
+    CInputThread<BUFFER> inputThread(buf);
+    inputThread.start();
+
+    writeAll(buf, testSize);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::streampos>(totalDataSize),
+                         buf.pubseekoff(0, std::ios_base::cur, std::ios_base::out));
+    buf.signalEndOfFile();
+
+    inputThread.waitForFinish();
+
+    uint64_t result(stopWatch.stop());
+
+    CPPUNIT_ASSERT_EQUAL(totalDataSize, inputThread.totalData());
+
+    return result;
+}
+}
+
+void CRingBufferStreamBufTest::testThroughput() {
+    // This compares the ring buffer with CDualThreadStreamBuf for various
+    // depths and block sizes.
+
+    static const size_t TEST_SIZE(200000);
+    size_t totalDataSize(TEST_SIZE * ::strlen(DATA));
+
+    uint64_t dualThreadTime(0);
+    {
+        ml::core::CDualThreadStreamBuf buf;
+        dualThreadTime = timeThroughput(buf, TEST_SIZE);
+    }
+    LOG_INFO(<< "Dual thread buffer transferred " << totalDataSize
+             << " bytes in " << dualThreadTime << "ms");
+
+    for (size_t depth : {2, 4, 16}) {
+        for (size_t blockCapacity : {4096, 65536}) {
+            ml::core::CRingBufferStreamBuf buf(blockCapacity, depth);
+            uint64_t ringTime(timeThroughput(buf, TEST_SIZE));
+            LOG_INFO(<< "Ring buffer with depth " << depth << " and block capacity "
+                     << blockCapacity << " transferred " << totalDataSize
+                     << " bytes in " << ringTime << "ms");
+        }
+    }
+}
+
+void CRingBufferStreamBufTest::testSlowConsumer() {
+    static const size_t TEST_SIZE(10);
+    static const uint32_t DELAY(200);
+    size_t dataSize(::strlen(DATA));
+    size_t numNewLines(std::count(DATA, DATA + dataSize, '\n'));
+    size_t totalDataSize(TEST_SIZE * dataSize);
+
+    // Small blocks so the writer has to wait for the reader.
+    ml::core::CRingBufferStreamBuf buf(1024, 2);
+    CInputThread<ml::core::CRingBufferStreamBuf> inputThread(buf, DELAY);
+    inputThread.start();
+
+    ml::core_t::TTime start(ml::core::CTimeUtils::now());
+
+    writeAll(buf, TEST_SIZE);
+    buf.signalEndOfFile();
+
+    inputThread.waitForFinish();
+
+    ml::core_t::TTime end(ml::core::CTimeUtils::now());
+
+    CPPUNIT_ASSERT_EQUAL(totalDataSize, inputThread.totalData());
+
+    ml::core_t::TTime duration(end - start);
+    LOG_INFO(<< "Ring buffer slow consumer test with test size " << TEST_SIZE
+             << ", " << numNewLines << " newlines per message and delay "
+             << DELAY << "ms took " << duration << " seconds");
+
+    ml::core_t::TTime delaySecs(
+        static_cast<ml::core_t::TTime>((DELAY * numNewLines * TEST_SIZE) / 1000));
+    CPPUNIT_ASSERT(duration >= delaySecs);
+    static const ml::core_t::TTime TOLERANCE(3);
+    CPPUNIT_ASSERT(duration <= delaySecs + TOLERANCE);
+}
+
+void CRingBufferStreamBufTest::testPutback() {
+    // Use small blocks so we put back across a block boundary.
+    static const size_t BLOCK_CAPACITY(100);
+
+    size_t dataSize(::strlen(DATA));
+    ml::core::CRingBufferStreamBuf buf(BLOCK_CAPACITY, dataSize / BLOCK_CAPACITY + 2);
+    writeAll(buf, 1);
+    buf.signalEndOfFile();
+
+    std::istream strm(&buf);
+
+    // Characters which don't match those read.
+    static const char* PUTBACK_CHARS("put this back");
+    char c('\0');
+    CPPUNIT_ASSERT(strm.get(c).good());
+    CPPUNIT_ASSERT_EQUAL(*DATA, c);
+    CPPUNIT_ASSERT(strm.putback(c).good());
+    for (const char* putbackChar = PUTBACK_CHARS; *putbackChar != '\0'; ++putbackChar) {
+        CPPUNIT_ASSERT(strm.putback(*putbackChar).good());
+    }
+    std::string actual;
+    for (const char* putbackChar = PUTBACK_CHARS; *putbackChar != '\0'; ++putbackChar) {
+        CPPUNIT_ASSERT(strm.get(c).good());
+        actual.insert(actual.begin(), c);
+    }
+    CPPUNIT_ASSERT_EQUAL(std::string(PUTBACK_CHARS), actual);
+
+    // Characters which match those read from the previous block.
+    std::string read(BLOCK_CAPACITY + 20, '\0');
+    CPPUNIT_ASSERT(strm.read(&read[0], static_cast<std::streamsize>(read.size())).good());
+    CPPUNIT_ASSERT_EQUAL(std::string(DATA, read.size()), read);
+    for (size_t i = 0; i < 40; ++i) {
+        CPPUNIT_ASSERT(strm.putback(read[read.size() - 1 - i]).good());
+    }
+    std::string reread(40, '\0');
+    CPPUNIT_ASSERT(strm.read(&reread[0], static_cast<std::streamsize>(reread.size())).good());
+    CPPUNIT_ASSERT_EQUAL(read.substr(read.size() - 40), reread);
+
+    std::string remainder(read);
+    std::string line;
+    while (std::getline(strm, line)) {
+        remainder += line;
+        remainder += '\n';
+    }
+    CPPUNIT_ASSERT_EQUAL(std::string(DATA), remainder);
+}
+
+void CRingBufferStreamBufTest::testFatal() {
+    static const size_t TEST_SIZE(10000);
+    static const size_t BLOCK_CAPACITY(16384);
+    static const size_t DEPTH(4);
+    size_t dataSize(::strlen(DATA));
+
+    // These conditions need to be true for the test to work properly
+    CPPUNIT_ASSERT(dataSize < BLOCK_CAPACITY);
+    CPPUNIT_ASSERT(BLOCK_CAPACITY * (DEPTH + 1) < TEST_SIZE * dataSize);
+
+    ml::core::CRingBufferStreamBuf buf(BLOCK_CAPACITY, DEPTH);
+    CInputThread<ml::core::CRingBufferStreamBuf> inputThread(buf, 1000, 1);
+    inputThread.start();
+
+    size_t totalDataWritten(0);
+    for (size_t count = 0; count < TEST_SIZE; ++count) {
+        std::streamsize toWrite(static_cast<std::streamsize>(dataSize));
+        const char* ptr(DATA);
+        while (toWrite > 0) {
+            std::streamsize written(buf.sputn(ptr, toWrite));
+            if (written == 0) {
+                break;
+            }
+            toWrite -= written;
+            ptr += written;
+            totalDataWritten += static_cast<size_t>(written);
+        }
+    }
+
+    buf.signalEndOfFile();
+
+    inputThread.waitForFinish();
+
+    LOG_DEBUG(<< "Total data written in fatal error test of size " << TEST_SIZE
+              << " is " << totalDataWritten << " bytes");
+
+    // The fatal error should have stopped the writer thread from writing
+    // much more than fits in the ring
+    CPPUNIT_ASSERT(totalDataWritten >= BLOCK_CAPACITY);
+    CPPUNIT_ASSERT(totalDataWritten <= DEPTH * BLOCK_CAPACITY + dataSize);
+}
+
+void CRingBufferStreamBufTest::testFlushLatency() {
+    // Data should reach the reader as soon as it is synced, even though the
+    // block isn't full and no more data is written.
+
+    ml::core::CRingBufferStreamBuf buf;
+
+    class CLineReader : public ml::core::CThread {
+    public:
+        CLineReader(ml::core::CRingBufferStreamBuf& buf) : m_Buf(buf) {}
+
+        const std::string& line() const { return m_Line; }
+
+    protected:
+        virtual void run() {
+            std::istream strm(&m_Buf);
+            std::getline(strm, m_Line);
+        }
+        virtual void shutdown() { m_Buf.signalFatalError(); }
+
+    private:
+        ml::core::CRingBufferStreamBuf& m_Buf;
+        std::string m_Line;
+    };
+
+    CLineReader reader(buf);
+    reader.start();
+
+    const std::string message("flush me\n");
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::streamsize>(message.length()),
+                         buf.sputn(message.c_str(), static_cast<std::streamsize>(message.length())));
+    CPPUNIT_ASSERT_EQUAL(0, buf.pubsync());
+
+    // The reader returns without the writer signalling end-of-file.
+    reader.waitForFinish();
+    CPPUNIT_ASSERT_EQUAL(std::string("flush me"), reader.line());
+    CPPUNIT_ASSERT(buf.endOfFile() == false);
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CRingBufferStreamBufTest_h
+#define INCLUDED_CRingBufferStreamBufTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CRingBufferStreamBufTest : public CppUnit::TestFixture {
+public:
+    void testThroughput();
+    void testSlowConsumer();
+    void testPutback();
+    void testFatal();
+    void testFlushLatency();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CRingBufferStreamBufTest_h
@@ -17,6 +17,7 @@
 #include <boost/random/uniform_int.hpp>
 
 #include <iostream>
+#include <vector>
 
 using namespace ml;
 using namespace core;
@@ -299,6 +300,50 @@ void CStateCompressorTest::testChunking() {
     }
 }
 
+void CStateCompressorTest::testShards() {
+    // Check that state compressed in independent shards is read back as one
+    // stream, including when shards span document boundaries, and isn't
+    // compressed a second time by the stream it's written to
+
+    for (std::size_t maxDocSize : {500, 3000, 100000}) {
+        std::string reference;
+        CMockDataAdder adder(maxDocSize);
+        {
+            std::vector<std::string> shards;
+            for (std::size_t i = 0; i < 20; ++i) {
+                std::ostringstream shard;
+                {
+                    CJsonStatePersistInserter inserter(shard);
+                    insert1stLevel(inserter, 2 * i);
+                }
+                reference += shard.str();
+                shards.push_back(ml::core::CStateCompressor::compressShard(shard.str()));
+            }
+
+            ml::core::CStateCompressor compressor(adder);
+            TOStreamP strm = compressor.addCompressedStreamed("1", "");
+            CPPUNIT_ASSERT(strm);
+            for (const auto& shard : shards) {
+                strm->write(shard.data(), shard.size());
+            }
+            CPPUNIT_ASSERT(compressor.streamComplete(strm, true));
+            CPPUNIT_ASSERT_EQUAL(adder.data().size(), compressor.numCompressedDocs());
+        }
+
+        std::string restored;
+        {
+            CMockDataSearcher searcher(adder);
+            ml::core::CStateDecompressor decompressor(searcher);
+            decompressor.setStateRestoreSearch("1", "");
+            TIStreamP istrm = decompressor.search(1, 1);
+            std::istreambuf_iterator<char> eos;
+            restored.assign(std::istreambuf_iterator<char>(*istrm), eos);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(reference, restored);
+    }
+}
+
 CppUnit::Test* CStateCompressorTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CStateCompressorTest");
 
@@ -308,6 +353,8 @@ CppUnit::Test* CStateCompressorTest::suite() {
         "CStateCompressorTest::testStreaming", &CStateCompressorTest::testStreaming));
     suiteOfTests->addTest(new CppUnit::TestCaller<CStateCompressorTest>(
         "CStateCompressorTest::testChunking", &CStateCompressorTest::testChunking));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStateCompressorTest>(
+        "CStateCompressorTest::testShards", &CStateCompressorTest::testShards));
 
     return suiteOfTests;
 }
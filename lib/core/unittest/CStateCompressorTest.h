@@ -13,6 +13,7 @@ public:
     void testForApiNoKey();
     void testStreaming();
     void testChunking();
+    void testShards();
     void testFile();
 
     static CppUnit::Test* suite();
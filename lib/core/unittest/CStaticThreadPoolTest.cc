@@ -0,0 +1,85 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CStaticThreadPoolTest.h"
+
+#include <core/CContainerPrinter.h>
+#include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace ml;
+
+void CStaticThreadPoolTest::testSchedule() {
+    std::atomic_size_t count{0};
+    {
+        core::CStaticThreadPool pool(4);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), pool.size());
+        for (std::size_t i = 0; i < 1000; ++i) {
+            pool.schedule([&count] { ++count; });
+        }
+        // Destruction waits for the queue to drain.
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1000), count.load());
+}
+
+void CStaticThreadPoolTest::testParallelForEach() {
+    core::CStaticThreadPool pool(3);
+
+    for (std::size_t n : {1, 2, 7, 1000}) {
+        std::vector<std::size_t> calls(n, 0);
+        std::vector<std::thread::id> threads(n);
+        pool.parallelForEach(n, [&](std::size_t i) {
+            ++calls[i];
+            threads[i] = std::this_thread::get_id();
+        });
+        CPPUNIT_ASSERT_EQUAL(n, std::accumulate(calls.begin(), calls.end(), std::size_t(0)));
+        CPPUNIT_ASSERT(std::count(calls.begin(), calls.end(), std::size_t(1)) ==
+                       static_cast<std::ptrdiff_t>(n));
+
+        std::sort(threads.begin(), threads.end());
+        threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+        LOG_DEBUG(<< n << " indices processed by " << threads.size() << " threads");
+        CPPUNIT_ASSERT(threads.size() <= pool.size() + 1);
+    }
+
+    // Check the pool can still run scheduled tasks after a parallel loop.
+    std::atomic_size_t count{0};
+    pool.parallelForEach(0, [&count](std::size_t) { ++count; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), count.load());
+    pool.parallelForEach(100, [&count](std::size_t) { ++count; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(100), count.load());
+}
+
+void CStaticThreadPoolTest::testEmptyPool() {
+    // With no threads everything runs in order on the calling thread.
+    core::CStaticThreadPool pool(0);
+
+    std::vector<std::size_t> order;
+    pool.parallelForEach(5, [&order](std::size_t i) { order.push_back(i); });
+    pool.schedule([&order] { order.push_back(5); });
+
+    CPPUNIT_ASSERT_EQUAL(std::string("[0, 1, 2, 3, 4, 5]"),
+                         core::CContainerPrinter::print(order));
+}
+
+CppUnit::Test* CStaticThreadPoolTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CStaticThreadPoolTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testSchedule", &CStaticThreadPoolTest::testSchedule));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testParallelForEach",
+        &CStaticThreadPoolTest::testParallelForEach));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testEmptyPool", &CStaticThreadPoolTest::testEmptyPool));
+
+    return suiteOfTests;
+}
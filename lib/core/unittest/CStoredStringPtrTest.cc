@@ -22,6 +22,8 @@ CppUnit::Test* CStoredStringPtrTest::suite() {
         "CStoredStringPtrTest::testMemoryUsage", &CStoredStringPtrTest::testMemoryUsage));
     suiteOfTests->addTest(new CppUnit::TestCaller<CStoredStringPtrTest>(
         "CStoredStringPtrTest::testHash", &CStoredStringPtrTest::testHash));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStoredStringPtrTest>(
+        "CStoredStringPtrTest::testWeak", &CStoredStringPtrTest::testWeak));
 
     return suiteOfTests;
 }
@@ -124,3 +126,27 @@ void CStoredStringPtrTest::testHash() {
 
     CPPUNIT_ASSERT_EQUAL(std::size_t(1), s.count(key));
 }
+
+void CStoredStringPtrTest::testWeak() {
+    {
+        ml::core::CStoredStringPtr::CWeak null;
+        CPPUNIT_ASSERT(null.lock() == nullptr);
+    }
+    {
+        ml::core::CStoredStringPtr ptr =
+            ml::core::CStoredStringPtr::makeStoredString("weak");
+        ml::core::CStoredStringPtr::CWeak weak(ptr);
+
+        // Weak references don't affect uniqueness.
+        CPPUNIT_ASSERT(ptr.isUnique());
+
+        ml::core::CStoredStringPtr locked = weak.lock();
+        CPPUNIT_ASSERT(locked == ptr);
+        CPPUNIT_ASSERT_EQUAL(std::string("weak"), *locked);
+        CPPUNIT_ASSERT(ptr.isUnique() == false);
+
+        locked = ml::core::CStoredStringPtr();
+        ptr = ml::core::CStoredStringPtr();
+        CPPUNIT_ASSERT(weak.lock() == nullptr);
+    }
+}
@@ -6,9 +6,12 @@
 #include "CStringSimilarityTesterTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 #include <core/CStringSimilarityTester.h>
 #include <core/CTimeUtils.h>
 
+#include <test/CRandomNumbers.h>
+
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,6 +43,15 @@ CppUnit::Test* CStringSimilarityTesterTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
         "CStringSimilarityTesterTest::testWeightedEditDistance",
         &CStringSimilarityTesterTest::testWeightedEditDistance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
+        "CStringSimilarityTesterTest::testBitParallelEditDistance",
+        &CStringSimilarityTesterTest::testBitParallelEditDistance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
+        "CStringSimilarityTesterTest::testWeightedEditDistanceWithMaximum",
+        &CStringSimilarityTesterTest::testWeightedEditDistanceWithMaximum));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
+        "CStringSimilarityTesterTest::testEditDistanceThroughputTokens",
+        &CStringSimilarityTesterTest::testEditDistanceThroughputTokens));
 
     return suiteOfTests;
 }
@@ -442,3 +454,249 @@ void CStringSimilarityTesterTest::testWeightedEditDistance() {
     CPPUNIT_ASSERT_EQUAL(size_t(21), sst.weightedEditDistance(serviceStart, empty));
     CPPUNIT_ASSERT_EQUAL(size_t(21), sst.weightedEditDistance(empty, serviceStart));
 }
+
+namespace {
+using TSizeVec = std::vector<size_t>;
+using TSizeSizePr = std::pair<size_t, size_t>;
+using TSizeSizePrVec = std::vector<TSizeSizePr>;
+
+//! Randomly insert, delete and substitute \p edits symbols of \p sequence.
+void randomlyEdit(ml::test::CRandomNumbers& rng,
+                  size_t alphabet,
+                  size_t edits,
+                  TSizeVec& sequence) {
+    TSizeVec samples;
+    for (size_t edit = 0; edit < edits; ++edit) {
+        rng.generateUniformSamples(0, 3, 1, samples);
+        size_t operation(samples[0]);
+        rng.generateUniformSamples(0, sequence.size() + 1, 1, samples);
+        size_t position(samples[0]);
+        rng.generateUniformSamples(0, alphabet, 1, samples);
+        size_t symbol(samples[0]);
+        if (operation == 0 || sequence.empty()) {
+            sequence.insert(sequence.begin() + position, symbol);
+        } else if (operation == 1) {
+            sequence.erase(sequence.begin() + std::min(position, sequence.size() - 1));
+        } else {
+            sequence[std::min(position, sequence.size() - 1)] = symbol;
+        }
+    }
+}
+}
+
+void CStringSimilarityTesterTest::testBitParallelEditDistance() {
+    ml::core::CStringSimilarityTester sst;
+
+    // Some simple cases.
+    {
+        std::string cat("cat");
+        std::string mouse("mouse");
+        std::string empty;
+        CPPUNIT_ASSERT_EQUAL(size_t(0), sst.bitParallelEditDistance(cat, cat));
+        CPPUNIT_ASSERT_EQUAL(size_t(5), sst.bitParallelEditDistance(cat, mouse));
+        CPPUNIT_ASSERT_EQUAL(size_t(5), sst.bitParallelEditDistance(mouse, cat));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), sst.bitParallelEditDistance(cat, empty));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), sst.bitParallelEditDistance(empty, cat));
+        CPPUNIT_ASSERT(sst.bitParallelEditDistance(cat, mouse, 4) > 4);
+        CPPUNIT_ASSERT_EQUAL(size_t(5), sst.bitParallelEditDistance(cat, mouse, 5));
+    }
+
+    // Check against the Levenshtein distance for random sequences which
+    // span one and several 64 bit blocks with and without a maximum.
+
+    ml::test::CRandomNumbers rng;
+
+    TSizeVec lengths;
+    TSizeVec edits;
+    TSizeVec maxDistances{0, 1, 2, 5, 10, 30, 70, 150};
+
+    for (size_t alphabet : {2, 4, 20, 1000}) {
+        for (size_t t = 0; t < 100; ++t) {
+            rng.generateUniformSamples(0, 200, 1, lengths);
+            rng.generateUniformSamples(0, 80, 1, edits);
+            TSizeVec first;
+            rng.generateUniformSamples(0, alphabet, lengths[0], first);
+            TSizeVec second(first);
+            randomlyEdit(rng, alphabet, edits[0], second);
+
+            size_t expected(sst.levenshteinDistance(first, second));
+            CPPUNIT_ASSERT_EQUAL(expected, sst.bitParallelEditDistance(first, second));
+            CPPUNIT_ASSERT_EQUAL(expected, sst.bitParallelEditDistance(second, first));
+
+            for (auto maxDistance : maxDistances) {
+                size_t actual(sst.bitParallelEditDistance(first, second, maxDistance));
+                if (expected <= maxDistance) {
+                    CPPUNIT_ASSERT_EQUAL(expected, actual);
+                } else {
+                    CPPUNIT_ASSERT(actual > maxDistance);
+                }
+            }
+
+            // The weights of pairs are ignored.
+            TSizeSizePrVec firstPairs;
+            for (auto symbol : first) {
+                firstPairs.emplace_back(symbol, 3);
+            }
+            TSizeSizePrVec secondPairs;
+            for (auto symbol : second) {
+                secondPairs.emplace_back(symbol, 1);
+            }
+            CPPUNIT_ASSERT_EQUAL(expected, sst.bitParallelEditDistance(firstPairs, secondPairs));
+        }
+    }
+}
+
+void CStringSimilarityTesterTest::testWeightedEditDistanceWithMaximum() {
+    // Check that the weighted edit distance with a maximum is equal to the
+    // distance without a maximum if the distance is at most the maximum and
+    // greater than the maximum otherwise.
+
+    ml::core::CStringSimilarityTester sst;
+
+    ml::test::CRandomNumbers rng;
+
+    TSizeVec lengths;
+    TSizeVec edits;
+    TSizeVec weights;
+    TSizeVec maxDistances{0, 1, 3, 5, 10, 25, 60, 200};
+
+    for (size_t t = 0; t < 300; ++t) {
+        rng.generateUniformSamples(0, 100, 1, lengths);
+        rng.generateUniformSamples(0, 30, 1, edits);
+        TSizeVec first;
+        rng.generateUniformSamples(0, 20, lengths[0], first);
+        TSizeVec second(first);
+        randomlyEdit(rng, 20, edits[0], second);
+
+        // Weight tokens like dictionary words more heavily.
+        TSizeSizePrVec firstPairs;
+        rng.generateUniformSamples(0, 2, first.size(), weights);
+        for (size_t i = 0; i < first.size(); ++i) {
+            firstPairs.emplace_back(first[i], 1 + 2 * weights[i]);
+        }
+        TSizeSizePrVec secondPairs;
+        rng.generateUniformSamples(0, 2, second.size(), weights);
+        for (size_t i = 0; i < second.size(); ++i) {
+            secondPairs.emplace_back(second[i], 1 + 2 * weights[i]);
+        }
+
+        // The bit-parallel lower bound is only used for integer symbols.
+        using TStrSizePr = std::pair<std::string, size_t>;
+        using TStrSizePrVec = std::vector<TStrSizePr>;
+        TStrSizePrVec firstStrPairs;
+        for (const auto& pair : firstPairs) {
+            firstStrPairs.emplace_back(std::to_string(pair.first), pair.second);
+        }
+        TStrSizePrVec secondStrPairs;
+        for (const auto& pair : secondPairs) {
+            secondStrPairs.emplace_back(std::to_string(pair.first), pair.second);
+        }
+
+        size_t expected(sst.weightedEditDistance(firstPairs, secondPairs));
+        CPPUNIT_ASSERT_EQUAL(expected, sst.weightedEditDistance(firstStrPairs, secondStrPairs));
+
+        for (auto maxDistance : maxDistances) {
+            size_t actual(sst.weightedEditDistance(firstPairs, secondPairs, maxDistance));
+            size_t actualStr(sst.weightedEditDistance(firstStrPairs, secondStrPairs, maxDistance));
+            if (expected <= maxDistance) {
+                CPPUNIT_ASSERT_EQUAL(expected, actual);
+                CPPUNIT_ASSERT_EQUAL(expected, actualStr);
+            } else {
+                CPPUNIT_ASSERT(actual > maxDistance);
+                CPPUNIT_ASSERT(actualStr > maxDistance);
+            }
+        }
+    }
+}
+
+void CStringSimilarityTesterTest::testEditDistanceThroughputTokens() {
+    // Compare the speed of the edit distance calculations on sequences of
+    // token IDs which look like the tokens of log messages.  These are made
+    // from a number of message templates, each with some variable tokens.
+
+    ml::core::CStringSimilarityTester sst;
+
+    ml::test::CRandomNumbers rng;
+
+    static const size_t NUM_TEMPLATES(20);
+    static const size_t NUM_MESSAGES(500);
+
+    TSizeVec lengths;
+    TSizeVec tokens;
+    TSizeVec variable;
+    std::vector<TSizeSizePrVec> templates(NUM_TEMPLATES);
+    for (auto& messageTemplate : templates) {
+        rng.generateUniformSamples(5, 40, 1, lengths);
+        rng.generateUniformSamples(0, 300, lengths[0], tokens);
+        rng.generateUniformSamples(0, 4, lengths[0], variable);
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            // Variable tokens are never dictionary words so have weight 1.
+            messageTemplate.emplace_back(variable[i] == 0 ? 0 : tokens[i],
+                                         variable[i] == 0 ? 1 : 3);
+        }
+    }
+
+    std::vector<TSizeSizePrVec> messages;
+    TSizeVec choice;
+    for (size_t i = 0; i < NUM_MESSAGES; ++i) {
+        rng.generateUniformSamples(0, NUM_TEMPLATES, 1, choice);
+        TSizeSizePrVec message(templates[choice[0]]);
+        for (auto& token : message) {
+            if (token.second == 1) {
+                rng.generateUniformSamples(1000, 100000, 1, tokens);
+                token.first = tokens[0];
+            }
+        }
+        messages.push_back(std::move(message));
+    }
+
+    ml::core::CStopWatch stopWatch(true);
+    size_t totalLevenshtein(0);
+    for (const auto& first : messages) {
+        for (const auto& second : messages) {
+            totalLevenshtein += sst.levenshteinDistance(first, second);
+        }
+    }
+    uint64_t levenshteinTime(stopWatch.lap());
+
+    size_t totalBitParallel(0);
+    for (const auto& first : messages) {
+        for (const auto& second : messages) {
+            totalBitParallel += sst.bitParallelEditDistance(first, second);
+        }
+    }
+    uint64_t bitParallelTime(stopWatch.lap());
+
+    LOG_INFO(<< "Levenshtein distance of " << NUM_MESSAGES << "^2 token sequences took "
+             << levenshteinTime << "ms and bit-parallel edit distance took "
+             << bitParallelTime << "ms");
+    CPPUNIT_ASSERT_EQUAL(totalLevenshtein, totalBitParallel);
+
+    // The data typers are only interested in distances which would give a
+    // similarity of at least 0.7.
+    size_t totalWeighted(0);
+    size_t similar(0);
+    for (const auto& first : messages) {
+        for (const auto& second : messages) {
+            size_t distance(sst.weightedEditDistance(first, second));
+            totalWeighted += distance;
+            similar += distance <= 10 ? 1 : 0;
+        }
+    }
+    uint64_t weightedTime(stopWatch.lap());
+
+    size_t similarWithMaximum(0);
+    for (const auto& first : messages) {
+        for (const auto& second : messages) {
+            size_t distance(sst.weightedEditDistance(first, second, 10));
+            similarWithMaximum += distance <= 10 ? 1 : 0;
+        }
+    }
+    uint64_t weightedWithMaximumTime(stopWatch.stop());
+
+    LOG_INFO(<< "Weighted edit distance of " << NUM_MESSAGES << "^2 token sequences took "
+             << weightedTime << "ms and with a maximum distance took "
+             << weightedWithMaximumTime << "ms");
+    CPPUNIT_ASSERT(totalWeighted > 0);
+    CPPUNIT_ASSERT_EQUAL(similar, similarWithMaximum);
+}
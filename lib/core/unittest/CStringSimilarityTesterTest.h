@@ -17,6 +17,9 @@ public:
     void testLevensteinDistanceThroughputSimilar();
     void testLevensteinDistanceAlgorithmEquivalence();
     void testWeightedEditDistance();
+    void testBitParallelEditDistance();
+    void testWeightedEditDistanceWithMaximum();
+    void testEditDistanceThroughputTokens();
 
     static CppUnit::Test* suite();
 };
@@ -7,6 +7,8 @@
 
 #include "CAllocationStrategyTest.h"
 #include "CBase64FilterTest.h"
+#include "CBinaryStatePersistInserterTest.h"
+#include "CBinaryStateRestoreTraverserTest.h"
 #include "CBlockingMessageQueueTest.h"
 #include "CByteSwapperTest.h"
 #include "CCompressUtilsTest.h"
@@ -33,6 +35,7 @@
 #include "CMemoryUsageTest.h"
 #include "CMessageBufferTest.h"
 #include "CMessageQueueTest.h"
+#include "CMonotonicArenaTest.h"
 #include "CMonotonicTimeTest.h"
 #include "CMutexTest.h"
 #include "CNamedPipeFactoryTest.h"
@@ -52,11 +55,13 @@
 #include "CRegexFilterTest.h"
 #include "CRegexTest.h"
 #include "CResourceLocatorTest.h"
+#include "CRingBufferStreamBufTest.h"
 #include "CShellArgQuoterTest.h"
 #include "CSleepTest.h"
 #include "CSmallVectorTest.h"
 #include "CStateCompressorTest.h"
 #include "CStateMachineTest.h"
+#include "CStaticThreadPoolTest.h"
 #include "CStatisticsTest.h"
 #include "CStopWatchTest.h"
 #include "CStoredStringPtrTest.h"
@@ -81,6 +86,8 @@ int main(int argc, const char** argv) {
 
     runner.addTest(CAllocationStrategyTest::suite());
     runner.addTest(CBase64FilterTest::suite());
+    runner.addTest(CBinaryStatePersistInserterTest::suite());
+    runner.addTest(CBinaryStateRestoreTraverserTest::suite());
     runner.addTest(CBlockingMessageQueueTest::suite());
     runner.addTest(CByteSwapperTest::suite());
     runner.addTest(CCompressedDictionaryTest::suite());
@@ -107,6 +114,7 @@ int main(int argc, const char** argv) {
     runner.addTest(CMemoryUsageTest::suite());
     runner.addTest(CMessageBufferTest::suite());
     runner.addTest(CMessageQueueTest::suite());
+    runner.addTest(CMonotonicArenaTest::suite());
     runner.addTest(CMonotonicTimeTest::suite());
     runner.addTest(CMutexTest::suite());
     runner.addTest(CNamedPipeFactoryTest::suite());
@@ -126,11 +134,13 @@ int main(int argc, const char** argv) {
     runner.addTest(CRegexFilterTest::suite());
     runner.addTest(CRegexTest::suite());
     runner.addTest(CResourceLocatorTest::suite());
+    runner.addTest(CRingBufferStreamBufTest::suite());
     runner.addTest(CShellArgQuoterTest::suite());
     runner.addTest(CSleepTest::suite());
     runner.addTest(CSmallVectorTest::suite());
     runner.addTest(CStateCompressorTest::suite());
     runner.addTest(CStateMachineTest::suite());
+    runner.addTest(CStaticThreadPoolTest::suite());
     runner.addTest(CStatisticsTest::suite());
     runner.addTest(CStopWatchTest::suite());
     runner.addTest(CStoredStringPtrTest::suite());
@@ -6,6 +6,7 @@
 
 #include <maths/CExpandingWindow.h>
 
+#include <core/CCompressUtils.h>
 #include <core/CPersistUtils.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
@@ -17,6 +18,7 @@
 #include <maths/CMathsFuncs.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 
 namespace ml {
@@ -25,6 +27,20 @@ namespace {
 const std::string BUCKET_LENGTH_INDEX_TAG("a");
 const std::string BUCKET_VALUES_TAG("b");
 const std::string START_TIME_TAG("c");
+
+//! The maximum number of distinct buckets for which values are buffered
+//! before the buffer is deflated.
+const std::size_t MAXIMUM_BUFFER_SIZE{8};
+
+//! The deflated buffers are merged into the deflated bucket values once
+//! they use at least this fraction of the latter's memory. On windows of
+//! 336 buckets of noisy values a quarter needs around a sixth of the time
+//! per value of inflating and deflating the whole window for every buffer
+//! and uses around 15% more memory.
+const std::size_t DEFLATED_BUFFER_FRACTION{4};
+
+//! A full buffer stored as (bucket, count, mean) triples.
+using TFloatBufferArray = std::array<float, 3 * MAXIMUM_BUFFER_SIZE>;
 }
 
 CExpandingWindow::CExpandingWindow(core_t::TTime bucketLength,
@@ -34,11 +50,15 @@ CExpandingWindow::CExpandingWindow(core_t::TTime bucketLength,
     : m_DecayRate(decayRate), m_BucketLength(bucketLength),
       m_BucketLengths(bucketLengths), m_BucketLengthIndex(0),
       m_StartTime(boost::numeric::bounds<core_t::TTime>::lowest()),
-      m_BucketValues(size % 2 == 0 ? size : size + 1) {
+      m_Size(size % 2 == 0 ? size : size + 1), m_Deflate(false),
+      m_BucketValues(m_Size) {
 }
 
 bool CExpandingWindow::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
     m_BucketValues.clear();
+    m_DeflatedBucketValues.clear();
+    m_DeflatedBufferedValues.clear();
+    m_BufferedValues.clear();
     do {
         const std::string& name = traverser.name();
         RESTORE_BUILT_IN(BUCKET_LENGTH_INDEX_TAG, m_BucketLengthIndex)
@@ -46,13 +66,28 @@ bool CExpandingWindow::acceptRestoreTraverser(core::CStateRestoreTraverser& trav
         RESTORE(BUCKET_VALUES_TAG,
                 core::CPersistUtils::restore(BUCKET_VALUES_TAG, m_BucketValues, traverser));
     } while (traverser.next());
+    m_Size = m_BucketValues.size();
+    this->deflateBucketValues();
     return true;
 }
 
 void CExpandingWindow::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
+    TFloatMeanAccumulatorVec workspace;
     inserter.insertValue(BUCKET_LENGTH_INDEX_TAG, m_BucketLengthIndex);
     inserter.insertValue(START_TIME_TAG, m_StartTime);
-    core::CPersistUtils::persist(BUCKET_VALUES_TAG, m_BucketValues, inserter);
+    core::CPersistUtils::persist(BUCKET_VALUES_TAG, this->bucketValues(workspace), inserter);
+}
+
+void CExpandingWindow::deflate(bool deflate) {
+    if (deflate != m_Deflate) {
+        this->inflateBucketValues();
+        m_Deflate = deflate;
+        this->deflateBucketValues();
+    }
+}
+
+bool CExpandingWindow::deflated() const {
+    return m_Deflate;
 }
 
 core_t::TTime CExpandingWindow::startTime() const {
@@ -60,7 +95,7 @@ core_t::TTime CExpandingWindow::startTime() const {
 }
 
 core_t::TTime CExpandingWindow::endTime() const {
-    return m_StartTime + (static_cast<core_t::TTime>(m_BucketValues.size()) *
+    return m_StartTime + (static_cast<core_t::TTime>(m_Size) *
                           m_BucketLengths[m_BucketLengthIndex]);
 }
 
@@ -68,15 +103,19 @@ core_t::TTime CExpandingWindow::bucketLength() const {
     return m_BucketLengths[m_BucketLengthIndex];
 }
 
-const CExpandingWindow::TFloatMeanAccumulatorVec& CExpandingWindow::values() const {
-    return m_BucketValues;
+CExpandingWindow::TFloatMeanAccumulatorVec CExpandingWindow::values() const {
+    TFloatMeanAccumulatorVec workspace;
+    if (&this->bucketValues(workspace) == &m_BucketValues) {
+        return m_BucketValues;
+    }
+    return workspace;
 }
 
 CExpandingWindow::TFloatMeanAccumulatorVec
 CExpandingWindow::valuesMinusPrediction(const TPredictor& predictor) const {
     core_t::TTime start{CIntegerTools::floor(this->startTime(), m_BucketLength)};
     core_t::TTime end{CIntegerTools::ceil(this->endTime(), m_BucketLength)};
-    core_t::TTime size{static_cast<core_t::TTime>(m_BucketValues.size())};
+    core_t::TTime size{static_cast<core_t::TTime>(m_Size)};
     core_t::TTime offset{
         static_cast<core_t::TTime>(CBasicStatistics::mean(m_MeanOffset) + 0.5)};
 
@@ -88,7 +127,7 @@ CExpandingWindow::valuesMinusPrediction(const TPredictor& predictor) const {
         }
     }
 
-    TFloatMeanAccumulatorVec result(m_BucketValues);
+    TFloatMeanAccumulatorVec result(this->values());
     for (core_t::TTime i = 0; i < size; ++i) {
         if (CBasicStatistics::count(result[i]) > 0.0) {
             CBasicStatistics::moment<0>(result[i]) -=
@@ -108,13 +147,18 @@ void CExpandingWindow::propagateForwardsByTime(double time) {
         LOG_ERROR(<< "Bad propagation time " << time);
     }
     double factor = std::exp(-m_DecayRate * time);
+    this->inflateBucketValues();
     for (auto& value : m_BucketValues) {
         value.age(factor);
     }
+    this->deflateBucketValues();
 }
 
 void CExpandingWindow::add(core_t::TTime time, double value, double weight) {
     if (time >= m_StartTime) {
+        if (this->needToCompress(time)) {
+            this->inflateBucketValues();
+        }
         while (this->needToCompress(time)) {
             m_BucketLengthIndex = (m_BucketLengthIndex + 1) % m_BucketLengths.size();
             auto end = m_BucketValues.begin();
@@ -135,8 +179,24 @@ void CExpandingWindow::add(core_t::TTime time, double value, double weight) {
             std::fill(end, m_BucketValues.end(), TFloatMeanAccumulator());
         }
 
-        m_BucketValues[(time - m_StartTime) / m_BucketLengths[m_BucketLengthIndex]]
-            .add(value, weight);
+        std::size_t bucket((time - m_StartTime) / m_BucketLengths[m_BucketLengthIndex]);
+        if (m_BucketValues.empty()) {
+            auto i = std::find_if(m_BufferedValues.begin(), m_BufferedValues.end(),
+                                  [bucket](const TSizeFloatMeanAccumulatorPr& value) {
+                                      return value.first == bucket;
+                                  });
+            if (i == m_BufferedValues.end()) {
+                if (m_BufferedValues.size() >= MAXIMUM_BUFFER_SIZE) {
+                    this->deflateBufferedValues();
+                }
+                m_BufferedValues.emplace_back(bucket, TFloatMeanAccumulator());
+                i = m_BufferedValues.end() - 1;
+            }
+            i->second.add(value, weight);
+        } else {
+            m_BucketValues[bucket].add(value, weight);
+        }
+        this->deflateBucketValues();
         m_MeanOffset.add(static_cast<double>(time % m_BucketLength));
     }
 }
@@ -145,19 +205,142 @@ bool CExpandingWindow::needToCompress(core_t::TTime time) const {
     return time >= this->endTime();
 }
 
+bool CExpandingWindow::needToRestart(core_t::TTime time) const {
+    return time >= m_StartTime + static_cast<core_t::TTime>(m_Size) * m_BucketLengths.back();
+}
+
 uint64_t CExpandingWindow::checksum(uint64_t seed) const {
     seed = CChecksum::calculate(seed, m_BucketLengthIndex);
     seed = CChecksum::calculate(seed, m_StartTime);
-    return CChecksum::calculate(seed, m_BucketValues);
+    TFloatMeanAccumulatorVec workspace;
+    return CChecksum::calculate(seed, this->bucketValues(workspace));
 }
 
 void CExpandingWindow::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("CScanningPeriodicityTest");
     core::CMemoryDebug::dynamicSize("m_BucketValues", m_BucketValues, mem);
+    core::CMemoryDebug::dynamicSize("m_DeflatedBucketValues", m_DeflatedBucketValues, mem);
+    core::CMemoryDebug::dynamicSize("m_DeflatedBufferedValues",
+                                    m_DeflatedBufferedValues, mem);
+    core::CMemoryDebug::dynamicSize("m_BufferedValues", m_BufferedValues, mem);
 }
 
 std::size_t CExpandingWindow::memoryUsage() const {
-    return core::CMemory::dynamicSize(m_BucketValues);
+    return core::CMemory::dynamicSize(m_BucketValues) +
+           core::CMemory::dynamicSize(m_DeflatedBucketValues) +
+           core::CMemory::dynamicSize(m_DeflatedBufferedValues) +
+           core::CMemory::dynamicSize(m_BufferedValues);
+}
+
+const CExpandingWindow::TFloatMeanAccumulatorVec&
+CExpandingWindow::bucketValues(TFloatMeanAccumulatorVec& workspace) const {
+    // Values are only buffered while the bucket values are deflated.
+    if (m_BucketValues.size() > 0 || m_Size == 0) {
+        return m_BucketValues;
+    }
+    workspace.assign(m_Size, TFloatMeanAccumulator());
+    if (m_DeflatedBucketValues.size() > 0) {
+        // The counts are stored before the means because they compress
+        // better this way.
+        std::vector<float> values(2 * m_Size);
+        if (core::CCompressUtils::inflateBytes(m_DeflatedBucketValues, values.data(),
+                                               values.size() * sizeof(float)) == false) {
+            LOG_ERROR(<< "Failed to inflate bucket values");
+            values.assign(values.size(), 0.0f);
+        }
+        for (std::size_t i = 0u; i < m_Size; ++i) {
+            workspace[i] = CBasicStatistics::accumulator(
+                CFloatStorage(values[i]), CFloatStorage(values[m_Size + i]));
+        }
+    }
+    for (std::size_t i = 0u; i < m_DeflatedBufferedValues.size();
+         i += 1 + m_DeflatedBufferedValues[i]) {
+        TFloatBufferArray values;
+        if (core::CCompressUtils::inflateBytes(
+                &m_DeflatedBufferedValues[i + 1], m_DeflatedBufferedValues[i],
+                values.data(), sizeof(values)) == false) {
+            LOG_ERROR(<< "Failed to inflate buffered values");
+            break;
+        }
+        for (std::size_t j = 0u; j < values.size(); j += 3) {
+            std::size_t bucket{static_cast<std::size_t>(values[j])};
+            if (bucket < m_Size) {
+                workspace[bucket] += CBasicStatistics::accumulator(
+                    CFloatStorage(values[j + 1]), CFloatStorage(values[j + 2]));
+            }
+        }
+    }
+    for (const auto& value : m_BufferedValues) {
+        workspace[value.first] += value.second;
+    }
+    return workspace;
+}
+
+void CExpandingWindow::inflateBucketValues() {
+    if (m_BucketValues.empty()) {
+        TFloatMeanAccumulatorVec workspace;
+        this->bucketValues(workspace);
+        m_BucketValues.swap(workspace);
+    }
+    TByteVec().swap(m_DeflatedBufferedValues);
+    m_BufferedValues.clear();
+}
+
+void CExpandingWindow::deflateBufferedValues() {
+    if (DEFLATED_BUFFER_FRACTION * m_DeflatedBufferedValues.size() >=
+        m_DeflatedBucketValues.size()) {
+        this->inflateBucketValues();
+        this->deflateBucketValues();
+        return;
+    }
+
+    TFloatBufferArray values;
+    for (std::size_t i = 0u; i < MAXIMUM_BUFFER_SIZE; ++i) {
+        values[3 * i] = static_cast<float>(m_BufferedValues[i].first);
+        values[3 * i + 1] =
+            static_cast<float>(CBasicStatistics::count(m_BufferedValues[i].second));
+        values[3 * i + 2] =
+            static_cast<float>(CBasicStatistics::mean(m_BufferedValues[i].second));
+    }
+    // A buffer deflates to well under 256 bytes so its length fits in the
+    // byte before it.
+    TByteVec deflated;
+    if (core::CCompressUtils::deflateBytes(values.data(), sizeof(values),
+                                           deflated, Z_BEST_SPEED) == false) {
+        LOG_ERROR(<< "Failed to deflate buffered values");
+        this->inflateBucketValues();
+        this->deflateBucketValues();
+        return;
+    }
+    m_DeflatedBufferedValues.reserve(m_DeflatedBufferedValues.size() + 1 +
+                                     deflated.size());
+    m_DeflatedBufferedValues.push_back(static_cast<unsigned char>(deflated.size()));
+    m_DeflatedBufferedValues.insert(m_DeflatedBufferedValues.end(),
+                                    deflated.begin(), deflated.end());
+    m_BufferedValues.clear();
+}
+
+void CExpandingWindow::deflateBucketValues() {
+    if (m_Deflate == false || m_BucketValues.empty()) {
+        return;
+    }
+    std::vector<float> values(2 * m_Size, 0.0f);
+    bool empty{true};
+    for (std::size_t i = 0u; i < m_Size; ++i) {
+        values[i] = static_cast<float>(CBasicStatistics::count(m_BucketValues[i]));
+        values[m_Size + i] = static_cast<float>(CBasicStatistics::mean(m_BucketValues[i]));
+        empty &= values[i] == 0.0f;
+    }
+    if (empty) {
+        m_DeflatedBucketValues.clear();
+    } else if (core::CCompressUtils::deflateBytes(values.data(), values.size() * sizeof(float),
+                                                  m_DeflatedBucketValues,
+                                                  Z_BEST_SPEED) == false) {
+        LOG_ERROR(<< "Failed to deflate bucket values");
+        return;
+    }
+    m_DeflatedBucketValues.shrink_to_fit();
+    TFloatMeanAccumulatorVec().swap(m_BucketValues);
 }
 }
 }
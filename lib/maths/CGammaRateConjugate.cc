@@ -21,6 +21,7 @@
 #include <maths/COrderings.h>
 #include <maths/CRestoreParams.h>
 #include <maths/CSolvers.h>
+#include <maths/CSpecialFunctions.h>
 #include <maths/CTools.h>
 #include <maths/ProbabilityAggregators.h>
 
@@ -452,12 +453,183 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute minus the log of the joint c.d.f., or its complement if
+//! \p complement is true, of \p samples at each of \p n offsets
+//! \p offset + \p x.
+//!
+//! This is equivalent to evaluateFunctionOnJointDistribution using
+//! CTools::SMinusLogCdf, or CTools::SMinusLogCdfComplement, and SPlusWeight
+//! at each offset, but evaluates the c.d.f. for all the samples and offsets
+//! in one batch with the vectorised special functions.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+bool minusLogJointCdf(bool complement,
+                      const TDouble1Vec& samples,
+                      const TDoubleWeightsAry1Vec& weights,
+                      bool isNonInformative,
+                      double offset,
+                      const double* x,
+                      std::size_t n,
+                      double likelihoodShape,
+                      double priorShape,
+                      double priorRate,
+                      double* result) {
+    std::fill_n(result, n, 0.0);
+
+    if (samples.empty()) {
+        LOG_ERROR(<< "Can't compute distribution for empty sample set");
+        return false;
+    }
+
+    if (isNonInformative) {
+        double minusLogCdf{complement ? CTools::SMinusLogCdfComplement()(
+                                            CTools::SImproperDistribution(), 0.0)
+                                      : CTools::SMinusLogCdf()(
+                                            CTools::SImproperDistribution(), 0.0)};
+        double total{0.0};
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            total += maths_t::count(weights[i]) * minusLogCdf;
+        }
+        std::fill_n(result, n, total);
+        return true;
+    }
+
+    static const double MINIMUM_GAMMA_SHAPE = 100.0;
+
+    // The arguments for the j'th offset and i'th sample are at j * m + i.
+    std::size_t m{samples.size()};
+    TDouble1Vec a(m * n);
+    TDouble1Vec b(m * n);
+    TDouble1Vec z(m * n);
+    TDouble1Vec cdf(m * n);
+
+    // See evaluateFunctionOnJointDistribution for details of the
+    // distributions.
+    if (priorShape > 2 && priorShape > likelihoodShape * MINIMUM_GAMMA_SHAPE) {
+        double shape = (priorShape - 2.0) / (priorShape - 1.0) * likelihoodShape;
+        double rate = (priorShape - 2.0) / priorRate;
+        for (std::size_t i = 0u; i < m; ++i) {
+            double varianceScale = maths_t::seasonalVarianceScale(weights[i]) *
+                                   maths_t::countVarianceScale(weights[i]);
+            for (std::size_t j = 0u, k = i; j < n; ++j, k += m) {
+                a[k] = shape / varianceScale;
+                b[k] = varianceScale / rate;
+                z[k] = samples[i] + offset + x[j];
+            }
+        }
+        CSpecialFunctions::gammaCdf(a.data(), b.data(), z.data(), m * n,
+                                    cdf.data(), complement);
+    } else {
+        for (std::size_t i = 0u; i < m; ++i) {
+            double varianceScale = maths_t::seasonalVarianceScale(weights[i]) *
+                                   maths_t::countVarianceScale(weights[i]);
+            double scaledPriorRate = varianceScale * priorRate;
+            for (std::size_t j = 0u, k = i; j < n; ++j, k += m) {
+                double xk = samples[i] + offset + x[j];
+                a[k] = likelihoodShape / varianceScale;
+                b[k] = priorShape;
+                z[k] = xk > 0.0 ? xk / (scaledPriorRate + xk) : 0.0;
+            }
+        }
+        CSpecialFunctions::incompleteBeta(a.data(), b.data(), z.data(), m * n,
+                                          cdf.data(), complement);
+    }
+
+    for (std::size_t j = 0u, k = 0u; j < n; ++j) {
+        for (std::size_t i = 0u; i < m; ++i, ++k) {
+            double xk = samples[i] + offset + x[j];
+            if (CMathsFuncs::isNan(xk)) {
+                LOG_ERROR(<< "x = NaN");
+                cdf[k] = 0.0;
+            } else if (xk <= 0.0) {
+                cdf[k] = complement ? 1.0 : 0.0;
+            } else if (CMathsFuncs::isNan(cdf[k])) {
+                LOG_ERROR(<< "Error calculating joint distribution: offset = "
+                          << offset + x[j] << ", likelihoodShape = " << likelihoodShape
+                          << ", priorShape = " << priorShape << ", priorRate = " << priorRate
+                          << ", samples = " << core::CContainerPrinter::print(samples));
+                return false;
+            }
+            result[j] += maths_t::count(weights[i]) * CTools::safeMinusLogCdf(cdf[k]);
+        }
+        LOG_TRACE(<< "result = " << result[j]);
+    }
+
+    return true;
+}
+
+//! Evaluate \p func on the joint predictive distribution for \p samples
+//! at each of \p n offsets \p offset + \p x.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+template<typename FUNC, typename AGGREGATOR>
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         FUNC func,
+                                         AGGREGATOR aggregate,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double likelihoodShape,
+                                         double priorShape,
+                                         double priorRate,
+                                         double* result) {
+    for (std::size_t i = 0u; i < n; ++i) {
+        if (!evaluateFunctionOnJointDistribution(
+                samples, weights, func, aggregate, isNonInformative, offset + x[i],
+                likelihoodShape, priorShape, priorRate, result[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Overload for minus the log of the c.d.f. which evaluates all the samples
+//! and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdf,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double likelihoodShape,
+                                         double priorShape,
+                                         double priorRate,
+                                         double* result) {
+    return minusLogJointCdf(false, samples, weights, isNonInformative, offset, x, n,
+                            likelihoodShape, priorShape, priorRate, result);
+}
+
+//! Overload for minus the log of the c.d.f. complement which evaluates all
+//! the samples and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdfComplement,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double likelihoodShape,
+                                         double priorShape,
+                                         double priorRate,
+                                         double* result) {
+    return minusLogJointCdf(true, samples, weights, isNonInformative, offset, x, n,
+                            likelihoodShape, priorShape, priorRate, result);
+}
+
 //! Evaluates a specified function object, which must be default constructible,
 //! on the joint distribution of a set of the samples at a specified offset.
 //!
 //! This thin wrapper around the evaluateFunctionOnJointDistribution function
 //! so that it can be integrated over the hidden variable representing the
 //! actual value of a discrete datum which we assume is in the interval [n, n+1].
+//! It supports both the scalar and batched integration interfaces.
 template<typename F>
 class CEvaluateOnSamples : core::CNonCopyable {
 public:
@@ -473,9 +645,13 @@ public:
           m_PriorShape(priorShape), m_PriorRate(priorRate) {}
 
     bool operator()(double x, double& result) const {
+        return (*this)(&x, 1, &result);
+    }
+
+    bool operator()(const double* x, std::size_t n, double* result) const {
         return evaluateFunctionOnJointDistribution(
-            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative,
-            m_Offset + x, m_LikelihoodShape, m_PriorShape, m_PriorRate, result);
+            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, m_Offset,
+            x, n, m_LikelihoodShape, m_PriorShape, m_PriorRate, result);
     }
 
 private:
@@ -623,6 +799,16 @@ public:
         return true;
     }
 
+    //! Evaluate the log marginal likelihood at the \p n offsets \p x.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        for (std::size_t i = 0u; i < n; ++i) {
+            if (!(*this)(x[i], result[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     //! Retrieve the error status for the integration.
     maths_t::EFloatingPointErrorStatus errorStatus() const {
         return m_ErrorStatus;
@@ -1146,7 +1332,7 @@ CGammaRateConjugate::jointLogMarginalLikelihood(const TDouble1Vec& samples,
             // If the data are discrete we compute the approximate expectation
             // w.r.t. to the hidden offset of the samples Z, which is uniform
             // on the interval [0,1].
-            CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+            CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 logMarginalLikelihood, 0.0, 1.0, result);
         } else {
             logMarginalLikelihood(0.0, result);
@@ -1315,7 +1501,7 @@ bool CGammaRateConjugate::minusLogJointCdf(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdf, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. for "
                       << core::CContainerPrinter::print(samples));
@@ -1355,7 +1541,7 @@ bool CGammaRateConjugate::minusLogJointCdfComplement(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdfComplement, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. complement for "
                       << core::CContainerPrinter::print(samples));
@@ -22,6 +22,7 @@
 #include <maths/CMathsFuncs.h>
 #include <maths/COrderings.h>
 #include <maths/CRestoreParams.h>
+#include <maths/CSpecialFunctions.h>
 #include <maths/CTools.h>
 #include <maths/ProbabilityAggregators.h>
 
@@ -57,6 +58,7 @@ inline double pow2(double x) {
 }
 
 const double MINIMUM_LOGNORMAL_SHAPE = 100.0;
+const double LOG_2_PI = std::log(boost::math::double_constants::two_pi);
 
 namespace detail {
 
@@ -215,12 +217,184 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute minus the log of the joint c.d.f., or its complement if
+//! \p complement is true, of \p samples at each of \p n offsets
+//! \p offset + \p x.
+//!
+//! This is equivalent to evaluateFunctionOnJointDistribution using
+//! CTools::SMinusLogCdf, or CTools::SMinusLogCdfComplement, and SPlusWeight
+//! at each offset, but evaluates the c.d.f. for all the samples and offsets
+//! in one batch with the vectorised special functions. Both the log-normal
+//! and log t c.d.f.s are evaluated by transforming the samples to log space.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+bool minusLogJointCdf(bool complement,
+                      const TDouble1Vec& samples,
+                      const TDoubleWeightsAry1Vec& weights,
+                      bool isNonInformative,
+                      double offset,
+                      const double* x,
+                      std::size_t n,
+                      double shape,
+                      double rate,
+                      double mean,
+                      double precision,
+                      double* result) {
+    std::fill_n(result, n, 0.0);
+
+    if (samples.empty()) {
+        LOG_ERROR(<< "Can't compute distribution for empty sample set");
+        return false;
+    }
+
+    if (isNonInformative) {
+        double minusLogCdf{complement ? CTools::SMinusLogCdfComplement()(
+                                            CTools::SImproperDistribution(), 0.0)
+                                      : CTools::SMinusLogCdf()(
+                                            CTools::SImproperDistribution(), 0.0)};
+        double total{0.0};
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            total += maths_t::count(weights[i]) * minusLogCdf;
+        }
+        std::fill_n(result, n, total);
+        return true;
+    }
+
+    double r = rate / shape;
+    double s = std::exp(-r);
+
+    // The arguments for the j'th offset and i'th sample are at j * m + i.
+    std::size_t m{samples.size()};
+    TDouble1Vec locations(m * n);
+    TDouble1Vec scales(m * n);
+    TDouble1Vec logx(m * n);
+    TDouble1Vec cdf(m * n);
+
+    for (std::size_t i = 0u; i < m; ++i) {
+        double varianceScale = maths_t::seasonalVarianceScale(weights[i]) *
+                               maths_t::countVarianceScale(weights[i]);
+        double location;
+        double scale;
+        locationAndScale(varianceScale, r, s, mean, precision, rate, shape, location, scale);
+        for (std::size_t j = 0u, k = i; j < n; ++j, k += m) {
+            double xk = samples[i] + offset + x[j];
+            locations[k] = location;
+            scales[k] = scale;
+            logx[k] = xk > 0.0 ? std::log(xk) : location;
+        }
+    }
+
+    // See evaluateFunctionOnJointDistribution for details of the
+    // distributions.
+    if (shape > MINIMUM_LOGNORMAL_SHAPE) {
+        CSpecialFunctions::normalCdf(locations.data(), scales.data(), logx.data(),
+                                     m * n, cdf.data(), complement);
+    } else {
+        for (std::size_t k = 0u; k < m * n; ++k) {
+            logx[k] = (logx[k] - locations[k]) / scales[k];
+            locations[k] = 2.0 * shape;
+        }
+        CSpecialFunctions::studentsTCdf(locations.data(), logx.data(), m * n,
+                                        cdf.data(), complement);
+    }
+
+    for (std::size_t j = 0u, k = 0u; j < n; ++j) {
+        for (std::size_t i = 0u; i < m; ++i, ++k) {
+            double xk = samples[i] + offset + x[j];
+            if (CMathsFuncs::isNan(xk)) {
+                LOG_ERROR(<< "x = NaN");
+                cdf[k] = 0.0;
+            } else if (xk <= 0.0) {
+                cdf[k] = complement ? 1.0 : 0.0;
+            } else if (CMathsFuncs::isNan(cdf[k])) {
+                LOG_ERROR(<< "Error calculating joint c.d.f.: shape = " << shape
+                          << ", rate = " << rate << ", mean = " << mean
+                          << ", precision = " << precision);
+                return false;
+            }
+            result[j] += maths_t::count(weights[i]) * CTools::safeMinusLogCdf(cdf[k]);
+        }
+        LOG_TRACE(<< "result = " << result[j]);
+    }
+
+    return true;
+}
+
+//! Evaluate \p func on the joint predictive distribution for \p samples
+//! at each of \p n offsets \p offset + \p x.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+template<typename FUNC, typename AGGREGATOR>
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         FUNC func,
+                                         AGGREGATOR aggregate,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double* result) {
+    for (std::size_t i = 0u; i < n; ++i) {
+        if (!evaluateFunctionOnJointDistribution(samples, weights, func, aggregate,
+                                                 isNonInformative, offset + x[i], shape,
+                                                 rate, mean, precision, result[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Overload for minus the log of the c.d.f. which evaluates all the samples
+//! and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdf,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double* result) {
+    return minusLogJointCdf(false, samples, weights, isNonInformative, offset, x,
+                            n, shape, rate, mean, precision, result);
+}
+
+//! Overload for minus the log of the c.d.f. complement which evaluates all
+//! the samples and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdfComplement,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         double offset,
+                                         const double* x,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double* result) {
+    return minusLogJointCdf(true, samples, weights, isNonInformative, offset, x,
+                            n, shape, rate, mean, precision, result);
+}
+
 //! \brief Evaluates a specified function object, which must be default constructible,
 //! on the joint distribution of a set of the samples at a specified offset.
 //!
 //! This thin wrapper around the evaluateFunctionOnJointDistribution function
 //! so that it can be integrated over the hidden variable representing the
 //! actual value of a discrete datum which we assume is in the interval [n, n+1].
+//! It supports both the scalar and batched integration interfaces.
 template<typename F>
 class CEvaluateOnSamples : core::CNonCopyable {
 public:
@@ -237,9 +411,13 @@ public:
           m_Precision(precision), m_Shape(shape), m_Rate(rate) {}
 
     bool operator()(double x, double& result) const {
+        return (*this)(&x, 1, &result);
+    }
+
+    bool operator()(const double* x, std::size_t n, double* result) const {
         return evaluateFunctionOnJointDistribution(
-            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative,
-            m_Offset + x, m_Shape, m_Rate, m_Mean, m_Precision, result);
+            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, m_Offset,
+            x, n, m_Shape, m_Rate, m_Mean, m_Precision, result);
     }
 
 private:
@@ -481,6 +659,16 @@ public:
         return true;
     }
 
+    //! Evaluate the log marginal likelihood at the \p n offsets \p x.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        for (std::size_t i = 0u; i < n; ++i) {
+            if (!(*this)(x[i], result[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     //! Retrieve the error status for the integration.
     maths_t::EFloatingPointErrorStatus errorStatus() const {
         return m_ErrorStatus;
@@ -1131,7 +1319,7 @@ CLogNormalMeanPrecConjugate::jointLogMarginalLikelihood(const TDouble1Vec& sampl
         samples, weights, m_Offset, m_GaussianMean, m_GaussianPrecision,
         m_GammaShape, m_GammaRate);
     if (this->isInteger()) {
-        CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
             logMarginalLikelihood, 0.0, 1.0, result);
     } else {
         logMarginalLikelihood(0.0, result);
@@ -1278,7 +1466,7 @@ bool CLogNormalMeanPrecConjugate::minusLogJointCdf(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdf, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. for "
                       << core::CContainerPrinter::print(samples));
@@ -1318,7 +1506,7 @@ bool CLogNormalMeanPrecConjugate::minusLogJointCdfComplement(const TDouble1Vec&
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdfComplement, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. complement for "
                       << core::CContainerPrinter::print(samples));
@@ -1502,6 +1690,165 @@ void CLogNormalMeanPrecConjugate::acceptPersistInserter(core::CStatePersistInser
                          core::CIEEE754::E_SinglePrecision);
 }
 
+bool CLogNormalMeanPrecConjugate::batchProbabilityOfLessLikelySamples(
+    maths_t::EProbabilityCalculation calculation,
+    const TLogNormalCPtrVec& priors,
+    const SSampleBatch& samples,
+    TDoubleVec& lowerBounds,
+    TDoubleVec& upperBounds,
+    TTailVec& tails) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+    tails.assign(n, maths_t::E_UndeterminedTail);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, locations, scales;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CLogNormalMeanPrecConjugate& prior{*priors[i]};
+        if (samples.s_Counts[i] == 1.0 &&
+            prior.gatherLogNormalApproximation(samples, i, x, locations, scales)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleProbabilityOfLessLikelySamples(calculation, prior, samples, i,
+                                                           lowerBounds[i],
+                                                           upperBounds[i], tails[i]);
+        }
+    }
+
+    TDoubleVec probabilities;
+    TTailVec tails_;
+    logNormalProbabilityOfLessLikelySamples(calculation, x, locations, scales,
+                                            probabilities, tails_);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] = probabilities[i];
+        tails[lanes[i]] = tails_[i];
+    }
+
+    return result;
+}
+
+bool CLogNormalMeanPrecConjugate::batchMinusLogJointCdf(const TLogNormalCPtrVec& priors,
+                                                        const SSampleBatch& samples,
+                                                        TDoubleVec& lowerBounds,
+                                                        TDoubleVec& upperBounds) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, locations, scales;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CLogNormalMeanPrecConjugate& prior{*priors[i]};
+        if (prior.gatherLogNormalApproximation(samples, i, x, locations, scales)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleMinusLogJointCdf(prior, samples, i, lowerBounds[i],
+                                             upperBounds[i]);
+        }
+    }
+
+    // The log-normal c.d.f. at x is the normal c.d.f. at log(x).
+    for (auto& xi : x) {
+        xi = std::log(xi);
+    }
+    TDoubleVec minusLogCdfs;
+    normalMinusLogCdf(x, locations, scales, minusLogCdfs);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] =
+            samples.s_Counts[lanes[i]] * minusLogCdfs[i];
+    }
+
+    return result;
+}
+
+maths_t::EFloatingPointErrorStatus
+CLogNormalMeanPrecConjugate::batchJointLogMarginalLikelihood(const TLogNormalCPtrVec& priors,
+                                                             const SSampleBatch& samples,
+                                                             TDoubleVec& results) {
+
+    std::size_t n{priors.size()};
+    results.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return maths_t::E_FpFailed;
+    }
+
+    // For a single sample the log sample square deviation is zero and
+    // the log marginal likelihood (see detail::CLogMarginalLikelihood)
+    // is a simple closed form expression. We only need to integrate over
+    // the hidden offset for integer data.
+
+    int status{maths_t::E_FpNoErrors};
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CLogNormalMeanPrecConjugate& prior{*priors[i]};
+        double x{samples.s_Samples[i] + prior.m_Offset};
+        double count{samples.s_Counts[i] * samples.s_WinsorisationWeights[i]};
+        if (prior.isInteger() || prior.isNonInformative() || !(count > 0.0) ||
+            !(x > 0.0) || !CMathsFuncs::isFinite(x)) {
+            status |= singleJointLogMarginalLikelihood(prior, samples, i, results[i]);
+            continue;
+        }
+
+        try {
+            double varianceScale{samples.s_SeasonalVarianceScales[i] *
+                                 samples.s_CountVarianceScales[i]};
+            double scale{1.0};
+            double shift{0.0};
+            double logVarianceScale{0.0};
+            if (varianceScale != 1.0) {
+                double r{prior.m_GammaRate / prior.m_GammaShape};
+                double s{std::exp(-r)};
+                double t{r + std::log(s + varianceScale * (1.0 - s))};
+                scale = t / r;
+                shift = 0.5 * (r - t);
+                logVarianceScale = std::log(t / r);
+            }
+
+            double logx{std::log(x)};
+            double impliedShape{prior.m_GammaShape + 0.5 * count};
+            double impliedPrecision{prior.m_GaussianPrecision + count / scale};
+            double weightedCount{count * (1.0 / scale)};
+            double impliedRate{prior.m_GammaRate +
+                               0.5 * (prior.m_GaussianPrecision * weightedCount *
+                                      pow2(logx - shift - prior.m_GaussianMean) /
+                                      (prior.m_GaussianPrecision + weightedCount))};
+            results[i] = 0.5 * (std::log(prior.m_GaussianPrecision) -
+                                std::log(impliedPrecision)) -
+                         0.5 * count * LOG_2_PI - 0.5 * logVarianceScale +
+                         boost::math::lgamma(impliedShape) -
+                         boost::math::lgamma(prior.m_GammaShape) +
+                         prior.m_GammaShape * std::log(prior.m_GammaRate) -
+                         impliedShape * std::log(impliedRate) - count * logx;
+            status |= CMathsFuncs::fpStatus(results[i]);
+        } catch (const std::exception& e) {
+            LOG_ERROR(<< "Error calculating marginal likelihood: " << e.what());
+            results[i] = 0.0;
+            status |= maths_t::E_FpFailed;
+        }
+    }
+
+    return static_cast<maths_t::EFloatingPointErrorStatus>(status);
+}
+
 double CLogNormalMeanPrecConjugate::normalMean() const {
     return m_GaussianMean;
 }
@@ -1640,6 +1987,37 @@ double CLogNormalMeanPrecConjugate::mean() const {
            m_Offset;
 }
 
+bool CLogNormalMeanPrecConjugate::gatherLogNormalApproximation(const SSampleBatch& samples,
+                                                               std::size_t i,
+                                                               TDoubleVec& x,
+                                                               TDoubleVec& locations,
+                                                               TDoubleVec& scales) const {
+    // This must match evaluateFunctionOnJointDistribution for large shape.
+
+    double sample{samples.s_Samples[i] + m_Offset};
+    if (this->isInteger() || this->isNonInformative() ||
+        m_GammaShape <= MINIMUM_LOGNORMAL_SHAPE || !(sample > 0.0) ||
+        !CMathsFuncs::isFinite(sample)) {
+        return false;
+    }
+
+    double varianceScale{samples.s_SeasonalVarianceScales[i] *
+                         samples.s_CountVarianceScales[i]};
+    double r{m_GammaRate / m_GammaShape};
+    // This is only used if the sample is scaled.
+    double s{varianceScale != 1.0 ? std::exp(-r) : 0.0};
+    double location;
+    double scale;
+    detail::locationAndScale(varianceScale, r, s, m_GaussianMean, m_GaussianPrecision,
+                             m_GammaRate, m_GammaShape, location, scale);
+
+    x.push_back(sample);
+    locations.push_back(location);
+    scales.push_back(scale);
+
+    return true;
+}
+
 bool CLogNormalMeanPrecConjugate::isBad() const {
     return !CMathsFuncs::isFinite(m_Offset) || !CMathsFuncs::isFinite(m_GaussianMean) ||
            !CMathsFuncs::isFinite(m_GaussianPrecision) ||
@@ -101,6 +101,14 @@ double CModelParams::probabilityBucketEmpty() const {
     return m_ProbabilityBucketEmpty;
 }
 
+void CModelParams::residualModelPrototype(const TPriorCPtr& prototype) {
+    m_ResidualModelPrototype = prototype;
+}
+
+const CModelParams::TPriorCPtr& CModelParams::residualModelPrototype() const {
+    return m_ResidualModelPrototype;
+}
+
 CModelAddSamplesParams::CModelAddSamplesParams()
     : m_Type(maths_t::E_MixedData), m_IsNonNegative(false),
       m_PropagationInterval(1.0), m_TrendWeights(nullptr), m_PriorWeights(nullptr) {
@@ -19,6 +19,7 @@
 #include <maths/CIntegration.h>
 #include <maths/CMathsFuncs.h>
 #include <maths/CRestoreParams.h>
+#include <maths/CSpecialFunctions.h>
 #include <maths/CTools.h>
 #include <maths/Constants.h>
 #include <maths/ProbabilityAggregators.h>
@@ -46,6 +47,7 @@ namespace {
 using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
 
 const double MINIMUM_GAUSSIAN_SHAPE = 100.0;
+const double LOG_2_PI = std::log(boost::math::double_constants::two_pi);
 
 namespace detail {
 
@@ -191,12 +193,184 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute minus the log of the joint c.d.f., or its complement if
+//! \p complement is true, of \p samples at each of \p n offsets.
+//!
+//! This is equivalent to evaluateFunctionOnJointDistribution using
+//! CTools::SMinusLogCdf, or CTools::SMinusLogCdfComplement, and SPlusWeight
+//! at each offset, but evaluates the c.d.f. for all the samples and offsets
+//! in one batch with the vectorised special functions.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+bool minusLogJointCdf(bool complement,
+                      const TDouble1Vec& samples,
+                      const TDoubleWeightsAry1Vec& weights,
+                      bool isNonInformative,
+                      const double* offsets,
+                      std::size_t n,
+                      double shape,
+                      double rate,
+                      double mean,
+                      double precision,
+                      double predictionMean,
+                      double* result) {
+    std::fill_n(result, n, 0.0);
+
+    if (samples.empty()) {
+        LOG_ERROR(<< "Can't compute distribution for empty sample set");
+        return false;
+    }
+
+    if (isNonInformative) {
+        double minusLogCdf{complement ? CTools::SMinusLogCdfComplement()(
+                                            CTools::SImproperDistribution(), 0.0)
+                                      : CTools::SMinusLogCdf()(
+                                            CTools::SImproperDistribution(), 0.0)};
+        double total{0.0};
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            double count = maths_t::count(weights[i]);
+            if (!CMathsFuncs::isFinite(count)) {
+                LOG_ERROR(<< "Bad count weight " << count);
+                return false;
+            }
+            total += count * minusLogCdf;
+        }
+        std::fill_n(result, n, total);
+        return true;
+    }
+
+    // The arguments for the j'th offset and i'th sample are at j * m + i.
+    std::size_t m{samples.size()};
+    TDouble1Vec locations(m * n);
+    TDouble1Vec scales(m * n);
+    TDouble1Vec x(m * n);
+    TDouble1Vec cdf(m * n);
+
+    for (std::size_t i = 0u; i < m; ++i) {
+        double seasonalScale = std::sqrt(maths_t::seasonalVarianceScale(weights[i]));
+        double countVarianceScale = maths_t::countVarianceScale(weights[i]);
+        double scaledPrecision = countVarianceScale * precision;
+        double scaledRate = countVarianceScale * rate;
+        double scale = std::sqrt((scaledPrecision + 1.0) / scaledPrecision * scaledRate / shape);
+        double xi = seasonalScale != 1.0
+                        ? predictionMean + (samples[i] - predictionMean) / seasonalScale
+                        : samples[i];
+        for (std::size_t j = 0u, k = i; j < n; ++j, k += m) {
+            locations[k] = mean;
+            scales[k] = scale;
+            x[k] = xi + offsets[j];
+        }
+    }
+
+    // See evaluateFunctionOnJointDistribution for details of the
+    // distributions.
+    if (shape > MINIMUM_GAUSSIAN_SHAPE) {
+        CSpecialFunctions::normalCdf(locations.data(), scales.data(), x.data(),
+                                     m * n, cdf.data(), complement);
+    } else {
+        for (std::size_t k = 0u; k < m * n; ++k) {
+            x[k] = (x[k] - mean) / scales[k];
+            locations[k] = 2.0 * shape;
+        }
+        CSpecialFunctions::studentsTCdf(locations.data(), x.data(), m * n,
+                                        cdf.data(), complement);
+    }
+
+    for (std::size_t j = 0u, k = 0u; j < n; ++j) {
+        for (std::size_t i = 0u; i < m; ++i, ++k) {
+            if (CMathsFuncs::isNan(cdf[k])) {
+                if (CMathsFuncs::isNan(x[k]) == false) {
+                    LOG_ERROR(<< "Error calculating joint distribution: shape = "
+                              << shape << ", rate = " << rate << ", mean = " << mean
+                              << ", precision = " << precision);
+                    return false;
+                }
+                LOG_ERROR(<< "x = NaN");
+                cdf[k] = 0.0;
+            }
+            result[j] += maths_t::count(weights[i]) * CTools::safeMinusLogCdf(cdf[k]);
+        }
+        LOG_TRACE(<< "result = " << result[j]);
+    }
+
+    return true;
+}
+
+//! Evaluate \p func on the joint predictive distribution for \p samples
+//! at each of \p n offsets.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+template<typename FUNC, typename AGGREGATOR>
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         FUNC func,
+                                         AGGREGATOR aggregate,
+                                         bool isNonInformative,
+                                         const double* offsets,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double predictionMean,
+                                         double* result) {
+    for (std::size_t i = 0u; i < n; ++i) {
+        if (!evaluateFunctionOnJointDistribution(
+                samples, weights, func, aggregate, isNonInformative, offsets[i],
+                shape, rate, mean, precision, predictionMean, result[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Overload for minus the log of the c.d.f. which evaluates all the samples
+//! and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdf,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         const double* offsets,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double predictionMean,
+                                         double* result) {
+    return minusLogJointCdf(false, samples, weights, isNonInformative, offsets, n,
+                            shape, rate, mean, precision, predictionMean, result);
+}
+
+//! Overload for minus the log of the c.d.f. complement which evaluates all
+//! the samples and offsets in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdfComplement,
+                                         SPlusWeight,
+                                         bool isNonInformative,
+                                         const double* offsets,
+                                         std::size_t n,
+                                         double shape,
+                                         double rate,
+                                         double mean,
+                                         double precision,
+                                         double predictionMean,
+                                         double* result) {
+    return minusLogJointCdf(true, samples, weights, isNonInformative, offsets, n,
+                            shape, rate, mean, precision, predictionMean, result);
+}
+
 //! Evaluates a specified function object, which must be default constructible,
 //! on the joint distribution of a set of the samples at a specified offset.
 //!
 //! This thin wrapper around the evaluateFunctionOnJointDistribution function
 //! so that it can be integrated over the hidden variable representing the
 //! actual value of a discrete datum which we assume is in the interval [n, n+1].
+//! It supports both the scalar and batched integration interfaces.
 template<typename F>
 class CEvaluateOnSamples : core::CNonCopyable {
 public:
@@ -213,8 +387,12 @@ public:
           m_Shape(shape), m_Rate(rate), m_PredictionMean(predictionMean) {}
 
     bool operator()(double x, double& result) const {
+        return (*this)(&x, 1, &result);
+    }
+
+    bool operator()(const double* x, std::size_t n, double* result) const {
         return evaluateFunctionOnJointDistribution(
-            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, x,
+            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, x, n,
             m_Shape, m_Rate, m_Mean, m_Precision, m_PredictionMean, result);
     }
 
@@ -339,6 +517,16 @@ public:
         return true;
     }
 
+    //! Evaluate the log marginal likelihood at the \p n offsets \p x.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        for (std::size_t i = 0u; i < n; ++i) {
+            if (!(*this)(x[i], result[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     //! Retrieve the error status for the integration.
     maths_t::EFloatingPointErrorStatus errorStatus() const {
         return m_ErrorStatus;
@@ -830,7 +1018,7 @@ CNormalMeanPrecConjugate::jointLogMarginalLikelihood(const TDouble1Vec& samples,
         samples, weights, m_GaussianMean, m_GaussianPrecision, m_GammaShape,
         m_GammaRate, this->marginalLikelihoodMean());
     if (this->isInteger()) {
-        CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
             logMarginalLikelihood, 0.0, 1.0, result);
     } else {
         logMarginalLikelihood(0.0, result);
@@ -1033,7 +1221,7 @@ bool CNormalMeanPrecConjugate::minusLogJointCdf(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdf, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. for "
                       << core::CContainerPrinter::print(samples));
@@ -1073,7 +1261,7 @@ bool CNormalMeanPrecConjugate::minusLogJointCdfComplement(const TDouble1Vec& sam
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::logGaussLegendreBatch<CIntegration::OrderThree>(
                 minusLogCdfComplement, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. complement for "
                       << core::CContainerPrinter::print(samples));
@@ -1246,6 +1434,160 @@ void CNormalMeanPrecConjugate::acceptPersistInserter(core::CStatePersistInserter
                          core::CIEEE754::E_SinglePrecision);
 }
 
+bool CNormalMeanPrecConjugate::batchProbabilityOfLessLikelySamples(
+    maths_t::EProbabilityCalculation calculation,
+    const TNormalCPtrVec& priors,
+    const SSampleBatch& samples,
+    TDoubleVec& lowerBounds,
+    TDoubleVec& upperBounds,
+    TTailVec& tails) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+    tails.assign(n, maths_t::E_UndeterminedTail);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    // The probability of a single sample with unit count is just the
+    // probability of the sample under its marginal likelihood.
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, means, deviations;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CNormalMeanPrecConjugate& prior{*priors[i]};
+        if (samples.s_Counts[i] == 1.0 &&
+            prior.gatherNormalApproximation(samples, i, x, means, deviations)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleProbabilityOfLessLikelySamples(calculation, prior, samples, i,
+                                                           lowerBounds[i],
+                                                           upperBounds[i], tails[i]);
+        }
+    }
+
+    TDoubleVec probabilities;
+    TTailVec tails_;
+    normalProbabilityOfLessLikelySamples(calculation, x, means, deviations,
+                                         probabilities, tails_);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] = probabilities[i];
+        tails[lanes[i]] = tails_[i];
+    }
+
+    return result;
+}
+
+bool CNormalMeanPrecConjugate::batchMinusLogJointCdf(const TNormalCPtrVec& priors,
+                                                     const SSampleBatch& samples,
+                                                     TDoubleVec& lowerBounds,
+                                                     TDoubleVec& upperBounds) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, means, deviations;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CNormalMeanPrecConjugate& prior{*priors[i]};
+        if (prior.gatherNormalApproximation(samples, i, x, means, deviations)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleMinusLogJointCdf(prior, samples, i, lowerBounds[i],
+                                             upperBounds[i]);
+        }
+    }
+
+    TDoubleVec minusLogCdfs;
+    normalMinusLogCdf(x, means, deviations, minusLogCdfs);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] =
+            samples.s_Counts[lanes[i]] * minusLogCdfs[i];
+    }
+
+    return result;
+}
+
+maths_t::EFloatingPointErrorStatus
+CNormalMeanPrecConjugate::batchJointLogMarginalLikelihood(const TNormalCPtrVec& priors,
+                                                          const SSampleBatch& samples,
+                                                          TDoubleVec& results) {
+
+    std::size_t n{priors.size()};
+    results.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return maths_t::E_FpFailed;
+    }
+
+    // For a single sample the sample square deviation is zero and the
+    // log marginal likelihood (see detail::CLogMarginalLikelihood) is a
+    // simple closed form expression. We only need to integrate over the
+    // hidden offset for integer data.
+
+    int status{maths_t::E_FpNoErrors};
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CNormalMeanPrecConjugate& prior{*priors[i]};
+        double sample{samples.s_Samples[i]};
+        double count{samples.s_Counts[i] * samples.s_WinsorisationWeights[i]};
+        if (prior.isInteger() || prior.isNonInformative() || !(count > 0.0) ||
+            !CMathsFuncs::isFinite(sample)) {
+            status |= singleJointLogMarginalLikelihood(prior, samples, i, results[i]);
+            continue;
+        }
+
+        try {
+            double seasonalScale{std::sqrt(samples.s_SeasonalVarianceScales[i])};
+            double countVarianceScale{samples.s_CountVarianceScales[i]};
+            double weightedCount{count * (1.0 / countVarianceScale)};
+            double logVarianceScale{0.0};
+            if (seasonalScale != 1.0) {
+                sample = prior.m_GaussianMean + (sample - prior.m_GaussianMean) / seasonalScale;
+                logVarianceScale += 2.0 * std::log(seasonalScale);
+            }
+            if (countVarianceScale != 1.0) {
+                logVarianceScale += std::log(countVarianceScale);
+            }
+
+            double impliedShape{prior.m_GammaShape + 0.5 * count};
+            double impliedPrecision{prior.m_GaussianPrecision + weightedCount};
+            double impliedRate{prior.m_GammaRate +
+                               0.5 * (prior.m_GaussianPrecision * weightedCount *
+                                      (sample - prior.m_GaussianMean) *
+                                      (sample - prior.m_GaussianMean) / impliedPrecision)};
+            results[i] = 0.5 * (std::log(prior.m_GaussianPrecision) -
+                                std::log(impliedPrecision)) -
+                         0.5 * count * LOG_2_PI - 0.5 * logVarianceScale +
+                         boost::math::lgamma(impliedShape) -
+                         boost::math::lgamma(prior.m_GammaShape) +
+                         prior.m_GammaShape * std::log(prior.m_GammaRate) -
+                         impliedShape * std::log(impliedRate);
+            status |= CMathsFuncs::fpStatus(results[i]);
+        } catch (const std::exception& e) {
+            LOG_ERROR(<< "Error calculating marginal likelihood: " << e.what());
+            results[i] = 0.0;
+            status |= maths_t::E_FpFailed;
+        }
+    }
+
+    return static_cast<maths_t::EFloatingPointErrorStatus>(status);
+}
+
 double CNormalMeanPrecConjugate::mean() const {
     return m_GaussianMean;
 }
@@ -1327,6 +1669,34 @@ bool CNormalMeanPrecConjugate::equalTolerance(const CNormalMeanPrecConjugate& rh
            equal(m_GammaShape, rhs.m_GammaShape) && equal(m_GammaRate, rhs.m_GammaRate);
 }
 
+bool CNormalMeanPrecConjugate::gatherNormalApproximation(const SSampleBatch& samples,
+                                                         std::size_t i,
+                                                         TDoubleVec& x,
+                                                         TDoubleVec& means,
+                                                         TDoubleVec& deviations) const {
+    // This must match evaluateFunctionOnJointDistribution for large shape.
+
+    double sample{samples.s_Samples[i]};
+    if (this->isInteger() || this->isNonInformative() ||
+        m_GammaShape <= MINIMUM_GAUSSIAN_SHAPE || !CMathsFuncs::isFinite(sample)) {
+        return false;
+    }
+
+    double seasonalScale{std::sqrt(samples.s_SeasonalVarianceScales[i])};
+    double countVarianceScale{samples.s_CountVarianceScales[i]};
+    double scaledPrecision{countVarianceScale * m_GaussianPrecision};
+    double scaledRate{countVarianceScale * m_GammaRate};
+
+    x.push_back(seasonalScale != 1.0
+                    ? m_GaussianMean + (sample - m_GaussianMean) / seasonalScale
+                    : sample);
+    means.push_back(m_GaussianMean);
+    deviations.push_back(std::sqrt((scaledPrecision + 1.0) / scaledPrecision *
+                                   scaledRate / m_GammaShape));
+
+    return true;
+}
+
 bool CNormalMeanPrecConjugate::isBad() const {
     return !CMathsFuncs::isFinite(m_GaussianMean) ||
            !CMathsFuncs::isFinite(m_GaussianPrecision) ||
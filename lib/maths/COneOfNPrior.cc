@@ -212,6 +212,32 @@ void COneOfNPrior::removeModels(CModelFilter& filter) {
     m_Models.erase(m_Models.begin() + last, m_Models.end());
 }
 
+bool COneOfNPrior::removeModelsWithWeightLessThan(double minimumWeight) {
+    double Z = 0.0;
+    for (const auto& model : m_Models) {
+        Z += std::exp(model.first.logWeight());
+    }
+    double logMinimumWeight = std::log(minimumWeight) + std::log(Z);
+
+    CScopeCanonicalizeWeights<TPriorPtr> canonicalize(m_Models);
+
+    std::size_t last = 0u;
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        if (last != i) {
+            std::swap(m_Models[last], m_Models[i]);
+        }
+        if (!(m_Models[last].second->participatesInModelSelection() &&
+              m_Models[last].first.logWeight() < logMinimumWeight)) {
+            ++last;
+        }
+    }
+    if (last == m_Models.size()) {
+        return false;
+    }
+    m_Models.erase(m_Models.begin() + last, m_Models.end());
+    return true;
+}
+
 bool COneOfNPrior::needsOffset() const {
     for (const auto& model : m_Models) {
         if (model.second->needsOffset()) {
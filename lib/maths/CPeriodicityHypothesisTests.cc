@@ -1641,7 +1641,8 @@ double meanAutocorrelationForPeriodicOffsets(const TDoubleVec& correlations,
 
 //! Find the single periodic component which explains the most
 //! cyclic autocorrelation.
-std::size_t mostSignificantPeriodicComponent(TFloatMeanAccumulatorVec values) {
+std::size_t mostSignificantPeriodicComponent(TFloatMeanAccumulatorVec values,
+                                             CSignal::CFftWorkspace& workspace) {
     using TSizeVec = std::vector<std::size_t>;
     using TDoubleSizePr = std::pair<double, std::size_t>;
     using TMaxAccumulator =
@@ -1655,7 +1656,7 @@ std::size_t mostSignificantPeriodicComponent(TFloatMeanAccumulatorVec values) {
     // to avoid windowing effects.
     TDoubleVec correlations;
     values.resize(n + pad);
-    CSignal::autocorrelations(values, correlations);
+    CSignal::autocorrelations(values, correlations, workspace);
     values.resize(n);
 
     // We retain the top 15 serial autocorrelations so we have a high
@@ -1705,9 +1706,19 @@ testForPeriods(const CPeriodicityHypothesisTestsConfig& config,
                core_t::TTime startTime,
                core_t::TTime bucketLength,
                const TFloatMeanAccumulatorVec& values) {
+    CSignal::CFftWorkspace workspace;
+    return testForPeriods(config, startTime, bucketLength, values, workspace);
+}
+
+CPeriodicityHypothesisTestsResult
+testForPeriods(const CPeriodicityHypothesisTestsConfig& config,
+               core_t::TTime startTime,
+               core_t::TTime bucketLength,
+               const TFloatMeanAccumulatorVec& values,
+               CSignal::CFftWorkspace& workspace) {
     // Find the single periodic component which explains the
     // most cyclic autocorrelation.
-    std::size_t period_{mostSignificantPeriodicComponent(values)};
+    std::size_t period_{mostSignificantPeriodicComponent(values, workspace)};
     core_t::TTime window{static_cast<core_t::TTime>(values.size()) * bucketLength};
     core_t::TTime period{static_cast<core_t::TTime>(period_) * bucketLength};
     LOG_TRACE(<< "bucket length = " << bucketLength << ", window = " << window
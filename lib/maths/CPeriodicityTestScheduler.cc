@@ -0,0 +1,156 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <maths/CPeriodicityTestScheduler.h>
+
+#include <core/CLogger.h>
+#include <core/CMonotonicTime.h>
+#include <core/CScopedFastLock.h>
+#include <core/CStaticThreadPool.h>
+
+#include <maths/CChecksum.h>
+#include <maths/CSignal.h>
+
+#include <algorithm>
+#include <tuple>
+
+namespace ml {
+namespace maths {
+namespace {
+//! The minimum number of tests to run in each batch.
+const std::size_t MINIMUM_BATCH_SIZE{4};
+}
+
+CPeriodicityTestScheduler::CTest::CTest(const CPeriodicityHypothesisTestsConfig& config,
+                                        core_t::TTime startTime,
+                                        core_t::TTime bucketLength,
+                                        TFloatMeanAccumulatorVec values,
+                                        std::uint64_t due)
+    : m_Config{config}, m_StartTime{startTime}, m_BucketLength{bucketLength},
+      m_Values{std::move(values)}, m_Due{due}, m_Complete{false} {
+}
+
+bool CPeriodicityTestScheduler::CTest::complete() const {
+    return m_Complete.load(std::memory_order_acquire);
+}
+
+const CPeriodicityHypothesisTestsResult& CPeriodicityTestScheduler::CTest::result() const {
+    return m_Result;
+}
+
+CPeriodicityTestScheduler::CPeriodicityTestScheduler(std::size_t spread)
+    : m_Spread{std::max(spread, std::size_t{1})}, m_Runs{0}, m_NumberDiscarded{0},
+      m_LastNumberTests{0}, m_LastRunTime{0.0} {
+}
+
+CPeriodicityTestScheduler::TTestPtr
+CPeriodicityTestScheduler::schedule(const CPeriodicityHypothesisTestsConfig& config,
+                                    core_t::TTime startTime,
+                                    core_t::TTime bucketLength,
+                                    TFloatMeanAccumulatorVec values) {
+    std::uint64_t delay{CChecksum::calculate(0, values) % m_Spread};
+    core::CScopedFastLock lock(m_Mutex);
+    auto test = std::make_shared<CTest>(config, startTime, bucketLength,
+                                        std::move(values), m_Runs + delay);
+    m_Pending.push_back(test);
+    return test;
+}
+
+void CPeriodicityTestScheduler::runTests(core::CStaticThreadPool* pool) {
+    static const core::CMonotonicTime clock;
+
+    std::uint64_t start{clock.nanoseconds()};
+
+    TTestPtrVec due;
+    {
+        core::CScopedFastLock lock(m_Mutex);
+        auto i = std::stable_partition(m_Pending.begin(), m_Pending.end(),
+                                       [this](const TTestPtr& test) {
+                                           return test->m_Due > m_Runs;
+                                       });
+        due.assign(std::make_move_iterator(i), std::make_move_iterator(m_Pending.end()));
+        m_Pending.erase(i, m_Pending.end());
+        ++m_Runs;
+    }
+
+    // Discard the tests whose results nobody is waiting for. We are the
+    // only owner of such a test so nothing else can acquire a reference.
+    std::size_t discarded{due.size()};
+    due.erase(std::remove_if(due.begin(), due.end(),
+                             [](const TTestPtr& test) {
+                                 return test.use_count() == 1;
+                             }),
+              due.end());
+    discarded -= due.size();
+
+    // Run tests on the same grid together so they share a workspace.
+    std::sort(due.begin(), due.end(), [](const TTestPtr& lhs, const TTestPtr& rhs) {
+        return std::make_tuple(lhs->m_BucketLength, lhs->m_Values.size(), lhs->m_StartTime) <
+               std::make_tuple(rhs->m_BucketLength, rhs->m_Values.size(), rhs->m_StartTime);
+    });
+
+    std::size_t threads{pool != nullptr ? pool->size() + 1 : 1};
+    std::size_t batchSize{std::max((due.size() + 4 * threads - 1) / (4 * threads),
+                                   MINIMUM_BATCH_SIZE)};
+    std::size_t batches{(due.size() + batchSize - 1) / batchSize};
+
+    TDoubleVec times(due.size());
+    auto runBatch = [&](std::size_t batch) {
+        CSignal::CFftWorkspace workspace;
+        std::size_t end{std::min((batch + 1) * batchSize, due.size())};
+        for (std::size_t i = batch * batchSize; i < end; ++i) {
+            CTest& test{*due[i]};
+            std::uint64_t testStart{clock.nanoseconds()};
+            test.m_Result = testForPeriods(test.m_Config, test.m_StartTime,
+                                           test.m_BucketLength, test.m_Values, workspace);
+            test.m_Values = TFloatMeanAccumulatorVec{};
+            test.m_Complete.store(true, std::memory_order_release);
+            times[i] = static_cast<double>(clock.nanoseconds() - testStart) / 1000.0;
+        }
+    };
+
+    if (pool != nullptr && batches > 1) {
+        pool->parallelForEach(batches, runBatch);
+    } else {
+        for (std::size_t batch = 0u; batch < batches; ++batch) {
+            runBatch(batch);
+        }
+    }
+
+    double elapsed{static_cast<double>(clock.nanoseconds() - start) / 1000.0};
+
+    core::CScopedFastLock lock(m_Mutex);
+    m_NumberDiscarded += discarded;
+    for (auto time : times) {
+        m_MeanTestTime.add(time);
+        m_MaxTestTime.add(time);
+    }
+    m_LastNumberTests = due.size();
+    m_LastRunTime = elapsed;
+    if (due.size() > 0) {
+        LOG_TRACE(<< "Ran " << due.size() << " periodicity tests in " << elapsed
+                  << "us, " << m_Pending.size() << " pending");
+    }
+}
+
+std::size_t CPeriodicityTestScheduler::numberPending() const {
+    core::CScopedFastLock lock(m_Mutex);
+    return m_Pending.size();
+}
+
+CPeriodicityTestScheduler::STimings CPeriodicityTestScheduler::timings() const {
+    core::CScopedFastLock lock(m_Mutex);
+    STimings result;
+    result.s_NumberTests = static_cast<std::uint64_t>(CBasicStatistics::count(m_MeanTestTime));
+    result.s_NumberDiscarded = m_NumberDiscarded;
+    result.s_MeanTestTime = CBasicStatistics::mean(m_MeanTestTime);
+    result.s_MaxTestTime = m_MaxTestTime.count() > 0 ? m_MaxTestTime[0] : 0.0;
+    result.s_LastNumberTests = m_LastNumberTests;
+    result.s_LastRunTime = m_LastRunTime;
+    return result;
+}
+}
+}
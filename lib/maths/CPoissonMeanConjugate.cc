@@ -17,6 +17,7 @@
 #include <maths/CChecksum.h>
 #include <maths/CMathsFuncs.h>
 #include <maths/CRestoreParams.h>
+#include <maths/CSpecialFunctions.h>
 #include <maths/CTools.h>
 #include <maths/ProbabilityAggregators.h>
 
@@ -161,6 +162,127 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute minus the log of the joint c.d.f., or its complement if
+//! \p complement is true, of \p samples.
+//!
+//! This is equivalent to evaluateFunctionOnJointDistribution using
+//! CTools::SMinusLogCdf, or CTools::SMinusLogCdfComplement, and SPlusWeight,
+//! but evaluates the c.d.f. for all the samples in one batch with the
+//! vectorised special functions. The negative binomial c.d.f. is evaluated
+//! using its relationship with the incomplete beta function, i.e.
+//! \f$F(x) = I_p(r, x + 1)\f$.
+//!
+//! \see evaluateFunctionOnJointDistribution for a description of the
+//! parameters.
+bool minusLogJointCdf(bool complement,
+                      const TDouble1Vec& samples,
+                      const TDoubleWeightsAry1Vec& weights,
+                      double offset,
+                      bool isNonInformative,
+                      double shape,
+                      double rate,
+                      double& result) {
+    result = 0.0;
+
+    if (samples.empty()) {
+        LOG_ERROR(<< "Can't compute distribution for empty sample set");
+        return false;
+    }
+
+    if (isNonInformative) {
+        double minusLogCdf{complement ? CTools::SMinusLogCdfComplement()(
+                                            CTools::SImproperDistribution(), 0.0)
+                                      : CTools::SMinusLogCdf()(
+                                            CTools::SImproperDistribution(), 0.0)};
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            result += maths_t::count(weights[i]) * minusLogCdf;
+        }
+        return true;
+    }
+
+    std::size_t m{samples.size()};
+    TDouble1Vec a(m);
+    TDouble1Vec b(m);
+    TDouble1Vec x(m);
+    TDouble1Vec cdf(m);
+
+    // See evaluateFunctionOnJointDistribution for details of the
+    // distributions.
+    double mean = shape / rate;
+    bool gaussian{mean > MINIMUM_GAUSSIAN_MEAN};
+    if (gaussian) {
+        double deviation = std::sqrt((rate + 1.0) / rate * mean);
+        for (std::size_t i = 0u; i < m; ++i) {
+            a[i] = mean;
+            b[i] = deviation;
+            x[i] = samples[i] + offset;
+        }
+        CSpecialFunctions::normalCdf(a.data(), b.data(), x.data(), m,
+                                     cdf.data(), complement);
+    } else {
+        double p = rate / (rate + 1.0);
+        for (std::size_t i = 0u; i < m; ++i) {
+            a[i] = shape;
+            b[i] = std::max(samples[i] + offset, 0.0) + 1.0;
+            x[i] = p;
+        }
+        CSpecialFunctions::incompleteBeta(a.data(), b.data(), x.data(), m,
+                                          cdf.data(), complement);
+    }
+
+    for (std::size_t i = 0u; i < m; ++i) {
+        double xi = samples[i] + offset;
+        if (CMathsFuncs::isNan(xi)) {
+            LOG_ERROR(<< "x = NaN");
+            cdf[i] = 0.0;
+        } else if (gaussian == false && xi < 0.0) {
+            cdf[i] = complement ? 1.0 : 0.0;
+        } else if (gaussian == false && !CMathsFuncs::isFinite(xi)) {
+            cdf[i] = complement ? 0.0 : 1.0;
+        } else if (CMathsFuncs::isNan(cdf[i])) {
+            LOG_ERROR(<< "Error calculating joint c.d.f."
+                      << " offset = " << offset << ", shape = " << shape
+                      << ", rate = " << rate);
+            return false;
+        }
+        result += maths_t::count(weights[i]) * CTools::safeMinusLogCdf(cdf[i]);
+    }
+
+    LOG_TRACE(<< "result = " << result);
+
+    return true;
+}
+
+//! Overload for minus the log of the c.d.f. which evaluates all the samples
+//! in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdf,
+                                         SPlusWeight,
+                                         double offset,
+                                         bool isNonInformative,
+                                         double shape,
+                                         double rate,
+                                         double& result) {
+    return minusLogJointCdf(false, samples, weights, offset, isNonInformative,
+                            shape, rate, result);
+}
+
+//! Overload for minus the log of the c.d.f. complement which evaluates all
+//! the samples in one batch.
+bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
+                                         const TDoubleWeightsAry1Vec& weights,
+                                         CTools::SMinusLogCdfComplement,
+                                         SPlusWeight,
+                                         double offset,
+                                         bool isNonInformative,
+                                         double shape,
+                                         double rate,
+                                         double& result) {
+    return minusLogJointCdf(true, samples, weights, offset, isNonInformative,
+                            shape, rate, result);
+}
+
 } // detail::
 
 // We use short field names to reduce the state size
@@ -877,6 +999,135 @@ void CPoissonMeanConjugate::acceptPersistInserter(core::CStatePersistInserter& i
                          core::CIEEE754::E_SinglePrecision);
 }
 
+bool CPoissonMeanConjugate::batchProbabilityOfLessLikelySamples(
+    maths_t::EProbabilityCalculation calculation,
+    const TPoissonCPtrVec& priors,
+    const SSampleBatch& samples,
+    TDoubleVec& lowerBounds,
+    TDoubleVec& upperBounds,
+    TTailVec& tails) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+    tails.assign(n, maths_t::E_UndeterminedTail);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, means, deviations;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CPoissonMeanConjugate& prior{*priors[i]};
+        if (samples.s_Counts[i] == 1.0 &&
+            prior.gatherNormalApproximation(samples, i, x, means, deviations)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleProbabilityOfLessLikelySamples(calculation, prior, samples, i,
+                                                           lowerBounds[i],
+                                                           upperBounds[i], tails[i]);
+        }
+    }
+
+    TDoubleVec probabilities;
+    TTailVec tails_;
+    normalProbabilityOfLessLikelySamples(calculation, x, means, deviations,
+                                         probabilities, tails_);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] = probabilities[i];
+        tails[lanes[i]] = tails_[i];
+    }
+
+    return result;
+}
+
+bool CPoissonMeanConjugate::batchMinusLogJointCdf(const TPoissonCPtrVec& priors,
+                                                  const SSampleBatch& samples,
+                                                  TDoubleVec& lowerBounds,
+                                                  TDoubleVec& upperBounds) {
+
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    TSizeVec lanes;
+    TDoubleVec x, means, deviations;
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CPoissonMeanConjugate& prior{*priors[i]};
+        if (prior.gatherNormalApproximation(samples, i, x, means, deviations)) {
+            lanes.push_back(i);
+        } else {
+            result &= singleMinusLogJointCdf(prior, samples, i, lowerBounds[i],
+                                             upperBounds[i]);
+        }
+    }
+
+    TDoubleVec minusLogCdfs;
+    normalMinusLogCdf(x, means, deviations, minusLogCdfs);
+    for (std::size_t i = 0u; i < lanes.size(); ++i) {
+        lowerBounds[lanes[i]] = upperBounds[lanes[i]] =
+            samples.s_Counts[lanes[i]] * minusLogCdfs[i];
+    }
+
+    return result;
+}
+
+maths_t::EFloatingPointErrorStatus
+CPoissonMeanConjugate::batchJointLogMarginalLikelihood(const TPoissonCPtrVec& priors,
+                                                       const SSampleBatch& samples,
+                                                       TDoubleVec& results) {
+
+    std::size_t n{priors.size()};
+    results.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return maths_t::E_FpFailed;
+    }
+
+    // This is jointLogMarginalLikelihood specialised to a single sample.
+
+    int status{maths_t::E_FpNoErrors};
+    for (std::size_t i = 0u; i < n; ++i) {
+        const CPoissonMeanConjugate& prior{*priors[i]};
+        double x{samples.s_Samples[i] + prior.m_Offset};
+        if (prior.isNonInformative() || !(x >= 0.0) || !CMathsFuncs::isFinite(x)) {
+            status |= singleJointLogMarginalLikelihood(prior, samples, i, results[i]);
+            continue;
+        }
+
+        try {
+            double count{samples.s_Counts[i] * samples.s_WinsorisationWeights[i]};
+            double impliedShape{prior.m_Shape + count * x};
+            double impliedRate{prior.m_Rate + count};
+            results[i] = boost::math::lgamma(impliedShape) +
+                         prior.m_Shape * std::log(prior.m_Rate) -
+                         impliedShape * std::log(impliedRate) -
+                         count * boost::math::lgamma(x + 1.0) -
+                         boost::math::lgamma(prior.m_Shape);
+            status |= CMathsFuncs::fpStatus(results[i]);
+        } catch (const std::exception& e) {
+            LOG_ERROR(<< "Error calculating marginal likelihood: " << e.what());
+            results[i] = 0.0;
+            status |= maths_t::E_FpFailed;
+        }
+    }
+
+    return static_cast<maths_t::EFloatingPointErrorStatus>(status);
+}
+
 double CPoissonMeanConjugate::priorMean() const {
 
     if (this->isNonInformative()) {
@@ -945,6 +1196,30 @@ bool CPoissonMeanConjugate::equalTolerance(const CPoissonMeanConjugate& rhs,
     return equal(m_Shape, rhs.m_Shape) && equal(m_Rate, rhs.m_Rate);
 }
 
+bool CPoissonMeanConjugate::gatherNormalApproximation(const SSampleBatch& samples,
+                                                      std::size_t i,
+                                                      TDoubleVec& x,
+                                                      TDoubleVec& means,
+                                                      TDoubleVec& deviations) const {
+    // This must match evaluateFunctionOnJointDistribution for large mean.
+
+    double sample{samples.s_Samples[i] + m_Offset};
+    if (this->isNonInformative() || !CMathsFuncs::isFinite(sample)) {
+        return false;
+    }
+
+    double mean{m_Shape / m_Rate};
+    if (mean <= MINIMUM_GAUSSIAN_MEAN) {
+        return false;
+    }
+
+    x.push_back(sample);
+    means.push_back(mean);
+    deviations.push_back(std::sqrt((m_Rate + 1.0) / m_Rate * mean));
+
+    return true;
+}
+
 const double CPoissonMeanConjugate::NON_INFORMATIVE_SHAPE = 0.1;
 const double CPoissonMeanConjugate::NON_INFORMATIVE_RATE = 0.0;
 }
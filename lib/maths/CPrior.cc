@@ -7,6 +7,7 @@
 #include <maths/CPrior.h>
 
 #include <core/CLogger.h>
+#include <core/Constants.h>
 
 #include <maths/CBasicStatistics.h>
 #include <maths/CBasicStatisticsPersist.h>
@@ -18,6 +19,9 @@
 #include <maths/COrderings.h>
 #include <maths/CPriorDetail.h>
 #include <maths/CSolvers.h>
+#include <maths/CTools.h>
+
+#include <boost/math/constants/constants.hpp>
 
 #include <algorithm>
 #include <cmath>
@@ -45,6 +49,7 @@ void setDecayRate(double value, double fallback, CFloatStorage& result) {
 }
 
 const std::size_t ADJUST_OFFSET_TRIALS = 20;
+const double ROOT_TWO = boost::math::double_constants::root_two;
 }
 
 CPrior::CPrior()
@@ -296,6 +301,74 @@ double CPrior::adjustOffsetWithCost(const TDouble1Vec& samples,
     return std::min(after - before, 0.0);
 }
 
+bool CPrior::batchProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                 const TPriorCPtrVec& priors,
+                                                 const SSampleBatch& samples,
+                                                 TDoubleVec& lowerBounds,
+                                                 TDoubleVec& upperBounds,
+                                                 TTailVec& tails) {
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+    tails.assign(n, maths_t::E_UndeterminedTail);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    for (std::size_t i = 0u; i < n; ++i) {
+        result &= singleProbabilityOfLessLikelySamples(calculation, *priors[i], samples, i,
+                                                       lowerBounds[i],
+                                                       upperBounds[i], tails[i]);
+    }
+    return result;
+}
+
+bool CPrior::batchMinusLogJointCdf(const TPriorCPtrVec& priors,
+                                   const SSampleBatch& samples,
+                                   TDoubleVec& lowerBounds,
+                                   TDoubleVec& upperBounds) {
+    std::size_t n{priors.size()};
+    lowerBounds.assign(n, 0.0);
+    upperBounds.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return false;
+    }
+
+    bool result{true};
+    for (std::size_t i = 0u; i < n; ++i) {
+        result &= singleMinusLogJointCdf(*priors[i], samples, i, lowerBounds[i],
+                                         upperBounds[i]);
+    }
+    return result;
+}
+
+maths_t::EFloatingPointErrorStatus
+CPrior::batchJointLogMarginalLikelihood(const TPriorCPtrVec& priors,
+                                        const SSampleBatch& samples,
+                                        TDoubleVec& results) {
+    std::size_t n{priors.size()};
+    results.assign(n, 0.0);
+
+    if (samples.size() != n) {
+        LOG_ERROR(<< "Mismatch in number of priors " << n << " and samples "
+                  << samples.size());
+        return maths_t::E_FpFailed;
+    }
+
+    int status{maths_t::E_FpNoErrors};
+    for (std::size_t i = 0u; i < n; ++i) {
+        status |= singleJointLogMarginalLikelihood(*priors[i], samples, i, results[i]);
+    }
+    return static_cast<maths_t::EFloatingPointErrorStatus>(status);
+}
+
 void CPrior::addSamples(double n) {
     m_NumberSamples += n;
 }
@@ -304,6 +377,151 @@ std::string CPrior::debug() const {
     return std::string();
 }
 
+bool CPrior::singleProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                  const CPrior& prior,
+                                                  const SSampleBatch& samples,
+                                                  std::size_t i,
+                                                  double& lowerBound,
+                                                  double& upperBound,
+                                                  maths_t::ETail& tail) {
+    return prior.probabilityOfLessLikelySamples(
+        calculation, TDouble1Vec{samples.s_Samples[i]},
+        TDoubleWeightsAry1Vec{samples.weights(i)}, lowerBound, upperBound, tail);
+}
+
+bool CPrior::singleMinusLogJointCdf(const CPrior& prior,
+                                    const SSampleBatch& samples,
+                                    std::size_t i,
+                                    double& lowerBound,
+                                    double& upperBound) {
+    return prior.minusLogJointCdf(TDouble1Vec{samples.s_Samples[i]},
+                                  TDoubleWeightsAry1Vec{samples.weights(i)},
+                                  lowerBound, upperBound);
+}
+
+maths_t::EFloatingPointErrorStatus
+CPrior::singleJointLogMarginalLikelihood(const CPrior& prior,
+                                         const SSampleBatch& samples,
+                                         std::size_t i,
+                                         double& result) {
+    return prior.jointLogMarginalLikelihood(TDouble1Vec{samples.s_Samples[i]},
+                                            TDoubleWeightsAry1Vec{samples.weights(i)},
+                                            result);
+}
+
+// The kernels below are written as branch free loops over contiguous
+// arrays so that the compiler can vectorise them. They reproduce the
+// calculations CTools performs for a single boost::math distribution,
+// in particular, the normal c.d.f. is computed as erfc(-z) / 2 with
+// z = (x - m) / (sd * 2^(1/2)) which is exactly what boost does.
+
+void CPrior::normalProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                  const TDoubleVec& x,
+                                                  const TDoubleVec& means,
+                                                  const TDoubleVec& deviations,
+                                                  TDoubleVec& result,
+                                                  TTailVec& tails) {
+    std::size_t n{x.size()};
+    result.resize(n);
+    tails.resize(n);
+
+    switch (calculation) {
+    case maths_t::E_OneSidedBelow:
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::erfc(-(x[i] - means[i]) / (deviations[i] * ROOT_TWO));
+            tails[i] = maths_t::E_LeftTail;
+        }
+        break;
+    case maths_t::E_TwoSided:
+        // The distribution is symmetric about its mode so this is
+        // 2 * min(F(x), 1 - F(x)).
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::erfc(std::fabs(x[i] - means[i]) / (deviations[i] * ROOT_TWO));
+            tails[i] = static_cast<maths_t::ETail>(
+                (x[i] <= means[i] ? maths_t::E_LeftTail : 0) |
+                (x[i] >= means[i] ? maths_t::E_RightTail : 0));
+        }
+        break;
+    case maths_t::E_OneSidedAbove:
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::erfc((x[i] - means[i]) / (deviations[i] * ROOT_TWO));
+            tails[i] = maths_t::E_RightTail;
+        }
+        break;
+    }
+
+    // This matches the truncation applied by CJointProbabilityOfLessLikelySamples.
+    double smallest{CTools::smallestProbability()};
+    for (std::size_t i = 0u; i < n; ++i) {
+        result[i] = std::min(std::max(result[i], smallest), 1.0);
+    }
+}
+
+void CPrior::normalMinusLogCdf(const TDoubleVec& x,
+                               const TDoubleVec& means,
+                               const TDoubleVec& deviations,
+                               TDoubleVec& result) {
+    std::size_t n{x.size()};
+    result.resize(n);
+    for (std::size_t i = 0u; i < n; ++i) {
+        double cdf{std::erfc(-(x[i] - means[i]) / (deviations[i] * ROOT_TWO)) / 2.0};
+        // We avoid log(0) for the same reasons as CTools::SMinusLogCdf.
+        result[i] = cdf == 0.0 ? -core::constants::LOG_MIN_DOUBLE
+                               : std::max(-std::log(cdf), 0.0);
+    }
+}
+
+void CPrior::logNormalProbabilityOfLessLikelySamples(maths_t::EProbabilityCalculation calculation,
+                                                     const TDoubleVec& x,
+                                                     const TDoubleVec& locations,
+                                                     const TDoubleVec& scales,
+                                                     TDoubleVec& result,
+                                                     TTailVec& tails) {
+    std::size_t n{x.size()};
+    result.resize(n);
+    tails.resize(n);
+
+    switch (calculation) {
+    case maths_t::E_OneSidedBelow:
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::erfc(-(std::log(x[i]) - locations[i]) / (scales[i] * ROOT_TWO));
+            tails[i] = maths_t::E_LeftTail;
+        }
+        break;
+    case maths_t::E_TwoSided:
+        // See CTools::CProbabilityOfLessLikelySample for the derivation
+        // of the point y with the same density as x. We work with log(y)
+        // directly since it avoids an exp and a log per sample.
+        for (std::size_t i = 0u; i < n; ++i) {
+            double logx{std::log(x[i])};
+            double s2{scales[i] * scales[i]};
+            double discriminant{std::sqrt(
+                s2 * s2 + (logx - locations[i] + 2.0 * s2) * (logx - locations[i]))};
+            double mode{std::exp(locations[i] - s2)};
+            double logy{locations[i] - s2 + (x[i] > mode ? -discriminant : discriminant)};
+            double a{std::min(logx, logy)};
+            double b{std::max(logx, logy)};
+            result[i] = std::erfc(-(a - locations[i]) / (scales[i] * ROOT_TWO)) / 2.0 +
+                        std::erfc((b - locations[i]) / (scales[i] * ROOT_TWO)) / 2.0;
+            tails[i] = static_cast<maths_t::ETail>(
+                (x[i] <= mode ? maths_t::E_LeftTail : 0) |
+                (x[i] >= mode ? maths_t::E_RightTail : 0));
+        }
+        break;
+    case maths_t::E_OneSidedAbove:
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::erfc((std::log(x[i]) - locations[i]) / (scales[i] * ROOT_TWO));
+            tails[i] = maths_t::E_RightTail;
+        }
+        break;
+    }
+
+    double smallest{CTools::smallestProbability()};
+    for (std::size_t i = 0u; i < n; ++i) {
+        result[i] = std::min(std::max(result[i], smallest), 1.0);
+    }
+}
+
 const double CPrior::FALLBACK_DECAY_RATE = 0.001;
 const std::size_t CPrior::ADJUST_OFFSET_SAMPLE_SIZE = 50u;
 
@@ -321,6 +539,45 @@ bool CPrior::CModelFilter::operator()(EPrior model) const {
     return (m_Filter & model) != 0;
 }
 
+////////// CPrior::SSampleBatch Implementation //////////
+
+void CPrior::SSampleBatch::add(double sample, const TDoubleWeightsAry& weights) {
+    s_Samples.push_back(sample);
+    s_Counts.push_back(maths_t::count(weights));
+    s_SeasonalVarianceScales.push_back(maths_t::seasonalVarianceScale(weights));
+    s_CountVarianceScales.push_back(maths_t::countVarianceScale(weights));
+    s_WinsorisationWeights.push_back(maths_t::winsorisationWeight(weights));
+}
+
+void CPrior::SSampleBatch::clear() {
+    s_Samples.clear();
+    s_Counts.clear();
+    s_SeasonalVarianceScales.clear();
+    s_CountVarianceScales.clear();
+    s_WinsorisationWeights.clear();
+}
+
+void CPrior::SSampleBatch::reserve(std::size_t n) {
+    s_Samples.reserve(n);
+    s_Counts.reserve(n);
+    s_SeasonalVarianceScales.reserve(n);
+    s_CountVarianceScales.reserve(n);
+    s_WinsorisationWeights.reserve(n);
+}
+
+std::size_t CPrior::SSampleBatch::size() const {
+    return s_Samples.size();
+}
+
+CPrior::TDoubleWeightsAry CPrior::SSampleBatch::weights(std::size_t i) const {
+    TDoubleWeightsAry result(TWeights::UNIT);
+    maths_t::setCount(s_Counts[i], result);
+    maths_t::setSeasonalVarianceScale(s_SeasonalVarianceScales[i], result);
+    maths_t::setCountVarianceScale(s_CountVarianceScales[i], result);
+    maths_t::setWinsorisationWeight(s_WinsorisationWeights[i], result);
+    return result;
+}
+
 ////////// CPrior::CLogMarginalLikelihood Implementation //////////
 
 CPrior::CLogMarginalLikelihood::CLogMarginalLikelihood(const CPrior& prior,
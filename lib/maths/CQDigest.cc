@@ -356,6 +356,28 @@ void CQDigest::superlevelSetInfimum(uint32_t x, uint32_t& result) const {
     m_Root->superlevelSetInfimum(x, result);
 }
 
+void CQDigest::cdfBreakpoints(TUInt32Vec& result) const {
+    result.clear();
+    result.push_back(0);
+
+    TNodePtrVec nodes;
+    m_Root->postOrder(nodes);
+
+    // The bounds only depend on x through comparisons with the
+    // nodes' minimum and maximum values, i.e. min <= x, max <= x,
+    // max < x and max > x.
+    result.reserve(3 * nodes.size() + 1);
+    for (const auto& node : nodes) {
+        result.push_back(node->min());
+        result.push_back(node->max());
+        if (node->max() < std::numeric_limits<uint32_t>::max()) {
+            result.push_back(node->max() + 1);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
 void CQDigest::summary(TUInt32UInt64PrVec& result) const {
     result.clear();
 
@@ -14,8 +14,12 @@ namespace maths {
 STimeSeriesDecompositionRestoreParams::STimeSeriesDecompositionRestoreParams(
     double decayRate,
     core_t::TTime minimumBucketLength,
-    std::size_t componentSize)
-    : s_DecayRate{decayRate}, s_MinimumBucketLength{minimumBucketLength}, s_ComponentSize{componentSize} {
+    std::size_t componentSize,
+    CPeriodicityTestScheduler* periodicityTestScheduler,
+    bool deflatePeriodicityTestWindows)
+    : s_DecayRate{decayRate}, s_MinimumBucketLength{minimumBucketLength},
+      s_ComponentSize{componentSize}, s_PeriodicityTestScheduler{periodicityTestScheduler},
+      s_DeflatePeriodicityTestWindows{deflatePeriodicityTestWindows} {
 }
 
 SDistributionRestoreParams::SDistributionRestoreParams(maths_t::EDataType dataType,
@@ -7,24 +7,41 @@
 #include <maths/CSignal.h>
 
 #include <core/CLogger.h>
-
-#include <maths/CIntegerTools.h>
+#include <core/CFastMutex.h>
+#include <core/CScopedFastLock.h>
 
 #include <boost/math/constants/constants.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <memory>
 
 namespace ml {
 namespace maths {
 
 namespace {
 
+using TDoubleVec = std::vector<double>;
+using TSizeVec = std::vector<std::size_t>;
 using TComplex = std::complex<double>;
 using TComplexVec = std::vector<TComplex>;
 using TMeanAccumulator = CBasicStatistics::SSampleMean<double>::TAccumulator;
 using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
 
+//! The radixes for which we have butterflies in order of preference.
+const std::size_t RADIXES[]{4, 2, 3, 5};
+//! The maximum number of plans of each type we cache.
+const std::size_t MAX_CACHED_PLANS{64};
+
+//! Get \f$e^{-2\pi i k / n}\f$.
+TComplex twiddle(std::size_t k, std::size_t n) {
+    double t{-boost::math::double_constants::two_pi * static_cast<double>(k % n) /
+             static_cast<double>(n)};
+    return {std::cos(t), std::sin(t)};
+}
+
 //! Scale \p f by \p scale.
 void scale(double scale, TComplexVec& f) {
     for (std::size_t i = 0u; i < f.size(); ++i) {
@@ -32,37 +49,378 @@ void scale(double scale, TComplexVec& f) {
     }
 }
 
-//! Compute the radix 2 FFT of \p f in-place.
-void radix2fft(TComplexVec& f) {
-    // Perform the appropriate permutation of f(x) by swapping
-    // each i in [0, N] with its bit reversal.
+//! Factorize \p n into the radixes for which we have butterflies.
+//!
+//! \return False if \p n has any other prime factor.
+bool factorize(std::size_t n, TSizeVec& factors) {
+    factors.clear();
+    for (auto radix : RADIXES) {
+        for (/**/; n % radix == 0; n /= radix) {
+            factors.push_back(radix);
+        }
+    }
+    return n == 1;
+}
+
+//! Get the smallest number greater than or equal to \p n which only has
+//! prime factors 2, 3 and 5.
+std::size_t nextSmooth(std::size_t n) {
+    for (TSizeVec factors; /**/; ++n) {
+        if (factorize(n, factors)) {
+            return n;
+        }
+    }
+}
+
+//! \brief A plan for computing the DFT of a fixed length.
+//!
+//! DESCRIPTION:\n
+//! If the length only has prime factors 2, 3 and 5 this uses an iterative
+//! decimation in time mixed radix Cooley-Tukey transform. Otherwise, it
+//! uses Bluestein's trick to reformulate the transform as a convolution
+//! whose length has these factors.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! All the tables the transform needs, i.e. the input permutation and the
+//! twiddle factors for each stage, are computed when the plan is created.
+//! The twiddle factors are computed directly rather than by recurrence so
+//! they are accurate to a few ulp. Scratch memory is supplied by the caller
+//! so a plan is immutable and can be shared between threads.
+class CFftPlan {
+public:
+    explicit CFftPlan(std::size_t n) : m_Size{n} {
+        if (factorize(n, m_Factors)) {
+            this->initializeMixedRadix();
+        } else {
+            this->initializeBluestein();
+        }
+    }
+
+    //! Compute the DFT of \p f in-place.
+    void transform(TComplexVec& f, TComplexVec& buffer, TComplexVec& padded) const {
+        if (m_Bluestein == nullptr) {
+            this->mixedRadix(f, buffer);
+        } else {
+            this->bluestein(f, buffer, padded);
+        }
+    }
+
+private:
+    using TFftPlanUPtr = std::unique_ptr<CFftPlan>;
+
+private:
+    void initializeMixedRadix() {
+        // The factors are ordered so the first is the outermost split of
+        // the input. We compute the position of each input value such that
+        // the sub-transforms at every level of the recursion are contiguous.
+
+        m_Permutation.resize(m_Size);
+        std::function<void(std::size_t, std::size_t, std::size_t, std::size_t, std::size_t)> permute;
+        permute = [&](std::size_t position, std::size_t offset,
+                      std::size_t stride, std::size_t length, std::size_t level) {
+            if (level == m_Factors.size()) {
+                m_Permutation[position] = offset;
+                return;
+            }
+            std::size_t radix{m_Factors[level]};
+            std::size_t m{length / radix};
+            for (std::size_t q = 0u; q < radix; ++q) {
+                permute(position + q * m, offset + q * stride, stride * radix, m, level + 1);
+            }
+        };
+        permute(0, 0, 1, m_Size, 0);
+
+        // The twiddle factors for each stage are stored contiguously in
+        // the order the stages are applied, i.e. innermost first.
+
+        for (std::size_t i = m_Factors.size(), m = 1; i > 0; --i) {
+            std::size_t radix{m_Factors[i - 1]};
+            for (std::size_t q = 1u; q < radix; ++q) {
+                for (std::size_t k = 0u; k < m; ++k) {
+                    m_Twiddles.push_back(twiddle(q * k, radix * m));
+                }
+            }
+            m *= radix;
+        }
+    }
+
+    void initializeBluestein() {
+        // We use Bluestein's trick to reformulate as a convolution which
+        // can be computed by padding to a length with small prime factors.
+        // We precompute the chirp and the transform of the filter with the
+        // inverse transform scale folded in.
+
+        std::size_t n{m_Size};
+        std::size_t m{nextSmooth(2 * n - 1)};
+        m_Bluestein = std::make_unique<CFftPlan>(m);
+
+        m_Chirp.reserve(n);
+        m_Filter.assign(m, TComplex{0.0, 0.0});
+        for (std::size_t i = 0u; i < n; ++i) {
+            // Note that i^2 mod 2n is exact and avoids losing precision in
+            // the argument of the chirp for large i.
+            double t{boost::math::double_constants::pi *
+                     static_cast<double>((i * i) % (2 * n)) / static_cast<double>(n)};
+            m_Chirp.emplace_back(std::cos(t), std::sin(t));
+            m_Filter[i] = m_Filter[(m - i) % m] = m_Chirp[i];
+        }
+
+        TComplexVec buffer;
+        m_Bluestein->mixedRadix(m_Filter, buffer);
+        scale(1.0 / static_cast<double>(m), m_Filter);
+    }
+
+    void mixedRadix(TComplexVec& f, TComplexVec& buffer) const {
+        std::size_t n{m_Size};
+        buffer.resize(n);
+        for (std::size_t i = 0u; i < n; ++i) {
+            buffer[i] = f[m_Permutation[i]];
+        }
+
+        const TComplex* twiddles{m_Twiddles.data()};
+        for (std::size_t i = m_Factors.size(), m = 1; i > 0; --i) {
+            std::size_t radix{m_Factors[i - 1]};
+            std::size_t length{radix * m};
+            for (std::size_t block = 0u; block < n; block += length) {
+                TComplex* x{&buffer[block]};
+                switch (radix) {
+                case 2:
+                    butterfly2(twiddles, m, x);
+                    break;
+                case 3:
+                    butterfly3(twiddles, m, x);
+                    break;
+                case 4:
+                    butterfly4(twiddles, m, x);
+                    break;
+                case 5:
+                    butterfly5(twiddles, m, x);
+                    break;
+                }
+            }
+            twiddles += (radix - 1) * m;
+            m = length;
+        }
+
+        std::copy(buffer.begin(), buffer.end(), f.begin());
+    }
+
+    void bluestein(TComplexVec& f, TComplexVec& buffer, TComplexVec& padded) const {
+        std::size_t n{m_Size};
+        std::size_t m{m_Filter.size()};
+
+        padded.assign(m, TComplex{0.0, 0.0});
+        for (std::size_t i = 0u; i < n; ++i) {
+            padded[i] = f[i] * std::conj(m_Chirp[i]);
+        }
+
+        // Convolve with the filter, computing the inverse transform by
+        // conjugating the input and output of the forward transform.
+        m_Bluestein->mixedRadix(padded, buffer);
+        for (std::size_t i = 0u; i < m; ++i) {
+            padded[i] = std::conj(padded[i] * m_Filter[i]);
+        }
+        m_Bluestein->mixedRadix(padded, buffer);
+
+        for (std::size_t i = 0u; i < n; ++i) {
+            f[i] = std::conj(m_Chirp[i]) * std::conj(padded[i]);
+        }
+    }
+
+    //! \name Butterflies
+    //!
+    //! These combine \p radix contiguous transforms of length \p m starting
+    //! at \p x into one of length \p radix * \p m.
+    //@{
+    static void butterfly2(const TComplex* w, std::size_t m, TComplex* x) {
+        for (std::size_t k = 0u; k < m; ++k) {
+            TComplex t0{x[k]};
+            TComplex t1{w[k] * x[k + m]};
+            x[k] = t0 + t1;
+            x[k + m] = t0 - t1;
+        }
+    }
+
+    static void butterfly3(const TComplex* w, std::size_t m, TComplex* x) {
+        static const double C{-0.5};
+        static const double S{0.5 * std::sqrt(3.0)};
+        for (std::size_t k = 0u; k < m; ++k) {
+            TComplex t0{x[k]};
+            TComplex t1{w[k] * x[k + m]};
+            TComplex t2{w[k + m] * x[k + 2 * m]};
+            TComplex a{t0 + C * (t1 + t2)};
+            TComplex b{minusI(S * (t1 - t2))};
+            x[k] = t0 + t1 + t2;
+            x[k + m] = a + b;
+            x[k + 2 * m] = a - b;
+        }
+    }
+
+    static void butterfly4(const TComplex* w, std::size_t m, TComplex* x) {
+        for (std::size_t k = 0u; k < m; ++k) {
+            TComplex t0{x[k]};
+            TComplex t1{w[k] * x[k + m]};
+            TComplex t2{w[k + m] * x[k + 2 * m]};
+            TComplex t3{w[k + 2 * m] * x[k + 3 * m]};
+            TComplex a0{t0 + t2};
+            TComplex a1{t0 - t2};
+            TComplex b0{t1 + t3};
+            TComplex b1{minusI(t1 - t3)};
+            x[k] = a0 + b0;
+            x[k + m] = a1 + b1;
+            x[k + 2 * m] = a0 - b0;
+            x[k + 3 * m] = a1 - b1;
+        }
+    }
 
-    uint64_t bits = CIntegerTools::nextPow2(f.size()) - 1;
-    for (uint64_t i = 0; i < f.size(); ++i) {
-        uint64_t j = CIntegerTools::reverseBits(i) >> (64 - bits);
-        if (j > i) {
-            LOG_TRACE(<< j << " -> " << i);
-            std::swap(f[i], f[j]);
+    static void butterfly5(const TComplex* w, std::size_t m, TComplex* x) {
+        static const double C1{std::cos(0.4 * boost::math::double_constants::pi)};
+        static const double C2{std::cos(0.8 * boost::math::double_constants::pi)};
+        static const double S1{std::sin(0.4 * boost::math::double_constants::pi)};
+        static const double S2{std::sin(0.8 * boost::math::double_constants::pi)};
+        for (std::size_t k = 0u; k < m; ++k) {
+            TComplex t0{x[k]};
+            TComplex t1{w[k] * x[k + m]};
+            TComplex t2{w[k + m] * x[k + 2 * m]};
+            TComplex t3{w[k + 2 * m] * x[k + 3 * m]};
+            TComplex t4{w[k + 3 * m] * x[k + 4 * m]};
+            TComplex a1{t1 + t4};
+            TComplex b1{t1 - t4};
+            TComplex a2{t2 + t3};
+            TComplex b2{t2 - t3};
+            TComplex c1{t0 + C1 * a1 + C2 * a2};
+            TComplex c2{t0 + C2 * a1 + C1 * a2};
+            TComplex d1{minusI(S1 * b1 + S2 * b2)};
+            TComplex d2{minusI(S2 * b1 - S1 * b2)};
+            x[k] = t0 + a1 + a2;
+            x[k + m] = c1 + d1;
+            x[k + 2 * m] = c2 + d2;
+            x[k + 3 * m] = c2 - d2;
+            x[k + 4 * m] = c1 - d1;
+        }
+    }
+    //@}
+
+    //! Multiply \p x by -i.
+    static TComplex minusI(const TComplex& x) { return {x.imag(), -x.real()}; }
+
+private:
+    //! The transform length.
+    std::size_t m_Size;
+    //! The radixes of the transform stages, outermost first.
+    TSizeVec m_Factors;
+    //! The position of each input value before the first stage.
+    TSizeVec m_Permutation;
+    //! The twiddle factors for each stage, innermost first.
+    TComplexVec m_Twiddles;
+    //! The plan for the padded convolution if we use Bluestein's trick.
+    TFftPlanUPtr m_Bluestein;
+    //! The chirp for Bluestein's trick.
+    TComplexVec m_Chirp;
+    //! The scaled transform of the Bluestein filter.
+    TComplexVec m_Filter;
+};
+
+//! \brief A plan for computing the DFT of real values of a fixed even length.
+//!
+//! DESCRIPTION:\n
+//! This packs the even and odd values into the real and imaginary parts
+//! of a complex signal of half the length and unpacks its transform.
+class CRealFftPlan {
+public:
+    using TFftPlanCPtr = std::shared_ptr<const CFftPlan>;
+
+public:
+    CRealFftPlan(std::size_t n, TFftPlanCPtr half) : m_Half{std::move(half)} {
+        m_Twiddles.reserve(n / 2 + 1);
+        for (std::size_t k = 0u; k <= n / 2; ++k) {
+            m_Twiddles.push_back(twiddle(k, n));
         }
     }
 
-    // Apply the twiddle factors.
+    //! Compute the DFT of \p f.
+    void transform(const TDoubleVec& f,
+                   TComplexVec& result,
+                   TComplexVec& packed,
+                   TComplexVec& buffer,
+                   TComplexVec& padded) const {
+        std::size_t h{f.size() / 2};
+
+        packed.resize(h);
+        for (std::size_t i = 0u; i < h; ++i) {
+            packed[i] = TComplex{f[2 * i], f[2 * i + 1]};
+        }
+        m_Half->transform(packed, buffer, padded);
+
+        // If Z is the transform of the packed values then the transforms
+        // of the even and odd values are E(k) = (Z(k) + Z*(h-k)) / 2 and
+        // O(k) = -i (Z(k) - Z*(h-k)) / 2, and X(k) = E(k) + w^k O(k).
+        result.resize(h + 1);
+        for (std::size_t k = 0u; k <= h; ++k) {
+            TComplex z{packed[k % h]};
+            TComplex zc{std::conj(packed[(h - k) % h])};
+            TComplex e{0.5 * (z + zc)};
+            TComplex d{0.5 * (z - zc)};
+            TComplex o{d.imag(), -d.real()};
+            result[k] = e + m_Twiddles[k] * o;
+        }
+    }
 
-    for (std::size_t stride = 1; stride < f.size(); stride <<= 1) {
-        for (std::size_t k = 0u; k < stride; ++k) {
-            double t = boost::math::double_constants::pi *
-                       static_cast<double>(k) / static_cast<double>(stride);
-            TComplex w(std::cos(t), std::sin(t));
-            for (std::size_t start = k; start < f.size(); start += 2 * stride) {
-                TComplex fs = f[start];
-                TComplex tw = w * f[start + stride];
-                f[start] = fs + tw;
-                f[start + stride] = fs - tw;
+private:
+    //! The plan for the packed transform.
+    TFftPlanCPtr m_Half;
+    //! The twiddle factors for unpacking the packed transform.
+    TComplexVec m_Twiddles;
+};
+
+using TFftPlanCPtr = std::shared_ptr<const CFftPlan>;
+using TRealFftPlanCPtr = std::shared_ptr<const CRealFftPlan>;
+
+//! \brief A thread safe cache of plans by length.
+template<typename PLAN>
+class CPlanCache {
+public:
+    using TPlanCPtr = std::shared_ptr<const PLAN>;
+    using TSizePlanCPtrUMap = boost::unordered_map<std::size_t, TPlanCPtr>;
+
+public:
+    //! Get the plan for length \p n creating it with \p create if necessary.
+    template<typename CREATE>
+    TPlanCPtr get(std::size_t n, CREATE create) {
+        {
+            core::CScopedFastLock lock(m_Mutex);
+            auto i = m_Plans.find(n);
+            if (i != m_Plans.end()) {
+                return i->second;
             }
         }
+        // We create the plan outside the lock since this can be slow and
+        // may itself need other plans from a cache.
+        TPlanCPtr plan{create(n)};
+        core::CScopedFastLock lock(m_Mutex);
+        if (m_Plans.size() >= MAX_CACHED_PLANS) {
+            m_Plans.clear();
+        }
+        return m_Plans.emplace(n, std::move(plan)).first->second;
     }
 
-    std::reverse(f.begin() + 1, f.end());
+private:
+    core::CFastMutex m_Mutex;
+    TSizePlanCPtrUMap m_Plans;
+};
+
+TFftPlanCPtr fftPlan(std::size_t n) {
+    static CPlanCache<CFftPlan> cache;
+    return cache.get(n, [](std::size_t n_) {
+        return std::make_shared<const CFftPlan>(n_);
+    });
+}
+
+TRealFftPlanCPtr realFftPlan(std::size_t n) {
+    static CPlanCache<CRealFftPlan> cache;
+    return cache.get(n, [](std::size_t n_) {
+        return std::make_shared<const CRealFftPlan>(n_, fftPlan(n_ / 2));
+    });
 }
 }
 
@@ -79,58 +437,45 @@ void CSignal::hadamard(const TComplexVec& fx, TComplexVec& fy) {
 }
 
 void CSignal::fft(TComplexVec& f) {
-    std::size_t n = f.size();
-    std::size_t p = CIntegerTools::nextPow2(n);
-    std::size_t m = std::size_t{1} << p;
-
-    LOG_TRACE(<< "n = " << n << ", m = " << m);
-
-    if ((m >> 1) == n) {
-        radix2fft(f);
-    } else {
-        // We use Bluestein's trick to reformulate as a convolution
-        // which can be computed by padding to a power of 2.
-
-        LOG_TRACE(<< "Using Bluestein's trick");
-
-        m = 2 * n - 1;
-        p = CIntegerTools::nextPow2(m);
-        m = std::size_t{1} << p;
-
-        TComplexVec chirp;
-        chirp.reserve(n);
-        TComplexVec a(m, TComplex(0.0));
-        TComplexVec b(m, TComplex(0.0));
-
-        chirp.emplace_back(1.0, 0.0);
-        a[0] = f[0] * chirp[0];
-        b[0] = chirp[0];
-        for (std::size_t i = 1u; i < n; ++i) {
-            double t = boost::math::double_constants::pi *
-                       static_cast<double>(i * i) / static_cast<double>(n);
-            chirp.emplace_back(std::cos(t), std::sin(t));
-            a[i] = f[i] * std::conj(chirp[i]);
-            b[i] = b[m - i] = chirp[i];
-        }
-
-        fft(a);
-        fft(b);
-        hadamard(a, b);
-        ifft(b);
+    CFftWorkspace workspace;
+    fft(f, workspace);
+}
 
-        for (std::size_t i = 0u; i < n; ++i) {
-            f[i] = std::conj(chirp[i]) * b[i];
-        }
+void CSignal::fft(TComplexVec& f, CFftWorkspace& workspace) {
+    if (f.size() > 1) {
+        fftPlan(f.size())->transform(f, workspace.m_Buffer, workspace.m_Padded);
     }
 }
 
 void CSignal::ifft(TComplexVec& f) {
+    CFftWorkspace workspace;
+    ifft(f, workspace);
+}
+
+void CSignal::ifft(TComplexVec& f, CFftWorkspace& workspace) {
     conj(f);
-    fft(f);
+    fft(f, workspace);
     conj(f);
     scale(1.0 / static_cast<double>(f.size()), f);
 }
 
+void CSignal::realFft(const TDoubleVec& f, TComplexVec& result) {
+    CFftWorkspace workspace;
+    realFft(f, result, workspace);
+}
+
+void CSignal::realFft(const TDoubleVec& f, TComplexVec& result, CFftWorkspace& workspace) {
+    std::size_t n{f.size()};
+    if (n % 2 == 0 && n > 0) {
+        realFftPlan(n)->transform(f, result, workspace.m_Packed,
+                                  workspace.m_Buffer, workspace.m_Padded);
+    } else {
+        result.assign(f.begin(), f.end());
+        fft(result, workspace);
+        result.resize(n / 2 + 1);
+    }
+}
+
 double CSignal::autocorrelation(std::size_t offset, const TFloatMeanAccumulatorVec& values) {
     return autocorrelation(offset, TFloatMeanAccumulatorCRng(values, 0, values.size()));
 }
@@ -165,6 +510,13 @@ double CSignal::autocorrelation(std::size_t offset, TFloatMeanAccumulatorCRng va
 }
 
 void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVec& result) {
+    CFftWorkspace workspace;
+    autocorrelations(values, result, workspace);
+}
+
+void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values,
+                               TDoubleVec& result,
+                               CFftWorkspace& workspace) {
     if (values.empty()) {
         return;
     }
@@ -180,7 +532,8 @@ void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVe
     double mean = CBasicStatistics::mean(moments);
     double variance = CBasicStatistics::maximumLikelihoodVariance(moments);
 
-    TComplexVec f;
+    TDoubleVec& f = workspace.m_Real;
+    f.clear();
     f.reserve(n);
     for (std::size_t i = 0u; i < n; ++i) {
         std::size_t j = i;
@@ -189,32 +542,41 @@ void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVe
         if (i != j) {
             // Infer missing values by linearly interpolating.
             if (j == n) {
-                f.resize(n, TComplex(0.0, 0.0));
+                f.resize(n, 0.0);
                 break;
             } else if (i == 0) {
-                f.resize(j - 1, TComplex(0.0, 0.0));
+                f.resize(j - 1, 0.0);
             } else {
                 for (std::size_t k = i; k < j; ++k) {
                     double alpha = static_cast<double>(k - i + 1) /
                                    static_cast<double>(j - i + 1);
                     double real = CBasicStatistics::mean(values[j]) - mean;
-                    f.push_back((1.0 - alpha) * f[i - 1] + alpha * TComplex(real, 0.0));
+                    f.push_back((1.0 - alpha) * f[i - 1] + alpha * real);
                 }
             }
             i = j;
         }
-        f.emplace_back(CBasicStatistics::mean(values[i]) - mean, 0.0);
+        f.push_back(CBasicStatistics::mean(values[i]) - mean);
     }
-
-    fft(f);
-    TComplexVec fConj(f);
-    conj(fConj);
-    hadamard(fConj, f);
-    ifft(f);
+    n = f.size();
+
+    // The autocorrelation is the inverse transform of the power spectrum.
+    // The values are real so we only need half their transform. The power
+    // spectrum is real and even so its inverse transform is its forward
+    // transform scaled by 1 / n and is also real and even.
+
+    TComplexVec& transform = workspace.m_Transform;
+    realFft(f, transform, workspace);
+    f.resize(n);
+    for (std::size_t i = 0u; i < transform.size(); ++i) {
+        f[i] = f[(n - i) % n] = std::norm(transform[i]);
+    }
+    realFft(f, transform, workspace);
 
     result.reserve(n);
     for (std::size_t i = 1u; i < n; ++i) {
-        result.push_back(f[i].real() / variance / static_cast<double>(n));
+        result.push_back(transform[std::min(i, n - i)].real() / variance /
+                         static_cast<double>(n * n));
     }
 }
 }
@@ -0,0 +1,984 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <maths/CSpecialFunctions.h>
+
+#include <core/CLogger.h>
+
+#include <boost/math/distributions/students_t.hpp>
+#include <boost/math/special_functions/beta.hpp>
+#include <boost/math/special_functions/gamma.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ML_SPECIAL_FUNCTIONS_SSE2
+#endif
+
+namespace ml {
+namespace maths {
+
+namespace {
+
+const double INF{std::numeric_limits<double>::infinity()};
+const double NOT_A_NUMBER{std::numeric_limits<double>::quiet_NaN()};
+const double EPSILON{std::numeric_limits<double>::epsilon()};
+const double MIN_DOUBLE{std::numeric_limits<double>::min()};
+//! Used to stop the continued fractions dividing by zero.
+const double TINY{1e-300};
+//! 2^52 plus the exponent bias, see pow2.
+const double POW2_52_PLUS_BIAS{4503599627371519.0};
+//! 2^52, see decompose.
+const double POW2_52{4503599627370496.0};
+const std::uint64_t POW2_52_BITS{0x4330000000000000};
+const std::uint64_t MANTISSA_MASK{0x000FFFFFFFFFFFFF};
+const std::uint64_t ONE_BITS{0x3FF0000000000000};
+const std::uint64_t HIGH_HALF_MASK{0xFFFFFFFFF8000000};
+const double LOG2_E{1.4426950408889634};
+const double LOG_2_HIGH{6.93147180369123816490e-01};
+const double LOG_2_LOW{1.90821492927058770002e-10};
+const double ROOT_TWO{1.4142135623730951};
+const double HALF_LOG_TWO_PI{0.91893853320467274178};
+const double TWO_OVER_ROOT_PI{1.1283791670955126};
+//! The maximum number of terms of the series and continued fractions
+//! before the fallback implementation is used.
+const int MAX_ITERATIONS{500};
+
+//! \name Packs
+//!
+//! A pack holds as many doubles as fit in a vector register and a mask
+//! holds the result of comparing two packs. These wrap the intrinsics
+//! for the instruction set we're compiling for behind one interface
+//! so there is a single implementation of each special function.
+//!
+//! The bit manipulations, i.e. pow2, highHalf and decompose, are only
+//! valid for normal positive values.
+//@{
+#if defined(__AVX2__)
+
+class CMask {
+public:
+    explicit CMask(bool value)
+        : m_Value(_mm256_castsi256_pd(_mm256_set1_epi64x(value ? -1 : 0))) {}
+    explicit CMask(__m256d value) : m_Value(value) {}
+
+    __m256d value() const { return m_Value; }
+
+    CMask operator&(const CMask& rhs) const {
+        return CMask(_mm256_and_pd(m_Value, rhs.m_Value));
+    }
+    CMask operator|(const CMask& rhs) const {
+        return CMask(_mm256_or_pd(m_Value, rhs.m_Value));
+    }
+    CMask operator~() const {
+        return CMask(_mm256_xor_pd(m_Value, CMask(true).m_Value));
+    }
+
+private:
+    __m256d m_Value;
+};
+
+class CPack {
+public:
+    static const std::size_t WIDTH = 4;
+
+public:
+    CPack() = default;
+    CPack(double value) : m_Value(_mm256_set1_pd(value)) {}
+    explicit CPack(__m256d value) : m_Value(value) {}
+
+    static CPack load(const double* values) {
+        return CPack(_mm256_loadu_pd(values));
+    }
+    void store(double* values) const { _mm256_storeu_pd(values, m_Value); }
+
+    __m256d value() const { return m_Value; }
+
+    CPack operator-() const {
+        return CPack(_mm256_xor_pd(m_Value, _mm256_set1_pd(-0.0)));
+    }
+    friend CPack operator+(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm256_add_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator-(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm256_sub_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator*(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm256_mul_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator/(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm256_div_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator<(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_LT_OQ));
+    }
+    friend CMask operator<=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_LE_OQ));
+    }
+    friend CMask operator>(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_GT_OQ));
+    }
+    friend CMask operator>=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_GE_OQ));
+    }
+    friend CMask operator==(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_EQ_OQ));
+    }
+    friend CMask operator!=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm256_cmp_pd(lhs.m_Value, rhs.m_Value, _CMP_NEQ_UQ));
+    }
+
+private:
+    __m256d m_Value;
+};
+
+const char* INSTRUCTION_SET{"avx2"};
+
+inline bool any(const CMask& mask) {
+    return _mm256_movemask_pd(mask.value()) != 0;
+}
+inline CPack select(const CMask& mask, const CPack& lhs, const CPack& rhs) {
+    return CPack(_mm256_blendv_pd(rhs.value(), lhs.value(), mask.value()));
+}
+inline CPack sqrt(const CPack& x) {
+    return CPack(_mm256_sqrt_pd(x.value()));
+}
+inline CPack fabs(const CPack& x) {
+    return CPack(_mm256_andnot_pd(_mm256_set1_pd(-0.0), x.value()));
+}
+inline CPack round(const CPack& x) {
+    return CPack(_mm256_round_pd(x.value(), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+//! Get 2^k for integer \p k in the range [-1022, 1023].
+inline CPack pow2(const CPack& k) {
+    __m256i bits{_mm256_castpd_si256((k + POW2_52_PLUS_BIAS).value())};
+    return CPack(_mm256_castsi256_pd(_mm256_slli_epi64(bits, 52)));
+}
+//! Zero the low 27 bits of the mantissa of \p x so its square is exact.
+inline CPack highHalf(const CPack& x) {
+    return CPack(_mm256_and_pd(x.value(), _mm256_castsi256_pd(_mm256_set1_epi64x(HIGH_HALF_MASK))));
+}
+//! Get the mantissa in the range [1, 2) and the unbiased exponent of \p x.
+inline void decompose(const CPack& x, CPack& mantissa, CPack& exponent) {
+    __m256i bits{_mm256_castpd_si256(x.value())};
+    mantissa = CPack(_mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(MANTISSA_MASK)),
+        _mm256_set1_epi64x(ONE_BITS))));
+    exponent = CPack(_mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(POW2_52_BITS))));
+    exponent = exponent - (POW2_52 + 1023.0);
+}
+
+#elif defined(ML_SPECIAL_FUNCTIONS_SSE2)
+
+class CMask {
+public:
+    explicit CMask(bool value)
+        : m_Value(_mm_castsi128_pd(_mm_set1_epi32(value ? -1 : 0))) {}
+    explicit CMask(__m128d value) : m_Value(value) {}
+
+    __m128d value() const { return m_Value; }
+
+    CMask operator&(const CMask& rhs) const {
+        return CMask(_mm_and_pd(m_Value, rhs.m_Value));
+    }
+    CMask operator|(const CMask& rhs) const {
+        return CMask(_mm_or_pd(m_Value, rhs.m_Value));
+    }
+    CMask operator~() const {
+        return CMask(_mm_xor_pd(m_Value, CMask(true).m_Value));
+    }
+
+private:
+    __m128d m_Value;
+};
+
+class CPack {
+public:
+    static const std::size_t WIDTH = 2;
+
+public:
+    CPack() = default;
+    CPack(double value) : m_Value(_mm_set1_pd(value)) {}
+    explicit CPack(__m128d value) : m_Value(value) {}
+
+    static CPack load(const double* values) {
+        return CPack(_mm_loadu_pd(values));
+    }
+    void store(double* values) const { _mm_storeu_pd(values, m_Value); }
+
+    __m128d value() const { return m_Value; }
+
+    CPack operator-() const {
+        return CPack(_mm_xor_pd(m_Value, _mm_set1_pd(-0.0)));
+    }
+    friend CPack operator+(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm_add_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator-(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm_sub_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator*(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm_mul_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CPack operator/(const CPack& lhs, const CPack& rhs) {
+        return CPack(_mm_div_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator<(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmplt_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator<=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmple_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator>(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmpgt_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator>=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmpge_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator==(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmpeq_pd(lhs.m_Value, rhs.m_Value));
+    }
+    friend CMask operator!=(const CPack& lhs, const CPack& rhs) {
+        return CMask(_mm_cmpneq_pd(lhs.m_Value, rhs.m_Value));
+    }
+
+private:
+    __m128d m_Value;
+};
+
+const char* INSTRUCTION_SET{"sse2"};
+
+inline bool any(const CMask& mask) {
+    return _mm_movemask_pd(mask.value()) != 0;
+}
+inline CPack select(const CMask& mask, const CPack& lhs, const CPack& rhs) {
+    return CPack(_mm_or_pd(_mm_and_pd(mask.value(), lhs.value()),
+                           _mm_andnot_pd(mask.value(), rhs.value())));
+}
+inline CPack sqrt(const CPack& x) {
+    return CPack(_mm_sqrt_pd(x.value()));
+}
+inline CPack fabs(const CPack& x) {
+    return CPack(_mm_andnot_pd(_mm_set1_pd(-0.0), x.value()));
+}
+inline CPack round(const CPack& x) {
+    // Adding and subtracting 1.5 * 2^52 rounds to the nearest integer
+    // for |x| < 2^51. SSE2 has no rounding instruction.
+    const CPack magic{6755399441055744.0};
+    return (x + magic) - magic;
+}
+//! Get 2^k for integer \p k in the range [-1022, 1023].
+inline CPack pow2(const CPack& k) {
+    __m128i bits{_mm_castpd_si128((k + POW2_52_PLUS_BIAS).value())};
+    return CPack(_mm_castsi128_pd(_mm_slli_epi64(bits, 52)));
+}
+//! Zero the low 27 bits of the mantissa of \p x so its square is exact.
+inline CPack highHalf(const CPack& x) {
+    return CPack(_mm_and_pd(x.value(), _mm_castsi128_pd(_mm_set1_epi64x(HIGH_HALF_MASK))));
+}
+//! Get the mantissa in the range [1, 2) and the unbiased exponent of \p x.
+inline void decompose(const CPack& x, CPack& mantissa, CPack& exponent) {
+    __m128i bits{_mm_castpd_si128(x.value())};
+    mantissa = CPack(_mm_castsi128_pd(
+        _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(MANTISSA_MASK)),
+                     _mm_set1_epi64x(ONE_BITS))));
+    exponent = CPack(_mm_castsi128_pd(
+        _mm_or_si128(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(POW2_52_BITS))));
+    exponent = exponent - (POW2_52 + 1023.0);
+}
+
+#else
+
+class CMask {
+public:
+    explicit CMask(bool value) : m_Value(value) {}
+
+    bool value() const { return m_Value; }
+
+    CMask operator&(const CMask& rhs) const {
+        return CMask(m_Value && rhs.m_Value);
+    }
+    CMask operator|(const CMask& rhs) const {
+        return CMask(m_Value || rhs.m_Value);
+    }
+    CMask operator~() const { return CMask(!m_Value); }
+
+private:
+    bool m_Value;
+};
+
+class CPack {
+public:
+    static const std::size_t WIDTH = 1;
+
+public:
+    CPack() = default;
+    CPack(double value) : m_Value(value) {}
+
+    static CPack load(const double* values) { return CPack(*values); }
+    void store(double* values) const { *values = m_Value; }
+
+    double value() const { return m_Value; }
+
+    CPack operator-() const { return CPack(-m_Value); }
+    friend CPack operator+(const CPack& lhs, const CPack& rhs) {
+        return CPack(lhs.m_Value + rhs.m_Value);
+    }
+    friend CPack operator-(const CPack& lhs, const CPack& rhs) {
+        return CPack(lhs.m_Value - rhs.m_Value);
+    }
+    friend CPack operator*(const CPack& lhs, const CPack& rhs) {
+        return CPack(lhs.m_Value * rhs.m_Value);
+    }
+    friend CPack operator/(const CPack& lhs, const CPack& rhs) {
+        return CPack(lhs.m_Value / rhs.m_Value);
+    }
+    friend CMask operator<(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value < rhs.m_Value);
+    }
+    friend CMask operator<=(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value <= rhs.m_Value);
+    }
+    friend CMask operator>(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value > rhs.m_Value);
+    }
+    friend CMask operator>=(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value >= rhs.m_Value);
+    }
+    friend CMask operator==(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value == rhs.m_Value);
+    }
+    friend CMask operator!=(const CPack& lhs, const CPack& rhs) {
+        return CMask(lhs.m_Value != rhs.m_Value);
+    }
+
+private:
+    double m_Value;
+};
+
+const char* INSTRUCTION_SET{"scalar"};
+
+inline bool any(const CMask& mask) {
+    return mask.value();
+}
+inline CPack select(const CMask& mask, const CPack& lhs, const CPack& rhs) {
+    return mask.value() ? lhs : rhs;
+}
+inline CPack sqrt(const CPack& x) {
+    return CPack(std::sqrt(x.value()));
+}
+inline CPack fabs(const CPack& x) {
+    return CPack(std::fabs(x.value()));
+}
+inline CPack round(const CPack& x) {
+    return CPack(std::floor(x.value() + 0.5));
+}
+//! Get 2^k for integer \p k in the range [-1022, 1023].
+inline CPack pow2(const CPack& k) {
+    std::uint64_t bits{static_cast<std::uint64_t>(k.value() + 1023.0) << 52};
+    double result;
+    // Use memcpy() rather than union to adhere to strict aliasing rules
+    std::memcpy(&result, &bits, sizeof(double));
+    return CPack(result);
+}
+//! Zero the low 27 bits of the mantissa of \p x so its square is exact.
+inline CPack highHalf(const CPack& x) {
+    double value{x.value()};
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(double));
+    bits &= HIGH_HALF_MASK;
+    std::memcpy(&value, &bits, sizeof(double));
+    return CPack(value);
+}
+//! Get the mantissa in the range [1, 2) and the unbiased exponent of \p x.
+inline void decompose(const CPack& x, CPack& mantissa, CPack& exponent) {
+    double value{x.value()};
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(double));
+    exponent = CPack(static_cast<double>(bits >> 52) - 1023.0);
+    bits = (bits & MANTISSA_MASK) | ONE_BITS;
+    std::memcpy(&value, &bits, sizeof(double));
+    mantissa = CPack(value);
+}
+
+#endif
+//@}
+
+//! \name Kernels
+//!
+//! These evaluate the special functions for a pack of arguments.
+//@{
+
+//! Evaluate the polynomial with \p coefficients, in order of increasing
+//! power, at \p x.
+template<std::size_t N>
+inline CPack polynomial(const double (&coefficients)[N], const CPack& x) {
+    CPack result{coefficients[N - 1]};
+    for (std::size_t i = N - 1; i > 0; --i) {
+        result = result * x + coefficients[i - 1];
+    }
+    return result;
+}
+
+//! Compute exp(\p x).
+CPack exp(CPack x) {
+    // We reduce to r = x - k log(2) with |r| <= log(2) / 2 and use the
+    // Taylor series of exp(r), which to 14 terms has relative error less
+    // than 1e-17.
+    static const double TAYLOR[]{1.0,
+                                 1.0,
+                                 1.0 / 2.0,
+                                 1.0 / 6.0,
+                                 1.0 / 24.0,
+                                 1.0 / 120.0,
+                                 1.0 / 720.0,
+                                 1.0 / 5040.0,
+                                 1.0 / 40320.0,
+                                 1.0 / 362880.0,
+                                 1.0 / 3628800.0,
+                                 1.0 / 39916800.0,
+                                 1.0 / 479001600.0,
+                                 1.0 / 6227020800.0};
+
+    CMask nan{x != x};
+    CMask overflow{x > 709.78};
+    x = select(x < -746.0, CPack(-746.0), select(overflow, CPack(709.0), x));
+
+    CPack k{round(x * LOG2_E)};
+    CPack r{(x - k * LOG_2_HIGH) - k * LOG_2_LOW};
+    CPack result{polynomial(TAYLOR, r)};
+
+    // Split the scaling so that the result can be subnormal.
+    CPack k1{round(k * 0.5)};
+    result = result * pow2(k1) * pow2(k - k1);
+
+    return select(nan, x, select(overflow, CPack(INF), result));
+}
+
+//! Compute log(\p x).
+CPack log(CPack x) {
+    // We reduce to m 2^e with 1/2^(1/2) <= m <= 2^(1/2) and use the series
+    //   log(m) = 2 Sum_k{ s^(2k+1) / (2k+1) }
+    // with s = (m - 1) / (m + 1) so |s| < 0.172, which to 12 terms has
+    // relative error less than 1e-19.
+    static const double SERIES[]{1.0,        1.0 / 3.0,  1.0 / 5.0,
+                                 1.0 / 7.0,  1.0 / 9.0,  1.0 / 11.0,
+                                 1.0 / 13.0, 1.0 / 15.0, 1.0 / 17.0,
+                                 1.0 / 19.0, 1.0 / 21.0, 1.0 / 23.0};
+
+    CMask nan{~(x >= 0.0)};
+    CMask zero{x == 0.0};
+    CMask infinite{x == INF};
+    x = select(nan | zero | infinite, CPack(1.0), x);
+    CMask subnormal{x < MIN_DOUBLE};
+    x = select(subnormal, x * 18014398509481984.0 /*2^54*/, x);
+
+    CPack m{0.0};
+    CPack e{0.0};
+    decompose(x, m, e);
+    e = select(subnormal, e - 54.0, e);
+    CMask large{m > ROOT_TWO};
+    m = select(large, m * 0.5, m);
+    e = select(large, e + 1.0, e);
+
+    CPack s{(m - 1.0) / (m + 1.0)};
+    CPack result{e * LOG_2_HIGH + (2.0 * s * polynomial(SERIES, s * s) + e * LOG_2_LOW)};
+
+    return select(nan, CPack(NOT_A_NUMBER),
+                  select(zero, CPack(-INF), select(infinite, CPack(INF), result)));
+}
+
+//! Compute log(Gamma(\p x)).
+CPack logGamma(CPack x) {
+    // We use the recurrence Gamma(x + 1) = x Gamma(x) to shift the argument
+    // to at least 10 and then Stirling's series which to 8 terms has error
+    // less than 1e-16. Note that the product of the shifts is at most 10!.
+    static const double STIRLING[]{1.0 / 12.0,    -1.0 / 360.0,
+                                   1.0 / 1260.0,  -1.0 / 1680.0,
+                                   1.0 / 1188.0,  -691.0 / 360360.0,
+                                   1.0 / 156.0,   -3617.0 / 122400.0};
+
+    CMask nan{~(x > 0.0)};
+    CMask infinite{x == INF};
+    x = select(nan | infinite, CPack(1.0), x);
+
+    CPack product{1.0};
+    for (int i = 0; i < 10; ++i) {
+        CMask shift{x < 10.0};
+        if (!any(shift)) {
+            break;
+        }
+        product = select(shift, product * x, product);
+        x = select(shift, x + 1.0, x);
+    }
+
+    CPack r{1.0 / x};
+    CPack result{(x - 0.5) * log(x) - x + HALF_LOG_TWO_PI +
+                 r * polynomial(STIRLING, r * r) - log(product)};
+
+    return select(nan, CPack(NOT_A_NUMBER), select(infinite, CPack(INF), result));
+}
+
+//! Compute the digamma function at \p x.
+CPack digamma(CPack x) {
+    // We use the recurrence f(x + 1) = f(x) + 1 / x to shift the argument
+    // to at least 10 and then the asymptotic expansion which to 7 terms has
+    // error less than 1e-16.
+    static const double ASYMPTOTIC[]{1.0 / 12.0,  -1.0 / 120.0, 1.0 / 252.0,
+                                     -1.0 / 240.0, 1.0 / 132.0, -691.0 / 32760.0,
+                                     1.0 / 12.0};
+
+    CMask nan{~(x > 0.0)};
+    CMask infinite{x == INF};
+    x = select(nan | infinite, CPack(1.0), x);
+
+    CPack shifts{0.0};
+    for (int i = 0; i < 10; ++i) {
+        CMask shift{x < 10.0};
+        if (!any(shift)) {
+            break;
+        }
+        shifts = select(shift, shifts + 1.0 / x, shifts);
+        x = select(shift, x + 1.0, x);
+    }
+
+    CPack r2{1.0 / (x * x)};
+    CPack result{log(x) - 0.5 / x - r2 * polynomial(ASYMPTOTIC, r2) - shifts};
+
+    return select(nan, CPack(NOT_A_NUMBER), select(infinite, CPack(INF), result));
+}
+
+//! Compute exp(-\p x^2) without the error in rounding \p x^2.
+CPack expMinusSquare(const CPack& x) {
+    // We split x^2 = h^2 + d where h^2 is exact and |d| < 2^(-20) |x|,
+    // so exp(-d) is accurate to three terms of its Taylor series for the
+    // values of x for which exp(-x^2) doesn't underflow.
+    CPack high{highHalf(x)};
+    CPack d{(x - high) * (x + high)};
+    return exp(-(high * high)) * (1.0 - d * (1.0 - 0.5 * d));
+}
+
+//! Compute erfc(\p x).
+CPack erfc(const CPack& x) {
+    // We use a Chebyshev expansion of (x + 2) exp(x^2) erfc(x) in
+    // t = (x - 2) / (x + 2) for x >= 0, which is smooth and bounded on
+    // [-1, 1], and erfc(-x) = 2 - erfc(x).
+    static const double CHEBYSHEV[]{
+        1.1540674772329396,     -0.71087384254099673,   0.13019031765757311,
+        -0.0073422847916732835, -0.0022256894867056475, 0.00032151659830782162,
+        6.5560631483518867e-05, -1.0884883290944725e-05, -3.0309331106814775e-06,
+        2.8595216363669349e-07, 1.6469217630543654e-07, 2.5925700342099843e-09,
+        -8.3094432645758339e-09, -1.2694118833866951e-09, 2.8641643390336925e-10,
+        1.2320840681034894e-10, 4.1221170921090792e-12, -7.1431116577258536e-12,
+        -1.7173951150084577e-12, 1.2333356558258403e-13, 1.4824252936307403e-13,
+        2.5816015991608765e-14, -5.4067861299245127e-15, -2.9509727994536659e-15,
+        -5.6066262743570403e-16};
+    static const std::size_t N{sizeof(CHEBYSHEV) / sizeof(double)};
+
+    CMask nan{x != x};
+    // erfc(x) underflows for x > 27.3.
+    CPack y{select(fabs(x) < 27.5, fabs(x), CPack(27.5))};
+
+    CPack t{(y - 2.0) / (y + 2.0)};
+    CPack b1{0.0};
+    CPack b2{0.0};
+    for (std::size_t i = N - 1; i > 0; --i) {
+        CPack b{2.0 * t * b1 - b2 + CHEBYSHEV[i]};
+        b2 = b1;
+        b1 = b;
+    }
+    CPack result{(t * b1 - b2 + CHEBYSHEV[0]) / (y + 2.0) * expMinusSquare(y)};
+
+    return select(nan, x, select(x < 0.0, 2.0 - result, result));
+}
+
+//! Compute erf(\p x).
+CPack erf(const CPack& x) {
+    // For |x| < 1/2 we use the Taylor series which to 13 terms has relative
+    // error less than 1e-17, otherwise 1 - erfc(|x|).
+    static const double TAYLOR[]{1.0,
+                                 -1.0 / 3.0,
+                                 1.0 / 10.0,
+                                 -1.0 / 42.0,
+                                 1.0 / 216.0,
+                                 -1.0 / 1320.0,
+                                 1.0 / 9360.0,
+                                 -1.0 / 75600.0,
+                                 1.0 / 685440.0,
+                                 -1.0 / 6894720.0,
+                                 1.0 / 76204800.0,
+                                 -1.0 / 918086400.0,
+                                 1.0 / 11975040000.0};
+
+    CMask small{fabs(x) < 0.5};
+    CPack result{0.0};
+    if (any(small)) {
+        result = TWO_OVER_ROOT_PI * x * polynomial(TAYLOR, x * x);
+    }
+    if (any(~small)) {
+        CPack large{1.0 - erfc(fabs(x))};
+        result = select(small, result, select(x < 0.0, -large, large));
+    }
+    return select(x != x, x, result);
+}
+
+//! Evaluate the continued fraction
+//!   b(0) + a(1) / (b(1) + a(2) / (b(2) + ...))
+//! whose terms are supplied by \p terms.
+//!
+//! This uses the fundamental recurrences, so unlike Lentz's method it
+//! needs no division per term, and renormalizes the convergents after
+//! every pair of terms to avoid overflow.
+//!
+//! \param[in] b0 The leading term.
+//! \param[in] terms Fills in a(n) and b(n) given n.
+//! \param[in] active The values to evaluate.
+//! \param[out] failed Set for the values which didn't converge.
+template<typename TERMS>
+CPack continuedFraction(const CPack& b0, TERMS terms, CMask active, CMask& failed) {
+    CPack a0{1.0};
+    CPack a1{b0};
+    CPack b0_{0.0};
+    CPack b1{1.0};
+    CPack result{b0};
+    for (int n = 1; n <= MAX_ITERATIONS && any(active); n += 2) {
+        CPack an{0.0};
+        CPack bn{0.0};
+        terms(n, an, bn);
+        CPack a2{bn * a1 + an * a0};
+        CPack b2{bn * b1 + an * b0_};
+        terms(n + 1, an, bn);
+        a0 = bn * a2 + an * a1;
+        b0_ = bn * b2 + an * b1;
+        a1 = a0;
+        b1 = b0_;
+        a0 = a2;
+        b0_ = b2;
+
+        CPack scale{1.0 / select(b1 == 0.0, CPack(TINY), b1)};
+        a0 = a0 * scale;
+        a1 = a1 * scale;
+        b0_ = b0_ * scale;
+        b1 = 1.0;
+        CPack last{result};
+        result = select(active, a1, result);
+        active = active & (fabs(result - last) > fabs(result) * EPSILON);
+    }
+    failed = failed | active | (result != result);
+    return result;
+}
+
+//! Compute the regularized incomplete gamma function P(\p a, \p x) or
+//! its complement.
+//!
+//! \param[out] failed Set for the values which didn't converge.
+CPack incompleteGamma(CPack a, CPack x, bool complement, CMask& failed) {
+    // We use the series
+    //   P(a, x) = x^a e^(-x) / Gamma(a) Sum_n{ x^n / (a (a+1) ... (a+n)) }
+    // for x < a + 1 and otherwise the continued fraction
+    //   Q(a, x) = x^a e^(-x) / Gamma(a) / (x + 1 - a - 1 (1 - a) / (x + 3 - a - ...)).
+    // Both converge quickly in their regions.
+
+    CMask nan{~(a > 0.0) | ~(x >= 0.0)};
+    CMask infinite{x == INF};
+    a = select(nan, CPack(1.0), a);
+    x = select(nan | infinite, CPack(1.0), x);
+
+    CPack prefix{exp(a * log(x) - x - logGamma(a))};
+
+    CMask series{x < a + 1.0};
+    CPack p{0.0};
+    CPack q{0.0};
+    failed = CMask(false);
+
+    if (any(series)) {
+        CPack ap{a};
+        CPack term{1.0 / a};
+        CPack sum{term};
+        CMask active{series};
+        for (int i = 0; i < MAX_ITERATIONS && any(active); ++i) {
+            // Keep the division off the critical path.
+            ap = ap + 1.0;
+            term = select(active, term * (x / ap), term);
+            sum = select(active, sum + term, sum);
+            active = active & (term >= sum * EPSILON);
+        }
+        failed = failed | active;
+        p = prefix * sum;
+    }
+    if (any(~series)) {
+        CPack b{x + 1.0 - a};
+        CPack fraction{continuedFraction(b,
+                                         [&a, &b](int n, CPack& an, CPack& bn) {
+                                             double n_{static_cast<double>(n)};
+                                             an = -n_ * (n_ - a);
+                                             bn = b + 2.0 * n_;
+                                         },
+                                         ~series, failed)};
+        q = prefix / fraction;
+    }
+
+    CPack result{complement ? select(series, 1.0 - p, q) : select(series, p, 1.0 - q)};
+    result = select(infinite, CPack(complement ? 0.0 : 1.0), result);
+    return select(nan, CPack(NOT_A_NUMBER), result);
+}
+
+//! Compute the regularized incomplete beta function I_{\p x}(\p a, \p b),
+//! where \p y is 1 - \p x, or its complement.
+//!
+//! \param[out] failed Set for the values which didn't converge.
+CPack incompleteBeta(CPack a, CPack b, CPack x, CPack y, bool complement, CMask& failed) {
+    // We use the continued fraction
+    //   I_x(a, b) = x^a y^b / a / B(a, b) / (1 + d(1) / (1 + d(2) / (1 + ...)))
+    // where
+    //   d(2m + 1) = -(a + m) (a + b + m) x / (a + 2m) / (a + 2m + 1)
+    //   d(2m) = m (b - m) x / (a + 2m - 1) / (a + 2m)
+    // This converges quickly for x < (a + 1) / (a + b + 2) and otherwise
+    // we use the symmetry relation I_x(a, b) = 1 - I_y(b, a).
+
+    CMask nan{~(a > 0.0) | ~(b > 0.0) | ~(x >= 0.0) | ~(x <= 1.0) | (y != y)};
+    a = select(nan, CPack(1.0), a);
+    b = select(nan, CPack(1.0), b);
+    x = select(nan, CPack(0.5), x);
+    y = select(nan, CPack(0.5), y);
+
+    CMask swap{x > (a + 1.0) / (a + b + 2.0)};
+    CPack a_{select(swap, b, a)};
+    CPack b_{select(swap, a, b)};
+    CPack x_{select(swap, y, x)};
+    CPack y_{select(swap, x, y)};
+
+    CPack prefix{exp(a_ * log(x_) + b_ * log(y_) - logGamma(a_) -
+                     logGamma(b_) + logGamma(a_ + b_))};
+
+    failed = CMask(false);
+    CPack fraction{continuedFraction(1.0,
+                                     [&a_, &b_, &x_](int n, CPack& an, CPack& bn) {
+                                         double m{static_cast<double>(n / 2)};
+                                         an = (n % 2 == 1)
+                                                  ? -(a_ + m) * (a_ + b_ + m) * x_ /
+                                                        ((a_ + 2.0 * m) * (a_ + (2.0 * m + 1.0)))
+                                                  : m * (b_ - m) * x_ /
+                                                        ((a_ + (2.0 * m - 1.0)) * (a_ + 2.0 * m));
+                                         bn = 1.0;
+                                     },
+                                     CMask(true), failed)};
+
+    CPack result{prefix / (fraction * a_)};
+    result = complement ? select(swap, result, 1.0 - result)
+                        : select(swap, 1.0 - result, result);
+    return select(nan, CPack(NOT_A_NUMBER), result);
+}
+//@}
+
+//! Evaluate \p kernel for the \p n arguments at \p arguments, a pack at
+//! a time, and write the results to \p result.
+//!
+//! \param[in] fallback Evaluates the function at a single index. This is
+//! used for arguments for which \p kernel fails.
+template<std::size_t N, typename KERNEL, typename FALLBACK>
+void evaluate(const double* const (&arguments)[N],
+              std::size_t n,
+              double* result,
+              KERNEL kernel,
+              FALLBACK fallback) {
+    static const std::size_t WIDTH{CPack::WIDTH};
+
+    double values[WIDTH];
+    double failures[WIDTH];
+    double padded[N][WIDTH];
+
+    for (std::size_t i = 0; i < n; i += WIDTH) {
+        std::size_t m{std::min(WIDTH, n - i)};
+
+        CPack x[N];
+        if (m == WIDTH) {
+            for (std::size_t j = 0; j < N; ++j) {
+                x[j] = CPack::load(arguments[j] + i);
+            }
+        } else {
+            // Pad with arguments which are valid for all functions.
+            for (std::size_t j = 0; j < N; ++j) {
+                std::fill_n(padded[j], WIDTH, 0.5);
+                std::copy(arguments[j] + i, arguments[j] + i + m, padded[j]);
+                x[j] = CPack::load(padded[j]);
+            }
+        }
+
+        CMask failed{false};
+        kernel(x, failed).store(values);
+        select(failed, CPack(1.0), CPack(0.0)).store(failures);
+
+        for (std::size_t j = 0; j < m; ++j) {
+            result[i + j] = failures[j] == 0.0 ? values[j] : fallback(i + j);
+        }
+    }
+}
+
+//! A fallback for kernels which always succeed.
+double noFallback(std::size_t) {
+    return NOT_A_NUMBER;
+}
+
+//! Evaluate the boost implementation of \p function catching errors.
+template<typename FUNCTION>
+double safeBoost(FUNCTION function) {
+    try {
+        return function();
+    } catch (const std::exception& e) {
+        LOG_ERROR(<< "Failed to evaluate special function: " << e.what());
+    }
+    return NOT_A_NUMBER;
+}
+}
+
+const char* CSpecialFunctions::instructionSet() {
+    return INSTRUCTION_SET;
+}
+
+std::size_t CSpecialFunctions::width() {
+    return CPack::WIDTH;
+}
+
+void CSpecialFunctions::logGamma(const double* x, std::size_t n, double* result) {
+    const double* const arguments[]{x};
+    evaluate(arguments, n, result,
+             [](const CPack (&x_)[1], CMask&) { return maths::logGamma(x_[0]); },
+             noFallback);
+}
+
+void CSpecialFunctions::digamma(const double* x, std::size_t n, double* result) {
+    const double* const arguments[]{x};
+    evaluate(arguments, n, result,
+             [](const CPack (&x_)[1], CMask&) { return maths::digamma(x_[0]); },
+             noFallback);
+}
+
+void CSpecialFunctions::erf(const double* x, std::size_t n, double* result) {
+    const double* const arguments[]{x};
+    evaluate(arguments, n, result,
+             [](const CPack (&x_)[1], CMask&) { return maths::erf(x_[0]); }, noFallback);
+}
+
+void CSpecialFunctions::erfc(const double* x, std::size_t n, double* result) {
+    const double* const arguments[]{x};
+    evaluate(arguments, n, result,
+             [](const CPack (&x_)[1], CMask&) { return maths::erfc(x_[0]); }, noFallback);
+}
+
+void CSpecialFunctions::incompleteGamma(const double* a,
+                                        const double* x,
+                                        std::size_t n,
+                                        double* result,
+                                        bool complement) {
+    const double* const arguments[]{a, x};
+    evaluate(arguments, n, result,
+             [complement](const CPack (&x_)[2], CMask& failed) {
+                 return maths::incompleteGamma(x_[0], x_[1], complement, failed);
+             },
+             [a, x, complement](std::size_t i) {
+                 return safeBoost([&] {
+                     return complement ? boost::math::gamma_q(a[i], x[i])
+                                       : boost::math::gamma_p(a[i], x[i]);
+                 });
+             });
+}
+
+void CSpecialFunctions::incompleteBeta(const double* a,
+                                       const double* b,
+                                       const double* x,
+                                       std::size_t n,
+                                       double* result,
+                                       bool complement) {
+    const double* const arguments[]{a, b, x};
+    evaluate(arguments, n, result,
+             [complement](const CPack (&x_)[3], CMask& failed) {
+                 return maths::incompleteBeta(x_[0], x_[1], x_[2], 1.0 - x_[2],
+                                              complement, failed);
+             },
+             [a, b, x, complement](std::size_t i) {
+                 return safeBoost([&] {
+                     return complement ? boost::math::ibetac(a[i], b[i], x[i])
+                                       : boost::math::ibeta(a[i], b[i], x[i]);
+                 });
+             });
+}
+
+void CSpecialFunctions::normalCdf(const double* mean,
+                                  const double* sd,
+                                  const double* x,
+                                  std::size_t n,
+                                  double* result,
+                                  bool complement) {
+    const double* const arguments[]{mean, sd, x};
+    evaluate(arguments, n, result,
+             [complement](const CPack (&x_)[3], CMask&) {
+                 CPack z{(x_[2] - x_[0]) / (x_[1] * ROOT_TWO)};
+                 CPack result_{0.5 * maths::erfc(complement ? z : -z)};
+                 return select(x_[1] > 0.0, result_, CPack(NOT_A_NUMBER));
+             },
+             noFallback);
+}
+
+void CSpecialFunctions::studentsTCdf(const double* dof,
+                                     const double* x,
+                                     std::size_t n,
+                                     double* result,
+                                     bool complement) {
+    // The c.d.f. of the student's t distribution with v degrees of freedom
+    // is 1/2 I_{v / (v + t^2)}(v / 2, 1 / 2) for t < 0 and symmetric.
+    const double* const arguments[]{dof, x};
+    evaluate(arguments, n, result,
+             [complement](const CPack (&x_)[2], CMask& failed) {
+                 CPack v{x_[0]};
+                 CPack t2{x_[1] * x_[1]};
+                 CPack y{select(t2 == INF, CPack(1.0), t2 / (v + t2))};
+                 CPack tail{0.5 * maths::incompleteBeta(0.5 * v, 0.5, v / (v + t2),
+                                                        y, false, failed)};
+                 CMask lower{complement ? x_[1] > 0.0 : x_[1] < 0.0};
+                 return select(lower, tail, 1.0 - tail);
+             },
+             [dof, x, complement](std::size_t i) {
+                 return safeBoost([&] {
+                     boost::math::students_t_distribution<> students(dof[i]);
+                     return complement ? boost::math::cdf(boost::math::complement(students, x[i]))
+                                       : boost::math::cdf(students, x[i]);
+                 });
+             });
+}
+
+void CSpecialFunctions::gammaCdf(const double* shape,
+                                 const double* scale,
+                                 const double* x,
+                                 std::size_t n,
+                                 double* result,
+                                 bool complement) {
+    const double* const arguments[]{shape, scale, x};
+    evaluate(arguments, n, result,
+             [complement](const CPack (&x_)[3], CMask& failed) {
+                 CMask below{x_[2] <= 0.0};
+                 CPack z{select(below, CPack(0.0), x_[2] / x_[1])};
+                 CPack result_{maths::incompleteGamma(x_[0], z, complement, failed)};
+                 result_ = select(below, CPack(complement ? 1.0 : 0.0), result_);
+                 return select(x_[1] > 0.0, result_, CPack(NOT_A_NUMBER));
+             },
+             [shape, scale, x, complement](std::size_t i) {
+                 return safeBoost([&] {
+                     return complement ? boost::math::gamma_q(shape[i], x[i] / scale[i])
+                                       : boost::math::gamma_p(shape[i], x[i] / scale[i]);
+                 });
+             });
+}
+}
+}
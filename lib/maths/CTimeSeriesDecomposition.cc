@@ -193,6 +193,14 @@ double CTimeSeriesDecomposition::decayRate() const {
     return m_Components.decayRate();
 }
 
+void CTimeSeriesDecomposition::periodicityTestScheduler(CPeriodicityTestScheduler* scheduler) {
+    m_PeriodicityTest.scheduler(scheduler);
+}
+
+void CTimeSeriesDecomposition::deflatePeriodicityTestWindows(bool deflate) {
+    m_PeriodicityTest.deflateWindows(deflate);
+}
+
 bool CTimeSeriesDecomposition::initialized() const {
     return m_Components.initialized();
 }
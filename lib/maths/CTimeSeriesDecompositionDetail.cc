@@ -462,13 +462,17 @@ CTimeSeriesDecompositionDetail::CPeriodicityTest::CPeriodicityTest(double decayR
           PT_STATES,
           PT_TRANSITION_FUNCTION,
           bucketLength > LONG_BUCKET_LENGTHS.back() ? PT_NOT_TESTING : PT_INITIAL)},
-      m_DecayRate{decayRate}, m_BucketLength{bucketLength} {
+      m_DecayRate{decayRate}, m_BucketLength{bucketLength},
+      m_DeflateWindows{false}, m_Scheduler{nullptr} {
 }
 
 CTimeSeriesDecompositionDetail::CPeriodicityTest::CPeriodicityTest(const CPeriodicityTest& other)
-    : m_Machine{other.m_Machine}, m_DecayRate{other.m_DecayRate}, m_BucketLength{
-                                                                      other.m_BucketLength} {
-    // Note that m_Windows is an array.
+    : m_Machine{other.m_Machine}, m_DecayRate{other.m_DecayRate},
+      m_BucketLength{other.m_BucketLength}, m_DeflateWindows{other.m_DeflateWindows},
+      m_Scheduler{other.m_Scheduler} {
+    // Note that m_Windows is an array. Scheduled tests aren't copied:
+    // their results are only forwarded by the object which scheduled
+    // them.
     for (std::size_t i = 0u; i < other.m_Windows.size(); ++i) {
         if (other.m_Windows[i]) {
             m_Windows[i] = std::make_shared<CExpandingWindow>(*other.m_Windows[i]);
@@ -522,6 +526,10 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::swap(CPeriodicityTest& ot
     std::swap(m_BucketLength, other.m_BucketLength);
     m_Windows[E_Short].swap(other.m_Windows[E_Short]);
     m_Windows[E_Long].swap(other.m_Windows[E_Long]);
+    std::swap(m_DeflateWindows, other.m_DeflateWindows);
+    std::swap(m_Scheduler, other.m_Scheduler);
+    m_ScheduledTests.swap(other.m_ScheduledTests);
+    m_ScheduledWindows.swap(other.m_ScheduledWindows);
 }
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::handle(const SAddValue& message) {
@@ -534,8 +542,15 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::handle(const SAddValue& m
 
     switch (m_Machine.state()) {
     case PT_TEST:
-        for (auto& window : m_Windows) {
+        for (std::size_t i = 0u; i < m_Windows.size(); ++i) {
+            const TExpandingWindowPtr& window{m_Windows[i]};
             if (window) {
+                // Restarting discards the values which a scheduled test's
+                // result needs, so only then do we keep a copy of them.
+                if (m_ScheduledTests[i] != nullptr && m_ScheduledWindows[i] == nullptr &&
+                    window->needToRestart(time)) {
+                    m_ScheduledWindows[i] = std::make_shared<CExpandingWindow>(*window);
+                }
                 window->add(time, value, weight);
             }
         }
@@ -567,11 +582,21 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::test(const SAddValue& mes
 
     switch (m_Machine.state()) {
     case PT_TEST:
-        for (const auto& window : m_Windows) {
+        this->forwardScheduledTestResults(message);
+        for (std::size_t i = 0u; i < m_Windows.size(); ++i) {
+            const TExpandingWindowPtr& window{m_Windows[i]};
             if (this->shouldTest(window, time)) {
                 TFloatMeanAccumulatorVec values(window->valuesMinusPrediction(predictor));
                 core_t::TTime start{CIntegerTools::floor(window->startTime(), m_BucketLength)};
                 core_t::TTime bucketLength{window->bucketLength()};
+                if (m_Scheduler != nullptr) {
+                    // This supersedes any test of the window which is still
+                    // pending, which the scheduler then discards.
+                    m_ScheduledTests[i] = m_Scheduler->schedule(
+                        config, start, bucketLength, std::move(values));
+                    m_ScheduledWindows[i].reset();
+                    continue;
+                }
                 CPeriodicityHypothesisTestsResult result{
                     testForPeriods(config, start, bucketLength, values)};
                 if (result.periodic()) {
@@ -591,6 +616,22 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::test(const SAddValue& mes
     }
 }
 
+void CTimeSeriesDecompositionDetail::CPeriodicityTest::scheduler(CPeriodicityTestScheduler* scheduler) {
+    if (scheduler != m_Scheduler) {
+        this->discardScheduledTests();
+        m_Scheduler = scheduler;
+    }
+}
+
+void CTimeSeriesDecompositionDetail::CPeriodicityTest::deflateWindows(bool deflate) {
+    m_DeflateWindows = deflate;
+    for (auto& window : m_Windows) {
+        if (window) {
+            window->deflate(deflate);
+        }
+    }
+}
+
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::propagateForwards(core_t::TTime start,
                                                                          core_t::TTime end) {
     stepwisePropagateForwards(DAY, start, end, m_Windows[E_Short]);
@@ -608,10 +649,12 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::debugMemoryUsage(
     core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("CPeriodicityTest");
     core::CMemoryDebug::dynamicSize("m_Windows", m_Windows, mem);
+    core::CMemoryDebug::dynamicSize("m_ScheduledWindows", m_ScheduledWindows, mem);
 }
 
 std::size_t CTimeSeriesDecompositionDetail::CPeriodicityTest::memoryUsage() const {
-    std::size_t usage{core::CMemory::dynamicSize(m_Windows)};
+    std::size_t usage{core::CMemory::dynamicSize(m_Windows) +
+                      core::CMemory::dynamicSize(m_ScheduledWindows)};
     if (m_Machine.state() == PT_INITIAL) {
         usage += this->extraMemoryOnInitialization();
     }
@@ -642,6 +685,7 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
                   << PT_STATES[state]);
 
         auto initialize = [this](core_t::TTime time_) {
+            this->discardScheduledTests();
             for (auto i : {E_Short, E_Long}) {
                 m_Windows[i].reset(this->newWindow(i));
                 if (m_Windows[i]) {
@@ -676,6 +720,7 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
         case PT_NOT_TESTING:
             m_Windows[0].reset();
             m_Windows[1].reset();
+            this->discardScheduledTests();
             break;
         default:
             LOG_ERROR(<< "Test in a bad state: " << state);
@@ -685,6 +730,40 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
     }
 }
 
+void CTimeSeriesDecompositionDetail::CPeriodicityTest::forwardScheduledTestResults(
+    const SAddValue& message) {
+    core_t::TTime time{message.s_Time};
+    core_t::TTime lastTime{message.s_LastTime};
+    const TPredictor& predictor{message.s_Predictor};
+
+    for (std::size_t i = 0u; i < m_ScheduledTests.size(); ++i) {
+        if (m_ScheduledTests[i] != nullptr && m_ScheduledTests[i]->complete()) {
+            TTestPtr test{std::move(m_ScheduledTests[i])};
+            TExpandingWindowPtr window{std::move(m_ScheduledWindows[i])};
+            m_ScheduledTests[i].reset();
+            m_ScheduledWindows[i].reset();
+            if (window == nullptr) {
+                // The live window has only been extended, and possibly
+                // compressed, since the test was scheduled, so it still
+                // contains the values tested.
+                window = m_Windows[i];
+            }
+            const CPeriodicityHypothesisTestsResult& result{test->result()};
+            if (result.periodic() && window != nullptr) {
+                this->mediator()->forward(
+                    SDetectedSeasonal{time, lastTime, result, *window, predictor});
+            }
+        }
+    }
+}
+
+void CTimeSeriesDecompositionDetail::CPeriodicityTest::discardScheduledTests() {
+    for (std::size_t i = 0u; i < m_ScheduledTests.size(); ++i) {
+        m_ScheduledTests[i].reset();
+        m_ScheduledWindows[i].reset();
+    }
+}
+
 bool CTimeSeriesDecompositionDetail::CPeriodicityTest::shouldTest(const TExpandingWindowPtr& window,
                                                                   core_t::TTime time) const {
 
@@ -717,7 +796,10 @@ CExpandingWindow* CTimeSeriesDecompositionDetail::CPeriodicityTest::newWindow(ET
                              bucketLengths.begin()};
             std::size_t b{bucketLengths.size()};
             TTimeCRng bucketLengths_(bucketLengths, a, b);
-            return new CExpandingWindow(m_BucketLength, bucketLengths_, 336, m_DecayRate);
+            auto* window = new CExpandingWindow(m_BucketLength, bucketLengths_,
+                                                336, m_DecayRate);
+            window->deflate(m_DeflateWindows);
+            return window;
         }
         return static_cast<CExpandingWindow*>(nullptr);
     };
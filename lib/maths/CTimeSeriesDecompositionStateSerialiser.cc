@@ -43,8 +43,12 @@ operator()(const STimeSeriesDecompositionRestoreParams& params,
     do {
         const std::string& name = traverser.name();
         if (name == TIME_SERIES_DECOMPOSITION_TAG) {
-            result.reset(new CTimeSeriesDecomposition(params.s_DecayRate, params.s_MinimumBucketLength,
-                                                      params.s_ComponentSize, traverser));
+            auto decomposition = std::make_unique<CTimeSeriesDecomposition>(
+                params.s_DecayRate, params.s_MinimumBucketLength,
+                params.s_ComponentSize, traverser);
+            decomposition->periodicityTestScheduler(params.s_PeriodicityTestScheduler);
+            decomposition->deflatePeriodicityTestWindows(params.s_DeflatePeriodicityTestWindows);
+            result = std::move(decomposition);
             ++numResults;
         } else if (name == TIME_SERIES_DECOMPOSITION_STUB_TAG) {
             result.reset(new CTimeSeriesDecompositionStub());
@@ -16,6 +16,7 @@
 #include <maths/CModelDetail.h>
 #include <maths/CMultivariateNormalConjugate.h>
 #include <maths/CMultivariatePrior.h>
+#include <maths/COneOfNPrior.h>
 #include <maths/COrderings.h>
 #include <maths/CPrior.h>
 #include <maths/CPriorStateSerialiser.h>
@@ -55,6 +56,15 @@ using TMultivariatePriorCPtrSizePr1Vec = CTimeSeriesCorrelations::TMultivariateP
 
 const std::size_t SLIDING_WINDOW_SIZE{12};
 
+//! The number of samples the residual model must have received before
+//! we try to compact it.
+const double MINIMUM_SAMPLES_TO_COMPACT_RESIDUAL_MODEL{50.0};
+
+//! The weight below which a residual model is removed from the prior.
+//! This matches the relative error to which COneOfNPrior calculates
+//! probabilities so such models have a negligible effect on results.
+const double MAXIMUM_COMPACTED_RESIDUAL_MODEL_WEIGHT{1e-3};
+
 //! Computes the Winsorisation weight for \p value.
 double computeWinsorisationWeight(const CPrior& prior, double derate, double scale, double value) {
     static const double WINSORISED_FRACTION = 1e-4;
@@ -163,6 +173,7 @@ const std::string TREND_6_3_TAG{"f"};
 const std::string PRIOR_6_3_TAG{"g"};
 const std::string ANOMALY_MODEL_6_3_TAG{"h"};
 const std::string SLIDING_WINDOW_6_3_TAG{"i"};
+const std::string IS_RESIDUAL_MODEL_COMPACT_6_3_TAG{"j"};
 // Version < 6.3
 const std::string ID_OLD_TAG{"a"};
 const std::string CONTROLLER_OLD_TAG{"b"};
@@ -540,7 +551,7 @@ CUnivariateTimeSeriesModel::CUnivariateTimeSeriesModel(const CModelParams& param
                                                        const TDecayRateController2Ary* controllers,
                                                        bool modelAnomalies)
     : CModel(params), m_Id(id), m_IsNonNegative(false), m_IsForecastable(true),
-      m_Trend(trend.clone()), m_Prior(prior.clone()),
+      m_IsResidualModelCompact(false), m_Trend(trend.clone()), m_Prior(prior.clone()),
       m_AnomalyModel(modelAnomalies ? std::make_shared<CTimeSeriesAnomalyModel>(
                                           params.bucketLength(),
                                           params.decayRate())
@@ -553,7 +564,7 @@ CUnivariateTimeSeriesModel::CUnivariateTimeSeriesModel(const CModelParams& param
 
 CUnivariateTimeSeriesModel::CUnivariateTimeSeriesModel(const SModelRestoreParams& params,
                                                        core::CStateRestoreTraverser& traverser)
-    : CModel(params.s_Params), m_IsForecastable(false),
+    : CModel(params.s_Params), m_IsForecastable(false), m_IsResidualModelCompact(false),
       m_SlidingWindow(SLIDING_WINDOW_SIZE), m_Correlations(nullptr) {
     traverser.traverseSubLevel(boost::bind(&CUnivariateTimeSeriesModel::acceptRestoreTraverser,
                                            this, boost::cref(params), _1));
@@ -680,6 +691,7 @@ CUnivariateTimeSeriesModel::addSamples(const CModelAddSamplesParams& params,
     if (m_AnomalyModel) {
         m_AnomalyModel->propagateForwardsByTime(params.propagationInterval());
     }
+    this->compactResidualModel();
 
     double multiplier{1.0};
     if (m_Controllers) {
@@ -1181,6 +1193,7 @@ bool CUnivariateTimeSeriesModel::acceptRestoreTraverser(const SModelRestoreParam
             RESTORE(SLIDING_WINDOW_6_3_TAG,
                     core::CPersistUtils::restore(SLIDING_WINDOW_6_3_TAG,
                                                  m_SlidingWindow, traverser))
+            RESTORE_BOOL(IS_RESIDUAL_MODEL_COMPACT_6_3_TAG, m_IsResidualModelCompact)
         }
     } else {
         // There is no version string this is historic state.
@@ -1237,12 +1250,18 @@ void CUnivariateTimeSeriesModel::acceptPersistInserter(core::CStatePersistInsert
                                          m_AnomalyModel.get(), _1));
     }
     core::CPersistUtils::persist(SLIDING_WINDOW_6_3_TAG, m_SlidingWindow, inserter);
+    inserter.insertValue(IS_RESIDUAL_MODEL_COMPACT_6_3_TAG,
+                         static_cast<int>(m_IsResidualModelCompact));
 }
 
 maths_t::EDataType CUnivariateTimeSeriesModel::dataType() const {
     return m_Prior->dataType();
 }
 
+bool CUnivariateTimeSeriesModel::isResidualModelCompact() const {
+    return m_IsResidualModelCompact;
+}
+
 const CUnivariateTimeSeriesModel::TTimeDoublePrCBuf&
 CUnivariateTimeSeriesModel::slidingWindow() const {
     return m_SlidingWindow;
@@ -1259,7 +1278,8 @@ const CPrior& CUnivariateTimeSeriesModel::prior() const {
 CUnivariateTimeSeriesModel::CUnivariateTimeSeriesModel(const CUnivariateTimeSeriesModel& other,
                                                        std::size_t id)
     : CModel(other.params()), m_Id(id), m_IsNonNegative(other.m_IsNonNegative),
-      m_IsForecastable(other.m_IsForecastable), m_Rng(other.m_Rng),
+      m_IsForecastable(other.m_IsForecastable),
+      m_IsResidualModelCompact(other.m_IsResidualModelCompact), m_Rng(other.m_Rng),
       m_Trend(other.m_Trend->clone()), m_Prior(other.m_Prior->clone()),
       m_AnomalyModel(other.m_AnomalyModel
                          ? std::make_shared<CTimeSeriesAnomalyModel>(*other.m_AnomalyModel)
@@ -1306,6 +1326,7 @@ CUnivariateTimeSeriesModel::updateTrend(const TTimeDouble2VecSizeTrVec& samples,
         }
     }
     if (result == E_Reset) {
+        this->promoteResidualModel();
         m_Prior->setToNonInformative(0.0, m_Prior->decayRate());
         TDoubleWeightsAry1Vec weight{maths_t::countWeight(
             slidingWindowCountWeight(this->params().learnRate()))};
@@ -1347,6 +1368,40 @@ void CUnivariateTimeSeriesModel::appendPredictionErrors(double interval,
     }
 }
 
+void CUnivariateTimeSeriesModel::compactResidualModel() {
+    if (this->params().residualModelPrototype() == nullptr || m_Trend->initialized() ||
+        m_Prior->numberSamples() < MINIMUM_SAMPLES_TO_COMPACT_RESIDUAL_MODEL) {
+        return;
+    }
+
+    COneOfNPrior* prior{dynamic_cast<COneOfNPrior*>(m_Prior.get())};
+    if (prior == nullptr) {
+        return;
+    }
+
+    // The weights are normalized so at least one model is always kept.
+    // Models which don't yet participate in model selection, such as a
+    // multimodal prior with one mode, are kept since their weight says
+    // nothing about how well they will fit the data.
+    if (prior->removeModelsWithWeightLessThan(MAXIMUM_COMPACTED_RESIDUAL_MODEL_WEIGHT)) {
+        LOG_TRACE(<< "Compacted residual model " << m_Id << " to "
+                  << prior->models().size() << " models");
+        m_IsResidualModelCompact = true;
+    }
+}
+
+void CUnivariateTimeSeriesModel::promoteResidualModel() {
+    const CModelParams::TPriorCPtr& prototype{this->params().residualModelPrototype()};
+    if (m_IsResidualModelCompact && prototype != nullptr) {
+        LOG_TRACE(<< "Promoting residual model " << m_Id);
+        TPriorPtr prior{prototype->clone()};
+        prior->dataType(m_Prior->dataType());
+        prior->decayRate(m_Prior->decayRate());
+        m_Prior = std::move(prior);
+        m_IsResidualModelCompact = false;
+    }
+}
+
 bool CUnivariateTimeSeriesModel::correlationModels(TSize1Vec& correlated,
                                                    TSize2Vec1Vec& variables,
                                                    TMultivariatePriorCPtrSizePr1Vec& correlationDistributionModels,
@@ -215,24 +215,6 @@ const double POS_INF = boost::numeric::bounds<double>::highest();
 
 //////// SMinusLogCdf Implementation ////////
 
-namespace {
-
-//! Computes -log(\p cdf) enforces limits and avoids underflow.
-inline double safeMinusLogCdf(double cdf) {
-    if (cdf == 0.0) {
-        // log(0.0) == -HUGE_VALUE, which is too big for our purposes
-        // and causes problems on Windows. In fact, we want to avoid
-        // underflow since this will pollute the floating point
-        // environment and *may* cause problems for some library
-        // function implementations (see fe*exceptflags for more details).
-        // The log of the minimum double should be small enough for
-        // our purposes.
-        return -core::constants::LOG_MIN_DOUBLE;
-    }
-    return std::max(-std::log(cdf), 0.0);
-}
-}
-
 const double CTools::IMPROPER_CDF(0.5);
 
 double CTools::SMinusLogCdf::operator()(const SImproperDistribution&, double) const {
@@ -1706,6 +1688,20 @@ double CTools::safeCdfComplement(const chi_squared& chi2, double x) {
     return continuousSafeCdfComplement(allowOverflow(chi2), x);
 }
 
+double CTools::safeMinusLogCdf(double cdf) {
+    if (cdf == 0.0) {
+        // log(0.0) == -HUGE_VALUE, which is too big for our purposes
+        // and causes problems on Windows. In fact, we want to avoid
+        // underflow since this will pollute the floating point
+        // environment and *may* cause problems for some library
+        // function implementations (see fe*exceptflags for more details).
+        // The log of the minimum double should be small enough for
+        // our purposes.
+        return -core::constants::LOG_MIN_DOUBLE;
+    }
+    return std::max(-std::log(cdf), 0.0);
+}
+
 //////// deviation Implementation ////////
 
 namespace {
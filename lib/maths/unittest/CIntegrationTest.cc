@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <functional>
 #include <numeric>
 
@@ -242,6 +243,89 @@ private:
     double m_Mean;
     double m_Std;
 };
+
+class CLogNormal {
+public:
+    CLogNormal(double mean, double std) : m_Mean(mean), m_Std(std) {}
+
+    bool operator()(double x, double& result) const {
+        result = -0.5 * (x - m_Mean) * (x - m_Mean) / m_Std / m_Std;
+        return true;
+    }
+
+private:
+    double m_Mean;
+    double m_Std;
+};
+
+//! Adapts a function for the batched integration interface.
+template<typename F>
+class CBatch {
+public:
+    explicit CBatch(const F& f) : m_F(f) {}
+
+    template<typename POINT>
+    bool operator()(const POINT* x, std::size_t n, double* result) const {
+        for (std::size_t i = 0u; i < n; ++i) {
+            if (!m_F(x[i], result[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const F& m_F;
+};
+
+template<typename F>
+CBatch<F> batch(const F& f) {
+    return CBatch<F>(f);
+}
+
+template<CIntegration::EOrder ORDER>
+void testBatchOrder(test::CRandomNumbers& rng) {
+    // Polynomials of order 2 * ORDER - 1 are integrated exactly.
+
+    static const unsigned int DEGREE = 2 * ORDER - 1;
+
+    using TPolynomial = CPolynomialFunction<DEGREE>;
+
+    const double* weights = CIntegration::CGaussLegendreNodes<ORDER>::WEIGHTS;
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, std::accumulate(weights, weights + ORDER, 0.0), 1e-14);
+
+    for (std::size_t t = 0u; t < 10; ++t) {
+        TDoubleVec coefficients;
+        rng.generateUniformSamples(-5.0, 5.0, DEGREE + 1, coefficients);
+        double coefficients_[DEGREE + 1];
+        std::copy(coefficients.begin(), coefficients.end(), coefficients_);
+        TPolynomial f(coefficients_);
+
+        TDoubleVec limits;
+        rng.generateUniformSamples(-3.0, 3.0, 2, limits);
+        std::sort(limits.begin(), limits.end());
+        double expected = integrate(f, limits[0], limits[1]);
+
+        double actual;
+        CPPUNIT_ASSERT(CIntegration::gaussLegendreBatch<ORDER>(batch(f), limits[0],
+                                                               limits[1], actual));
+        double scalar;
+        CPPUNIT_ASSERT(CIntegration::gaussLegendre<ORDER>(f, limits[0], limits[1], scalar));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-6 * std::max(std::fabs(expected), 1.0));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(scalar, actual, 1e-12 * std::max(std::fabs(scalar), 1.0));
+
+        CIntegration::TDoubleDoublePrVec intervals{
+            {limits[0], 0.5 * (limits[0] + limits[1])},
+            {0.5 * (limits[0] + limits[1]), limits[1]},
+            {-1.0, 1.0}};
+        TDoubleVec results;
+        CPPUNIT_ASSERT(CIntegration::gaussLegendreBatch<ORDER>(batch(f), intervals, results));
+        CPPUNIT_ASSERT_EQUAL(intervals.size(), results.size());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, results[0] + results[1],
+                                     1e-6 * std::max(std::fabs(expected), 1.0));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(integrate(f, -1.0, 1.0), results[2], 1e-6);
+    }
+}
 }
 
 void CIntegrationTest::testAllSingleVariate() {
@@ -1248,6 +1332,90 @@ void CIntegrationTest::testMultivariateSmooth() {
     }
 }
 
+void CIntegrationTest::testBatch() {
+    // Test that the batched quadratures match the scalar quadratures.
+
+    test::CRandomNumbers rng;
+
+    LOG_DEBUG(<< "+--------------------------+");
+    LOG_DEBUG(<< "|  Batch: polynomials      |");
+    LOG_DEBUG(<< "+--------------------------+");
+
+    testBatchOrder<CIntegration::OrderOne>(rng);
+    testBatchOrder<CIntegration::OrderTwo>(rng);
+    testBatchOrder<CIntegration::OrderThree>(rng);
+    testBatchOrder<CIntegration::OrderFour>(rng);
+    testBatchOrder<CIntegration::OrderFive>(rng);
+    testBatchOrder<CIntegration::OrderSix>(rng);
+    testBatchOrder<CIntegration::OrderSeven>(rng);
+    testBatchOrder<CIntegration::OrderEight>(rng);
+    testBatchOrder<CIntegration::OrderNine>(rng);
+    testBatchOrder<CIntegration::OrderTen>(rng);
+
+    LOG_DEBUG(<< "+--------------------------+");
+    LOG_DEBUG(<< "|  Batch: log quadrature   |");
+    LOG_DEBUG(<< "+--------------------------+");
+
+    {
+        double means[]{-1000.0, 0.0, 5.0};
+        for (std::size_t i = 0u; i < boost::size(means); ++i) {
+            CLogNormal f(means[i], 2.0);
+            double expected;
+            double actual;
+            CPPUNIT_ASSERT(CIntegration::logGaussLegendre<CIntegration::OrderFive>(
+                f, 0.0, 3.0, expected));
+            CPPUNIT_ASSERT(CIntegration::logGaussLegendreBatch<CIntegration::OrderFive>(
+                batch(f), 3.0, 0.0, actual));
+            LOG_DEBUG(<< "expected = " << expected << ", actual = " << actual);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-12 * std::fabs(expected));
+        }
+    }
+
+    LOG_DEBUG(<< "+--------------------------+");
+    LOG_DEBUG(<< "|  Batch: sparse grid      |");
+    LOG_DEBUG(<< "+--------------------------+");
+
+    {
+        static const std::size_t DIMENSION = 3u;
+
+        using TVector = CVectorNx1<double, DIMENSION>;
+
+        CMultivariatePolynomialFunction<DIMENSION> polynomial;
+        double p1[]{1.0, 2.0, 0.0};
+        double p2[]{0.0, 1.0, 3.0};
+        double p3[]{0.0, 0.0, 0.0};
+        polynomial.add(2.0, p1);
+        polynomial.add(-1.5, p2);
+        polynomial.add(4.0, p3);
+        polynomial.finalize();
+
+        TDoubleVec a{-1.0, 0.5, -2.0};
+        TDoubleVec b{2.0, 1.5, 1.0};
+
+        auto function = [&polynomial](const double* x, std::size_t n, double* result) {
+            for (std::size_t i = 0u; i < n; ++i, x += DIMENSION) {
+                polynomial(TVector(x, x + DIMENSION), result[i]);
+            }
+            return true;
+        };
+
+        double expected = integrate(polynomial, a, b);
+        double scalar;
+        double actual;
+        CPPUNIT_ASSERT((CIntegration::sparseGaussLegendre<CIntegration::OrderFour, CIntegration::ThreeDimensions>(
+            polynomial, a, b, scalar)));
+        CPPUNIT_ASSERT((CIntegration::sparseGaussLegendreBatch<CIntegration::OrderFour, CIntegration::ThreeDimensions>(
+            function, a, b, actual)));
+        LOG_DEBUG(<< "expected = " << expected << ", actual = " << actual);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-10 * std::fabs(expected));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(scalar, actual, 1e-12 * std::fabs(scalar));
+
+        TDoubleVec bad{1.0};
+        CPPUNIT_ASSERT((CIntegration::sparseGaussLegendreBatch<CIntegration::OrderFour, CIntegration::ThreeDimensions>(
+                            function, bad, b, actual)) == false);
+    }
+}
+
 CppUnit::Test* CIntegrationTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CIntegrationTest");
 
@@ -1259,6 +1427,8 @@ CppUnit::Test* CIntegrationTest::suite() {
         "CIntegrationTest::testSparseGrid", &CIntegrationTest::testSparseGrid));
     suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
         "CIntegrationTest::testMultivariateSmooth", &CIntegrationTest::testMultivariateSmooth));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
+        "CIntegrationTest::testBatch", &CIntegrationTest::testBatch));
 
     return suiteOfTests;
 }
@@ -15,6 +15,7 @@ public:
     void testAdaptive();
     void testSparseGrid();
     void testMultivariateSmooth();
+    void testBatch();
 
     static CppUnit::Test* suite();
 };
@@ -6,6 +6,8 @@
 
 #include "CMultimodalPriorTest.h"
 
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
 #include <core/CLogger.h>
 #include <core/CRapidXmlParser.h>
 #include <core/CRapidXmlStatePersistInserter.h>
@@ -27,12 +29,14 @@
 
 #include "TestUtils.h"
 
+#include <boost/bind.hpp>
 #include <boost/math/distributions/gamma.hpp>
 #include <boost/math/distributions/lognormal.hpp>
 #include <boost/math/distributions/normal.hpp>
 #include <boost/range.hpp>
 
 #include <memory>
+#include <sstream>
 #include <vector>
 
 using namespace ml;
@@ -1820,6 +1824,34 @@ void CMultimodalPriorTest::testPersist() {
         inserter.toXml(newXml);
     }
     CPPUNIT_ASSERT_EQUAL(origXml, newXml);
+
+    // The binary representation should restore to the same filter
+    std::ostringstream origBinary;
+    {
+        core::CBinaryStatePersistInserter inserter(origBinary);
+        inserter.insertLevel("root", boost::bind(&maths::CMultimodalPrior::acceptPersistInserter,
+                                                 &origFilter, _1));
+    }
+    LOG_DEBUG(<< "XML size = " << origXml.size()
+              << ", binary size = " << origBinary.str().size());
+    CPPUNIT_ASSERT(origBinary.str().size() < origXml.size());
+
+    std::istringstream binaryStrm(origBinary.str());
+    core::CBinaryStateRestoreTraverser binaryTraverser(binaryStrm);
+    maths::CMultimodalPrior binaryRestoredFilter(params, binaryTraverser);
+    CPPUNIT_ASSERT(!binaryTraverser.haveBadState());
+
+    LOG_DEBUG(<< "orig checksum = " << checksum
+              << " binary restored checksum = " << binaryRestoredFilter.checksum());
+    CPPUNIT_ASSERT_EQUAL(checksum, binaryRestoredFilter.checksum());
+
+    std::string binaryXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        binaryRestoredFilter.acceptPersistInserter(inserter);
+        inserter.toXml(binaryXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(origXml, binaryXml);
 }
 
 CppUnit::Test* CMultimodalPriorTest::suite() {
@@ -0,0 +1,267 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CPeriodicityTestSchedulerTest.h"
+
+#include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
+#include <core/Constants.h>
+#include <core/CoreTypes.h>
+
+#include <maths/CPeriodicityHypothesisTests.h>
+#include <maths/CPeriodicityTestScheduler.h>
+#include <maths/CTimeSeriesDecomposition.h>
+
+#include <test/CRandomNumbers.h>
+
+#include <boost/math/constants/constants.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace ml;
+
+namespace {
+using TDoubleVec = std::vector<double>;
+using TSizeVec = std::vector<std::size_t>;
+using TFloatMeanAccumulatorVec = maths::CPeriodicityTestScheduler::TFloatMeanAccumulatorVec;
+using TFloatMeanAccumulatorVecVec = std::vector<TFloatMeanAccumulatorVec>;
+using TTestPtr = maths::CPeriodicityTestScheduler::TTestPtr;
+using TTestPtrVec = std::vector<TTestPtr>;
+
+const core_t::TTime HALF_HOUR{core::constants::HOUR / 2};
+const core_t::TTime DAY{core::constants::DAY};
+const core_t::TTime WEEK{core::constants::WEEK};
+
+//! Generate \p n windows of a week of half hour values, every other
+//! one of which has a daily periodic component.
+TFloatMeanAccumulatorVecVec generateWindows(test::CRandomNumbers& rng, std::size_t n) {
+    TFloatMeanAccumulatorVecVec result(n);
+    for (std::size_t i = 0u; i < n; ++i) {
+        double amplitude{i % 2 == 0 ? 10.0 : 0.0};
+        TDoubleVec noise;
+        rng.generateNormalSamples(0.0, 1.0, WEEK / HALF_HOUR, noise);
+        for (core_t::TTime time = 0; time < WEEK; time += HALF_HOUR) {
+            double value{amplitude * std::sin(boost::math::double_constants::two_pi *
+                                              static_cast<double>(time) /
+                                              static_cast<double>(DAY)) +
+                         noise[time / HALF_HOUR]};
+            result[i].emplace_back();
+            result[i].back().add(value);
+        }
+    }
+    return result;
+}
+}
+
+void CPeriodicityTestSchedulerTest::testSpread() {
+    // Test that tests are run over the spread and that the results are
+    // the same as running the tests directly.
+
+    test::CRandomNumbers rng;
+
+    TFloatMeanAccumulatorVecVec windows(generateWindows(rng, 30));
+
+    maths::CPeriodicityHypothesisTestsConfig config;
+    maths::CPeriodicityTestScheduler scheduler{3};
+
+    TTestPtrVec tests;
+    for (const auto& window : windows) {
+        tests.push_back(scheduler.schedule(config, 0, HALF_HOUR, window));
+    }
+    CPPUNIT_ASSERT_EQUAL(windows.size(), scheduler.numberPending());
+    for (const auto& test : tests) {
+        CPPUNIT_ASSERT(test->complete() == false);
+    }
+
+    std::size_t complete{0};
+    for (std::size_t run = 0u; run < 3; ++run) {
+        scheduler.runTests();
+        std::size_t lastComplete{complete};
+        complete = 0;
+        for (const auto& test : tests) {
+            complete += test->complete() ? 1 : 0;
+        }
+        LOG_DEBUG(<< "run " << run << ": complete = " << complete);
+        CPPUNIT_ASSERT(complete > lastComplete);
+        CPPUNIT_ASSERT_EQUAL(complete, scheduler.timings().s_NumberTests);
+        CPPUNIT_ASSERT_EQUAL(complete - lastComplete, scheduler.timings().s_LastNumberTests);
+    }
+    CPPUNIT_ASSERT_EQUAL(tests.size(), complete);
+    CPPUNIT_ASSERT_EQUAL(std::size_t{0}, scheduler.numberPending());
+
+    for (std::size_t i = 0u; i < tests.size(); ++i) {
+        maths::CPeriodicityHypothesisTestsResult expected{
+            maths::testForPeriods(config, 0, HALF_HOUR, windows[i])};
+        CPPUNIT_ASSERT_EQUAL(expected.print(), tests[i]->result().print());
+        CPPUNIT_ASSERT_EQUAL(i % 2 == 0, tests[i]->result().periodic());
+    }
+
+    maths::CPeriodicityTestScheduler::STimings timings{scheduler.timings()};
+    LOG_DEBUG(<< "mean test time = " << timings.s_MeanTestTime
+              << "us, max test time = " << timings.s_MaxTestTime << "us");
+    CPPUNIT_ASSERT(timings.s_MeanTestTime > 0.0);
+    CPPUNIT_ASSERT(timings.s_MaxTestTime >= timings.s_MeanTestTime);
+}
+
+void CPeriodicityTestSchedulerTest::testDiscard() {
+    // Test that tests whose handles are released aren't run.
+
+    test::CRandomNumbers rng;
+
+    TFloatMeanAccumulatorVecVec windows(generateWindows(rng, 10));
+
+    maths::CPeriodicityHypothesisTestsConfig config;
+    maths::CPeriodicityTestScheduler scheduler{1};
+
+    TTestPtrVec tests;
+    for (std::size_t i = 0u; i < windows.size(); ++i) {
+        TTestPtr test{scheduler.schedule(config, 0, HALF_HOUR, windows[i])};
+        if (i % 2 == 0) {
+            tests.push_back(test);
+        }
+    }
+
+    scheduler.runTests();
+
+    maths::CPeriodicityTestScheduler::STimings timings{scheduler.timings()};
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t{5}, timings.s_NumberTests);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t{5}, timings.s_NumberDiscarded);
+    for (const auto& test : tests) {
+        CPPUNIT_ASSERT(test->complete());
+    }
+}
+
+void CPeriodicityTestSchedulerTest::testThreads() {
+    // Test the results and when they're available don't depend on the
+    // number of threads.
+
+    test::CRandomNumbers rng;
+
+    TFloatMeanAccumulatorVecVec windows(generateWindows(rng, 40));
+
+    maths::CPeriodicityHypothesisTestsConfig config;
+    maths::CPeriodicityTestScheduler serial{4};
+    maths::CPeriodicityTestScheduler parallel{4};
+    core::CStaticThreadPool pool{3};
+
+    TTestPtrVec serialTests;
+    TTestPtrVec parallelTests;
+    for (const auto& window : windows) {
+        serialTests.push_back(serial.schedule(config, 0, HALF_HOUR, window));
+    }
+    for (auto i = windows.rbegin(); i != windows.rend(); ++i) {
+        parallelTests.insert(parallelTests.begin(),
+                             parallel.schedule(config, 0, HALF_HOUR, *i));
+    }
+
+    for (std::size_t run = 0u; run < 4; ++run) {
+        serial.runTests();
+        parallel.runTests(&pool);
+        for (std::size_t i = 0u; i < windows.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(serialTests[i]->complete(), parallelTests[i]->complete());
+        }
+    }
+    for (std::size_t i = 0u; i < windows.size(); ++i) {
+        CPPUNIT_ASSERT(parallelTests[i]->complete());
+        CPPUNIT_ASSERT_EQUAL(serialTests[i]->result().print(),
+                             parallelTests[i]->result().print());
+    }
+}
+
+void CPeriodicityTestSchedulerTest::testDecomposition() {
+    // Test that a decomposition using a scheduler detects the same
+    // components shortly after one which tests immediately.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, 1.0, 3 * WEEK / HALF_HOUR, noise);
+
+    maths::CPeriodicityTestScheduler scheduler{4};
+    maths::CTimeSeriesDecomposition immediate(0.01, HALF_HOUR);
+    maths::CTimeSeriesDecomposition scheduled(0.01, HALF_HOUR);
+    scheduled.periodicityTestScheduler(&scheduler);
+
+    core_t::TTime immediateDetected{0};
+    core_t::TTime scheduledDetected{0};
+    for (core_t::TTime time = 0; time < 3 * WEEK; time += HALF_HOUR) {
+        double value{10.0 * std::sin(boost::math::double_constants::two_pi *
+                                     static_cast<double>(time) /
+                                     static_cast<double>(DAY)) +
+                     noise[time / HALF_HOUR]};
+        if (immediate.addPoint(time, value) && immediateDetected == 0) {
+            immediateDetected = time;
+        }
+        if (scheduled.addPoint(time, value) && scheduledDetected == 0) {
+            scheduledDetected = time;
+        }
+        scheduler.runTests();
+    }
+
+    LOG_DEBUG(<< "detected immediately at " << immediateDetected
+              << ", detected scheduled at " << scheduledDetected);
+    CPPUNIT_ASSERT(immediateDetected > 0);
+    CPPUNIT_ASSERT(scheduledDetected >= immediateDetected);
+    CPPUNIT_ASSERT(scheduledDetected <= immediateDetected + 4 * HALF_HOUR);
+    CPPUNIT_ASSERT_EQUAL(immediate.seasonalComponents().size(),
+                         scheduled.seasonalComponents().size());
+    CPPUNIT_ASSERT(scheduler.timings().s_NumberTests > 0);
+}
+
+void CPeriodicityTestSchedulerTest::testWindowMemory() {
+    // Test that a decomposition using a scheduler only keeps a copy of
+    // a window while a test of it is pending and the window restarts.
+    // With half hour buckets the short window restarts after two weeks.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, 1.0, 3 * WEEK / HALF_HOUR, noise);
+
+    std::size_t spread{4};
+    maths::CPeriodicityTestScheduler scheduler{spread};
+    maths::CTimeSeriesDecomposition immediate(0.01, HALF_HOUR);
+    maths::CTimeSeriesDecomposition scheduled(0.01, HALF_HOUR);
+    scheduled.periodicityTestScheduler(&scheduler);
+
+    std::size_t copies{0};
+    for (core_t::TTime time = 0; time < 3 * WEEK; time += HALF_HOUR) {
+        immediate.addPoint(time, noise[time / HALF_HOUR]);
+        scheduled.addPoint(time, noise[time / HALF_HOUR]);
+        CPPUNIT_ASSERT(scheduled.memoryUsage() >= immediate.memoryUsage());
+        if (scheduled.memoryUsage() > immediate.memoryUsage()) {
+            ++copies;
+        }
+        scheduler.runTests();
+    }
+
+    LOG_DEBUG(<< "kept a copy of a window for " << copies << " buckets");
+    CPPUNIT_ASSERT(copies > 0);
+    CPPUNIT_ASSERT(copies <= spread);
+    CPPUNIT_ASSERT(immediate.seasonalComponents().empty());
+    CPPUNIT_ASSERT(scheduled.seasonalComponents().empty());
+    CPPUNIT_ASSERT(scheduler.timings().s_NumberTests > 0);
+}
+
+CppUnit::Test* CPeriodicityTestSchedulerTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CPeriodicityTestSchedulerTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPeriodicityTestSchedulerTest>(
+        "CPeriodicityTestSchedulerTest::testSpread", &CPeriodicityTestSchedulerTest::testSpread));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPeriodicityTestSchedulerTest>(
+        "CPeriodicityTestSchedulerTest::testDiscard", &CPeriodicityTestSchedulerTest::testDiscard));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPeriodicityTestSchedulerTest>(
+        "CPeriodicityTestSchedulerTest::testThreads", &CPeriodicityTestSchedulerTest::testThreads));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPeriodicityTestSchedulerTest>(
+        "CPeriodicityTestSchedulerTest::testDecomposition",
+        &CPeriodicityTestSchedulerTest::testDecomposition));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPeriodicityTestSchedulerTest>(
+        "CPeriodicityTestSchedulerTest::testWindowMemory",
+        &CPeriodicityTestSchedulerTest::testWindowMemory));
+
+    return suiteOfTests;
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_CPeriodicityTestSchedulerTest_h
+#define INCLUDED_CPeriodicityTestSchedulerTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CPeriodicityTestSchedulerTest : public CppUnit::TestFixture {
+public:
+    void testSpread();
+    void testDiscard();
+    void testThreads();
+    void testDecomposition();
+    void testWindowMemory();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CPeriodicityTestSchedulerTest_h
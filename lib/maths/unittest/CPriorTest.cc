@@ -7,12 +7,14 @@
 #include "CPriorTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 
 #include <maths/CBasicStatistics.h>
 #include <maths/CCompositeFunctions.h>
 #include <maths/CGammaRateConjugate.h>
 #include <maths/CLogNormalMeanPrecConjugate.h>
 #include <maths/CNormalMeanPrecConjugate.h>
+#include <maths/CPoissonMeanConjugate.h>
 #include <maths/CPrior.h>
 #include <maths/CPriorDetail.h>
 #include <maths/CTools.h>
@@ -23,12 +25,17 @@
 
 #include <boost/math/distributions/normal.hpp>
 
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
 using namespace ml;
 using namespace handy_typedefs;
 
 namespace {
 
 using TDoubleVec = std::vector<double>;
+using TUIntVec = std::vector<unsigned int>;
 
 class CX {
 public:
@@ -71,6 +78,112 @@ private:
     const maths::CPrior* m_Prior;
     mutable TDoubleVec m_X;
 };
+
+using TTailVec = maths::CPrior::TTailVec;
+using TNormalVec = std::vector<maths::CNormalMeanPrecConjugate>;
+using TLogNormalVec = std::vector<maths::CLogNormalMeanPrecConjugate>;
+using TPoissonVec = std::vector<maths::CPoissonMeanConjugate>;
+using TGammaVec = std::vector<maths::CGammaRateConjugate>;
+
+const maths_t::EProbabilityCalculation CALCULATIONS[]{
+    maths_t::E_OneSidedBelow, maths_t::E_TwoSided, maths_t::E_OneSidedAbove};
+
+//! Get one of a selection of weights which covers all the weight styles.
+maths_t::TDoubleWeightsAry weight(std::size_t i) {
+    switch (i % 5) {
+    case 0:
+        return maths_t::CUnitWeights::UNIT;
+    case 1:
+        return maths_t::seasonalVarianceScaleWeight(2.0);
+    case 2:
+        return maths_t::countVarianceScaleWeight(1.5);
+    case 3:
+        return maths_t::countWeight(2.0);
+    default:
+        return maths_t::winsorisationWeight(0.5);
+    }
+}
+
+template<typename PRIOR>
+void addSamples(const TDoubleVec& samples, PRIOR& prior) {
+    prior.addSamples(samples, maths_t::TDoubleWeightsAry1Vec(
+                                  samples.size(), maths_t::CUnitWeights::UNIT));
+}
+
+//! Check that the batch functions for the concrete prior type give the
+//! same results as the member functions of each prior.
+template<typename PRIOR>
+void checkBatch(const std::vector<PRIOR>& priors, const maths::CPrior::SSampleBatch& samples) {
+    std::vector<const PRIOR*> concrete;
+    maths::CPrior::TPriorCPtrVec generic;
+    for (const auto& prior : priors) {
+        concrete.push_back(&prior);
+        generic.push_back(&prior);
+    }
+
+    auto sample = [&samples](std::size_t i) {
+        return maths::CPrior::TDouble1Vec{samples.s_Samples[i]};
+    };
+    auto weights = [&samples](std::size_t i) {
+        return maths_t::TDoubleWeightsAry1Vec{samples.weights(i)};
+    };
+
+    // Probabilities are compared to a relative tolerance and log
+    // quantities to an absolute one because the kernels can differ
+    // from boost in the last bit of the error function.
+
+    for (auto calculation : CALCULATIONS) {
+        TDoubleVec lowerBounds, upperBounds, genericLowerBounds, genericUpperBounds;
+        TTailVec tails, genericTails;
+        CPPUNIT_ASSERT(PRIOR::batchProbabilityOfLessLikelySamples(
+            calculation, concrete, samples, lowerBounds, upperBounds, tails));
+        CPPUNIT_ASSERT(maths::CPrior::batchProbabilityOfLessLikelySamples(
+            calculation, generic, samples, genericLowerBounds, genericUpperBounds, genericTails));
+        for (std::size_t i = 0u; i < priors.size(); ++i) {
+            double lb, ub;
+            maths_t::ETail tail;
+            CPPUNIT_ASSERT(priors[i].probabilityOfLessLikelySamples(
+                calculation, sample(i), weights(i), lb, ub, tail));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(lb, lowerBounds[i], 1e-10 * lb);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(ub, upperBounds[i], 1e-10 * ub);
+            CPPUNIT_ASSERT_EQUAL(tail, tails[i]);
+            CPPUNIT_ASSERT_EQUAL(lb, genericLowerBounds[i]);
+            CPPUNIT_ASSERT_EQUAL(ub, genericUpperBounds[i]);
+            CPPUNIT_ASSERT_EQUAL(tail, genericTails[i]);
+        }
+    }
+
+    {
+        TDoubleVec lowerBounds, upperBounds, genericLowerBounds, genericUpperBounds;
+        CPPUNIT_ASSERT(PRIOR::batchMinusLogJointCdf(concrete, samples, lowerBounds, upperBounds));
+        CPPUNIT_ASSERT(maths::CPrior::batchMinusLogJointCdf(
+            generic, samples, genericLowerBounds, genericUpperBounds));
+        for (std::size_t i = 0u; i < priors.size(); ++i) {
+            double lb, ub;
+            CPPUNIT_ASSERT(priors[i].minusLogJointCdf(sample(i), weights(i), lb, ub));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(lb, lowerBounds[i], 1e-10 * std::max(lb, 1.0));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(ub, upperBounds[i], 1e-10 * std::max(ub, 1.0));
+            CPPUNIT_ASSERT_EQUAL(lb, genericLowerBounds[i]);
+            CPPUNIT_ASSERT_EQUAL(ub, genericUpperBounds[i]);
+        }
+    }
+
+    {
+        TDoubleVec results, genericResults;
+        maths_t::EFloatingPointErrorStatus status{
+            PRIOR::batchJointLogMarginalLikelihood(concrete, samples, results)};
+        maths_t::EFloatingPointErrorStatus genericStatus{
+            maths::CPrior::batchJointLogMarginalLikelihood(generic, samples, genericResults)};
+        CPPUNIT_ASSERT_EQUAL(genericStatus, status);
+        for (std::size_t i = 0u; i < priors.size(); ++i) {
+            double result;
+            priors[i].jointLogMarginalLikelihood(sample(i), weights(i), result);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(
+                result, results[i], 1e-10 * std::max(std::fabs(result), 1.0));
+            CPPUNIT_ASSERT_EQUAL(result, genericResults[i]);
+        }
+    }
+}
 }
 
 void CPriorTest::testExpectation() {
@@ -125,11 +238,209 @@ void CPriorTest::testExpectation() {
     }
 }
 
+void CPriorTest::testBatch() {
+    // Test the batch functions give the same results as the member
+    // functions for a mixture of priors and weights, which include
+    // ones the vectorised kernels don't handle.
+
+    test::CRandomNumbers rng;
+
+    const std::size_t n{100};
+
+    TDoubleVec samples;
+
+    LOG_DEBUG(<< "*** normal ***");
+    {
+        TNormalVec priors;
+        maths::CPrior::SSampleBatch batch;
+        for (std::size_t i = 0u; i < n; ++i) {
+            double mean{static_cast<double>(i)};
+            double variance{1.0 + static_cast<double>(i % 7)};
+            rng.generateNormalSamples(mean, variance, 400, samples);
+            switch (i % 4) {
+            case 0:
+                // Narrow prior: normal approximation.
+                priors.push_back(maths::CNormalMeanPrecConjugate::nonInformativePrior(
+                    maths_t::E_ContinuousData));
+                addSamples(samples, priors.back());
+                break;
+            case 1:
+                // Wide prior: student's t.
+                priors.push_back(maths::CNormalMeanPrecConjugate::nonInformativePrior(
+                    maths_t::E_ContinuousData));
+                addSamples(TDoubleVec(samples.begin(), samples.begin() + 20),
+                           priors.back());
+                break;
+            case 2:
+                priors.push_back(maths::CNormalMeanPrecConjugate::nonInformativePrior(
+                    maths_t::E_ContinuousData));
+                break;
+            default:
+                for (auto& sample : samples) {
+                    sample = std::floor(sample);
+                }
+                priors.push_back(maths::CNormalMeanPrecConjugate::nonInformativePrior(
+                    maths_t::E_IntegerData));
+                addSamples(samples, priors.back());
+                break;
+            }
+            // Include samples in the far tails and at the mean.
+            double x{i % 3 == 0 ? mean + 50.0 * std::sqrt(variance)
+                                : (i % 3 == 1 ? mean - 3.0 * std::sqrt(variance) : mean)};
+            batch.add(x, weight(i));
+        }
+        checkBatch(priors, batch);
+    }
+
+    LOG_DEBUG(<< "*** log-normal ***");
+    {
+        TLogNormalVec priors;
+        maths::CPrior::SSampleBatch batch;
+        for (std::size_t i = 0u; i < n; ++i) {
+            double location{1.0 + 0.05 * static_cast<double>(i)};
+            double squareScale{0.1 + 0.02 * static_cast<double>(i % 7)};
+            rng.generateLogNormalSamples(location, squareScale, 400, samples);
+            priors.push_back(maths::CLogNormalMeanPrecConjugate::nonInformativePrior(
+                i % 4 == 3 ? maths_t::E_IntegerData : maths_t::E_ContinuousData));
+            switch (i % 4) {
+            case 0:
+            case 3:
+                addSamples(samples, priors.back());
+                break;
+            case 1:
+                addSamples(TDoubleVec(samples.begin(), samples.begin() + 20),
+                           priors.back());
+                break;
+            default:
+                break;
+            }
+            double x{i % 3 == 0 ? std::exp(location + 20.0 * std::sqrt(squareScale))
+                                : (i % 3 == 1 ? std::exp(location - 2.0 * std::sqrt(squareScale))
+                                              : -1.0)};
+            batch.add(x, weight(i));
+        }
+        checkBatch(priors, batch);
+    }
+
+    LOG_DEBUG(<< "*** poisson ***");
+    {
+        TPoissonVec priors;
+        maths::CPrior::SSampleBatch batch;
+        TUIntVec counts;
+        for (std::size_t i = 0u; i < n; ++i) {
+            // The marginal likelihood is normal for large rate.
+            double rate{i % 3 == 0 ? 20.0 : 150.0 + static_cast<double>(i)};
+            rng.generatePoissonSamples(rate, 100, counts);
+            priors.push_back(maths::CPoissonMeanConjugate::nonInformativePrior());
+            if (i % 4 != 2) {
+                addSamples(TDoubleVec(counts.begin(), counts.end()), priors.back());
+            }
+            double x{i % 2 == 0 ? std::floor(rate + 4.0 * std::sqrt(rate))
+                                : std::floor(rate - 2.0 * std::sqrt(rate))};
+            batch.add(x, weight(i));
+        }
+        checkBatch(priors, batch);
+    }
+}
+
+void CPriorTest::testBatchPerformance() {
+    // Compare the time to compute probabilities for a large number of
+    // priors using the batch functions and the member functions.
+
+    test::CRandomNumbers rng;
+
+    const std::size_t n{20000};
+
+    TDoubleVec samples;
+    rng.generateNormalSamples(10.0, 4.0, 500, samples);
+
+    maths::CNormalMeanPrecConjugate normal(
+        maths::CNormalMeanPrecConjugate::nonInformativePrior(maths_t::E_ContinuousData));
+    addSamples(samples, normal);
+    maths::CLogNormalMeanPrecConjugate logNormal(
+        maths::CLogNormalMeanPrecConjugate::nonInformativePrior(maths_t::E_ContinuousData));
+    addSamples(samples, logNormal);
+    maths::CGammaRateConjugate gamma(
+        maths::CGammaRateConjugate::nonInformativePrior(maths_t::E_ContinuousData));
+    addSamples(samples, gamma);
+    rng.generateNormalSamples(200.0, 200.0, 500, samples);
+    maths::CPoissonMeanConjugate poisson(maths::CPoissonMeanConjugate::nonInformativePrior());
+    addSamples(samples, poisson);
+
+    TNormalVec normals(n, normal);
+    TLogNormalVec logNormals(n, logNormal);
+    TPoissonVec poissons(n, poisson);
+    TGammaVec gammas(n, gamma);
+
+    maths::CPrior::SSampleBatch batch;
+    maths::CPrior::SSampleBatch poissonBatch;
+    rng.generateNormalSamples(10.0, 9.0, n, samples);
+    for (std::size_t i = 0u; i < n; ++i) {
+        batch.add(samples[i]);
+        poissonBatch.add(std::floor(20.0 * samples[i]));
+    }
+
+    TDoubleVec lowerBounds, upperBounds;
+    TTailVec tails;
+
+    auto time = [&](const std::string& name, const maths::CPrior::TPriorCPtrVec& generic,
+                    const maths::CPrior::SSampleBatch& batch_, auto computeBatch) {
+        core::CStopWatch stopWatch;
+        stopWatch.start();
+        CPPUNIT_ASSERT(maths::CPrior::batchProbabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, generic, batch_, lowerBounds, upperBounds, tails));
+        std::uint64_t scalarTime{stopWatch.stop()};
+        stopWatch.reset();
+        stopWatch.start();
+        CPPUNIT_ASSERT(computeBatch());
+        std::uint64_t batchTime{stopWatch.stop()};
+        LOG_DEBUG(<< name << ": scalar time = " << scalarTime
+                  << "ms, batch time = " << batchTime << "ms");
+    };
+
+    std::vector<const maths::CNormalMeanPrecConjugate*> normalPtrs;
+    std::vector<const maths::CLogNormalMeanPrecConjugate*> logNormalPtrs;
+    std::vector<const maths::CPoissonMeanConjugate*> poissonPtrs;
+    maths::CPrior::TPriorCPtrVec normalGeneric, logNormalGeneric, poissonGeneric, gammaGeneric;
+    for (std::size_t i = 0u; i < n; ++i) {
+        normalPtrs.push_back(&normals[i]);
+        normalGeneric.push_back(&normals[i]);
+        logNormalPtrs.push_back(&logNormals[i]);
+        logNormalGeneric.push_back(&logNormals[i]);
+        poissonPtrs.push_back(&poissons[i]);
+        poissonGeneric.push_back(&poissons[i]);
+        gammaGeneric.push_back(&gammas[i]);
+    }
+
+    time("normal", normalGeneric, batch, [&] {
+        return maths::CNormalMeanPrecConjugate::batchProbabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, normalPtrs, batch, lowerBounds, upperBounds, tails);
+    });
+    time("log-normal", logNormalGeneric, batch, [&] {
+        return maths::CLogNormalMeanPrecConjugate::batchProbabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, logNormalPtrs, batch, lowerBounds, upperBounds, tails);
+    });
+    time("poisson", poissonGeneric, poissonBatch, [&] {
+        return maths::CPoissonMeanConjugate::batchProbabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, poissonPtrs, poissonBatch, lowerBounds, upperBounds, tails);
+    });
+    // There is no vectorised kernel for the gamma prior so this is the
+    // same as the scalar path.
+    time("gamma", gammaGeneric, batch, [&] {
+        return maths::CPrior::batchProbabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, gammaGeneric, batch, lowerBounds, upperBounds, tails);
+    });
+}
+
 CppUnit::Test* CPriorTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CPriorTest");
 
     suiteOfTests->addTest(new CppUnit::TestCaller<CPriorTest>(
         "CPriorTest::testExpectation", &CPriorTest::testExpectation));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPriorTest>(
+        "CPriorTest::testBatch", &CPriorTest::testBatch));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPriorTest>(
+        "CPriorTest::testBatchPerformance", &CPriorTest::testBatchPerformance));
 
     return suiteOfTests;
 }
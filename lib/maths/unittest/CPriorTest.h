@@ -12,6 +12,8 @@
 class CPriorTest : public CppUnit::TestFixture {
 public:
     void testExpectation();
+    void testBatch();
+    void testBatchPerformance();
 
     static CppUnit::Test* suite();
 };
@@ -20,6 +20,7 @@
 #include <boost/math/distributions/normal.hpp>
 #include <boost/range.hpp>
 
+#include <algorithm>
 #include <set>
 
 using namespace ml;
@@ -204,6 +205,51 @@ void CQDigestTest::testCdf() {
     }
 }
 
+void CQDigestTest::testCdfBreakpoints() {
+    // Test that the c.d.f. and p.d.f. bounds are constant between
+    // consecutive breakpoints and that they change at most of them.
+
+    CQDigest qDigest(20u);
+
+    TDoubleVec samples;
+    CRandomNumbers generator;
+    generator.generateUniformSamples(0.0, 200.0, 500u, samples);
+    for (std::size_t i = 0u; i < samples.size(); ++i) {
+        qDigest.add(static_cast<uint32_t>(std::floor(samples[i])));
+    }
+
+    CQDigest::TUInt32Vec breakpoints;
+    qDigest.cdfBreakpoints(breakpoints);
+    LOG_DEBUG(<< "breakpoints = " << core::CContainerPrinter::print(breakpoints));
+
+    CPPUNIT_ASSERT(!breakpoints.empty());
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), breakpoints[0]);
+    CPPUNIT_ASSERT(std::is_sorted(breakpoints.begin(), breakpoints.end()));
+    CPPUNIT_ASSERT(std::adjacent_find(breakpoints.begin(), breakpoints.end()) ==
+                   breakpoints.end());
+
+    auto bounds = [&qDigest](uint32_t x) {
+        double result[4];
+        qDigest.cdf(x, 0.0, result[0], result[1]);
+        qDigest.pdf(x, 0.0, result[2], result[3]);
+        return core::CContainerPrinter::print(result);
+    };
+
+    std::size_t changes = 0u;
+    for (std::size_t i = 0u; i < breakpoints.size(); ++i) {
+        uint32_t end = i + 1 < breakpoints.size() ? breakpoints[i + 1] : 260;
+        std::string expected = bounds(breakpoints[i]);
+        for (uint32_t x = breakpoints[i] + 1; x < end; ++x) {
+            CPPUNIT_ASSERT_EQUAL(expected, bounds(x));
+        }
+        if (i > 0 && expected != bounds(breakpoints[i] - 1)) {
+            ++changes;
+        }
+    }
+    LOG_DEBUG(<< "changes = " << changes << "/" << breakpoints.size());
+    CPPUNIT_ASSERT(2 * changes > breakpoints.size());
+}
+
 void CQDigestTest::testSummary() {
     // Check that quantiles of the summary agree with the digest.
     {
@@ -577,6 +623,8 @@ CppUnit::Test* CQDigestTest::suite() {
         "CQDigestTest::testMerge", &CQDigestTest::testMerge));
     suiteOfTests->addTest(new CppUnit::TestCaller<CQDigestTest>(
         "CQDigestTest::testCdf", &CQDigestTest::testCdf));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CQDigestTest>(
+        "CQDigestTest::testCdfBreakpoints", &CQDigestTest::testCdfBreakpoints));
     suiteOfTests->addTest(new CppUnit::TestCaller<CQDigestTest>(
         "CQDigestTest::testSummary", &CQDigestTest::testSummary));
     suiteOfTests->addTest(new CppUnit::TestCaller<CQDigestTest>(
@@ -14,6 +14,7 @@ public:
     void testAdd();
     void testMerge();
     void testCdf();
+    void testCdfBreakpoints();
     void testSummary();
     void testPropagateForwardByTime();
     void testScale();
@@ -7,6 +7,7 @@
 #include "CSignalTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 #include <core/CoreTypes.h>
 
 #include <maths/CSignal.h>
@@ -323,6 +324,71 @@ void CSignalTest::testFFTIFFTIdempotency() {
     }
 }
 
+void CSignalTest::testFFTLargeLengths() {
+    // Test lengths with large and repeated factors of each radix and
+    // large prime lengths versus brute force.
+
+    test::CRandomNumbers rng;
+
+    TSizeVec lengths{1, 256, 729, 1000, 1024, 1125, 1536, 997, 1009, 2 * 1009};
+
+    for (auto length : lengths) {
+        TDoubleVec components;
+        rng.generateUniformSamples(-100.0, 100.0, 2 * length, components);
+
+        maths::CSignal::TComplexVec expected;
+        for (std::size_t k = 0u; k < length; ++k) {
+            expected.emplace_back(components[2 * k], components[2 * k + 1]);
+        }
+        maths::CSignal::TComplexVec actual(expected);
+
+        bruteForceDft(expected, +1.0);
+        maths::CSignal::fft(actual);
+
+        double error = 0.0;
+        double norm = 0.0;
+        for (std::size_t k = 0u; k < actual.size(); ++k) {
+            error += std::abs(actual[k] - expected[k]);
+            norm += std::abs(expected[k]);
+        }
+
+        LOG_DEBUG(<< "length = " << length << ", error  = " << error / norm);
+        CPPUNIT_ASSERT(error < 1e-12 * norm);
+    }
+}
+
+void CSignalTest::testRealFFT() {
+    // Test the real transform is the first half of the complex transform.
+
+    test::CRandomNumbers rng;
+
+    TSizeVec lengths;
+    rng.generateUniformSamples(1, 200, 500, lengths);
+
+    maths::CSignal::CFftWorkspace workspace;
+
+    for (auto length : lengths) {
+        TDoubleVec values;
+        rng.generateUniformSamples(-1000.0, 1000.0, length, values);
+
+        maths::CSignal::TComplexVec expected(values.begin(), values.end());
+        maths::CSignal::fft(expected);
+
+        maths::CSignal::TComplexVec actual;
+        maths::CSignal::realFft(values, actual, workspace);
+
+        CPPUNIT_ASSERT_EQUAL(length / 2 + 1, actual.size());
+        double error = 0.0;
+        for (std::size_t k = 0u; k < actual.size(); ++k) {
+            error += std::abs(actual[k] - expected[k]);
+        }
+        if (error >= 1e-8) {
+            LOG_DEBUG(<< "length = " << length << ", error  = " << error);
+        }
+        CPPUNIT_ASSERT(error < 1e-8);
+    }
+}
+
 void CSignalTest::testAutocorrelations() {
     test::CRandomNumbers rng;
 
@@ -355,6 +421,81 @@ void CSignalTest::testAutocorrelations() {
     }
 }
 
+void CSignalTest::testAutocorrelationsPerformance() {
+    // Benchmark computing the autocorrelations for lengths typical of the
+    // windows tested by CPeriodicityHypothesisTests, which pad the values
+    // by one third, versus computing them with the complex transform.
+
+    using TFloatMeanAccumulatorVec = maths::CSignal::TFloatMeanAccumulatorVec;
+
+    test::CRandomNumbers rng;
+
+    TSizeVec lengths{4 * 168, 2016, 4 * 1008, 4032};
+    std::size_t repeats{100};
+
+    for (auto length : lengths) {
+        std::size_t n{length + length / 3};
+
+        TDoubleVec values_;
+        rng.generateNormalSamples(0.0, 1.0, length, values_);
+        TFloatMeanAccumulatorVec values(n);
+        for (std::size_t i = 0u; i < length; ++i) {
+            values[i].add(std::sin(boost::math::double_constants::two_pi *
+                                   static_cast<double>(i) / 24.0) +
+                          values_[i]);
+        }
+
+        core::CStopWatch stopWatch;
+        stopWatch.start();
+        TDoubleVec expected;
+        for (std::size_t i = 0u; i < repeats; ++i) {
+            // This is the calculation using the complex transform. Note
+            // that the padding is missing so is replaced by the mean.
+            double mean{0.0};
+            for (std::size_t j = 0u; j < length; ++j) {
+                mean += maths::CBasicStatistics::mean(values[j]);
+            }
+            mean /= static_cast<double>(length);
+            double variance{0.0};
+            maths::CSignal::TComplexVec f(n, maths::CSignal::TComplex(0.0, 0.0));
+            for (std::size_t j = 0u; j < length; ++j) {
+                double x{maths::CBasicStatistics::mean(values[j]) - mean};
+                variance += x * x;
+                f[j] = maths::CSignal::TComplex(x, 0.0);
+            }
+            variance /= static_cast<double>(length);
+            maths::CSignal::fft(f);
+            maths::CSignal::TComplexVec fConj(f);
+            maths::CSignal::conj(fConj);
+            maths::CSignal::hadamard(fConj, f);
+            maths::CSignal::ifft(f);
+            expected.clear();
+            for (std::size_t j = 1u; j < n; ++j) {
+                expected.push_back(f[j].real() / variance / static_cast<double>(n));
+            }
+        }
+        std::uint64_t complexTime{stopWatch.stop()};
+
+        stopWatch.reset();
+        stopWatch.start();
+        TDoubleVec actual;
+        maths::CSignal::CFftWorkspace workspace;
+        for (std::size_t i = 0u; i < repeats; ++i) {
+            actual.clear();
+            maths::CSignal::autocorrelations(values, actual, workspace);
+        }
+        std::uint64_t realTime{stopWatch.stop()};
+
+        LOG_DEBUG(<< "n = " << n << ": complex time = " << complexTime
+                  << "ms, real time = " << realTime << "ms");
+
+        CPPUNIT_ASSERT_EQUAL(expected.size(), actual.size());
+        for (std::size_t i = 0u; i < expected.size(); ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i], actual[i], 1e-10);
+        }
+    }
+}
+
 CppUnit::Test* CSignalTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CSignalTest");
 
@@ -368,8 +509,15 @@ CppUnit::Test* CSignalTest::suite() {
         "CSignalTest::testIFFTRandomized", &CSignalTest::testIFFTRandomized));
     suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
         "CSignalTest::testFFTIFFTIdempotency", &CSignalTest::testFFTIFFTIdempotency));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
+        "CSignalTest::testFFTLargeLengths", &CSignalTest::testFFTLargeLengths));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
+        "CSignalTest::testRealFFT", &CSignalTest::testRealFFT));
     suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
         "CSignalTest::testAutocorrelations", &CSignalTest::testAutocorrelations));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
+        "CSignalTest::testAutocorrelationsPerformance",
+        &CSignalTest::testAutocorrelationsPerformance));
 
     return suiteOfTests;
 }
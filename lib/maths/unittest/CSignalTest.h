@@ -16,7 +16,10 @@ public:
     void testFFTRandomized();
     void testIFFTRandomized();
     void testFFTIFFTIdempotency();
+    void testFFTLargeLengths();
+    void testRealFFT();
     void testAutocorrelations();
+    void testAutocorrelationsPerformance();
 
     static CppUnit::Test* suite();
 };
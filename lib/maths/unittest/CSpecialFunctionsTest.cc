@@ -0,0 +1,380 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CSpecialFunctionsTest.h"
+
+#include <core/CLogger.h>
+#include <core/CStopWatch.h>
+
+#include <maths/CSpecialFunctions.h>
+
+#include <test/CRandomNumbers.h>
+
+#include <boost/math/distributions/gamma.hpp>
+#include <boost/math/distributions/normal.hpp>
+#include <boost/math/distributions/students_t.hpp>
+#include <boost/math/special_functions/beta.hpp>
+#include <boost/math/special_functions/digamma.hpp>
+#include <boost/math/special_functions/erf.hpp>
+#include <boost/math/special_functions/gamma.hpp>
+#include <boost/range.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace ml;
+
+namespace {
+
+using TDoubleVec = std::vector<double>;
+
+//! Get the error of \p actual relative to max(\p scale, |\p expected|).
+double error(double expected, double actual, double scale = 0.0) {
+    return std::fabs(actual - expected) / std::max(scale, std::fabs(expected));
+}
+
+//! Check that the arguments for which the reference values are very small
+//! are skipped: boost::math isn't accurate in the extreme tails.
+bool tiny(double expected) {
+    return std::fabs(expected) < 1e-200;
+}
+}
+
+void CSpecialFunctionsTest::testLogGamma() {
+    // Test against boost::math::lgamma over a wide range of scales.
+
+    LOG_DEBUG(<< "Instruction set = " << maths::CSpecialFunctions::instructionSet());
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec x;
+    rng.generateUniformSamples(-10.0, 10.0, 10000, x);
+    std::for_each(x.begin(), x.end(), [](double& xi) { xi = std::exp(xi); });
+    x.push_back(1.0);
+    x.push_back(2.0);
+
+    TDoubleVec actual(x.size());
+    maths::CSpecialFunctions::logGamma(x.data(), x.size(), actual.data());
+
+    double maxError{0.0};
+    for (std::size_t i = 0u; i < x.size(); ++i) {
+        double expected{boost::math::lgamma(x[i])};
+        maxError = std::max(maxError, error(expected, actual[i], 1.0));
+    }
+    LOG_DEBUG(<< "max error = " << maxError);
+    CPPUNIT_ASSERT(maxError < 1e-14);
+}
+
+void CSpecialFunctionsTest::testDigamma() {
+    // Test against boost::math::digamma over a wide range of scales.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec x;
+    rng.generateUniformSamples(-10.0, 10.0, 10000, x);
+    std::for_each(x.begin(), x.end(), [](double& xi) { xi = std::exp(xi); });
+
+    TDoubleVec actual(x.size());
+    maths::CSpecialFunctions::digamma(x.data(), x.size(), actual.data());
+
+    double maxError{0.0};
+    for (std::size_t i = 0u; i < x.size(); ++i) {
+        double expected{boost::math::digamma(x[i])};
+        maxError = std::max(maxError, error(expected, actual[i], 1.0));
+    }
+    LOG_DEBUG(<< "max error = " << maxError);
+    CPPUNIT_ASSERT(maxError < 1e-14);
+}
+
+void CSpecialFunctionsTest::testErf() {
+    // Test erf and erfc against boost::math, including far into the tails.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec x;
+    rng.generateUniformSamples(-30.0, 30.0, 10000, x);
+    TDoubleVec small;
+    rng.generateUniformSamples(-1.0, 1.0, 1000, small);
+    x.insert(x.end(), small.begin(), small.end());
+    x.push_back(0.0);
+
+    TDoubleVec actualErf(x.size());
+    TDoubleVec actualErfc(x.size());
+    maths::CSpecialFunctions::erf(x.data(), x.size(), actualErf.data());
+    maths::CSpecialFunctions::erfc(x.data(), x.size(), actualErfc.data());
+
+    double maxErfError{0.0};
+    double maxErfcError{0.0};
+    for (std::size_t i = 0u; i < x.size(); ++i) {
+        double expected{boost::math::erf(x[i])};
+        maxErfError = std::max(maxErfError, error(expected, actualErf[i], 1e-300));
+        expected = boost::math::erfc(x[i]);
+        if (tiny(expected)) {
+            CPPUNIT_ASSERT(actualErfc[i] < 1e-200);
+            continue;
+        }
+        maxErfcError = std::max(maxErfcError, error(expected, actualErfc[i]));
+    }
+    LOG_DEBUG(<< "max erf error = " << maxErfError);
+    LOG_DEBUG(<< "max erfc error = " << maxErfcError);
+    CPPUNIT_ASSERT(maxErfError < 1e-14);
+    CPPUNIT_ASSERT(maxErfcError < 1e-14);
+}
+
+void CSpecialFunctionsTest::testIncompleteGamma() {
+    // Test P(a, x) and Q(a, x) against boost::math for x around the
+    // mean for a range of shapes.
+
+    test::CRandomNumbers rng;
+
+    double shapes[]{10.0, 100.0, 1000.0};
+    double tolerances[]{1e-12, 1e-11, 1e-11};
+
+    for (std::size_t i = 0u; i < boost::size(shapes); ++i) {
+        LOG_DEBUG(<< "a < " << shapes[i]);
+
+        TDoubleVec a, x;
+        rng.generateUniformSamples(0.01, shapes[i], 5000, a);
+        rng.generateUniformSamples(0.0, 3.0, 5000, x);
+        for (std::size_t j = 0u; j < a.size(); ++j) {
+            x[j] *= a[j];
+        }
+
+        for (auto complement : {false, true}) {
+            TDoubleVec actual(a.size());
+            maths::CSpecialFunctions::incompleteGamma(
+                a.data(), x.data(), a.size(), actual.data(), complement);
+
+            double maxError{0.0};
+            for (std::size_t j = 0u; j < a.size(); ++j) {
+                double expected{complement ? boost::math::gamma_q(a[j], x[j])
+                                           : boost::math::gamma_p(a[j], x[j])};
+                if (tiny(expected) == false) {
+                    maxError = std::max(maxError, error(expected, actual[j]));
+                }
+            }
+            LOG_DEBUG(<< "complement = " << complement << ", max error = " << maxError);
+            CPPUNIT_ASSERT(maxError < tolerances[i]);
+        }
+    }
+}
+
+void CSpecialFunctionsTest::testIncompleteBeta() {
+    // Test I_x(a, b) and its complement against boost::math for a
+    // range of shapes.
+
+    test::CRandomNumbers rng;
+
+    double shapes[]{10.0, 100.0, 1000.0};
+    double tolerances[]{1e-11, 1e-10, 1e-9};
+
+    for (std::size_t i = 0u; i < boost::size(shapes); ++i) {
+        LOG_DEBUG(<< "a, b < " << shapes[i]);
+
+        TDoubleVec a, b, x;
+        rng.generateUniformSamples(0.01, shapes[i], 5000, a);
+        rng.generateUniformSamples(0.01, shapes[i], 5000, b);
+        rng.generateUniformSamples(0.0, 1.0, 5000, x);
+
+        for (auto complement : {false, true}) {
+            TDoubleVec actual(a.size());
+            maths::CSpecialFunctions::incompleteBeta(
+                a.data(), b.data(), x.data(), a.size(), actual.data(), complement);
+
+            double maxError{0.0};
+            for (std::size_t j = 0u; j < a.size(); ++j) {
+                double expected{complement ? boost::math::ibetac(a[j], b[j], x[j])
+                                           : boost::math::ibeta(a[j], b[j], x[j])};
+                if (tiny(expected) == false) {
+                    maxError = std::max(maxError, error(expected, actual[j]));
+                }
+            }
+            LOG_DEBUG(<< "complement = " << complement << ", max error = " << maxError);
+            CPPUNIT_ASSERT(maxError < tolerances[i]);
+        }
+    }
+}
+
+void CSpecialFunctionsTest::testCdfs() {
+    // Test the normal, student's t and gamma c.d.f.s against boost::math.
+
+    test::CRandomNumbers rng;
+
+    const std::size_t n{5000};
+
+    TDoubleVec location, scale, shape, x;
+    rng.generateUniformSamples(-100.0, 100.0, n, location);
+    rng.generateUniformSamples(0.1, 50.0, n, scale);
+    rng.generateUniformSamples(0.5, 300.0, n, shape);
+    rng.generateUniformSamples(-8.0, 8.0, n, x);
+
+    for (auto complement : {false, true}) {
+        TDoubleVec y(n);
+        for (std::size_t i = 0u; i < n; ++i) {
+            y[i] = location[i] + scale[i] * x[i];
+        }
+        TDoubleVec actual(n);
+        maths::CSpecialFunctions::normalCdf(location.data(), scale.data(),
+                                            y.data(), n, actual.data(), complement);
+        double maxError{0.0};
+        for (std::size_t i = 0u; i < n; ++i) {
+            boost::math::normal normal(location[i], scale[i]);
+            double expected{complement ? boost::math::cdf(boost::math::complement(normal, y[i]))
+                                       : boost::math::cdf(normal, y[i])};
+            maxError = std::max(maxError, error(expected, actual[i]));
+        }
+        LOG_DEBUG(<< "normal: complement = " << complement << ", max error = " << maxError);
+        CPPUNIT_ASSERT(maxError < 1e-13);
+
+        maths::CSpecialFunctions::studentsTCdf(shape.data(), x.data(), n,
+                                               actual.data(), complement);
+        maxError = 0.0;
+        for (std::size_t i = 0u; i < n; ++i) {
+            boost::math::students_t students(shape[i]);
+            double expected{complement ? boost::math::cdf(boost::math::complement(students, x[i]))
+                                       : boost::math::cdf(students, x[i])};
+            maxError = std::max(maxError, error(expected, actual[i]));
+        }
+        LOG_DEBUG(<< "students t: complement = " << complement << ", max error = " << maxError);
+        CPPUNIT_ASSERT(maxError < 1e-11);
+
+        for (std::size_t i = 0u; i < n; ++i) {
+            y[i] = scale[i] * shape[i] * (1.0 + x[i] / 8.0);
+        }
+        maths::CSpecialFunctions::gammaCdf(shape.data(), scale.data(), y.data(),
+                                           n, actual.data(), complement);
+        maxError = 0.0;
+        for (std::size_t i = 0u; i < n; ++i) {
+            boost::math::gamma_distribution<> gamma(shape[i], scale[i]);
+            double expected{complement ? boost::math::cdf(boost::math::complement(gamma, y[i]))
+                                       : boost::math::cdf(gamma, y[i])};
+            if (tiny(expected) == false) {
+                maxError = std::max(maxError, error(expected, actual[i]));
+            }
+        }
+        LOG_DEBUG(<< "gamma: complement = " << complement << ", max error = " << maxError);
+        CPPUNIT_ASSERT(maxError < 1e-11);
+    }
+}
+
+void CSpecialFunctionsTest::testInvalidArguments() {
+    // Check that arguments outside the domains give NaN, the boundaries
+    // are handled and that the valid arguments in the same pack are
+    // unaffected.
+
+    double x[]{-1.0, 0.0, 2.0, std::numeric_limits<double>::quiet_NaN(), 3.0};
+    double one[]{1.0, 1.0, 1.0, 1.0, 1.0};
+    double result[5];
+
+    maths::CSpecialFunctions::logGamma(x, 5, result);
+    CPPUNIT_ASSERT(std::isnan(result[0]));
+    CPPUNIT_ASSERT(std::isnan(result[3]));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, result[2], 1e-14);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(std::log(2.0), result[4], 1e-14);
+
+    maths::CSpecialFunctions::incompleteGamma(x, x, 5, result);
+    CPPUNIT_ASSERT(std::isnan(result[0]));
+    CPPUNIT_ASSERT(std::isnan(result[3]));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(boost::math::gamma_p(2.0, 2.0), result[2], 1e-14);
+
+    double probabilities[]{-0.5, 0.0, 1.0, 0.5, 2.0};
+    maths::CSpecialFunctions::incompleteBeta(one, one, probabilities, 5, result);
+    CPPUNIT_ASSERT(std::isnan(result[0]));
+    CPPUNIT_ASSERT_EQUAL(0.0, result[1]);
+    CPPUNIT_ASSERT_EQUAL(1.0, result[2]);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, result[3], 1e-14);
+    CPPUNIT_ASSERT(std::isnan(result[4]));
+
+    maths::CSpecialFunctions::normalCdf(one, x, one, 5, result);
+    CPPUNIT_ASSERT(std::isnan(result[0]));
+    CPPUNIT_ASSERT(std::isnan(result[1]));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, result[2], 1e-14);
+
+    maths::CSpecialFunctions::gammaCdf(one, one, x, 5, result);
+    CPPUNIT_ASSERT_EQUAL(0.0, result[0]);
+    CPPUNIT_ASSERT_EQUAL(0.0, result[1]);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0 - std::exp(-2.0), result[2], 1e-14);
+}
+
+void CSpecialFunctionsTest::testPerformance() {
+    // Compare the time to evaluate the functions with boost::math.
+
+    test::CRandomNumbers rng;
+
+    const std::size_t n{100000};
+
+    TDoubleVec a, b, x;
+    rng.generateUniformSamples(0.5, 100.0, n, a);
+    rng.generateUniformSamples(0.5, 100.0, n, b);
+    rng.generateUniformSamples(0.0, 1.0, n, x);
+    TDoubleVec result(n);
+
+    auto time = [&](const std::string& name, auto vectorised, auto scalar) {
+        core::CStopWatch stopWatch;
+        stopWatch.start();
+        vectorised();
+        std::uint64_t vectorisedTime{stopWatch.stop()};
+        stopWatch.reset();
+        stopWatch.start();
+        double sum{0.0};
+        for (std::size_t i = 0u; i < n; ++i) {
+            sum += scalar(i);
+        }
+        std::uint64_t scalarTime{stopWatch.stop()};
+        LOG_DEBUG(<< name << ": vectorised time = " << vectorisedTime
+                  << "ms, boost time = " << scalarTime << "ms (" << sum << ")");
+    };
+
+    time("logGamma",
+         [&] { maths::CSpecialFunctions::logGamma(a.data(), n, result.data()); },
+         [&](std::size_t i) { return boost::math::lgamma(a[i]); });
+    time("erfc",
+         [&] { maths::CSpecialFunctions::erfc(x.data(), n, result.data()); },
+         [&](std::size_t i) { return boost::math::erfc(x[i]); });
+    time("incompleteBeta",
+         [&] {
+             maths::CSpecialFunctions::incompleteBeta(a.data(), b.data(), x.data(),
+                                                      n, result.data());
+         },
+         [&](std::size_t i) { return boost::math::ibeta(a[i], b[i], x[i]); });
+    time("studentsTCdf",
+         [&] {
+             maths::CSpecialFunctions::studentsTCdf(a.data(), x.data(), n, result.data());
+         },
+         [&](std::size_t i) {
+             return boost::math::cdf(boost::math::students_t(a[i]), x[i]);
+         });
+}
+
+CppUnit::Test* CSpecialFunctionsTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CSpecialFunctionsTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testLogGamma", &CSpecialFunctionsTest::testLogGamma));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testDigamma", &CSpecialFunctionsTest::testDigamma));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testErf", &CSpecialFunctionsTest::testErf));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testIncompleteGamma",
+        &CSpecialFunctionsTest::testIncompleteGamma));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testIncompleteBeta",
+        &CSpecialFunctionsTest::testIncompleteBeta));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testCdfs", &CSpecialFunctionsTest::testCdfs));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testInvalidArguments",
+        &CSpecialFunctionsTest::testInvalidArguments));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpecialFunctionsTest>(
+        "CSpecialFunctionsTest::testPerformance", &CSpecialFunctionsTest::testPerformance));
+
+    return suiteOfTests;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_CSpecialFunctionsTest_h
+#define INCLUDED_CSpecialFunctionsTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CSpecialFunctionsTest : public CppUnit::TestFixture {
+public:
+    void testLogGamma();
+    void testDigamma();
+    void testErf();
+    void testIncompleteGamma();
+    void testIncompleteBeta();
+    void testCdfs();
+    void testInvalidArguments();
+    void testPerformance();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CSpecialFunctionsTest_h
@@ -2099,6 +2099,84 @@ void CTimeSeriesDecompositionTest::testPersist() {
     CPPUNIT_ASSERT_EQUAL(origXml, newXml);
 }
 
+void CTimeSeriesDecompositionTest::testDeflatePeriodicityTestWindows() {
+    // Check that deflating the periodicity test windows uses less memory,
+    // finds the same components and that serialization is idempotent.
+    const double decayRate = 0.01;
+    const core_t::TTime bucketLength = HALF_HOUR;
+
+    TTimeVec times;
+    TDoubleVec trend;
+    for (core_t::TTime time = 0; time < 4 * WEEK + 1; time += HALF_HOUR) {
+        double daily = 15.0 + 10.0 * std::sin(boost::math::double_constants::two_pi *
+                                              static_cast<double>(time) /
+                                              static_cast<double>(DAY));
+        times.push_back(time);
+        trend.push_back(daily);
+    }
+
+    test::CRandomNumbers rng;
+    TDoubleVec noise;
+    rng.generateNormalSamples(20.0, 16.0, times.size(), noise);
+
+    maths::CTimeSeriesDecomposition decomposition(decayRate, bucketLength);
+    maths::CTimeSeriesDecomposition deflatedDecomposition(decayRate, bucketLength);
+    deflatedDecomposition.deflatePeriodicityTestWindows(true);
+
+    for (std::size_t i = 0u; i < times.size(); ++i) {
+        decomposition.addPoint(times[i], trend[i] + noise[i]);
+        deflatedDecomposition.addPoint(times[i], trend[i] + noise[i]);
+        if (decomposition.initialized() == false) {
+            CPPUNIT_ASSERT(deflatedDecomposition.memoryUsage() <=
+                           decomposition.memoryUsage());
+        }
+    }
+
+    LOG_DEBUG(<< "memory = " << decomposition.memoryUsage()
+              << ", deflated memory = " << deflatedDecomposition.memoryUsage());
+    CPPUNIT_ASSERT(deflatedDecomposition.memoryUsage() < decomposition.memoryUsage());
+    CPPUNIT_ASSERT_EQUAL(decomposition.seasonalComponents().size(),
+                         deflatedDecomposition.seasonalComponents().size());
+
+    TMeanAccumulator error;
+    for (core_t::TTime time = times.back(); time < times.back() + DAY; time += HALF_HOUR) {
+        error.add(std::fabs(mean(decomposition.baseline(time, 0.0)) -
+                            mean(deflatedDecomposition.baseline(time, 0.0))));
+    }
+    LOG_DEBUG(<< "mean error = " << maths::CBasicStatistics::mean(error));
+    CPPUNIT_ASSERT(maths::CBasicStatistics::mean(error) < 0.1);
+
+    // Reading the windows doesn't inflate them.
+    std::size_t memory{deflatedDecomposition.memoryUsage()};
+    uint64_t checksum{deflatedDecomposition.checksum()};
+
+    std::string origXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        deflatedDecomposition.acceptPersistInserter(inserter);
+        inserter.toXml(origXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(memory, deflatedDecomposition.memoryUsage());
+    CPPUNIT_ASSERT_EQUAL(checksum, deflatedDecomposition.checksum());
+
+    core::CRapidXmlParser parser;
+    CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+    core::CRapidXmlStateRestoreTraverser traverser(parser);
+
+    maths::CTimeSeriesDecomposition restoredDecomposition(
+        decayRate, bucketLength,
+        maths::CTimeSeriesDecomposition::DEFAULT_COMPONENT_SIZE, traverser);
+    restoredDecomposition.deflatePeriodicityTestWindows(true);
+
+    std::string newXml;
+    {
+        core::CRapidXmlStatePersistInserter inserter("root");
+        restoredDecomposition.acceptPersistInserter(inserter);
+        inserter.toXml(newXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(origXml, newXml);
+}
+
 void CTimeSeriesDecompositionTest::testUpgrade() {
     // Check we can validly upgrade existing state.
 
@@ -2312,6 +2390,9 @@ CppUnit::Test* CTimeSeriesDecompositionTest::suite() {
         "CTimeSeriesDecompositionTest::testSwap", &CTimeSeriesDecompositionTest::testSwap));
     suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesDecompositionTest>(
         "CTimeSeriesDecompositionTest::testPersist", &CTimeSeriesDecompositionTest::testPersist));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesDecompositionTest>(
+        "CTimeSeriesDecompositionTest::testDeflatePeriodicityTestWindows",
+        &CTimeSeriesDecompositionTest::testDeflatePeriodicityTestWindows));
     suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesDecompositionTest>(
         "CTimeSeriesDecompositionTest::testUpgrade", &CTimeSeriesDecompositionTest::testUpgrade));
 
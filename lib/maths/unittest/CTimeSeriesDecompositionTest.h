@@ -30,6 +30,7 @@ public:
     void testConditionOfTrend();
     void testSwap();
     void testPersist();
+    void testDeflatePeriodicityTestWindows();
     void testUpgrade();
 
     static CppUnit::Test* suite();
@@ -26,7 +26,9 @@
 
 #include <test/CRandomNumbers.h>
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <memory>
 
 using namespace ml;
@@ -2013,6 +2015,201 @@ void CTimeSeriesModelTest::testAnomalyModel() {
     }
 }
 
+void CTimeSeriesModelTest::testCompactResidualModel() {
+    // Test that the residual model of a time series without structure
+    // is compacted, that this is preserved by persistence and that the
+    // full model is restored if we detect seasonality.
+
+    core_t::TTime bucketLength{600};
+
+    test::CRandomNumbers rng;
+
+    maths::COneOfNPrior::TPriorPtrVec models{
+        std::make_shared<maths::CNormalMeanPrecConjugate>(univariateNormal()),
+        std::make_shared<maths::CLogNormalMeanPrecConjugate>(univariateLogNormal()),
+        std::make_shared<maths::CMultimodalPrior>(univariateMultimodal())};
+    maths::COneOfNPrior prior{models, maths_t::E_ContinuousData, DECAY_RATE};
+
+    maths::CModelParams compactParams{params(bucketLength)};
+    compactParams.residualModelPrototype(std::make_shared<maths::COneOfNPrior>(prior));
+
+    maths::CTimeSeriesDecomposition trend{24.0 * DECAY_RATE, bucketLength};
+    maths::CUnivariateTimeSeriesModel model{params(bucketLength), 0, trend, prior};
+    maths::CUnivariateTimeSeriesModel compactModel{compactParams, 1, trend, prior};
+
+    TDouble2VecWeightsAryVec weights{maths_t::CUnitWeights::unit<TDouble2Vec>(1)};
+    auto addSamples = [&](const TDoubleVec& samples, core_t::TTime& time) {
+        for (auto sample : samples) {
+            maths::CModelAddSamplesParams params;
+            params.integer(false).propagationInterval(1.0).trendWeights(weights).priorWeights(weights);
+            model.addSamples(params, {core::make_triple(time, TDouble2Vec{sample}, TAG)});
+            compactModel.addSamples(
+                params, {core::make_triple(time, TDouble2Vec{sample}, TAG)});
+            time += bucketLength;
+        }
+    };
+
+    core_t::TTime time{0};
+
+    LOG_DEBUG(<< "No structure");
+    {
+        TDoubleVec samples;
+        rng.generateNormalSamples(10.0, 4.0, 1000, samples);
+        addSamples(samples, time);
+
+        const auto& residualModel =
+            dynamic_cast<const maths::COneOfNPrior&>(compactModel.prior());
+        LOG_DEBUG(<< "models = " << residualModel.models().size()
+                  << ", memory = " << model.memoryUsage()
+                  << ", compact memory = " << compactModel.memoryUsage());
+        CPPUNIT_ASSERT(compactModel.isResidualModelCompact());
+        CPPUNIT_ASSERT(model.isResidualModelCompact() == false);
+        CPPUNIT_ASSERT(residualModel.models().size() < 3);
+        CPPUNIT_ASSERT(compactModel.memoryUsage() < model.memoryUsage());
+    }
+
+    LOG_DEBUG(<< "Persist");
+    {
+        std::string origXml;
+        {
+            ml::core::CRapidXmlStatePersistInserter inserter{"root"};
+            compactModel.acceptPersistInserter(inserter);
+            inserter.toXml(origXml);
+        }
+
+        core::CRapidXmlParser parser;
+        CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+        core::CRapidXmlStateRestoreTraverser traverser(parser);
+
+        maths::STimeSeriesDecompositionRestoreParams decompositionParams{
+            24.0 * DECAY_RATE, bucketLength,
+            maths::CTimeSeriesDecomposition::DEFAULT_COMPONENT_SIZE};
+        maths::SDistributionRestoreParams distributionParams{
+            maths_t::E_ContinuousData, DECAY_RATE, 0.5, 24.0, 12};
+        maths::SModelRestoreParams restoreParams{compactParams, decompositionParams,
+                                                 distributionParams};
+        maths::CUnivariateTimeSeriesModel restoredModel{restoreParams, traverser};
+
+        CPPUNIT_ASSERT(restoredModel.isResidualModelCompact());
+        CPPUNIT_ASSERT_EQUAL(compactModel.checksum(), restoredModel.checksum());
+    }
+
+    LOG_DEBUG(<< "Daily seasonality");
+    {
+        TDoubleVec samples;
+        rng.generateNormalSamples(0.0, 1.0, 2000, samples);
+        core_t::TTime sampleTime{time};
+        for (auto& sample : samples) {
+            sample += 10.0 + 5.0 * std::sin(boost::math::double_constants::two_pi *
+                                            static_cast<double>(sampleTime) / 86400.0);
+            sampleTime += bucketLength;
+        }
+        addSamples(samples, time);
+
+        const auto& residualModel =
+            dynamic_cast<const maths::COneOfNPrior&>(compactModel.prior());
+        LOG_DEBUG(<< "models = " << residualModel.models().size());
+        CPPUNIT_ASSERT(compactModel.isResidualModelCompact() == false);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), residualModel.models().size());
+    }
+}
+
+void CTimeSeriesModelTest::testPruneResidualModelSelection() {
+    // Test that pruning the residual model only removes distributions with
+    // negligible weight, so the remaining distributions are selected with
+    // the same relative weights and the probabilities we compute for new
+    // values are unchanged to the accuracy with which we calculate them.
+
+    core_t::TTime bucketLength{600};
+
+    test::CRandomNumbers rng;
+
+    maths::COneOfNPrior::TPriorPtrVec models{
+        std::make_shared<maths::CNormalMeanPrecConjugate>(univariateNormal()),
+        std::make_shared<maths::CLogNormalMeanPrecConjugate>(univariateLogNormal()),
+        std::make_shared<maths::CMultimodalPrior>(univariateMultimodal())};
+    maths::COneOfNPrior prior{models, maths_t::E_ContinuousData, DECAY_RATE};
+
+    maths::CModelParams prunedParams{params(bucketLength)};
+    prunedParams.residualModelPrototype(std::make_shared<maths::COneOfNPrior>(prior));
+
+    maths::CTimeSeriesDecomposition trend{24.0 * DECAY_RATE, bucketLength};
+    maths::CUnivariateTimeSeriesModel model{params(bucketLength), 0, trend, prior};
+    maths::CUnivariateTimeSeriesModel prunedModel{prunedParams, 1, trend, prior};
+
+    TDoubleVec samples;
+    rng.generateLogNormalSamples(2.0, 1.0, 1000, samples);
+
+    TDouble2VecWeightsAryVec weights{maths_t::CUnitWeights::unit<TDouble2Vec>(1)};
+    core_t::TTime time{0};
+    for (auto sample : samples) {
+        maths::CModelAddSamplesParams params;
+        params.integer(false).propagationInterval(1.0).trendWeights(weights).priorWeights(weights);
+        model.addSamples(params, {core::make_triple(time, TDouble2Vec{sample}, TAG)});
+        prunedModel.addSamples(params, {core::make_triple(time, TDouble2Vec{sample}, TAG)});
+        time += bucketLength;
+    }
+
+    const auto& residualModel = dynamic_cast<const maths::COneOfNPrior&>(model.prior());
+    const auto& prunedResidualModel =
+        dynamic_cast<const maths::COneOfNPrior&>(prunedModel.prior());
+
+    TDoubleVec residualWeights(residualModel.weights());
+    TDoubleVec prunedResidualWeights(prunedResidualModel.weights());
+    LOG_DEBUG(<< "weights = " << core::CContainerPrinter::print(residualWeights));
+    LOG_DEBUG(<< "pruned weights = " << core::CContainerPrinter::print(prunedResidualWeights));
+
+    CPPUNIT_ASSERT(model.isResidualModelCompact() == false);
+    CPPUNIT_ASSERT(prunedModel.isResidualModelCompact());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), residualWeights.size());
+    CPPUNIT_ASSERT(prunedResidualWeights.size() < residualWeights.size());
+
+    // The same distribution is selected and the remaining distributions'
+    // weights are those of the full model renormalized.
+    auto type = [](const maths::COneOfNPrior& prior, std::size_t i) {
+        return prior.models()[i]->type();
+    };
+    std::size_t selected = static_cast<std::size_t>(
+        std::max_element(residualWeights.begin(), residualWeights.end()) -
+        residualWeights.begin());
+    std::size_t prunedSelected = static_cast<std::size_t>(
+        std::max_element(prunedResidualWeights.begin(), prunedResidualWeights.end()) -
+        prunedResidualWeights.begin());
+    CPPUNIT_ASSERT_EQUAL(type(residualModel, selected), type(prunedResidualModel, prunedSelected));
+
+    double Z{0.0};
+    for (std::size_t i = 0u; i < residualWeights.size(); ++i) {
+        for (std::size_t j = 0u; j < prunedResidualWeights.size(); ++j) {
+            if (type(residualModel, i) == type(prunedResidualModel, j)) {
+                Z += residualWeights[i];
+            }
+        }
+    }
+    CPPUNIT_ASSERT(Z > 1.0 - 3e-3);
+    for (std::size_t i = 0u; i < residualWeights.size(); ++i) {
+        for (std::size_t j = 0u; j < prunedResidualWeights.size(); ++j) {
+            if (type(residualModel, i) == type(prunedResidualModel, j)) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(residualWeights[i] / Z,
+                                             prunedResidualWeights[j], 1e-6);
+            }
+        }
+    }
+
+    // The pruned distributions contribute negligibly to the probabilities.
+    rng.generateLogNormalSamples(2.0, 1.0, 100, samples);
+    TDoubleWeightsAry1Vec unit{maths_t::CUnitWeights::UNIT};
+    for (auto sample : samples) {
+        double lb, ub, prunedLb, prunedUb;
+        maths_t::ETail tail;
+        CPPUNIT_ASSERT(residualModel.probabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, {sample}, unit, lb, ub, tail));
+        CPPUNIT_ASSERT(prunedResidualModel.probabilityOfLessLikelySamples(
+            maths_t::E_TwoSided, {sample}, unit, prunedLb, prunedUb, tail));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL((lb + ub) / 2.0, (prunedLb + prunedUb) / 2.0,
+                                     5e-3 * (lb + ub) / 2.0);
+    }
+}
+
 CppUnit::Test* CTimeSeriesModelTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CTimeSeriesModelTest");
 
@@ -2044,6 +2241,12 @@ CppUnit::Test* CTimeSeriesModelTest::suite() {
         &CTimeSeriesModelTest::testProbabilityWithCorrelations));
     suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesModelTest>(
         "CTimeSeriesModelTest::testAnomalyModel", &CTimeSeriesModelTest::testAnomalyModel));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesModelTest>(
+        "CTimeSeriesModelTest::testCompactResidualModel",
+        &CTimeSeriesModelTest::testCompactResidualModel));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesModelTest>(
+        "CTimeSeriesModelTest::testPruneResidualModelSelection",
+        &CTimeSeriesModelTest::testPruneResidualModelSelection));
 
     return suiteOfTests;
 }
@@ -24,6 +24,8 @@ public:
     void testAddSamplesWithCorrelations();
     void testProbabilityWithCorrelations();
     void testAnomalyModel();
+    void testCompactResidualModel();
+    void testPruneResidualModelSelection();
 
     static CppUnit::Test* suite();
 };
@@ -53,6 +53,7 @@
 #include "CPRNGTest.h"
 #include "CPackedBitVectorTest.h"
 #include "CPeriodicityHypothesisTestsTest.h"
+#include "CPeriodicityTestSchedulerTest.h"
 #include "CPoissonMeanConjugateTest.h"
 #include "CPriorTest.h"
 #include "CProbabilityAggregatorsTest.h"
@@ -67,6 +68,7 @@
 #include "CSeasonalComponentTest.h"
 #include "CSetToolsTest.h"
 #include "CSignalTest.h"
+#include "CSpecialFunctionsTest.h"
 #include "CSolversTest.h"
 #include "CSplineTest.h"
 #include "CStatisticalTestsTest.h"
@@ -128,6 +130,7 @@ int main(int argc, const char** argv) {
     runner.addTest(COrdinalTest::suite());
     runner.addTest(CPackedBitVectorTest::suite());
     runner.addTest(CPeriodicityHypothesisTestsTest::suite());
+    runner.addTest(CPeriodicityTestSchedulerTest::suite());
     runner.addTest(CPoissonMeanConjugateTest::suite());
     runner.addTest(CPriorTest::suite());
     runner.addTest(CPRNGTest::suite());
@@ -143,6 +146,7 @@ int main(int argc, const char** argv) {
     runner.addTest(CSeasonalComponentAdaptiveBucketingTest::suite());
     runner.addTest(CSetToolsTest::suite());
     runner.addTest(CSignalTest::suite());
+    runner.addTest(CSpecialFunctionsTest::suite());
     runner.addTest(CSolversTest::suite());
     runner.addTest(CSplineTest::suite());
     runner.addTest(CStatisticalTestsTest::suite());
@@ -102,7 +102,8 @@ CAnomalyDetector::CAnomalyDetector(int detectorIndex,
       m_LastBucketEndTime(maths::CIntegerTools::ceil(firstTime, modelConfig.bucketLength())),
       m_DataGatherer(makeDataGatherer(modelFactory, m_LastBucketEndTime, partitionFieldValue)),
       m_ModelFactory(modelFactory),
-      m_Model(makeModel(modelFactory, m_DataGatherer)), m_IsForPersistence(false) {
+      m_Model(makeModel(modelFactory, m_DataGatherer)), m_IsForPersistence(false),
+      m_NumberRecords(0) {
     if (m_DataGatherer == nullptr) {
         LOG_ABORT(<< "Failed to construct data gatherer for detector: "
                   << this->description());
@@ -128,7 +129,7 @@ CAnomalyDetector::CAnomalyDetector(bool isForPersistence, const CAnomalyDetector
       m_ModelFactory(other.m_ModelFactory), // Shallow copy of model factory is OK
       m_Model(other.m_Model->cloneForPersistence()),
       // Empty message propagation function is fine in this case
-      m_IsForPersistence(isForPersistence) {
+      m_IsForPersistence(isForPersistence), m_NumberRecords(other.m_NumberRecords) {
     if (!isForPersistence) {
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
@@ -167,8 +168,8 @@ void CAnomalyDetector::zeroModelsToTime(core_t::TTime time) {
                   << "', bucketStartTime = " << bucketStartTime
                   << ", m_LastBucketEndTime = " << m_LastBucketEndTime);
 
-        // Update the statistical models.
-        m_Model->sample(bucketStartTime, m_LastBucketEndTime, m_Limits.resourceMonitor());
+        // Update the statistical models as buildResults() does.
+        this->sample(bucketStartTime, m_LastBucketEndTime, m_Limits.resourceMonitor());
     }
 }
 
@@ -357,12 +358,24 @@ const CAnomalyDetector::TStrVec& CAnomalyDetector::fieldsOfInterest() const {
 }
 
 void CAnomalyDetector::addRecord(core_t::TTime time, const TStrCPtrVec& fieldValues) {
+    this->addRecord(time, fieldValues, TDoubleCPtrVec());
+}
+
+void CAnomalyDetector::addRecord(core_t::TTime time,
+                                 const TStrCPtrVec& fieldValues,
+                                 const TDoubleCPtrVec& numericValues) {
     const TStrCPtrVec& processedFieldValues = this->preprocessFieldValues(fieldValues);
 
     CEventData eventData;
     eventData.time(time);
 
-    m_DataGatherer->addArrival(processedFieldValues, eventData, m_Limits.resourceMonitor());
+    m_DataGatherer->addArrival(processedFieldValues, numericValues, eventData,
+                               m_Limits.resourceMonitor());
+    ++m_NumberRecords;
+}
+
+uint64_t CAnomalyDetector::numberRecords() const {
+    return m_NumberRecords;
 }
 
 const CAnomalyDetector::TStrCPtrVec&
@@ -598,6 +611,14 @@ std::size_t CAnomalyDetector::memoryUsage() const {
     return mem;
 }
 
+std::size_t CAnomalyDetector::pendingMemoryUsage() {
+    return m_Model->pendingMemoryUsage();
+}
+
+uint64_t CAnomalyDetector::checksum() const {
+    return m_Model->checksum(true);
+}
+
 const core_t::TTime& CAnomalyDetector::lastBucketEndTime() const {
     return m_LastBucketEndTime;
 }
@@ -9,6 +9,7 @@
 #include <core/CAllocationStrategy.h>
 #include <core/CFunctional.h>
 #include <core/CLogger.h>
+#include <core/CMemory.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/CStatistics.h>
@@ -342,6 +343,16 @@ std::size_t CAnomalyDetectorModel::memoryUsage() const {
     return mem;
 }
 
+std::size_t CAnomalyDetectorModel::walkMemoryUsage() const {
+    core::CMemoryUsage mem;
+    this->debugMemoryUsage(mem.addChild());
+    return this->staticSize() + mem.usage();
+}
+
+std::size_t CAnomalyDetectorModel::pendingMemoryUsage() {
+    return 0;
+}
+
 CAnomalyDetectorModel::TOptionalSize
 CAnomalyDetectorModel::estimateMemoryUsage(std::size_t numberPeople,
                                            std::size_t numberAttributes,
@@ -512,13 +523,32 @@ maths::CModel* CAnomalyDetectorModel::tinyModel() {
     return new maths::CModelStub;
 }
 
+std::size_t CAnomalyDetectorModel::pendingMemoryUsage(const TFeatureModelsVec& models,
+                                                      std::size_t numberModels,
+                                                      std::size_t numberRecycled) {
+    std::size_t result{0};
+    for (const auto& feature : models) {
+        std::size_t numberPending{numberRecycled};
+        if (numberModels > feature.s_Models.size()) {
+            numberPending += numberModels - feature.s_Models.size();
+        }
+        // Each new model also takes a slot in the models' vector.
+        result += numberPending * (feature.s_NewModelMemoryUsage + sizeof(TMathsModelPtr));
+    }
+    return result;
+}
+
 const std::size_t CAnomalyDetectorModel::MAXIMUM_PERMITTED_AGE(1000000);
 const core_t::TTime CAnomalyDetectorModel::TIME_UNSET(-1);
 const std::string CAnomalyDetectorModel::EMPTY_STRING;
 
 CAnomalyDetectorModel::SFeatureModels::SFeatureModels(model_t::EFeature feature,
                                                       TMathsModelPtr newModel)
-    : s_Feature(feature), s_NewModel(newModel) {
+    : s_Feature(feature), s_NewModel(newModel),
+      s_NewModelMemoryUsage(newModel != nullptr
+                                ? core::CMemory::staticSize(*newModel) +
+                                      core::CMemory::dynamicSize(*newModel)
+                                : 0) {
 }
 
 bool CAnomalyDetectorModel::SFeatureModels::acceptRestoreTraverser(const SModelParams& params_,
@@ -529,7 +559,8 @@ bool CAnomalyDetectorModel::SFeatureModels::acceptRestoreTraverser(const SModelP
         maths::STimeSeriesDecompositionRestoreParams{
             CAnomalyDetectorModelConfig::trendDecayRate(params_.s_DecayRate,
                                                         params_.s_BucketLength),
-            params_.s_BucketLength, params_.s_ComponentSize},
+            params_.s_BucketLength, params_.s_ComponentSize,
+            params_.s_PeriodicityTestScheduler, params_.s_CompactModels},
         params_.distributionRestoreParams(dataType)};
     do {
         if (traverser.name() == MODEL_TAG) {
@@ -167,7 +167,8 @@ CAnomalyDetectorModelConfig::CAnomalyDetectorModelConfig()
       m_NoiseMultiplier(DEFAULT_NOISE_MULTIPLIER),
       m_NormalizedScoreKnotPoints(boost::begin(DEFAULT_NORMALIZED_SCORE_KNOT_POINTS),
                                   boost::end(DEFAULT_NORMALIZED_SCORE_KNOT_POINTS)),
-      m_PerPartitionNormalisation(false), m_DetectionRules(EMPTY_RULES_MAP),
+      m_PerPartitionNormalisation(false), m_NormalizerLookupTables(false),
+      m_DetectionRules(EMPTY_RULES_MAP),
       m_ScheduledEvents(EMPTY_EVENTS) {
     for (std::size_t i = 0u; i < model_t::NUMBER_AGGREGATION_STYLES; ++i) {
         for (std::size_t j = 0u; j < model_t::NUMBER_AGGREGATION_PARAMS; ++j) {
@@ -649,6 +650,12 @@ void CAnomalyDetectorModelConfig::decayRate(double value) {
     }
 }
 
+void CAnomalyDetectorModelConfig::periodicityTestScheduler(maths::CPeriodicityTestScheduler* scheduler) {
+    for (auto& factory : m_Factories) {
+        factory.second->periodicityTestScheduler(scheduler);
+    }
+}
+
 double CAnomalyDetectorModelConfig::decayRate() const {
     return m_Factories.begin()->second->modelParams().s_DecayRate;
 }
@@ -723,6 +730,14 @@ void CAnomalyDetectorModelConfig::perPartitionNormalization(bool value) {
     m_PerPartitionNormalisation = value;
 }
 
+bool CAnomalyDetectorModelConfig::normalizerLookupTables() const {
+    return m_NormalizerLookupTables;
+}
+
+void CAnomalyDetectorModelConfig::normalizerLookupTables(bool value) {
+    m_NormalizerLookupTables = value;
+}
+
 void CAnomalyDetectorModelConfig::detectionRules(TIntDetectionRuleVecUMapCRef detectionRules) {
     m_DetectionRules = detectionRules;
 }
@@ -745,6 +760,8 @@ const std::string INDIVIDUAL_MODE_FRACTION_PROPERTY("individualmodefraction");
 const std::string POPULATION_MODE_FRACTION_PROPERTY("populationmodefraction");
 const std::string PEERS_MODE_FRACTION_PROPERTY("peersmodefraction");
 const std::string COMPONENT_SIZE_PROPERTY("componentsize");
+const std::string COMPACT_MODELS_PROPERTY("compactmodels");
+const std::string PRUNE_RESIDUAL_MODELS_PROPERTY("pruneresidualmodels");
 const std::string SAMPLE_COUNT_FACTOR_PROPERTY("samplecountfactor");
 const std::string PRUNE_WINDOW_SCALE_MINIMUM("prunewindowscaleminimum");
 const std::string PRUNE_WINDOW_SCALE_MAXIMUM("prunewindowscalemaximum");
@@ -878,6 +895,26 @@ bool CAnomalyDetectorModelConfig::processStanza(const boost::property_tree::ptre
             for (auto& factory : m_Factories) {
                 factory.second->componentSize(componentSize);
             }
+        } else if (propName == COMPACT_MODELS_PROPERTY) {
+            bool compact;
+            if (core::CStringUtils::stringToType(propValue, compact) == false) {
+                LOG_ERROR(<< "Invalid value for property " << propName << " : " << propValue);
+                result = false;
+                continue;
+            }
+            for (auto& factory : m_Factories) {
+                factory.second->compactModels(compact);
+            }
+        } else if (propName == PRUNE_RESIDUAL_MODELS_PROPERTY) {
+            bool prune;
+            if (core::CStringUtils::stringToType(propValue, prune) == false) {
+                LOG_ERROR(<< "Invalid value for property " << propName << " : " << propValue);
+                result = false;
+                continue;
+            }
+            for (auto& factory : m_Factories) {
+                factory.second->pruneResidualModels(prune);
+            }
         } else if (propName == SAMPLE_COUNT_FACTOR_PROPERTY) {
             int factor;
             if (core::CStringUtils::stringToType(propValue, factor) == false || factor < 0) {
@@ -250,7 +250,8 @@ CAnomalyScore::CNormalizer::CNormalizer(const CAnomalyDetectorModelConfig& confi
                   std::max(static_cast<double>(config.bucketLength()) /
                                static_cast<double>(CAnomalyDetectorModelConfig::STANDARD_BUCKET_LENGTH),
                            1.0)),
-      m_TimeToQuantileDecay(QUANTILE_DECAY_TIME) {
+      m_TimeToQuantileDecay(QUANTILE_DECAY_TIME),
+      m_UseLookupTable(config.normalizerLookupTables()), m_LookupTableValid(false) {
 }
 
 bool CAnomalyScore::CNormalizer::canNormalize() const {
@@ -292,8 +293,6 @@ bool CAnomalyScore::CNormalizer::normalize(double& score) const {
 
     LOG_TRACE(<< "Normalising " << score);
 
-    static const double CONFIDENCE_INTERVAL = 70.0;
-
     double normalizedScores[] = {m_MaximumNormalizedScore, m_MaximumNormalizedScore,
                                  m_MaximumNormalizedScore, m_MaximumNormalizedScore};
 
@@ -324,37 +323,94 @@ bool CAnomalyScore::CNormalizer::normalize(double& score) const {
     // we cap the maximum score such that probabilities near the
     // cutoff don't generate large normalized scores.
 
-    // Compute the noise ceiling. Note that since the scores are
-    // logarithms (base e) the difference corresponds to the scaled,
-    // 10 / log(10), signal strength in dB. By default a signal of
-    // 75dB corresponds to a normalized score of 75. Note that if
-    // the noise percentile is zero then really it is unknown,
-    // since scores are truncated to zero. In this case we don't
-    // want this term to constrain the normalized score. However,
-    // we also want this term to be smooth, i.e. the score should
+    // The first two ceilings depend on the quantiles, so they can
+    // be looked up.
+    if (m_UseLookupTable) {
+        const SLookupTable& table = this->lookupTable();
+        normalizedScores[0] = this->noiseCeiling(table.s_NoiseCeiling, discreteScore);
+        std::size_t interval = std::upper_bound(table.s_Breakpoints.begin(),
+                                                table.s_Breakpoints.end(), discreteScore) -
+                               table.s_Breakpoints.begin();
+        normalizedScores[1] = table.s_PercentileCeilings[interval - 1];
+    } else {
+        normalizedScores[0] =
+            this->noiseCeiling(this->noiseCeilingParameters(), discreteScore);
+        normalizedScores[1] = this->percentileCeiling(discreteScore);
+    }
+
+    // Compute the maximum score ceiling.
+    double ratio = score / m_MaxScore[0];
+    double curves[] = {0.0 + 1.5 * ratio, 0.5 + 0.5 * ratio};
+    normalizedScores[2] = m_MaximumNormalizedScore *
+                          (*std::min_element(curves, curves + 2));
+    LOG_TRACE(<< "normalizedScores[2] = " << normalizedScores[2]
+              << ", score = " << score << ", maxScore = " << m_MaxScore[0]);
+
+    // Logarithmically interpolate the maximum score between the
+    // largest significant and small probability.
+    static const double M = (probabilityToScore(maths::SMALL_PROBABILITY) -
+                             probabilityToScore(maths::LARGEST_SIGNIFICANT_PROBABILITY)) /
+                            (std::log(maths::SMALL_PROBABILITY) -
+                             std::log(maths::LARGEST_SIGNIFICANT_PROBABILITY));
+    static const double C = std::log(maths::LARGEST_SIGNIFICANT_PROBABILITY);
+    normalizedScores[3] = m_MaximumNormalizedScore *
+                          (0.95 * M * (std::log(scoreToProbability(score)) - C) + 0.05);
+    LOG_TRACE(<< "normalizedScores[3] = " << normalizedScores[3] << ", score = " << score
+              << ", probability = " << scoreToProbability(score));
+
+    score = std::min(*std::min_element(boost::begin(normalizedScores),
+                                       boost::end(normalizedScores)),
+                     m_MaximumNormalizedScore);
+    LOG_TRACE(<< "normalizedScore = " << score);
+
+    return true;
+}
+
+CAnomalyScore::CNormalizer::SNoiseCeilingParameters
+CAnomalyScore::CNormalizer::noiseCeilingParameters() const {
+    // Note that if the noise percentile is zero then really it is
+    // unknown, since scores are truncated to zero. In this case we
+    // don't want the noise ceiling to constrain the normalized score.
+    // However, we also want it to be smooth, i.e. the score should
     // be nearly continuous when F(0) = pn. Here, F(.) denotes the
     // c.d.f. of the score and pn the noise percentile. We achieve
     // this by adding "max score" * min(F(0) / "noise percentile",
     // to the score.
-    uint32_t noiseScore;
-    m_RawScoreQuantileSummary.quantile(m_NoisePercentile / 100.0, noiseScore);
+    SNoiseCeilingParameters result;
+    m_RawScoreQuantileSummary.quantile(m_NoisePercentile / 100.0, result.s_NoiseScore);
     TDoubleDoublePrVecCItr knotPoint = std::lower_bound(
         m_NormalizedScoreKnotPoints.begin(), m_NormalizedScoreKnotPoints.end(),
         TDoubleDoublePr(m_NoisePercentile, 0.0));
-    double signalStrength =
-        m_NoiseMultiplier * 10.0 / DISCRETIZATION_FACTOR *
-        (static_cast<double>(discreteScore) - static_cast<double>(noiseScore));
+    result.s_KnotPointScore = knotPoint->second;
     double l0;
     double u0;
     m_RawScoreQuantileSummary.cdf(0, 0.0, l0, u0);
-    normalizedScores[0] =
-        knotPoint->second * std::max(1.0 + signalStrength, 0.0) +
+    result.s_ZeroScoreCeiling =
         m_MaximumNormalizedScore *
-            std::max(2.0 * std::min(50.0 * (l0 + u0) / m_NoisePercentile, 1.0) - 1.0, 0.0);
-    LOG_TRACE(<< "normalizedScores[0] = " << normalizedScores[0]
-              << ", knotPoint = " << knotPoint->second << ", discreteScore = " << discreteScore
-              << ", noiseScore = " << noiseScore << ", l(0) = " << l0
-              << ", u(0) = " << u0 << ", signalStrength = " << signalStrength);
+        std::max(2.0 * std::min(50.0 * (l0 + u0) / m_NoisePercentile, 1.0) - 1.0, 0.0);
+    LOG_TRACE(<< "knotPoint = " << result.s_KnotPointScore << ", noiseScore = "
+              << result.s_NoiseScore << ", l(0) = " << l0 << ", u(0) = " << u0);
+    return result;
+}
+
+double CAnomalyScore::CNormalizer::noiseCeiling(const SNoiseCeilingParameters& parameters,
+                                                uint32_t discreteScore) const {
+    // Note that since the scores are logarithms (base e) the
+    // difference corresponds to the scaled, 10 / log(10), signal
+    // strength in dB. By default a signal of 75dB corresponds to
+    // a normalized score of 75.
+    double signalStrength = m_NoiseMultiplier * 10.0 / DISCRETIZATION_FACTOR *
+                            (static_cast<double>(discreteScore) -
+                             static_cast<double>(parameters.s_NoiseScore));
+    double result = parameters.s_KnotPointScore * std::max(1.0 + signalStrength, 0.0) +
+                    parameters.s_ZeroScoreCeiling;
+    LOG_TRACE(<< "normalizedScores[0] = " << result << ", discreteScore = "
+              << discreteScore << ", signalStrength = " << signalStrength);
+    return result;
+}
+
+double CAnomalyScore::CNormalizer::percentileCeiling(uint32_t discreteScore) const {
+    static const double CONFIDENCE_INTERVAL = 70.0;
 
     // Compute the raw normalized score. Note we compute the probability
     // of seeing a lower score on the normal bucket length and convert
@@ -363,7 +419,7 @@ bool CAnomalyScore::CNormalizer::normalize(double& score) const {
     // which is P^n where P is the quantile expressed as a probability.
     double lowerBound;
     double upperBound;
-    this->quantile(score, CONFIDENCE_INTERVAL, lowerBound, upperBound);
+    this->discreteQuantile(discreteScore, CONFIDENCE_INTERVAL, lowerBound, upperBound);
     double lowerPercentile = 100.0 * std::pow(lowerBound, 1.0 / m_BucketNormalizationFactor);
     double upperPercentile = 100.0 * std::pow(upperBound, 1.0 / m_BucketNormalizationFactor);
     if (lowerPercentile > upperPercentile) {
@@ -384,64 +440,87 @@ bool CAnomalyScore::CNormalizer::normalize(double& score) const {
                                   maths::COrderings::SFirstLess()) -
                      m_NormalizedScoreKnotPoints.begin(),
                  ptrdiff_t(1));
+    double result;
     if (lowerKnotPoint < m_NormalizedScoreKnotPoints.size()) {
         const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[lowerKnotPoint - 1];
         const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[lowerKnotPoint];
         // Linearly interpolate between the two knot points.
-        normalizedScores[1] = left.second + (right.second - left.second) *
-                                                (lowerPercentile - left.first) /
-                                                (right.first - left.first);
+        result = left.second + (right.second - left.second) *
+                                   (lowerPercentile - left.first) /
+                                   (right.first - left.first);
     } else {
-        normalizedScores[1] = m_MaximumNormalizedScore;
+        result = m_MaximumNormalizedScore;
     }
     if (upperKnotPoint < m_NormalizedScoreKnotPoints.size()) {
         const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[upperKnotPoint - 1];
         const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[upperKnotPoint];
         // Linearly interpolate between the two knot points.
-        normalizedScores[1] = (normalizedScores[1] + left.second +
-                               (right.second - left.second) * (upperPercentile - left.first) /
-                                   (right.first - left.first)) /
-                              2.0;
+        result = (result + left.second +
+                  (right.second - left.second) * (upperPercentile - left.first) /
+                      (right.first - left.first)) /
+                 2.0;
     } else {
-        normalizedScores[1] = (normalizedScores[1] + m_MaximumNormalizedScore) / 2.0;
+        result = (result + m_MaximumNormalizedScore) / 2.0;
     }
-    LOG_TRACE(<< "normalizedScores[1] = " << normalizedScores[1] << ", lowerBound = " << lowerBound
+    LOG_TRACE(<< "normalizedScores[1] = " << result << ", lowerBound = " << lowerBound
               << ", upperBound = " << upperBound << ", lowerPercentile = " << lowerPercentile
               << ", upperPercentile = " << upperPercentile);
 
-    // Compute the maximum score ceiling.
-    double ratio = score / m_MaxScore[0];
-    double curves[] = {0.0 + 1.5 * ratio, 0.5 + 0.5 * ratio};
-    normalizedScores[2] = m_MaximumNormalizedScore *
-                          (*std::min_element(curves, curves + 2));
-    LOG_TRACE(<< "normalizedScores[2] = " << normalizedScores[2]
-              << ", score = " << score << ", maxScore = " << m_MaxScore[0]);
+    return result;
+}
 
-    // Logarithmically interpolate the maximum score between the
-    // largest significant and small probability.
-    static const double M = (probabilityToScore(maths::SMALL_PROBABILITY) -
-                             probabilityToScore(maths::LARGEST_SIGNIFICANT_PROBABILITY)) /
-                            (std::log(maths::SMALL_PROBABILITY) -
-                             std::log(maths::LARGEST_SIGNIFICANT_PROBABILITY));
-    static const double C = std::log(maths::LARGEST_SIGNIFICANT_PROBABILITY);
-    normalizedScores[3] = m_MaximumNormalizedScore *
-                          (0.95 * M * (std::log(scoreToProbability(score)) - C) + 0.05);
-    LOG_TRACE(<< "normalizedScores[3] = " << normalizedScores[3] << ", score = " << score
-              << ", probability = " << scoreToProbability(score));
+const CAnomalyScore::CNormalizer::SLookupTable& CAnomalyScore::CNormalizer::lookupTable() const {
+    if (m_LookupTableValid.load(std::memory_order_acquire)) {
+        return m_LookupTable;
+    }
 
-    score = std::min(*std::min_element(boost::begin(normalizedScores),
-                                       boost::end(normalizedScores)),
-                     m_MaximumNormalizedScore);
-    LOG_TRACE(<< "normalizedScore = " << score);
+    std::lock_guard<std::mutex> lock(m_LookupTableMutex);
+    if (m_LookupTableValid.load(std::memory_order_relaxed)) {
+        return m_LookupTable;
+    }
 
-    return true;
+    // The percentile ceiling only depends on the discrete score via
+    // the q-digests' c.d.f. and p.d.f. bounds and which q-digest is
+    // used, so it is constant between the breakpoints of these.
+    TUInt32Vec& breakpoints = m_LookupTable.s_Breakpoints;
+    TUInt32Vec highBreakpoints;
+    m_RawScoreQuantileSummary.cdfBreakpoints(breakpoints);
+    m_RawScoreHighQuantileSummary.cdfBreakpoints(highBreakpoints);
+    breakpoints.insert(breakpoints.end(), highBreakpoints.begin(), highBreakpoints.end());
+    if (m_HighPercentileScore < std::numeric_limits<uint32_t>::max()) {
+        breakpoints.push_back(m_HighPercentileScore + 1);
+    }
+    std::sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+
+    m_LookupTable.s_NoiseCeiling = this->noiseCeilingParameters();
+    m_LookupTable.s_PercentileCeilings.clear();
+    m_LookupTable.s_PercentileCeilings.reserve(breakpoints.size());
+    for (auto breakpoint : breakpoints) {
+        m_LookupTable.s_PercentileCeilings.push_back(this->percentileCeiling(breakpoint));
+    }
+    LOG_TRACE(<< "Rebuilt lookup table with " << breakpoints.size() << " breakpoints");
+
+    m_LookupTableValid.store(true, std::memory_order_release);
+
+    return m_LookupTable;
+}
+
+void CAnomalyScore::CNormalizer::invalidateLookupTable() {
+    m_LookupTableValid.store(false, std::memory_order_release);
 }
 
 void CAnomalyScore::CNormalizer::quantile(double score,
                                           double confidence,
                                           double& lowerBound,
                                           double& upperBound) const {
-    uint32_t discreteScore = this->discreteScore(score);
+    this->discreteQuantile(this->discreteScore(score), confidence, lowerBound, upperBound);
+}
+
+void CAnomalyScore::CNormalizer::discreteQuantile(uint32_t discreteScore,
+                                                  double confidence,
+                                                  double& lowerBound,
+                                                  double& upperBound) const {
     double n = static_cast<double>(m_RawScoreQuantileSummary.n());
     double lowerQuantile = (100.0 - confidence) / 200.0;
     double upperQuantile = (100.0 + confidence) / 200.0;
@@ -464,14 +543,15 @@ void CAnomalyScore::CNormalizer::quantile(double score,
         upperBound = maths::CTools::truncate(upperBound - pdfLowerBound, 0.0, fu);
         if (!(lowerBound >= 0.0 && lowerBound <= 1.0) ||
             !(upperBound >= 0.0 && upperBound <= 1.0)) {
-            LOG_ERROR(<< "score = " << score << ", cdf = [" << lowerBound << ","
+            LOG_ERROR(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound << ","
                       << upperBound << "]"
                       << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]");
         }
         lowerBound = maths::CQDigest::cdfQuantile(n, lowerBound, lowerQuantile);
         upperBound = maths::CQDigest::cdfQuantile(n, upperBound, upperQuantile);
 
-        LOG_TRACE(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+        LOG_TRACE(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound << ","
+                  << upperBound << "]"
                   << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]");
 
         return;
@@ -503,7 +583,8 @@ void CAnomalyScore::CNormalizer::quantile(double score,
                                    std::numeric_limits<double>::epsilon());
     if (!(lowerBound >= 0.0 && lowerBound <= 1.0) ||
         !(upperBound >= 0.0 && upperBound <= 1.0)) {
-        LOG_ERROR(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+        LOG_ERROR(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound << ","
+                  << upperBound << "]"
                   << ", cutoff = [" << cutoffCdfLowerBound << "," << cutoffCdfUpperBound << "]"
                   << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]"
                   << ", f = " << f);
@@ -511,7 +592,8 @@ void CAnomalyScore::CNormalizer::quantile(double score,
     lowerBound = maths::CQDigest::cdfQuantile(n, lowerBound, lowerQuantile);
     upperBound = maths::CQDigest::cdfQuantile(n, upperBound, upperQuantile);
 
-    LOG_TRACE(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+    LOG_TRACE(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound << ","
+              << upperBound << "]"
               << ", cutoff = [" << cutoffCdfLowerBound << "," << cutoffCdfUpperBound << "]"
               << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]"
               << ", f = " << f);
@@ -525,6 +607,8 @@ bool CAnomalyScore::CNormalizer::updateQuantiles(double score) {
     using TUInt32UInt64Pr = std::pair<uint32_t, uint64_t>;
     using TUInt32UInt64PrVec = std::vector<TUInt32UInt64Pr>;
 
+    this->invalidateLookupTable();
+
     bool bigChange(false);
     double oldMaxScore(m_MaxScore.count() == 0 ? 0.0 : m_MaxScore[0]);
     m_MaxScore.add(score);
@@ -693,6 +777,8 @@ void CAnomalyScore::CNormalizer::propagateForwardByTime(double time) {
     if (m_TimeToQuantileDecay <= 0.0) {
         time = std::floor((QUANTILE_DECAY_TIME - m_TimeToQuantileDecay) / QUANTILE_DECAY_TIME);
 
+        this->invalidateLookupTable();
+
         uint64_t n = m_RawScoreQuantileSummary.n();
         m_RawScoreQuantileSummary.propagateForwardsByTime(time);
         m_RawScoreHighQuantileSummary.propagateForwardsByTime(time);
@@ -750,6 +836,8 @@ bool CAnomalyScore::CNormalizer::upgrade(const std::string& loadedVersion,
              << currentVersion << " - will scale highest score by " << highScoreUpgradeFactor
              << " and Q digest min/max values by " << qDigestUpgradeFactor);
 
+    this->invalidateLookupTable();
+
     // For the maximum score aging is equivalent to scaling.
     m_MaxScore.age(highScoreUpgradeFactor);
 
@@ -773,6 +861,7 @@ void CAnomalyScore::CNormalizer::clear() {
     m_RawScoreQuantileSummary.clear();
     m_RawScoreHighQuantileSummary.clear();
     m_TimeToQuantileDecay = QUANTILE_DECAY_TIME;
+    this->invalidateLookupTable();
 }
 
 void CAnomalyScore::CNormalizer::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
@@ -789,6 +878,8 @@ void CAnomalyScore::CNormalizer::acceptPersistInserter(core::CStatePersistInsert
 }
 
 bool CAnomalyScore::CNormalizer::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
+    this->invalidateLookupTable();
+
     do {
         const std::string& name = traverser.name();
 
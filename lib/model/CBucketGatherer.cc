@@ -273,18 +273,16 @@ bool CBucketGatherer::addEventData(CEventData& data) {
             bucketCounts[pidCid] += count;
         }
 
-        const CEventData::TOptionalStrVec influences = data.influences();
+        const CEventData::TOptionalStrVec& influences = data.influences();
         TSizeSizePrStoredStringPtrPrUInt64UMapVec& influencerCounts =
             m_InfluencerCounts.get(time);
         influencerCounts.resize(influences.size());
-        TStoredStringPtrVec canonicalInfluences(influences.size());
+        TStoredStringPtrVec canonicalInfluences;
+        CStringStore::influencers().get(influences, canonicalInfluences);
 
         for (std::size_t i = 0u; i < influences.size(); ++i) {
-            const CEventData::TOptionalStr& influence = influences[i];
-            if (influence) {
-                const core::CStoredStringPtr& inf =
-                    CStringStore::influencers().get(*influence);
-                canonicalInfluences[i] = inf;
+            const core::CStoredStringPtr& inf = canonicalInfluences[i];
+            if (inf) {
                 if (count > 0) {
                     influencerCounts[i]
                         .emplace(boost::unordered::piecewise_construct,
@@ -499,6 +497,34 @@ bool CBucketGatherer::validateSampleTimes(core_t::TTime& startTime, core_t::TTim
     return false;
 }
 
+void CBucketGatherer::featureData(core_t::TTime /*time*/,
+                                  core_t::TTime /*bucketLength*/,
+                                  TFeatureSizeEventRateFeatureDataPrVecPrVec& result) const {
+    LOG_ERROR(<< "Gatherer doesn't support individual event rate features");
+    result.clear();
+}
+
+void CBucketGatherer::featureData(core_t::TTime /*time*/,
+                                  core_t::TTime /*bucketLength*/,
+                                  TFeatureSizeSizePrEventRateFeatureDataPrVecPrVec& result) const {
+    LOG_ERROR(<< "Gatherer doesn't support population event rate features");
+    result.clear();
+}
+
+void CBucketGatherer::featureData(core_t::TTime /*time*/,
+                                  core_t::TTime /*bucketLength*/,
+                                  TFeatureSizeMetricFeatureDataPrVecPrVec& result) const {
+    LOG_ERROR(<< "Gatherer doesn't support individual metric features");
+    result.clear();
+}
+
+void CBucketGatherer::featureData(core_t::TTime /*time*/,
+                                  core_t::TTime /*bucketLength*/,
+                                  TFeatureSizeSizePrMetricFeatureDataPrVecPrVec& result) const {
+    LOG_ERROR(<< "Gatherer doesn't support population metric features");
+    result.clear();
+}
+
 const CDataGatherer& CBucketGatherer::dataGatherer() const {
     return m_DataGatherer;
 }
@@ -530,6 +556,11 @@ bool CBucketGatherer::hasExplicitNullsOnly(core_t::TTime time, std::size_t pid,
            bucketCounts.find(pidCid) == bucketCounts.end();
 }
 
+const double* CBucketGatherer::numericValue(const TDoubleCPtrVec& numericValues,
+                                            std::size_t i) {
+    return i < numericValues.size() ? numericValues[i] : nullptr;
+}
+
 uint64_t CBucketGatherer::checksum() const {
     using TStrCRef = boost::reference_wrapper<const std::string>;
     using TStrCRefStrCRefPr = std::pair<TStrCRef, TStrCRef>;
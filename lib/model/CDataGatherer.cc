@@ -340,16 +340,31 @@ std::size_t CDataGatherer::numberOverFieldValues() const {
 bool CDataGatherer::processFields(const TStrCPtrVec& fieldValues,
                                   CEventData& result,
                                   CResourceMonitor& resourceMonitor) {
-    return m_Gatherers.front()->processFields(fieldValues, result, resourceMonitor);
+    return this->processFields(fieldValues, TDoubleCPtrVec(), result, resourceMonitor);
+}
+
+bool CDataGatherer::processFields(const TStrCPtrVec& fieldValues,
+                                  const TDoubleCPtrVec& numericValues,
+                                  CEventData& result,
+                                  CResourceMonitor& resourceMonitor) {
+    return m_Gatherers.front()->processFields(fieldValues, numericValues, result,
+                                              resourceMonitor);
+}
+
+bool CDataGatherer::addArrival(const TStrCPtrVec& fieldValues,
+                               CEventData& data,
+                               CResourceMonitor& resourceMonitor) {
+    return this->addArrival(fieldValues, TDoubleCPtrVec(), data, resourceMonitor);
 }
 
 bool CDataGatherer::addArrival(const TStrCPtrVec& fieldValues,
+                               const TDoubleCPtrVec& numericValues,
                                CEventData& data,
                                CResourceMonitor& resourceMonitor) {
     // We process fields even if we are in the first partial bucket so that
     // we add enough extra memory to the resource monitor in order to control
     // the number of partitions created.
-    m_Gatherers.front()->processFields(fieldValues, data, resourceMonitor);
+    m_Gatherers.front()->processFields(fieldValues, numericValues, data, resourceMonitor);
 
     core_t::TTime time = data.time();
     if (time < m_Gatherers.front()->earliestBucketStartTime()) {
@@ -770,6 +785,25 @@ bool CDataGatherer::extractCountFromField(const std::string& fieldName,
     return count > 0;
 }
 
+bool CDataGatherer::extractCountFromField(const std::string& fieldName,
+                                          double fieldValue,
+                                          std::size_t& count) const {
+    if (maths::CMathsFuncs::isNan(fieldValue)) {
+        // Treat not present as explicit null
+        count = EXPLICIT_NULL_SUMMARY_COUNT;
+        return true;
+    }
+
+    if (fieldValue < 0.0 || maths::CMathsFuncs::isFinite(fieldValue) == false) {
+        LOG_ERROR(<< "Unable to extract count " << fieldName << " from " << fieldValue);
+        return false;
+    }
+    count = static_cast<std::size_t>(fieldValue + 0.5);
+
+    // Treat count of 0 as a failure to extract. This will cause the record to be ignored.
+    return count > 0;
+}
+
 bool CDataGatherer::extractMetricFromField(const std::string& fieldName,
                                            std::string fieldValue,
                                            TDouble1Vec& result) const {
@@ -810,6 +844,24 @@ bool CDataGatherer::extractMetricFromField(const std::string& fieldName,
     return true;
 }
 
+bool CDataGatherer::extractMetricFromField(const std::string& fieldName,
+                                           double fieldValue,
+                                           TDouble1Vec& result) const {
+    result.clear();
+
+    if (maths::CMathsFuncs::isNan(fieldValue)) {
+        LOG_WARN(<< "Configured metric " << fieldName << " not present in event");
+        return false;
+    }
+    if (maths::CMathsFuncs::isFinite(fieldValue) == false) {
+        LOG_ERROR(<< "Bad value for " << fieldName << " from " << fieldValue);
+        return false;
+    }
+    result.push_back(fieldValue);
+
+    return true;
+}
+
 core_t::TTime CDataGatherer::earliestBucketStartTime() const {
     return m_Gatherers.front()->earliestBucketStartTime();
 }
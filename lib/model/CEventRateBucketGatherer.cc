@@ -830,6 +830,7 @@ std::string CEventRateBucketGatherer::description() const {
 }
 
 bool CEventRateBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
+                                             const TDoubleCPtrVec& numericValues,
                                              CEventData& result,
                                              CResourceMonitor& resourceMonitor) {
     using TOptionalSize = boost::optional<std::size_t>;
@@ -864,9 +865,12 @@ bool CEventRateBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
 
     std::size_t count = 1;
     if (m_DataGatherer.summaryMode() != model_t::E_None) {
-        if (m_DataGatherer.extractCountFromField(m_FieldNames[m_BeginSummaryFields],
-                                                 fieldValues[m_BeginSummaryFields],
-                                                 count) == false) {
+        const std::string& fieldName = m_FieldNames[m_BeginSummaryFields];
+        const double* number = numericValue(numericValues, m_BeginSummaryFields);
+        if ((number != nullptr
+                 ? m_DataGatherer.extractCountFromField(fieldName, *number, count)
+                 : m_DataGatherer.extractCountFromField(
+                       fieldName, fieldValues[m_BeginSummaryFields], count)) == false) {
             result.addValue();
             return true;
         }
@@ -1040,7 +1044,7 @@ void CEventRateBucketGatherer::sample(core_t::TTime time) {
 
 void CEventRateBucketGatherer::featureData(core_t::TTime time,
                                            core_t::TTime /*bucketLength*/,
-                                           TFeatureAnyPrVec& result) const {
+                                           TFeatureSizeFeatureDataPrVecPrVec& result) const {
     result.clear();
 
     if (!this->dataAvailable(time) ||
@@ -1050,6 +1054,7 @@ void CEventRateBucketGatherer::featureData(core_t::TTime time,
         return;
     }
 
+    result.reserve(m_DataGatherer.numberFeatures());
     for (std::size_t i = 0u, n = m_DataGatherer.numberFeatures(); i < n; ++i) {
         const model_t::EFeature feature = m_DataGatherer.feature(i);
 
@@ -1092,6 +1097,35 @@ void CEventRateBucketGatherer::featureData(core_t::TTime time,
             this->bucketMeanTimesPerPerson(feature, time, result);
             break;
 
+        CASE_INDIVIDUAL_METRIC:
+        CASE_POPULATION_COUNT:
+        CASE_POPULATION_METRIC:
+        CASE_PEERS_COUNT:
+        CASE_PEERS_METRIC:
+            LOG_ERROR(<< "Unexpected feature = " << model_t::print(feature));
+            break;
+        }
+    }
+}
+
+void CEventRateBucketGatherer::featureData(core_t::TTime time,
+                                           core_t::TTime /*bucketLength*/,
+                                           TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const {
+    result.clear();
+
+    if (!this->dataAvailable(time) ||
+        time >= this->currentBucketStartTime() + this->bucketLength()) {
+        LOG_DEBUG(<< "No data available at " << time
+                  << ", current bucket = " << this->printCurrentBucket());
+        return;
+    }
+
+    result.reserve(m_DataGatherer.numberFeatures());
+    for (std::size_t i = 0u, n = m_DataGatherer.numberFeatures(); i < n; ++i) {
+        const model_t::EFeature feature = m_DataGatherer.feature(i);
+
+        switch (feature) {
+        CASE_INDIVIDUAL_COUNT:
         CASE_INDIVIDUAL_METRIC:
             LOG_ERROR(<< "Unexpected feature = " << model_t::print(feature));
             break;
@@ -1161,15 +1195,14 @@ void CEventRateBucketGatherer::featureData(core_t::TTime time,
 
 void CEventRateBucketGatherer::personCounts(model_t::EFeature feature,
                                             core_t::TTime time,
-                                            TFeatureAnyPrVec& result_) const {
+                                            TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     if (m_DataGatherer.isPopulation()) {
         LOG_ERROR(<< "Function does not support population analysis.");
         return;
     }
 
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
     result.reserve(m_DataGatherer.numberActivePeople());
 
     for (std::size_t pid = 0u, n = m_DataGatherer.numberPeople(); pid < n; ++pid) {
@@ -1193,10 +1226,9 @@ void CEventRateBucketGatherer::personCounts(model_t::EFeature feature,
 
 void CEventRateBucketGatherer::nonZeroPersonCounts(model_t::EFeature feature,
                                                    core_t::TTime time,
-                                                   TFeatureAnyPrVec& result_) const {
+                                                   TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
@@ -1211,10 +1243,9 @@ void CEventRateBucketGatherer::nonZeroPersonCounts(model_t::EFeature feature,
 
 void CEventRateBucketGatherer::personIndicator(model_t::EFeature feature,
                                                core_t::TTime time,
-                                               TFeatureAnyPrVec& result_) const {
+                                               TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
@@ -1228,17 +1259,16 @@ void CEventRateBucketGatherer::personIndicator(model_t::EFeature feature,
 
 void CEventRateBucketGatherer::personArrivalTimes(model_t::EFeature feature,
                                                   core_t::TTime /*time*/,
-                                                  TFeatureAnyPrVec& result_) const {
+                                                  TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     // TODO
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
 }
 
 void CEventRateBucketGatherer::nonZeroAttributeCounts(model_t::EFeature feature,
                                                       core_t::TTime time,
-                                                      TFeatureAnyPrVec& result_) const {
+                                                      TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
@@ -1253,10 +1283,9 @@ void CEventRateBucketGatherer::nonZeroAttributeCounts(model_t::EFeature feature,
 }
 
 void CEventRateBucketGatherer::peoplePerAttribute(model_t::EFeature feature,
-                                                  TFeatureAnyPrVec& result_) const {
+                                                  TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_AttributePeople);
     if (i == m_FeatureData.end()) {
@@ -1280,10 +1309,9 @@ void CEventRateBucketGatherer::peoplePerAttribute(model_t::EFeature feature,
 
 void CEventRateBucketGatherer::attributeIndicator(model_t::EFeature feature,
                                                   core_t::TTime time,
-                                                  TFeatureAnyPrVec& result_) const {
+                                                  TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     const TSizeSizePrUInt64UMap& counts = this->bucketCounts(time);
     result.reserve(counts.size());
@@ -1307,10 +1335,9 @@ void CEventRateBucketGatherer::attributeIndicator(model_t::EFeature feature,
 
 void CEventRateBucketGatherer::bucketUniqueValuesPerPerson(model_t::EFeature feature,
                                                            core_t::TTime time,
-                                                           TFeatureAnyPrVec& result_) const {
+                                                           TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_UniqueValues);
     if (i == m_FeatureData.end()) {
@@ -1336,10 +1363,9 @@ void CEventRateBucketGatherer::bucketUniqueValuesPerPerson(model_t::EFeature fea
 
 void CEventRateBucketGatherer::bucketUniqueValuesPerPersonAttribute(model_t::EFeature feature,
                                                                     core_t::TTime time,
-                                                                    TFeatureAnyPrVec& result_) const {
+                                                                    TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_UniqueValues);
     if (i == m_FeatureData.end()) {
@@ -1365,10 +1391,9 @@ void CEventRateBucketGatherer::bucketUniqueValuesPerPersonAttribute(model_t::EFe
 
 void CEventRateBucketGatherer::bucketCompressedLengthPerPerson(model_t::EFeature feature,
                                                                core_t::TTime time,
-                                                               TFeatureAnyPrVec& result_) const {
+                                                               TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_UniqueValues);
     if (i == m_FeatureData.end()) {
@@ -1395,10 +1420,9 @@ void CEventRateBucketGatherer::bucketCompressedLengthPerPerson(model_t::EFeature
 void CEventRateBucketGatherer::bucketCompressedLengthPerPersonAttribute(
     model_t::EFeature feature,
     core_t::TTime time,
-    TFeatureAnyPrVec& result_) const {
+    TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_UniqueValues);
     if (i == m_FeatureData.end()) {
@@ -1424,10 +1448,9 @@ void CEventRateBucketGatherer::bucketCompressedLengthPerPersonAttribute(
 
 void CEventRateBucketGatherer::bucketMeanTimesPerPerson(model_t::EFeature feature,
                                                         core_t::TTime time,
-                                                        TFeatureAnyPrVec& result_) const {
+                                                        TFeatureSizeFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_DiurnalTimes);
     if (i == m_FeatureData.end()) {
@@ -1467,10 +1490,9 @@ void CEventRateBucketGatherer::bucketMeanTimesPerPerson(model_t::EFeature featur
 
 void CEventRateBucketGatherer::bucketMeanTimesPerPersonAttribute(model_t::EFeature feature,
                                                                  core_t::TTime time,
-                                                                 TFeatureAnyPrVec& result_) const {
+                                                                 TFeatureSizeSizePrFeatureDataPrVecPrVec& result_) const {
     result_.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-    auto& result =
-        *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
+    auto& result = result_.back().second;
 
     auto i = m_FeatureData.find(model_t::E_DiurnalTimes);
     if (i == m_FeatureData.end()) {
@@ -427,6 +427,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
                     core_t::TTime skipTime = sampleTime - attributeLastBucketTimesMap[cid];
                     if (skipTime > 0) {
                         model->skipTime(skipTime);
+                        m_Probabilities.invalidate(feature, cid);
                         // Update the last time so we don't advance the same model
                         // multiple times (once per person)
                         attributeLastBucketTimesMap[cid] = sampleTime;
@@ -473,6 +474,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
                     maths::CModel::E_Reset) {
                     gatherer.resetSampleCount(cid);
                 }
+                m_Probabilities.invalidate(feature, cid);
             }
         }
 
@@ -481,7 +483,11 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
         }
 
         m_AttributeProbabilities = TCategoryProbabilityCache(m_AttributeProbabilityPrior);
-        m_Probabilities.clear();
+        // The correlations can affect every model's probabilities.
+        if (m_FeatureCorrelatesModels.size() > 0) {
+            m_Probabilities.clear();
+        }
+        m_Probabilities.nextGeneration();
     }
 }
 
@@ -810,6 +816,7 @@ void CEventRatePopulationModel::debugMemoryUsage(core::CMemoryUsage::TMemoryUsag
                                     m_NewAttributeProbabilityPrior, mem);
     core::CMemoryDebug::dynamicSize("m_AttributeProbabilityPrior",
                                     m_AttributeProbabilityPrior, mem);
+    core::CMemoryDebug::dynamicSize("m_Probabilities", m_Probabilities, mem);
     core::CMemoryDebug::dynamicSize("m_FeatureModels", m_FeatureModels, mem);
     core::CMemoryDebug::dynamicSize("m_FeatureCorrelatesModels",
                                     m_FeatureCorrelatesModels, mem);
@@ -832,12 +839,20 @@ std::size_t CEventRatePopulationModel::computeMemoryUsage() const {
     mem += core::CMemory::dynamicSize(m_AttributeProbabilities);
     mem += core::CMemory::dynamicSize(m_NewAttributeProbabilityPrior);
     mem += core::CMemory::dynamicSize(m_AttributeProbabilityPrior);
+    mem += core::CMemory::dynamicSize(m_Probabilities);
     mem += core::CMemory::dynamicSize(m_FeatureModels);
     mem += core::CMemory::dynamicSize(m_FeatureCorrelatesModels);
     mem += core::CMemory::dynamicSize(m_MemoryEstimator);
     return mem;
 }
 
+std::size_t CEventRatePopulationModel::pendingMemoryUsage() {
+    CDataGatherer& gatherer = this->dataGatherer();
+    return this->CAnomalyDetectorModel::pendingMemoryUsage(
+        m_FeatureModels, gatherer.numberAttributes(),
+        gatherer.recycledAttributeIds().size());
+}
+
 CMemoryUsageEstimator* CEventRatePopulationModel::memoryUsageEstimator() const {
     return &m_MemoryEstimator;
 }
@@ -919,6 +934,7 @@ void CEventRatePopulationModel::updateRecycledModels() {
             }
         }
     }
+    m_Probabilities.clear();
     this->CPopulationModel::updateRecycledModels();
 }
 
@@ -945,6 +961,7 @@ void CEventRatePopulationModel::clearPrunedResources(const TSizeVec& /*people*/,
             feature.s_Models[cid].reset(this->tinyModel());
         }
     }
+    m_Probabilities.clear();
 }
 
 void CEventRatePopulationModel::doSkipSampling(core_t::TTime startTime, core_t::TTime endTime) {
@@ -954,6 +971,7 @@ void CEventRatePopulationModel::doSkipSampling(core_t::TTime startTime, core_t::
             model->skipTime(gap);
         }
     }
+    m_Probabilities.clear();
     this->CPopulationModel::doSkipSampling(startTime, endTime);
 }
 
@@ -9,6 +9,7 @@
 #include <core/CContainerPrinter.h>
 #include <core/CFunctional.h>
 #include <core/CLogger.h>
+#include <core/CMonotonicArena.h>
 #include <core/CStringUtils.h>
 #include <core/RestoreMacros.h>
 
@@ -31,6 +32,7 @@ namespace hierarchical_results_detail {
 namespace {
 
 using TNodeCPtr = SNode::TNodeCPtr;
+using TNodePtrVec = std::vector<SNode*, core::CMonotonicArenaAllocator<SNode*>>;
 
 //! CHierarchicalResults tags
 const std::string NODES_1_TAG("a");
@@ -159,9 +161,10 @@ void aggregateLayer(ITR beginLayer,
                     ITR endLayer,
                     CHierarchicalResults& results,
                     FACTORY newNode,
-                    std::vector<SNode*>& newLayer) {
-    using TNodePtrVec = std::vector<SNode*>;
-    using TNodeCPtrNodePtrVecMap = std::map<TNodeCPtr, TNodePtrVec, LESS>;
+                    TNodePtrVec& newLayer) {
+    using TNodeCPtrNodePtrVecMap =
+        std::map<TNodeCPtr, TNodePtrVec, LESS,
+                 core::CMonotonicArenaAllocator<std::pair<const TNodeCPtr, TNodePtrVec>>>;
 
     newLayer.clear();
 
@@ -555,9 +558,19 @@ void CHierarchicalResults::addInfluencer(const std::string& name) {
     this->newPivotRoot(CStringStore::influencers().get(name));
 }
 
-void CHierarchicalResults::buildHierarchy() {
-    using TNodePtrVec = std::vector<SNode*>;
+void CHierarchicalResults::append(CHierarchicalResults& other) {
+    for (auto& node : other.m_Nodes) {
+        m_Nodes.emplace_back();
+        m_Nodes.back().swap(node);
+    }
+    for (const auto& root : other.m_PivotRootNodes) {
+        this->newPivotRoot(root.first);
+    }
+    other.m_Nodes.clear();
+    other.m_PivotRootNodes.clear();
+}
 
+void CHierarchicalResults::buildHierarchy() {
     m_Nodes.erase(std::remove_if(m_Nodes.begin(), m_Nodes.end(), isAggregate),
                   m_Nodes.end());
 
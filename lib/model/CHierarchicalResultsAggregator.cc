@@ -247,7 +247,9 @@ bool CHierarchicalResultsAggregator::partitionChildProbabilities(
     bool pivot,
     std::size_t& numberDetectors,
     TIntSizePrDouble1VecUMap (&partition)[N]) {
-    using TSizeFSet = boost::container::flat_set<std::size_t>;
+    using TSizeFSet =
+        boost::container::flat_set<std::size_t, std::less<std::size_t>,
+                                   core::CMonotonicArenaAllocator<std::size_t>>;
     using TMinAccumulator = maths::CBasicStatistics::SMin<double>::TAccumulator;
 
     for (std::size_t i = 0u; i < N; ++i) {
@@ -317,7 +319,9 @@ void CHierarchicalResultsAggregator::detectorProbabilities(
     int& detector,
     int& aggregation,
     TDouble1Vec& probabilities) {
-    using TIntDouble1VecFMap = boost::container::flat_map<int, TDouble1Vec>;
+    using TIntDouble1VecFMap =
+        boost::container::flat_map<int, TDouble1Vec, std::less<int>,
+                                   core::CMonotonicArenaAllocator<std::pair<int, TDouble1Vec>>>;
 
     int fallback{static_cast<int>(model_t::E_AggregatePeople)};
     detector = -3;
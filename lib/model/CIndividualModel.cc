@@ -330,6 +330,12 @@ std::size_t CIndividualModel::computeMemoryUsage() const {
     return mem;
 }
 
+std::size_t CIndividualModel::pendingMemoryUsage() {
+    CDataGatherer& gatherer = this->dataGatherer();
+    return this->CAnomalyDetectorModel::pendingMemoryUsage(
+        m_FeatureModels, gatherer.numberPeople(), gatherer.recycledPersonIds().size());
+}
+
 CMemoryUsageEstimator* CIndividualModel::memoryUsageEstimator() const {
     return &m_MemoryEstimator;
 }
@@ -699,29 +699,17 @@ public:
 //! Extracts feature data from a collection of gatherers.
 struct SExtractFeatureData {
 public:
-    using TFeatureAnyPr = std::pair<model_t::EFeature, boost::any>;
-    using TFeatureAnyPrVec = std::vector<TFeatureAnyPr>;
-
-public:
-    template<typename T>
+    template<typename T, typename U>
     void operator()(const TCategorySizePr& /*category*/,
                     const TSizeSizeTUMapUMap<T>& data,
                     const CMetricBucketGatherer& gatherer,
                     model_t::EFeature feature,
                     core_t::TTime time,
                     core_t::TTime bucketLength,
-                    TFeatureAnyPrVec& result) const {
-        if (gatherer.dataGatherer().isPopulation()) {
-            result.emplace_back(feature, TSizeSizePrFeatureDataPrVec());
-            this->featureData(data, gatherer, time, bucketLength, this->isSum(feature),
-                              *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(
-                                  &result.back().second));
-        } else {
-            result.emplace_back(feature, TSizeFeatureDataPrVec());
-            this->featureData(
-                data, gatherer, time, bucketLength, this->isSum(feature),
-                *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result.back().second));
-        }
+                    std::vector<std::pair<model_t::EFeature, U>>& result) const {
+        result.emplace_back(feature, U());
+        this->featureData(data, gatherer, time, bucketLength,
+                          this->isSum(feature), result.back().second);
     }
 
 private:
@@ -830,6 +818,49 @@ private:
 const TSampleVec
     SExtractFeatureData::ZERO_SAMPLE(1, CSample(0, TDoubleVec(1, 0.0), 1.0, 1.0));
 
+//! Extract the data for all features of \p gatherer in the bucketing
+//! interval containing \p time.
+//!
+//! \tparam T The type of the feature data, which is determined by
+//! whether the gatherer is for a population.
+template<typename T>
+void extractFeatureData(const CMetricBucketGatherer& gatherer,
+                        const TCategorySizePrAnyMap& featureData,
+                        core_t::TTime time,
+                        core_t::TTime bucketLength,
+                        std::vector<std::pair<model_t::EFeature, T>>& result) {
+    result.clear();
+
+    if (!gatherer.dataAvailable(time) ||
+        time >= gatherer.currentBucketStartTime() + gatherer.bucketLength()) {
+        LOG_DEBUG(<< "No data available at " << time);
+        return;
+    }
+
+    const CDataGatherer& dataGatherer = gatherer.dataGatherer();
+    result.reserve(dataGatherer.numberFeatures());
+    for (std::size_t i = 0u, n = dataGatherer.numberFeatures(); i < n; ++i) {
+        model_t::EFeature feature = dataGatherer.feature(i);
+        model_t::EMetricCategory category;
+        if (model_t::metricCategory(feature, category)) {
+            std::size_t dimension = model_t::dimension(feature);
+            auto begin = featureData.find({category, dimension});
+            if (begin != featureData.end()) {
+                auto end = begin;
+                ++end;
+                apply(begin, end,
+                      boost::bind<void>(SExtractFeatureData(), _1, _2,
+                                        boost::cref(gatherer), feature, time,
+                                        bucketLength, boost::ref(result)));
+            } else {
+                LOG_ERROR(<< "No data for category " << model_t::print(category));
+            }
+        } else {
+            LOG_ERROR(<< "Unexpected feature " << model_t::print(feature));
+        }
+    }
+}
+
 //! Adds a value to the specified data gatherers.
 struct SAddValue {
     struct SStatistic {
@@ -1111,6 +1142,7 @@ std::string CMetricBucketGatherer::description() const {
 }
 
 bool CMetricBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
+                                          const TDoubleCPtrVec& numericValues,
                                           CEventData& result,
                                           CResourceMonitor& resourceMonitor) {
     using TOptionalStr = boost::optional<std::string>;
@@ -1144,8 +1176,12 @@ bool CMetricBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
     if (m_DataGatherer.summaryMode() != model_t::E_None) {
         CEventData::TDouble1VecArraySizePr statistics;
         statistics.first.fill(TDouble1Vec(1, 0.0));
-        if (m_DataGatherer.extractCountFromField(m_FieldNames[i], fieldValues[i],
-                                                 statistics.second) == false) {
+        const double* number = numericValue(numericValues, i);
+        if ((number != nullptr
+                 ? m_DataGatherer.extractCountFromField(m_FieldNames[i], *number,
+                                                        statistics.second)
+                 : m_DataGatherer.extractCountFromField(m_FieldNames[i], fieldValues[i],
+                                                        statistics.second)) == false) {
             result.addValue();
             return true;
         }
@@ -1165,9 +1201,13 @@ bool CMetricBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
         }
         for (std::size_t j = 0u; allOk && i < m_FieldNames.size(); ++i, ++j) {
             model_t::EMetricCategory category = m_FieldMetricCategories[j];
-            if (fieldValues[i] == nullptr ||
-                m_DataGatherer.extractMetricFromField(
-                    m_FieldNames[i], *fieldValues[i], statistics.first[category]) == false) {
+            if (const double* number = numericValue(numericValues, i)) {
+                allOk = m_DataGatherer.extractMetricFromField(
+                    m_FieldNames[i], *number, statistics.first[category]);
+            } else if (fieldValues[i] == nullptr ||
+                       m_DataGatherer.extractMetricFromField(
+                           m_FieldNames[i], *fieldValues[i],
+                           statistics.first[category]) == false) {
                 allOk = false;
             }
         }
@@ -1182,9 +1222,12 @@ bool CMetricBucketGatherer::processFields(const TStrCPtrVec& fieldValues,
         }
     } else {
         TDouble1Vec value;
-        if (fieldValues[i] != nullptr &&
-            m_DataGatherer.extractMetricFromField(m_FieldNames[i], *fieldValues[i],
-                                                  value) == true) {
+        const double* number = numericValue(numericValues, i);
+        if (number != nullptr
+                ? m_DataGatherer.extractMetricFromField(m_FieldNames[i], *number, value)
+                : fieldValues[i] != nullptr &&
+                      m_DataGatherer.extractMetricFromField(
+                          m_FieldNames[i], *fieldValues[i], value)) {
             result.addValue(value);
         } else {
             result.addValue();
@@ -1362,35 +1405,24 @@ void CMetricBucketGatherer::sample(core_t::TTime time) {
 
 void CMetricBucketGatherer::featureData(core_t::TTime time,
                                         core_t::TTime bucketLength,
-                                        TFeatureAnyPrVec& result) const {
-    result.clear();
-
-    if (!this->dataAvailable(time) ||
-        time >= this->currentBucketStartTime() + this->bucketLength()) {
-        LOG_DEBUG(<< "No data available at " << time);
+                                        TFeatureSizeFeatureDataPrVecPrVec& result) const {
+    if (m_DataGatherer.isPopulation()) {
+        LOG_ERROR(<< "Function does not support population analysis.");
+        result.clear();
         return;
     }
+    extractFeatureData(*this, m_FeatureData, time, bucketLength, result);
+}
 
-    for (std::size_t i = 0u, n = m_DataGatherer.numberFeatures(); i < n; ++i) {
-        model_t::EFeature feature = m_DataGatherer.feature(i);
-        model_t::EMetricCategory category;
-        if (model_t::metricCategory(feature, category)) {
-            std::size_t dimension = model_t::dimension(feature);
-            auto begin = m_FeatureData.find({category, dimension});
-            if (begin != m_FeatureData.end()) {
-                auto end = begin;
-                ++end;
-                apply(begin, end,
-                      boost::bind<void>(SExtractFeatureData(), _1, _2,
-                                        boost::cref(*this), feature, time,
-                                        bucketLength, boost::ref(result)));
-            } else {
-                LOG_ERROR(<< "No data for category " << model_t::print(category));
-            }
-        } else {
-            LOG_ERROR(<< "Unexpected feature " << model_t::print(feature));
-        }
+void CMetricBucketGatherer::featureData(core_t::TTime time,
+                                        core_t::TTime bucketLength,
+                                        TFeatureSizeSizePrFeatureDataPrVecPrVec& result) const {
+    if (!m_DataGatherer.isPopulation()) {
+        LOG_ERROR(<< "Function does not support individual analysis.");
+        result.clear();
+        return;
     }
+    extractFeatureData(*this, m_FeatureData, time, bucketLength, result);
 }
 
 void CMetricBucketGatherer::resize(std::size_t pid, std::size_t cid) {
@@ -384,6 +384,7 @@ void CMetricPopulationModel::sample(core_t::TTime startTime,
                     core_t::TTime skipTime = sampleTime - attributeLastBucketTimesMap[cid];
                     if (skipTime > 0) {
                         model->skipTime(skipTime);
+                        m_Probabilities.invalidate(feature, cid);
                         // Update the last time so we don't advance the same model
                         // multiple times (once per person)
                         attributeLastBucketTimesMap[cid] = sampleTime;
@@ -471,6 +472,7 @@ void CMetricPopulationModel::sample(core_t::TTime startTime,
                     maths::CModel::E_Reset) {
                     gatherer.resetSampleCount(cid);
                 }
+                m_Probabilities.invalidate(feature, cid);
             }
         }
 
@@ -478,7 +480,11 @@ void CMetricPopulationModel::sample(core_t::TTime startTime,
             feature.s_Models->processSamples();
         }
 
-        m_Probabilities.clear();
+        // The correlations can affect every model's probabilities.
+        if (m_FeatureCorrelatesModels.size() > 0) {
+            m_Probabilities.clear();
+        }
+        m_Probabilities.nextGeneration();
     }
 }
 
@@ -722,6 +728,7 @@ void CMetricPopulationModel::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePt
                                     m_CurrentBucketStats.s_FeatureData, mem);
     core::CMemoryDebug::dynamicSize("m_CurrentBucketStats.s_InterimCorrections",
                                     m_CurrentBucketStats.s_InterimCorrections, mem);
+    core::CMemoryDebug::dynamicSize("m_Probabilities", m_Probabilities, mem);
     core::CMemoryDebug::dynamicSize("m_FeatureModels", m_FeatureModels, mem);
     core::CMemoryDebug::dynamicSize("m_FeatureCorrelatesModels",
                                     m_FeatureCorrelatesModels, mem);
@@ -741,12 +748,20 @@ std::size_t CMetricPopulationModel::computeMemoryUsage() const {
     mem += core::CMemory::dynamicSize(m_CurrentBucketStats.s_PersonCounts);
     mem += core::CMemory::dynamicSize(m_CurrentBucketStats.s_FeatureData);
     mem += core::CMemory::dynamicSize(m_CurrentBucketStats.s_InterimCorrections);
+    mem += core::CMemory::dynamicSize(m_Probabilities);
     mem += core::CMemory::dynamicSize(m_FeatureModels);
     mem += core::CMemory::dynamicSize(m_FeatureCorrelatesModels);
     mem += core::CMemory::dynamicSize(m_MemoryEstimator);
     return mem;
 }
 
+std::size_t CMetricPopulationModel::pendingMemoryUsage() {
+    CDataGatherer& gatherer = this->dataGatherer();
+    return this->CAnomalyDetectorModel::pendingMemoryUsage(
+        m_FeatureModels, gatherer.numberAttributes(),
+        gatherer.recycledAttributeIds().size());
+}
+
 CMemoryUsageEstimator* CMetricPopulationModel::memoryUsageEstimator() const {
     return &m_MemoryEstimator;
 }
@@ -827,6 +842,7 @@ void CMetricPopulationModel::updateRecycledModels() {
             }
         }
     }
+    m_Probabilities.clear();
     this->CPopulationModel::updateRecycledModels();
 }
 
@@ -859,6 +875,7 @@ void CMetricPopulationModel::clearPrunedResources(const TSizeVec& /*people*/,
             }
         }
     }
+    m_Probabilities.clear();
 }
 
 void CMetricPopulationModel::doSkipSampling(core_t::TTime startTime, core_t::TTime endTime) {
@@ -868,6 +885,7 @@ void CMetricPopulationModel::doSkipSampling(core_t::TTime startTime, core_t::TTi
             model->skipTime(gap);
         }
     }
+    m_Probabilities.clear();
     this->CPopulationModel::doSkipSampling(startTime, endTime);
 }
 
@@ -6,6 +6,7 @@
 
 #include <model/CModelFactory.h>
 
+#include <core/CScopedFastLock.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/Constants.h>
 
@@ -40,11 +41,21 @@ CModelFactory::CModelFactory(const SModelParams& params)
     : m_ModelParams(params) {
 }
 
+CModelFactory::CModelFactory(const CModelFactory& other)
+    : m_ModelParams(other.m_ModelParams) {
+    core::CScopedFastLock lock(other.m_CacheMutex);
+    m_MathsModelCache = other.m_MathsModelCache;
+    m_CorrelatePriorCache = other.m_CorrelatePriorCache;
+    m_CorrelationsCache = other.m_CorrelationsCache;
+    m_InfluenceCalculatorCache = other.m_InfluenceCalculatorCache;
+}
+
 const CModelFactory::TFeatureMathsModelPtrPrVec&
 CModelFactory::defaultFeatureModels(const TFeatureVec& features,
                                     core_t::TTime bucketLength,
                                     double minimumSeasonalVarianceScale,
                                     bool modelAnomalies) const {
+    core::CScopedFastLock lock(m_CacheMutex);
     auto result = m_MathsModelCache.insert({features, TFeatureMathsModelPtrPrVec()});
     if (result.second) {
         result.first->second.reserve(features.size());
@@ -89,6 +100,10 @@ CModelFactory::defaultFeatureModel(model_t::EFeature feature,
 
     if (dimension == 1) {
         TPriorPtr prior{this->defaultPrior(feature)};
+        if (m_ModelParams.s_PruneResidualModels) {
+            // This is shared by every time series model for the feature.
+            params.residualModelPrototype(prior);
+        }
         return std::make_shared<maths::CUnivariateTimeSeriesModel>(
             params,
             0, // identifier (unused).
@@ -104,6 +119,7 @@ CModelFactory::defaultFeatureModel(model_t::EFeature feature,
 
 const CModelFactory::TFeatureMultivariatePriorPtrPrVec&
 CModelFactory::defaultCorrelatePriors(const TFeatureVec& features) const {
+    core::CScopedFastLock lock(m_CacheMutex);
     auto result = m_CorrelatePriorCache.insert(
         {features, TFeatureMultivariatePriorPtrPrVec()});
     if (result.second) {
@@ -120,6 +136,7 @@ CModelFactory::defaultCorrelatePriors(const TFeatureVec& features) const {
 
 const CModelFactory::TFeatureCorrelationsPtrPrVec&
 CModelFactory::defaultCorrelates(const TFeatureVec& features) const {
+    core::CScopedFastLock lock(m_CacheMutex);
     auto result = m_CorrelationsCache.insert({features, TFeatureCorrelationsPtrPrVec()});
     if (result.second) {
         result.first->second.reserve(features.size());
@@ -163,13 +180,17 @@ CModelFactory::defaultDecomposition(model_t::EFeature feature, core_t::TTime buc
     }
     double decayRate = CAnomalyDetectorModelConfig::trendDecayRate(
         m_ModelParams.s_DecayRate, bucketLength);
-    return std::make_shared<maths::CTimeSeriesDecomposition>(
+    auto result = std::make_shared<maths::CTimeSeriesDecomposition>(
         decayRate, bucketLength, m_ModelParams.s_ComponentSize);
+    result->periodicityTestScheduler(m_ModelParams.s_PeriodicityTestScheduler);
+    result->deflatePeriodicityTestWindows(m_ModelParams.s_CompactModels);
+    return result;
 }
 
 const CModelFactory::TFeatureInfluenceCalculatorCPtrPrVec&
 CModelFactory::defaultInfluenceCalculators(const std::string& influencerName,
                                            const TFeatureVec& features) const {
+    core::CScopedFastLock lock(m_CacheMutex);
     TFeatureInfluenceCalculatorCPtrPrVec& result =
         m_InfluenceCalculatorCache[TStrFeatureVecPr(influencerName, features)];
 
@@ -258,6 +279,14 @@ void CModelFactory::componentSize(std::size_t componentSize) {
     m_ModelParams.s_ComponentSize = componentSize;
 }
 
+void CModelFactory::compactModels(bool compact) {
+    m_ModelParams.s_CompactModels = compact;
+}
+
+void CModelFactory::pruneResidualModels(bool prune) {
+    m_ModelParams.s_PruneResidualModels = prune;
+}
+
 double CModelFactory::minimumModeFraction() const {
     return m_ModelParams.s_MinimumModeFraction;
 }
@@ -274,6 +303,10 @@ void CModelFactory::updateBucketLength(core_t::TTime length) {
     m_ModelParams.s_BucketLength = length;
 }
 
+void CModelFactory::periodicityTestScheduler(maths::CPeriodicityTestScheduler* scheduler) {
+    m_ModelParams.s_PeriodicityTestScheduler = scheduler;
+}
+
 void CModelFactory::swap(CModelFactory& other) {
     std::swap(m_ModelParams, other.m_ModelParams);
     m_MathsModelCache.swap(other.m_MathsModelCache);
@@ -35,6 +35,7 @@ SModelParams::SModelParams(core_t::TTime bucketLength)
       s_MinimumModeCount(CAnomalyDetectorModelConfig::DEFAULT_MINIMUM_CLUSTER_SPLIT_COUNT),
       s_CutoffToModelEmptyBuckets(CAnomalyDetectorModelConfig::DEFAULT_CUTOFF_TO_MODEL_EMPTY_BUCKETS),
       s_ComponentSize(CAnomalyDetectorModelConfig::DEFAULT_COMPONENT_SIZE),
+      s_CompactModels(false), s_PruneResidualModels(false),
       s_ExcludeFrequent(model_t::E_XF_None), s_ExcludePersonFrequency(0.1),
       s_ExcludeAttributeFrequency(0.1),
       s_MaximumUpdatesPerBucket(CAnomalyDetectorModelConfig::DEFAULT_MAXIMUM_UPDATES_PER_BUCKET),
@@ -52,7 +53,8 @@ SModelParams::SModelParams(core_t::TTime bucketLength)
           CAnomalyDetectorModelConfig::DEFAULT_MINIMUM_SIGNIFICANT_CORRELATION),
       s_DetectionRules(EMPTY_RULES), s_ScheduledEvents(EMPTY_SCHEDULED_EVENTS),
       s_BucketResultsDelay(0), s_MinimumToDeduplicate(10000),
-      s_CacheProbabilities(true), s_SamplingAgeCutoff(SAMPLING_AGE_CUTOFF_DEFAULT) {
+      s_CacheProbabilities(true), s_SamplingAgeCutoff(SAMPLING_AGE_CUTOFF_DEFAULT),
+      s_PeriodicityTestScheduler(nullptr) {
 }
 
 void SModelParams::configureLatency(core_t::TTime latency, core_t::TTime bucketLength) {
@@ -6,7 +6,11 @@
 
 #include <model/CModelTools.h>
 
+#include <core/CMemory.h>
+#include <core/CStatistics.h>
+
 #include <maths/CBasicStatistics.h>
+#include <maths/CChecksum.h>
 #include <maths/CIntegerTools.h>
 #include <maths/CModel.h>
 #include <maths/CMultinomialConjugate.h>
@@ -318,12 +322,28 @@ std::size_t CModelTools::CCategoryProbabilityCache::memoryUsage() const {
     return mem;
 }
 
-CModelTools::CProbabilityCache::CProbabilityCache(double maximumError)
-    : m_MaximumError(maximumError) {
+const std::size_t CModelTools::CProbabilityCache::DEFAULT_MEMORY_BUDGET{1024 * 1024};
+
+CModelTools::CProbabilityCache::CProbabilityCache(double maximumError, std::size_t memoryBudget)
+    : m_MaximumError(maximumError), m_MemoryBudget(memoryBudget),
+      m_Generation(0), m_NumberProbabilities(0) {
 }
 
 void CModelTools::CProbabilityCache::clear() {
     m_Caches.clear();
+    m_NumberProbabilities = 0;
+}
+
+void CModelTools::CProbabilityCache::invalidate(model_t::EFeature feature, std::size_t id) {
+    auto pos = m_Caches.find({feature, id});
+    if (pos != m_Caches.end()) {
+        m_NumberProbabilities -= pos->second.s_Probabilities.size();
+        m_Caches.erase(pos);
+    }
+}
+
+void CModelTools::CProbabilityCache::nextGeneration() {
+    ++m_Generation;
 }
 
 void CModelTools::CProbabilityCache::addModes(model_t::EFeature feature,
@@ -344,19 +364,34 @@ void CModelTools::CProbabilityCache::addModes(model_t::EFeature feature,
 
 void CModelTools::CProbabilityCache::addProbability(model_t::EFeature feature,
                                                     std::size_t id,
+                                                    const maths::CModelProbabilityParams& params,
                                                     const TDouble2Vec1Vec& value,
                                                     double probability,
                                                     const TTail2Vec& tail,
                                                     bool conditional,
                                                     const TSize1Vec& mostAnomalousCorrelate) {
     if (m_MaximumError > 0.0 && value.size() == 1 && value[0].size() == 1) {
-        m_Caches[{feature, id}].s_Probabilities.emplace(
-            value[0][0], SProbability{probability, tail, conditional, mostAnomalousCorrelate});
+        SProbabilityCache& cache{m_Caches[{feature, id}]};
+        uint64_t parameters{checksum(params)};
+        if (cache.s_Parameters != parameters) {
+            m_NumberProbabilities -= cache.s_Probabilities.size();
+            cache.s_Probabilities.clear();
+            cache.s_Parameters = parameters;
+        }
+        cache.s_Generation = m_Generation;
+        if (cache.s_Probabilities
+                .emplace(value[0][0], SProbability{probability, tail, conditional,
+                                                   mostAnomalousCorrelate})
+                .second) {
+            ++m_NumberProbabilities;
+            this->prune();
+        }
     }
 }
 
 bool CModelTools::CProbabilityCache::lookup(model_t::EFeature feature,
                                             std::size_t id,
+                                            const maths::CModelProbabilityParams& params,
                                             const TDouble2Vec1Vec& value,
                                             double& probability,
                                             TTail2Vec& tail,
@@ -376,7 +411,8 @@ bool CModelTools::CProbabilityCache::lookup(model_t::EFeature feature,
 
     if (m_MaximumError > 0.0 && value.size() == 1 && value[0].size() == 1) {
         auto pos = m_Caches.find({feature, id});
-        if (pos != m_Caches.end()) {
+        if (pos != m_Caches.end() && pos->second.s_Parameters == checksum(params)) {
+            pos->second.s_Generation = m_Generation;
             double x{value[0][0]};
             const TDouble1Vec& modes{pos->second.s_Modes};
             const TDoubleProbabilityFMap& probabilities{pos->second.s_Probabilities};
@@ -387,6 +423,7 @@ bool CModelTools::CProbabilityCache::lookup(model_t::EFeature feature,
                 tail = right->second.s_Tail;
                 conditional = right->second.s_Conditional;
                 mostAnomalousCorrelate = right->second.s_MostAnomalousCorrelate;
+                core::CStatistics::stat(stat_t::E_NumberProbabilityCacheHits).increment();
                 return true;
             } else if (right != probabilities.end() &&
                        right + 1 != probabilities.end() &&
@@ -415,15 +452,75 @@ bool CModelTools::CProbabilityCache::lookup(model_t::EFeature feature,
                         tail = nearest->second.s_Tail;
                         conditional = nearest->second.s_Conditional;
                         mostAnomalousCorrelate = nearest->second.s_MostAnomalousCorrelate;
-                        return std::fabs(p[2] - p[1]) <=
-                               m_MaximumError * std::min(p[1], p[2]);
+                        if (std::fabs(p[2] - p[1]) <= m_MaximumError * std::min(p[1], p[2])) {
+                            core::CStatistics::stat(stat_t::E_NumberProbabilityCacheHits)
+                                .increment();
+                            return true;
+                        }
                     }
                 }
             }
         }
+        core::CStatistics::stat(stat_t::E_NumberProbabilityCacheMisses).increment();
     }
 
     return false;
 }
+
+void CModelTools::CProbabilityCache::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
+    mem->setName("CModelTools::CProbabilityCache");
+    core::CMemoryDebug::dynamicSize("m_Caches", m_Caches, mem);
+}
+
+std::size_t CModelTools::CProbabilityCache::memoryUsage() const {
+    return core::CMemory::dynamicSize(m_Caches);
+}
+
+uint64_t CModelTools::CProbabilityCache::checksum(const maths::CModelProbabilityParams& params) {
+    uint64_t seed{maths::CChecksum::calculate(0, params.seasonalConfidenceInterval())};
+    for (std::size_t i = 0u; i < params.calculations(); ++i) {
+        seed = maths::CChecksum::calculate(seed, static_cast<int>(params.calculation(i)));
+    }
+    seed = maths::CChecksum::calculate(seed, params.bucketEmpty());
+    return maths::CChecksum::calculate(seed, params.weights());
+}
+
+void CModelTools::CProbabilityCache::prune() {
+    // We estimate the memory used by the cached probabilities because
+    // this is called for every new probability.
+    std::size_t limit{m_MemoryBudget / sizeof(TDoubleProbabilityFMap::value_type)};
+    if (m_NumberProbabilities <= limit) {
+        return;
+    }
+
+    for (auto i = m_Caches.begin(); i != m_Caches.end(); /**/) {
+        if (i->second.s_Generation < m_Generation) {
+            m_NumberProbabilities -= i->second.s_Probabilities.size();
+            i = m_Caches.erase(i);
+        } else {
+            ++i;
+        }
+    }
+    if (m_NumberProbabilities > limit) {
+        LOG_TRACE(<< "Clearing probability cache with " << m_NumberProbabilities
+                  << " probabilities");
+        this->clear();
+    }
+}
+
+CModelTools::CProbabilityCache::SProbabilityCache::SProbabilityCache()
+    : s_Parameters(0), s_Generation(0) {
+}
+
+void CModelTools::CProbabilityCache::SProbabilityCache::debugMemoryUsage(
+    core::CMemoryUsage::TMemoryUsagePtr mem) const {
+    mem->setName("CModelTools::CProbabilityCache::SProbabilityCache");
+    core::CMemoryDebug::dynamicSize("s_Modes", s_Modes, mem);
+    core::CMemoryDebug::dynamicSize("s_Probabilities", s_Probabilities, mem);
+}
+
+std::size_t CModelTools::CProbabilityCache::SProbabilityCache::memoryUsage() const {
+    return core::CMemory::dynamicSize(s_Modes) + core::CMemory::dynamicSize(s_Probabilities);
+}
 }
 }
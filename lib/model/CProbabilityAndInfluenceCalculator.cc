@@ -620,13 +620,16 @@ bool CProbabilityAndInfluenceCalculator::addProbability(model_t::EFeature featur
         return false;
     }
 
-    // Check the cache.
+    // Check the cache. The cache is keyed by the detrended values so it
+    // can be shared between buckets.
+    TDouble2Vec1Vec detrended;
     if (!model_t::isConstant(feature) && m_ProbabilityCache) {
-        TDouble2Vec1Vec values(model_t::stripExtraStatistics(feature, values_));
-        model.detrend(time, params.seasonalConfidenceInterval(), values);
+        detrended = model_t::stripExtraStatistics(feature, values_);
+        model.detrend(time, params.seasonalConfidenceInterval(), detrended);
         bool conditional;
-        if (m_ProbabilityCache->lookup(feature, id, values, probability, tail,
-                                       conditional, mostAnomalousCorrelate)) {
+        if (m_ProbabilityCache->lookup(feature, id, params, detrended, probability,
+                                       tail, conditional, mostAnomalousCorrelate)) {
+            probability = model_t::adjustProbability(feature, elapsedTime, probability);
             m_Probability.add(probability, weight);
             type.set(conditional ? model_t::CResultType::E_Conditional
                                  : model_t::CResultType::E_Unconditional);
@@ -641,16 +644,16 @@ bool CProbabilityAndInfluenceCalculator::addProbability(model_t::EFeature featur
     if (model.probability(params, time, values, probability, tail, conditional,
                           mostAnomalousCorrelate)) {
         if (!model_t::isConstant(feature)) {
-            probability = model_t::adjustProbability(feature, elapsedTime, probability);
-            m_Probability.add(probability, weight);
-            type.set(conditional ? model_t::CResultType::E_Conditional
-                                 : model_t::CResultType::E_Unconditional);
             if (m_ProbabilityCache) {
                 m_ProbabilityCache->addModes(feature, id, model);
-                m_ProbabilityCache->addProbability(feature, id, values,
+                m_ProbabilityCache->addProbability(feature, id, params, detrended,
                                                    probability, tail, conditional,
                                                    mostAnomalousCorrelate);
             }
+            probability = model_t::adjustProbability(feature, elapsedTime, probability);
+            m_Probability.add(probability, weight);
+            type.set(conditional ? model_t::CResultType::E_Conditional
+                                 : model_t::CResultType::E_Unconditional);
         } else {
             type.set(model_t::CResultType::E_Unconditional);
             mostAnomalousCorrelate.clear();
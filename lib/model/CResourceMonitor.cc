@@ -6,6 +6,8 @@
 
 #include <model/CResourceMonitor.h>
 
+#include <core/CMemory.h>
+#include <core/CScopedFastLock.h>
 #include <core/CStatistics.h>
 #include <core/Constants.h>
 
@@ -15,10 +17,20 @@
 
 #include <algorithm>
 #include <limits>
+#include <tuple>
+#include <utility>
 
 namespace ml {
 
 namespace model {
+namespace {
+//! The deferred task the current thread is running.
+struct SCurrentDeferredTask {
+    const CResourceMonitor* s_Monitor;
+    std::size_t s_Task;
+};
+thread_local SCurrentDeferredTask currentDeferredTask{nullptr, 0};
+}
 
 // Only prune once per hour
 const core_t::TTime CResourceMonitor::MINIMUM_PRUNE_FREQUENCY(60 * 60);
@@ -27,13 +39,16 @@ const std::size_t CResourceMonitor::DEFAULT_MEMORY_LIMIT_MB(4096);
 
 CResourceMonitor::CResourceMonitor()
     : m_AllowAllocations(true), m_ByteLimitHigh(0), m_ByteLimitLow(0),
-      m_CurrentAnomalyDetectorMemory(0), m_ExtraMemory(0),
+      m_CurrentAnomalyDetectorMemory(0), m_ExtraMemory(0), m_WorkingMemory(0),
       m_PreviousTotal(this->totalMemory()), m_Peak(m_PreviousTotal),
       m_LastAllocationFailureReport(0), m_MemoryStatus(model_t::E_MemoryStatusOk),
       m_HasPruningStarted(false), m_PruneThreshold(0), m_LastPruneTime(0),
       m_PruneWindow(std::numeric_limits<std::size_t>::max()),
       m_PruneWindowMaximum(std::numeric_limits<std::size_t>::max()),
-      m_PruneWindowMinimum(std::numeric_limits<std::size_t>::max()), m_NoLimit(false) {
+      m_PruneWindowMinimum(std::numeric_limits<std::size_t>::max()), m_NoLimit(false),
+      m_LastVerifiedModel(nullptr), m_SamplingStartMemory(0), m_LargestSamplingGrowth(0),
+      m_DeferRefreshes(false), m_DeferredAnomalyDetectorMemory(0),
+      m_DeferredExtraMemory(0), m_DeferredClearExtraMemory(false) {
     this->updateMemoryLimitsAndPruneThreshold(DEFAULT_MEMORY_LIMIT_MB);
 }
 
@@ -43,10 +58,16 @@ void CResourceMonitor::memoryUsageReporter(const TMemoryUsageReporterFunc& repor
 
 void CResourceMonitor::registerComponent(CAnomalyDetector& detector) {
     LOG_TRACE(<< "Registering component: " << detector.model());
-    m_Models.insert({detector.model().get(), std::size_t(0)});
+    // Detectors may be restored concurrently
+    core::CScopedFastLock lock(m_Mutex);
+    m_Models.emplace(std::piecewise_construct,
+                     std::forward_as_tuple(detector.model().get()),
+                     std::forward_as_tuple(std::size_t(0)));
 }
 
 void CResourceMonitor::unRegisterComponent(CAnomalyDetector& detector) {
+    // Detectors may be restored concurrently
+    core::CScopedFastLock lock(m_Mutex);
     auto iter = m_Models.find(detector.model().get());
     if (iter == m_Models.end()) {
         LOG_ERROR(<< "Inconsistency - component has not been registered: "
@@ -55,9 +76,16 @@ void CResourceMonitor::unRegisterComponent(CAnomalyDetector& detector) {
     }
 
     LOG_TRACE(<< "Unregistering component: " << detector.model());
+    m_CurrentAnomalyDetectorMemory -= iter->second.s_Usage.load();
     m_Models.erase(iter);
 }
 
+std::size_t CResourceMonitor::componentMemoryUsage(const CAnomalyDetector& detector) const {
+    core::CScopedFastLock lock(m_Mutex);
+    auto iter = m_Models.find(detector.model().get());
+    return iter == m_Models.end() ? 0 : iter->second.s_Usage.load();
+}
+
 void CResourceMonitor::memoryLimit(std::size_t limitMBs) {
     this->updateMemoryLimitsAndPruneThreshold(limitMBs);
 
@@ -107,11 +135,22 @@ void CResourceMonitor::refresh(CAnomalyDetector& detector) {
 
 void CResourceMonitor::forceRefresh(CAnomalyDetector& detector) {
     this->memUsage(detector.model().get());
+
+    if (m_DeferRefreshes) {
+        return;
+    }
+
     core::CStatistics::stat(stat_t::E_MemoryUsage).set(this->totalMemory());
     LOG_TRACE(<< "Checking allocations: currently at " << this->totalMemory());
     this->updateAllowAllocations();
 }
 
+std::size_t CResourceMonitor::verifyMemoryUsage(const CAnomalyDetector& detector) {
+    CAnomalyDetectorModel* model{detector.model().get()};
+    const SModelUsage* modelUsage{this->modelUsage(model)};
+    return modelUsage == nullptr ? 0 : this->verify(model, modelUsage->s_Usage.load());
+}
+
 void CResourceMonitor::updateAllowAllocations() {
     std::size_t total{this->totalMemory()};
     if (m_AllowAllocations) {
@@ -167,13 +206,10 @@ bool CResourceMonitor::pruneIfRequired(core_t::TTime endTime) {
     if (aboveThreshold) {
         // Do a prune and see how much we got back
         // These are the expensive operations
-        std::size_t usageAfter = 0;
         for (auto& model : m_Models) {
             model.first->prune(m_PruneWindow);
-            model.second = model.first->memoryUsage();
-            usageAfter += model.second;
+            this->memUsage(model.first);
         }
-        m_CurrentAnomalyDetectorMemory = usageAfter;
         total = this->totalMemory();
         this->updateAllowAllocations();
     }
@@ -215,15 +251,53 @@ std::size_t CResourceMonitor::allocationLimit() const {
 }
 
 void CResourceMonitor::memUsage(CAnomalyDetectorModel* model) {
+    this->memUsage(model, core::CMemory::dynamicSize(model));
+}
+
+std::size_t CResourceMonitor::verify(const CAnomalyDetectorModel* model, std::size_t usage) {
+    std::size_t walked{model->walkMemoryUsage()};
+    std::size_t drift{std::max(walked, usage) - std::min(walked, usage)};
+    LOG_TRACE(<< "Verified memory usage of " << model << ": refreshed "
+              << usage << ", walked " << walked);
+    core::CStatistics::stat(stat_t::E_NumberMemoryUsageVerifications).increment();
+    core::CStatistics::stat(stat_t::E_MemoryUsageDrift).set(drift);
+    return drift;
+}
+
+void CResourceMonitor::verifyNextModel() {
+    if (m_Models.empty()) {
+        return;
+    }
+    auto next = m_Models.upper_bound(m_LastVerifiedModel);
+    if (next == m_Models.end()) {
+        next = m_Models.begin();
+    }
+    m_LastVerifiedModel = next->first;
+    this->verify(next->first, next->second.s_Usage.load());
+}
+
+CResourceMonitor::SModelUsage* CResourceMonitor::modelUsage(CAnomalyDetectorModel* model) {
+    // Detectors may be refreshed concurrently with others being restored
+    core::CScopedFastLock lock(m_Mutex);
     auto iter = m_Models.find(model);
     if (iter == m_Models.end()) {
         LOG_ERROR(<< "Inconsistency - component has not been registered: " << model);
+        return nullptr;
+    }
+    // Map entries aren't moved by inserting others
+    return &iter->second;
+}
+
+void CResourceMonitor::memUsage(CAnomalyDetectorModel* model, std::size_t modelCurrentUsage) {
+    SModelUsage* modelUsage{this->modelUsage(model)};
+    if (modelUsage == nullptr) {
         return;
     }
-    std::size_t modelPreviousUsage = iter->second;
-    std::size_t modelCurrentUsage = core::CMemory::dynamicSize(iter->first);
-    iter->second = modelCurrentUsage;
-    m_CurrentAnomalyDetectorMemory += (modelCurrentUsage - modelPreviousUsage);
+    std::size_t modelPreviousUsage{modelUsage->s_Usage.exchange(modelCurrentUsage)};
+    // Unsigned arithmetic wraps so this also handles decreases.
+    TAtomicSize& total{m_DeferRefreshes ? m_DeferredAnomalyDetectorMemory
+                                        : m_CurrentAnomalyDetectorMemory};
+    total.fetch_add(modelCurrentUsage - modelPreviousUsage);
 }
 
 void CResourceMonitor::sendMemoryUsageReportIfSignificantlyChanged(core_t::TTime bucketStartTime) {
@@ -250,6 +324,7 @@ bool CResourceMonitor::needToSendReport() {
 }
 
 void CResourceMonitor::sendMemoryUsageReport(core_t::TTime bucketStartTime) {
+    this->verifyNextModel();
     std::size_t total{this->totalMemory()};
     m_Peak = std::max(m_Peak, total);
     if (m_MemoryUsageReporter) {
@@ -280,6 +355,7 @@ CResourceMonitor::SResults CResourceMonitor::createMemoryUsageReport(core_t::TTi
 }
 
 void CResourceMonitor::acceptAllocationFailureResult(core_t::TTime time) {
+    core::CScopedFastLock lock(m_Mutex);
     m_MemoryStatus = model_t::E_MemoryStatusHardLimit;
     ++m_AllocationFailures[time];
 }
@@ -295,22 +371,136 @@ bool CResourceMonitor::haveNoLimit() const {
 }
 
 void CResourceMonitor::addExtraMemory(std::size_t mem) {
+    if (m_DeferRefreshes) {
+        SDeferredExtraMemory* task{this->deferredTask()};
+        if (task != nullptr) {
+            task->s_Extra += mem;
+        } else {
+            m_DeferredExtraMemory += mem;
+        }
+        return;
+    }
+
     m_ExtraMemory += mem;
     this->updateAllowAllocations();
 }
 
 void CResourceMonitor::clearExtraMemory() {
+    if (m_DeferRefreshes) {
+        SDeferredExtraMemory* task{this->deferredTask()};
+        if (task != nullptr) {
+            task->s_Cleared = true;
+            task->s_Extra = 0;
+        } else {
+            m_DeferredClearExtraMemory = true;
+        }
+        return;
+    }
+
     if (m_ExtraMemory != 0) {
         m_ExtraMemory = 0;
         this->updateAllowAllocations();
     }
 }
 
+void CResourceMonitor::workingMemoryUsage(std::size_t usage) {
+    if (usage != m_WorkingMemory) {
+        m_WorkingMemory = usage;
+        if (m_DeferRefreshes == false) {
+            this->updateAllowAllocations();
+        }
+    }
+}
+
+bool CResourceMonitor::canDeferRefreshes(std::size_t extraMemory) const {
+    return m_NoLimit || (m_AllowAllocations && m_MemoryStatus == model_t::E_MemoryStatusOk &&
+                         this->totalMemory() + extraMemory < m_PruneThreshold);
+}
+
+bool CResourceMonitor::canDeferSampling(std::size_t pendingMemory) const {
+    return this->canDeferRefreshes(pendingMemory + m_LargestSamplingGrowth);
+}
+
+void CResourceMonitor::startSampling() {
+    m_SamplingStartMemory = m_CurrentAnomalyDetectorMemory;
+}
+
+void CResourceMonitor::finishSampling() {
+    std::size_t memory{m_CurrentAnomalyDetectorMemory};
+    if (memory > m_SamplingStartMemory) {
+        m_LargestSamplingGrowth =
+            std::max(m_LargestSamplingGrowth, memory - m_SamplingStartMemory);
+    }
+}
+
+void CResourceMonitor::deferRefreshes(std::size_t numberTasks) {
+    m_DeferredTasks.assign(numberTasks, SDeferredExtraMemory());
+    m_DeferRefreshes = true;
+}
+
+void CResourceMonitor::commitDeferredRefreshes() {
+    m_DeferRefreshes = false;
+    bool tasksChangedExtraMemory{std::any_of(
+        m_DeferredTasks.begin(), m_DeferredTasks.end(), [](const SDeferredExtraMemory& task) {
+            return task.s_Cleared || task.s_Extra > 0;
+        })};
+    if (m_DeferredAnomalyDetectorMemory == 0 && m_DeferredExtraMemory == 0 &&
+        m_DeferredClearExtraMemory == false && tasksChangedExtraMemory == false) {
+        m_DeferredTasks.clear();
+        return;
+    }
+
+    // The totals are sums so the order in which the usages were computed
+    // doesn't matter.
+    m_CurrentAnomalyDetectorMemory += m_DeferredAnomalyDetectorMemory.exchange(0);
+    if (m_DeferredClearExtraMemory.exchange(false)) {
+        m_ExtraMemory = 0;
+    }
+    m_ExtraMemory += m_DeferredExtraMemory.exchange(0);
+
+    // Clearing doesn't commute with adding so the tasks' extra memory is
+    // replayed in the order they'd have run one at a time.
+    for (const auto& task : m_DeferredTasks) {
+        if (task.s_Cleared) {
+            m_ExtraMemory = 0;
+        }
+        m_ExtraMemory += task.s_Extra;
+    }
+    m_DeferredTasks.clear();
+
+    core::CStatistics::stat(stat_t::E_MemoryUsage).set(this->totalMemory());
+    LOG_TRACE(<< "Checking allocations: currently at " << this->totalMemory());
+    this->updateAllowAllocations();
+}
+
+CResourceMonitor::SDeferredExtraMemory* CResourceMonitor::deferredTask() {
+    if (currentDeferredTask.s_Monitor != this ||
+        currentDeferredTask.s_Task >= m_DeferredTasks.size()) {
+        return nullptr;
+    }
+    // Each task is only run by one thread so it can be updated without
+    // synchronisation.
+    return &m_DeferredTasks[currentDeferredTask.s_Task];
+}
+
 std::size_t CResourceMonitor::totalMemory() const {
-    return m_CurrentAnomalyDetectorMemory + m_ExtraMemory +
+    return m_CurrentAnomalyDetectorMemory + m_ExtraMemory + m_WorkingMemory +
            CStringStore::names().memoryUsage() +
            CStringStore::influencers().memoryUsage();
 }
 
+CResourceMonitor::CScopedDeferredTask::CScopedDeferredTask(const CResourceMonitor& monitor,
+                                                            std::size_t task)
+    : m_PreviousMonitor{currentDeferredTask.s_Monitor},
+      m_PreviousTask{currentDeferredTask.s_Task} {
+    currentDeferredTask.s_Monitor = &monitor;
+    currentDeferredTask.s_Task = task;
+}
+
+CResourceMonitor::CScopedDeferredTask::~CScopedDeferredTask() {
+    currentDeferredTask.s_Monitor = m_PreviousMonitor;
+    currentDeferredTask.s_Task = m_PreviousTask;
+}
+
 } // model
 } // ml
@@ -12,7 +12,8 @@
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
 
-#include <boost/bind.hpp>
+#include <algorithm>
+#include <thread>
 
 namespace ml {
 namespace model {
@@ -34,6 +35,12 @@ struct SStrStoredStringPtrEqual {
     }
 } STR_EQUAL;
 
+//! \brief Helper class to supply the precomputed hash of a std::string.
+struct SPrecomputedHash {
+    std::size_t operator()(const std::string& /*key*/) const { return s_Hash; }
+    std::size_t s_Hash;
+};
+
 // To ensure the singletons are constructed before multiple threads may
 // require them call instance() during the static initialisation phase
 // of the program.  Of course, the instance may already be constructed
@@ -42,18 +49,21 @@ const CStringStore& DO_NOT_USE_THIS_VARIABLE = CStringStore::names();
 const CStringStore& DO_NOT_USE_THIS_VARIABLE_EITHER = CStringStore::influencers();
 }
 
-void CStringStore::tidyUpNotThreadSafe() {
-    names().pruneRemovedNotThreadSafe();
-    influencers().pruneNotThreadSafe();
+const std::size_t CStringStore::NUMBER_SHARDS{16};
+const std::size_t CStringStore::THREAD_CACHE_SIZE{64};
+
+void CStringStore::tidyUp() {
+    names().pruneRemoved();
+    influencers().prune();
 }
 
 CStringStore& CStringStore::names() {
-    static CStringStore namesInstance;
+    static CStringStore namesInstance{0};
     return namesInstance;
 }
 
 CStringStore& CStringStore::influencers() {
-    static CStringStore influencersInstance;
+    static CStringStore influencersInstance{1};
     return influencersInstance;
 }
 
@@ -62,90 +72,92 @@ const core::CStoredStringPtr& CStringStore::getEmpty() const {
 }
 
 core::CStoredStringPtr CStringStore::get(const std::string& value) {
-    // This section is expected to be performed frequently.
-    //
-    // We ensure either:
-    //   1) Some threads may perform an insert and no thread will perform
-    //      a find until no threads can still perform an insert.
-    //   2) Some threads may perform a find and no thread will perform
-    //      an insert until no thread can still perform a find.
-    //
-    // We "leak" strings if there is contention between reading and writing,
-    // which is expected to be rare because inserts are expected to be rare.
-
     if (value.empty()) {
         return m_EmptyString;
     }
 
-    core::CStoredStringPtr result;
-
-    m_Reading.fetch_add(1, std::memory_order_release);
-    if (m_Writing.load(std::memory_order_consume) == 0) {
-        auto i = m_Strings.find(value, STR_HASH, STR_EQUAL);
-        if (i != m_Strings.end()) {
-            result = *i;
-            m_Reading.fetch_sub(1, std::memory_order_release);
-        } else {
-            m_Writing.fetch_add(1, std::memory_order_acq_rel);
-            // NB: fetch_sub() returns the OLD value, and we know we added 1 in
-            // this thread, hence the test for 1 rather than 0
-            if (m_Reading.fetch_sub(1, std::memory_order_release) == 1) {
-                // This section is expected to occur infrequently so inserts
-                // are synchronized with a mutex.
-                core::CScopedFastLock lock(m_Mutex);
-                auto ret = m_Strings.insert(core::CStoredStringPtr::makeStoredString(value));
-                result = *ret.first;
-                if (ret.second) {
-                    m_StoredStringsMemUse += result.actualMemoryUsage();
-                }
-                m_Writing.fetch_sub(1, std::memory_order_release);
-            } else {
-                m_Writing.fetch_sub(1, std::memory_order_relaxed);
-                // This is leaked in the sense that it will never be shared and
-                // won't count towards our reported memory usage.  But it is not
-                // leaked in the traditional sense of the word, as its memory
-                // will be freed when the single user is finished with it.
-                result = core::CStoredStringPtr::makeStoredString(value);
-            }
-        }
-    } else {
-        m_Reading.fetch_sub(1, std::memory_order_relaxed);
-        // This is leaked in the sense that it will never be shared and won't
-        // count towards our reported memory usage.  But it is not leaked
-        // in the traditional sense of the word, as its memory will be freed
-        // when the single user is finished with it.
-        result = core::CStoredStringPtr::makeStoredString(value);
+    std::size_t hash{STR_HASH(value)};
+
+    // The low bits of the hash select the shard so use the next ones to
+    // select the cache entry.
+    auto& entry = this->threadCache()[(hash / NUMBER_SHARDS) % THREAD_CACHE_SIZE];
+    core::CStoredStringPtr result{this->lookUpCache(entry, hash, value)};
+    if (result) {
+        return result;
     }
 
+    std::size_t prunes{m_Prunes.load()};
+    result = this->shard(hash).get(value, hash);
+    entry = SCacheEntry{hash, prunes, core::CStoredStringPtr::CWeak{result}};
     return result;
 }
 
+void CStringStore::get(const TOptionalStrVec& values, TStoredStringPtrVec& result) {
+    result.assign(values.size(), core::CStoredStringPtr());
+
+    TCacheEntryVec& cache{this->threadCache()};
+
+    // Look up the values in the cache and order the misses by shard so
+    // that we visit each shard once.
+    TSizeVec hashes(values.size(), 0);
+    TSizeVec misses;
+    for (std::size_t i = 0u; i < values.size(); ++i) {
+        if (!values[i]) {
+            continue;
+        }
+        const std::string& value{*values[i]};
+        if (value.empty()) {
+            result[i] = m_EmptyString;
+            continue;
+        }
+        hashes[i] = STR_HASH(value);
+        result[i] = this->lookUpCache(
+            cache[(hashes[i] / NUMBER_SHARDS) % THREAD_CACHE_SIZE], hashes[i], value);
+        if (!result[i]) {
+            misses.push_back(i);
+        }
+    }
+    std::stable_sort(misses.begin(), misses.end(), [&hashes](std::size_t lhs, std::size_t rhs) {
+        return hashes[lhs] % NUMBER_SHARDS < hashes[rhs] % NUMBER_SHARDS;
+    });
+
+    std::size_t prunes{m_Prunes.load()};
+    for (auto i : misses) {
+        result[i] = this->shard(hashes[i]).get(*values[i], hashes[i]);
+        cache[(hashes[i] / NUMBER_SHARDS) % THREAD_CACHE_SIZE] =
+            SCacheEntry{hashes[i], prunes, core::CStoredStringPtr::CWeak{result[i]}};
+    }
+}
+
 void CStringStore::remove(const std::string& value) {
-    core::CScopedFastLock lock(m_Mutex);
-    m_Removed.push_back(value);
+    SShard& shard{this->shard(STR_HASH(value))};
+    core::CScopedFastLock lock(shard.s_Mutex);
+    shard.s_Removed.push_back(value);
+    shard.updateMemoryUsage();
 }
 
-void CStringStore::pruneRemovedNotThreadSafe() {
-    core::CScopedFastLock lock(m_Mutex);
-    for (const auto& removed : m_Removed) {
-        auto i = m_Strings.find(removed, STR_HASH, STR_EQUAL);
-        if (i != m_Strings.end() && i->isUnique()) {
-            m_StoredStringsMemUse -= i->actualMemoryUsage();
-            m_Strings.erase(i);
+void CStringStore::pruneRemoved() {
+    for (auto& shard : m_Shards) {
+        TStrVec removed;
+        {
+            core::CScopedFastLock lock(shard->s_Mutex);
+            removed.swap(shard->s_Removed);
+            shard->updateMemoryUsage();
+        }
+        if (removed.size() > 0) {
+            std::sort(removed.begin(), removed.end());
+            m_Prunes.fetch_add(1);
+            shard->erase([&removed](const core::CStoredStringPtr& value) {
+                return std::binary_search(removed.begin(), removed.end(), *value);
+            });
         }
     }
-    m_Removed.clear();
 }
 
-void CStringStore::pruneNotThreadSafe() {
-    core::CScopedFastLock lock(m_Mutex);
-    for (auto i = m_Strings.begin(); i != m_Strings.end(); /**/) {
-        if (i->isUnique()) {
-            m_StoredStringsMemUse -= i->actualMemoryUsage();
-            i = m_Strings.erase(i);
-        } else {
-            ++i;
-        }
+void CStringStore::prune() {
+    m_Prunes.fetch_add(1);
+    for (auto& shard : m_Shards) {
+        shard->erase([](const core::CStoredStringPtr&) { return true; });
     }
 }
 
@@ -155,43 +167,207 @@ void CStringStore::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) con
                      : (this == &CStringStore::influencers() ? "influencers StringStore"
                                                              : "unknown StringStore"));
     mem->addItem("empty string ptr", m_EmptyString.actualMemoryUsage());
-    core::CScopedFastLock lock(m_Mutex);
-    core::CMemoryDebug::dynamicSize("stored strings", m_Strings, mem);
-    core::CMemoryDebug::dynamicSize("removed strings", m_Removed, mem);
-    mem->addItem("stored string ptr memory", m_StoredStringsMemUse);
+    core::CMemoryDebug::dynamicSize("shards", m_Shards, mem);
+    std::size_t storedStringsMemUse{0};
+    for (const auto& shard : m_Shards) {
+        core::CScopedFastLock lock(shard->s_Mutex);
+        core::CMemoryDebug::dynamicSize("stored strings", shard->s_Strings, mem);
+        core::CMemoryDebug::dynamicSize("removed strings", shard->s_Removed, mem);
+        storedStringsMemUse += shard->s_StoredStringsMemUse;
+    }
+    mem->addItem("stored string ptr memory", storedStringsMemUse);
 }
 
 std::size_t CStringStore::memoryUsage() const {
     std::size_t mem = m_EmptyString.actualMemoryUsage();
-    core::CScopedFastLock lock(m_Mutex);
-    // The assumption here is that the existence of
-    // core::CStoredStringPtr::dynamicSizeAlwaysZero() combined with dead code
-    // elimination will make calculating the size of m_Strings boil down to a
-    // couple of simple multiplications and additions
-    mem += core::CMemory::dynamicSize(m_Strings);
-    // This one could be more expensive, but the assumption is that there won't
-    // be many memory usage calculations while m_Removed is populated
-    mem += core::CMemory::dynamicSize(m_Removed);
-    // This adds back the size that was excluded from
-    // core::CMemory::dynamicSize(m_Strings)
-    mem += m_StoredStringsMemUse;
+    mem += core::CMemory::dynamicSize(m_Shards);
+    mem += m_MemoryUsage.load(std::memory_order_relaxed);
     return mem;
 }
 
-CStringStore::CStringStore()
-    : m_Reading(0), m_Writing(0),
-      m_EmptyString(core::CStoredStringPtr::makeStoredString(std::string())),
-      m_StoredStringsMemUse(0) {
+CStringStore::CStringStore(std::size_t index)
+    : m_Index(index), m_EmptyString(core::CStoredStringPtr::makeStoredString(std::string())),
+      m_MemoryUsage(0), m_Prunes(0) {
+    m_Shards.reserve(NUMBER_SHARDS);
+    for (std::size_t i = 0u; i < NUMBER_SHARDS; ++i) {
+        m_Shards.emplace_back(new SShard(m_MemoryUsage));
+    }
+}
+
+CStringStore::TCacheEntryVec& CStringStore::threadCache() const {
+    static thread_local TCacheEntryVec caches[]{TCacheEntryVec(THREAD_CACHE_SIZE),
+                                                TCacheEntryVec(THREAD_CACHE_SIZE)};
+    return caches[m_Index];
+}
+
+core::CStoredStringPtr CStringStore::lookUpCache(const SCacheEntry& entry,
+                                                 std::size_t hash,
+                                                 const std::string& value) const {
+    if (entry.s_Hash == hash) {
+        core::CStoredStringPtr result{entry.s_String.lock()};
+        // The string may have been removed from its shard if a prune has
+        // started since it was cached.  This is checked after taking the
+        // reference because a prune only removes strings it holds the only
+        // reference to.
+        if (result && m_Prunes.load() == entry.s_Prunes && *result == value) {
+            return result;
+        }
+    }
+    return core::CStoredStringPtr();
+}
+
+CStringStore::SShard& CStringStore::shard(std::size_t hash) const {
+    return *m_Shards[hash % NUMBER_SHARDS];
+}
+
+std::size_t CStringStore::size() const {
+    std::size_t result{0};
+    for (const auto& shard : m_Shards) {
+        core::CScopedFastLock lock(shard->s_Mutex);
+        result += shard->s_Strings.size();
+    }
+    return result;
 }
 
 void CStringStore::clearEverythingTestOnly() {
+    // Strings the test still holds would otherwise be found in the cache.
+    this->threadCache().assign(THREAD_CACHE_SIZE, SCacheEntry());
     // For tests that assert on memory usage it's important that these
     // containers get returned to the state of a default constructed container
-    TStoredStringPtrUSet emptySet;
-    emptySet.swap(m_Strings);
-    TStrVec emptyVec;
-    emptyVec.swap(m_Removed);
-    m_StoredStringsMemUse = 0;
+    for (auto& shard : m_Shards) {
+        TStoredStringPtrUSet emptySet;
+        emptySet.swap(shard->s_Strings);
+        TStrVec emptyVec;
+        emptyVec.swap(shard->s_Removed);
+        shard->s_StoredStringsMemUse = 0;
+        shard->updateMemoryUsage();
+    }
+}
+
+CStringStore::SShard::SShard(std::atomic<std::size_t>& memoryUsage)
+    : s_Reading(0), s_Writing(0), s_StoredStringsMemUse(0), s_MemoryUsage(0),
+      s_StoreMemoryUsage(memoryUsage) {
+    this->updateMemoryUsage();
+}
+
+core::CStoredStringPtr CStringStore::SShard::get(const std::string& value,
+                                                 std::size_t hash) {
+    // This section is expected to be performed frequently.
+    //
+    // We ensure either:
+    //   1) Some threads may perform an insert and no thread will perform
+    //      a find until no threads can still perform an insert.
+    //   2) Some threads may perform a find and no thread will perform
+    //      an insert until no thread can still perform a find.
+    //
+    // The fences are sequentially consistent because each side must see
+    // the other's increment before it proceeds.
+
+    SPrecomputedHash precomputedHash{hash};
+
+    s_Reading.fetch_add(1);
+    if (s_Writing.load() == 0) {
+        auto i = s_Strings.find(value, precomputedHash, STR_EQUAL);
+        if (i != s_Strings.end()) {
+            core::CStoredStringPtr result{*i};
+            s_Reading.fetch_sub(1, std::memory_order_release);
+            return result;
+        }
+        s_Writing.fetch_add(1);
+        // NB: fetch_sub() returns the OLD value, and we know we added 1 in
+        // this thread, hence the test for 1 rather than 0
+        if (s_Reading.fetch_sub(1) == 1) {
+            // This section is expected to occur infrequently so inserts
+            // are synchronized with a mutex.
+            core::CScopedFastLock lock(s_Mutex);
+            core::CStoredStringPtr result{this->findOrInsert(value, hash)};
+            s_Writing.fetch_sub(1, std::memory_order_release);
+            return result;
+        }
+        s_Writing.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+        s_Reading.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // There is contention between reading and writing, which is expected
+    // to be rare because inserts are expected to be rare.  Stored strings
+    // are compared by address so we mustn't return a copy: wait for the
+    // other writers and the readers to finish then find or insert the
+    // string.  Readers never wait on the mutex while they hold the read
+    // fence so this can't deadlock.
+    core::CScopedFastLock lock(s_Mutex);
+    s_Writing.fetch_add(1);
+    while (s_Reading.load() != 0) {
+        std::this_thread::yield();
+    }
+    core::CStoredStringPtr result{this->findOrInsert(value, hash)};
+    s_Writing.fetch_sub(1, std::memory_order_release);
+    return result;
+}
+
+core::CStoredStringPtr CStringStore::SShard::findOrInsert(const std::string& value,
+                                                          std::size_t hash) {
+    auto i = s_Strings.find(value, SPrecomputedHash{hash}, STR_EQUAL);
+    if (i != s_Strings.end()) {
+        return *i;
+    }
+    core::CStoredStringPtr result{core::CStoredStringPtr::makeStoredString(value)};
+    s_Strings.insert(result);
+    s_StoredStringsMemUse += result.actualMemoryUsage();
+    this->updateMemoryUsage();
+    return result;
+}
+
+template<typename PRED>
+void CStringStore::SShard::erase(PRED pred) {
+    // Stop new lookups using the set and wait for those in progress to
+    // finish. Lookups of strings in this shard wait on the mutex until
+    // we're done.
+    s_Writing.fetch_add(1);
+    while (s_Reading.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    {
+        core::CScopedFastLock lock(s_Mutex);
+        // A string is only in use elsewhere if we don't hold the only
+        // reference to it. While we block lookups new references can only
+        // be created from a thread cache, and the store counted the prune
+        // before it started so these aren't returned: see lookUpCache.
+        for (auto i = s_Strings.begin(); i != s_Strings.end(); /**/) {
+            if (i->isUnique() && pred(*i)) {
+                s_StoredStringsMemUse -= i->actualMemoryUsage();
+                i = s_Strings.erase(i);
+            } else {
+                ++i;
+            }
+        }
+        // Erasing doesn't free the buckets, which count towards the memory
+        // usage, so release them if the set is empty
+        if (s_Strings.empty()) {
+            TStoredStringPtrUSet emptySet;
+            emptySet.swap(s_Strings);
+        }
+        this->updateMemoryUsage();
+    }
+
+    s_Writing.fetch_sub(1, std::memory_order_release);
+}
+
+void CStringStore::SShard::updateMemoryUsage() {
+    // The assumption here is that the existence of
+    // core::CStoredStringPtr::dynamicSizeAlwaysZero() combined with dead code
+    // elimination will make calculating the size of the strings boil down to
+    // a couple of simple multiplications and additions. The removed strings
+    // could be more expensive, but the assumption is that there won't be
+    // many waiting removal. s_StoredStringsMemUse adds back the size that
+    // was excluded from core::CMemory::dynamicSize(s_Strings).
+    std::size_t memoryUsage{core::CMemory::dynamicSize(s_Strings) +
+                            core::CMemory::dynamicSize(s_Removed) +
+                            s_StoredStringsMemUse};
+    // Unsigned arithmetic wraps so this also handles decreases.
+    s_StoreMemoryUsage.fetch_add(memoryUsage - s_MemoryUsage, std::memory_order_relaxed);
+    s_MemoryUsage = memoryUsage;
 }
 
 } // model
@@ -84,6 +84,10 @@ void CAnomalyDetectorModelConfigTest::testNormal() {
                              config.factory(1, POPULATION_COUNT)->modelParams().s_SampleCountFactor);
         CPPUNIT_ASSERT_EQUAL(std::size_t(20),
                              config.factory(1, POPULATION_METRIC)->modelParams().s_SampleCountFactor);
+        CPPUNIT_ASSERT(config.factory(1, INDIVIDUAL_COUNT)->modelParams().s_PruneResidualModels);
+        CPPUNIT_ASSERT(config.factory(1, INDIVIDUAL_METRIC)->modelParams().s_PruneResidualModels);
+        CPPUNIT_ASSERT(config.factory(1, POPULATION_COUNT)->modelParams().s_PruneResidualModels);
+        CPPUNIT_ASSERT(config.factory(1, POPULATION_METRIC)->modelParams().s_PruneResidualModels);
         TDoubleVec params;
         for (std::size_t i = 0u; i < model_t::NUMBER_AGGREGATION_STYLES; ++i) {
             for (std::size_t j = 0u; j < model_t::NUMBER_AGGREGATION_PARAMS; ++j) {
@@ -469,6 +469,72 @@ void CAnomalyScoreTest::testNormalizeScoresOrdering() {
     }
 }
 
+void CAnomalyScoreTest::testNormalizeScoresLookupTable() {
+    // Test that normalizing with the lookup tables gives identical results
+    // to the direct calculation, including after the quantiles are updated,
+    // aged and restored.
+
+    test::CRandomNumbers rng;
+
+    model::CAnomalyDetectorModelConfig config =
+        model::CAnomalyDetectorModelConfig::defaultConfig(1800);
+    model::CAnomalyScore::CNormalizer direct(config);
+    config.normalizerLookupTables(true);
+    model::CAnomalyScore::CNormalizer lookup(config);
+
+    auto update = [&](std::size_t n) {
+        TDoubleVec samples;
+        rng.generateGammaSamples(1.0, 2.0, n, samples);
+        TDoubleVec u;
+        rng.generateUniformSamples(0.0, 1.0, n, u);
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            if (samples[i] < 0.5) {
+                samples[i] = 0.0;
+            } else if (u[i] < 0.01) {
+                samples[i] += 10000.0 * u[i];
+            }
+            CPPUNIT_ASSERT_EQUAL(direct.updateQuantiles(samples[i]),
+                                 lookup.updateQuantiles(samples[i]));
+        }
+    };
+
+    auto check = [&](const model::CAnomalyScore::CNormalizer& normalizer) {
+        TDoubleVec scores;
+        rng.generateUniformSamples(0.0, 150.0, 2000, scores);
+        TDoubleVec small;
+        rng.generateUniformSamples(0.0, 2.0, 500, small);
+        scores.insert(scores.end(), small.begin(), small.end());
+        scores.push_back(0.0);
+        scores.push_back(1000.0);
+        for (std::size_t i = 0u; i < scores.size(); ++i) {
+            double expected = scores[i];
+            double actual = scores[i];
+            CPPUNIT_ASSERT_EQUAL(direct.normalize(expected), normalizer.normalize(actual));
+            CPPUNIT_ASSERT_EQUAL(expected, actual);
+        }
+    };
+
+    for (std::size_t i = 0u; i < 5; ++i) {
+        LOG_DEBUG(<< "round " << i);
+        update(500);
+        check(lookup);
+        check(lookup);
+        direct.propagateForwardByTime(2.0 * 86400.0);
+        lookup.propagateForwardByTime(2.0 * 86400.0);
+        check(lookup);
+    }
+
+    std::string json;
+    model::CAnomalyScore::normalizerToJson(lookup, "test", "test", "test", 1234567890, json);
+    model::CAnomalyScore::CNormalizer restored(config);
+    CPPUNIT_ASSERT(model::CAnomalyScore::normalizerFromJson(json, restored));
+    check(restored);
+
+    lookup.clear();
+    direct.clear();
+    check(lookup);
+}
+
 void CAnomalyScoreTest::testJsonConversion() {
     test::CRandomNumbers rng;
 
@@ -606,6 +672,9 @@ CppUnit::Test* CAnomalyScoreTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
         "CAnomalyScoreTest::testNormalizeScoresOrdering",
         &CAnomalyScoreTest::testNormalizeScoresOrdering));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
+        "CAnomalyScoreTest::testNormalizeScoresLookupTable",
+        &CAnomalyScoreTest::testNormalizeScoresLookupTable));
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
         "CAnomalyScoreTest::testJsonConversion", &CAnomalyScoreTest::testJsonConversion));
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
@@ -22,6 +22,7 @@ public:
     void testNormalizeScoresLargeScore();
     void testNormalizeScoresNearZero();
     void testNormalizeScoresOrdering();
+    void testNormalizeScoresLookupTable();
     void testJsonConversion();
     void testPersistEmpty();
 
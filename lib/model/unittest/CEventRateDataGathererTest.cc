@@ -27,6 +27,7 @@
 
 #include <boost/range.hpp>
 
+#include <fstream>
 #include <utility>
 #include <vector>
 
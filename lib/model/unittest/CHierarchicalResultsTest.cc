@@ -8,9 +8,11 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/CMonotonicArena.h>
 #include <core/CRapidXmlParser.h>
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CStringUtils.h>
 
 #include <maths/CStatisticalTests.h>
 #include <maths/CTools.h>
@@ -1952,6 +1954,71 @@ void CHierarchicalResultsTest::testShouldWritePartition() {
         limits, results, *extract.partitionNodes()[1], false));
 }
 
+void CHierarchicalResultsTest::testArena() {
+    // Check that building and aggregating the results in an arena gives
+    // the same results as using the heap and that the arena serves most
+    // of the allocations.
+
+    static const std::string FUNC("max");
+    static const ml::model::function_t::EFunction function(ml::model::function_t::E_IndividualMetricMax);
+    static const std::string PART1("PART1");
+    static const std::string PERS("PERS");
+    static const std::string VAL1("VAL1");
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec probabilities;
+    rng.generateUniformSamples(0.0, 1.0, 200, probabilities);
+
+    TStrVec partitions;
+    TStrVec people;
+    for (std::size_t i = 0; i < 10; ++i) {
+        partitions.push_back("part" + core::CStringUtils::typeToString(i));
+        people.push_back("pers" + core::CStringUtils::typeToString(i));
+    }
+
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig();
+
+    auto computeRoot = [&](model::CHierarchicalResults& results) {
+        for (std::size_t i = 0; i < probabilities.size(); ++i) {
+            addResult(static_cast<int>(i % 3), false, FUNC, function, PART1,
+                      partitions[(i / 10) % partitions.size()], PERS,
+                      people[i % people.size()], VAL1, probabilities[i], results);
+        }
+        results.buildHierarchy();
+        model::CHierarchicalResultsAggregator aggregator(modelConfig);
+        results.bottomUpBreadthFirst(aggregator);
+        CPPUNIT_ASSERT(results.root());
+        return std::make_pair(results.root()->s_RawAnomalyScore,
+                              results.root()->probability());
+    };
+
+    model::CHierarchicalResults heapResults;
+    auto expected = computeRoot(heapResults);
+
+    core::CMonotonicArena arena;
+    for (std::size_t i = 0; i < 3; ++i) {
+        core::CScopedMonotonicArena scopedArena(arena, false);
+        model::CHierarchicalResults arenaResults;
+        auto actual = computeRoot(arenaResults);
+        LOG_DEBUG(<< "expected = " << core::CContainerPrinter::print(expected)
+                  << ", actual = " << core::CContainerPrinter::print(actual));
+        CPPUNIT_ASSERT_EQUAL(expected.first, actual.first);
+        CPPUNIT_ASSERT_EQUAL(expected.second, actual.second);
+
+        const core::CMonotonicArena::SStatistics& statistics = arena.statistics();
+        LOG_DEBUG(<< "allocations = " << statistics.s_Allocations
+                  << ", heap allocations = " << statistics.s_HeapAllocations);
+        CPPUNIT_ASSERT(statistics.s_Allocations > 100);
+        CPPUNIT_ASSERT(statistics.s_Allocations > 20 * statistics.s_HeapAllocations);
+        arena.reset();
+    }
+
+    // After the first reset the arena has enough space for a bucket.
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), arena.statistics().s_HeapAllocations);
+}
+
 CppUnit::Test* CHierarchicalResultsTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CHierarchicalResultsTest");
 
@@ -1985,6 +2052,8 @@ CppUnit::Test* CHierarchicalResultsTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CHierarchicalResultsTest>(
         "CHierarchicalResultsTest::testShouldWritePartition",
         &CHierarchicalResultsTest::testShouldWritePartition));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CHierarchicalResultsTest>(
+        "CHierarchicalResultsTest::testArena", &CHierarchicalResultsTest::testArena));
 
     return suiteOfTests;
 }
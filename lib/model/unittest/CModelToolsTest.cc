@@ -8,6 +8,7 @@
 
 #include <core/CLogger.h>
 #include <core/CSmallVector.h>
+#include <core/CStatistics.h>
 
 #include <maths/CMultimodalPrior.h>
 #include <maths/CNormalMeanPrecConjugate.h>
@@ -257,7 +258,7 @@ void CModelToolsTest::testProbabilityCache() {
 
             double probability;
             TTail2Vec tail;
-            if (cache.lookup(feature, id, sample, probability, tail,
+            if (cache.lookup(feature, id, params, sample, probability, tail,
                              conditional, mostAnomalousCorrelate)) {
                 ++hits;
                 error.add(std::fabs(probability - expectedProbability) / expectedProbability);
@@ -268,7 +269,7 @@ void CModelToolsTest::testProbabilityCache() {
                 CPPUNIT_ASSERT(mostAnomalousCorrelate.empty());
             } else {
                 cache.addModes(feature, id, model);
-                cache.addProbability(feature, id, sample, expectedProbability,
+                cache.addProbability(feature, id, params, sample, expectedProbability,
                                      expectedTail, false, mostAnomalousCorrelate);
             }
         }
@@ -300,19 +301,146 @@ void CModelToolsTest::testProbabilityCache() {
 
             double probability;
             TTail2Vec tail;
-            if (cache.lookup(feature, id, sample, probability, tail,
+            if (cache.lookup(feature, id, params, sample, probability, tail,
                              conditional, mostAnomalousCorrelate)) {
                 // Shouldn't have any cache hits.
                 CPPUNIT_ASSERT(false);
             } else {
                 cache.addModes(feature, id, model);
-                cache.addProbability(feature, id, sample, expectedProbability,
+                cache.addProbability(feature, id, params, sample, expectedProbability,
                                      expectedTail, false, mostAnomalousCorrelate);
             }
         }
     }
 }
 
+void CModelToolsTest::testProbabilityCacheInvalidation() {
+    using TBool2Vec = core::CSmallVector<bool, 2>;
+    using TSize1Vec = core::CSmallVector<std::size_t, 1>;
+    using TTime2Vec = core::CSmallVector<core_t::TTime, 2>;
+    using TTime2Vec1Vec = core::CSmallVector<TTime2Vec, 1>;
+    using TDouble2Vec1Vec = core::CSmallVector<TDouble2Vec, 1>;
+    using TDouble2VecWeightsAryVec = std::vector<maths_t::TDouble2VecWeightsAry>;
+    using TTail2Vec = core::CSmallVector<maths_t::ETail, 2>;
+
+    core_t::TTime bucketLength{1800};
+
+    maths::CTimeSeriesDecomposition trend{DECAY_RATE, bucketLength};
+    maths::CUnivariateTimeSeriesModel model{
+        params(bucketLength), 0, trend, multimodal(), nullptr, false};
+    test::CRandomNumbers rng;
+
+    TDoubleVec samples;
+    rng.generateNormalSamples(10.0, 4.0, 200, samples);
+    TDouble2VecWeightsAryVec weights{maths_t::CUnitWeights::unit<TDouble2Vec>(1)};
+    for (auto sample : samples) {
+        maths::CModelAddSamplesParams params;
+        params.integer(false).propagationInterval(1.0).trendWeights(weights).priorWeights(weights);
+        model.addSamples(params, {core::make_triple(core_t::TTime{0}, TDouble2Vec{sample}, TAG)});
+    }
+
+    model_t::EFeature feature{model_t::E_PopulationMeanByPersonAndAttribute};
+    TTime2Vec1Vec time{TTime2Vec{0}};
+
+    auto probabilityParams = [](double scale) {
+        maths_t::TDouble2VecWeightsAry weight(maths_t::CUnitWeights::unit<TDouble2Vec>(1));
+        maths_t::setSeasonalVarianceScale(TDouble2Vec{scale}, weight);
+        maths::CModelProbabilityParams result;
+        result.addCalculation(maths_t::E_TwoSided)
+            .seasonalConfidenceInterval(0.0)
+            .addBucketEmpty(TBool2Vec{false})
+            .addWeights(weight);
+        return result;
+    };
+
+    auto fill = [&](model::CModelTools::CProbabilityCache& cache, std::size_t id,
+                    const maths::CModelProbabilityParams& params) {
+        for (std::size_t i = 0u; i <= 200; ++i) {
+            TDouble2Vec1Vec value{TDouble2Vec{0.1 * static_cast<double>(i)}};
+            double probability;
+            TTail2Vec tail;
+            bool conditional;
+            TSize1Vec mostAnomalousCorrelate;
+            model.probability(params, time, value, probability, tail,
+                              conditional, mostAnomalousCorrelate);
+            cache.addModes(feature, id, model);
+            cache.addProbability(feature, id, params, value, probability, tail,
+                                 conditional, mostAnomalousCorrelate);
+        }
+    };
+
+    auto hit = [&](model::CModelTools::CProbabilityCache& cache, std::size_t id,
+                   const maths::CModelProbabilityParams& params) {
+        TDouble2Vec1Vec value{TDouble2Vec{0.1 * 120.0}};
+        double probability;
+        TTail2Vec tail;
+        bool conditional;
+        TSize1Vec mostAnomalousCorrelate;
+        return cache.lookup(feature, id, params, value, probability, tail,
+                            conditional, mostAnomalousCorrelate);
+    };
+
+    maths::CModelProbabilityParams params{probabilityParams(1.0)};
+
+    LOG_DEBUG(<< "Test generations");
+    {
+        model::CModelTools::CProbabilityCache cache(0.05);
+        fill(cache, 0, params);
+        fill(cache, 1, params);
+        CPPUNIT_ASSERT(hit(cache, 0, params));
+
+        // Entries survive a new generation unless their model changes.
+        cache.nextGeneration();
+        cache.invalidate(feature, 1);
+        CPPUNIT_ASSERT(hit(cache, 0, params));
+        CPPUNIT_ASSERT(!hit(cache, 1, params));
+    }
+
+    LOG_DEBUG(<< "Test parameters");
+    {
+        model::CModelTools::CProbabilityCache cache(0.05);
+        fill(cache, 0, params);
+        maths::CModelProbabilityParams scaled{probabilityParams(2.0)};
+        CPPUNIT_ASSERT(!hit(cache, 0, scaled));
+        fill(cache, 0, scaled);
+        CPPUNIT_ASSERT(hit(cache, 0, scaled));
+        CPPUNIT_ASSERT(!hit(cache, 0, params));
+    }
+
+    LOG_DEBUG(<< "Test memory budget");
+    {
+        model::CModelTools::CProbabilityCache unlimited(0.05);
+        fill(unlimited, 0, params);
+        std::size_t budget{3 * unlimited.memoryUsage() / 2};
+        LOG_DEBUG(<< "budget = " << budget);
+
+        model::CModelTools::CProbabilityCache cache(0.05, budget);
+        fill(cache, 0, params);
+        cache.nextGeneration();
+        fill(cache, 1, params);
+
+        // The stale generation is removed first.
+        CPPUNIT_ASSERT(!hit(cache, 0, params));
+        CPPUNIT_ASSERT(hit(cache, 1, params));
+        CPPUNIT_ASSERT(cache.memoryUsage() <= budget);
+    }
+
+    LOG_DEBUG(<< "Test statistics");
+    {
+        core::CStat& hits{core::CStatistics::stat(stat_t::E_NumberProbabilityCacheHits)};
+        core::CStat& misses{core::CStatistics::stat(stat_t::E_NumberProbabilityCacheMisses)};
+        uint64_t hits0{hits.value()};
+        uint64_t misses0{misses.value()};
+
+        model::CModelTools::CProbabilityCache cache(0.05);
+        CPPUNIT_ASSERT(!hit(cache, 0, params));
+        fill(cache, 0, params);
+        CPPUNIT_ASSERT(hit(cache, 0, params));
+        CPPUNIT_ASSERT_EQUAL(hits0 + 1, hits.value());
+        CPPUNIT_ASSERT_EQUAL(misses0 + 1, misses.value());
+    }
+}
+
 CppUnit::Test* CModelToolsTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CModelToolsTest");
 
@@ -320,6 +448,9 @@ CppUnit::Test* CModelToolsTest::suite() {
         "CModelToolsTest::testFuzzyDeduplicate", &CModelToolsTest::testFuzzyDeduplicate));
     suiteOfTests->addTest(new CppUnit::TestCaller<CModelToolsTest>(
         "CModelToolsTest::testProbabilityCache", &CModelToolsTest::testProbabilityCache));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CModelToolsTest>(
+        "CModelToolsTest::testProbabilityCacheInvalidation",
+        &CModelToolsTest::testProbabilityCacheInvalidation));
 
     return suiteOfTests;
 }
@@ -5,6 +5,9 @@
  */
 #include "CResourceMonitorTest.h"
 
+#include <core/CMemory.h>
+#include <core/CStatistics.h>
+
 #include <model/CAnomalyDetector.h>
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CHierarchicalResults.h>
@@ -13,7 +16,12 @@
 #include <model/CResourceMonitor.h>
 #include <model/CStringStore.h>
 
+#include <algorithm>
+#include <limits>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace ml;
 using namespace model;
@@ -27,6 +35,15 @@ CppUnit::Test* CResourceMonitorTest::suite() {
         "CResourceMonitorTest::testPruning", &CResourceMonitorTest::testPruning));
     suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
         "CResourceMonitorTest::testExtraMemory", &CResourceMonitorTest::testExtraMemory));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
+        "CResourceMonitorTest::testCanDeferRefreshes",
+        &CResourceMonitorTest::testCanDeferRefreshes));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
+        "CResourceMonitorTest::testDeferredExtraMemory",
+        &CResourceMonitorTest::testDeferredExtraMemory));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
+        "CResourceMonitorTest::testIncrementalAccounting",
+        &CResourceMonitorTest::testIncrementalAccounting));
     return suiteOfTests;
 }
 
@@ -99,7 +116,7 @@ void CResourceMonitorTest::testMonitor() {
         CResourceMonitor mon;
 
         CPPUNIT_ASSERT_EQUAL(std::size_t(0), mon.m_Models.size());
-        CPPUNIT_ASSERT_EQUAL(std::size_t(0), mon.m_CurrentAnomalyDetectorMemory);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), mon.m_CurrentAnomalyDetectorMemory.load());
         CPPUNIT_ASSERT(mon.m_PreviousTotal > 0); // because it includes string store memory
 
         mon.registerComponent(detector1);
@@ -260,11 +277,12 @@ void CResourceMonitorTest::testMonitor() {
 
         std::size_t origTotalMemory = mon.totalMemory();
 
-        // Go up to 10 bytes, triggering a need
-        mon.m_CurrentAnomalyDetectorMemory = 10;
+        // Go up by 2%, triggering a need
+        std::size_t usage{10 + origTotalMemory / 50};
+        mon.m_CurrentAnomalyDetectorMemory = usage;
         CPPUNIT_ASSERT(mon.needToSendReport());
         mon.sendMemoryUsageReport(0);
-        CPPUNIT_ASSERT_EQUAL(origTotalMemory + 10, m_CallbackResults.s_Usage);
+        CPPUNIT_ASSERT_EQUAL(origTotalMemory + usage, m_CallbackResults.s_Usage);
 
         // Nothing new added, so no report
         CPPUNIT_ASSERT(!mon.needToSendReport());
@@ -273,27 +291,29 @@ void CResourceMonitorTest::testMonitor() {
         mon.m_CurrentAnomalyDetectorMemory += 1 + (origTotalMemory + 9) / 10;
         CPPUNIT_ASSERT(mon.needToSendReport());
         mon.sendMemoryUsageReport(0);
-        CPPUNIT_ASSERT_EQUAL(origTotalMemory + 11 + (origTotalMemory + 9) / 10,
+        CPPUNIT_ASSERT_EQUAL(origTotalMemory + usage + 1 + (origTotalMemory + 9) / 10,
                              m_CallbackResults.s_Usage);
 
         // Huge increase should trigger a need
-        mon.m_CurrentAnomalyDetectorMemory = 1000;
+        usage = 2 * origTotalMemory;
+        mon.m_CurrentAnomalyDetectorMemory = usage;
         CPPUNIT_ASSERT(mon.needToSendReport());
         mon.sendMemoryUsageReport(0);
-        CPPUNIT_ASSERT_EQUAL(origTotalMemory + 1000, m_CallbackResults.s_Usage);
+        CPPUNIT_ASSERT_EQUAL(origTotalMemory + usage, m_CallbackResults.s_Usage);
 
         // 0.1% increase should not trigger a need
         mon.m_CurrentAnomalyDetectorMemory += 1 + (origTotalMemory + 999) / 1000;
         CPPUNIT_ASSERT(!mon.needToSendReport());
 
         // A decrease should trigger a need
-        mon.m_CurrentAnomalyDetectorMemory = 900;
+        usage = 9 * usage / 10;
+        mon.m_CurrentAnomalyDetectorMemory = usage;
         CPPUNIT_ASSERT(mon.needToSendReport());
         mon.sendMemoryUsageReport(0);
-        CPPUNIT_ASSERT_EQUAL(origTotalMemory + 900, m_CallbackResults.s_Usage);
+        CPPUNIT_ASSERT_EQUAL(origTotalMemory + usage, m_CallbackResults.s_Usage);
 
         // A tiny decrease should not trigger a need
-        mon.m_CurrentAnomalyDetectorMemory = 899;
+        mon.m_CurrentAnomalyDetectorMemory = usage - 1;
         CPPUNIT_ASSERT(!mon.needToSendReport());
     }
 }
@@ -407,6 +427,212 @@ void CResourceMonitorTest::testExtraMemory() {
     monitor.clearExtraMemory();
     CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
     CPPUNIT_ASSERT_EQUAL(allocationLimit, monitor.allocationLimit());
+
+    // Working memory is included until it's updated.
+    monitor.workingMemoryUsage(300);
+    CPPUNIT_ASSERT_EQUAL(allocationLimit - 300, monitor.allocationLimit());
+    monitor.clearExtraMemory();
+    CPPUNIT_ASSERT_EQUAL(allocationLimit - 300, monitor.allocationLimit());
+    monitor.workingMemoryUsage(0);
+    CPPUNIT_ASSERT_EQUAL(allocationLimit, monitor.allocationLimit());
+}
+
+void CResourceMonitorTest::testCanDeferRefreshes() {
+    const std::string EMPTY_STRING;
+    const core_t::TTime FIRST_TIME(358556400);
+    const core_t::TTime BUCKET_LENGTH(3600);
+
+    CAnomalyDetectorModelConfig modelConfig =
+        CAnomalyDetectorModelConfig::defaultConfig(BUCKET_LENGTH);
+    CLimits limits;
+
+    CSearchKey key(1, // identifier
+                   function_t::E_IndividualMetric, false, model_t::E_XF_None,
+                   "value", "colour");
+
+    CResourceMonitor& monitor = limits.resourceMonitor();
+    monitor.memoryLimit(1);
+
+    CAnomalyDetector detector(1, // identifier
+                              limits, modelConfig, EMPTY_STRING, FIRST_TIME,
+                              modelConfig.factory(key));
+    monitor.forceRefresh(detector);
+    CPPUNIT_ASSERT(monitor.totalMemory() < monitor.m_PruneThreshold);
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes());
+
+    // Sampling can't be deferred if the new models, and then the most the
+    // usage has grown sampling a bucket as well, could reach the threshold.
+    std::size_t headroom{monitor.m_PruneThreshold - monitor.totalMemory()};
+    CPPUNIT_ASSERT(monitor.canDeferSampling(headroom - 1));
+    CPPUNIT_ASSERT(monitor.canDeferSampling(headroom) == false);
+    monitor.startSampling();
+    monitor.m_CurrentAnomalyDetectorMemory += headroom / 2;
+    monitor.finishSampling();
+    monitor.m_CurrentAnomalyDetectorMemory -= headroom / 2;
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes());
+    CPPUNIT_ASSERT(monitor.canDeferSampling(headroom - headroom / 2 - 1));
+    CPPUNIT_ASSERT(monitor.canDeferSampling(headroom - headroom / 2) == false);
+
+    // A smaller growth doesn't change the bound.
+    monitor.startSampling();
+    monitor.m_CurrentAnomalyDetectorMemory += 1;
+    monitor.finishSampling();
+    monitor.m_CurrentAnomalyDetectorMemory -= 1;
+    CPPUNIT_ASSERT(monitor.canDeferSampling(headroom - headroom / 2) == false);
+
+    // Refreshes can't be deferred once the usage, including the memory
+    // reserved for new models, reaches the prune threshold even though
+    // allocations are still allowed.
+    monitor.addExtraMemory(monitor.m_PruneThreshold - monitor.totalMemory());
+    CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes() == false);
+
+    monitor.clearExtraMemory();
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes());
+
+    // Nor once the limit has come into play.
+    monitor.acceptPruningResult();
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes() == false);
+
+    // They always can be if there's no limit.
+    monitor.memoryLimit(std::numeric_limits<std::size_t>::max());
+    CPPUNIT_ASSERT(monitor.canDeferRefreshes());
+}
+
+void CResourceMonitorTest::testDeferredExtraMemory() {
+    // Test that the extra memory added and cleared by deferred tasks is the
+    // same as if the tasks had been run one at a time, whatever the order
+    // and threads they actually run on.
+
+    using TBoolSizePr = std::pair<bool, std::size_t>;
+    using TBoolSizePrVec = std::vector<TBoolSizePr>;
+
+    // Each task optionally clears the extra memory and then adds some.
+    TBoolSizePrVec tasks{{true, 100}, {false, 20}, {true, 30}, {false, 5}};
+
+    auto runTask = [](CResourceMonitor& monitor, const TBoolSizePr& task) {
+        if (task.first) {
+            monitor.clearExtraMemory();
+        }
+        monitor.addExtraMemory(task.second);
+    };
+
+    CResourceMonitor serial;
+    serial.addExtraMemory(1000);
+    for (const auto& task : tasks) {
+        runTask(serial, task);
+    }
+
+    CResourceMonitor deferred;
+    deferred.addExtraMemory(1000);
+    deferred.deferRefreshes(tasks.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = tasks.size(); i > 0; --i) {
+        threads.emplace_back([&deferred, &tasks, &runTask, i] {
+            CResourceMonitor::CScopedDeferredTask scopedTask(deferred, i - 1);
+            runTask(deferred, tasks[i - 1]);
+        });
+        threads.back().join();
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1000), deferred.m_ExtraMemory);
+    deferred.commitDeferredRefreshes();
+
+    LOG_DEBUG(<< "serial = " << serial.m_ExtraMemory << ", deferred = " << deferred.m_ExtraMemory);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(35), serial.m_ExtraMemory);
+    CPPUNIT_ASSERT_EQUAL(serial.m_ExtraMemory, deferred.m_ExtraMemory);
+    CPPUNIT_ASSERT_EQUAL(serial.totalMemory(), deferred.totalMemory());
+
+    // Extra memory added outside any task accumulates.
+    deferred.deferRefreshes();
+    deferred.addExtraMemory(10);
+    deferred.addExtraMemory(15);
+    deferred.commitDeferredRefreshes();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(60), deferred.m_ExtraMemory);
+}
+
+void CResourceMonitorTest::testIncrementalAccounting() {
+    const std::string EMPTY_STRING;
+    const core_t::TTime FIRST_TIME(358556400);
+    const core_t::TTime BUCKET_LENGTH(3600);
+
+    CAnomalyDetectorModelConfig modelConfig =
+        CAnomalyDetectorModelConfig::defaultConfig(BUCKET_LENGTH);
+    CLimits limits;
+
+    CSearchKey key(1, // identifier
+                   function_t::E_IndividualMetric, false, model_t::E_XF_None,
+                   "value", "colour");
+
+    CResourceMonitor& monitor = limits.resourceMonitor();
+
+    CAnomalyDetector detector1(1, // identifier
+                               limits, modelConfig, EMPTY_STRING, FIRST_TIME,
+                               modelConfig.factory(key));
+
+    auto modelUsage = [&monitor](CAnomalyDetector& detector) {
+        return monitor.componentMemoryUsage(detector);
+    };
+    auto numberVerifications = []() {
+        return core::CStatistics::stat(stat_t::E_NumberMemoryUsageVerifications).value();
+    };
+    auto latestDrift = []() {
+        return core::CStatistics::stat(stat_t::E_MemoryUsageDrift).value();
+    };
+
+    core_t::TTime bucket = FIRST_TIME;
+    std::size_t startOffset = 10;
+    {
+        CAnomalyDetector detector2(2, // identifier
+                                   limits, modelConfig, EMPTY_STRING,
+                                   FIRST_TIME, modelConfig.factory(key));
+
+        // The total is the sum of the models' usages however they change.
+        core_t::TTime bucket2 = FIRST_TIME;
+        this->addTestData(bucket, BUCKET_LENGTH, 10, 5, startOffset, detector1, monitor);
+        this->addTestData(bucket2, BUCKET_LENGTH, 5, 2, startOffset, detector2, monitor);
+        monitor.forceRefresh(detector1);
+        monitor.forceRefresh(detector2);
+        CPPUNIT_ASSERT_EQUAL(modelUsage(detector1) + modelUsage(detector2),
+                             monitor.m_CurrentAnomalyDetectorMemory.load());
+
+        // Deferred changes only affect the total on commit.
+        std::size_t total{monitor.m_CurrentAnomalyDetectorMemory.load()};
+        monitor.deferRefreshes();
+        this->addTestData(bucket, BUCKET_LENGTH, 2, 10, startOffset, detector1, monitor);
+        monitor.forceRefresh(detector1);
+        monitor.forceRefresh(detector2);
+        CPPUNIT_ASSERT_EQUAL(total, monitor.m_CurrentAnomalyDetectorMemory.load());
+        monitor.commitDeferredRefreshes();
+        CPPUNIT_ASSERT_EQUAL(modelUsage(detector1) + modelUsage(detector2),
+                             monitor.m_CurrentAnomalyDetectorMemory.load());
+    }
+
+    // Unregistering a detector removes its usage from the total.
+    CPPUNIT_ASSERT_EQUAL(modelUsage(detector1), monitor.m_CurrentAnomalyDetectorMemory.load());
+
+    // Refreshes measure the models' growth without walking them.
+    uint64_t verifications{numberVerifications()};
+    std::size_t usage{modelUsage(detector1)};
+    this->addTestData(bucket, BUCKET_LENGTH, 3, 10, startOffset, detector1, monitor);
+    monitor.forceRefresh(detector1);
+    CPPUNIT_ASSERT_EQUAL(verifications, numberVerifications());
+    CPPUNIT_ASSERT(modelUsage(detector1) > usage);
+    CPPUNIT_ASSERT_EQUAL(modelUsage(detector1), monitor.m_CurrentAnomalyDetectorMemory.load());
+
+    // Verification publishes the latest drift without changing the usage.
+    usage = modelUsage(detector1);
+    std::size_t drift{monitor.verifyMemoryUsage(detector1)};
+    std::size_t walked{detector1.model()->walkMemoryUsage()};
+    CPPUNIT_ASSERT_EQUAL(std::max(walked, usage) - std::min(walked, usage), drift);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(drift), latestDrift());
+    CPPUNIT_ASSERT_EQUAL(verifications + 1, numberVerifications());
+    CPPUNIT_ASSERT_EQUAL(usage, modelUsage(detector1));
+    CPPUNIT_ASSERT_EQUAL(usage, monitor.m_CurrentAnomalyDetectorMemory.load());
+
+    // Each usage report verifies one model.
+    monitor.sendMemoryUsageReport(bucket);
+    CPPUNIT_ASSERT_EQUAL(verifications + 2, numberVerifications());
+    CPPUNIT_ASSERT_EQUAL(usage, monitor.m_CurrentAnomalyDetectorMemory.load());
 }
 
 void CResourceMonitorTest::addTestData(core_t::TTime& firstTime,
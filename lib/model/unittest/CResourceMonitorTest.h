@@ -23,6 +23,9 @@ public:
     void testMonitor();
     void testPruning();
     void testExtraMemory();
+    void testCanDeferRefreshes();
+    void testDeferredExtraMemory();
+    void testIncrementalAccounting();
 
     static CppUnit::Test* suite();
 
@@ -8,12 +8,16 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
+#include <core/CStringUtils.h>
 #include <core/CThread.h>
 
 #include <model/CStringStore.h>
 
 #include <cppunit/Exception.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 
 using namespace ml;
@@ -80,6 +84,47 @@ private:
     TStrCPtrUSet m_UniquePtrs;
     TCppUnitExceptionP m_LastException;
 };
+
+class CLookupThread : public core::CThread {
+public:
+    using TCppUnitExceptionP = std::shared_ptr<CppUnit::Exception>;
+
+public:
+    CLookupThread(std::size_t lookups, const TStrVec& strings)
+        : m_Lookups(lookups), m_Strings(strings) {}
+
+    void propagateLastThreadAssert() {
+        if (m_LastException) {
+            throw *m_LastException;
+        }
+    }
+
+private:
+    virtual void run() {
+        try {
+            // A string which is held can't be pruned so every lookup must
+            // get the same pointer.
+            core::CStoredStringPtr held = CStringStore::names().get(m_Strings[0]);
+            std::size_t n = m_Strings.size();
+            for (std::size_t i = 0u; i < m_Lookups; ++i) {
+                core::CStoredStringPtr p = CStringStore::names().get(m_Strings[i % n]);
+                CPPUNIT_ASSERT_EQUAL(m_Strings[i % n], *p);
+                if (i % n == 0) {
+                    CPPUNIT_ASSERT_EQUAL(held.get(), p.get());
+                }
+            }
+        } catch (CppUnit::Exception& e) {
+            m_LastException.reset(new CppUnit::Exception(e));
+        }
+    }
+
+    virtual void shutdown() {}
+
+private:
+    std::size_t m_Lookups;
+    TStrVec m_Strings;
+    TCppUnitExceptionP m_LastException;
+};
 }
 
 void CStringStoreTest::setUp() {
@@ -121,11 +166,11 @@ void CStringStoreTest::testStringStore() {
         CPPUNIT_ASSERT_EQUAL(pG.get(), pG2.get());
         CPPUNIT_ASSERT_EQUAL(*pG, *pG2);
 
-        CPPUNIT_ASSERT_EQUAL(std::size_t(1), CStringStore::names().m_Strings.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), CStringStore::names().size());
     }
-    CPPUNIT_ASSERT_EQUAL(std::size_t(1), CStringStore::names().m_Strings.size());
-    CStringStore::names().pruneNotThreadSafe();
-    CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().m_Strings.size());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), CStringStore::names().size());
+    CStringStore::names().prune();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
 
     {
         LOG_DEBUG(<< "Testing multi-threaded");
@@ -143,11 +188,11 @@ void CStringStoreTest::testStringStore() {
             CPPUNIT_ASSERT(threads[i]->waitForFinish());
         }
 
-        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().m_Strings.size());
-        CStringStore::names().pruneNotThreadSafe();
-        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().m_Strings.size());
+        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().size());
+        CStringStore::names().prune();
+        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().size());
         CPPUNIT_ASSERT_EQUAL(std::size_t(0),
-                             CStringStore::influencers().m_Strings.size());
+                             CStringStore::influencers().size());
 
         for (std::size_t i = 0; i < threads.size(); ++i) {
             // CppUnit won't automatically catch the exceptions thrown by
@@ -158,11 +203,11 @@ void CStringStoreTest::testStringStore() {
             threads[i]->clearPtrs();
         }
 
-        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().m_Strings.size());
-        CStringStore::names().pruneNotThreadSafe();
-        CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().m_Strings.size());
+        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().size());
+        CStringStore::names().prune();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
         threads.clear();
-        CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().m_Strings.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
     }
     {
         LOG_DEBUG(<< "Testing multi-threaded string duplication rate");
@@ -196,13 +241,13 @@ void CStringStoreTest::testStringStore() {
             threads[i]->uniques(uniques);
         }
         LOG_DEBUG(<< "unique counts = " << uniques.size());
-        CPPUNIT_ASSERT(uniques.size() < 20000);
+        CPPUNIT_ASSERT_EQUAL(lotsOfStrings.size(), uniques.size());
 
         // Tidy up
         for (std::size_t i = 0; i < threads.size(); ++i) {
             threads[i]->clearPtrs();
         }
-        CStringStore::names().pruneNotThreadSafe();
+        CStringStore::names().prune();
     }
 }
 
@@ -225,7 +270,7 @@ void CStringStoreTest::testMemUsage() {
 
         // This pruning should have no effect, as there are external pointers to
         // the contents
-        CStringStore::names().pruneNotThreadSafe();
+        CStringStore::names().prune();
         CPPUNIT_ASSERT_EQUAL(inUseMemUse, CStringStore::names().memoryUsage());
     }
 
@@ -234,7 +279,7 @@ void CStringStoreTest::testMemUsage() {
     CPPUNIT_ASSERT_EQUAL(inUseMemUse, CStringStore::names().memoryUsage());
 
     // There are no external references, so this should remove values
-    CStringStore::names().pruneNotThreadSafe();
+    CStringStore::names().prune();
     std::size_t prunedMemUse = CStringStore::names().memoryUsage();
     LOG_DEBUG(<< "Pruned memory usage: " << prunedMemUse);
     CPPUNIT_ASSERT(prunedMemUse < inUseMemUse - shortStr.length() - longStr.length());
@@ -243,6 +288,119 @@ void CStringStoreTest::testMemUsage() {
     CPPUNIT_ASSERT_EQUAL(origMemUse, CStringStore::names().memoryUsage());
 }
 
+void CStringStoreTest::testBatchGet() {
+    CStringStore::TOptionalStrVec values;
+    for (std::size_t i = 0u; i < 100; ++i) {
+        values.emplace_back(core::CStringUtils::typeToString(i % 50));
+    }
+    values.emplace_back();
+    values.emplace_back(std::string());
+
+    TStoredStringPtrVec ptrs;
+    CStringStore::names().get(values, ptrs);
+
+    CPPUNIT_ASSERT_EQUAL(values.size(), ptrs.size());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(50), CStringStore::names().size());
+    for (std::size_t i = 0u; i < 100; ++i) {
+        CPPUNIT_ASSERT(ptrs[i]);
+        CPPUNIT_ASSERT_EQUAL(*values[i], *ptrs[i]);
+        // Repeated values share the same stored string.
+        CPPUNIT_ASSERT_EQUAL(ptrs[i % 50].get(), ptrs[i].get());
+        // The result should match getting the values one at a time.
+        CPPUNIT_ASSERT_EQUAL(ptrs[i].get(), CStringStore::names().get(*values[i]).get());
+    }
+    CPPUNIT_ASSERT(ptrs[100] == nullptr);
+    CPPUNIT_ASSERT_EQUAL(CStringStore::names().getEmpty().get(), ptrs[101].get());
+
+    // The thread cache mustn't stop strings being pruned.
+    ptrs.clear();
+    CStringStore::names().prune();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
+
+    CStringStore::names().get(values, ptrs);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(50), CStringStore::names().size());
+    for (std::size_t i = 0u; i < 100; ++i) {
+        CPPUNIT_ASSERT_EQUAL(*values[i], *ptrs[i]);
+    }
+    ptrs.clear();
+    CStringStore::names().prune();
+}
+
+void CStringStoreTest::testConcurrentPrune() {
+    // Test that pruning is safe while other threads are getting strings.
+
+    TStrVec strings;
+    for (std::size_t i = 0u; i < 200; ++i) {
+        strings.push_back(core::CStringUtils::typeToString(i));
+    }
+
+    using TThreadPtr = std::shared_ptr<CLookupThread>;
+    using TThreadVec = std::vector<TThreadPtr>;
+    TThreadVec threads;
+    for (std::size_t i = 0; i < 8; ++i) {
+        threads.emplace_back(new CLookupThread(200000, strings));
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        CPPUNIT_ASSERT(threads[i]->start());
+    }
+    for (std::size_t i = 0; i < 100; ++i) {
+        CStringStore::names().prune();
+        CPPUNIT_ASSERT(CStringStore::names().size() <= strings.size());
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        CPPUNIT_ASSERT(threads[i]->waitForFinish());
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->propagateLastThreadAssert();
+    }
+
+    // Nothing holds the strings once the threads have finished.
+    CStringStore::names().prune();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
+}
+
+void CStringStoreTest::testContention() {
+    // Measure the lookup throughput as the number of threads increases.
+
+    TStrVec strings;
+    for (std::size_t i = 0u; i < 1000; ++i) {
+        strings.push_back("string" + core::CStringUtils::typeToString(i));
+    }
+
+    std::size_t lookups{1000000};
+
+    for (std::size_t numberThreads : {1, 2, 4, 8}) {
+        using TThreadPtr = std::shared_ptr<CLookupThread>;
+        using TThreadVec = std::vector<TThreadPtr>;
+        TThreadVec threads;
+        for (std::size_t i = 0; i < numberThreads; ++i) {
+            threads.emplace_back(new CLookupThread(lookups, strings));
+        }
+
+        core::CStopWatch stopWatch(true);
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            CPPUNIT_ASSERT(threads[i]->start());
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            CPPUNIT_ASSERT(threads[i]->waitForFinish());
+        }
+        std::uint64_t time{stopWatch.stop()};
+
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            threads[i]->propagateLastThreadAssert();
+        }
+        LOG_DEBUG(<< numberThreads << " threads: " << numberThreads * lookups
+                  << " lookups took " << time << "ms ("
+                  << static_cast<double>(numberThreads * lookups) /
+                         static_cast<double>(std::max(time, std::uint64_t(1)))
+                  << " lookups/ms)");
+
+        CPPUNIT_ASSERT_EQUAL(strings.size(), CStringStore::names().size());
+        CStringStore::names().prune();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), CStringStore::names().size());
+    }
+}
+
 CppUnit::Test* CStringStoreTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CStringStoreTest");
 
@@ -250,6 +408,12 @@ CppUnit::Test* CStringStoreTest::suite() {
         "CStringStoreTest::testStringStore", &CStringStoreTest::testStringStore));
     suiteOfTests->addTest(new CppUnit::TestCaller<CStringStoreTest>(
         "CStringStoreTest::testMemUsage", &CStringStoreTest::testMemUsage));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringStoreTest>(
+        "CStringStoreTest::testBatchGet", &CStringStoreTest::testBatchGet));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringStoreTest>(
+        "CStringStoreTest::testConcurrentPrune", &CStringStoreTest::testConcurrentPrune));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringStoreTest>(
+        "CStringStoreTest::testContention", &CStringStoreTest::testContention));
 
     return suiteOfTests;
 }
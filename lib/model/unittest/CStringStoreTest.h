@@ -15,6 +15,9 @@ public:
 
     void testStringStore();
     void testMemUsage();
+    void testBatchGet();
+    void testConcurrentPrune();
+    void testContention();
 
     static CppUnit::Test* suite();
 };